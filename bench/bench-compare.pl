@@ -0,0 +1,197 @@
+#! /usr/bin/perl -w
+#
+#######################################################################
+#  Copyright (C) 2015 by Carnegie Mellon University.
+#
+#  See end of file
+#######################################################################
+#  bench-compare.pl
+#
+#    Compare two JSON result files written by silkbench or
+#    bench-scenarios.pl, such as those from "make bench" on the base
+#    and head of a branch.  For each benchmark in both files, print
+#    the time per operation in each and the change, and flag the
+#    benchmarks that are slower by more than --threshold percent.
+#
+#    Exits with status 1 when any benchmark is flagged, so the script
+#    may be used to fail a build.
+#
+#######################################################################
+#  RCSIDENT("$SiLK: bench-compare.pl $")
+#######################################################################
+
+use strict;
+use Getopt::Long qw(GetOptions);
+
+our $THRESHOLD = 10;
+
+process_options();
+
+my ($old_file, $new_file) = @ARGV;
+my ($old_order, $old) = read_results($old_file);
+my ($new_order, $new) = read_results($new_file);
+
+my $regressions = 0;
+
+printf("%-34s %14s %14s %9s\n", 'benchmark', 'old ns/op', 'new ns/op',
+       'change');
+for my $name (@$new_order) {
+    unless (exists $old->{$name}) {
+        printf("%-34s %14s %14.1f %9s\n", $name, '-', $new->{$name}, 'new');
+        next;
+    }
+    my $change = (($old->{$name} > 0)
+                  ? 100.0 * ($new->{$name} - $old->{$name}) / $old->{$name}
+                  : 0.0);
+    my $flag = '';
+    if ($change > $THRESHOLD) {
+        $flag = '  REGRESSION';
+        ++$regressions;
+    }
+    printf("%-34s %14.1f %14.1f %+8.1f%%%s\n",
+           $name, $old->{$name}, $new->{$name}, $change, $flag);
+}
+for my $name (@$old_order) {
+    unless (exists $new->{$name}) {
+        printf("%-34s %14.1f %14s %9s\n", $name, $old->{$name}, '-',
+               'removed');
+    }
+}
+
+if ($regressions) {
+    print "\n$regressions benchmark(s) slower by more than $THRESHOLD%\n";
+    exit 1;
+}
+exit 0;
+
+
+#  (\@names, \%ns_per_op) = read_results($file);
+#
+#    Read the results from the JSON in $file.  Return the benchmark
+#    names in the order they appear and a hash from each name to its
+#    time per operation in nanoseconds.
+#
+sub read_results
+{
+    my ($file) = @_;
+
+    open my $fh, '<', $file
+        or die "$0: Unable to open '$file': $!\n";
+    my $json = do { local $/; <$fh> };
+    close $fh;
+
+    my @names;
+    my %ns_per_op;
+    while ($json =~ /\{([^{}]*)\}/g) {
+        my $obj = $1;
+        my ($name) = ($obj =~ /"name"\s*:\s*"([^"]*)"/);
+        my ($ops) = ($obj =~ /"operations"\s*:\s*(\d+)/);
+        my ($secs) = ($obj =~ /"seconds"\s*:\s*([0-9.eE+-]+)/);
+        next unless defined $name && defined $ops && defined $secs;
+        push @names, $name unless exists $ns_per_op{$name};
+        $ns_per_op{$name} = (($ops) ? 1.0e9 * $secs / $ops : 0.0);
+    }
+    unless (@names) {
+        die "$0: No benchmark results found in '$file'\n";
+    }
+    return (\@names, \%ns_per_op);
+}
+
+
+sub process_options
+{
+    my $help;
+
+    GetOptions('help|?'      => \$help,
+               'threshold=f' => \$THRESHOLD,
+        ) or usage(1);
+
+    usage(0) if $help;
+
+    if (@ARGV != 2) {
+        warn "$0: Expected the names of two result files\n";
+        usage(1);
+    }
+}
+
+
+sub usage
+{
+    my ($exit_val) = @_;
+
+    my $usage = <<EOF_USAGE;
+Usage: $0 [--threshold=PERCENT] OLD.json NEW.json
+
+Compare the benchmark results in OLD.json and NEW.json, which were
+written by silkbench or bench-scenarios.pl.  Exit with status 1 if
+any benchmark's time per operation grew by more than PERCENT.
+
+SWITCHES:
+--threshold=PERCENT  Flag benchmarks slower by more than PERCENT.
+                     Def. $THRESHOLD
+--help               Print this usage output and exit
+EOF_USAGE
+
+    if ($exit_val) {
+        print STDERR $usage;
+    }
+    else {
+        print $usage;
+    }
+
+    exit $exit_val;
+}
+
+__END__
+
+#######################################################################
+# Copyright (C) 2015 by Carnegie Mellon University.
+#
+# @OPENSOURCE_HEADER_START@
+#
+# Use of the SILK system and related source code is subject to the terms
+# of the following licenses:
+#
+# GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+# Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+#
+# NO WARRANTY
+#
+# ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+# PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+# PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+# "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+# KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+# LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+# MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+# OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+# SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+# TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+# WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+# LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+# CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+# CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+# DELIVERABLES UNDER THIS LICENSE.
+#
+# Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+# Mellon University, its trustees, officers, employees, and agents from
+# all claims or demands made against them (and any related losses,
+# expenses, or attorney's fees) arising out of, or relating to Licensee's
+# and/or its sub licensees' negligent use or willful misuse of or
+# negligent conduct or willful misconduct regarding the Software,
+# facilities, or other rights or assistance granted by Carnegie Mellon
+# University under this License, including, but not limited to, any
+# claims of product liability, personal injury, death, damage to
+# property, or violation of any laws or regulations.
+#
+# Carnegie Mellon University Software Engineering Institute authored
+# documents are sponsored by the U.S. Department of Defense under
+# Contract FA8721-05-C-0003. Carnegie Mellon University retains
+# copyrights in all material produced under this contract. The U.S.
+# Government retains a non-exclusive, royalty-free license to publish or
+# reproduce these documents, or allow others to do so, for U.S.
+# Government purposes only pursuant to the copyright license under the
+# contract clause at 252.227.7013.
+#
+# @OPENSOURCE_HEADER_END@
+#######################################################################
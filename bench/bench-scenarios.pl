@@ -0,0 +1,211 @@
+#! /usr/bin/perl -w
+#
+#######################################################################
+#  Copyright (C) 2015 by Carnegie Mellon University.
+#
+#  See end of file
+#######################################################################
+#  bench-scenarios.pl
+#
+#    Time end-to-end runs of rwfilter, rwsort, rwuniq, and rwstats on
+#    the data file given by --data and write the results as JSON in
+#    the same form as silkbench, so that bench-compare.pl can compare
+#    them.  Each scenario is run --repeat times and the fastest run is
+#    reported.  The output of every command is discarded.
+#
+#######################################################################
+#  RCSIDENT("$SiLK: bench-scenarios.pl $")
+#######################################################################
+
+use strict;
+use Getopt::Long qw(GetOptions);
+use Time::HiRes qw(gettimeofday tv_interval);
+
+our $BINDIR = '../src';
+our $DATA;
+our $OUTPUT = '-';
+our $REPEAT = 3;
+our $FILTER;
+
+# each scenario is a name, the tool to run (relative to $BINDIR), and
+# its arguments; the data file is appended to the arguments
+our @SCENARIOS = (
+    ['rwfilter-proto-port', 'rwfilter/rwfilter',
+     '--proto=6 --dport=80,443,8080 --pass=/dev/null'],
+    ['rwfilter-addresses', 'rwfilter/rwfilter',
+     '--scidr=10.0.0.0/8,192.168.0.0/16 --not-dcidr=172.16.0.0/12'
+     .' --pass=/dev/null --fail=/dev/null'],
+    ['rwsort-sip-sport', 'rwsort/rwsort',
+     '--fields=sip,sport,stime --output-path=/dev/null'],
+    ['rwsort-bytes', 'rwsort/rwsort',
+     '--fields=bytes --reverse --output-path=/dev/null'],
+    ['rwuniq-sip', 'rwuniq/rwuniq',
+     '--fields=sip --values=records,bytes,packets --output-path=/dev/null'],
+    ['rwuniq-five-tuple', 'rwuniq/rwuniq',
+     '--fields=sip,dip,sport,dport,proto --values=records,distinct:stime'
+     .' --output-path=/dev/null'],
+    ['rwstats-dport', 'rwstats/rwstats',
+     '--fields=dport --values=bytes --count=20 --output-path=/dev/null'],
+    ['rwstats-sip-dip', 'rwstats/rwstats',
+     '--fields=sip,dip --values=records --percentage=1'
+     .' --output-path=/dev/null'],
+    );
+
+process_options();
+
+# the number of records in the data file is the number of operations
+my $rwfileinfo = "$BINDIR/rwfileinfo/rwfileinfo";
+my $records = `$rwfileinfo --fields=count-records --no-titles '$DATA'`;
+unless (defined $records && $records =~ /(\d+)/) {
+    die "$0: Unable to determine the number of records in '$DATA'\n";
+}
+$records = $1;
+
+my @results;
+for my $s (@SCENARIOS) {
+    my ($name, $tool, $args) = @$s;
+    next if defined $FILTER && -1 == index($name, $FILTER);
+
+    my $cmd = "$BINDIR/$tool $args '$DATA' >/dev/null";
+    my $best;
+    for (1 .. $REPEAT) {
+        my $start = [gettimeofday];
+        if (system $cmd) {
+            die "$0: Scenario $name failed: $cmd\n";
+        }
+        my $elapsed = tv_interval($start);
+        $best = $elapsed if !defined $best || $elapsed < $best;
+    }
+    push @results, sprintf(('    {"name": "%s", "operations": %d,'
+                            .' "seconds": %.6f, "ops_per_sec": %.1f}'),
+                           $name, $records, $best,
+                           (($best > 0) ? $records / $best : 0));
+}
+
+my $fh;
+if ($OUTPUT eq '-' || $OUTPUT eq 'stdout') {
+    $fh = \*STDOUT;
+}
+else {
+    open $fh, '>', $OUTPUT
+        or die "$0: Unable to open output file '$OUTPUT': $!\n";
+}
+print $fh "{\n  \"suite\": \"scenarios\",\n",
+    "  \"records\": $records,\n  \"repeat\": $REPEAT,\n",
+    "  \"results\": [\n", join(",\n", @results), "\n  ]\n}\n";
+close $fh
+    or die "$0: Unable to close output file '$OUTPUT': $!\n";
+
+exit 0;
+
+
+sub process_options
+{
+    my $help;
+
+    GetOptions('help|?'     => \$help,
+               'bindir=s'   => \$BINDIR,
+               'data=s'     => \$DATA,
+               'output=s'   => \$OUTPUT,
+               'repeat=i'   => \$REPEAT,
+               'name-filter=s' => \$FILTER,
+        ) or usage(1);
+
+    usage(0) if $help;
+
+    unless (defined $DATA) {
+        warn "$0: The --data switch is required\n";
+        usage(1);
+    }
+    unless (-f $DATA) {
+        die "$0: Data file '$DATA' does not exist\n";
+    }
+    if ($REPEAT < 1) {
+        die "$0: The --repeat value must be positive\n";
+    }
+}
+
+
+sub usage
+{
+    my ($exit_val) = @_;
+
+    my $usage = <<EOF_USAGE;
+Usage: $0 --data=FILE [SWITCHES]
+
+Time end-to-end runs of the SiLK tools on the flow records in FILE
+and write the results as JSON.
+
+SWITCHES:
+--bindir=DIR  Find the tools in subdirectories of DIR, as in the
+              build tree. Def. $BINDIR
+--output=FILE Write the JSON to FILE. Def. stdout
+--repeat=NUM  Run each scenario NUM times and report the fastest run.
+              Def. $REPEAT
+--name-filter=STRING  Only run the scenarios whose names contain STRING
+--help        Print this usage output and exit
+EOF_USAGE
+
+    if ($exit_val) {
+        print STDERR $usage;
+    }
+    else {
+        print $usage;
+    }
+
+    exit $exit_val;
+}
+
+__END__
+
+#######################################################################
+# Copyright (C) 2015 by Carnegie Mellon University.
+#
+# @OPENSOURCE_HEADER_START@
+#
+# Use of the SILK system and related source code is subject to the terms
+# of the following licenses:
+#
+# GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+# Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+#
+# NO WARRANTY
+#
+# ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+# PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+# PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+# "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+# KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+# LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+# MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+# OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+# SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+# TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+# WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+# LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+# CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+# CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+# DELIVERABLES UNDER THIS LICENSE.
+#
+# Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+# Mellon University, its trustees, officers, employees, and agents from
+# all claims or demands made against them (and any related losses,
+# expenses, or attorney's fees) arising out of, or relating to Licensee's
+# and/or its sub licensees' negligent use or willful misuse of or
+# negligent conduct or willful misconduct regarding the Software,
+# facilities, or other rights or assistance granted by Carnegie Mellon
+# University under this License, including, but not limited to, any
+# claims of product liability, personal injury, death, damage to
+# property, or violation of any laws or regulations.
+#
+# Carnegie Mellon University Software Engineering Institute authored
+# documents are sponsored by the U.S. Department of Defense under
+# Contract FA8721-05-C-0003. Carnegie Mellon University retains
+# copyrights in all material produced under this contract. The U.S.
+# Government retains a non-exclusive, royalty-free license to publish or
+# reproduce these documents, or allow others to do so, for U.S.
+# Government purposes only pursuant to the copyright license under the
+# contract clause at 252.227.7013.
+#
+# @OPENSOURCE_HEADER_END@
+#######################################################################
@@ -0,0 +1,416 @@
+#! /usr/bin/perl -w
+#
+#######################################################################
+#  Copyright (C) 2015 by Carnegie Mellon University.
+#
+#  See end of file
+#######################################################################
+#  bench-sendrcv.pl
+#
+#    Time the transfer of a set of files from an rwsender to an
+#    rwreceiver over the loopback interface and write the results as
+#    JSON in the same form as silkbench, so that bench-compare.pl can
+#    compare them.  The operations of each scenario are the bytes
+#    transferred.  Each scenario is run --repeat times and the fastest
+#    run is reported.
+#
+#    A run starts the rwreceiver and the rwsender, waits for them to
+#    connect, and places the files in the incoming directory.  The
+#    time starts when the rwsender takes the first file from the
+#    incoming directory, so that it does not include the polling
+#    interval, and ends once every file is in the destination
+#    directory.
+#
+#######################################################################
+#  RCSIDENT("$SiLK: bench-sendrcv.pl $")
+#######################################################################
+
+use strict;
+use File::Path qw(mkpath rmtree);
+use File::Temp qw(tempdir);
+use Getopt::Long qw(GetOptions);
+use IO::Socket::INET;
+use POSIX qw(WNOHANG);
+use Time::HiRes qw(gettimeofday tv_interval sleep);
+
+our $BINDIR = '../src';
+our $OUTPUT = '-';
+our $REPEAT = 3;
+our $FILE_COUNT = 16;
+our $FILE_SIZE = 4 * 1024 * 1024;
+our $TIMEOUT = 300;
+our $FILTER;
+
+# each scenario is a name, the kind of file content ('random' or
+# 'text'), and the additional arguments to rwsender
+our @SCENARIOS = (
+    ['sendrcv-random', 'random', ''],
+    ['sendrcv-random-4m-blocks', 'random', '--block-size=4194304'],
+    ['sendrcv-text', 'text', ''],
+    ['sendrcv-text-compressed', 'text', '--transfer-compression=best'],
+    );
+
+process_options();
+
+my $rwsender = "$BINDIR/sendrcv/rwsender";
+my $rwreceiver = "$BINDIR/sendrcv/rwreceiver";
+for my $prog ($rwsender, $rwreceiver) {
+    die "$0: Cannot find '$prog'\n" unless -x $prog;
+}
+
+my $tmpdir = tempdir('bench-sendrcv-XXXXXX', TMPDIR => 1, CLEANUP => 1);
+
+# create the files once; each run hard-links them into the incoming
+# directory, since rwsender removes the files it sends
+my %staged;
+for my $content (qw(random text)) {
+    my $dir = "$tmpdir/staged-$content";
+    mkpath($dir);
+    for my $i (1 .. $FILE_COUNT) {
+        create_file(sprintf("%s/%s-%03d", $dir, $content, $i), $content);
+    }
+    $staged{$content} = $dir;
+}
+my $bytes = $FILE_COUNT * $FILE_SIZE;
+
+# stop any daemons that are running when interrupted
+my @daemons;
+$SIG{INT} = $SIG{TERM} = sub { stop_daemons(); exit 1; };
+
+my @results;
+for my $s (@SCENARIOS) {
+    my ($name, $content, $args) = @$s;
+    next if defined $FILTER && -1 == index($name, $FILTER);
+
+    my $best;
+    for (1 .. $REPEAT) {
+        my $elapsed = transfer($staged{$content}, $args, $name);
+        $best = $elapsed if !defined $best || $elapsed < $best;
+    }
+    push @results, sprintf(('    {"name": "%s", "operations": %d,'
+                            .' "seconds": %.6f, "ops_per_sec": %.1f}'),
+                           $name, $bytes, $best,
+                           (($best > 0) ? $bytes / $best : 0));
+}
+
+my $fh;
+if ($OUTPUT eq '-' || $OUTPUT eq 'stdout') {
+    $fh = \*STDOUT;
+}
+else {
+    open $fh, '>', $OUTPUT
+        or die "$0: Unable to open output file '$OUTPUT': $!\n";
+}
+print $fh "{\n  \"suite\": \"sendrcv\",\n",
+    "  \"files\": $FILE_COUNT,\n  \"file_size\": $FILE_SIZE,\n",
+    "  \"repeat\": $REPEAT,\n",
+    "  \"results\": [\n", join(",\n", @results), "\n  ]\n}\n";
+close $fh
+    or die "$0: Unable to close output file '$OUTPUT': $!\n";
+
+exit 0;
+
+
+#  create_file($path, $content);
+#
+#    Write $FILE_SIZE bytes to $path.  The bytes are random when
+#    $content is 'random' and lines of compressible text otherwise.
+#
+sub create_file
+{
+    my ($path, $content) = @_;
+
+    my $data = '';
+    if ($content eq 'random') {
+        open my $rand, '<', '/dev/urandom'
+            or die "$0: Unable to open /dev/urandom: $!\n";
+        binmode $rand;
+        while (length($data) < $FILE_SIZE) {
+            my $buf;
+            read($rand, $buf, $FILE_SIZE - length($data))
+                or die "$0: Unable to read /dev/urandom: $!\n";
+            $data .= $buf;
+        }
+        close $rand;
+    }
+    else {
+        my $line = 0;
+        while (length($data) < $FILE_SIZE) {
+            $data .= sprintf("%d\tsome compressible text\n", ++$line);
+        }
+        $data = substr($data, 0, $FILE_SIZE);
+    }
+
+    open my $out, '>', $path
+        or die "$0: Unable to create '$path': $!\n";
+    binmode $out;
+    print $out $data;
+    close $out
+        or die "$0: Unable to write '$path': $!\n";
+}
+
+
+#  $seconds = transfer($staged_dir, $sender_args, $name);
+#
+#    Send the files in $staged_dir from an rwsender run with the
+#    additional arguments $sender_args to an rwreceiver, and return
+#    the number of seconds it took.
+#
+sub transfer
+{
+    my ($staged_dir, $sender_args, $name) = @_;
+
+    my $dir = "$tmpdir/run";
+    rmtree($dir);
+    for my $d (qw(in proc error dest)) {
+        mkpath("$dir/$d");
+    }
+
+    # find a free port on the loopback interface
+    my $sock = IO::Socket::INET->new(LocalAddr => '127.0.0.1',
+                                     LocalPort => 0, Proto => 'tcp',
+                                     Listen => 1, ReuseAddr => 1)
+        or die "$0: Unable to find a free port: $!\n";
+    my $port = $sock->sockport();
+    close $sock;
+
+    my $common = '--no-daemon --log-level=info';
+    start_daemon("$rwreceiver $common --mode=server"
+                 ." --log-pathname=$dir/receiver.log"
+                 ." --identifier=bench-receiver"
+                 ." --server-port=127.0.0.1:$port"
+                 ." --client-ident=bench-sender"
+                 ." --destination-directory=$dir/dest");
+    start_daemon("$rwsender $common --mode=client"
+                 ." --log-pathname=$dir/sender.log"
+                 ." --identifier=bench-sender"
+                 ." --server-address=bench-receiver:127.0.0.1:$port"
+                 ." --incoming-directory=$dir/in"
+                 ." --processing-directory=$dir/proc"
+                 ." --error-directory=$dir/error"
+                 ." --polling-interval=1 $sender_args");
+
+    my $wait_start = [gettimeofday];
+    wait_for($name, $wait_start, sub {
+        my $log = '';
+        if (open my $lfh, '<', "$dir/sender.log") {
+            local $/;
+            $log = <$lfh>;
+            close $lfh;
+        }
+        return (defined $log
+                && $log =~ /Connected to remote bench-receiver/);
+             });
+
+    my @files;
+    opendir my $dh, $staged_dir
+        or die "$0: Unable to read '$staged_dir': $!\n";
+    @files = grep { !/^\./ } readdir $dh;
+    closedir $dh;
+    for my $f (@files) {
+        link("$staged_dir/$f", "$dir/in/$f")
+            or die "$0: Unable to link '$f' into '$dir/in': $!\n";
+    }
+
+    # start the clock when the rwsender takes the first file
+    wait_for($name, $wait_start, sub {
+        for my $f (@files) {
+            return 1 unless -e "$dir/in/$f";
+        }
+        return 0;
+             }, 0.001);
+    my $start = [gettimeofday];
+
+    # the receiver creates an empty placeholder for each file and
+    # renames the complete file over it
+    my %done;
+    wait_for($name, $start, sub {
+        for my $f (@files) {
+            next if $done{$f};
+            my $size = -s "$dir/dest/$f";
+            return 0 unless defined $size && $size == $FILE_SIZE;
+            $done{$f} = 1;
+        }
+        return 1;
+             });
+    my $elapsed = tv_interval($start);
+
+    stop_daemons();
+    rmtree($dir);
+    return $elapsed;
+}
+
+
+#  wait_for($name, $start, $done_fn, $interval);
+#
+#    Call $done_fn every $interval seconds (default 0.01) until it
+#    returns true.  Exit with an error if the daemons started by
+#    start_daemon() exit or if $TIMEOUT seconds pass after the time
+#    $start.  $name is the scenario for error messages.
+#
+sub wait_for
+{
+    my ($name, $start, $done_fn, $interval) = @_;
+
+    $interval = 0.01 unless defined $interval;
+    until ($done_fn->()) {
+        if (tv_interval($start) > $TIMEOUT) {
+            stop_daemons();
+            die "$0: Scenario $name did not finish in $TIMEOUT seconds\n";
+        }
+        for my $pid (@daemons) {
+            if (waitpid($pid, WNOHANG) == $pid) {
+                @daemons = grep { $_ != $pid } @daemons;
+                stop_daemons();
+                die "$0: Scenario $name: a daemon exited early\n";
+            }
+        }
+        sleep $interval;
+    }
+}
+
+
+#  start_daemon($command);
+#
+#    Run $command in the background and remember its process ID.
+#
+sub start_daemon
+{
+    my ($cmd) = @_;
+
+    my $pid = fork;
+    die "$0: Unable to fork: $!\n" unless defined $pid;
+    if (0 == $pid) {
+        exec $cmd
+            or die "$0: Unable to run '$cmd': $!\n";
+    }
+    push @daemons, $pid;
+}
+
+
+#  stop_daemons();
+#
+#    Stop the daemons started by start_daemon() and wait for them.
+#
+sub stop_daemons
+{
+    kill 'TERM', @daemons;
+    for my $pid (@daemons) {
+        waitpid($pid, 0);
+    }
+    @daemons = ();
+}
+
+
+sub process_options
+{
+    my $help;
+
+    GetOptions('help|?'       => \$help,
+               'bindir=s'     => \$BINDIR,
+               'output=s'     => \$OUTPUT,
+               'repeat=i'     => \$REPEAT,
+               'file-count=i' => \$FILE_COUNT,
+               'file-size=i'  => \$FILE_SIZE,
+               'name-filter=s' => \$FILTER,
+        ) or usage(1);
+
+    usage(0) if $help;
+
+    if ($REPEAT < 1) {
+        die "$0: The --repeat value must be positive\n";
+    }
+    if ($FILE_COUNT < 1) {
+        die "$0: The --file-count value must be positive\n";
+    }
+    if ($FILE_SIZE < 1) {
+        die "$0: The --file-size value must be positive\n";
+    }
+}
+
+
+sub usage
+{
+    my ($exit_val) = @_;
+
+    my $usage = <<EOF_USAGE;
+Usage: $0 [SWITCHES]
+
+Time the transfer of files from rwsender to rwreceiver over the
+loopback interface and write the results as JSON.
+
+SWITCHES:
+--bindir=DIR  Find rwsender and rwreceiver in the sendrcv subdirectory
+              of DIR, as in the build tree. Def. $BINDIR
+--output=FILE Write the JSON to FILE. Def. stdout
+--repeat=NUM  Run each scenario NUM times and report the fastest run.
+              Def. $REPEAT
+--file-count=NUM  Transfer NUM files in each run. Def. $FILE_COUNT
+--file-size=NUM   Make each file NUM bytes long. Def. $FILE_SIZE
+--name-filter=STRING  Only run the scenarios whose names contain STRING
+--help        Print this usage output and exit
+EOF_USAGE
+
+    if ($exit_val) {
+        print STDERR $usage;
+    }
+    else {
+        print $usage;
+    }
+
+    exit $exit_val;
+}
+
+__END__
+
+#######################################################################
+# Copyright (C) 2015 by Carnegie Mellon University.
+#
+# @OPENSOURCE_HEADER_START@
+#
+# Use of the SILK system and related source code is subject to the terms
+# of the following licenses:
+#
+# GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+# Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+#
+# NO WARRANTY
+#
+# ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+# PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+# PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+# "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+# KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+# LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+# MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+# OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+# SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+# TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+# WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+# LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+# CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+# CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+# DELIVERABLES UNDER THIS LICENSE.
+#
+# Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+# Mellon University, its trustees, officers, employees, and agents from
+# all claims or demands made against them (and any related losses,
+# expenses, or attorney's fees) arising out of, or relating to Licensee's
+# and/or its sub licensees' negligent use or willful misuse of or
+# negligent conduct or willful misconduct regarding the Software,
+# facilities, or other rights or assistance granted by Carnegie Mellon
+# University under this License, including, but not limited to, any
+# claims of product liability, personal injury, death, damage to
+# property, or violation of any laws or regulations.
+#
+# Carnegie Mellon University Software Engineering Institute authored
+# documents are sponsored by the U.S. Department of Defense under
+# Contract FA8721-05-C-0003. Carnegie Mellon University retains
+# copyrights in all material produced under this contract. The U.S.
+# Government retains a non-exclusive, royalty-free license to publish or
+# reproduce these documents, or allow others to do so, for U.S.
+# Government purposes only pursuant to the copyright license under the
+# contract clause at 252.227.7013.
+#
+# @OPENSOURCE_HEADER_END@
+#######################################################################
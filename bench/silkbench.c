@@ -0,0 +1,1231 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  silkbench.c
+**
+**    Micro-benchmarks of the libsilk functions that dominate the run
+**    time of the SiLK tools.  The records to use are read from the
+**    file given to --data, which "make bench" creates with
+**    rwrecgenerator so that every run uses the same records.
+**
+**    Each benchmark is run --repeat times and the fastest run is
+**    reported.  The results are written as JSON to the --output file
+**    for comparison with bench-compare.pl.
+*/
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: silkbench.c $");
+
+#include <silk/hashlib.h>
+#include <silk/rwascii.h>
+#include <silk/rwrec.h>
+#include <silk/skbag.h>
+#include <silk/skipset.h>
+#include <silk/skprefixmap.h>
+#include <silk/sksite.h>
+#include <silk/skstream.h>
+#include <silk/utils.h>
+
+
+/* LOCAL DEFINES AND TYPEDEFS */
+
+/* where to write usage (--help) information */
+#define USAGE_FH stdout
+
+/* default number of times to run each benchmark */
+#define BENCH_REPEAT_DEFAULT  3
+
+/* default maximum number of records to read from the --data file */
+#define BENCH_MAX_RECORDS_DEFAULT  1000000
+
+/* number of ranges in the prefix map used by the pmap benchmark */
+#define BENCH_PMAP_RANGES  4096
+
+/* the timing of one benchmark */
+typedef struct bench_result_st {
+    char        name[128];
+    /* number of operations (records, addresses, ...) per run */
+    uint64_t    ops;
+    /* elapsed time of the fastest run */
+    double      seconds;
+    /* start time of the current run; set by benchStart() */
+    double      start;
+} bench_result_t;
+
+/* a benchmark function; it calls benchStart() and benchStop() around
+ * the work to be timed, and returns 0 on success */
+typedef int (*bench_fn_t)(bench_result_t *res, const void *arg);
+
+/* the file format and compression method for the stream benchmarks */
+typedef struct bench_stream_arg_st {
+    const char         *format_name;
+    fileFormat_t        format;
+    sk_compmethod_t     comp_method;
+} bench_stream_arg_t;
+
+/* key of the hashlib benchmarks; similar to the keys of rwuniq */
+typedef struct bench_hash_key_st {
+    uint32_t    sip;
+    uint32_t    dip;
+    uint16_t    sport;
+    uint16_t    dport;
+    uint8_t     proto;
+    uint8_t     pad[3];
+} bench_hash_key_t;
+
+
+/* LOCAL VARIABLE DEFINITIONS */
+
+/* the records to use */
+static rwRec *recs = NULL;
+static size_t rec_count = 0;
+
+/* where to write the results */
+static const char *output_path = "-";
+
+/* the file to read the records from */
+static const char *data_path = NULL;
+
+/* directory for the files the stream benchmarks create */
+static const char *scratch_dir = ".";
+
+/* the name of the file the stream benchmarks create */
+static char scratch_path[PATH_MAX];
+
+/* number of times to run each benchmark */
+static uint32_t repeat = BENCH_REPEAT_DEFAULT;
+
+/* maximum number of records to read */
+static uint64_t max_records = BENCH_MAX_RECORDS_DEFAULT;
+
+/* only run the benchmarks whose names contain this string */
+static const char *name_filter = NULL;
+
+/* the file formats used by the stream benchmarks.  the formats used
+ * by rwflowpack's hourly files store times relative to the hour in
+ * the file's header, so they cannot hold an arbitrary data set and
+ * are not included */
+static const struct bench_format_st {
+    const char         *name;
+    fileFormat_t        format;
+} bench_formats[] = {
+    {"generic",     FT_RWGENERIC},
+#if SK_ENABLE_IPV6
+    {"ipv6",        FT_RWIPV6},
+    {"ipv6routing", FT_RWIPV6ROUTING},
+#endif
+    {NULL,          0}
+};
+
+
+/* OPTIONS SETUP */
+
+typedef enum {
+    OPT_DATA, OPT_OUTPUT, OPT_REPEAT, OPT_MAX_RECORDS, OPT_SCRATCH_DIR,
+    OPT_NAME_FILTER
+} appOptionsEnum;
+
+static struct option appOptions[] = {
+    {"data",                REQUIRED_ARG, 0, OPT_DATA},
+    {"output",              REQUIRED_ARG, 0, OPT_OUTPUT},
+    {"repeat",              REQUIRED_ARG, 0, OPT_REPEAT},
+    {"max-records",         REQUIRED_ARG, 0, OPT_MAX_RECORDS},
+    {"scratch-dir",         REQUIRED_ARG, 0, OPT_SCRATCH_DIR},
+    {"name-filter",         REQUIRED_ARG, 0, OPT_NAME_FILTER},
+    {0,0,0,0}               /* sentinel entry */
+};
+
+static const char *appHelp[] = {
+    "Read the records to use from this SiLK Flow file. Req.",
+    "Write the JSON results to this file. Def. stdout",
+    ("Run each benchmark this many times and report the fastest\n"
+     "\trun. Def. 3"),
+    "Use at most this many records from the data file. Def. 1000000",
+    ("Create temporary files in this directory for the\n"
+     "\tstream benchmarks. Def. Current directory"),
+    ("Only run the benchmarks whose names contain this\n"
+     "\tstring. Def. Run all benchmarks"),
+    (char *)NULL
+};
+
+
+/* LOCAL FUNCTION PROTOTYPES */
+
+static int  appOptionsHandler(clientData cData, int opt_index, char *opt_arg);
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  appUsageLong();
+ *
+ *    Print complete usage information to USAGE_FH.  Pass this
+ *    function to skOptionsSetUsageCallback(); skOptionsParse() will
+ *    call this funciton and then exit the program when the --help
+ *    option is given.
+ */
+static void
+appUsageLong(
+    void)
+{
+#define USAGE_MSG                                                         \
+    ("--data=FILE [SWITCHES]\n"                                           \
+     "\tTime the libsilk functions that the SiLK tools use most using\n"  \
+     "\tthe records in FILE, and write the results as JSON.\n")
+
+    FILE *fh = USAGE_FH;
+
+    skAppStandardUsage(fh, USAGE_MSG, appOptions, appHelp);
+    sksiteOptionsUsage(fh);
+}
+
+
+/*
+ *  appTeardown()
+ *
+ *    Teardown all modules, close all files, and tidy up all
+ *    application state.
+ *
+ *    This function is idempotent.
+ */
+static void
+appTeardown(
+    void)
+{
+    static int teardownFlag = 0;
+
+    if (teardownFlag) {
+        return;
+    }
+    teardownFlag = 1;
+
+    if (scratch_path[0]) {
+        unlink(scratch_path);
+    }
+    free(recs);
+    recs = NULL;
+
+    skAppUnregister();
+}
+
+
+/*
+ *  appSetup(argc, argv);
+ *
+ *    Perform all the setup for this application include setting up
+ *    required modules, parsing options, etc.  This function should be
+ *    passed the same arguments that were passed into main().
+ *
+ *    Returns to the caller if all setup succeeds.  If anything fails,
+ *    this function will cause the application to exit with a FAILURE
+ *    exit status.
+ */
+static void
+appSetup(
+    int                 argc,
+    char              **argv)
+{
+    SILK_FEATURES_DEFINE_STRUCT(features);
+    int arg_index;
+
+    /* verify same number of options and help strings */
+    assert((sizeof(appHelp)/sizeof(char *)) ==
+           (sizeof(appOptions)/sizeof(struct option)));
+
+    /* register the application */
+    skAppRegister(argv[0]);
+    skAppVerifyFeatures(&features, NULL);
+    skOptionsSetUsageCallback(&appUsageLong);
+
+    /* register the options */
+    if (skOptionsRegister(appOptions, &appOptionsHandler, NULL)
+        || sksiteOptionsRegister(SK_SITE_FLAG_CONFIG_FILE))
+    {
+        skAppPrintErr("Unable to register options");
+        exit(EXIT_FAILURE);
+    }
+
+    /* register the teardown handler */
+    if (atexit(appTeardown) < 0) {
+        skAppPrintErr("Unable to register appTeardown() with atexit()");
+        appTeardown();
+        exit(EXIT_FAILURE);
+    }
+
+    /* parse options */
+    arg_index = skOptionsParse(argc, argv);
+    assert(arg_index <= argc);
+    if (arg_index < 0) {
+        skAppUsage();           /* never returns */
+    }
+    if (arg_index != argc) {
+        skAppPrintErr("Too many arguments or unrecognized switch '%s'",
+                      argv[arg_index]);
+        skAppUsage();           /* never returns */
+    }
+    if (NULL == data_path) {
+        skAppPrintErr("The --%s switch is required",
+                      appOptions[OPT_DATA].name);
+        skAppUsage();           /* never returns */
+    }
+
+    /* the stream benchmarks need the site configuration to write
+     * records that contain sensors and flowtypes */
+    sksiteConfigure(0);
+
+    snprintf(scratch_path, sizeof(scratch_path), "%s/silkbench-%ld.rwf",
+             scratch_dir, (long)getpid());
+
+    return;                       /* OK */
+}
+
+
+/*
+ *  status = appOptionsHandler(cData, opt_index, opt_arg);
+ *
+ *    Called by skOptionsParse(); handles a user-specified switch that
+ *    the application has registered, typically by setting global
+ *    variables.  Returns 1 if the switch processing failed or 0 if it
+ *    succeeded.
+ */
+static int
+appOptionsHandler(
+    clientData   UNUSED(cData),
+    int                 opt_index,
+    char               *opt_arg)
+{
+    int rv;
+
+    switch ((appOptionsEnum)opt_index) {
+      case OPT_DATA:
+        data_path = opt_arg;
+        break;
+
+      case OPT_OUTPUT:
+        output_path = opt_arg;
+        break;
+
+      case OPT_REPEAT:
+        rv = skStringParseUint32(&repeat, opt_arg, 1, 0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
+
+      case OPT_MAX_RECORDS:
+        rv = skStringParseUint64(&max_records, opt_arg, 1, 0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
+
+      case OPT_SCRATCH_DIR:
+        if (!skDirExists(opt_arg)) {
+            skAppPrintErr("Invalid %s: Directory '%s' does not exist",
+                          appOptions[opt_index].name, opt_arg);
+            return 1;
+        }
+        scratch_dir = opt_arg;
+        break;
+
+      case OPT_NAME_FILTER:
+        name_filter = opt_arg;
+        break;
+    }
+
+    return 0;                     /* OK */
+
+  PARSE_ERROR:
+    skAppPrintErr("Invalid %s '%s': %s",
+                  appOptions[opt_index].name, opt_arg,
+                  skStringParseStrerror(rv));
+    return 1;
+}
+
+
+/*
+ *  seconds = benchNow();
+ *
+ *    Return the current time as a number of seconds.
+ */
+static double
+benchNow(
+    void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1.0e6;
+}
+
+
+/*
+ *  benchStart(res);
+ *  benchStop(res, ops);
+ *
+ *    Mark the start and end of the timed portion of a benchmark run
+ *    that performed 'ops' operations.  benchStop() keeps the time of
+ *    the fastest run in 'res'.
+ */
+static void
+benchStart(
+    bench_result_t     *res)
+{
+    res->start = benchNow();
+}
+
+static void
+benchStop(
+    bench_result_t     *res,
+    uint64_t            ops)
+{
+    double elapsed = benchNow() - res->start;
+
+    if (0 == res->ops || elapsed < res->seconds) {
+        res->seconds = elapsed;
+    }
+    res->ops = ops;
+}
+
+
+/*
+ *  status = loadRecords();
+ *
+ *    Read up to 'max_records' records from 'data_path' into 'recs'.
+ */
+static int
+loadRecords(
+    void)
+{
+    skstream_t *stream = NULL;
+    size_t alloc;
+    rwRec *old_recs;
+    int rv;
+
+    alloc = 1 << 16;
+    recs = (rwRec*)malloc(alloc * sizeof(rwRec));
+    if (NULL == recs) {
+        skAppPrintOutOfMemory("records");
+        return -1;
+    }
+
+    rv = skStreamOpenSilkFlow(&stream, data_path, SK_IO_READ);
+    if (rv) {
+        skStreamPrintLastErr(stream, rv, &skAppPrintErr);
+        skStreamDestroy(&stream);
+        return -1;
+    }
+    skStreamSetIPv6Policy(stream, SK_IPV6POLICY_ASV4);
+
+    while (rec_count < max_records) {
+        if (rec_count == alloc) {
+            alloc *= 2;
+            old_recs = recs;
+            recs = (rwRec*)realloc(recs, alloc * sizeof(rwRec));
+            if (NULL == recs) {
+                recs = old_recs;
+                skAppPrintOutOfMemory("records");
+                skStreamDestroy(&stream);
+                return -1;
+            }
+        }
+        rv = skStreamReadRecord(stream, &recs[rec_count]);
+        if (rv) {
+            break;
+        }
+        ++rec_count;
+    }
+    if (rv && SKSTREAM_ERR_EOF != rv) {
+        skStreamPrintLastErr(stream, rv, &skAppPrintErr);
+        skStreamDestroy(&stream);
+        return -1;
+    }
+    skStreamDestroy(&stream);
+
+    if (0 == rec_count) {
+        skAppPrintErr("No records were read from '%s'", data_path);
+        return -1;
+    }
+    return 0;
+}
+
+
+/*
+ *  status = writeScratch(res, arg);
+ *
+ *    Write the records to the scratch file using the file format and
+ *    compression method in 'arg'.  When 'res' is not NULL, time the
+ *    writing of the records.
+ */
+static int
+writeScratch(
+    bench_result_t             *res,
+    const bench_stream_arg_t   *arg)
+{
+    skstream_t *stream = NULL;
+    sk_file_header_t *hdr;
+    size_t i;
+    int rv;
+
+    unlink(scratch_path);
+    if ((rv = skStreamCreate(&stream, SK_IO_WRITE, SK_CONTENT_SILK_FLOW))
+        || (rv = skStreamBind(stream, scratch_path)))
+    {
+        goto END;
+    }
+    hdr = skStreamGetSilkHeader(stream);
+    if ((rv = skHeaderSetFileFormat(hdr, arg->format))
+        || (rv = skHeaderSetCompressionMethod(hdr, arg->comp_method))
+        || (rv = skStreamOpen(stream))
+        || (rv = skStreamWriteSilkHeader(stream)))
+    {
+        goto END;
+    }
+
+    if (res) {
+        benchStart(res);
+    }
+    for (i = 0; i < rec_count; ++i) {
+        rv = skStreamWriteRecord(stream, &recs[i]);
+        if (rv) {
+            goto END;
+        }
+    }
+    rv = skStreamClose(stream);
+    if (res) {
+        benchStop(res, rec_count);
+    }
+
+  END:
+    if (rv) {
+        skStreamPrintLastErr(stream, rv, &skAppPrintErr);
+    }
+    skStreamDestroy(&stream);
+    return ((rv) ? -1 : 0);
+}
+
+
+/*
+ *  status = benchStreamWrite(res, arg);
+ *
+ *    Time skStreamWriteRecord() using the file format and compression
+ *    method in 'arg'.
+ */
+static int
+benchStreamWrite(
+    bench_result_t     *res,
+    const void         *arg)
+{
+    return writeScratch(res, (const bench_stream_arg_t *)arg);
+}
+
+
+/*
+ *  status = benchStreamRead(res, arg);
+ *
+ *    Time skStreamReadRecord() on a file written using the file
+ *    format and compression method in 'arg'.
+ */
+static int
+benchStreamRead(
+    bench_result_t     *res,
+    const void         *arg)
+{
+    skstream_t *stream = NULL;
+    rwRec rwrec;
+    uint64_t count = 0;
+    int rv;
+
+    if (writeScratch(NULL, (const bench_stream_arg_t *)arg)) {
+        return -1;
+    }
+
+    benchStart(res);
+    rv = skStreamOpenSilkFlow(&stream, scratch_path, SK_IO_READ);
+    if (rv) {
+        skStreamPrintLastErr(stream, rv, &skAppPrintErr);
+        skStreamDestroy(&stream);
+        return -1;
+    }
+    while ((rv = skStreamReadRecord(stream, &rwrec)) == SKSTREAM_OK) {
+        ++count;
+    }
+    benchStop(res, count);
+
+    if (SKSTREAM_ERR_EOF != rv) {
+        skStreamPrintLastErr(stream, rv, &skAppPrintErr);
+        skStreamDestroy(&stream);
+        return -1;
+    }
+    skStreamDestroy(&stream);
+    if (count != rec_count) {
+        skAppPrintErr("Read %" PRIu64 " of %" SK_PRIuZ " records",
+                      count, rec_count);
+        return -1;
+    }
+    return 0;
+}
+
+
+/*
+ *  hashKeyFromRec(&key, rwrec);
+ *
+ *    Fill 'key' with the five-tuple of 'rwrec'.
+ */
+static void
+hashKeyFromRec(
+    bench_hash_key_t   *key,
+    const rwRec        *rwrec)
+{
+    memset(key, 0, sizeof(*key));
+    key->sip = rwRecGetSIPv4(rwrec);
+    key->dip = rwRecGetDIPv4(rwrec);
+    key->sport = rwRecGetSPort(rwrec);
+    key->dport = rwRecGetDPort(rwrec);
+    key->proto = rwRecGetProto(rwrec);
+}
+
+
+/*
+ *  table = hashBuild(res);
+ *
+ *    Create a hash table and insert the five-tuple of every record,
+ *    timing the insertions when 'res' is not NULL.
+ */
+static HashTable *
+hashBuild(
+    bench_result_t     *res)
+{
+    bench_hash_key_t key;
+    HashTable *table;
+    uint8_t *value;
+    size_t i;
+    int rv;
+
+    table = hashlib_create_table(sizeof(bench_hash_key_t), sizeof(uint64_t),
+                                 HTT_INPLACE, NULL, NULL, 0,
+                                 256, DEFAULT_LOAD_FACTOR);
+    if (NULL == table) {
+        skAppPrintOutOfMemory("hash table");
+        return NULL;
+    }
+
+    if (res) {
+        benchStart(res);
+    }
+    for (i = 0; i < rec_count; ++i) {
+        hashKeyFromRec(&key, &recs[i]);
+        rv = hashlib_insert(table, (uint8_t*)&key, &value);
+        if (OK == rv) {
+            memset(value, 0, sizeof(uint64_t));
+        } else if (OK_DUPLICATE != rv) {
+            skAppPrintErr("Error inserting into hash table");
+            hashlib_free_table(table);
+            return NULL;
+        }
+        ++*(uint64_t*)value;
+    }
+    if (res) {
+        benchStop(res, rec_count);
+    }
+    return table;
+}
+
+
+/*
+ *  status = benchHashInsert(res, arg);
+ *
+ *    Time hashlib_insert() of the five-tuple of each record.
+ */
+static int
+benchHashInsert(
+    bench_result_t     *res,
+    const void  UNUSED(*arg))
+{
+    HashTable *table;
+
+    table = hashBuild(res);
+    if (NULL == table) {
+        return -1;
+    }
+    hashlib_free_table(table);
+    return 0;
+}
+
+
+/*
+ *  status = benchHashLookup(res, arg);
+ *
+ *    Time hashlib_lookup() of the five-tuple of each record, with the
+ *    source and destination swapped so that some lookups fail.
+ */
+static int
+benchHashLookup(
+    bench_result_t     *res,
+    const void  UNUSED(*arg))
+{
+    bench_hash_key_t key;
+    HashTable *table;
+    uint8_t *value;
+    uint64_t found = 0;
+    uint32_t tmp;
+    size_t i;
+
+    table = hashBuild(NULL);
+    if (NULL == table) {
+        return -1;
+    }
+
+    benchStart(res);
+    for (i = 0; i < rec_count; ++i) {
+        hashKeyFromRec(&key, &recs[i]);
+        if (i & 1) {
+            tmp = key.sip;
+            key.sip = key.dip;
+            key.dip = tmp;
+        }
+        if (OK == hashlib_lookup(table, (uint8_t*)&key, &value)) {
+            ++found;
+        }
+    }
+    benchStop(res, rec_count);
+
+    hashlib_free_table(table);
+    return ((found) ? 0 : -1);
+}
+
+
+/*
+ *  set = ipsetBuild(res, use_dip);
+ *
+ *    Create an IPset containing the source (or destination when
+ *    'use_dip' is true) address of every record, timing the
+ *    insertions when 'res' is not NULL.
+ */
+static skipset_t *
+ipsetBuild(
+    bench_result_t     *res,
+    int                 use_dip)
+{
+    skipset_t *ipset = NULL;
+    skipaddr_t addr;
+    size_t i;
+
+    if (skIPSetCreate(&ipset, 0)) {
+        skAppPrintOutOfMemory("IPset");
+        return NULL;
+    }
+
+    if (res) {
+        benchStart(res);
+    }
+    for (i = 0; i < rec_count; ++i) {
+        if (use_dip) {
+            rwRecMemGetDIP(&recs[i], &addr);
+        } else {
+            rwRecMemGetSIP(&recs[i], &addr);
+        }
+        if (skIPSetInsertAddress(ipset, &addr, 0)) {
+            skAppPrintErr("Error inserting into IPset");
+            skIPSetDestroy(&ipset);
+            return NULL;
+        }
+    }
+    skIPSetClean(ipset);
+    if (res) {
+        benchStop(res, rec_count);
+    }
+    return ipset;
+}
+
+
+/*
+ *  status = benchIPSetInsert(res, arg);
+ *
+ *    Time skIPSetInsertAddress() of the source address of each record
+ *    and the skIPSetClean() that follows.
+ */
+static int
+benchIPSetInsert(
+    bench_result_t     *res,
+    const void  UNUSED(*arg))
+{
+    skipset_t *ipset;
+
+    ipset = ipsetBuild(res, 0);
+    if (NULL == ipset) {
+        return -1;
+    }
+    skIPSetDestroy(&ipset);
+    return 0;
+}
+
+
+/*
+ *  status = benchIPSetCheck(res, arg);
+ *
+ *    Time skIPSetCheckAddress() of the destination address of each
+ *    record against an IPset of the source addresses.
+ */
+static int
+benchIPSetCheck(
+    bench_result_t     *res,
+    const void  UNUSED(*arg))
+{
+    skipset_t *ipset;
+    skipaddr_t addr;
+    uint64_t found = 0;
+    size_t i;
+
+    ipset = ipsetBuild(NULL, 0);
+    if (NULL == ipset) {
+        return -1;
+    }
+
+    benchStart(res);
+    for (i = 0; i < rec_count; ++i) {
+        rwRecMemGetDIP(&recs[i], &addr);
+        if (skIPSetCheckAddress(ipset, &addr)) {
+            ++found;
+        }
+    }
+    benchStop(res, rec_count);
+
+    skIPSetDestroy(&ipset);
+    return 0;
+}
+
+
+/*
+ *  status = benchIPSetUnion(res, arg);
+ *
+ *    Time skIPSetUnion() of the IPset of destination addresses into
+ *    the IPset of source addresses.  An operation is one union.
+ */
+static int
+benchIPSetUnion(
+    bench_result_t     *res,
+    const void  UNUSED(*arg))
+{
+    skipset_t *sip_set;
+    skipset_t *dip_set;
+    int rv;
+
+    sip_set = ipsetBuild(NULL, 0);
+    if (NULL == sip_set) {
+        return -1;
+    }
+    dip_set = ipsetBuild(NULL, 1);
+    if (NULL == dip_set) {
+        skIPSetDestroy(&sip_set);
+        return -1;
+    }
+
+    benchStart(res);
+    rv = skIPSetUnion(sip_set, dip_set);
+    skIPSetClean(sip_set);
+    benchStop(res, 1);
+
+    skIPSetDestroy(&sip_set);
+    skIPSetDestroy(&dip_set);
+    return ((rv) ? -1 : 0);
+}
+
+
+/*
+ *  status = benchBagAdd(res, arg);
+ *
+ *    Time skBagCounterAdd() of the bytes of each record to a bag
+ *    keyed by the source address.
+ */
+static int
+benchBagAdd(
+    bench_result_t     *res,
+    const void  UNUSED(*arg))
+{
+    skBag_t *bag = NULL;
+    skBagTypedKey_t key;
+    skBagTypedCounter_t counter;
+    size_t i;
+    int rv = -1;
+
+    if (skBagCreateTyped(&bag, SKBAG_FIELD_SIPv4, SKBAG_FIELD_SUM_BYTES,
+                         SKBAG_OCTETS_FIELD_DEFAULT,
+                         SKBAG_OCTETS_FIELD_DEFAULT))
+    {
+        skAppPrintOutOfMemory("bag");
+        return -1;
+    }
+    key.type = SKBAG_KEY_U32;
+    counter.type = SKBAG_COUNTER_U64;
+
+    benchStart(res);
+    for (i = 0; i < rec_count; ++i) {
+        key.val.u32 = rwRecGetSIPv4(&recs[i]);
+        counter.val.u64 = rwRecGetBytes(&recs[i]);
+        if (skBagCounterAdd(bag, &key, &counter, NULL)) {
+            skAppPrintErr("Error adding to bag");
+            goto END;
+        }
+    }
+    benchStop(res, rec_count);
+    rv = 0;
+
+  END:
+    skBagDestroy(&bag);
+    return rv;
+}
+
+
+/*
+ *  status = benchPrefixMapLookup(res, arg);
+ *
+ *    Time skPrefixMapFindValue() of the source and destination
+ *    addresses of each record in a prefix map of IPv4 addresses that
+ *    contains BENCH_PMAP_RANGES ranges of varying size.
+ */
+static int
+benchPrefixMapLookup(
+    bench_result_t     *res,
+    const void  UNUSED(*arg))
+{
+    skPrefixMap_t *map = NULL;
+    uint64_t low;
+    uint64_t high;
+    uint32_t low32;
+    uint32_t high32;
+    skipaddr_t low_ip;
+    skipaddr_t high_ip;
+    skipaddr_t ip;
+    uint32_t total = 0;
+    size_t i;
+    int rv = -1;
+
+    if (skPrefixMapCreate(&map)) {
+        skAppPrintOutOfMemory("prefix map");
+        return -1;
+    }
+    skPrefixMapSetContentType(map, SKPREFIXMAP_CONT_ADDR_V4);
+
+    /* split the address space into ranges whose sizes vary so the
+     * map's tree has a mix of depths */
+    low = 0;
+    for (i = 0; i < BENCH_PMAP_RANGES && low <= UINT32_MAX; ++i) {
+        high = low + (UINT64_C(1) << (12 + (i * 7) % 9)) * (1 + i % 3) - 1;
+        if (high > UINT32_MAX || i + 1 == BENCH_PMAP_RANGES) {
+            high = UINT32_MAX;
+        }
+        low32 = (uint32_t)low;
+        high32 = (uint32_t)high;
+        skipaddrSetV4(&low_ip, &low32);
+        skipaddrSetV4(&high_ip, &high32);
+        if (skPrefixMapAddRange(map, &low_ip, &high_ip, i % 256)) {
+            skAppPrintErr("Error adding to prefix map");
+            goto END;
+        }
+        low = high + 1;
+    }
+
+    benchStart(res);
+    for (i = 0; i < rec_count; ++i) {
+        rwRecMemGetSIP(&recs[i], &ip);
+        total += skPrefixMapFindValue(map, &ip);
+        rwRecMemGetDIP(&recs[i], &ip);
+        total += skPrefixMapFindValue(map, &ip);
+    }
+    benchStop(res, 2 * rec_count);
+    rv = ((total) ? 0 : -1);
+
+  END:
+    skPrefixMapDelete(map);
+    return rv;
+}
+
+
+/*
+ *  status = benchAsciiFormat(res, arg);
+ *
+ *    Time rwAsciiPrintRec() of each record with the default fields of
+ *    rwcut, writing to /dev/null.
+ */
+static int
+benchAsciiFormat(
+    bench_result_t     *res,
+    const void  UNUSED(*arg))
+{
+    const uint32_t fields[] = {
+        RWREC_FIELD_SIP, RWREC_FIELD_DIP, RWREC_FIELD_SPORT,
+        RWREC_FIELD_DPORT, RWREC_FIELD_PROTO, RWREC_FIELD_PKTS,
+        RWREC_FIELD_BYTES, RWREC_FIELD_FLAGS, RWREC_FIELD_STIME,
+        RWREC_FIELD_ELAPSED, RWREC_FIELD_ETIME, RWREC_FIELD_SID
+    };
+    rwAsciiStream_t *astream = NULL;
+    FILE *fp;
+    size_t i;
+    int rv = -1;
+
+    fp = fopen("/dev/null", "w");
+    if (NULL == fp) {
+        skAppPrintSyserror("Unable to open /dev/null");
+        return -1;
+    }
+    if (rwAsciiStreamCreate(&astream)
+        || rwAsciiAppendFields(astream, fields,
+                               sizeof(fields)/sizeof(fields[0])))
+    {
+        skAppPrintErr("Unable to create ASCII stream");
+        goto END;
+    }
+    rwAsciiSetOutputHandle(astream, fp);
+
+    benchStart(res);
+    for (i = 0; i < rec_count; ++i) {
+        rwAsciiPrintRec(astream, &recs[i]);
+    }
+    fflush(fp);
+    benchStop(res, rec_count);
+    rv = 0;
+
+  END:
+    rwAsciiStreamDestroy(&astream);
+    fclose(fp);
+    return rv;
+}
+
+
+/*
+ *  cmp = compareRecs(a, b);
+ *
+ *    Compare records by source address, source port, and start time,
+ *    as "rwsort --fields=sip,sport,stime" would.
+ */
+static int
+compareRecs(
+    const void         *va,
+    const void         *vb)
+{
+    const rwRec *a = (const rwRec *)va;
+    const rwRec *b = (const rwRec *)vb;
+
+    if (rwRecGetSIPv4(a) != rwRecGetSIPv4(b)) {
+        return ((rwRecGetSIPv4(a) < rwRecGetSIPv4(b)) ? -1 : 1);
+    }
+    if (rwRecGetSPort(a) != rwRecGetSPort(b)) {
+        return ((rwRecGetSPort(a) < rwRecGetSPort(b)) ? -1 : 1);
+    }
+    if (rwRecGetStartTime(a) != rwRecGetStartTime(b)) {
+        return ((rwRecGetStartTime(a) < rwRecGetStartTime(b)) ? -1 : 1);
+    }
+    return 0;
+}
+
+
+/*
+ *  status = benchQSort(res, arg);
+ *
+ *    Time skQSort() of a copy of the records.
+ */
+static int
+benchQSort(
+    bench_result_t     *res,
+    const void  UNUSED(*arg))
+{
+    rwRec *copy;
+
+    copy = (rwRec*)malloc(rec_count * sizeof(rwRec));
+    if (NULL == copy) {
+        skAppPrintOutOfMemory("records");
+        return -1;
+    }
+    memcpy(copy, recs, rec_count * sizeof(rwRec));
+
+    benchStart(res);
+    skQSort(copy, rec_count, sizeof(rwRec), &compareRecs);
+    benchStop(res, rec_count);
+
+    free(copy);
+    return 0;
+}
+
+
+/*
+ *  status = runBench(fp, &first, name, fn, arg);
+ *
+ *    Run the benchmark 'fn' with 'arg' 'repeat' times and write its
+ *    result to 'fp' as a JSON object.  'first' is true for the first
+ *    result written; it is cleared on return.  Do nothing when the
+ *    name does not match --name-filter.
+ */
+static int
+runBench(
+    FILE               *fp,
+    int                *first,
+    const char         *name,
+    bench_fn_t          fn,
+    const void         *arg)
+{
+    bench_result_t res;
+    uint32_t i;
+
+    if (name_filter && !strstr(name, name_filter)) {
+        return 0;
+    }
+
+    memset(&res, 0, sizeof(res));
+    snprintf(res.name, sizeof(res.name), "%s", name);
+    for (i = 0; i < repeat; ++i) {
+        if (fn(&res, arg)) {
+            skAppPrintErr("Benchmark %s failed", name);
+            return -1;
+        }
+    }
+
+    fprintf(fp, "%s\n    {\"name\": \"%s\", \"operations\": %" PRIu64
+            ", \"seconds\": %.6f, \"ops_per_sec\": %.1f}",
+            ((*first) ? "" : ","), res.name, res.ops, res.seconds,
+            ((res.seconds > 0.0) ? (double)res.ops / res.seconds : 0.0));
+    fflush(fp);
+    *first = 0;
+    return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    const struct bench_format_st *fmt;
+    bench_stream_arg_t stream_arg;
+    char comp_name[32];
+    char name[128];
+    FILE *fp;
+    int first = 1;
+    int rv = 0;
+    int c;
+
+    appSetup(argc, argv);
+
+    if (loadRecords()) {
+        exit(EXIT_FAILURE);
+    }
+
+    if (0 == strcmp(output_path, "-") || 0 == strcmp(output_path, "stdout")) {
+        fp = stdout;
+    } else {
+        fp = fopen(output_path, "w");
+        if (NULL == fp) {
+            skAppPrintSyserror("Unable to open output file '%s'", output_path);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    fprintf(fp, ("{\n  \"suite\": \"silkbench\",\n  \"version\": \"%s\",\n"
+                 "  \"records\": %" SK_PRIuZ ",\n  \"repeat\": %" PRIu32 ",\n"
+                 "  \"results\": ["),
+            SK_PACKAGE_VERSION, rec_count, repeat);
+
+    /* the stream benchmarks, for every combination of file format
+     * and available compression method */
+    for (fmt = bench_formats; fmt->name && !rv; ++fmt) {
+        for (c = 0; c < UINT8_MAX && !rv; ++c) {
+            if (sksiteCompmethodCheck(c) != SK_COMPMETHOD_IS_AVAIL) {
+                if (!(sksiteCompmethodCheck(c) & SK_COMPMETHOD_IS_VALID)) {
+                    break;
+                }
+                continue;
+            }
+            sksiteCompmethodGetName(comp_name, sizeof(comp_name), c);
+            stream_arg.format_name = fmt->name;
+            stream_arg.format = fmt->format;
+            stream_arg.comp_method = c;
+
+            snprintf(name, sizeof(name), "stream-write/%s/%s",
+                     fmt->name, comp_name);
+            rv = runBench(fp, &first, name, &benchStreamWrite, &stream_arg);
+            if (!rv) {
+                snprintf(name, sizeof(name), "stream-read/%s/%s",
+                         fmt->name, comp_name);
+                rv = runBench(fp, &first, name, &benchStreamRead, &stream_arg);
+            }
+        }
+    }
+
+    if (!rv) {
+        rv = (runBench(fp, &first, "hashlib-insert", &benchHashInsert, NULL)
+              || runBench(fp, &first, "hashlib-lookup", &benchHashLookup, NULL)
+              || runBench(fp, &first, "ipset-insert", &benchIPSetInsert, NULL)
+              || runBench(fp, &first, "ipset-check", &benchIPSetCheck, NULL)
+              || runBench(fp, &first, "ipset-union", &benchIPSetUnion, NULL)
+              || runBench(fp, &first, "bag-add", &benchBagAdd, NULL)
+              || runBench(fp, &first, "pmap-lookup",
+                          &benchPrefixMapLookup, NULL)
+              || runBench(fp, &first, "rwascii-format",
+                          &benchAsciiFormat, NULL)
+              || runBench(fp, &first, "qsort", &benchQSort, NULL));
+    }
+
+    fprintf(fp, "\n  ]\n}\n");
+    if (fp != stdout) {
+        fclose(fp);
+    }
+
+    return ((rv) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -57,6 +57,7 @@ RCSIDENT("$SiLK: flowcap.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 #include <silk/libflowsource.h>
 #include <silk/rwrec.h>
 #include <silk/skheader.h>
+#include <silk/sktelemetry.h>
 #include <silk/skthread.h>      /* MUTEX_LOCK,MUTEX_UNLOCK */
 #include <silk/sktimer.h>
 #if SK_ENABLE_IPFIX
@@ -86,6 +87,22 @@ RCSIDENT("$SiLK: flowcap.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 
 
 
+/* the stages of handling a record whose latency is reported in the
+ * telemetry file.  'receive' is from the arrival of the packet that
+ * held the record until the record is decoded; 'read' is the time
+ * spent waiting for and decoding the record; 'write' is the time
+ * spent writing the record to the output file. */
+typedef enum fc_stage_en {
+    STAGE_RECEIVE, STAGE_READ, STAGE_WRITE
+} fc_stage_t;
+
+#define FC_STAGE_COUNT  3
+
+static const char *fc_stage_names[FC_STAGE_COUNT] = {
+    "receive", "read", "write"
+};
+
+
 /* the reason a file was closed; passed to closeFile() */
 typedef enum close_reason_en {
     FC_TIMED_OUT,
@@ -134,6 +151,19 @@ typedef struct flowcap_reader_st {
     /* number of records written to current file */
     uint32_t            records;
 
+    /* counts for the telemetry file: the number of records written,
+     * the number of files opened, the number of files closed and
+     * handed to the sender, and the number of empty files removed.
+     * Protected by 'mutex'. */
+    uint64_t            records_total;
+    uint64_t            files_opened;
+    uint64_t            files_closed;
+    uint64_t            files_removed;
+
+    /* time spent in each fc_stage_t; NULL unless --telemetry-file
+     * was given */
+    sk_telemetry_latency_t *latency;
+
     /* whether this file is due to be closed. */
     unsigned            close       : 1;
 
@@ -178,6 +208,11 @@ uint8_t flowcap_version = FC_VERSION_DEFAULT;
 /* The list of probes we care about */
 sk_vector_t *probe_vec = NULL;
 
+/* File to which performance metrics are written every
+ * 'telemetry_interval' seconds; NULL if none */
+const char *telemetry_path = NULL;
+uint32_t telemetry_interval = DEFAULT_TELEMETRY_INTERVAL;
+
 #ifdef SK_HAVE_STATVFS
 /* leave at least this much free space on the disk; specified by
  * --freespace-minimum.  Gets set to DEFAULT_FREESPACE_MINIMUM */
@@ -208,6 +243,9 @@ static pthread_t main_thread;
 static flowcap_reader_t *fc_readers;
 static size_t num_fc_readers;
 
+/* The object that writes the telemetry file */
+static sk_telemetry_t *telemetry = NULL;
+
 
 /* LOCAL FUNCTION PROTOTYPES */
 
@@ -228,6 +266,7 @@ closeFileBase(
     close_reason_t      reason);
 static int  startReaders(void);
 static void stopReaders(void);
+static int  startTelemetry(void);
 
 #ifdef SK_HAVE_STATVFS
 static int checkDiskSpace(void);
@@ -277,6 +316,13 @@ appTeardown(
     shutting_down = 1;
 
     stopReaders();
+
+    /* write the final metrics while the sources still exist */
+    if (telemetry) {
+        skTelemetryWrite(telemetry);
+        skTelemetryDestroy(&telemetry);
+    }
+
     freeReaders();
 
     skpcTeardown();
@@ -398,6 +444,9 @@ freeReaders(
 
     NOTICEMSG("Destroyed all sources.");
 
+    for (i = 0, reader = fc_readers; i < num_fc_readers; ++i, ++reader) {
+        skTelemetryLatencyDestroy(&reader->latency);
+    }
     free(fc_readers);
     fc_readers = NULL;
 }
@@ -587,6 +636,7 @@ openFileBase(
     reader->records    = 0;
     reader->closing    = 0;
     reader->close      = 0;
+    ++reader->files_opened;
 
     /* set the timer to write_timeout */
     if (NULL == reader->timer) {
@@ -739,6 +789,7 @@ closeFileBase(
 
         INFOMSG(("Removed empty file '%s': %" PRId64 " seconds"),
                 reader->filename, (int64_t)(end_time - reader->start_time));
+        ++reader->files_removed;
 
         if (reader->valid_source) {
             switch (skpcProbeGetType(reader->probe)) {
@@ -832,6 +883,7 @@ closeFileBase(
     }
 
     INFOMSG("Finished closing '%s'", reader->filename);
+    ++reader->files_closed;
     reader->filename = NULL;
     return 0;
 }
@@ -926,6 +978,7 @@ readerWriteRecord(
         exit(EXIT_FAILURE);
     }
     ++reader->records;
+    ++reader->records_total;
 
     /* Check to see if we have reached the size limit */
     if (skStreamGetUpperBound(reader->ios) < max_file_size) {
@@ -959,6 +1012,9 @@ readerMainPDU(
 {
     flowcap_reader_t *reader = (flowcap_reader_t*)vreader;
     rwRec rec;
+    uint64_t t_start = 0;
+    uint64_t t_end;
+    uint64_t arrival;
 
     assert(reader);
     assert(reader->probe);
@@ -967,10 +1023,31 @@ readerMainPDU(
     INFOMSG("'%s': Reader thread started.", reader->probename);
 
     /* Continue as long as there is data to be read */
+    if (reader->latency) {
+        t_start = skTelemetryNow();
+    }
     while (reading
            && (skPDUSourceGetGeneric(reader->source.pdu, &rec) == 0))
     {
-        readerWriteRecord(reader, &rec);
+        if (reader->latency) {
+            t_end = skTelemetryNow();
+            skTelemetryLatencyAdd(reader->latency, STAGE_READ,
+                                  t_start, t_end);
+            arrival = skPDUSourceGetArrivalTime(reader->source.pdu);
+            if (arrival) {
+                skTelemetryLatencyAdd(reader->latency, STAGE_RECEIVE,
+                                      arrival, t_end);
+            }
+            readerWriteRecord(reader, &rec);
+            t_start = skTelemetryNow();
+            skTelemetryLatencyAdd(reader->latency, STAGE_WRITE,
+                                  t_end, t_start);
+        } else {
+            readerWriteRecord(reader, &rec);
+        }
+    }
+    if (reader->latency) {
+        skTelemetryLatencyFlush(reader->latency);
     }
 
     INFOMSG("'%s': Reader thread ended.", reader->probename);
@@ -987,6 +1064,8 @@ readerMainIPFIX(
 {
     flowcap_reader_t *reader = (flowcap_reader_t*)vreader;
     rwRec rec;
+    uint64_t t_start = 0;
+    uint64_t t_end;
 
     assert(reader);
     assert(reader->probe);
@@ -997,10 +1076,26 @@ readerMainIPFIX(
     INFOMSG("'%s': Reader thread started.", reader->probename);
 
     /* Continue as long as there is data to be read */
+    if (reader->latency) {
+        t_start = skTelemetryNow();
+    }
     while (reading
            && (skIPFIXSourceGetGeneric(reader->source.ipfix, &rec) == 0))
     {
-        readerWriteRecord(reader, &rec);
+        if (reader->latency) {
+            t_end = skTelemetryNow();
+            skTelemetryLatencyAdd(reader->latency, STAGE_READ,
+                                  t_start, t_end);
+            readerWriteRecord(reader, &rec);
+            t_start = skTelemetryNow();
+            skTelemetryLatencyAdd(reader->latency, STAGE_WRITE,
+                                  t_end, t_start);
+        } else {
+            readerWriteRecord(reader, &rec);
+        }
+    }
+    if (reader->latency) {
+        skTelemetryLatencyFlush(reader->latency);
     }
 
     INFOMSG("'%s': Reader thread ended.", reader->probename);
@@ -1046,6 +1141,13 @@ startReaders(
         /* Initialize mutex */
         pthread_mutex_init(&reader->mutex, NULL);
 
+        if (telemetry_path
+            && skTelemetryLatencyCreate(&reader->latency, FC_STAGE_COUNT))
+        {
+            skAppPrintOutOfMemory("latency recorder");
+            return 1;
+        }
+
         /* Create the first file */
         MUTEX_LOCK(&reader->mutex);
         if (openFileBase(reader)) {
@@ -1177,6 +1279,152 @@ stopReaders(
 }
 
 
+/*
+ *  telemetryReport(telemetry, NULL);
+ *
+ *    Report the metrics for each reader and its flow-source.  Invoked
+ *    by skTelemetryWrite() on the telemetry timer's thread.
+ */
+static void
+telemetryReport(
+    sk_telemetry_t     *tel,
+    void        UNUSED(*dummy))
+{
+    skFlowSourceTelemetry_t src;
+    sk_telemetry_hist_t hist;
+    flowcap_reader_t *reader;
+    uint64_t records_total;
+    uint64_t files_opened;
+    uint64_t files_closed;
+    uint64_t files_removed;
+    size_t i;
+    size_t s;
+
+    for (i = 0, reader = fc_readers; i < num_fc_readers; ++i, ++reader) {
+        MUTEX_LOCK(&reader->mutex);
+        records_total = reader->records_total;
+        files_opened = reader->files_opened;
+        files_closed = reader->files_closed;
+        files_removed = reader->files_removed;
+        MUTEX_UNLOCK(&reader->mutex);
+
+        skTelemetryAddCounter(tel, "records_total",
+                              "Records written to the output files",
+                              records_total, "probe", reader->probename, NULL);
+        skTelemetryAddCounter(tel, "files_opened_total",
+                              "Output files opened",
+                              files_opened, "probe", reader->probename, NULL);
+        skTelemetryAddCounter(tel, "files_closed_total",
+                              "Output files closed and made available to"
+                              " the sender",
+                              files_closed, "probe", reader->probename, NULL);
+        skTelemetryAddCounter(tel, "files_removed_total",
+                              "Empty output files removed",
+                              files_removed, "probe", reader->probename, NULL);
+
+        memset(&src, 0, sizeof(src));
+        if (!reader->valid_source) {
+            /* no source */
+        } else if (PROBE_ENUM_NETFLOW_V5 == skpcProbeGetType(reader->probe)) {
+            skPDUSourceGetTelemetry(reader->source.pdu, &src);
+        } else {
+#if SK_ENABLE_IPFIX
+            skIPFIXSourceGetTelemetry(reader->source.ipfix, &src);
+#endif
+        }
+        skTelemetryAddCounter(tel, "source_packets_total",
+                              "Packets received by the flow source",
+                              src.stats.procPkts,
+                              "probe", reader->probename, NULL);
+        skTelemetryAddCounter(tel, "source_bad_packets_total",
+                              "Packets rejected by the flow source",
+                              src.stats.badPkts,
+                              "probe", reader->probename, NULL);
+        skTelemetryAddCounter(tel, "source_bytes_total",
+                              "Octets in the packets received by the"
+                              " flow source",
+                              src.procBytes, "probe", reader->probename, NULL);
+        skTelemetryAddCounter(tel, "source_records_total",
+                              "Records decoded by the flow source",
+                              src.stats.goodRecs,
+                              "probe", reader->probename, NULL);
+        skTelemetryAddCounter(tel, "source_bad_records_total",
+                              "Records rejected by the flow source",
+                              src.stats.badRecs,
+                              "probe", reader->probename, NULL);
+        skTelemetryAddGauge(tel, "source_missing_records",
+                            "Records missing according to the"
+                            " sequence numbers",
+                            (double)src.stats.missingRecs,
+                            "probe", reader->probename, NULL);
+        if (src.bufCapacity) {
+            skTelemetryAddGauge(tel, "source_buffer_packets",
+                                "Packets waiting in the source's buffer",
+                                (double)src.bufCount,
+                                "probe", reader->probename, NULL);
+            skTelemetryAddGauge(tel, "source_buffer_capacity_packets",
+                                "Packets the source's buffer holds",
+                                (double)src.bufCapacity,
+                                "probe", reader->probename, NULL);
+            skTelemetryAddCounter(tel, "source_buffer_full_waits_total",
+                                  "Times the collector waited on a"
+                                  " full buffer",
+                                  src.bufFullWaits,
+                                  "probe", reader->probename, NULL);
+            skTelemetryAddCounter(tel, "source_buffer_empty_waits_total",
+                                  "Times the reader waited on an"
+                                  " empty buffer",
+                                  src.bufEmptyWaits,
+                                  "probe", reader->probename, NULL);
+        }
+
+        if (reader->latency) {
+            for (s = 0; s < FC_STAGE_COUNT; ++s) {
+                skTelemetryLatencyGet(reader->latency, s, &hist);
+                if (STAGE_RECEIVE == s && 0 == hist.count) {
+                    continue;
+                }
+                skTelemetryAddHistogram(tel, "stage_latency_seconds",
+                                        "Time spent in each stage of"
+                                        " processing a record",
+                                        &hist, "probe", reader->probename,
+                                        "stage", fc_stage_names[s], NULL);
+            }
+        }
+    }
+}
+
+
+/*
+ *  status = startTelemetry();
+ *
+ *    Start the thread that writes the telemetry file when the
+ *    --telemetry-file switch was given.  Return 0 on success, or -1
+ *    on failure.
+ */
+static int
+startTelemetry(
+    void)
+{
+    if (NULL == telemetry_path) {
+        return 0;
+    }
+    if (skTelemetryCreate(&telemetry, telemetry_path, telemetry_interval,
+                          "flowcap", &telemetryReport, NULL))
+    {
+        CRITMSG("Unable to create the telemetry writer.");
+        return -1;
+    }
+    INFOMSG("Writing telemetry to '%s' every %" PRIu32 " seconds",
+            telemetry_path, telemetry_interval);
+    if (skTelemetryStart(telemetry)) {
+        CRITMSG("Unable to start telemetry timer.");
+        return -1;
+    }
+    return 0;
+}
+
+
 /* Program entry point. */
 int main(int argc, char **argv)
 {
@@ -1205,6 +1453,10 @@ int main(int argc, char **argv)
         exit(EXIT_FAILURE);
     }
 
+    if (startTelemetry()) {
+        exit(EXIT_FAILURE);
+    }
+
     /* We now run forever, excepting signals */
     while (!shutting_down) {
         pause();
@@ -107,6 +107,9 @@ RCSIDENTVAR(rcsID_FLOWCAP_H, "$SiLK: flowcap.h b7b8edebba12 2015-01-05 18:05:21Z
 /* maximum percentage of disk space to take */
 #define DEFAULT_SPACE_MAXIMUM_PERCENT  ((double)98.00)
 
+/* how often, in seconds, to rewrite the telemetry file */
+#define DEFAULT_TELEMETRY_INTERVAL  10
+
 
 /* Where to write files */
 extern const char *destination_dir;
@@ -133,6 +136,12 @@ extern uint64_t alloc_file_size;
 /* Probes the user wants to flowcap process */
 extern sk_vector_t *probe_vec;
 
+/* File to which performance metrics are written every
+ * 'telemetry_interval' seconds; NULL if none.  Set by
+ * --telemetry-file and --telemetry-interval. */
+extern const char *telemetry_path;
+extern uint32_t telemetry_interval;
+
 #ifdef SK_HAVE_STATVFS
 /* leave at least this much free space on the disk; specified by
  * --freespace-minimum */
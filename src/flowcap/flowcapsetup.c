@@ -76,6 +76,9 @@ static char *probe_list = NULL;
  * print names of probes that were parsed.  */
 static int verify_sensor_config = 0;
 
+/* Whether the --telemetry-interval switch was given */
+static int telemetry_interval_seen = 0;
+
 
 /* OPTIONS SETUP */
 
@@ -86,7 +89,8 @@ typedef enum {
 #ifdef SK_HAVE_STATVFS
     OPT_FREESPACE_MINIMUM, OPT_SPACE_MAXIMUM_PERCENT,
 #endif
-    OPT_PROBES, OPT_FC_VERSION
+    OPT_PROBES, OPT_FC_VERSION,
+    OPT_TELEMETRY_FILE, OPT_TELEMETRY_INTERVAL
 } appOptionsEnum;
 
 static struct option appOptions[] = {
@@ -102,6 +106,8 @@ static struct option appOptions[] = {
 #endif
     {"probes",                REQUIRED_ARG, 0, OPT_PROBES},
     {"fc-version",            REQUIRED_ARG, 0, OPT_FC_VERSION},
+    {"telemetry-file",        REQUIRED_ARG, 0, OPT_TELEMETRY_FILE},
+    {"telemetry-interval",    REQUIRED_ARG, 0, OPT_TELEMETRY_INTERVAL},
     {0,0,0,0}                 /* sentinel entry */
 };
 
@@ -129,6 +135,11 @@ static const char *appHelp[] = {
     ("Ignore all probes in the sensor-configuration file except\n"
      "\tfor these, a comma separated list of probe names. Def. Use all probes"),
     NULL, /* generate dynamically */
+    ("Periodically write performance metrics for the\n"
+     "\tsources, record processing stages, and output files to this file\n"
+     "\tin the Prometheus text format. Def. No metrics"),
+    ("Time (in seconds) between updates of the\n"
+     "\ttelemetry file. Requires --telemetry-file. Def. "),
     (char *)NULL
 };
 
@@ -185,6 +196,9 @@ appUsageLong(
                     DEFAULT_SPACE_MAXIMUM_PERCENT);
             break;
 #endif
+          case OPT_TELEMETRY_INTERVAL:
+            fprintf(fh, "%s%d", appHelp[i], DEFAULT_TELEMETRY_INTERVAL);
+            break;
           default:
             fprintf(fh, "%s", appHelp[i]);
             break;
@@ -294,6 +308,24 @@ appOptionsHandler(
         flowcap_version = tmp_32;
         break;
 
+      case OPT_TELEMETRY_FILE:
+        if ('\0' == opt_arg[0]) {
+            skAppPrintErr("Invalid %s: Empty string",
+                          appOptions[opt_index].name);
+            return 1;
+        }
+        telemetry_path = opt_arg;
+        break;
+
+      case OPT_TELEMETRY_INTERVAL:
+        rv = skStringParseUint32(&tmp_32, opt_arg, 1, 0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        telemetry_interval = tmp_32;
+        telemetry_interval_seen = 1;
+        break;
+
       case OPT_DESTINATION_DIR:
         if (skOptionsCheckDirectory(opt_arg, appOptions[opt_index].name)) {
             return 1;
@@ -508,6 +540,14 @@ validateOptions(
         ++error;
     }
 
+    /* --telemetry-interval requires --telemetry-file */
+    if (telemetry_interval_seen && NULL == telemetry_path) {
+        skAppPrintErr("The --%s switch is required when using --%s",
+                      appOptions[OPT_TELEMETRY_FILE].name,
+                      appOptions[OPT_TELEMETRY_INTERVAL].name);
+        ++error;
+    }
+
     /* verify the required options for logging */
     if (skdaemonOptionsVerify()) {
         ++error;
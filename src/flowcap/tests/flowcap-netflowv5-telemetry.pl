@@ -0,0 +1,146 @@
+#! /usr/bin/perl -w
+#
+#
+# RCSIDENT("$SiLK: flowcap-netflowv5-telemetry.pl $")
+
+use strict;
+use SiLKTests;
+
+my $NAME = $0;
+$NAME =~ s,.*/,,;
+
+# find the apps we need.  this will exit 77 if they're not available
+my $rwcat = check_silk_app('rwcat');
+my $rwsort = check_silk_app('rwsort');
+
+# find the data files we use as sources, or exit 77
+my %file;
+$file{data} = get_data_or_exit77('data');
+
+# prefix any existing PYTHONPATH with the proper directories
+check_python_bin();
+
+# create our tempdir
+my $tmpdir = make_tempdir();
+
+# send data to this port and host
+my $host = '127.0.0.1';
+my $port = get_ephemeral_port($host, 'udp');
+
+# create the sensor.conf
+my $sensor_conf = "$tmpdir/sensor.conf";
+my $sensor_conf_text = <<EOF;
+probe P0 netflow-v5
+    protocol udp
+    listen-on-port $port
+    listen-as-host $host
+end probe
+EOF
+make_config_file($sensor_conf, \$sensor_conf_text);
+
+# the command that wraps flowcap
+# the file of performance metrics
+my $telemetry = "$tmpdir/flowcap.prom";
+
+my $cmd = join " ", ("$SiLKTests::PYTHON $srcdir/tests/flowcap-daemon.py",
+                     ($ENV{SK_TESTS_VERBOSE} ? "--verbose" : ()),
+                     ($ENV{SK_TESTS_LOG_DEBUG} ? "--log-level=debug" : ()),
+                     "--pdu 40000,$host,$port",
+                     "--limit=40000",
+                     "--basedir=$tmpdir",
+                     "--daemon-timeout=120",
+                     "--",
+                     "--sensor-conf=$sensor_conf",
+                     "--max-file-size=100k",
+                     "--clock-time=2",
+                     "--telemetry-file=$telemetry",
+                     "--telemetry-interval=1",
+    );
+
+# run it and check the MD5 hash of its output
+check_md5_output('f6e9b35dc226f9975c8c14d9ab332bd7', $cmd);
+
+# path to the directory holding the output files
+my $data_dir = "$tmpdir/destination";
+die "$NAME: ERROR: Missing data directory '$data_dir'\n"
+    unless -d $data_dir;
+
+# check for zero length files in the directory
+opendir D, "$data_dir"
+    or die "$NAME: ERROR: Unable to open directory $data_dir: $!\n";
+for my $f (readdir D) {
+    next if (-d "$data_dir/$f") || (0 < -s _);
+    warn "$NAME: WARNING: Zero length files in $data_dir\n";
+    last;
+}
+closedir D;
+
+# create a command to sort all files in the directory and output them
+# in a standard form.
+$cmd = ("find $data_dir -type f -print "
+        ." | $rwcat --xargs "
+        ." | $rwsort --fields=stime,sip "
+        ." | $rwcat --byte-order=little --compression-method=none"
+        ." --ipv4-output");
+
+check_md5_output('4ac59f73c7d70e777982e9907952c9a3', $cmd);
+
+# read the metrics, making certain every metric has a type
+my %value;
+my %type;
+open F, $telemetry
+    or die "$NAME: ERROR: Cannot open $telemetry: $!\n";
+while (my $line = <F>) {
+    chomp $line;
+    if ($line =~ /^# TYPE (\S+) (counter|gauge|histogram)$/) {
+        $type{$1} = $2;
+    }
+    elsif ($line =~ /^#/) {
+        next;
+    }
+    elsif ($line =~ /^(flowcap_\w+)(\{[^}]*\})? (\S+)$/) {
+        my ($name, $labels, $val) = ($1, ($2 || '{}'), $3);
+        (my $family = $name) =~ s/_(bucket|sum|count)$//;
+        die "$NAME: ERROR: Metric $name has no TYPE\n"
+            unless $type{$name} || $type{$family};
+        $value{$name.$labels} = $val;
+    }
+    else {
+        die "$NAME: ERROR: Unexpected line in telemetry file: '$line'\n";
+    }
+}
+close F;
+
+# the metrics are written before the final file is closed
+my $probe = '{probe="P0"}';
+my $recs = $value{"flowcap_records_total$probe"};
+die "$NAME: ERROR: Wrote ".($recs // 'no')." records; source decoded "
+    .($value{"flowcap_source_records_total$probe"} // 'none')."\n"
+    unless $recs && $recs == $value{"flowcap_source_records_total$probe"};
+for my $k (qw(source_bad_packets_total source_bad_records_total)) {
+    die "$NAME: ERROR: Metric $k is not 0\n"
+        unless defined $value{"flowcap_$k$probe"}
+        && 0 == $value{"flowcap_$k$probe"};
+}
+# each packet is a 24-byte header and a 48-byte entry per record
+my $bytes = (24 * $value{"flowcap_source_packets_total$probe"} + 48 * $recs);
+die "$NAME: ERROR: Received ".$value{"flowcap_source_bytes_total$probe"}
+    ." bytes; expected $bytes\n"
+    unless $value{"flowcap_source_bytes_total$probe"} == $bytes;
+die "$NAME: ERROR: Missing buffer capacity\n"
+    unless $value{"flowcap_source_buffer_capacity_packets$probe"};
+die "$NAME: ERROR: Opened fewer files than were closed\n"
+    unless ($value{"flowcap_files_opened_total$probe"}
+            > ($value{"flowcap_files_closed_total$probe"}
+               + $value{"flowcap_files_removed_total$probe"}));
+
+# records arriving over the network are timed in every stage
+for my $stage (qw(receive read write)) {
+    my $k = "flowcap_stage_latency_seconds_count"
+        .qq({probe="P0",stage="$stage"});
+    die "$NAME: ERROR: Stage $stage has ".($value{$k} // 'no')." records;"
+        ." expected $recs\n"
+        unless defined $value{$k} && $value{$k} == $recs;
+}
+
+exit 0;
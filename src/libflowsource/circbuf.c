@@ -167,6 +167,10 @@ struct circBuf_st {
     pthread_cond_t   cond;
     /* Number of threads waiting on this buf */
     uint32_t         wait_count;
+    /* Number of calls to circBufNextHead() that found the buf full */
+    uint64_t         full_waits;
+    /* Number of calls to circBufNextTail() that found the buf empty */
+    uint64_t         empty_waits;
     /* True if the buf has been stopped */
     unsigned         destroyed : 1;
 };
@@ -256,6 +260,9 @@ circBufNextHead(
     ++buf->wait_count;
 
     /* Wait for an empty cell */
+    if (!buf->destroyed && (buf->cellcount == buf->maxcells)) {
+        ++buf->full_waits;
+    }
     while (!buf->destroyed && (buf->cellcount == buf->maxcells)) {
         TRACEMSG((("circBufNextHead() full, count is %" PRIu32),
                   buf->cellcount));
@@ -347,6 +354,9 @@ circBufNextTail(
     ++buf->wait_count;
 
     /* Wait for a full cell */
+    if (!buf->destroyed && (buf->cellcount <= 1)) {
+        ++buf->empty_waits;
+    }
     while (!buf->destroyed && (buf->cellcount <= 1)) {
         pthread_cond_wait(&buf->cond, &buf->mutex);
     }
@@ -408,6 +418,24 @@ circBufNextTail(
 }
 
 
+void
+circBufGetStats(
+    circBuf_t          *buf,
+    circBufStats_t     *stats)
+{
+    assert(buf);
+    assert(stats);
+
+    pthread_mutex_lock(&buf->mutex);
+    /* the cell held by the writer is included in the cellcount */
+    stats->items = ((buf->cellcount > 1) ? (buf->cellcount - 1) : 0);
+    stats->capacity = buf->maxcells;
+    stats->full_waits = buf->full_waits;
+    stats->empty_waits = buf->empty_waits;
+    pthread_mutex_unlock(&buf->mutex);
+}
+
+
 void
 circBufStop(
     circBuf_t          *buf)
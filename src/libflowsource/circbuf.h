@@ -80,6 +80,20 @@ RCSIDENTVAR(rcsID_CIRCBUF_H, "$SiLK: circbuf.h b7b8edebba12 2015-01-05 18:05:21Z
 struct circBuf_st;
 typedef struct circBuf_st circBuf_t;
 
+/*
+ *    Statistics about a circular buffer; filled by circBufGetStats().
+ */
+typedef struct circBufStats_st {
+    /* Number of items waiting to be read */
+    uint32_t    items;
+    /* Maximum number of items the buffer can hold */
+    uint32_t    capacity;
+    /* Number of times a writer waited because the buffer was full */
+    uint64_t    full_waits;
+    /* Number of times a reader waited because the buffer was empty */
+    uint64_t    empty_waits;
+} circBufStats_t;
+
 /*
  *    Creates a circular buffer which can contain at least up to
  *    item_count items of size item_size.  Returns NULL if not enough
@@ -91,6 +105,15 @@ circBufCreate(
     uint32_t            item_size,
     uint32_t            item_count);
 
+/*
+ *    Fills 'stats' with the current statistics for the circular
+ *    buffer 'buf'.
+ */
+void
+circBufGetStats(
+    circBuf_t          *buf,
+    circBufStats_t     *stats);
+
 /*
  *    Causes all threads waiting on a circular buffer to return.
  */
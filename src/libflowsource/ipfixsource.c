@@ -356,6 +356,10 @@ struct skIPFIXSource_st {
     uint64_t                reverse_flows;
     uint64_t                ignored_flows;
 
+    /* the statistics above that have been cleared, mapped onto an
+     * skFlowSourceStats_t by source_get_stats(); for telemetry */
+    skFlowSourceStats_t     totals;
+
     /* mutex to protect access to the above statistics */
     pthread_mutex_t         stats_mutex;
 
@@ -2321,6 +2325,27 @@ skIPFIXSourceGetRecord(
 }
 
 
+/*
+ *  source_get_stats(source, stats);
+ *
+ *    Fill 'stats' with the current statistics for 'source'.  Packets
+ *    are those yaf reports; for NetFlowV9 and sFlow, the missing
+ *    records are the packets that libfixbuf reports as missed.  The
+ *    caller must hold the stats_mutex.
+ */
+static void
+source_get_stats(
+    const skIPFIXSource_t  *source,
+    skFlowSourceStats_t    *stats)
+{
+    stats->procPkts = source->yaf_processed_packets;
+    stats->badPkts = source->yaf_ignored_packets;
+    stats->goodRecs = source->forward_flows + source->reverse_flows;
+    stats->badRecs = source->ignored_flows;
+    stats->missingRecs = (int64_t)source->yaf_dropped_packets;
+}
+
+
 /* Constants used to create source_do_stats()'s flags argument */
 #define SOURCE_DO_STATS_LOG     0x01
 #define SOURCE_DO_STATS_CLEAR   0x02
@@ -2456,6 +2481,11 @@ source_do_stats(
     /* reset (set to zero) statistics on the skIPFIXSource_t
      * 'source' */
     if (flags & SOURCE_DO_STATS_CLEAR) {
+        skFlowSourceStats_t stats;
+
+        source_get_stats(source, &stats);
+        FLOWSOURCE_STATS_ADD(&source->totals, &stats);
+
         source->yaf_dropped_packets = 0;
         source->yaf_ignored_packets = 0;
         source->yaf_notsent_packets = 0;
@@ -2497,6 +2527,30 @@ skIPFIXSourceClearStats(
     source_do_stats(source, SOURCE_DO_STATS_CLEAR);
 }
 
+/* Get the cumulative statistics and buffer state of an IPFIX
+ * source */
+void
+skIPFIXSourceGetTelemetry(
+    skIPFIXSource_t            *source,
+    skFlowSourceTelemetry_t    *telemetry)
+{
+    circBufStats_t buf_stats;
+
+    memset(telemetry, 0, sizeof(*telemetry));
+    pthread_mutex_lock(&source->stats_mutex);
+    source_get_stats(source, &telemetry->stats);
+    FLOWSOURCE_STATS_ADD(&telemetry->stats, &source->totals);
+    pthread_mutex_unlock(&source->stats_mutex);
+
+    if (source->data_buffer) {
+        circBufGetStats(source->data_buffer, &buf_stats);
+        telemetry->bufCount = buf_stats.items;
+        telemetry->bufCapacity = buf_stats.capacity;
+        telemetry->bufFullWaits = buf_stats.full_waits;
+        telemetry->bufEmptyWaits = buf_stats.empty_waits;
+    }
+}
+
 /*
 ** Local Variables:
 ** mode:c
@@ -211,6 +211,43 @@ typedef struct skFlowSourceStats_st {
             (source_stats)->procPkts, (source_stats)->goodRecs,         \
             (source_stats)->missingRecs, (source_stats)->badRecs)
 
+/**
+ *    Macro to add the statistics in 'source_stats' to 'total_stats'.
+ */
+#define FLOWSOURCE_STATS_ADD(total_stats, source_stats)                 \
+    do {                                                                \
+        (total_stats)->procPkts    += (source_stats)->procPkts;         \
+        (total_stats)->badPkts     += (source_stats)->badPkts;          \
+        (total_stats)->goodRecs    += (source_stats)->goodRecs;         \
+        (total_stats)->badRecs     += (source_stats)->badRecs;          \
+        (total_stats)->missingRecs += (source_stats)->missingRecs;      \
+    } while (0)
+
+
+/**
+ *    Structure used to report the state of a flow source to a
+ *    performance monitor.  Unlike skFlowSourceStats_t, the counters
+ *    are totals since the source was created; they are not reset
+ *    when the statistics are logged and cleared.
+ */
+typedef struct skFlowSourceTelemetry_st {
+    /** Statistics since the source was created */
+    skFlowSourceStats_t stats;
+    /** Number of octets in the processed packets, or 0 if unknown */
+    uint64_t    procBytes;
+    /** Number of packets waiting in the source's buffer */
+    uint32_t    bufCount;
+    /** Number of packets the buffer holds, or 0 for a source that
+     * reads from a file */
+    uint32_t    bufCapacity;
+    /** Number of times the collector waited for the reader to make
+     * room in a full buffer; the operating system may drop packets
+     * during the wait */
+    uint64_t    bufFullWaits;
+    /** Number of times the reader waited on an empty buffer */
+    uint64_t    bufEmptyWaits;
+} skFlowSourceTelemetry_t;
+
 
 
 /***  PDU SOURCES  ********************************************************/
@@ -304,6 +341,27 @@ skPDUSourceClearStats(
     skPDUSource_t      *source);
 
 
+/**
+ *    Returns the time when the packet that held the record most
+ *    recently returned by skPDUSourceGetGeneric() arrived, as
+ *    microseconds since the UNIX epoch.  Returns 0 when the source
+ *    reads from a file.
+ */
+uint64_t
+skPDUSourceGetArrivalTime(
+    const skPDUSource_t    *source);
+
+
+/**
+ *    Fills 'telemetry' with the cumulative statistics and the buffer
+ *    state of the PDU source.
+ */
+void
+skPDUSourceGetTelemetry(
+    skPDUSource_t              *source,
+    skFlowSourceTelemetry_t    *telemetry);
+
+
 /***  IPFIX SOURCES  ******************************************************/
 
 
@@ -466,6 +524,17 @@ skIPFIXSourceClearStats(
     skIPFIXSource_t    *source);
 
 
+/**
+ *    Fills 'telemetry' with the cumulative statistics and the buffer
+ *    state of the IPFIX source.  The number of octets is not known
+ *    and is reported as 0.
+ */
+void
+skIPFIXSourceGetTelemetry(
+    skIPFIXSource_t            *source,
+    skFlowSourceTelemetry_t    *telemetry);
+
+
 
 #ifdef __cplusplus
 }
@@ -126,6 +126,10 @@ typedef struct pdu_engine_info_st {
 struct skPDUSource_st {
     skFlowSourceStats_t     statistics;
     pthread_mutex_t         stats_mutex;
+    /* statistics that were cleared from 'statistics', and the bytes
+     * in the packets processed, for telemetry */
+    skFlowSourceStats_t     totals;
+    uint64_t                proc_bytes;
 
     const skpc_probe_t     *probe;
     const char             *name;
@@ -313,6 +317,7 @@ pduSourceRejectPacket(
             /* previous status was also PDU_OK; return */
             pthread_mutex_lock(&source->stats_mutex);
             ++source->statistics.procPkts;
+            source->proc_bytes += data_len;
             pthread_mutex_unlock(&source->stats_mutex);
             return 0;
         }
@@ -327,6 +332,7 @@ pduSourceRejectPacket(
         ++source->badpdu_consec;
         pthread_mutex_lock(&source->stats_mutex);
         ++source->statistics.procPkts;
+        source->proc_bytes += data_len;
         ++source->statistics.badPkts;
         pthread_mutex_unlock(&source->stats_mutex);
         return 1;
@@ -347,6 +353,7 @@ pduSourceRejectPacket(
             source->badpdu_status = PDU_OK;
             pthread_mutex_lock(&source->stats_mutex);
             ++source->statistics.procPkts;
+            source->proc_bytes += data_len;
             pthread_mutex_unlock(&source->stats_mutex);
             return 0;
         }
@@ -360,6 +367,7 @@ pduSourceRejectPacket(
     source->badpdu_status = pdu_status;
     pthread_mutex_lock(&source->stats_mutex);
     ++source->statistics.procPkts;
+    source->proc_bytes += data_len;
     ++source->statistics.badPkts;
     pthread_mutex_unlock(&source->stats_mutex);
     return 1;
@@ -892,6 +900,7 @@ skPDUSourceLogStatsAndClear(
 {
     pthread_mutex_lock(&source->stats_mutex);
     FLOWSOURCE_STATS_INFOMSG(source->name, &(source->statistics));
+    FLOWSOURCE_STATS_ADD(&source->totals, &source->statistics);
     memset(&source->statistics, 0, sizeof(source->statistics));
     pthread_mutex_unlock(&source->stats_mutex);
 }
@@ -902,11 +911,43 @@ skPDUSourceClearStats(
     skPDUSource_t      *source)
 {
     pthread_mutex_lock(&source->stats_mutex);
+    FLOWSOURCE_STATS_ADD(&source->totals, &source->statistics);
     memset(&source->statistics, 0, sizeof(source->statistics));
     pthread_mutex_unlock(&source->stats_mutex);
 }
 
 
+
+uint64_t
+skPDUSourceGetArrivalTime(
+    const skPDUSource_t    *source)
+{
+    return skUDPSourceGetArrivalTime(source->source);
+}
+
+
+void
+skPDUSourceGetTelemetry(
+    skPDUSource_t              *source,
+    skFlowSourceTelemetry_t    *telemetry)
+{
+    circBufStats_t buf_stats;
+
+    memset(telemetry, 0, sizeof(*telemetry));
+    pthread_mutex_lock(&source->stats_mutex);
+    telemetry->stats = source->totals;
+    FLOWSOURCE_STATS_ADD(&telemetry->stats, &source->statistics);
+    telemetry->procBytes = source->proc_bytes;
+    pthread_mutex_unlock(&source->stats_mutex);
+
+    if (0 == skUDPSourceGetBufferStats(source->source, &buf_stats)) {
+        telemetry->bufCount = buf_stats.items;
+        telemetry->bufCapacity = buf_stats.capacity;
+        telemetry->bufFullWaits = buf_stats.full_waits;
+        telemetry->bufEmptyWaits = buf_stats.empty_waits;
+    }
+}
+
 /*
 ** Local Variables:
 ** mode:c
@@ -2416,64 +2416,96 @@ skiCreateWriteBufferForFP(
 }
 
 
-/* Append SiLK Flow 'rec' to the libfixbuf buffer 'fbuf' */
-gboolean
-skiRwAppendRecord(
-    fBuf_t             *fbuf,
+/* Return the size of the record filled by skiRwToFixrec() */
+size_t
+skiRwFixrecSize(
+    void)
+{
+    return sizeof(ski_rwrec_t);
+}
+
+
+/* Convert SiLK Flow 'rec' to the internal template record 'v_fixrec' */
+void
+skiRwToFixrec(
     const rwRec        *rec,
-    GError            **err)
+    void               *v_fixrec)
 {
-    ski_rwrec_t fixrec;
+    ski_rwrec_t *fixrec = (ski_rwrec_t *)v_fixrec;
 
     /* Convert time from start/elapsed to start and end epoch millis. */
-    fixrec.flowStartMilliseconds = (uint64_t)rwRecGetStartTime(rec);
-    fixrec.flowEndMilliseconds = ((uint64_t)fixrec.flowStartMilliseconds
-                                  + rwRecGetElapsed(rec));
+    fixrec->flowStartMilliseconds = (uint64_t)rwRecGetStartTime(rec);
+    fixrec->flowEndMilliseconds = ((uint64_t)fixrec->flowStartMilliseconds
+                                   + rwRecGetElapsed(rec));
 
     /* Handle IP addresses */
 #if SK_ENABLE_IPV6
     if (rwRecIsIPv6(rec)) {
-        rwRecMemGetSIPv6(rec, fixrec.sourceIPv6Address);
-        rwRecMemGetDIPv6(rec, fixrec.destinationIPv6Address);
-        rwRecMemGetNhIPv6(rec, fixrec.ipNextHopIPv6Address);
-        fixrec.sourceIPv4Address = 0;
-        fixrec.destinationIPv4Address = 0;
-        fixrec.ipNextHopIPv4Address = 0;
+        rwRecMemGetSIPv6(rec, fixrec->sourceIPv6Address);
+        rwRecMemGetDIPv6(rec, fixrec->destinationIPv6Address);
+        rwRecMemGetNhIPv6(rec, fixrec->ipNextHopIPv6Address);
+        fixrec->sourceIPv4Address = 0;
+        fixrec->destinationIPv4Address = 0;
+        fixrec->ipNextHopIPv4Address = 0;
     } else
 #endif
     {
-        memset(fixrec.sourceIPv6Address, 0,
-               sizeof(fixrec.sourceIPv6Address));
-        memset(fixrec.destinationIPv6Address, 0,
-               sizeof(fixrec.destinationIPv6Address));
-        memset(fixrec.ipNextHopIPv6Address, 0,
-               sizeof(fixrec.ipNextHopIPv6Address));
-        fixrec.sourceIPv4Address = rwRecGetSIPv4(rec);
-        fixrec.destinationIPv4Address = rwRecGetDIPv4(rec);
-        fixrec.ipNextHopIPv4Address = rwRecGetNhIPv4(rec);
+        memset(fixrec->sourceIPv6Address, 0,
+               sizeof(fixrec->sourceIPv6Address));
+        memset(fixrec->destinationIPv6Address, 0,
+               sizeof(fixrec->destinationIPv6Address));
+        memset(fixrec->ipNextHopIPv6Address, 0,
+               sizeof(fixrec->ipNextHopIPv6Address));
+        fixrec->sourceIPv4Address = rwRecGetSIPv4(rec);
+        fixrec->destinationIPv4Address = rwRecGetDIPv4(rec);
+        fixrec->ipNextHopIPv4Address = rwRecGetNhIPv4(rec);
     }
 
     /* Copy rest of record */
-    fixrec.sourceTransportPort = rwRecGetSPort(rec);
-    fixrec.destinationTransportPort = rwRecGetDPort(rec);
-    fixrec.ingressInterface = rwRecGetInput(rec);
-    fixrec.egressInterface = rwRecGetOutput(rec);
-    fixrec.packetDeltaCount = rwRecGetPkts(rec);
-    fixrec.octetDeltaCount = rwRecGetBytes(rec);
-    fixrec.protocolIdentifier = rwRecGetProto(rec);
-    fixrec.silkFlowType = rwRecGetFlowType(rec);
-    fixrec.silkFlowSensor = rwRecGetSensor(rec);
-    fixrec.tcpControlBits = rwRecGetFlags(rec);
-    fixrec.initialTCPFlags = rwRecGetInitFlags(rec);
-    fixrec.unionTCPFlags = rwRecGetRestFlags(rec);
-    fixrec.silkTCPState = rwRecGetTcpState(rec);
-    fixrec.silkAppLabel = rwRecGetApplication(rec);
+    fixrec->sourceTransportPort = rwRecGetSPort(rec);
+    fixrec->destinationTransportPort = rwRecGetDPort(rec);
+    fixrec->ingressInterface = rwRecGetInput(rec);
+    fixrec->egressInterface = rwRecGetOutput(rec);
+    fixrec->packetDeltaCount = rwRecGetPkts(rec);
+    fixrec->octetDeltaCount = rwRecGetBytes(rec);
+    fixrec->protocolIdentifier = rwRecGetProto(rec);
+    fixrec->silkFlowType = rwRecGetFlowType(rec);
+    fixrec->silkFlowSensor = rwRecGetSensor(rec);
+    fixrec->tcpControlBits = rwRecGetFlags(rec);
+    fixrec->initialTCPFlags = rwRecGetInitFlags(rec);
+    fixrec->unionTCPFlags = rwRecGetRestFlags(rec);
+    fixrec->silkTCPState = rwRecGetTcpState(rec);
+    fixrec->silkAppLabel = rwRecGetApplication(rec);
 
 #if SKI_RWREC_PADDING != 0
     /* According to RFC5102, the value of the paddingOctets
      * Information Element "is always a sequence of 0x00 values." */
-    memset(fixrec.pad, 0, SKI_RWREC_PADDING);
+    memset(fixrec->pad, 0, SKI_RWREC_PADDING);
 #endif
+}
+
+
+/* Append a record filled by skiRwToFixrec() to the buffer 'fbuf' */
+gboolean
+skiRwAppendFixrec(
+    fBuf_t             *fbuf,
+    const void         *fixrec,
+    GError            **err)
+{
+    return fBufAppend(fbuf, (uint8_t *)fixrec, sizeof(ski_rwrec_t), err);
+}
+
+
+/* Append SiLK Flow 'rec' to the libfixbuf buffer 'fbuf' */
+gboolean
+skiRwAppendRecord(
+    fBuf_t             *fbuf,
+    const rwRec        *rec,
+    GError            **err)
+{
+    ski_rwrec_t fixrec;
+
+    skiRwToFixrec(rec, &fixrec);
 
     /* Append the record to the buffer */
     if (!fBufAppend(fbuf, (uint8_t *)&fixrec, sizeof(fixrec), err)) {
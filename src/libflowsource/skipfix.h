@@ -448,6 +448,47 @@ skiRwAppendRecord(
     const rwRec        *rec,
     GError            **err);
 
+/**
+ * Return the size in octets of the IPFIX record that skiRwToFixrec()
+ * fills.  Callers that convert records in batches use this to size
+ * their buffers.
+ */
+size_t
+skiRwFixrecSize(
+    void);
+
+/**
+ * Convert a SiLK Flow record to the record described by the template
+ * that skiCreateWriteBufferForFP() sets as the internal template.
+ * This function does not touch any fixbuf state, so it may be called
+ * from multiple threads concurrently.  The result may be appended to
+ * a buffer with skiRwAppendFixrec().
+ *
+ * @param rec     pointer to SiLK Flow record.
+ * @param fixrec  location of at least skiRwFixrecSize() octets, with
+ *                the alignment returned by malloc(), to fill.
+ */
+void
+skiRwToFixrec(
+    const rwRec        *rec,
+    void               *fixrec);
+
+/**
+ * Append a record previously filled by skiRwToFixrec() to an IPFIX
+ * message buffer.  Return values are the same as for
+ * skiRwAppendRecord().
+ *
+ * @param fbuf    an IPFIX Message buffer.
+ * @param fixrec  pointer to the converted record.
+ * @param err     an error description
+ * @return TRUE on success, FALSE on failure.
+ */
+gboolean
+skiRwAppendFixrec(
+    fBuf_t             *fbuf,
+    const void         *fixrec,
+    GError            **err);
+
 
 
 #ifdef __cplusplus
@@ -68,6 +68,7 @@ RCSIDENT("$SiLK: udpsource.c 57462b566e53 2015-02-17 15:50:12Z mthomas $");
 #include <silk/redblack.h>
 #include <silk/skdllist.h>
 #include <silk/sklog.h>
+#include <silk/sktelemetry.h>
 #include <silk/skthread.h>
 #include "udpsource.h"
 #include "circbuf.h"
@@ -83,6 +84,12 @@ RCSIDENT("$SiLK: udpsource.c 57462b566e53 2015-02-17 15:50:12Z mthomas $");
 #define DEBUG_ACCEPT_FROM 0
 #endif
 
+/* Each cell in the circular buffer of a network source begins with
+ * the time the packet arrived, in microseconds since the epoch, and
+ * the packet follows.  The size of the header keeps the packet
+ * aligned on an 8-byte boundary. */
+#define UDP_CELL_HEADER  sizeof(uint64_t)
+
 
 /* forward declarations */
 struct skUDPSourceBase_st;
@@ -129,6 +136,10 @@ struct skUDPSource_st {
     circBuf_t                  *data_buffer;
     void                       *pkt_buffer;
 
+    /* arrival time of the packet most recently returned by
+     * skUDPSourceNext(); only accessed by the caller's thread */
+    uint64_t                    arrival;
+
     unsigned                    stopped : 1;
 };
 
@@ -303,6 +314,7 @@ udp_reader(
     while (!base->stop && base->active_sources && base->pfd_valid) {
         nfds_t i;
         ssize_t rv;
+        uint64_t arrival;
 
         /* Wait for data */
         rv = poll(base->pfd, base->pfd_len, POLL_TIMEOUT);
@@ -351,6 +363,7 @@ udp_reader(
             len = sizeof(addr);
             rv = recvfrom(pfd->fd, data, base->data_size, 0,
                           (struct sockaddr *)&addr, &len);
+            arrival = skTelemetryNow();
 
             /* Check for error or recv from wrong address */
             if (rv == -1) {
@@ -416,12 +429,14 @@ udp_reader(
                 continue;
             }
 
-            /* Copy the data onto the source */
-            memcpy(source->pkt_buffer, data, rv);
+            /* Copy the arrival time and data onto the source */
+            memcpy(source->pkt_buffer, &arrival, UDP_CELL_HEADER);
+            memcpy((uint8_t*)source->pkt_buffer + UDP_CELL_HEADER, data, rv);
             pthread_mutex_unlock(&base->mutex);
 
             if (source->reject_pkt_fn
-                && source->reject_pkt_fn(rv, source->pkt_buffer,
+                && source->reject_pkt_fn(rv, ((uint8_t*)source->pkt_buffer
+                                              + UDP_CELL_HEADER),
                                          source->fn_callback_data))
             {
                 /* reject the packet; do not advance to next location */
@@ -1138,7 +1153,8 @@ skUDPSourceCreate(
         /* A socket-based probe */
 
         /* Create circular buffer */
-        source->data_buffer = circBufCreate(itemsize, params->max_pkts);
+        source->data_buffer = circBufCreate(itemsize + UDP_CELL_HEADER,
+                                            params->max_pkts);
         if (source->data_buffer == NULL) {
             free(source);
             return NULL;
@@ -1287,7 +1303,12 @@ skUDPSourceNext(
          * until data is ready */
         pthread_mutex_unlock(&base->mutex);
         if (source->data_buffer) {
-            return circBufNextTail(source->data_buffer);
+            data = circBufNextTail(source->data_buffer);
+            if (data) {
+                memcpy(&source->arrival, data, UDP_CELL_HEADER);
+                data += UDP_CELL_HEADER;
+            }
+            return data;
         }
         return NULL;
     }
@@ -1323,6 +1344,30 @@ skUDPSourceNext(
     return data;
 }
 
+
+uint64_t
+skUDPSourceGetArrivalTime(
+    const skUDPSource_t    *source)
+{
+    assert(source);
+    return ((source->data_buffer) ? source->arrival : 0);
+}
+
+
+int
+skUDPSourceGetBufferStats(
+    skUDPSource_t      *source,
+    circBufStats_t     *stats)
+{
+    assert(source);
+    if (NULL == source->data_buffer) {
+        memset(stats, 0, sizeof(*stats));
+        return -1;
+    }
+    circBufGetStats(source->data_buffer, stats);
+    return 0;
+}
+
 /*
 ** Local Variables:
 ** mode:c
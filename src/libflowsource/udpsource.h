@@ -60,6 +60,7 @@ extern "C" {
 RCSIDENTVAR(rcsID_UDPSOURCE_H, "$SiLK: udpsource.h 2b1355d69f79 2015-02-13 23:12:41Z mthomas $");
 
 #include <silk/utils.h>
+#include "circbuf.h"
 
 struct skUDPSource_st;
 typedef struct skUDPSource_st skUDPSource_t;
@@ -129,6 +130,28 @@ uint8_t *
 skUDPSourceNext(
     skUDPSource_t      *source);
 
+
+/**
+ *    Return the time when the data most recently returned by
+ *    skUDPSourceNext() arrived, as microseconds since the UNIX epoch.
+ *    Return 0 when 'source' reads from a file.
+ */
+uint64_t
+skUDPSourceGetArrivalTime(
+    const skUDPSource_t    *source);
+
+
+/**
+ *    Fill 'stats' with the statistics for the buffer that holds the
+ *    packets 'source' has collected but that have not been requested.
+ *    Return 0 on success.  Return -1 and clear 'stats' when 'source'
+ *    reads from a file.
+ */
+int
+skUDPSourceGetBufferStats(
+    skUDPSource_t      *source,
+    circBufStats_t     *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -72,6 +72,10 @@ RCSIDENT("$SiLK: rwascii.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 /* size of buffer that gets filled with a column's value */
 #define RWASCII_BUF_SIZE  2048
 
+/* size of the buffer that collects formatted rows before they are
+ * handed to the output FILE in a single fwrite() */
+#define RWASCII_OUTBUF_SIZE  0x10000
+
 /* how we know a field contains a callback */
 #define RWASCII_CB_FIELD_ID        UINT32_MAX
 #define RWASCII_CB_EXTRA_FIELD_ID  (UINT32_MAX-1)
@@ -89,9 +93,34 @@ typedef struct rwascii_field_st {
 } rwascii_field_t;
 
 
+/*
+ *    Every timestamp within one minute has the same text up to and
+ *    including the minutes.  The time cache holds that text so only
+ *    the seconds and milliseconds must be formatted for each record.
+ */
+typedef struct rwascii_timecache_st {
+    /* the time of the start of the cached minute, or -1 if empty */
+    sktime_t            tc_minute;
+    /* the number of characters in 'tc_prefix' */
+    size_t              tc_len;
+    /* the text of the timestamp up to and including the minutes */
+    char                tc_prefix[SKTIMESTAMP_STRLEN];
+} rwascii_timecache_t;
+
+
 /* typedef rwAsciiStream_st rwAsciiStream_t; */
 struct rwAsciiStream_st {
     FILE               *as_out_stream;
+    /* when set, text is handed to this function instead of being
+     * written to 'as_out_stream' */
+    rwAsciiStreamWrite_t    as_write_fn;
+    void               *as_write_cb_data;
+    /* rows are formatted here, then written to 'as_out_stream' */
+    char               *as_outbuf;
+    size_t              as_outbuf_len;
+    /* caches for the start time and for the end time */
+    rwascii_timecache_t as_stime_cache;
+    rwascii_timecache_t as_etime_cache;
     rwascii_field_t    *as_field;
     uint32_t            as_field_count;
     uint32_t            as_field_capacity;
@@ -214,6 +243,221 @@ static const sk_stringmap_entry_t field_map_entries[] = {
 
 /* FUNCTION DEFINITIONS */
 
+/*
+ *  asciiBufferFlush(astream);
+ *
+ *    Write any text in the output buffer of 'astream' to the output
+ *    FILE---or pass it to the write callback---and empty the buffer.
+ */
+static void
+asciiBufferFlush(
+    rwAsciiStream_t    *astream)
+{
+    if (astream->as_outbuf_len) {
+        if (astream->as_write_fn) {
+            astream->as_write_fn(astream->as_outbuf, astream->as_outbuf_len,
+                                 astream->as_write_cb_data);
+        } else {
+            fwrite(astream->as_outbuf, 1, astream->as_outbuf_len,
+                   astream->as_out_stream);
+        }
+        astream->as_outbuf_len = 0;
+    }
+}
+
+
+/*
+ *  asciiBufferAppend(astream, text, len, width);
+ *
+ *    Append the 'len' characters in 'text' to the output buffer of
+ *    'astream', right-justifying the text in a column of 'width'
+ *    characters.  Flush the buffer when it becomes full.
+ */
+static void
+asciiBufferAppend(
+    rwAsciiStream_t    *astream,
+    const char         *text,
+    size_t              len,
+    size_t              width)
+{
+    size_t pad = ((len < width) ? (width - len) : 0);
+    size_t n;
+
+    if (astream->as_outbuf_len + pad + len <= RWASCII_OUTBUF_SIZE) {
+        if (pad) {
+            memset(astream->as_outbuf + astream->as_outbuf_len, ' ', pad);
+            astream->as_outbuf_len += pad;
+        }
+        memcpy(astream->as_outbuf + astream->as_outbuf_len, text, len);
+        astream->as_outbuf_len += len;
+        return;
+    }
+
+    /* the text does not fit; copy it in pieces */
+    while (pad) {
+        if (astream->as_outbuf_len == RWASCII_OUTBUF_SIZE) {
+            asciiBufferFlush(astream);
+        }
+        n = RWASCII_OUTBUF_SIZE - astream->as_outbuf_len;
+        if (n > pad) {
+            n = pad;
+        }
+        memset(astream->as_outbuf + astream->as_outbuf_len, ' ', n);
+        astream->as_outbuf_len += n;
+        pad -= n;
+    }
+    while (len) {
+        if (astream->as_outbuf_len == RWASCII_OUTBUF_SIZE) {
+            asciiBufferFlush(astream);
+        }
+        n = RWASCII_OUTBUF_SIZE - astream->as_outbuf_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(astream->as_outbuf + astream->as_outbuf_len, text, n);
+        astream->as_outbuf_len += n;
+        text += n;
+        len -= n;
+    }
+}
+
+
+/*
+ *  asciiBufferAppendChar(astream, c);
+ *
+ *    Append the single character 'c' to the output buffer of
+ *    'astream'.
+ */
+static void
+asciiBufferAppendChar(
+    rwAsciiStream_t    *astream,
+    char                c)
+{
+    if (astream->as_outbuf_len == RWASCII_OUTBUF_SIZE) {
+        asciiBufferFlush(astream);
+    }
+    astream->as_outbuf[astream->as_outbuf_len++] = c;
+}
+
+
+/*
+ *  len = asciiFormatUint(buf, val);
+ *
+ *    Write the decimal representation of 'val' into 'buf', NUL
+ *    terminate it, and return the number of characters written,
+ *    not including the NUL.
+ */
+static size_t
+asciiFormatUint(
+    char               *buf,
+    uint64_t            val)
+{
+    char tmp[24];
+    char *cp = tmp + sizeof(tmp);
+    size_t len;
+
+    do {
+        *--cp = '0' + (char)(val % 10);
+        val /= 10;
+    } while (val);
+
+    len = tmp + sizeof(tmp) - cp;
+    memcpy(buf, cp, len);
+    buf[len] = '\0';
+    return len;
+}
+
+
+/*
+ *  len = asciiFormatMsec(buf, val);
+ *
+ *    Write 'val' milliseconds as seconds with three decimal places
+ *    ("%u.%03u") into 'buf' and return the length of the text.
+ */
+static size_t
+asciiFormatMsec(
+    char               *buf,
+    uint64_t            val)
+{
+    unsigned int msec = (unsigned int)(val % 1000);
+    size_t len;
+
+    len = asciiFormatUint(buf, val / 1000);
+    buf[len++] = '.';
+    buf[len++] = '0' + msec / 100;
+    buf[len++] = '0' + (msec / 10) % 10;
+    buf[len++] = '0' + msec % 10;
+    buf[len] = '\0';
+    return len;
+}
+
+
+/*
+ *  len = asciiFormatTime(cache, buf, t, time_flags);
+ *
+ *    Write the timestamp 't' into 'buf' in the form specified by
+ *    'time_flags' (see sktimestamp_r()) and return the length of the
+ *    text.  Use and update 'cache' to avoid converting the time to a
+ *    calendar date for every record.
+ */
+static size_t
+asciiFormatTime(
+    rwascii_timecache_t    *cache,
+    char                   *buf,
+    sktime_t                t,
+    uint32_t                time_flags)
+{
+    sktime_t minute;
+    unsigned int sec;
+    char *cp;
+
+    if (t < 0) {
+        sktimestamp_r(buf, t, time_flags);
+        return strlen(buf);
+    }
+    if (time_flags & SKTIMESTAMP_EPOCH) {
+        if (time_flags & SKTIMESTAMP_NOMSEC) {
+            return asciiFormatUint(buf, t / 1000);
+        }
+        return asciiFormatMsec(buf, t);
+    }
+
+    minute = t - (t % 60000);
+    if (minute != cache->tc_minute) {
+        /* format the start of the minute without milliseconds and
+         * remove the seconds.  If the seconds are not "00" (a time
+         * zone with an odd offset), do not use the cache. */
+        sktimestamp_r(cache->tc_prefix, minute,
+                      (time_flags | SKTIMESTAMP_NOMSEC));
+        cache->tc_len = strlen(cache->tc_prefix);
+        if (cache->tc_len < 2
+            || 0 != strcmp(&cache->tc_prefix[cache->tc_len - 2], "00"))
+        {
+            cache->tc_minute = -1;
+            sktimestamp_r(buf, t, time_flags);
+            return strlen(buf);
+        }
+        cache->tc_len -= 2;
+        cache->tc_minute = minute;
+    }
+
+    memcpy(buf, cache->tc_prefix, cache->tc_len);
+    cp = buf + cache->tc_len;
+    sec = (unsigned int)((t - minute) / 1000);
+    *cp++ = '0' + sec / 10;
+    *cp++ = '0' + sec % 10;
+    if (!(time_flags & SKTIMESTAMP_NOMSEC)) {
+        sec = (unsigned int)(t % 1000);
+        *cp++ = '.';
+        *cp++ = '0' + sec / 100;
+        *cp++ = '0' + (sec / 10) % 10;
+        *cp++ = '0' + sec % 10;
+    }
+    *cp = '\0';
+    return cp - buf;
+}
+
+
 static int
 rwAsciiAllocFields(
     rwAsciiStream_t    *astream,
@@ -540,6 +784,10 @@ int
 rwAsciiFlush(
     rwAsciiStream_t    *astream)
 {
+    asciiBufferFlush(astream);
+    if (astream->as_write_fn) {
+        return 0;
+    }
     return fflush(astream->as_out_stream);
 }
 
@@ -552,6 +800,11 @@ rwAsciiStreamDestroy(
         return;
     }
 
+    if ((*astream)->as_outbuf) {
+        asciiBufferFlush(*astream);
+        free((*astream)->as_outbuf);
+        (*astream)->as_outbuf = NULL;
+    }
     if ((*astream)->as_field) {
         free((*astream)->as_field);
         (*astream)->as_field = NULL;
@@ -575,8 +828,18 @@ rwAsciiStreamCreate(
         return -1;
     }
 
+    (*astream)->as_outbuf = (char*)malloc(RWASCII_OUTBUF_SIZE);
+    if (!(*astream)->as_outbuf) {
+        free(*astream);
+        *astream = NULL;
+        skAppPrintOutOfMemory(NULL);
+        return -1;
+    }
+
     /* non-zero defaults */
     (*astream)->as_out_stream = stdout;
+    (*astream)->as_stime_cache.tc_minute = -1;
+    (*astream)->as_etime_cache.tc_minute = -1;
     (*astream)->as_delimiter = '|';
 #if SK_ENABLE_IPV6
     (*astream)->as_ipv6_policy = SK_IPV6POLICY_MIX;
@@ -588,6 +851,54 @@ rwAsciiStreamCreate(
 }
 
 
+int
+rwAsciiStreamClone(
+    rwAsciiStream_t   **clone,
+    rwAsciiStream_t    *astream)
+{
+    rwAsciiStream_t *c;
+
+    assert(clone);
+    assert(astream);
+
+    /* fix the list of fields and their widths */
+    if (astream->as_initialized == 0) {
+        rwAsciiPreparePrint(astream);
+    }
+
+    if (rwAsciiStreamCreate(&c)) {
+        return -1;
+    }
+    if (rwAsciiAllocFields(c, astream->as_field_count)) {
+        rwAsciiStreamDestroy(&c);
+        skAppPrintOutOfMemory(NULL);
+        return -1;
+    }
+    memcpy(c->as_field, astream->as_field,
+           astream->as_field_count * sizeof(rwascii_field_t));
+    c->as_field_count = astream->as_field_count;
+
+    c->as_out_stream      = astream->as_out_stream;
+    c->as_ipformat        = astream->as_ipformat;
+    c->as_timeflags       = astream->as_timeflags;
+    c->as_ipv6_policy     = astream->as_ipv6_policy;
+    c->as_delimiter       = astream->as_delimiter;
+    c->as_not_columnar    = astream->as_not_columnar;
+    c->as_integer_sensors = astream->as_integer_sensors;
+    c->as_integer_flags   = astream->as_integer_flags;
+    c->as_no_final_delim  = astream->as_no_final_delim;
+    c->as_no_newline      = astream->as_no_newline;
+    c->as_legacy_icmp     = astream->as_legacy_icmp;
+
+    /* the clone neither prints the titles nor adjusts the fields */
+    c->as_no_titles = 1;
+    c->as_initialized = 1;
+
+    *clone = c;
+    return 0;
+}
+
+
 int
 rwAsciiAppendOneField(
     rwAsciiStream_t    *astream,
@@ -716,6 +1027,8 @@ rwAsciiSetOutputHandle(
     FILE               *fh)
 {
     assert(astream);
+    /* send pending text to the current handle */
+    asciiBufferFlush(astream);
     if (fh == NULL) {
         astream->as_out_stream = stdout;
     } else {
@@ -724,6 +1037,20 @@ rwAsciiSetOutputHandle(
 }
 
 
+void
+rwAsciiSetOutputCallback(
+    rwAsciiStream_t        *astream,
+    rwAsciiStreamWrite_t    write_fn,
+    void                   *callback_data)
+{
+    assert(astream);
+    /* send pending text to the current destination */
+    asciiBufferFlush(astream);
+    astream->as_write_fn = write_fn;
+    astream->as_write_cb_data = callback_data;
+}
+
+
 void
 rwAsciiSetDelimiter(
     rwAsciiStream_t    *astream,
@@ -778,6 +1105,8 @@ rwAsciiSetTimestampFlags(
 {
     assert(astream);
     astream->as_timeflags = time_flags;
+    astream->as_stime_cache.tc_minute = -1;
+    astream->as_etime_cache.tc_minute = -1;
 }
 
 
@@ -849,12 +1178,95 @@ rwAsciiGetFieldName(
 }
 
 
+uint32_t
+rwAsciiGetFieldCount(
+    rwAsciiStream_t    *astream)
+{
+    if (astream->as_initialized == 0) {
+        rwAsciiPreparePrint(astream);
+    }
+    return astream->as_field_count;
+}
+
+
+int
+rwAsciiGetFieldInfo(
+    rwAsciiStream_t    *astream,
+    uint32_t            position,
+    uint32_t           *field_id,
+    char               *title_buf,
+    size_t              title_buf_size)
+{
+    const rwascii_field_t *field;
+
+    if (position >= rwAsciiGetFieldCount(astream)) {
+        return -1;
+    }
+    field = &astream->as_field[position];
+
+    switch (field->af_field_id) {
+      case RWASCII_CB_FIELD_ID:
+      case RWASCII_CB_EXTRA_FIELD_ID:
+        *field_id = RWASCII_CALLBACK_FIELD;
+        if (title_buf) {
+            field->af_cb_gettitle(title_buf, title_buf_size,
+                                  field->af_cb_data);
+        }
+        break;
+
+      default:
+        *field_id = field->af_field_id;
+        if (title_buf) {
+            rwAsciiGetFieldName(title_buf, title_buf_size,
+                                (rwrec_printable_fields_t)field->af_field_id);
+        }
+        break;
+    }
+    return 0;
+}
+
+
+int
+rwAsciiGetCallbackFieldValue(
+    rwAsciiStream_t    *astream,
+    uint32_t            position,
+    const rwRec        *rwrec,
+    void               *extra,
+    char               *text_buf,
+    size_t              text_buf_size)
+{
+    const rwascii_field_t *field;
+
+    if (position >= rwAsciiGetFieldCount(astream)) {
+        return -1;
+    }
+    field = &astream->as_field[position];
+
+    switch (field->af_field_id) {
+      case RWASCII_CB_FIELD_ID:
+        field->af_cb_getvalue.gv(rwrec, text_buf, text_buf_size,
+                                 field->af_cb_data);
+        break;
+
+      case RWASCII_CB_EXTRA_FIELD_ID:
+        field->af_cb_getvalue.gv_extra(rwrec, text_buf, text_buf_size,
+                                       field->af_cb_data, extra);
+        break;
+
+      default:
+        return -1;
+    }
+    return 0;
+}
+
+
 void
 rwAsciiPrintTitles(
     rwAsciiStream_t    *astream)
 {
     const rwascii_field_t *field;
     char buf[RWASCII_BUF_SIZE];
+    size_t len;
     uint32_t i;
 
     /* initialize */
@@ -874,7 +1286,7 @@ rwAsciiPrintTitles(
          ++i, ++field)
     {
         if (i > 0) {
-            fprintf(astream->as_out_stream, "%c", astream->as_delimiter);
+            asciiBufferAppendChar(astream, astream->as_delimiter);
         }
         switch (field->af_field_id) {
           case RWASCII_CB_FIELD_ID:
@@ -889,20 +1301,26 @@ rwAsciiPrintTitles(
             break;
         }
 
+        len = strlen(buf);
         if (astream->as_not_columnar) {
-            fprintf(astream->as_out_stream, "%s", buf);
+            asciiBufferAppend(astream, buf, len, 0);
         } else {
-            fprintf(astream->as_out_stream, "%*.*s",
-                    (int)field->af_width, (int)field->af_width,
-                    buf);
+            /* titles are truncated to the column width */
+            if (len > field->af_width) {
+                len = field->af_width;
+            }
+            asciiBufferAppend(astream, buf, len, field->af_width);
         }
     } /* for */
 
     if ( !astream->as_no_final_delim) {
-        fprintf(astream->as_out_stream, "%c", astream->as_delimiter);
+        asciiBufferAppendChar(astream, astream->as_delimiter);
     }
     if ( !astream->as_no_newline) {
-        fprintf(astream->as_out_stream, "\n");
+        asciiBufferAppendChar(astream, '\n');
+    } else {
+        /* the caller will append to the line */
+        asciiBufferFlush(astream);
     }
 }
 
@@ -914,11 +1332,11 @@ rwAsciiPrintRecExtra(
     const rwRec        *rwrec,
     void               *extra)
 {
-    static char buffer[RWASCII_BUF_SIZE];
+    char buffer[RWASCII_BUF_SIZE];
     const rwascii_field_t *field;
     skipaddr_t ip;
     int flags_flags;
-    imaxdiv_t idiv;
+    size_t len;
     uint32_t i;
 
     assert(astream);
@@ -947,41 +1365,44 @@ rwAsciiPrintRecExtra(
          ++i, ++field)
     {
         if (i > 0) {
-            fprintf(astream->as_out_stream, "%c", astream->as_delimiter);
+            asciiBufferAppendChar(astream, astream->as_delimiter);
         }
         switch (field->af_field_id) {
           case RWREC_FIELD_SIP:
             rwRecMemGetSIP(rwrec, &ip);
             skipaddrString(buffer, &ip, astream->as_ipformat);
+            len = strlen(buffer);
             break;
 
           case RWREC_FIELD_DIP:
             rwRecMemGetDIP(rwrec, &ip);
             skipaddrString(buffer, &ip, astream->as_ipformat);
+            len = strlen(buffer);
             break;
 
           case RWREC_FIELD_NHIP:
             rwRecMemGetNhIP(rwrec, &ip);
             skipaddrString(buffer, &ip, astream->as_ipformat);
+            len = strlen(buffer);
             break;
 
           case RWREC_FIELD_SPORT:
             if (astream->as_legacy_icmp && rwRecIsICMP(rwrec)) {
                 /* Put the ICMP type in this column. */
-                sprintf(buffer, "%u", (unsigned int)rwRecGetIcmpType(rwrec));
+                len = asciiFormatUint(buffer, rwRecGetIcmpType(rwrec));
             } else {
                 /* Put the sPort value here, regardless of protocol */
-                sprintf(buffer, "%u", (unsigned int)rwRecGetSPort(rwrec));
+                len = asciiFormatUint(buffer, rwRecGetSPort(rwrec));
             }
             break;
 
           case RWREC_FIELD_DPORT:
             if (astream->as_legacy_icmp && rwRecIsICMP(rwrec)) {
                 /* Put the ICMP code in this column. */
-                sprintf(buffer, "%u", (unsigned int)rwRecGetIcmpCode(rwrec));
+                len = asciiFormatUint(buffer, rwRecGetIcmpCode(rwrec));
             } else {
                 /* Put the dPort value here, regardless of protocol */
-                sprintf(buffer, "%u", (unsigned int)rwRecGetDPort(rwrec));
+                len = asciiFormatUint(buffer, rwRecGetDPort(rwrec));
             }
             break;
 
@@ -989,8 +1410,9 @@ rwAsciiPrintRecExtra(
             if (!rwRecIsICMP(rwrec)) {
                 /* not ICMP; leave column blank */
                 buffer[0] = '\0';
+                len = 0;
             } else {
-                sprintf(buffer, "%u", (unsigned int)rwRecGetIcmpType(rwrec));
+                len = asciiFormatUint(buffer, rwRecGetIcmpType(rwrec));
             }
             break;
 
@@ -998,85 +1420,92 @@ rwAsciiPrintRecExtra(
             if (!rwRecIsICMP(rwrec)) {
                 /* not ICMP; leave column blank */
                 buffer[0] = '\0';
+                len = 0;
             } else {
-                sprintf(buffer, "%u", (unsigned int)rwRecGetIcmpCode(rwrec));
+                len = asciiFormatUint(buffer, rwRecGetIcmpCode(rwrec));
             }
             break;
 
           case RWREC_FIELD_PROTO:
-            sprintf(buffer, "%u", (unsigned int)rwRecGetProto(rwrec));
+            len = asciiFormatUint(buffer, rwRecGetProto(rwrec));
             break;
 
           case RWREC_FIELD_PKTS:
-            sprintf(buffer, ("%" PRIu32), rwRecGetPkts(rwrec));
+            len = asciiFormatUint(buffer, rwRecGetPkts(rwrec));
             break;
 
           case RWREC_FIELD_BYTES:
-            sprintf(buffer, ("%" PRIu32), rwRecGetBytes(rwrec));
+            len = asciiFormatUint(buffer, rwRecGetBytes(rwrec));
             break;
 
           case RWREC_FIELD_FLAGS:
             if (astream->as_integer_flags) {
-                sprintf(buffer, "%u", (unsigned int)rwRecGetFlags(rwrec));
+                len = asciiFormatUint(buffer, rwRecGetFlags(rwrec));
             } else {
                 skTCPFlagsString(rwRecGetFlags(rwrec), buffer, flags_flags);
+                len = strlen(buffer);
             }
             break;
 
           case RWREC_FIELD_INIT_FLAGS:
             if (astream->as_integer_flags) {
-                sprintf(buffer, "%u", (unsigned int)rwRecGetInitFlags(rwrec));
+                len = asciiFormatUint(buffer, rwRecGetInitFlags(rwrec));
             } else {
                 skTCPFlagsString(rwRecGetInitFlags(rwrec), buffer, flags_flags);
+                len = strlen(buffer);
             }
             break;
 
           case RWREC_FIELD_REST_FLAGS:
             if (astream->as_integer_flags) {
-                sprintf(buffer, "%u", (unsigned int)rwRecGetRestFlags(rwrec));
+                len = asciiFormatUint(buffer, rwRecGetRestFlags(rwrec));
             } else {
                 skTCPFlagsString(rwRecGetRestFlags(rwrec), buffer, flags_flags);
+                len = strlen(buffer);
             }
             break;
 
           case RWREC_FIELD_TCP_STATE:
             skTCPStateString(rwRecGetTcpState(rwrec), buffer, flags_flags);
+            len = strlen(buffer);
             break;
 
           case RWREC_FIELD_APPLICATION:
-            sprintf(buffer, "%u", (unsigned int)rwRecGetApplication(rwrec));
+            len = asciiFormatUint(buffer, rwRecGetApplication(rwrec));
             break;
 
           case RWREC_FIELD_ELAPSED:
             if (astream->as_timeflags & SKTIMESTAMP_NOMSEC) {
-                sprintf(buffer, ("%" PRIu32), rwRecGetElapsedSeconds(rwrec));
+                len = asciiFormatUint(buffer, rwRecGetElapsedSeconds(rwrec));
                 break;
             }
             /* else fallthough */
           case RWREC_FIELD_ELAPSED_MSEC:
-            idiv = imaxdiv(rwRecGetElapsed(rwrec), 1000);
-            sprintf(buffer, ("%" PRIdMAX ".%03" PRIdMAX),
-                    idiv.quot, idiv.rem);
+            len = asciiFormatMsec(buffer, rwRecGetElapsed(rwrec));
             break;
 
           case RWREC_FIELD_STIME:
-            sktimestamp_r(buffer, rwRecGetStartTime(rwrec),
-                          astream->as_timeflags);
+            len = asciiFormatTime(&astream->as_stime_cache, buffer,
+                                  rwRecGetStartTime(rwrec),
+                                  astream->as_timeflags);
             break;
 
           case RWREC_FIELD_STIME_MSEC:
-            sktimestamp_r(buffer, rwRecGetStartTime(rwrec),
-                          (astream->as_timeflags & ~SKTIMESTAMP_NOMSEC));
+            len = asciiFormatTime(&astream->as_stime_cache, buffer,
+                                  rwRecGetStartTime(rwrec),
+                                  (astream->as_timeflags & ~SKTIMESTAMP_NOMSEC));
             break;
 
           case RWREC_FIELD_ETIME:
-            sktimestamp_r(buffer, rwRecGetEndTime(rwrec),
-                          astream->as_timeflags);
+            len = asciiFormatTime(&astream->as_etime_cache, buffer,
+                                  rwRecGetEndTime(rwrec),
+                                  astream->as_timeflags);
             break;
 
           case RWREC_FIELD_ETIME_MSEC:
-            sktimestamp_r(buffer, rwRecGetEndTime(rwrec),
-                          (astream->as_timeflags & ~SKTIMESTAMP_NOMSEC));
+            len = asciiFormatTime(&astream->as_etime_cache, buffer,
+                                  rwRecGetEndTime(rwrec),
+                                  (astream->as_timeflags & ~SKTIMESTAMP_NOMSEC));
             break;
 
           case RWREC_FIELD_SID:
@@ -1084,61 +1513,66 @@ rwAsciiPrintRecExtra(
             if ( !astream->as_integer_sensors ) {
                 sksiteSensorGetName(buffer, sizeof(buffer),
                                     rwRecGetSensor(rwrec));
+                len = strlen(buffer);
             } else if (SK_INVALID_SENSOR == rwRecGetSensor(rwrec)) {
                 strcpy(buffer, "-1");
+                len = 2;
             } else {
-                sprintf(buffer, "%u", (unsigned int)rwRecGetSensor(rwrec));
+                len = asciiFormatUint(buffer, rwRecGetSensor(rwrec));
             }
             break;
 
           case RWREC_FIELD_INPUT:
-            sprintf(buffer, "%u", (unsigned int)rwRecGetInput(rwrec));
+            len = asciiFormatUint(buffer, rwRecGetInput(rwrec));
             break;
 
           case RWREC_FIELD_OUTPUT:
             /* output */
-            sprintf(buffer, "%u", (unsigned int)rwRecGetOutput(rwrec));
+            len = asciiFormatUint(buffer, rwRecGetOutput(rwrec));
             break;
 
           case RWREC_FIELD_FTYPE_CLASS:
             sksiteFlowtypeGetClass(buffer, sizeof(buffer),
                                    rwRecGetFlowType(rwrec));
+            len = strlen(buffer);
             break;
 
           case RWREC_FIELD_FTYPE_TYPE:
             sksiteFlowtypeGetType(buffer, sizeof(buffer),
                                   rwRecGetFlowType(rwrec));
+            len = strlen(buffer);
             break;
 
           case RWASCII_CB_FIELD_ID:
             /* invoke callback */
             field->af_cb_getvalue.gv(rwrec, buffer, sizeof(buffer),
                                      field->af_cb_data);
+            len = strlen(buffer);
             break;
 
           case RWASCII_CB_EXTRA_FIELD_ID:
             /* invoke callback */
             field->af_cb_getvalue.gv_extra(rwrec, buffer, sizeof(buffer),
                                            field->af_cb_data, extra);
+            len = strlen(buffer);
             break;
 
           default:
             skAbortBadCase(field->af_field_id);
         } /* switch */
 
-        if (astream->as_not_columnar) {
-            fprintf(astream->as_out_stream, "%s", buffer);
-        } else {
-            fprintf(astream->as_out_stream, "%*s",
-                    (int)field->af_width, buffer);
-        }
+        asciiBufferAppend(astream, buffer, len,
+                          (astream->as_not_columnar ? 0 : field->af_width));
     } /* for */
 
     if ( !astream->as_no_final_delim) {
-        fprintf(astream->as_out_stream, "%c", astream->as_delimiter);
+        asciiBufferAppendChar(astream, astream->as_delimiter);
     }
     if ( !astream->as_no_newline) {
-        fprintf(astream->as_out_stream, "\n");
+        asciiBufferAppendChar(astream, '\n');
+    } else {
+        /* the caller will append to the line */
+        asciiBufferFlush(astream);
     }
 
     return;
@@ -180,6 +180,23 @@ typedef int (*rwAsciiStreamGetValueExtra_t)(
     void        *extra);
 
 
+/**
+ *    A callback function that may be used in place of the output
+ *    handle.  When the callback is set by rwAsciiSetOutputCallback(),
+ *    the 'astream' passes the formatted text to this function instead
+ *    of writing it to a FILE.
+ *
+ *    'text' holds 'text_len' characters of output; it is not NUL
+ *    terminated.  The text may contain many rows or a portion of a
+ *    row.  'cb_data' is the 'callback_data' that was specified when
+ *    the callback was set.
+ */
+typedef void (*rwAsciiStreamWrite_t)(
+    const char         *text,
+    size_t              text_len,
+    void               *cb_data);
+
+
 /**
  *  Create a new output rwAsciiStream for printing rwRec records in a
  *  human readable form. Store the newly allocated rwAsciiStream_t in
@@ -212,7 +229,27 @@ rwAsciiStreamCreate(
     rwAsciiStream_t   **astream);
 
 /**
- *    Free all memory associated with the 'astream'.  It is the
+ *    Create a new rwAsciiStream that has the same fields and settings
+ *    as 'astream' and store it in the memory pointed to by 'clone'.
+ *    Return 0 on success or non-zero if allocation fails.
+ *
+ *    The fields of 'astream' are finalized (the default fields are
+ *    selected if none were specified) when this function is called.
+ *    The clone never prints column titles.
+ *
+ *    This function allows multiple threads to format records
+ *    concurrently, each using its own clone and an output callback
+ *    (rwAsciiSetOutputCallback()).  Any callback fields must be safe
+ *    to call from multiple threads.
+ */
+int
+rwAsciiStreamClone(
+    rwAsciiStream_t   **clone,
+    rwAsciiStream_t    *astream);
+
+/**
+ *    Free all memory associated with the 'astream'.  Any buffered
+ *    text is written to the underlying file pointer first; it is the
  *    caller's responsibility to fflush() the underlying file pointer.
  *    Does nothing if 'astream' or the location it points to is NULL.
  */
@@ -224,6 +261,12 @@ rwAsciiStreamDestroy(
  *    Print 'rwrec' in a human-readable form to 'astream'.  Will print
  *    the column titles when the 'astream' is configured to have
  *    titles and the titles have not yet been printed.
+ *
+ *    The text is collected in a buffer owned by 'astream' and written
+ *    to the output handle in large blocks.  A caller that writes to
+ *    the output handle directly must call rwAsciiFlush() first.  When
+ *    rwAsciiSetNoNewline() is in effect, the buffer is written after
+ *    every record so the caller may append to the line.
  */
 void
 rwAsciiPrintRec(
@@ -252,7 +295,8 @@ rwAsciiPrintTitles(
 
 /**
  *    Configure the 'astream' to print the output to 'fh'.  If 'fh' is
- *    NULL, stdout is used.
+ *    NULL, stdout is used.  Any text buffered for the previous handle
+ *    is written to it.
  */
 void
 rwAsciiSetOutputHandle(
@@ -260,6 +304,20 @@ rwAsciiSetOutputHandle(
     FILE               *fh);
 
 
+/**
+ *    Configure the 'astream' to pass its output to 'write_fn' instead
+ *    of writing it to the output handle.  'callback_data' is passed
+ *    unchanged to 'write_fn'.  If 'write_fn' is NULL, the output
+ *    handle is used.  Any text already buffered is sent to the
+ *    previous destination.
+ */
+void
+rwAsciiSetOutputCallback(
+    rwAsciiStream_t        *astream,
+    rwAsciiStreamWrite_t    write_fn,
+    void                   *callback_data);
+
+
 /**
  *    Configure the 'astream' to print the built-in fields listed in
  *    'field_list', which is an array contains 'field_count' values
@@ -472,7 +530,60 @@ rwAsciiGetFieldName(
     rwrec_printable_fields_t    field_id);
 
 /**
- *    Call flush() on the I/O object that 'astream' wraps.
+ *    The value that rwAsciiGetFieldInfo() puts into 'field_id' for a
+ *    field that was added by rwAsciiAppendCallbackField() or by
+ *    rwAsciiAppendCallbackFieldExtra().
+ */
+#define RWASCII_CALLBACK_FIELD  UINT32_MAX
+
+/**
+ *    Return the number of fields (columns) that 'astream' prints.
+ *    This finalizes the list of fields as if the titles were being
+ *    printed, so no more fields may be added to 'astream'.
+ */
+uint32_t
+rwAsciiGetFieldCount(
+    rwAsciiStream_t    *astream);
+
+/**
+ *    Get information about the field at 'position' in 'astream',
+ *    where 0 is the first field.  Set 'field_id' to the
+ *    rwrec_printable_fields_t value of the field, or to
+ *    RWASCII_CALLBACK_FIELD when the field's value is provided by a
+ *    callback.  When 'title_buf' is not NULL, fill it with the
+ *    field's title.  Return 0 on success, or -1 if 'position' is not
+ *    valid.
+ *
+ *    This allows a caller to produce output in another format from
+ *    the same list of fields.
+ */
+int
+rwAsciiGetFieldInfo(
+    rwAsciiStream_t    *astream,
+    uint32_t            position,
+    uint32_t           *field_id,
+    char               *title_buf,
+    size_t              title_buf_size);
+
+/**
+ *    Fill 'text_buf' with the value for 'rwrec' of the callback field
+ *    at 'position' in 'astream'.  'extra' is passed to callbacks that
+ *    were added by rwAsciiAppendCallbackFieldExtra() and ignored
+ *    otherwise.  Return 0 on success, or -1 if 'position' is not
+ *    valid or does not refer to a callback field.
+ */
+int
+rwAsciiGetCallbackFieldValue(
+    rwAsciiStream_t    *astream,
+    uint32_t            position,
+    const rwRec        *rwrec,
+    void               *extra,
+    char               *text_buf,
+    size_t              text_buf_size);
+
+/**
+ *    Write any buffered text to the I/O object that 'astream' wraps
+ *    and call flush() on it.
  */
 int
 rwAsciiFlush(
@@ -84,6 +84,9 @@ RCSIDENT("$SiLK: skcountry.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 /* the prefixmap used to look up country codes */
 static skPrefixMap_t *ccmap = NULL;
 
+/* the path of the file holding ccmap */
+static char ccmap_path[PATH_MAX];
+
 
 /* FUNCTION DEFINITIONS */
 
@@ -160,6 +163,14 @@ skCountryGetPrefixMap(
 }
 
 
+const char *
+skCountryGetMapPath(
+    void)
+{
+    return (ccmap ? ccmap_path : NULL);
+}
+
+
 int
 skCountryIsV6(
     void)
@@ -292,6 +303,8 @@ skCountrySetup(
             errmsg = "Map contains protocol/port pairs";
             break;
         }
+        strncpy(ccmap_path, filename, sizeof(ccmap_path));
+        ccmap_path[sizeof(ccmap_path)-1] = '\0';
         return 0;
       case SKPREFIXMAP_ERR_ARGS:
         errmsg = "Invalid arguments";
@@ -149,6 +149,15 @@ skCountryGetPrefixMap(
     void);
 
 
+/**
+ *    Return the path of the file that skCountrySetup() loaded, or
+ *    NULL if the Country Code map has not been loaded.
+ */
+const char *
+skCountryGetMapPath(
+    void);
+
+
 /**
  *    Return 1 if the Country Code map contains IPv6 addresses.
  *    Return 0 if the Country Code map contains only IPv4 addresses.
@@ -0,0 +1,747 @@
+/*
+** Copyright (C) 2001-2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  skdedupe.c
+**
+**    A sliding-window set of flow records used to remove duplicate
+**    records from input that is ordered by start time.
+**
+**    The records are stored in a ring buffer in the order they are
+**    added, and each record is given a sequence number that never
+**    repeats.  A record lives in the ring slot given by its sequence
+**    number modulo the ring's capacity.  As the latest start time
+**    advances, records are expired from the front of the ring by
+**    advancing the sequence number of the oldest live record.
+**
+**    A hash table maps the hash of a record's key to the sequence
+**    number of the newest record having that hash, and each record
+**    holds the sequence number of the next older record with the
+**    same hash.  Since the chains are ordered from newest to oldest,
+**    a walk down a chain stops at the first sequence number that is
+**    older than the oldest live record; expired records never need
+**    to be unlinked.  Sequence numbers begin at 1 so that 0 ends a
+**    chain.
+**
+**    When a start time tolerance is set, the start time in the hash
+**    is divided into buckets that are one more than the tolerance
+**    wide.  Records whose start times are within the tolerance are
+**    in the same or adjacent buckets, so a lookup checks three
+**    buckets.  Tolerances on the other fields remove those fields
+**    from the hash; they are checked when the candidate records are
+**    compared.
+**
+**    When the ring fills before any records expire, the ring and
+**    the hash table double in size.
+*/
+
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: skdedupe.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
+
+#include <silk/skdedupe.h>
+#include <silk/skipaddr.h>
+#include <silk/utils.h>
+
+
+/* LOCAL DEFINES AND TYPEDEFS */
+
+/*
+ *    Number of records the ring initially holds.  Must be a power of
+ *    2.
+ */
+#define DEDUPE_INITIAL_CAPACITY  (1 << 12)
+
+/*
+ *    Mix the 64-bit value 'v' into the hash 'h'.
+ */
+#define DEDUPE_MIX(h, v)                                        \
+    do {                                                        \
+        (h) = ((h) ^ (uint64_t)(v)) * UINT64_C(0x9e3779b97f4a7c15); \
+        (h) ^= (h) >> 32;                                       \
+    } while (0)
+
+/*
+ *    Return 0 from the current function if 'func' returns different
+ *    values for the records 'rec_a' and 'rec_b'.
+ */
+#define RETURN_IF_DIFFERENT(func, rec_a, rec_b)         \
+    if (func(rec_a) != func(rec_b)) {                   \
+        return 0;                                       \
+    }
+
+/*
+ *    Return 0 from the current function if the values 'func' returns
+ *    for the records 'rec_a' and 'rec_b' differ by more than 'delta'.
+ */
+#define RETURN_IF_BEYOND_DELTA(func, rec_a, rec_b, delta)               \
+    if (func(rec_a) < func(rec_b)) {                                    \
+        if ((uint64_t)(func(rec_b) - func(rec_a)) > (uint64_t)(delta)) { \
+            return 0;                                                   \
+        }                                                               \
+    } else if ((uint64_t)(func(rec_a) - func(rec_b)) > (uint64_t)(delta)) { \
+        return 0;                                                       \
+    }
+
+/*
+ *    A record in the ring.
+ */
+typedef struct dedupe_entry_st {
+    rwRec       rec;
+    /* hash of the record's key */
+    uint64_t    hash;
+    /* sequence number of the next older record in the same hash
+     * bucket, or 0 */
+    uint64_t    older;
+} dedupe_entry_t;
+
+struct sk_dedupe_st {
+    /* the records, indexed by sequence number modulo capacity */
+    dedupe_entry_t *ring;
+    /* the hash table; each holds the sequence number of the newest
+     * record in the bucket, or 0 */
+    uint64_t       *buckets;
+    /* size of both 'ring' and 'buckets'; a power of 2 */
+    uint64_t        capacity;
+    /* sequence number of the oldest live record */
+    uint64_t        oldest;
+    /* sequence number the next record added will have */
+    uint64_t        next;
+    /* number of duplicates found */
+    uint64_t        dup_count;
+    /* records whose start time plus this value is less than
+     * 'max_stime' are expired */
+    sktime_t        window;
+    /* the latest start time seen */
+    sktime_t        max_stime;
+    /* the fields to compare */
+    uint32_t        fields[RWREC_PRINTABLE_FIELD_COUNT];
+    uint32_t        field_count;
+    /* tolerances */
+    uint32_t        d_stime;
+    uint32_t        d_elapsed;
+    uint32_t        d_packets;
+    uint32_t        d_bytes;
+    /* whether the start time is one of the fields */
+    unsigned        use_stime   :1;
+    /* whether a record has been checked */
+    unsigned        started     :1;
+};
+
+
+/* LOCAL VARIABLE DEFINITIONS */
+
+/* the fields to compare when the caller does not provide any */
+static const uint32_t default_fields[] = {
+    RWREC_FIELD_SIP, RWREC_FIELD_DIP, RWREC_FIELD_SPORT, RWREC_FIELD_DPORT,
+    RWREC_FIELD_PROTO, RWREC_FIELD_PKTS, RWREC_FIELD_BYTES, RWREC_FIELD_FLAGS,
+    RWREC_FIELD_STIME, RWREC_FIELD_ELAPSED, RWREC_FIELD_SID,
+    RWREC_FIELD_INPUT, RWREC_FIELD_OUTPUT, RWREC_FIELD_NHIP,
+    RWREC_FIELD_INIT_FLAGS, RWREC_FIELD_REST_FLAGS, RWREC_FIELD_TCP_STATE,
+    RWREC_FIELD_APPLICATION, RWREC_FIELD_FTYPE_CLASS
+};
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  h = dedupeHashIP(h, ipaddr);
+ *
+ *    Mix the IP address 'ipaddr' into the hash 'h' and return the
+ *    result.
+ */
+static uint64_t
+dedupeHashIP(
+    uint64_t            h,
+    const skipaddr_t   *ipaddr)
+{
+#if SK_ENABLE_IPV6
+    if (skipaddrIsV6(ipaddr)) {
+        uint64_t ip6[2];
+
+        skipaddrGetV6(ipaddr, ip6);
+        DEDUPE_MIX(h, ip6[0]);
+        DEDUPE_MIX(h, ip6[1]);
+        return h;
+    }
+#endif
+    DEDUPE_MIX(h, skipaddrGetV4(ipaddr));
+    return h;
+}
+
+
+/*
+ *  equal = dedupeIPsEqual(ipa, ipb);
+ *
+ *    Return 1 if 'ipa' and 'ipb' are the same address of the same
+ *    family; 0 otherwise.
+ */
+static int
+dedupeIPsEqual(
+    const skipaddr_t   *ipa,
+    const skipaddr_t   *ipb)
+{
+#if SK_ENABLE_IPV6
+    if (skipaddrIsV6(ipa) != skipaddrIsV6(ipb)) {
+        return 0;
+    }
+    if (skipaddrIsV6(ipa)) {
+        uint8_t ipa_v6[16];
+        uint8_t ipb_v6[16];
+
+        skipaddrGetV6(ipa, ipa_v6);
+        skipaddrGetV6(ipb, ipb_v6);
+        return (0 == memcmp(ipa_v6, ipb_v6, sizeof(ipa_v6)));
+    }
+#endif  /* SK_ENABLE_IPV6 */
+    return (skipaddrGetV4(ipa) == skipaddrGetV4(ipb));
+}
+
+
+/*
+ *  h = dedupeHashRecord(dedupe, rwrec);
+ *
+ *    Compute the hash of the fields of 'rwrec' that 'dedupe' compares
+ *    exactly, excluding the start time.
+ */
+static uint64_t
+dedupeHashRecord(
+    const sk_dedupe_t  *dedupe,
+    const rwRec        *rwrec)
+{
+    skipaddr_t ipaddr;
+    uint64_t h = 0;
+    uint32_t i;
+
+    for (i = 0; i < dedupe->field_count; ++i) {
+        switch (dedupe->fields[i]) {
+          case RWREC_FIELD_SIP:
+            rwRecMemGetSIP(rwrec, &ipaddr);
+            h = dedupeHashIP(h, &ipaddr);
+            break;
+          case RWREC_FIELD_DIP:
+            rwRecMemGetDIP(rwrec, &ipaddr);
+            h = dedupeHashIP(h, &ipaddr);
+            break;
+          case RWREC_FIELD_NHIP:
+            rwRecMemGetNhIP(rwrec, &ipaddr);
+            h = dedupeHashIP(h, &ipaddr);
+            break;
+          case RWREC_FIELD_SPORT:
+            DEDUPE_MIX(h, rwRecGetSPort(rwrec));
+            break;
+          case RWREC_FIELD_DPORT:
+            DEDUPE_MIX(h, rwRecGetDPort(rwrec));
+            break;
+          case RWREC_FIELD_PROTO:
+            DEDUPE_MIX(h, rwRecGetProto(rwrec));
+            break;
+          case RWREC_FIELD_PKTS:
+            if (0 == dedupe->d_packets) {
+                DEDUPE_MIX(h, rwRecGetPkts(rwrec));
+            }
+            break;
+          case RWREC_FIELD_BYTES:
+            if (0 == dedupe->d_bytes) {
+                DEDUPE_MIX(h, rwRecGetBytes(rwrec));
+            }
+            break;
+          case RWREC_FIELD_FLAGS:
+            DEDUPE_MIX(h, rwRecGetFlags(rwrec));
+            break;
+          case RWREC_FIELD_STIME:
+          case RWREC_FIELD_STIME_MSEC:
+            /* handled by the caller */
+            break;
+          case RWREC_FIELD_ELAPSED:
+          case RWREC_FIELD_ELAPSED_MSEC:
+            if (0 == dedupe->d_elapsed) {
+                DEDUPE_MIX(h, rwRecGetElapsed(rwrec));
+            }
+            break;
+          case RWREC_FIELD_SID:
+            DEDUPE_MIX(h, rwRecGetSensor(rwrec));
+            break;
+          case RWREC_FIELD_INPUT:
+            DEDUPE_MIX(h, rwRecGetInput(rwrec));
+            break;
+          case RWREC_FIELD_OUTPUT:
+            DEDUPE_MIX(h, rwRecGetOutput(rwrec));
+            break;
+          case RWREC_FIELD_INIT_FLAGS:
+            DEDUPE_MIX(h, rwRecGetInitFlags(rwrec));
+            break;
+          case RWREC_FIELD_REST_FLAGS:
+            DEDUPE_MIX(h, rwRecGetRestFlags(rwrec));
+            break;
+          case RWREC_FIELD_TCP_STATE:
+            DEDUPE_MIX(h, rwRecGetTcpState(rwrec));
+            break;
+          case RWREC_FIELD_APPLICATION:
+            DEDUPE_MIX(h, rwRecGetApplication(rwrec));
+            break;
+          case RWREC_FIELD_FTYPE_CLASS:
+          case RWREC_FIELD_FTYPE_TYPE:
+            DEDUPE_MIX(h, rwRecGetFlowType(rwrec));
+            break;
+        }
+    }
+
+    return h;
+}
+
+
+/*
+ *  h = dedupeHashFinal(h, stime_key);
+ *
+ *    Mix the start time value 'stime_key' into the partial hash 'h'
+ *    and return the final hash.
+ */
+static uint64_t
+dedupeHashFinal(
+    uint64_t            h,
+    int64_t             stime_key)
+{
+    DEDUPE_MIX(h, stime_key);
+    h ^= h >> 33;
+    h *= UINT64_C(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    return h;
+}
+
+
+/*
+ *  match = dedupeRecordsMatch(dedupe, rec_a, rec_b);
+ *
+ *    Return 1 if 'rec_a' and 'rec_b' are duplicates given the fields
+ *    and tolerances of 'dedupe'; 0 otherwise.
+ */
+static int
+dedupeRecordsMatch(
+    const sk_dedupe_t  *dedupe,
+    const rwRec        *rec_a,
+    const rwRec        *rec_b)
+{
+    skipaddr_t ip_a;
+    skipaddr_t ip_b;
+    uint32_t i;
+
+    for (i = 0; i < dedupe->field_count; ++i) {
+        switch (dedupe->fields[i]) {
+          case RWREC_FIELD_SIP:
+            rwRecMemGetSIP(rec_a, &ip_a);
+            rwRecMemGetSIP(rec_b, &ip_b);
+            if (!dedupeIPsEqual(&ip_a, &ip_b)) {
+                return 0;
+            }
+            break;
+          case RWREC_FIELD_DIP:
+            rwRecMemGetDIP(rec_a, &ip_a);
+            rwRecMemGetDIP(rec_b, &ip_b);
+            if (!dedupeIPsEqual(&ip_a, &ip_b)) {
+                return 0;
+            }
+            break;
+          case RWREC_FIELD_NHIP:
+            rwRecMemGetNhIP(rec_a, &ip_a);
+            rwRecMemGetNhIP(rec_b, &ip_b);
+            if (!dedupeIPsEqual(&ip_a, &ip_b)) {
+                return 0;
+            }
+            break;
+          case RWREC_FIELD_SPORT:
+            RETURN_IF_DIFFERENT(rwRecGetSPort, rec_a, rec_b);
+            break;
+          case RWREC_FIELD_DPORT:
+            RETURN_IF_DIFFERENT(rwRecGetDPort, rec_a, rec_b);
+            break;
+          case RWREC_FIELD_PROTO:
+            RETURN_IF_DIFFERENT(rwRecGetProto, rec_a, rec_b);
+            break;
+          case RWREC_FIELD_PKTS:
+            RETURN_IF_BEYOND_DELTA(rwRecGetPkts, rec_a, rec_b,
+                                   dedupe->d_packets);
+            break;
+          case RWREC_FIELD_BYTES:
+            RETURN_IF_BEYOND_DELTA(rwRecGetBytes, rec_a, rec_b,
+                                   dedupe->d_bytes);
+            break;
+          case RWREC_FIELD_FLAGS:
+            RETURN_IF_DIFFERENT(rwRecGetFlags, rec_a, rec_b);
+            break;
+          case RWREC_FIELD_STIME:
+          case RWREC_FIELD_STIME_MSEC:
+            RETURN_IF_BEYOND_DELTA(rwRecGetStartTime, rec_a, rec_b,
+                                   dedupe->d_stime);
+            break;
+          case RWREC_FIELD_ELAPSED:
+          case RWREC_FIELD_ELAPSED_MSEC:
+            RETURN_IF_BEYOND_DELTA(rwRecGetElapsed, rec_a, rec_b,
+                                   dedupe->d_elapsed);
+            break;
+          case RWREC_FIELD_SID:
+            RETURN_IF_DIFFERENT(rwRecGetSensor, rec_a, rec_b);
+            break;
+          case RWREC_FIELD_INPUT:
+            RETURN_IF_DIFFERENT(rwRecGetInput, rec_a, rec_b);
+            break;
+          case RWREC_FIELD_OUTPUT:
+            RETURN_IF_DIFFERENT(rwRecGetOutput, rec_a, rec_b);
+            break;
+          case RWREC_FIELD_INIT_FLAGS:
+            RETURN_IF_DIFFERENT(rwRecGetInitFlags, rec_a, rec_b);
+            break;
+          case RWREC_FIELD_REST_FLAGS:
+            RETURN_IF_DIFFERENT(rwRecGetRestFlags, rec_a, rec_b);
+            break;
+          case RWREC_FIELD_TCP_STATE:
+            RETURN_IF_DIFFERENT(rwRecGetTcpState, rec_a, rec_b);
+            break;
+          case RWREC_FIELD_APPLICATION:
+            RETURN_IF_DIFFERENT(rwRecGetApplication, rec_a, rec_b);
+            break;
+          case RWREC_FIELD_FTYPE_CLASS:
+          case RWREC_FIELD_FTYPE_TYPE:
+            RETURN_IF_DIFFERENT(rwRecGetFlowType, rec_a, rec_b);
+            break;
+        }
+    }
+
+    return 1;
+}
+
+
+/*
+ *  found = dedupeLookup(dedupe, hash, rwrec);
+ *
+ *    Return 1 if a live record in the chain for 'hash' matches
+ *    'rwrec'; 0 otherwise.
+ */
+static int
+dedupeLookup(
+    const sk_dedupe_t  *dedupe,
+    uint64_t            hash,
+    const rwRec        *rwrec)
+{
+    const uint64_t mask = dedupe->capacity - 1;
+    const dedupe_entry_t *entry;
+    uint64_t seq;
+
+    for (seq = dedupe->buckets[hash & mask];
+         seq >= dedupe->oldest;
+         seq = entry->older)
+    {
+        entry = &dedupe->ring[seq & mask];
+        if (entry->hash == hash
+            && dedupeRecordsMatch(dedupe, &entry->rec, rwrec))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ *  status = dedupeGrow(dedupe);
+ *
+ *    Double the capacity of the ring and of the hash table of
+ *    'dedupe', and relink the live records.  Return 0 on success or
+ *    -1 on allocation failure, in which case 'dedupe' is unchanged.
+ */
+static int
+dedupeGrow(
+    sk_dedupe_t        *dedupe)
+{
+    const uint64_t old_mask = dedupe->capacity - 1;
+    dedupe_entry_t *ring;
+    dedupe_entry_t *entry;
+    uint64_t *buckets;
+    uint64_t capacity;
+    uint64_t mask;
+    uint64_t seq;
+
+    capacity = dedupe->capacity << 1;
+    if (capacity > SIZE_MAX / sizeof(dedupe_entry_t)) {
+        return -1;
+    }
+    ring = (dedupe_entry_t*)malloc(capacity * sizeof(dedupe_entry_t));
+    if (NULL == ring) {
+        return -1;
+    }
+    buckets = (uint64_t*)calloc(capacity, sizeof(uint64_t));
+    if (NULL == buckets) {
+        free(ring);
+        return -1;
+    }
+
+    /* visit the records from oldest to newest so each chain is
+     * rebuilt from newest to oldest */
+    mask = capacity - 1;
+    for (seq = dedupe->oldest; seq < dedupe->next; ++seq) {
+        entry = &ring[seq & mask];
+        memcpy(entry, &dedupe->ring[seq & old_mask], sizeof(dedupe_entry_t));
+        entry->older = buckets[entry->hash & mask];
+        buckets[entry->hash & mask] = seq;
+    }
+
+    free(dedupe->ring);
+    free(dedupe->buckets);
+    dedupe->ring = ring;
+    dedupe->buckets = buckets;
+    dedupe->capacity = capacity;
+    return 0;
+}
+
+
+int
+skDedupeCreate(
+    sk_dedupe_t       **dedupe,
+    const uint32_t     *fields,
+    uint32_t            field_count,
+    sktime_t            window)
+{
+    sk_dedupe_t *dd;
+    uint32_t i;
+
+    assert(dedupe);
+    if (window < 0) {
+        return -1;
+    }
+    if (0 == field_count) {
+        fields = default_fields;
+        field_count = sizeof(default_fields) / sizeof(default_fields[0]);
+    }
+    if (field_count > RWREC_PRINTABLE_FIELD_COUNT) {
+        return -1;
+    }
+
+    dd = (sk_dedupe_t*)calloc(1, sizeof(sk_dedupe_t));
+    if (NULL == dd) {
+        return -1;
+    }
+
+    for (i = 0; i < field_count; ++i) {
+        switch (fields[i]) {
+          case RWREC_FIELD_STIME:
+          case RWREC_FIELD_STIME_MSEC:
+            dd->use_stime = 1;
+            break;
+          case RWREC_FIELD_ETIME:
+          case RWREC_FIELD_ETIME_MSEC:
+          case RWREC_FIELD_ICMP_TYPE:
+          case RWREC_FIELD_ICMP_CODE:
+            free(dd);
+            return -1;
+          default:
+            if (fields[i] >= RWREC_PRINTABLE_FIELD_COUNT) {
+                free(dd);
+                return -1;
+            }
+            break;
+        }
+        dd->fields[i] = fields[i];
+    }
+    dd->field_count = field_count;
+    dd->window = window;
+    dd->capacity = DEDUPE_INITIAL_CAPACITY;
+    dd->oldest = 1;
+    dd->next = 1;
+
+    dd->ring = (dedupe_entry_t*)malloc(dd->capacity * sizeof(dedupe_entry_t));
+    dd->buckets = (uint64_t*)calloc(dd->capacity, sizeof(uint64_t));
+    if (NULL == dd->ring || NULL == dd->buckets) {
+        skDedupeDestroy(&dd);
+        return -1;
+    }
+
+    *dedupe = dd;
+    return 0;
+}
+
+
+void
+skDedupeDestroy(
+    sk_dedupe_t       **dedupe)
+{
+    if (NULL == dedupe || NULL == *dedupe) {
+        return;
+    }
+    free((*dedupe)->ring);
+    free((*dedupe)->buckets);
+    free(*dedupe);
+    *dedupe = NULL;
+}
+
+
+int
+skDedupeSetDelta(
+    sk_dedupe_t        *dedupe,
+    uint32_t            field,
+    uint32_t            delta)
+{
+    assert(dedupe);
+    assert(!dedupe->started);
+
+    switch (field) {
+      case RWREC_FIELD_STIME:
+      case RWREC_FIELD_STIME_MSEC:
+        dedupe->d_stime = delta;
+        break;
+      case RWREC_FIELD_ELAPSED:
+      case RWREC_FIELD_ELAPSED_MSEC:
+        dedupe->d_elapsed = delta;
+        break;
+      case RWREC_FIELD_PKTS:
+        dedupe->d_packets = delta;
+        break;
+      case RWREC_FIELD_BYTES:
+        dedupe->d_bytes = delta;
+        break;
+      default:
+        return -1;
+    }
+    return 0;
+}
+
+
+int
+skDedupeCheckRecord(
+    sk_dedupe_t        *dedupe,
+    const rwRec        *rwrec)
+{
+    const sktime_t stime = rwRecGetStartTime(rwrec);
+    const sktime_t horizon = dedupe->window + (sktime_t)dedupe->d_stime;
+    dedupe_entry_t *entry;
+    uint64_t partial;
+    uint64_t hash;
+    int64_t bucket;
+    uint64_t mask;
+
+    /* expire the records that have left the window */
+    if (!dedupe->started) {
+        dedupe->started = 1;
+        dedupe->max_stime = stime;
+    } else if (stime > dedupe->max_stime) {
+        dedupe->max_stime = stime;
+        mask = dedupe->capacity - 1;
+        while (dedupe->oldest < dedupe->next
+               && (rwRecGetStartTime(&dedupe->ring[dedupe->oldest & mask].rec)
+                   + horizon < stime))
+        {
+            ++dedupe->oldest;
+        }
+    }
+
+    partial = dedupeHashRecord(dedupe, rwrec);
+    if (!dedupe->use_stime) {
+        hash = dedupeHashFinal(partial, 0);
+        if (dedupeLookup(dedupe, hash, rwrec)) {
+            goto DUPLICATE;
+        }
+    } else if (0 == dedupe->d_stime) {
+        hash = dedupeHashFinal(partial, stime);
+        if (dedupeLookup(dedupe, hash, rwrec)) {
+            goto DUPLICATE;
+        }
+    } else {
+        bucket = stime / ((int64_t)dedupe->d_stime + 1);
+        if (dedupeLookup(dedupe, dedupeHashFinal(partial, bucket - 1), rwrec)
+            || dedupeLookup(dedupe, dedupeHashFinal(partial, bucket + 1),
+                            rwrec))
+        {
+            goto DUPLICATE;
+        }
+        hash = dedupeHashFinal(partial, bucket);
+        if (dedupeLookup(dedupe, hash, rwrec)) {
+            goto DUPLICATE;
+        }
+    }
+
+    /* add the record */
+    if (dedupe->next - dedupe->oldest == dedupe->capacity) {
+        if (dedupeGrow(dedupe)) {
+            return -1;
+        }
+    }
+    mask = dedupe->capacity - 1;
+    entry = &dedupe->ring[dedupe->next & mask];
+    RWREC_COPY(&entry->rec, rwrec);
+    entry->hash = hash;
+    entry->older = dedupe->buckets[hash & mask];
+    dedupe->buckets[hash & mask] = dedupe->next;
+    ++dedupe->next;
+    return 0;
+
+  DUPLICATE:
+    ++dedupe->dup_count;
+    return 1;
+}
+
+
+uint64_t
+skDedupeGetDuplicateCount(
+    const sk_dedupe_t  *dedupe)
+{
+    assert(dedupe);
+    return dedupe->dup_count;
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -0,0 +1,185 @@
+/*
+** Copyright (C) 2001-2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  skdedupe.h
+**
+**    Removal of duplicate flow records from a stream of records that
+**    is ordered by start time.
+**
+*/
+#ifndef _SKDEDUPE_H
+#define _SKDEDUPE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <silk/silk.h>
+
+RCSIDENTVAR(rcsID_SKDEDUPE_H, "$SiLK: skdedupe.h b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
+
+#include <silk/rwascii.h>
+#include <silk/rwrec.h>
+
+/**
+ *  @file
+ *
+ *    A sliding-window set of flow records used to remove duplicate
+ *    records in a single pass over input that is ordered (or nearly
+ *    ordered) by start time, such as the flows generated by two
+ *    exporters that see the same traffic.
+ *
+ *    The set remembers every unique record whose start time is within
+ *    the window of the latest start time it has seen.  A record that
+ *    matches a remembered record is reported as a duplicate.  Memory
+ *    use is proportional to the number of records in the window.
+ *
+ *    This file is part of libsilk.
+ */
+
+
+/**
+ *    The deduplication object.
+ */
+typedef struct sk_dedupe_st sk_dedupe_t;
+
+
+/**
+ *    Create a new deduplication object and store it in the location
+ *    referenced by 'dedupe'.
+ *
+ *    Two records are duplicates when the values of the 'field_count'
+ *    fields listed in 'fields' are identical, subject to the
+ *    tolerances set by skDedupeSetDelta().  The values in 'fields'
+ *    are from the rwrec_printable_fields_t enumeration.  When
+ *    'field_count' is 0, all fields on the rwRec are compared.
+ *
+ *    The object remembers records whose start time is no more than
+ *    'window' milliseconds before the latest start time seen.
+ *
+ *    Return 0 on success, or -1 on an allocation error or if 'fields'
+ *    contains an unsupported field.
+ */
+int
+skDedupeCreate(
+    sk_dedupe_t       **dedupe,
+    const uint32_t     *fields,
+    uint32_t            field_count,
+    sktime_t            window);
+
+
+/**
+ *    Destroy the deduplication object referenced by 'dedupe' and set
+ *    that location to NULL.  Do nothing if 'dedupe' or the location
+ *    it references is NULL.
+ */
+void
+skDedupeDestroy(
+    sk_dedupe_t       **dedupe);
+
+
+/**
+ *    Treat the values of 'field' on two records as identical when
+ *    they differ by no more than 'delta'.  'field' must be one of
+ *    RWREC_FIELD_STIME, RWREC_FIELD_ELAPSED, RWREC_FIELD_PKTS, or
+ *    RWREC_FIELD_BYTES; time values are in milliseconds.  A start
+ *    time tolerance widens the window by the same amount.
+ *
+ *    This function must be called before the first call to
+ *    skDedupeCheckRecord().  Return 0 on success or -1 if 'field' is
+ *    not supported.
+ */
+int
+skDedupeSetDelta(
+    sk_dedupe_t        *dedupe,
+    uint32_t            field,
+    uint32_t            delta);
+
+
+/**
+ *    Check whether 'rwrec' duplicates a record that 'dedupe'
+ *    remembers.
+ *
+ *    Return 1 if 'rwrec' is a duplicate.  Otherwise, add 'rwrec' to
+ *    'dedupe' and return 0.  Return -1 if memory to store 'rwrec'
+ *    cannot be allocated.
+ *
+ *    A record that arrives more than the window behind the latest
+ *    start time is compared only with the records that remain in the
+ *    window.
+ */
+int
+skDedupeCheckRecord(
+    sk_dedupe_t        *dedupe,
+    const rwRec        *rwrec);
+
+
+/**
+ *    Return the number of duplicate records 'dedupe' has found.
+ */
+uint64_t
+skDedupeGetDuplicateCount(
+    const sk_dedupe_t  *dedupe);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _SKDEDUPE_H */
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
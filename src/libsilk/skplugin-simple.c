@@ -144,6 +144,25 @@ add_to_free_list(
     skDLListPushTail(free_list, data);
 }
 
+/* Registers a field and gives it the batch rec-to-bin callback
+ * 'batch_fn'. */
+static skplugin_err_t
+reg_field_with_batch(
+    const char                 *name,
+    const skplugin_callbacks_t *callbacks,
+    skplugin_bin_batch_fn_t     batch_fn,
+    void                       *cbdata)
+{
+    skplugin_field_t *field;
+    skplugin_err_t err;
+
+    err = skpinRegField(&field, name, no_description, callbacks, cbdata);
+    if (SKPLUGIN_OK == err) {
+        err = skpinSetFieldRecToBinBatchFn(field, batch_fn);
+    }
+    return err;
+}
+
 /* Does the conversion of uint64_t to binary value */
 static void
 bin_from_int(
@@ -213,6 +232,29 @@ int_to_bin(
 }
 
 
+/* rec_to_bin_batch for integers */
+static skplugin_err_t
+int_to_bin_batch(
+    const rwRec           **rec_list,
+    uint8_t               **dest_list,
+    size_t                  count,
+    void                   *cbdata,
+    void           UNUSED(**extra))
+{
+    int_field_info_t *info = (int_field_info_t *)cbdata;
+    size_t i;
+
+    assert(info != NULL);
+    assert(extra == NULL);
+
+    for (i = 0; i < count; ++i) {
+        bin_from_int(info, dest_list[i], info->fn(rec_list[i]));
+    }
+
+    return SKPLUGIN_OK;
+}
+
+
 /* bin_to_text for integers */
 static skplugin_err_t
 int_bin_to_text(
@@ -305,7 +347,7 @@ skpinRegIntField(
     callbacks.rec_to_bin   = int_to_bin;
     callbacks.bin_to_text  = int_bin_to_text;
 
-    return skpinRegField(NULL, name, no_description, &callbacks, info);
+    return reg_field_with_batch(name, &callbacks, int_to_bin_batch, info);
 }
 
 
@@ -353,6 +395,31 @@ ipv4_to_bin(
 }
 
 
+/* rec_to_bin_batch for ipv4 */
+static skplugin_err_t
+ipv4_to_bin_batch(
+    const rwRec           **rec_list,
+    uint8_t               **dest_list,
+    size_t                  count,
+    void                   *cbdata,
+    void           UNUSED(**extra))
+{
+    uint32_t val;
+    ipv4_field_info_t *info = (ipv4_field_info_t *)cbdata;
+    size_t i;
+
+    assert(info != NULL);
+    assert(extra == NULL);
+
+    for (i = 0; i < count; ++i) {
+        val = htonl(info->fn(rec_list[i]));
+        memcpy(dest_list[i], &val, sizeof(val));
+    }
+
+    return SKPLUGIN_OK;
+}
+
+
 /* bin_to_text for ipv4 */
 static skplugin_err_t
 ipv4_bin_to_text(
@@ -400,7 +467,7 @@ skpinRegIPv4Field(
     callbacks.rec_to_bin   = ipv4_to_bin;
     callbacks.bin_to_text  = ipv4_bin_to_text;
 
-    return skpinRegField(NULL, name, no_description, &callbacks, info);
+    return reg_field_with_batch(name, &callbacks, ipv4_to_bin_batch, info);
 }
 
 
@@ -457,6 +524,38 @@ ip_to_bin(
 }
 
 
+/* rec_to_bin_batch for skipaddr_t */
+static skplugin_err_t
+ip_to_bin_batch(
+    const rwRec           **rec_list,
+    uint8_t               **dest_list,
+    size_t                  count,
+    void                   *cbdata,
+    void           UNUSED(**extra))
+{
+    skipaddr_t val;
+    ip_field_info_t *info = (ip_field_info_t *)cbdata;
+    size_t i;
+
+    assert(info != NULL);
+    assert(extra == NULL);
+
+    for (i = 0; i < count; ++i) {
+        info->fn(&val, rec_list[i]);
+#if SK_ENABLE_IPV6
+        skipaddrGetAsV6(&val, dest_list[i]);
+#else
+        {
+            uint32_t val32 = htonl(skipaddrGetV4(&val));
+            memcpy(dest_list[i], &val32, sizeof(val32));
+        }
+#endif
+    }
+
+    return SKPLUGIN_OK;
+}
+
+
 /* bin_to_text for skipaddr_t */
 static skplugin_err_t
 ip_bin_to_text(
@@ -519,7 +618,7 @@ skpinRegIPAddressField(
     callbacks.rec_to_bin   = ip_to_bin;
     callbacks.bin_to_text  = ip_bin_to_text;
 
-    return skpinRegField(NULL, name, no_description, &callbacks, info);
+    return reg_field_with_batch(name, &callbacks, ip_to_bin_batch, info);
 }
 
 
@@ -602,7 +701,8 @@ skpinRegTextField(
     callbacks.rec_to_bin   = int_to_bin;
     callbacks.bin_to_text  = text_bin_to_text;
 
-    return skpinRegField(NULL, name, no_description, &callbacks, text_info);
+    return reg_field_with_batch(name, &callbacks, int_to_bin_batch,
+                                text_info);
 }
 
 
@@ -723,7 +823,7 @@ skpinRegStringListField(
     callbacks.rec_to_bin   = int_to_bin;
     callbacks.bin_to_text  = list_bin_to_text;
 
-    return skpinRegField(NULL, name, no_description, &callbacks, info);
+    return reg_field_with_batch(name, &callbacks, int_to_bin_batch, info);
 }
 
 
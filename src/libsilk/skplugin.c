@@ -145,6 +145,7 @@ typedef struct skp_function_common_st {
 typedef struct skp_filter_st {
     skp_function_common_t       common; /* Must be first element */
     skplugin_filter_fn_t        filter;
+    skplugin_filter_batch_fn_t  filter_batch;
 } skp_filter_t;
 
 /* transformer identifier */
@@ -160,6 +161,7 @@ typedef struct skp_field_st {
     skp_function_common_t       common; /* Must be first element */
     skplugin_text_fn_t          rec_to_text;
     skplugin_bin_fn_t           rec_to_bin;
+    skplugin_bin_batch_fn_t     rec_to_bin_batch;
     skplugin_bin_fn_t           add_rec_to_bin;
     skplugin_bin_to_text_fn_t   bin_to_text;
     skplugin_bin_merge_fn_t     bin_merge;
@@ -1634,6 +1636,115 @@ skPluginRunFilterFn(
 }
 
 
+/* Returns 1 if every registered filter has a batch callback. */
+int
+skPluginFiltersSupportBatch(
+    void)
+{
+    sk_dll_iter_t iter;
+    skp_filter_t *filt;
+
+    assert(skp_initialized);
+    assert(!skp_in_plugin_init);
+    assert(skp_handle_type(SKPLUGIN_FN_FILTER));
+
+    skDLLAssignIter(&iter, skp_filter_list);
+    while (skDLLIterForward(&iter, (void **)&filt) == 0) {
+        if (NULL == filt->filter_batch) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/* Runs the filter functions over the 'count' records in 'rec_list',
+ * clearing the entry in 'pass_list' for each record that fails.
+ * Filters without a batch callback are run one record at a time. */
+skplugin_err_t
+skPluginRunFilterBatchFn(
+    const rwRec       **rec_list,
+    uint8_t            *pass_list,
+    size_t              count,
+    void              **extra)
+{
+    sk_dll_iter_t iter;
+    skp_filter_t *filt;
+    void **remap;
+    skplugin_err_t err;
+    size_t i;
+
+    assert(skp_initialized);
+    assert(!skp_in_plugin_init);
+    assert(skp_handle_type(SKPLUGIN_FN_FILTER));
+    assert(rec_list || 0 == count);
+    assert(pass_list || 0 == count);
+
+    skDLLAssignIter(&iter, skp_filter_list);
+
+    while (skDLLIterForward(&iter, (void **)&filt) == 0) {
+        if (filt->common.extra_remap == NULL) {
+            remap = extra;
+        } else {
+            remap = skp_remap(&filt->common, extra);
+        }
+
+        if (filt->filter_batch) {
+            err = filt->filter_batch(rec_list, pass_list, count,
+                                     filt->common.data, remap);
+        } else {
+            err = SKPLUGIN_OK;
+            for (i = 0; i < count && SKPLUGIN_OK == err; ++i) {
+                if (!pass_list[i]) {
+                    continue;
+                }
+                switch (filt->filter(rec_list[i], filt->common.data, remap)) {
+                  case SKPLUGIN_FILTER_PASS:
+                  case SKPLUGIN_FILTER_PASS_NOW:
+                    break;
+                  case SKPLUGIN_FILTER_FAIL:
+                  case SKPLUGIN_FILTER_IGNORE:
+                    pass_list[i] = 0;
+                    break;
+                  case SKPLUGIN_ERR_FATAL:
+                  case SKPLUGIN_ERR_VERSION_TOO_NEW:
+                  case SKPLUGIN_ERR_DID_NOT_REGISTER:
+                    skAppPrintErr("Fatal error running filter");
+                    exit(EXIT_FAILURE);
+                  case SKPLUGIN_ERR_SYSTEM:
+                    err = SKPLUGIN_ERR_SYSTEM;
+                    break;
+                  case SKPLUGIN_OK:
+                  case SKPLUGIN_ERR:
+                    err = SKPLUGIN_ERR;
+                    break;
+                }
+            }
+        }
+
+        if (remap != extra) {
+            free(remap);
+        }
+
+        switch (err) {
+          case SKPLUGIN_OK:
+            break;
+
+          case SKPLUGIN_ERR_FATAL:
+          case SKPLUGIN_ERR_VERSION_TOO_NEW:
+          case SKPLUGIN_ERR_DID_NOT_REGISTER:
+            skAppPrintErr("Fatal error running filter");
+            exit(EXIT_FAILURE);
+
+          default:
+            return err;
+        }
+    }
+
+    return SKPLUGIN_OK;
+}
+
+
 /* Runs the transform functions over the record 'rec'.  'extra'
  * fields are determined by the current set of arguments registed by
  * skPluginRegisterUsedAppExtraArgs(). */
@@ -1838,6 +1949,51 @@ skPluginFieldRunRecToBinFn(
 }
 
 
+/* Runs the bin function that converts from record to bin value for
+ * this field over a batch of records, using the field's batch
+ * callback when it has one. */
+skplugin_err_t
+skPluginFieldRunRecToBinBatchFn(
+    const skplugin_field_t     *field,
+    uint8_t                   **bin_list,
+    const rwRec               **rec_list,
+    size_t                      count,
+    void                      **extra)
+{
+    skplugin_err_t err = SKPLUGIN_OK;
+    void **remap;
+    size_t i;
+
+    assert(skp_initialized);
+    assert(!skp_in_plugin_init);
+    assert(field);
+    assert(bin_list || 0 == count);
+    assert(rec_list || 0 == count);
+
+    if (field->common.extra_remap == NULL) {
+        remap = extra;
+    } else {
+        remap = skp_remap(&field->common, extra);
+    }
+
+    if (field->rec_to_bin_batch) {
+        err = field->rec_to_bin_batch(rec_list, bin_list, count,
+                                      field->common.data, remap);
+    } else {
+        for (i = 0; i < count && SKPLUGIN_OK == err; ++i) {
+            err = field->rec_to_bin(rec_list[i], bin_list[i],
+                                    field->common.data, remap);
+        }
+    }
+
+    if (remap != extra) {
+        free(remap);
+    }
+
+    return err;
+}
+
+
 /* Runs the bin function that adds to the bin value for this field
  * based on a given record.  'extra' fields are determined by the
  * current set of arguments registed by
@@ -2069,6 +2225,38 @@ skpinSimpleCheckVersion(
 }
 
 
+/* Give a filter a batch callback. */
+skplugin_err_t
+skpinSetFilterBatchFn(
+    skplugin_filter_t              *filter,
+    skplugin_filter_batch_fn_t      filter_batch)
+{
+    assert(skp_in_plugin_init);
+
+    if (filter) {
+        filter->filter_batch = filter_batch;
+    }
+
+    return SKPLUGIN_OK;
+}
+
+
+/* Give a field a batch rec-to-bin callback. */
+skplugin_err_t
+skpinSetFieldRecToBinBatchFn(
+    skplugin_field_t               *field,
+    skplugin_bin_batch_fn_t         rec_to_bin_batch)
+{
+    assert(skp_in_plugin_init);
+
+    if (field && field->rec_to_bin) {
+        field->rec_to_bin_batch = rec_to_bin_batch;
+    }
+
+    return SKPLUGIN_OK;
+}
+
+
 /* Set field widths for a field.  Meant to be used within an init
  * function. */
 skplugin_err_t
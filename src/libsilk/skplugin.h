@@ -604,6 +604,37 @@ typedef skplugin_err_t (*skplugin_bin_fn_t)(
     void         *cbdata,
     void        **extra);
 
+/**
+ *    Batch filter callback.  Called with an array of 'count' pointers
+ *    to SiLK Flow records in 'rec_list' and a parallel array of
+ *    'count' pass/fail flags in 'pass_list'.  On entry, a non-zero
+ *    flag means the record is still a candidate; the function must
+ *    set the flag to zero for each candidate record that fails the
+ *    filter, and it may ignore records whose flag is already zero.
+ *    Should return SKPLUGIN_OK on success.  Registered by
+ *    skpinSetFilterBatchFn().  Called by skPluginRunFilterBatchFn().
+ */
+typedef skplugin_err_t (*skplugin_filter_batch_fn_t)(
+    const rwRec       **rec_list,
+    uint8_t            *pass_list,
+    size_t              count,
+    void               *cbdata,
+    void              **extra);
+
+/**
+ *    Batch record to binary callback.  Just like the record to binary
+ *    callback, but fills in each of the 'count' buffers in
+ *    'dest_list' given the corresponding record in 'rec_list'.
+ *    Registered by skpinSetFieldRecToBinBatchFn().  Called by
+ *    skPluginFieldRunRecToBinBatchFn().
+ */
+typedef skplugin_err_t (*skplugin_bin_batch_fn_t)(
+    const rwRec       **rec_list,
+    uint8_t           **dest_list,
+    size_t              count,
+    void               *cbdata,
+    void              **extra);
+
 /**
  *    Binary to text callback.  Just like record to text callback, but
  *    converts data from a binary value (as produced by a
@@ -794,6 +825,29 @@ skpinRegFilter(
     const skplugin_callbacks_t     *regdata,
     void                           *cbdata);
 
+/**
+ *    Give the filter 'filter', which was returned by
+ *    skpinRegFilter(), a batch callback.
+ *    'filter_batch(rec_list, pass_list, count, cbdata)' may be
+ *    provided in addition to the 'filter()' callback.  When every
+ *    registered filter provides it, the application may hand the
+ *    plug-ins an array of records at a time and receive an array of
+ *    pass/fail flags; see skplugin_filter_batch_fn_t.  The function
+ *    must produce the same result as calling 'filter()' on each
+ *    record, so a plug-in that may return SKPLUGIN_FILTER_PASS_NOW
+ *    or SKPLUGIN_FILTER_IGNORE must not provide it.
+ *
+ *    When 'filter' is NULL, as it is when the application does not
+ *    support filters, the function does nothing and returns
+ *    SKPLUGIN_OK.
+ *
+ *    Since version 1.1 of the plug-in interface.
+ */
+skplugin_err_t
+skpinSetFilterBatchFn(
+    skplugin_filter_t              *filter,
+    skplugin_filter_batch_fn_t      filter_batch);
+
 
 /**
  *    Register a new transformer function to apply to all records.
@@ -934,6 +988,25 @@ skpinRegField(
     const skplugin_callbacks_t     *regdata,
     void                           *cbdata);
 
+/**
+ *    Give the field 'field', which was returned by skpinRegField(), a
+ *    batch callback.  'rec_to_bin_batch(rec_list, dst_list, count,
+ *    cbdata)' is an optional companion to the field's 'rec_to_bin'
+ *    callback that fills 'count' binary values at once; each value
+ *    must be identical to the one 'rec_to_bin' would produce.  It is
+ *    ignored when the field has no 'rec_to_bin' callback.
+ *
+ *    When 'field' is NULL, as it is when the application does not
+ *    support fields, the function does nothing and returns
+ *    SKPLUGIN_OK.
+ *
+ *    Since version 1.1 of the plug-in interface.
+ */
+skplugin_err_t
+skpinSetFieldRecToBinBatchFn(
+    skplugin_field_t               *field,
+    skplugin_bin_batch_fn_t         rec_to_bin_batch);
+
 /**
  *    Set the textual and binary widths for a field.  Meant to be used
  *    within an 'init' function.
@@ -1047,7 +1120,7 @@ typedef enum {
 /**
  *   The current minor version of the skplugin interface.
  */
-#define SKPLUGIN_INTERFACE_VERSION_MINOR 0
+#define SKPLUGIN_INTERFACE_VERSION_MINOR 1
 
 /**
  *    Name of envar that if set will enable debugging output
@@ -1373,6 +1446,44 @@ skPluginRunFilterFn(
     const rwRec        *rec,
     void              **extra);
 
+/**
+ *    Returns 1 if every registered filter supports the batch filter
+ *    callback, 0 otherwise.  When this returns 0, the application
+ *    should use skPluginRunFilterFn() so that the
+ *    SKPLUGIN_FILTER_PASS_NOW and SKPLUGIN_FILTER_IGNORE results are
+ *    honored.
+ */
+int
+skPluginFiltersSupportBatch(
+    void);
+
+/**
+ *    Runs the filter functions over the 'count' SiLK Flow records in
+ *    'rec_list' for all registered filters, updating the parallel
+ *    array of flags in 'pass_list'.  On entry a non-zero flag marks
+ *    a record to be checked; on return the flag is zero for each
+ *    such record that failed any filter.  Returns SKPLUGIN_OK on
+ *    success or the error returned by a filter.
+ *
+ *    That is, calls the skplugin_filter_batch_fn_t function that
+ *    skpinSetFilterBatchFn() registered:
+ *    filter_batch(rec_list, pass_list, count, cbdata, extra)
+ *
+ *    for each filter in turn.  A filter that did not register a
+ *    batch callback is run one record at a time, in which case
+ *    SKPLUGIN_FILTER_PASS_NOW is treated as a pass and
+ *    SKPLUGIN_FILTER_IGNORE as a failure.
+ *
+ *    The 'extra' fields are determined as described in the EXTRA
+ *    ARGUMENTS section and apply to every record in the batch.
+ */
+skplugin_err_t
+skPluginRunFilterBatchFn(
+    const rwRec       **rec_list,
+    uint8_t            *pass_list,
+    size_t              count,
+    void              **extra);
+
 /**
  *    Runs the transform functions over the SiLK Flow record 'rec' for
  *    all registered tranformers.
@@ -1427,6 +1538,29 @@ skPluginFieldRunRecToBinFn(
     const rwRec                *rec,
     void                      **extra);
 
+/**
+ *    Runs the record-to-bin function for the specified field over
+ *    each of the 'count' SiLK Flow records in 'rec_list', putting the
+ *    value for 'rec_list[i]' into 'bin_list[i]'.
+ *
+ *    That is, calls the skplugin_bin_batch_fn_t function that
+ *    skpinSetFieldRecToBinBatchFn() registered:
+ *    rec_to_bin_batch(rec_list, bin_list, count, cbdata, extra)
+ *
+ *    when the field registered one, and calls
+ *    skplugin_callbacks_t.rec_to_bin() on each record otherwise.
+ *
+ *    The 'extra' fields are determined as described in the EXTRA
+ *    ARGUMENTS section and apply to every record in the batch.
+ */
+skplugin_err_t
+skPluginFieldRunRecToBinBatchFn(
+    const skplugin_field_t     *field,
+    uint8_t                   **bin_list,
+    const rwRec               **rec_list,
+    size_t                      count,
+    void                      **extra);
+
 /**
  *    Given a SiLK Flow record 'rec', runs the function that computes
  *    a binary value for this field and merges with (adds to) the
@@ -0,0 +1,746 @@
+/*
+** Copyright (C) 2001-2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  sktelemetry.c
+**
+**    Latency histograms and a periodically rewritten metrics file
+**    for long-running daemons.
+**
+**    While the report function runs, each sample is formatted into
+**    the text buffer of its metric family, and the families are
+**    written to the file in the order they were first reported.  The
+**    file is written under a temporary name in the same directory
+**    and renamed into place.
+*/
+
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: sktelemetry.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
+
+#include <silk/sklog.h>
+#include <silk/sktelemetry.h>
+#include <silk/sktimer.h>
+#include <silk/utils.h>
+
+
+/* LOCAL DEFINES AND TYPEDEFS */
+
+/*
+ *    The owner of a latency recorder publishes its private histograms
+ *    when this many microseconds have passed since the previous
+ *    publication...
+ */
+#define LATENCY_PUBLISH_USEC  1000000
+
+/*
+ *    ...or when it has made this many observations.
+ */
+#define LATENCY_PUBLISH_COUNT  (1 << 16)
+
+/*
+ *    The maximum length of the label string on one sample.
+ */
+#define TELEMETRY_LABEL_MAX  1024
+
+/*
+ *    Expand to the three string arguments that print the formatted
+ *    labels 'lbl' in braces, or print nothing when 'lbl' is empty.
+ */
+#define TELEMETRY_BRACES(lbl)                                   \
+    ((lbl)[0] ? "{" : ""), (lbl), ((lbl)[0] ? "}" : "")
+
+struct sk_telemetry_latency_st {
+    /* histograms updated by the owning thread */
+    sk_telemetry_hist_t    *local;
+    /* histograms read by other threads; protected by 'mutex' */
+    sk_telemetry_hist_t    *shared;
+    size_t                  stage_count;
+    /* number of observations in 'local' */
+    uint32_t                pending;
+    /* time of the previous publication */
+    uint64_t                published;
+    pthread_mutex_t         mutex;
+};
+
+/*
+ *    The samples reported for one metric.
+ */
+typedef struct telemetry_family_st {
+    char           *name;
+    char           *help;
+    const char     *type;
+    char           *text;
+    size_t          len;
+    size_t          cap;
+} telemetry_family_t;
+
+struct sk_telemetry_st {
+    char                       *path;
+    char                       *prefix;
+    sk_telemetry_report_fn_t    report_fn;
+    void                       *cb_data;
+    skTimer_t                   timer;
+    uint32_t                    interval;
+    /* the families being reported by the current write */
+    telemetry_family_t         *family;
+    size_t                      family_count;
+    size_t                      family_cap;
+    /* whether the previous write failed; used to limit logging */
+    unsigned                    failed      :1;
+    /* whether an allocation failed during the current report */
+    unsigned                    oom         :1;
+    /* serializes calls to skTelemetryWrite() */
+    pthread_mutex_t             mutex;
+};
+
+
+/* FUNCTION DEFINITIONS */
+
+uint64_t
+skTelemetryNow(
+    void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+
+int
+skTelemetryLatencyCreate(
+    sk_telemetry_latency_t    **latency,
+    size_t                      stage_count)
+{
+    sk_telemetry_latency_t *lat;
+
+    assert(latency);
+
+    lat = (sk_telemetry_latency_t*)calloc(1, sizeof(sk_telemetry_latency_t));
+    if (NULL == lat) {
+        return -1;
+    }
+    lat->local = ((sk_telemetry_hist_t*)
+                  calloc(stage_count, sizeof(sk_telemetry_hist_t)));
+    lat->shared = ((sk_telemetry_hist_t*)
+                   calloc(stage_count, sizeof(sk_telemetry_hist_t)));
+    if (NULL == lat->local || NULL == lat->shared) {
+        free(lat->local);
+        free(lat->shared);
+        free(lat);
+        return -1;
+    }
+    lat->stage_count = stage_count;
+    lat->published = skTelemetryNow();
+    pthread_mutex_init(&lat->mutex, NULL);
+
+    *latency = lat;
+    return 0;
+}
+
+
+void
+skTelemetryLatencyDestroy(
+    sk_telemetry_latency_t    **latency)
+{
+    if (NULL == latency || NULL == *latency) {
+        return;
+    }
+    pthread_mutex_destroy(&(*latency)->mutex);
+    free((*latency)->local);
+    free((*latency)->shared);
+    free(*latency);
+    *latency = NULL;
+}
+
+
+void
+skTelemetryLatencyAdd(
+    sk_telemetry_latency_t     *latency,
+    size_t                      stage,
+    uint64_t                    start,
+    uint64_t                    end)
+{
+    sk_telemetry_hist_t *hist;
+    uint64_t elapsed;
+    unsigned int i;
+
+    if (stage >= latency->stage_count) {
+        return;
+    }
+    /* treat a clock that stepped backward as no time */
+    elapsed = ((end > start) ? (end - start) : 0);
+
+    for (i = 0;
+         (i < SK_TELEMETRY_HIST_BUCKETS - 1
+          && (UINT64_C(1) << i) < elapsed);
+         ++i)
+        ;                       /* empty */
+
+    hist = &latency->local[stage];
+    ++hist->bucket[i];
+    ++hist->count;
+    hist->sum += elapsed;
+
+    ++latency->pending;
+    if (latency->pending >= LATENCY_PUBLISH_COUNT
+        || end >= latency->published + LATENCY_PUBLISH_USEC)
+    {
+        latency->published = end;
+        skTelemetryLatencyFlush(latency);
+    }
+}
+
+
+void
+skTelemetryLatencyFlush(
+    sk_telemetry_latency_t     *latency)
+{
+    size_t s;
+    unsigned int i;
+
+    if (0 == latency->pending) {
+        return;
+    }
+    pthread_mutex_lock(&latency->mutex);
+    for (s = 0; s < latency->stage_count; ++s) {
+        for (i = 0; i < SK_TELEMETRY_HIST_BUCKETS; ++i) {
+            latency->shared[s].bucket[i] += latency->local[s].bucket[i];
+        }
+        latency->shared[s].count += latency->local[s].count;
+        latency->shared[s].sum += latency->local[s].sum;
+    }
+    pthread_mutex_unlock(&latency->mutex);
+
+    memset(latency->local, 0,
+           latency->stage_count * sizeof(sk_telemetry_hist_t));
+    latency->pending = 0;
+}
+
+
+int
+skTelemetryLatencyGet(
+    sk_telemetry_latency_t     *latency,
+    size_t                      stage,
+    sk_telemetry_hist_t        *hist)
+{
+    if (stage >= latency->stage_count) {
+        return -1;
+    }
+    pthread_mutex_lock(&latency->mutex);
+    memcpy(hist, &latency->shared[stage], sizeof(sk_telemetry_hist_t));
+    pthread_mutex_unlock(&latency->mutex);
+    return 0;
+}
+
+
+/*
+ *    Callback for the timer.
+ */
+static skTimerRepeat_t
+telemetryTimerCallback(
+    void               *v_telemetry)
+{
+    skTelemetryWrite((sk_telemetry_t*)v_telemetry);
+    return SK_TIMER_REPEAT;
+}
+
+
+int
+skTelemetryCreate(
+    sk_telemetry_t            **telemetry,
+    const char                 *path,
+    uint32_t                    interval,
+    const char                 *prefix,
+    sk_telemetry_report_fn_t    report_fn,
+    void                       *cb_data)
+{
+    sk_telemetry_t *t;
+
+    assert(telemetry);
+    assert(path);
+    assert(prefix);
+    assert(report_fn);
+
+    t = (sk_telemetry_t*)calloc(1, sizeof(sk_telemetry_t));
+    if (NULL == t) {
+        return -1;
+    }
+    t->path = strdup(path);
+    t->prefix = strdup(prefix);
+    if (NULL == t->path || NULL == t->prefix) {
+        free(t->path);
+        free(t->prefix);
+        free(t);
+        return -1;
+    }
+    t->interval = ((interval > 0) ? interval : 1);
+    t->report_fn = report_fn;
+    t->cb_data = cb_data;
+    pthread_mutex_init(&t->mutex, NULL);
+
+    *telemetry = t;
+    return 0;
+}
+
+
+int
+skTelemetryStart(
+    sk_telemetry_t             *telemetry)
+{
+    if (telemetry->timer) {
+        return 0;
+    }
+    if (skTimerCreate(&telemetry->timer, telemetry->interval,
+                      &telemetryTimerCallback, (void*)telemetry))
+    {
+        telemetry->timer = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+
+void
+skTelemetryDestroy(
+    sk_telemetry_t            **telemetry)
+{
+    sk_telemetry_t *t;
+
+    if (NULL == telemetry || NULL == *telemetry) {
+        return;
+    }
+    t = *telemetry;
+    *telemetry = NULL;
+
+    if (t->timer) {
+        skTimerDestroy(t->timer);
+    }
+    pthread_mutex_destroy(&t->mutex);
+    free(t->family);
+    free(t->path);
+    free(t->prefix);
+    free(t);
+}
+
+
+/*
+ *    Free the families that were reported during the previous write.
+ */
+static void
+telemetryClearFamilies(
+    sk_telemetry_t     *t)
+{
+    size_t i;
+
+    for (i = 0; i < t->family_count; ++i) {
+        free(t->family[i].name);
+        free(t->family[i].help);
+        free(t->family[i].text);
+    }
+    t->family_count = 0;
+    t->oom = 0;
+}
+
+
+/*
+ *    Return the family named 'name' on 't', creating it with 'help'
+ *    and 'type' if necessary.  Return NULL on an allocation error.
+ */
+static telemetry_family_t *
+telemetryGetFamily(
+    sk_telemetry_t     *t,
+    const char         *name,
+    const char         *help,
+    const char         *type)
+{
+    telemetry_family_t *fam;
+    size_t i;
+
+    for (i = 0; i < t->family_count; ++i) {
+        if (0 == strcmp(name, t->family[i].name)) {
+            return &t->family[i];
+        }
+    }
+    if (t->family_count == t->family_cap) {
+        size_t cap = ((t->family_cap) ? (2 * t->family_cap) : 32);
+        fam = ((telemetry_family_t*)
+               realloc(t->family, cap * sizeof(telemetry_family_t)));
+        if (NULL == fam) {
+            return NULL;
+        }
+        t->family = fam;
+        t->family_cap = cap;
+    }
+    fam = &t->family[t->family_count];
+    memset(fam, 0, sizeof(telemetry_family_t));
+    fam->name = strdup(name);
+    fam->help = strdup(help ? help : "");
+    if (NULL == fam->name || NULL == fam->help) {
+        free(fam->name);
+        free(fam->help);
+        return NULL;
+    }
+    fam->type = type;
+    ++t->family_count;
+    return fam;
+}
+
+
+/*
+ *    Append the printf-style 'fmt' to the text of 'fam'.  Return 0 on
+ *    success or -1 on an allocation error.
+ */
+static int
+telemetryAppend(
+    telemetry_family_t *fam,
+    const char         *fmt,
+    ...)
+    SK_CHECK_PRINTF(2, 3);
+
+static int
+telemetryAppend(
+    telemetry_family_t *fam,
+    const char         *fmt,
+    ...)
+{
+    va_list args;
+    char *text;
+    size_t cap;
+    int rv;
+
+    for (;;) {
+        va_start(args, fmt);
+        rv = vsnprintf(fam->text + fam->len, fam->cap - fam->len, fmt, args);
+        va_end(args);
+        if (rv < 0) {
+            return -1;
+        }
+        if ((size_t)rv < fam->cap - fam->len) {
+            fam->len += rv;
+            return 0;
+        }
+        cap = ((fam->cap) ? (2 * fam->cap) : 1024);
+        while (cap - fam->len <= (size_t)rv) {
+            cap *= 2;
+        }
+        text = (char*)realloc(fam->text, cap);
+        if (NULL == text) {
+            return -1;
+        }
+        fam->text = text;
+        fam->cap = cap;
+    }
+}
+
+
+/*
+ *    Format the NULL-terminated list of label name/value pairs in
+ *    'args' into 'buf', which has size 'bufsize'.  Labels are
+ *    separated by commas; 'buf' is empty when there are no labels.
+ *    Label values are escaped as the file format requires.
+ */
+static void
+telemetryFormatLabels(
+    char               *buf,
+    size_t              bufsize,
+    va_list             args)
+{
+    const char *label;
+    const char *value;
+    size_t len = 0;
+
+    buf[0] = '\0';
+    while ((label = va_arg(args, const char *)) != NULL) {
+        value = va_arg(args, const char *);
+        if (NULL == value) {
+            value = "";
+        }
+        /* leave room for the worst case of an escaped character,
+         * the closing quote, the comma, and the NUL */
+        if (len + strlen(label) + 3 + 5 > bufsize) {
+            break;
+        }
+        len += snprintf(buf + len, bufsize - len, "%s%s=\"",
+                        (len ? "," : ""), label);
+        for ( ; *value && len + 5 < bufsize; ++value) {
+            switch (*value) {
+              case '\\':
+              case '"':
+                buf[len++] = '\\';
+                buf[len++] = *value;
+                break;
+              case '\n':
+                buf[len++] = '\\';
+                buf[len++] = 'n';
+                break;
+              default:
+                buf[len++] = *value;
+                break;
+            }
+        }
+        buf[len++] = '"';
+        buf[len] = '\0';
+    }
+}
+
+
+void
+skTelemetryAddCounter(
+    sk_telemetry_t             *telemetry,
+    const char                 *name,
+    const char                 *help,
+    uint64_t                    value,
+    ...)
+{
+    telemetry_family_t *fam;
+    char labels[TELEMETRY_LABEL_MAX];
+    va_list args;
+
+    fam = telemetryGetFamily(telemetry, name, help, "counter");
+    if (NULL == fam) {
+        telemetry->oom = 1;
+        return;
+    }
+    va_start(args, value);
+    telemetryFormatLabels(labels, sizeof(labels), args);
+    va_end(args);
+
+    if (telemetryAppend(fam, "%s_%s%s%s%s %" PRIu64 "\n",
+                        telemetry->prefix, name, TELEMETRY_BRACES(labels),
+                        value))
+    {
+        telemetry->oom = 1;
+    }
+}
+
+
+void
+skTelemetryAddGauge(
+    sk_telemetry_t             *telemetry,
+    const char                 *name,
+    const char                 *help,
+    double                      value,
+    ...)
+{
+    telemetry_family_t *fam;
+    char labels[TELEMETRY_LABEL_MAX];
+    va_list args;
+
+    fam = telemetryGetFamily(telemetry, name, help, "gauge");
+    if (NULL == fam) {
+        telemetry->oom = 1;
+        return;
+    }
+    va_start(args, value);
+    telemetryFormatLabels(labels, sizeof(labels), args);
+    va_end(args);
+
+    if (telemetryAppend(fam, "%s_%s%s%s%s %.17g\n",
+                        telemetry->prefix, name, TELEMETRY_BRACES(labels),
+                        value))
+    {
+        telemetry->oom = 1;
+    }
+}
+
+
+void
+skTelemetryAddHistogram(
+    sk_telemetry_t             *telemetry,
+    const char                 *name,
+    const char                 *help,
+    const sk_telemetry_hist_t  *hist,
+    ...)
+{
+    telemetry_family_t *fam;
+    char labels[TELEMETRY_LABEL_MAX];
+    uint64_t cumulative = 0;
+    va_list args;
+    unsigned int i;
+    int rv = 0;
+
+    fam = telemetryGetFamily(telemetry, name, help, "histogram");
+    if (NULL == fam) {
+        telemetry->oom = 1;
+        return;
+    }
+    va_start(args, hist);
+    telemetryFormatLabels(labels, sizeof(labels), args);
+    va_end(args);
+
+    for (i = 0; i < SK_TELEMETRY_HIST_BUCKETS - 1 && 0 == rv; ++i) {
+        cumulative += hist->bucket[i];
+        rv = telemetryAppend(fam,
+                             "%s_%s_bucket{%s%sle=\"%.6f\"} %" PRIu64 "\n",
+                             telemetry->prefix, name,
+                             labels, (labels[0] ? "," : ""),
+                             (double)(UINT64_C(1) << i) / 1e6, cumulative);
+    }
+    if (0 == rv) {
+        rv = telemetryAppend(fam,
+                             ("%s_%s_bucket{%s%sle=\"+Inf\"} %" PRIu64 "\n"
+                              "%s_%s_sum%s%s%s %.6f\n"
+                              "%s_%s_count%s%s%s %" PRIu64 "\n"),
+                             telemetry->prefix, name,
+                             labels, (labels[0] ? "," : ""), hist->count,
+                             telemetry->prefix, name, TELEMETRY_BRACES(labels),
+                             (double)hist->sum / 1e6,
+                             telemetry->prefix, name, TELEMETRY_BRACES(labels),
+                             hist->count);
+    }
+    if (rv) {
+        telemetry->oom = 1;
+    }
+}
+
+
+int
+skTelemetryWrite(
+    sk_telemetry_t             *telemetry)
+{
+    char tmp_path[PATH_MAX];
+    telemetry_family_t *fam;
+    struct timeval now;
+    const char *errmsg = NULL;
+    FILE *fp = NULL;
+    size_t i;
+    int fd;
+    int rv = -1;
+
+    pthread_mutex_lock(&telemetry->mutex);
+
+    telemetryClearFamilies(telemetry);
+    telemetry->report_fn(telemetry, telemetry->cb_data);
+    gettimeofday(&now, NULL);
+    skTelemetryAddGauge(telemetry, "telemetry_write_timestamp_seconds",
+                        "Time when this file was written",
+                        (double)now.tv_sec + (double)now.tv_usec / 1e6,
+                        NULL);
+    if (telemetry->oom) {
+        errmsg = "Out of memory";
+        goto END;
+    }
+
+    if ((size_t)snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX",
+                         telemetry->path)
+        >= sizeof(tmp_path))
+    {
+        errmsg = "Path name is too long";
+        goto END;
+    }
+    fd = mkstemp(tmp_path);
+    if (-1 == fd) {
+        errmsg = strerror(errno);
+        goto END;
+    }
+    fp = fdopen(fd, "w");
+    if (NULL == fp) {
+        errmsg = strerror(errno);
+        close(fd);
+        unlink(tmp_path);
+        goto END;
+    }
+    for (i = 0; i < telemetry->family_count; ++i) {
+        fam = &telemetry->family[i];
+        fprintf(fp, "# HELP %s_%s %s\n# TYPE %s_%s %s\n",
+                telemetry->prefix, fam->name, fam->help,
+                telemetry->prefix, fam->name, fam->type);
+        if (fam->len) {
+            fwrite(fam->text, 1, fam->len, fp);
+        }
+    }
+    fflush(fp);
+    if (ferror(fp) || fchmod(fileno(fp), 0644)) {
+        errmsg = strerror(errno);
+        fclose(fp);
+        unlink(tmp_path);
+        goto END;
+    }
+    if (fclose(fp)) {
+        errmsg = strerror(errno);
+        unlink(tmp_path);
+        goto END;
+    }
+    if (rename(tmp_path, telemetry->path)) {
+        errmsg = strerror(errno);
+        unlink(tmp_path);
+        goto END;
+    }
+    rv = 0;
+
+  END:
+    telemetryClearFamilies(telemetry);
+    if (errmsg) {
+        if (!telemetry->failed) {
+            WARNINGMSG("Cannot write telemetry file '%s': %s",
+                       telemetry->path, errmsg);
+        }
+        telemetry->failed = 1;
+    } else if (telemetry->failed) {
+        NOTICEMSG("Writing telemetry file '%s' again", telemetry->path);
+        telemetry->failed = 0;
+    }
+    pthread_mutex_unlock(&telemetry->mutex);
+    return rv;
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
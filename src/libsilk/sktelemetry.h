@@ -0,0 +1,299 @@
+/*
+** Copyright (C) 2001-2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  sktelemetry.h
+**
+**    Latency histograms and a periodically rewritten metrics file
+**    for long-running daemons.
+**
+*/
+#ifndef _SKTELEMETRY_H
+#define _SKTELEMETRY_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <silk/silk.h>
+
+RCSIDENTVAR(rcsID_SKTELEMETRY_H, "$SiLK: sktelemetry.h b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
+
+/**
+ *  @file
+ *
+ *    Support for exporting performance metrics from a daemon.
+ *
+ *    A telemetry object owns a file that is rewritten every few
+ *    seconds by a timer thread.  On each write, the object invokes a
+ *    callback that reports the current values of the application's
+ *    counters, gauges, and histograms.  The file uses the Prometheus
+ *    text exposition format, and a new file is renamed over the old
+ *    one so that a reader always sees a complete report.
+ *
+ *    A latency recorder holds a histogram for each of several
+ *    processing stages.  A recorder is meant to be updated by a
+ *    single thread.  That thread updates a private copy of the
+ *    histograms without locking and publishes them to a shared copy
+ *    about once a second, so the cost of the mutex is spread over
+ *    many observations.
+ *
+ *    This file is part of libsilk-thrd.
+ */
+
+
+/**
+ *    The number of buckets in a latency histogram.  Bucket 'i' for
+ *    'i' less than SK_TELEMETRY_HIST_BUCKETS-1 counts observations
+ *    whose value in microseconds is no larger than 2^i.  The final
+ *    bucket counts larger observations.
+ */
+#define SK_TELEMETRY_HIST_BUCKETS  23
+
+/**
+ *    A histogram of latencies.
+ */
+typedef struct sk_telemetry_hist_st {
+    /* number of observations in each bucket; not cumulative */
+    uint64_t    bucket[SK_TELEMETRY_HIST_BUCKETS];
+    /* total number of observations */
+    uint64_t    count;
+    /* sum of the observations, in microseconds */
+    uint64_t    sum;
+} sk_telemetry_hist_t;
+
+
+/**
+ *    Return the current time as microseconds since the UNIX epoch.
+ */
+uint64_t
+skTelemetryNow(
+    void);
+
+
+/**
+ *    The latency recorder.
+ */
+typedef struct sk_telemetry_latency_st sk_telemetry_latency_t;
+
+/**
+ *    Create a latency recorder that holds a histogram for each of
+ *    'stage_count' stages and store it in the location referenced
+ *    by 'latency'.  Return 0 on success or -1 on an allocation error.
+ */
+int
+skTelemetryLatencyCreate(
+    sk_telemetry_latency_t    **latency,
+    size_t                      stage_count);
+
+/**
+ *    Destroy the latency recorder referenced by 'latency' and set
+ *    that location to NULL.  Do nothing if 'latency' or the location
+ *    it references is NULL.
+ */
+void
+skTelemetryLatencyDestroy(
+    sk_telemetry_latency_t    **latency);
+
+/**
+ *    Record that 'stage' of 'latency' began at 'start' and ended at
+ *    'end', where both are values returned by skTelemetryNow().  Do
+ *    nothing if 'stage' is out of range.
+ *
+ *    Only one thread may call this function on a recorder.  The
+ *    observation becomes visible to skTelemetryLatencyGet() the next
+ *    time the private histograms are published.
+ */
+void
+skTelemetryLatencyAdd(
+    sk_telemetry_latency_t     *latency,
+    size_t                      stage,
+    uint64_t                    start,
+    uint64_t                    end);
+
+/**
+ *    Publish the observations the owning thread has made on
+ *    'latency'.  Only the thread that calls skTelemetryLatencyAdd()
+ *    may call this function.
+ */
+void
+skTelemetryLatencyFlush(
+    sk_telemetry_latency_t     *latency);
+
+/**
+ *    Fill 'hist' with the published histogram for 'stage' of
+ *    'latency'.  This function may be called from any thread.
+ *    Return 0 on success or -1 if 'stage' is out of range.
+ */
+int
+skTelemetryLatencyGet(
+    sk_telemetry_latency_t     *latency,
+    size_t                      stage,
+    sk_telemetry_hist_t        *hist);
+
+
+/**
+ *    The telemetry object.
+ */
+typedef struct sk_telemetry_st sk_telemetry_t;
+
+/**
+ *    The signature of the function that reports the metrics.  The
+ *    function is called from the thread that writes the file and
+ *    should call skTelemetryAddCounter(), skTelemetryAddGauge(), and
+ *    skTelemetryAddHistogram() on 'telemetry'.  'cb_data' is the
+ *    value given to skTelemetryCreate().
+ */
+typedef void (*sk_telemetry_report_fn_t)(
+    sk_telemetry_t     *telemetry,
+    void               *cb_data);
+
+/**
+ *    Create a telemetry object that writes its metrics to 'path' and
+ *    store it in the location referenced by 'telemetry'.  The file
+ *    is written every 'interval' seconds once skTelemetryStart() is
+ *    called.  Each metric name is prefixed by 'prefix' and an
+ *    underscore.  'report_fn' is called with 'cb_data' to report the
+ *    metrics.
+ *
+ *    Return 0 on success or -1 on an allocation error.
+ */
+int
+skTelemetryCreate(
+    sk_telemetry_t            **telemetry,
+    const char                 *path,
+    uint32_t                    interval,
+    const char                 *prefix,
+    sk_telemetry_report_fn_t    report_fn,
+    void                       *cb_data);
+
+/**
+ *    Start the thread that periodically writes the file for
+ *    'telemetry'.  Return 0 on success or -1 on failure.
+ */
+int
+skTelemetryStart(
+    sk_telemetry_t             *telemetry);
+
+/**
+ *    Write the file for 'telemetry' immediately.  Return 0 on
+ *    success or -1 if the file cannot be written, in which case an
+ *    error is logged.
+ */
+int
+skTelemetryWrite(
+    sk_telemetry_t             *telemetry);
+
+/**
+ *    Stop the timer thread, if any, destroy the object referenced by
+ *    'telemetry', and set that location to NULL.  The file is not
+ *    removed.  Do nothing if 'telemetry' or the location it
+ *    references is NULL.
+ */
+void
+skTelemetryDestroy(
+    sk_telemetry_t            **telemetry);
+
+/**
+ *    Report the value of a counter; that is, a value that only
+ *    increases.  'name' is the name of the metric without the prefix
+ *    and 'help' describes it.  The remaining arguments are pairs of
+ *    label names and label values, terminated by NULL.
+ *
+ *    These functions may only be called from the report function.
+ *    Samples for the same metric are grouped together in the file,
+ *    and the 'help' from the first sample is used.
+ */
+void
+skTelemetryAddCounter(
+    sk_telemetry_t             *telemetry,
+    const char                 *name,
+    const char                 *help,
+    uint64_t                    value,
+    ...);
+
+/**
+ *    Report the value of a gauge; that is, a value that may go up or
+ *    down.  The arguments are as for skTelemetryAddCounter().
+ */
+void
+skTelemetryAddGauge(
+    sk_telemetry_t             *telemetry,
+    const char                 *name,
+    const char                 *help,
+    double                      value,
+    ...);
+
+/**
+ *    Report the latency histogram 'hist'.  The bucket boundaries and
+ *    the sum are written in seconds.  The remaining arguments are as
+ *    for skTelemetryAddCounter().
+ */
+void
+skTelemetryAddHistogram(
+    sk_telemetry_t             *telemetry,
+    const char                 *name,
+    const char                 *help,
+    const sk_telemetry_hist_t  *hist,
+    ...);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _SKTELEMETRY_H */
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -127,6 +127,42 @@ static const uint8_t log_table_256[256] =
 /* FUNCTION DEFINITIONS */
 
 
+/*
+ *  ipv4ToDottedQuad(outbuf, ipv4, zero_pad);
+ *
+ *    Helper for skipaddrString().  Write 'ipv4' into 'outbuf' in
+ *    dotted-quad form and NUL-terminate it.  When 'zero_pad' is
+ *    non-zero, each octet is padded to three digits.
+ *
+ *    This is done by hand since snprintf() dominates the cost of
+ *    printing IPv4 addresses in bulk (rwcut, rwuniq, rwstats).
+ */
+static void
+ipv4ToDottedQuad(
+    char               *outbuf,
+    uint32_t            ipv4,
+    int                 zero_pad)
+{
+    char *cp = outbuf;
+    unsigned int octet;
+    int shift;
+
+    for (shift = 24; shift >= 0; shift -= 8) {
+        octet = (ipv4 >> shift) & 0xFF;
+        if (zero_pad || octet >= 100) {
+            *cp++ = '0' + octet / 100;
+            *cp++ = '0' + (octet / 10) % 10;
+        } else if (octet >= 10) {
+            *cp++ = '0' + octet / 10;
+        }
+        *cp++ = '0' + octet % 10;
+        *cp++ = '.';
+    }
+    /* replace the final '.' */
+    *(cp - 1) = '\0';
+}
+
+
 /* compute the log2() of 'value' */
 int
 skIntegerLog2(
@@ -823,20 +859,12 @@ skipaddrString(
         switch ((skipaddr_flags_t)ip_flags) {
           case SKIPADDR_CANONICAL:
             /* Convert integer 0 to string "0.0.0.0" */
-            snprintf(outbuf, SK_NUM2DOT_STRLEN, "%lu.%lu.%lu.%lu",
-                     (unsigned long)((ip->ip_ip.ipu_ipv4 >> 24) & 0xFF),
-                     (unsigned long)((ip->ip_ip.ipu_ipv4 >> 16) & 0xFF),
-                     (unsigned long)((ip->ip_ip.ipu_ipv4 >> 8) & 0xFF),
-                     (unsigned long)(ip->ip_ip.ipu_ipv4 & 0xFF));
+            ipv4ToDottedQuad(outbuf, ip->ip_ip.ipu_ipv4, 0);
             break;
 
           case SKIPADDR_ZEROPAD:
             /* Convert integer 0 to string "000.000.000.000" */
-            snprintf(outbuf, SK_NUM2DOT_STRLEN, "%03lu.%03lu.%03lu.%03lu",
-                     (unsigned long)((ip->ip_ip.ipu_ipv4 >> 24) & 0xFF),
-                     (unsigned long)((ip->ip_ip.ipu_ipv4 >> 16) & 0xFF),
-                     (unsigned long)((ip->ip_ip.ipu_ipv4 >> 8) & 0xFF),
-                     (unsigned long)(ip->ip_ip.ipu_ipv4 & 0xFF));
+            ipv4ToDottedQuad(outbuf, ip->ip_ip.ipu_ipv4, 1);
             break;
 
           case SKIPADDR_DECIMAL:
@@ -705,6 +705,44 @@ skOptionsGetShortestPrefix(
 }
 
 
+/* find the option that 'switch_name' selects */
+const struct option *
+skOptionsLookupName(
+    const char         *switch_name,
+    size_t              name_len)
+{
+    const struct option *found = NULL;
+    struct option *opt;
+    int ambiguous = 0;
+    size_t i;
+
+    if (switch_name == NULL || name_len == 0) {
+        return NULL;
+    }
+
+    for (i = 0, opt = app_options->o_options;
+         i < app_options->o_count;
+         ++i, ++opt)
+    {
+        if (0 != strncmp(switch_name, opt->name, name_len)) {
+            continue;
+        }
+        if ('\0' == opt->name[name_len]) {
+            /* an exact match is never ambiguous */
+            return opt;
+        }
+        if (NULL == found) {
+            found = opt;
+        } else if (found->val != opt->val) {
+            /* the abbreviation matches multiple options */
+            ambiguous = 1;
+        }
+    }
+
+    return (ambiguous ? NULL : found);
+}
+
+
 /* check whether dirname exists */
 int
 skOptionsCheckDirectory(
@@ -1324,6 +1324,20 @@ skOptionsGetShortestPrefix(
     const char         *option_name);
 
 
+/**
+ *    Return the registered option that the command line switch
+ *    'switch_name' selects, where 'name_len' is the length of the
+ *    switch's name, not including any leading hyphens or the '='
+ *    and argument that may follow the name.  The name may be an
+ *    abbreviation.  Return NULL if no option matches the name or if
+ *    the abbreviation is ambiguous.
+ */
+const struct option *
+skOptionsLookupName(
+    const char         *switch_name,
+    size_t              name_len);
+
+
 /**
  *    Registers a --temp-directory switch for the application.  Use
  *    skOptionsTempDirUsage() to print the usage for this switch.
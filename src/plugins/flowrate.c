@@ -80,7 +80,7 @@ RCSIDENT("$SiLK: flowrate.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 
 /* Plugin protocol version */
 #define PLUGIN_API_VERSION_MAJOR 1
-#define PLUGIN_API_VERSION_MINOR 0
+#define PLUGIN_API_VERSION_MINOR 1
 
 /* identifiers for the fields */
 #define PCKTS_PER_SEC_KEY       1
@@ -235,6 +235,13 @@ filter(
     const rwRec        *rwrec,
     void               *cbdata,
     void              **extra);
+static skplugin_err_t
+filterBatch(
+    const rwRec       **rec_list,
+    uint8_t            *pass_list,
+    size_t              count,
+    void               *cbdata,
+    void              **extra);
 
 
 /* FUNCTION DEFINITIONS */
@@ -257,6 +264,8 @@ optionsHandler(
     skplugin_callbacks_t regdata;
     plugin_options_enum opt_index = *((plugin_options_enum*)cbdata);
     static int filter_registered = 0;
+    skplugin_filter_t *filt;
+    skplugin_err_t err;
     int rv;
 
     switch (opt_index) {
@@ -307,7 +316,11 @@ optionsHandler(
 
     memset(&regdata, 0, sizeof(regdata));
     regdata.filter = filter;
-    return skpinRegFilter(NULL, &regdata, NULL);
+    err = skpinRegFilter(&filt, &regdata, NULL);
+    if (SKPLUGIN_OK != err) {
+        return err;
+    }
+    return skpinSetFilterBatchFn(filt, filterBatch);
 
   PARSE_ERROR:
     skAppPrintErr("Invalid %s '%s': %s",
@@ -433,6 +446,74 @@ filter(
 }
 
 
+/*
+ *  status = filterBatch(rec_list, pass_list, count, data, NULL);
+ *
+ *    The batch version of filter().  Rather than checking every
+ *    active range for one record before moving to the next, check
+ *    one range across all candidate records in 'rec_list', clearing
+ *    the flag in 'pass_list' for the records that fail it.
+ */
+static skplugin_err_t
+filterBatch(
+    const rwRec           **rec_list,
+    uint8_t                *pass_list,
+    size_t                  count,
+    void            UNUSED(*cbdata),
+    void           UNUSED(**extra))
+{
+    uint64_t payload;
+    double rate;
+    size_t i;
+
+    /* filter by payload-bytes */
+    if (payload_bytes.is_active) {
+        for (i = 0; i < count; ++i) {
+            if (pass_list[i]) {
+                payload = getPayload(rec_list[i]);
+                pass_list[i] = !(payload < payload_bytes.min
+                                  || payload > payload_bytes.max);
+            }
+        }
+    }
+
+    /* filter by payload-rate */
+    if (payload_rate.is_active) {
+        for (i = 0; i < count; ++i) {
+            if (pass_list[i]) {
+                rate = PAYLOAD_RATE_DOUBLE(rec_list[i]);
+                pass_list[i] = !(rate < payload_rate.min
+                                  || rate > payload_rate.max);
+            }
+        }
+    }
+
+    /* filter by packets-per-second */
+    if (pckt_rate.is_active) {
+        for (i = 0; i < count; ++i) {
+            if (pass_list[i]) {
+                rate = PCKT_RATE_DOUBLE(rec_list[i]);
+                pass_list[i] = !(rate < pckt_rate.min
+                                  || rate > pckt_rate.max);
+            }
+        }
+    }
+
+    /* filter by bytes-per-second */
+    if (byte_rate.is_active) {
+        for (i = 0; i < count; ++i) {
+            if (pass_list[i]) {
+                rate = BYTE_RATE_DOUBLE(rec_list[i]);
+                pass_list[i] = !(rate < byte_rate.min
+                                  || rate > byte_rate.max);
+            }
+        }
+    }
+
+    return SKPLUGIN_OK;
+}
+
+
 /*
  *  status = recToTextKey(rwrec, text_val, text_len, &index, NULL);
  *
@@ -520,6 +601,57 @@ recToBinKey(
 }
 
 
+/*
+ *  status = recToBinKeyBatch(rec_list, bin_list, count, &index, NULL);
+ *
+ *    The batch version of recToBinKey(): compute the flow-rate ratio
+ *    specified by '*index' for each of the 'count' records in
+ *    'rec_list' and write its binary representation into the
+ *    corresponding buffer in 'bin_list'.
+ */
+static skplugin_err_t
+recToBinKeyBatch(
+    const rwRec           **rec_list,
+    uint8_t               **bin_list,
+    size_t                  count,
+    void                   *idx,
+    void           UNUSED(**extra))
+{
+    uint64_t val_u64;
+    size_t i;
+
+#define REC_TO_BIN_LOOP(rtbl_expr)                                  \
+    for (i = 0; i < count; ++i) {                                   \
+        val_u64 = hton64(rtbl_expr);                                \
+        memcpy(bin_list[i], &val_u64, RATE_BINARY_SIZE_KEY);        \
+    }
+
+    switch (*((unsigned int*)(idx))) {
+      case PAYLOAD_BYTES_KEY:
+        REC_TO_BIN_LOOP(getPayload(rec_list[i]));
+        break;
+      case PAYLOAD_RATE_KEY:
+        REC_TO_BIN_LOOP(DOUBLE_TO_UINT64(PAYLOAD_RATE_DOUBLE(rec_list[i])));
+        break;
+      case PCKTS_PER_SEC_KEY:
+        REC_TO_BIN_LOOP(DOUBLE_TO_UINT64(PCKT_RATE_DOUBLE(rec_list[i])));
+        break;
+      case BYTES_PER_SEC_KEY:
+        REC_TO_BIN_LOOP(DOUBLE_TO_UINT64(BYTE_RATE_DOUBLE(rec_list[i])));
+        break;
+      case BYTES_PER_PACKET_KEY:
+        REC_TO_BIN_LOOP(
+            DOUBLE_TO_UINT64(BYTES_PER_PACKET_DOUBLE(rec_list[i])));
+        break;
+      default:
+        return SKPLUGIN_ERR_FATAL;
+    }
+#undef REC_TO_BIN_LOOP
+
+    return SKPLUGIN_OK;
+}
+
+
 /*
  *  status = binToTextKey(bin_val, text_val, text_len, &index);
  *
@@ -782,6 +914,10 @@ SKPLUGIN_SETUP_FN(
         if (SKPLUGIN_OK != rv) {
             return rv;
         }
+        rv = skpinSetFieldRecToBinBatchFn(field, recToBinKeyBatch);
+        if (SKPLUGIN_OK != rv) {
+            return rv;
+        }
     }
 
     /* register the aggregate value fields to use for rwuniq and
@@ -6530,6 +6530,775 @@ silkPyRawRWRec_new(
 }
 
 
+/*
+ *************************************************************************
+ *   RWRec Batch
+ *************************************************************************
+ */
+
+/* default number of records SilkFile.read_batch() reads */
+#define BATCH_DEFAULT_COUNT  65536
+
+/* size of the widest column, which holds IPv6 addresses; the size of
+ * every column of a batch of 'count' records must fit in a size_t */
+#define BATCH_MAX_COLUMN_SIZE  16
+
+/* the columns of an RWRecBatch */
+typedef enum {
+    BATCH_COL_SIP,
+    BATCH_COL_DIP,
+    BATCH_COL_NHIP,
+    BATCH_COL_SPORT,
+    BATCH_COL_DPORT,
+    BATCH_COL_PROTOCOL,
+    BATCH_COL_PACKETS,
+    BATCH_COL_BYTES,
+    BATCH_COL_STIME,
+    BATCH_COL_DURATION,
+    BATCH_COL_SENSOR_ID,
+    BATCH_COL_CLASSTYPE_ID,
+    BATCH_COL_INPUT,
+    BATCH_COL_OUTPUT,
+    BATCH_COL_APPLICATION,
+    BATCH_COL_TCPFLAGS,
+    BATCH_COL_INITIAL_TCPFLAGS,
+    BATCH_COL_SESSION_TCPFLAGS,
+    BATCH_COL_COUNT
+} batch_column_id_t;
+
+/* the kind of data in an RWRecColumn */
+typedef enum {
+    BATCH_KIND_NUMBER,
+    BATCH_KIND_IPV4,
+    BATCH_KIND_IPV6
+} batch_column_kind_t;
+
+/* the name, the size of each value, and the buffer-protocol format
+ * of each column; the order matches batch_column_id_t.  The size of
+ * the IP columns changes to 16 when the batch holds IPv6 records. */
+static const struct batch_column_info_st {
+    const char         *name;
+    const char         *format;
+    Py_ssize_t          size;
+} batch_column_info[] = {
+    {"sip",                 "I",    sizeof(uint32_t)},
+    {"dip",                 "I",    sizeof(uint32_t)},
+    {"nhip",                "I",    sizeof(uint32_t)},
+    {"sport",               "H",    sizeof(uint16_t)},
+    {"dport",               "H",    sizeof(uint16_t)},
+    {"protocol",            "B",    sizeof(uint8_t)},
+    {"packets",             "I",    sizeof(uint32_t)},
+    {"bytes",               "I",    sizeof(uint32_t)},
+    {"stime",               "q",    sizeof(int64_t)},
+    {"duration",            "I",    sizeof(uint32_t)},
+    {"sensor_id",           "H",    sizeof(uint16_t)},
+    {"classtype_id",        "B",    sizeof(uint8_t)},
+    {"input",               "H",    sizeof(uint16_t)},
+    {"output",              "H",    sizeof(uint16_t)},
+    {"application",         "H",    sizeof(uint16_t)},
+    {"tcpflags",            "B",    sizeof(uint8_t)},
+    {"initial_tcpflags",    "B",    sizeof(uint8_t)},
+    {"session_tcpflags",    "B",    sizeof(uint8_t)}
+};
+
+typedef struct silkPyRWRecBatch_st {
+    PyObject_HEAD
+    uint8_t    *column[BATCH_COL_COUNT];
+    Py_ssize_t  count;
+    Py_ssize_t  capacity;
+    unsigned    is_ipv6 : 1;
+} silkPyRWRecBatch;
+
+typedef struct silkPyRWRecColumn_st {
+    PyObject_HEAD
+    /* the batch that owns 'data', or NULL when the column owns it */
+    PyObject           *owner;
+    uint8_t            *data;
+    const char         *format;
+    Py_ssize_t          itemsize;
+    Py_ssize_t          shape[2];
+    Py_ssize_t          strides[2];
+    int                 ndim;
+    batch_column_kind_t kind;
+} silkPyRWRecColumn;
+
+/* function prototypes */
+static PyObject *
+silkPyRWRecBatch_column_get(
+    silkPyRWRecBatch   *obj,
+    void               *closure);
+static void
+silkPyRWRecBatch_dealloc(
+    silkPyRWRecBatch   *obj);
+static PyObject *
+silkPyRWRecBatch_is_ipv6_get(
+    silkPyRWRecBatch       *obj,
+    void            UNUSED(*closure));
+static Py_ssize_t
+silkPyRWRecBatch_len(
+    silkPyRWRecBatch   *obj);
+static PyObject *
+silkPyRWRecBatch_columns(
+    silkPyRWRecBatch   *obj);
+static void
+silkPyRWRecColumn_dealloc(
+    silkPyRWRecColumn  *obj);
+#if PY_VERSION_HEX >= 0x02060000
+static int
+silkPyRWRecColumn_getbuffer(
+    silkPyRWRecColumn  *obj,
+    Py_buffer          *view,
+    int                 flags);
+#endif
+static PyObject *
+silkPyRWRecColumn_isin(
+    silkPyRWRecColumn  *self,
+    PyObject           *set);
+static Py_ssize_t
+silkPyRWRecColumn_len(
+    silkPyRWRecColumn  *obj);
+static PyObject *
+silkPyRWRecColumn_pmap_values(
+    silkPyRWRecColumn  *self,
+    PyObject           *pmap);
+
+/* define docs and methods */
+#define silkPyRWRecBatch_doc                                            \
+    "Columns of the fields of a block of records read by"               \
+    " SilkFile.read_batch()"
+
+#define silkPyRWRecColumn_doc                                           \
+    "A column of an RWRecBatch; supports the buffer protocol"
+
+static PyMethodDef silkPyRWRecBatch_methods[] = {
+    {"__reduce__", (PyCFunction)reduce_error, METH_NOARGS, ""},
+    {"columns", (PyCFunction)silkPyRWRecBatch_columns, METH_NOARGS,
+     "Return a dictionary that maps the column names to the columns"},
+    {NULL, NULL, 0, NULL}       /* Sentinel */
+};
+
+static PyGetSetDef silkPyRWRecBatch_getseters[] = {
+    {"sip", (getter)silkPyRWRecBatch_column_get, NULL,
+     "source IPs", (void*)&batch_column_info[BATCH_COL_SIP]},
+    {"dip", (getter)silkPyRWRecBatch_column_get, NULL,
+     "destination IPs", (void*)&batch_column_info[BATCH_COL_DIP]},
+    {"nhip", (getter)silkPyRWRecBatch_column_get, NULL,
+     "router next hop IPs", (void*)&batch_column_info[BATCH_COL_NHIP]},
+    {"sport", (getter)silkPyRWRecBatch_column_get, NULL,
+     "source ports", (void*)&batch_column_info[BATCH_COL_SPORT]},
+    {"dport", (getter)silkPyRWRecBatch_column_get, NULL,
+     "destination ports", (void*)&batch_column_info[BATCH_COL_DPORT]},
+    {"protocol", (getter)silkPyRWRecBatch_column_get, NULL,
+     "IP protocols", (void*)&batch_column_info[BATCH_COL_PROTOCOL]},
+    {"packets", (getter)silkPyRWRecBatch_column_get, NULL,
+     "counts of packets", (void*)&batch_column_info[BATCH_COL_PACKETS]},
+    {"bytes", (getter)silkPyRWRecBatch_column_get, NULL,
+     "counts of bytes", (void*)&batch_column_info[BATCH_COL_BYTES]},
+    {"stime", (getter)silkPyRWRecBatch_column_get, NULL,
+     "start times as milliseconds since the epoch",
+     (void*)&batch_column_info[BATCH_COL_STIME]},
+    {"duration", (getter)silkPyRWRecBatch_column_get, NULL,
+     "durations in milliseconds",
+     (void*)&batch_column_info[BATCH_COL_DURATION]},
+    {"sensor_id", (getter)silkPyRWRecBatch_column_get, NULL,
+     "sensor IDs", (void*)&batch_column_info[BATCH_COL_SENSOR_ID]},
+    {"classtype_id", (getter)silkPyRWRecBatch_column_get, NULL,
+     "class/type IDs", (void*)&batch_column_info[BATCH_COL_CLASSTYPE_ID]},
+    {"input", (getter)silkPyRWRecBatch_column_get, NULL,
+     "router incoming SNMP interfaces",
+     (void*)&batch_column_info[BATCH_COL_INPUT]},
+    {"output", (getter)silkPyRWRecBatch_column_get, NULL,
+     "router outgoing SNMP interfaces",
+     (void*)&batch_column_info[BATCH_COL_OUTPUT]},
+    {"application", (getter)silkPyRWRecBatch_column_get, NULL,
+     "applications", (void*)&batch_column_info[BATCH_COL_APPLICATION]},
+    {"tcpflags", (getter)silkPyRWRecBatch_column_get, NULL,
+     "OR of all tcpflags", (void*)&batch_column_info[BATCH_COL_TCPFLAGS]},
+    {"initial_tcpflags", (getter)silkPyRWRecBatch_column_get, NULL,
+     "TCP flags of first packet",
+     (void*)&batch_column_info[BATCH_COL_INITIAL_TCPFLAGS]},
+    {"session_tcpflags", (getter)silkPyRWRecBatch_column_get, NULL,
+     "TCP flags on non-initial packets",
+     (void*)&batch_column_info[BATCH_COL_SESSION_TCPFLAGS]},
+    {"is_ipv6", (getter)silkPyRWRecBatch_is_ipv6_get, NULL,
+     "whether the IP columns hold 16-byte IPv6 addresses", NULL},
+    {NULL, NULL, NULL, NULL, NULL}    /* Sentinel */
+};
+
+static PySequenceMethods silkPyRWRecBatch_sequence_methods = {
+#if PY_VERSION_HEX < 0x02050000
+    (inquiry)silkPyRWRecBatch_len, /* sq_length */
+#else
+    (lenfunc)silkPyRWRecBatch_len, /* sq_length */
+#endif
+    0,                          /* sq_concat */
+    0,                          /* sq_repeat */
+    0,                          /* sq_item */
+    0,                          /* sq_slice */
+    0,                          /* sq_ass_item */
+    0,                          /* sq_ass_slice */
+    0,                          /* sq_contains */
+    0,                          /* sq_inplace_concat */
+    0                           /* sq_inplace_repeat */
+};
+
+static PyMethodDef silkPyRWRecColumn_methods[] = {
+    {"__reduce__", (PyCFunction)reduce_error, METH_NOARGS, ""},
+    {"isin", (PyCFunction)silkPyRWRecColumn_isin, METH_O,
+     ("Return a column of booleans stating whether each address in"
+      " this IP column is in the IPSet")},
+    {"pmap_values", (PyCFunction)silkPyRWRecColumn_pmap_values, METH_O,
+     ("Return a column of the values the address prefix map assigns"
+      " to each address in this IP column")},
+    {NULL, NULL, 0, NULL}       /* Sentinel */
+};
+
+static PySequenceMethods silkPyRWRecColumn_sequence_methods = {
+#if PY_VERSION_HEX < 0x02050000
+    (inquiry)silkPyRWRecColumn_len, /* sq_length */
+#else
+    (lenfunc)silkPyRWRecColumn_len, /* sq_length */
+#endif
+    0,                          /* sq_concat */
+    0,                          /* sq_repeat */
+    0,                          /* sq_item */
+    0,                          /* sq_slice */
+    0,                          /* sq_ass_item */
+    0,                          /* sq_ass_slice */
+    0,                          /* sq_contains */
+    0,                          /* sq_inplace_concat */
+    0                           /* sq_inplace_repeat */
+};
+
+#if PY_VERSION_HEX >= 0x02060000
+static PyBufferProcs silkPyRWRecColumn_buffer_methods = {
+#if PY_MAJOR_VERSION < 3
+    0,                          /* bf_getreadbuffer */
+    0,                          /* bf_getwritebuffer */
+    0,                          /* bf_getsegcount */
+    0,                          /* bf_getcharbuffer */
+#endif
+    (getbufferproc)silkPyRWRecColumn_getbuffer, /* bf_getbuffer */
+    0                           /* bf_releasebuffer */
+};
+#define RWRECCOLUMN_BUFFER_METHODS  &silkPyRWRecColumn_buffer_methods
+#if PY_MAJOR_VERSION < 3
+#define RWRECCOLUMN_TPFLAGS  (Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER)
+#else
+#define RWRECCOLUMN_TPFLAGS  Py_TPFLAGS_DEFAULT
+#endif
+#else  /* PY_VERSION_HEX < 0x02060000 */
+#define RWRECCOLUMN_BUFFER_METHODS  0
+#define RWRECCOLUMN_TPFLAGS  Py_TPFLAGS_DEFAULT
+#endif
+
+/* define the object types */
+static PyTypeObject silkPyRWRecBatchType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "silk.pysilk.RWRecBatch",   /* tp_name */
+    sizeof(silkPyRWRecBatch),   /* tp_basicsize */
+    0,                          /* tp_itemsize */
+    (destructor)silkPyRWRecBatch_dealloc, /* tp_dealloc */
+    0,                          /* tp_print */
+    0,                          /* tp_getattr */
+    0,                          /* tp_setattr */
+    0,                          /* tp_compare */
+    0,                          /* tp_repr */
+    0,                          /* tp_as_number */
+    &silkPyRWRecBatch_sequence_methods, /* tp_as_sequence */
+    0,                          /* tp_as_mapping */
+    0,                          /* tp_hash  */
+    0,                          /* tp_call */
+    0,                          /* tp_str */
+    0,                          /* tp_getattro */
+    0,                          /* tp_setattro */
+    0,                          /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,         /* tp_flags */
+    silkPyRWRecBatch_doc,       /* tp_doc */
+    0,                          /* tp_traverse */
+    0,                          /* tp_clear */
+    0,                          /* tp_richcompare */
+    0,                          /* tp_weaklistoffset */
+    0,                          /* tp_iter */
+    0,                          /* tp_iternext */
+    silkPyRWRecBatch_methods,   /* tp_methods */
+    0,                          /* tp_members */
+    silkPyRWRecBatch_getseters, /* tp_getset */
+    0,                          /* tp_base */
+    0,                          /* tp_dict */
+    0,                          /* tp_descr_get */
+    0,                          /* tp_descr_set */
+    0,                          /* tp_dictoffset */
+    0,                          /* tp_init */
+    0,                          /* tp_alloc */
+    0,                          /* tp_new */
+    0,                          /* tp_free */
+    0,                          /* tp_is_gc */
+    0,                          /* tp_bases */
+    0,                          /* tp_mro */
+    0,                          /* tp_cache */
+    0,                          /* tp_subclasses */
+    0,                          /* tp_weaklist */
+    0                           /* tp_del */
+#if PY_VERSION_HEX >= 0x02060000
+    ,0                          /* tp_version_tag */
+#endif
+};
+
+static PyTypeObject silkPyRWRecColumnType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "silk.pysilk.RWRecColumn",  /* tp_name */
+    sizeof(silkPyRWRecColumn),  /* tp_basicsize */
+    0,                          /* tp_itemsize */
+    (destructor)silkPyRWRecColumn_dealloc, /* tp_dealloc */
+    0,                          /* tp_print */
+    0,                          /* tp_getattr */
+    0,                          /* tp_setattr */
+    0,                          /* tp_compare */
+    0,                          /* tp_repr */
+    0,                          /* tp_as_number */
+    &silkPyRWRecColumn_sequence_methods, /* tp_as_sequence */
+    0,                          /* tp_as_mapping */
+    0,                          /* tp_hash  */
+    0,                          /* tp_call */
+    0,                          /* tp_str */
+    0,                          /* tp_getattro */
+    0,                          /* tp_setattro */
+    RWRECCOLUMN_BUFFER_METHODS, /* tp_as_buffer */
+    RWRECCOLUMN_TPFLAGS,        /* tp_flags */
+    silkPyRWRecColumn_doc,      /* tp_doc */
+    0,                          /* tp_traverse */
+    0,                          /* tp_clear */
+    0,                          /* tp_richcompare */
+    0,                          /* tp_weaklistoffset */
+    0,                          /* tp_iter */
+    0,                          /* tp_iternext */
+    silkPyRWRecColumn_methods,  /* tp_methods */
+    0,                          /* tp_members */
+    0,                          /* tp_getset */
+    0,                          /* tp_base */
+    0,                          /* tp_dict */
+    0,                          /* tp_descr_get */
+    0,                          /* tp_descr_set */
+    0,                          /* tp_dictoffset */
+    0,                          /* tp_init */
+    0,                          /* tp_alloc */
+    0,                          /* tp_new */
+    0,                          /* tp_free */
+    0,                          /* tp_is_gc */
+    0,                          /* tp_bases */
+    0,                          /* tp_mro */
+    0,                          /* tp_cache */
+    0,                          /* tp_subclasses */
+    0,                          /* tp_weaklist */
+    0                           /* tp_del */
+#if PY_VERSION_HEX >= 0x02060000
+    ,0                          /* tp_version_tag */
+#endif
+};
+
+/* macro and function defintions */
+#define silkPyRWRecBatch_Check(op)              \
+    PyObject_TypeCheck(op, &silkPyRWRecBatchType)
+#define silkPyRWRecColumn_Check(op)             \
+    PyObject_TypeCheck(op, &silkPyRWRecColumnType)
+
+/*
+ *  column = silkPyRWRecColumnCreate(owner, data, count, kind, format, itemsize);
+ *
+ *    Create a column of 'count' values of 'itemsize' bytes at 'data'.
+ *    When 'owner' is not NULL, the column holds a reference to it;
+ *    otherwise, the column frees 'data' when it is destroyed.  An
+ *    IPv6 column has two dimensions: 'count' by 16 bytes.
+ */
+static PyObject *
+silkPyRWRecColumnCreate(
+    PyObject           *owner,
+    uint8_t            *data,
+    Py_ssize_t          count,
+    batch_column_kind_t kind,
+    const char         *format,
+    Py_ssize_t          itemsize)
+{
+    silkPyRWRecColumn *col;
+
+    col = ((silkPyRWRecColumn*)
+           silkPyRWRecColumnType.tp_alloc(&silkPyRWRecColumnType, 0));
+    if (col == NULL) {
+        if (owner == NULL) {
+            free(data);
+        }
+        return NULL;
+    }
+    Py_XINCREF(owner);
+    col->owner = owner;
+    col->data = data;
+    col->kind = kind;
+    col->shape[0] = count;
+    if (kind == BATCH_KIND_IPV6) {
+        col->format = "B";
+        col->itemsize = 1;
+        col->ndim = 2;
+        col->shape[1] = 16;
+        col->strides[0] = 16;
+        col->strides[1] = 1;
+    } else {
+        col->format = format;
+        col->itemsize = itemsize;
+        col->ndim = 1;
+        col->strides[0] = itemsize;
+    }
+    return (PyObject*)col;
+}
+
+/*
+ *  status = silkPyRWRecBatchPromoteIPv6(batch);
+ *
+ *    Replace the IPv4 address columns of 'batch' with 16-byte
+ *    columns, mapping the addresses already in the batch into
+ *    ::ffff:0:0/96.  Return 0 on success, or -1 on memory error.
+ */
+#if SK_ENABLE_IPV6
+static int
+silkPyRWRecBatchPromoteIPv6(
+    silkPyRWRecBatch   *batch)
+{
+    uint8_t *v6[3];
+    const uint32_t *v4;
+    skipaddr_t addr;
+    Py_ssize_t i;
+    int c;
+
+    for (c = 0; c < 3; ++c) {
+        v6[c] = (uint8_t*)malloc(16 * batch->capacity);
+        if (v6[c] == NULL) {
+            while (c > 0) {
+                free(v6[--c]);
+            }
+            return -1;
+        }
+    }
+    for (c = 0; c < 3; ++c) {
+        v4 = (uint32_t*)batch->column[BATCH_COL_SIP + c];
+        for (i = 0; i < batch->count; ++i) {
+            skipaddrSetV4(&addr, &v4[i]);
+            skipaddrGetAsV6(&addr, v6[c] + 16 * i);
+        }
+        free(batch->column[BATCH_COL_SIP + c]);
+        batch->column[BATCH_COL_SIP + c] = v6[c];
+    }
+    batch->is_ipv6 = 1;
+    return 0;
+}
+#endif  /* SK_ENABLE_IPV6 */
+
+/*
+ *  batch = silkPyRWRecBatchRead(stream, count, &rv);
+ *
+ *    Read up to 'count' records from 'stream' into a new batch and
+ *    return the batch.  When no records can be read or reading fails
+ *    for a reason other than end of file, return NULL and set 'rv' to
+ *    the status of the stream; on memory error, return NULL, set the
+ *    Python exception, and set 'rv' to SKSTREAM_OK.  'count' must be
+ *    positive and no larger than SIZE_MAX / BATCH_MAX_COLUMN_SIZE.
+ */
+static silkPyRWRecBatch *
+silkPyRWRecBatchRead(
+    skstream_t         *stream,
+    Py_ssize_t          count,
+    int                *rv)
+{
+    silkPyRWRecBatch *batch;
+    rwRec rec;
+    Py_ssize_t n;
+    int c;
+
+    batch = ((silkPyRWRecBatch*)
+             silkPyRWRecBatchType.tp_alloc(&silkPyRWRecBatchType, 0));
+    if (batch == NULL) {
+        *rv = SKSTREAM_OK;
+        return NULL;
+    }
+    batch->capacity = count;
+    for (c = 0; c < BATCH_COL_COUNT; ++c) {
+        batch->column[c] = (uint8_t*)malloc(batch_column_info[c].size * count);
+        if (batch->column[c] == NULL) {
+            Py_DECREF(batch);
+            PyErr_NoMemory();
+            *rv = SKSTREAM_OK;
+            return NULL;
+        }
+    }
+
+#define BATCH_SET(bs_id, bs_type, bs_value)                             \
+    (((bs_type*)batch->column[bs_id])[n] = (bs_type)(bs_value))
+
+    for (n = 0; n < count; ++n) {
+        *rv = skStreamReadRecord(stream, &rec);
+        if (*rv != SKSTREAM_OK) {
+            break;
+        }
+#if SK_ENABLE_IPV6
+        if (rwRecIsIPv6(&rec) && !batch->is_ipv6) {
+            batch->count = n;
+            if (silkPyRWRecBatchPromoteIPv6(batch)) {
+                Py_DECREF(batch);
+                PyErr_NoMemory();
+                *rv = SKSTREAM_OK;
+                return NULL;
+            }
+        }
+        if (batch->is_ipv6) {
+            rwRecMemGetSIPv6(&rec, batch->column[BATCH_COL_SIP] + 16 * n);
+            rwRecMemGetDIPv6(&rec, batch->column[BATCH_COL_DIP] + 16 * n);
+            rwRecMemGetNhIPv6(&rec, batch->column[BATCH_COL_NHIP] + 16 * n);
+        } else
+#endif  /* SK_ENABLE_IPV6 */
+        {
+            BATCH_SET(BATCH_COL_SIP, uint32_t, rwRecGetSIPv4(&rec));
+            BATCH_SET(BATCH_COL_DIP, uint32_t, rwRecGetDIPv4(&rec));
+            BATCH_SET(BATCH_COL_NHIP, uint32_t, rwRecGetNhIPv4(&rec));
+        }
+        BATCH_SET(BATCH_COL_SPORT, uint16_t, rwRecGetSPort(&rec));
+        BATCH_SET(BATCH_COL_DPORT, uint16_t, rwRecGetDPort(&rec));
+        BATCH_SET(BATCH_COL_PROTOCOL, uint8_t, rwRecGetProto(&rec));
+        BATCH_SET(BATCH_COL_PACKETS, uint32_t, rwRecGetPkts(&rec));
+        BATCH_SET(BATCH_COL_BYTES, uint32_t, rwRecGetBytes(&rec));
+        BATCH_SET(BATCH_COL_STIME, int64_t, rwRecGetStartTime(&rec));
+        BATCH_SET(BATCH_COL_DURATION, uint32_t, rwRecGetElapsed(&rec));
+        BATCH_SET(BATCH_COL_SENSOR_ID, uint16_t, rwRecGetSensor(&rec));
+        BATCH_SET(BATCH_COL_CLASSTYPE_ID, uint8_t, rwRecGetFlowType(&rec));
+        BATCH_SET(BATCH_COL_INPUT, uint16_t, rwRecGetInput(&rec));
+        BATCH_SET(BATCH_COL_OUTPUT, uint16_t, rwRecGetOutput(&rec));
+        BATCH_SET(BATCH_COL_APPLICATION, uint16_t, rwRecGetApplication(&rec));
+        BATCH_SET(BATCH_COL_TCPFLAGS, uint8_t, rwRecGetFlags(&rec));
+        BATCH_SET(BATCH_COL_INITIAL_TCPFLAGS, uint8_t,
+                  rwRecGetInitFlags(&rec));
+        BATCH_SET(BATCH_COL_SESSION_TCPFLAGS, uint8_t,
+                  rwRecGetRestFlags(&rec));
+    }
+#undef BATCH_SET
+
+    batch->count = n;
+    if (n == 0 || (*rv != SKSTREAM_OK && *rv != SKSTREAM_ERR_EOF)) {
+        /* do not hide a read error behind a short batch */
+        Py_DECREF(batch);
+        return NULL;
+    }
+    *rv = SKSTREAM_OK;
+    return batch;
+}
+
+static PyObject *
+silkPyRWRecBatch_column_get(
+    silkPyRWRecBatch   *obj,
+    void               *closure)
+{
+    const struct batch_column_info_st *info;
+    batch_column_id_t id;
+    batch_column_kind_t kind = BATCH_KIND_NUMBER;
+
+    info = (const struct batch_column_info_st*)closure;
+    id = (batch_column_id_t)(info - batch_column_info);
+    if (id == BATCH_COL_SIP || id == BATCH_COL_DIP || id == BATCH_COL_NHIP) {
+        kind = (obj->is_ipv6 ? BATCH_KIND_IPV6 : BATCH_KIND_IPV4);
+    }
+    return silkPyRWRecColumnCreate((PyObject*)obj, obj->column[id],
+                                   obj->count, kind, info->format,
+                                   info->size);
+}
+
+static PyObject *
+silkPyRWRecBatch_columns(
+    silkPyRWRecBatch   *obj)
+{
+    PyObject *dict;
+    PyObject *col;
+    int c;
+
+    dict = PyDict_New();
+    if (dict == NULL) {
+        return NULL;
+    }
+    for (c = 0; c < BATCH_COL_COUNT; ++c) {
+        col = silkPyRWRecBatch_column_get(obj, (void*)&batch_column_info[c]);
+        if (col == NULL
+            || PyDict_SetItemString(dict, batch_column_info[c].name, col))
+        {
+            Py_XDECREF(col);
+            Py_DECREF(dict);
+            return NULL;
+        }
+        Py_DECREF(col);
+    }
+    return dict;
+}
+
+static void
+silkPyRWRecBatch_dealloc(
+    silkPyRWRecBatch   *obj)
+{
+    int c;
+
+    for (c = 0; c < BATCH_COL_COUNT; ++c) {
+        free(obj->column[c]);
+    }
+    Py_TYPE(obj)->tp_free((PyObject*)obj);
+}
+
+static PyObject *
+silkPyRWRecBatch_is_ipv6_get(
+    silkPyRWRecBatch       *obj,
+    void            UNUSED(*closure))
+{
+    return PyBool_FromLong(obj->is_ipv6);
+}
+
+static Py_ssize_t
+silkPyRWRecBatch_len(
+    silkPyRWRecBatch   *obj)
+{
+    return obj->count;
+}
+
+static void
+silkPyRWRecColumn_dealloc(
+    silkPyRWRecColumn  *obj)
+{
+    if (obj->owner) {
+        Py_DECREF(obj->owner);
+    } else {
+        free(obj->data);
+    }
+    Py_TYPE(obj)->tp_free((PyObject*)obj);
+}
+
+#if PY_VERSION_HEX >= 0x02060000
+static int
+silkPyRWRecColumn_getbuffer(
+    silkPyRWRecColumn  *obj,
+    Py_buffer          *view,
+    int                 flags)
+{
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "RWRecColumn is read-only");
+        view->obj = NULL;
+        return -1;
+    }
+    view->buf = obj->data;
+    view->obj = (PyObject*)obj;
+    Py_INCREF(obj);
+    view->len = obj->shape[0] * obj->strides[0];
+    view->readonly = 1;
+    view->itemsize = obj->itemsize;
+    view->format = ((flags & PyBUF_FORMAT) ? (char*)obj->format : NULL);
+    view->ndim = obj->ndim;
+    view->shape = ((flags & PyBUF_ND) ? obj->shape : NULL);
+    view->strides = (((flags & PyBUF_STRIDES) == PyBUF_STRIDES)
+                     ? obj->strides : NULL);
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+#endif  /* PY_VERSION_HEX >= 0x02060000 */
+
+/*
+ *  silkPyRWRecColumnGetAddr(col, i, addr);
+ *
+ *    Fill 'addr' with the address at position 'i' of the IP column
+ *    'col'.
+ */
+static void
+silkPyRWRecColumnGetAddr(
+    const silkPyRWRecColumn    *col,
+    Py_ssize_t                  i,
+    skipaddr_t                 *addr)
+{
+#if SK_ENABLE_IPV6
+    if (col->kind == BATCH_KIND_IPV6) {
+        skipaddrSetV6(addr, col->data + 16 * i);
+        return;
+    }
+#endif
+    skipaddrSetV4(addr, &((const uint32_t*)col->data)[i]);
+}
+
+static PyObject *
+silkPyRWRecColumn_isin(
+    silkPyRWRecColumn  *self,
+    PyObject           *set)
+{
+    skipset_t *ipset;
+    skipaddr_t addr;
+    uint8_t *result;
+    Py_ssize_t i;
+
+    if (self->kind == BATCH_KIND_NUMBER) {
+        PyErr_SetString(PyExc_TypeError, "Column does not contain IPs");
+        return NULL;
+    }
+    if (!silkPyIPSet_Check(set)) {
+        PyErr_SetString(PyExc_TypeError, "Expected an IPSet");
+        return NULL;
+    }
+    ipset = ((silkPyIPSet*)set)->ipset;
+
+    result = (uint8_t*)malloc(self->shape[0] + 1);
+    if (result == NULL) {
+        return PyErr_NoMemory();
+    }
+    for (i = 0; i < self->shape[0]; ++i) {
+        silkPyRWRecColumnGetAddr(self, i, &addr);
+        result[i] = (skIPSetCheckAddress(ipset, &addr) ? 1 : 0);
+    }
+    return silkPyRWRecColumnCreate(NULL, result, self->shape[0],
+                                   BATCH_KIND_NUMBER, "?", 1);
+}
+
+static Py_ssize_t
+silkPyRWRecColumn_len(
+    silkPyRWRecColumn  *obj)
+{
+    return obj->shape[0];
+}
+
+static PyObject *
+silkPyRWRecColumn_pmap_values(
+    silkPyRWRecColumn  *self,
+    PyObject           *pmap)
+{
+    skPrefixMap_t *map;
+    skipaddr_t addr;
+    uint32_t *result;
+    Py_ssize_t i;
+
+    if (self->kind == BATCH_KIND_NUMBER) {
+        PyErr_SetString(PyExc_TypeError, "Column does not contain IPs");
+        return NULL;
+    }
+    if (!silkPyPmap_Check(pmap)) {
+        PyErr_SetString(PyExc_TypeError, "Expected a PMapBase");
+        return NULL;
+    }
+    map = ((silkPyPmap*)pmap)->map;
+    if (skPrefixMapGetContentType(map) == SKPREFIXMAP_CONT_PROTO_PORT) {
+        PyErr_SetString(PyExc_TypeError, "Expected an address prefix map");
+        return NULL;
+    }
+
+    result = (uint32_t*)malloc((self->shape[0] + 1) * sizeof(uint32_t));
+    if (result == NULL) {
+        return PyErr_NoMemory();
+    }
+    for (i = 0; i < self->shape[0]; ++i) {
+        silkPyRWRecColumnGetAddr(self, i, &addr);
+        result[i] = skPrefixMapFindValue(map, &addr);
+    }
+    return silkPyRWRecColumnCreate(NULL, (uint8_t*)result, self->shape[0],
+                                   BATCH_KIND_NUMBER, "I", sizeof(uint32_t));
+}
+
+
 /*
  *************************************************************************
  *   SiLK File
@@ -6571,6 +7340,11 @@ static PyObject *
 silkPySilkFile_read(
     silkPySilkFile     *obj);
 static PyObject *
+silkPySilkFile_read_batch(
+    silkPySilkFile     *obj,
+    PyObject           *args,
+    PyObject           *kwds);
+static PyObject *
 silkPySilkFile_write(
     silkPySilkFile     *obj,
     PyObject           *rec);
@@ -6580,6 +7354,9 @@ static PyMethodDef silkPySilkFile_methods[] = {
     {"__reduce__", (PyCFunction)reduce_error, METH_NOARGS, ""},
     {"read", (PyCFunction)silkPySilkFile_read, METH_NOARGS,
      "Read a RWRec from a RW File"},
+    {"read_batch", (PyCFunction)silkPySilkFile_read_batch,
+     METH_VARARGS | METH_KEYWORDS,
+     "Read up to count records from a RW File into an RWRecBatch"},
     {"write", (PyCFunction)silkPySilkFile_write, METH_O,
      "Write a RWRec to a RW File"},
     {"close", (PyCFunction)silkPySilkFile_close, METH_NOARGS,
@@ -6990,6 +7767,43 @@ silkPySilkFile_read(
     return pyrec;
 }
 
+static PyObject *
+silkPySilkFile_read_batch(
+    silkPySilkFile     *obj,
+    PyObject           *args,
+    PyObject           *kwds)
+{
+    static char *kwlist[] = {"count", NULL};
+    silkPyRWRecBatch *batch;
+    Py_ssize_t count = BATCH_DEFAULT_COUNT;
+    int rv;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|n", kwlist, &count)) {
+        return NULL;
+    }
+    if (count <= 0) {
+        PyErr_SetString(PyExc_ValueError, "count must be positive");
+        return NULL;
+    }
+    if ((size_t)count > SIZE_MAX / BATCH_MAX_COLUMN_SIZE) {
+        PyErr_SetString(PyExc_ValueError, "count is too large");
+        return NULL;
+    }
+
+    batch = silkPyRWRecBatchRead(obj->io, count, &rv);
+    if (batch == NULL) {
+        if (rv == SKSTREAM_OK) {
+            return NULL;
+        }
+        if (rv == SKSTREAM_ERR_EOF) {
+            Py_RETURN_NONE;
+        }
+        return throw_ioerror(obj, rv);
+    }
+
+    return (PyObject*)batch;
+}
+
 static PyObject *
 silkPySilkFile_write(
     silkPySilkFile     *obj,
@@ -8684,6 +9498,20 @@ initpysilkbase(
                                      (PyObject*)&silkPyRWRecType),
                   int, 0);
 
+    if (PyType_Ready(&silkPyRWRecBatchType) < 0) {
+        goto err;
+    }
+    ASSERT_RESULT(PyModule_AddObject(silkmod, "RWRecBatch",
+                                     (PyObject*)&silkPyRWRecBatchType),
+                  int, 0);
+
+    if (PyType_Ready(&silkPyRWRecColumnType) < 0) {
+        goto err;
+    }
+    ASSERT_RESULT(PyModule_AddObject(silkmod, "RWRecColumn",
+                                     (PyObject*)&silkPyRWRecColumnType),
+                  int, 0);
+
     tmp = PyImport_ImportModule("datetime");
     if (tmp == NULL) {
         skAppPrintErr("Failed to import datetime module");
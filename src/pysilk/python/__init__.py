@@ -715,6 +715,19 @@ class PrefixMap(object):
         """
         return tuple(self._itervalues())
 
+    def labels(self):
+        """
+        pmap.labels() -> tuple of pmap's values indexed by their number
+        """
+        return tuple(self._value(i) for i in range(0, self._pmap.num_values))
+
+    def lookup_column(self, column):
+        """
+        pmap.lookup_column(col) -> RWRecColumn of value numbers for the
+        IP addresses in the RWRecColumn col
+        """
+        return column.pmap_values(self._pmap)
+
 class AddressPrefixMap(PrefixMap):
     pass
 
@@ -209,18 +209,22 @@ def register_field(name, **kwds):
 
 # The order for these fields must be the same as the order of the
 # filter_index_t in silkpython.c
-_filter_name_list = ['filter', 'initialize', 'finalize']
+_filter_name_list = ['filter', 'initialize', 'finalize', 'batch_filter']
 
 _filter_data = []
 _filter_names = {'filter': 1,
                  'initialize' : 0,
-                 'finalize' : 0}
+                 'finalize' : 0,
+                 'batch_filter' : 1}
 
 def _get_filter_data():
     return _get_generic_data(_filter_data, _filter_name_list)
 
-def register_filter(filter, **kwds):
-    kwds['filter'] = filter
+def register_filter(filter=None, **kwds):
+    if filter is not None:
+        kwds['filter'] = filter
+    elif 'batch_filter' not in kwds:
+        raise TypeError("Either a filter or a batch_filter must be given")
     _check_type(_filter_names, kwds)
     _filter_data.append(kwds)
 
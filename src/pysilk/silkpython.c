@@ -85,7 +85,7 @@ SK_DIAGNOSTIC_IGNORE_PUSH("-Wwrite-strings")
 
 /* Plugin protocol version */
 #define PLUGIN_API_VERSION_MAJOR 1
-#define PLUGIN_API_VERSION_MINOR 0
+#define PLUGIN_API_VERSION_MINOR 1
 
 
 /*
@@ -143,6 +143,7 @@ typedef enum {
     FILTER_FILTER = 0,
     FILTER_INIT,
     FILTER_FINALIZE,
+    FILTER_BATCH,
 
     FILTER_INDEX_MAX
 } filter_index_t;
@@ -212,6 +213,13 @@ silkpython_filter(
     void               *data,
     void              **extra);
 static skplugin_err_t
+silkpython_filter_batch(
+    const rwRec       **rec_list,
+    uint8_t            *pass_list,
+    size_t              count,
+    void               *data,
+    void              **extra);
+static skplugin_err_t
 silkpython_field_init(
     void               *data);
 static skplugin_err_t
@@ -944,8 +952,10 @@ register_filter(
     PyObject               *obj;
     skplugin_callback_fn_t  init_fn  = NULL;
     skplugin_filter_fn_t    filter   = NULL;
+    skplugin_filter_batch_fn_t filter_batch = NULL;
     skplugin_callback_fn_t  finalize = NULL;
     skplugin_callbacks_t    regdata;
+    skplugin_filter_t      *filt;
 
     if (PyTuple_GET_SIZE(o) != FILTER_INDEX_MAX) {
         skAppPrintErr("Incorrect number of entries for a filter");
@@ -976,13 +986,28 @@ register_filter(
         finalize = silkpython_filter_finalize;
     }
 
+    obj = PyTuple_GET_ITEM(o, FILTER_BATCH);
+    if (obj == NULL) {
+        return -1;
+    }
+    if (obj != Py_None) {
+        /* silkpython_filter() calls the batch function with a single
+         * record when no per-record function was given */
+        filter = silkpython_filter;
+        filter_batch = silkpython_filter_batch;
+    }
+
     memset(&regdata, 0, sizeof(regdata));
 
     regdata.init = init_fn;
     regdata.cleanup = finalize;
     regdata.filter = filter;
 
-    err = skpinRegFilter(NULL, &regdata, o);
+    err = skpinRegFilter(&filt, &regdata, o);
+    if (err != SKPLUGIN_OK) {
+        return -1;
+    }
+    err = skpinSetFilterBatchFn(filt, filter_batch);
     if (err != SKPLUGIN_OK) {
         return -1;
     }
@@ -1261,6 +1286,12 @@ silkpython_filter(
 
     fun = PyTuple_GET_ITEM(obj, FILTER_FILTER);
     assert(fun != NULL);
+    if (fun == Py_None) {
+        /* only a batch filter was registered */
+        uint8_t pass = 1;
+        silkpython_filter_batch(&rwrec, &pass, 1, data, extra);
+        return (pass ? SKPLUGIN_FILTER_PASS : SKPLUGIN_FILTER_FAIL);
+    }
     Py_INCREF(fun);
 
     rec = rwrec_to_python(rwrec);
@@ -1281,6 +1312,98 @@ silkpython_filter(
 }
 
 
+/* Filter a batch of rwrecs: the candidate records are handed to the
+ * Python function as a list, and it returns a sequence of the same
+ * length whose items are the pass/fail results */
+static skplugin_err_t
+silkpython_filter_batch(
+    const rwRec           **rec_list,
+    uint8_t                *pass_list,
+    size_t                  count,
+    void                   *data,
+    void           UNUSED(**extra))
+{
+    PyObject *obj = (PyObject *)data;
+    PyObject *fun;
+    PyObject *list;
+    PyObject *retval;
+    PyObject *seq;
+    Py_ssize_t k;
+    size_t i;
+    int rv;
+
+    assert(!ignore_plugin);
+
+    fun = PyTuple_GET_ITEM(obj, FILTER_BATCH);
+    assert(fun != NULL);
+    Py_INCREF(fun);
+
+    list = PyList_New(0);
+    if (list == NULL) {
+        PyErr_Print();
+        PyErr_Clear();
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < count; ++i) {
+        if (pass_list[i]) {
+            PyObject *rec = rwrec_to_python(rec_list[i]);
+            rv = PyList_Append(list, rec);
+            Py_DECREF(rec);
+            if (rv) {
+                PyErr_Print();
+                PyErr_Clear();
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    if (0 == PyList_GET_SIZE(list)) {
+        Py_DECREF(list);
+        Py_DECREF(fun);
+        return SKPLUGIN_OK;
+    }
+
+    retval = PyObject_CallFunctionObjArgs(fun, list, NULL);
+    if (retval == NULL) {
+        PyErr_Print();
+        PyErr_Clear();
+        exit(EXIT_FAILURE);
+    }
+    seq = PySequence_Fast(retval, "batch_filter must return a sequence");
+    if (seq == NULL) {
+        PyErr_Print();
+        PyErr_Clear();
+        exit(EXIT_FAILURE);
+    }
+    if (PySequence_Fast_GET_SIZE(seq) != PyList_GET_SIZE(list)) {
+        skAppPrintErr(("batch_filter returned %" SK_PRIuZ " results"
+                       " for %" SK_PRIuZ " records"),
+                      (size_t)PySequence_Fast_GET_SIZE(seq),
+                      (size_t)PyList_GET_SIZE(list));
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0, k = 0; i < count; ++i) {
+        if (pass_list[i]) {
+            rv = PyObject_IsTrue(PySequence_Fast_GET_ITEM(seq, k));
+            if (rv == -1) {
+                PyErr_Print();
+                PyErr_Clear();
+                exit(EXIT_FAILURE);
+            }
+            pass_list[i] = (uint8_t)rv;
+            ++k;
+        }
+    }
+
+    Py_DECREF(seq);
+    Py_DECREF(retval);
+    Py_DECREF(list);
+    Py_DECREF(fun);
+
+    return SKPLUGIN_OK;
+}
+
+
 static skplugin_err_t
 silkpython_x_call(
     int                 offset,
@@ -73,13 +73,12 @@
 
 RCSIDENT("$SiLK: rwaddrcount.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 
-#include <silk/iptree.h>
 #include <silk/rwrec.h>
 #include <silk/skipaddr.h>
+#include <silk/skipset.h>
 #include <silk/sksite.h>
 #include <silk/skstream.h>
 #include <silk/skstringmap.h>
-#include <silk/skvector.h>
 #include <silk/utils.h>
 
 
@@ -88,37 +87,52 @@ RCSIDENT("$SiLK: rwaddrcount.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 /* where to write output from --help */
 #define USAGE_FH stdout
 
-/* number of buckets in hash table */
-#define RWAC_ARRAYSIZE   50865917
+/* environment variable that specifies the number of threads */
+#define RWAC_THREADS_ENVAR  "SILK_RWADDRCOUNT_THREADS"
 
-/* number of countRecord_t to allocate at one time */
-#define RWAC_BLOCK_SIZE      4096
+/* initial number of slots in the hash table; must be a power of 2.
+ * the table doubles in size whenever it becomes half full */
+#define RWAC_TABLE_INITIAL_SIZE  (1 << 12)
 
 /*
- * Get the IP address from the record 'r' to use as the key.  Uses the
- * global variable 'use_dest'
+ * Get the IPv4 address from the record 'r' to use as the key.  Uses
+ * the global variable 'use_dest'
  */
 #define GETIP(r)                                                \
     ((use_dest) ? rwRecGetDIPv4(r) : rwRecGetSIPv4(r))
 
 /*
- * One of the problems I've had recently is a tendency to focus on
- * doing the perfect hash.  The perfect hash is nice, but what we need
- * RIGHT HERE RIGHT NOW is a tool that'll actually do the job.  Enough
- * mathematical wanking.
- *
- * So, this is a hash whose collision compensation algorithm is linear
- * chaining.  I'm not happy about it, but it'll do for now.
+ * The key of each countRecord_t is an IPv6 address held in two 64-bit
+ * values.  IPv4 addresses are stored as IPv4-mapped IPv6 addresses
+ * (::ffff:0:0/96).  KEY_IS_V4 is TRUE if the countRecord_t 'cr' holds
+ * an IPv4 address.
+ */
+#define KEY_V4_PREFIX   UINT64_C(0x0000ffff00000000)
+
+#define KEY_IS_V4(cr)                                           \
+    (0 == (cr)->cr_key_hi                                       \
+     && KEY_V4_PREFIX == ((cr)->cr_key_lo & ~UINT64_C(0xffffffff)))
+
+/*
+ * Hash the key 'hi','lo' to a 64-bit value; the table uses the low
+ * bits of the result as the index of the first slot to probe.
  */
-#define HASHFUNC(value)                                         \
-    ((value ^ (value >> 7) ^ (value << 23)) % RWAC_ARRAYSIZE)
+#define HASHKEY(hk_out, hk_hi, hk_lo)                           \
+    {                                                           \
+        (hk_out) = ((hk_lo) ^ ((hk_hi) * UINT64_C(0x9e3779b97f4a7c15))); \
+        (hk_out) ^= (hk_out) >> 33;                             \
+        (hk_out) *= UINT64_C(0xff51afd7ed558ccd);               \
+        (hk_out) ^= (hk_out) >> 33;                             \
+    }
 
 /*
- * CMPFNC: return TRUE if IP on the rwRec 'r' matches the IP stored in
- * the countRecord_t 'b'.
+ * Get the byte of the key of the countRecord_t 'cr' to use for pass
+ * 'p' of the radix sort.  Pass 0 is the least significant byte.
  */
-#define CMPFNC(r, cr)                           \
-    ((cr)->cr_key == GETIP(r))
+#define KEY_BYTE(cr, p)                                         \
+    ((uint8_t)(((p) < 8)                                        \
+               ? ((cr)->cr_key_lo >> (8 * (p)))                 \
+               : ((cr)->cr_key_hi >> (8 * ((p) - 8)))))
 
 /*
  * when generating output, this macro will evaluate to TRUE if the
@@ -143,30 +157,58 @@ RCSIDENT("$SiLK: rwaddrcount.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 
 /* formats for printing statistics */
 #define FMT_STAT_VALUE                                                  \
-    "%*s%c%*" PRIu32 "%c%*" PRIu64 "%c%*" PRIu64 "%c%*" PRIu64 "%s\n"
+    "%*s%c%*" PRIu64 "%c%*" PRIu64 "%c%*" PRIu64 "%c%*" PRIu64 "%s\n"
 #define FMT_STAT_TITLE "%*s%c%*s%c%*s%c%*s%c%*s%s\n"
 #define FMT_STAT_WIDTH {10, 10, 20, 15, 15}
 
+/* width of the IP column when IPv6 addresses are present */
+#define IPV6_WIDTH  39
+
 /* default time_flags */
 #define TIME_FLAGS_DEFAULT  SKTIMESTAMP_NOMSEC
 
-typedef struct countRecord_st countRecord_t;
-struct countRecord_st {
+/*
+ * A bin.  A slot in the hash table whose cr_records is 0 is empty.
+ */
+typedef struct countRecord_st {
+    /* IP address as an IPv6 address: the most and least significant
+     * 64 bits */
+    uint64_t        cr_key_hi;
+    uint64_t        cr_key_lo;
     /* total number of bytes */
     uint64_t        cr_bytes;
-    /* Pointer to the next record for collision */
-    countRecord_t  *cr_next;
-    /* IP address, or whatever we don't consider source or dest here*/
-    uint32_t        cr_key;
     /* total number of packets */
     uint32_t        cr_packets;
-    /* total number of records */
+    /* total number of records; does not wrap to 0 */
     uint32_t        cr_records;
     /* start time - epoch*/
     uint32_t        cr_start;
     /* total time lasted */
     uint32_t        cr_end;
-};
+} countRecord_t;
+
+/*
+ * An open-addressing hash table of bins that uses linear probing.
+ */
+typedef struct countTable_st {
+    /* the slots */
+    countRecord_t  *slots;
+    /* number of slots; a power of 2 */
+    uint64_t        size;
+    /* number of slots in use */
+    uint64_t        count;
+    /* whether any key is an IPv6 address */
+    int             has_ipv6;
+} countTable_t;
+
+/*
+ * A thread that counts records into its own table.
+ */
+typedef struct countThread_st {
+    countTable_t    table;
+    pthread_t       thread;
+    int             rv;
+} countThread_t;
 
 typedef enum {
     RWAC_PMODE_NONE=0,
@@ -196,18 +238,23 @@ static uint32_t min_records = 0;
 static uint32_t max_records = UINT32_MAX;
 
 /* the hash table */
-static countRecord_t *hash_bins[RWAC_ARRAYSIZE];
+static countTable_t table;
 
 /* IPset file for output when --set-file is specified */
 static const char *ipset_file = NULL;
 
-/* entries are allocated in blocks; the blocks are stored in a
- * vector */
-static sk_vector_t *mem_vector = NULL;
-
 /* whether to use the source(==0) or destination(==1) IPs */
 static uint8_t use_dest = 0;
 
+/* how to handle IPv6 flows */
+static sk_ipv6policy_t ipv6_policy = SK_IPV6POLICY_MIX;
+
+/* number of threads to use to count records; 1 for no threading */
+static uint32_t thread_count = 1;
+
+/* protects calls to skOptionsCtxNextSilkFile() from the threads */
+static pthread_mutex_t next_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /* output mode for IPs */
 static uint32_t ip_format = SKIPADDR_CANONICAL;
 static uint8_t sort_ips_flag = 0;
@@ -283,6 +330,7 @@ typedef enum {
     OPT_DELIMITED,
     OPT_OUTPUT_PATH,
     OPT_PAGER,
+    OPT_THREADS,
     OPT_LEGACY_TIMESTAMPS
 } appOptionsEnum;
 
@@ -307,6 +355,7 @@ static struct option appOptions[] = {
     {"delimited",           OPTIONAL_ARG, 0, OPT_DELIMITED},
     {"output-path",         REQUIRED_ARG, 0, OPT_OUTPUT_PATH},
     {"pager",               REQUIRED_ARG, 0, OPT_PAGER},
+    {"threads",             REQUIRED_ARG, 0, OPT_THREADS},
     {"legacy-timestamps",   OPTIONAL_ARG, 0, OPT_LEGACY_TIMESTAMPS},
     {0,0,0,0}               /* sentinel entry */
 };
@@ -338,6 +387,8 @@ static const char *appHelp[] = {
     "Shortcut for --no-columns --no-final-del --column-sep=CHAR",
     "Send output to given file path. Def. stdout",
     "Program to invoke to page output. Def. $SILK_PAGER or $PAGER",
+    ("Count records using this number of threads.\n"
+     "\tDef. $" RWAC_THREADS_ENVAR " or 1"),
     "DEPRECATED. Equivalent to --timestamp-format=m/d/y,no-msec",
     (char *)NULL
 };
@@ -356,6 +407,7 @@ static struct option legacyOptions[] = {
 /* LOCAL FUNCTION PROTOTYPES */
 
 static int  appOptionsHandler(clientData cData, int opt_index, char *opt_arg);
+static int  tableCreate(countTable_t *tbl);
 static int  timestampFormatParse(const char *format, uint32_t *out_flags);
 static void timestampFormatUsage(FILE *fh);
 
@@ -404,6 +456,7 @@ appUsageLong(
         }
     }
     skOptionsCtxOptionsUsage(optctx, fh);
+    skIPv6PolicyUsage(fh);
     sksiteOptionsUsage(fh);
 
     fprintf(fh, "\nDEPRECATED SWITCHES:\n");
@@ -427,15 +480,7 @@ static void
 appTeardown(
     void)
 {
-/* #define RWAC_MAX_CHAIN  64 */
-
     static int teardownFlag = 0;
-    countRecord_t *bin;
-    uint32_t i;
-#ifdef RWAC_MAX_CHAIN
-    uint32_t chained[RWAC_MAX_CHAIN];
-    uint32_t chain_len;
-#endif
 
     if (teardownFlag) {
         return;
@@ -450,45 +495,8 @@ appTeardown(
     /* close the copy-stream */
     skOptionsCtxCopyStreamClose(optctx, &skAppPrintErr);
 
-#ifdef RWAC_MAX_CHAIN
-    /* print chain length of each bucket */
-    memset(chained, 0, sizeof(chained));
-    chain_len = 0;
-
-    for (i = 0; i < RWAC_ARRAYSIZE; ++i) {
-        if (NULL != hash_bins[i]) {
-            bin = hash_bins[i];
-            chain_len = 0;
-            do {
-                ++chain_len;
-                bin = bin->cr_next;
-            } while (bin != hash_bins[i]);
-            if (chain_len < RWAC_MAX_CHAIN) {
-                ++chained[chain_len];
-            } else {
-                ++chained[RWAC_MAX_CHAIN-1];
-            }
-        }
-    }
-
-    if (chain_len) {
-        fprintf(stderr, "Hash Chaining Information\n%10s|%10s|\n",
-                "Length", "Count");
-    }
-    for (i = 0; i < RWAC_MAX_CHAIN; ++i) {
-        if (chained[i]) {
-            fprintf(stderr, ("%10" PRIu32 "|%10" PRIu32 "|\n"),
-                    i, chained[i]);
-        }
-    }
-#endif  /* RWAC_MAX_CHAIN */
-
-    if (mem_vector) {
-        for (i = 0; 0 == skVectorGetValue(&bin, mem_vector, i); ++i) {
-            free(bin);
-        }
-        skVectorDestroy(mem_vector);
-    }
+    free(table.slots);
+    table.slots = NULL;
 
     skOptionsCtxDestroy(&optctx);
     skAppUnregister();
@@ -513,6 +521,8 @@ appSetup(
 {
     SILK_FEATURES_DEFINE_STRUCT(features);
     int optctx_flags;
+    const char *env;
+    uint32_t tc;
     int rv;
 
     /* verify same number of options and help strings */
@@ -539,6 +549,7 @@ appSetup(
         || skOptionsRegister(appOptions, &appOptionsHandler, NULL)
         || skOptionsRegister(legacyOptions, &appOptionsHandler, NULL)
         || skOptionsIPFormatRegister(&ip_format)
+        || skIPv6PolicyOptionsRegister(&ipv6_policy)
         || sksiteOptionsRegister(SK_SITE_FLAG_CONFIG_FILE))
     {
         skAppPrintErr("Unable to register options");
@@ -552,6 +563,14 @@ appSetup(
         exit(EXIT_FAILURE);
     }
 
+    /* check the thread count envar */
+    env = getenv(RWAC_THREADS_ENVAR);
+    if (env && env[0]) {
+        if (skStringParseUint32(&tc, env, 1, 0) == 0) {
+            thread_count = tc;
+        }
+    }
+
     /* parse options */
     rv = skOptionsCtxOptionsParse(optctx, argc, argv);
     if (rv < 0) {
@@ -628,10 +647,23 @@ appSetup(
         }
     }
 
-    /* create vector */
-    mem_vector = skVectorNew(sizeof(countRecord_t*));
-    if (NULL == mem_vector) {
-        skAppPrintErr("Cannot create vector");
+    /* the --copy-input stream is written as each record is read, so
+     * records must be read by a single thread */
+    if (skOptionsCtxCopyStreamIsActive(optctx)) {
+        thread_count = 1;
+    }
+
+    /* use no more threads than there are files on the command line.
+     * with no files, the input is the standard input or the files
+     * named by --xargs, whose number is not known */
+    rv = skOptionsCtxCountArgs(optctx);
+    if (rv > 0 && (uint32_t)rv < thread_count) {
+        thread_count = (uint32_t)rv;
+    }
+
+    /* create the hash table */
+    if (tableCreate(&table)) {
+        skAppPrintOutOfMemory("hash table");
         exit(EXIT_FAILURE);
     }
 
@@ -789,6 +821,13 @@ appOptionsHandler(
         pager = opt_arg;
         break;
 
+      case OPT_THREADS:
+        rv = skStringParseUint32(&thread_count, opt_arg, 1, 0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
+
       case OPT_LEGACY_TIMESTAMPS:
         if ((opt_arg == NULL) || (opt_arg[0] == '\0') || (opt_arg[0] == '1')) {
             rv = timestampFormatParse("m/d/y", &time_flags);
@@ -958,205 +997,374 @@ timestampFormatUsage(
 
 
 /*
- * void addToBin(countRecord_t *bin, rwRec *rwrec)
+ * SECTION: The hash table
+ */
+
+
+/*
+ *  status = tableCreate(tbl);
  *
- * Adds the contents of a record to the values stored in a bin.
+ *    Initialize the hash table 'tbl' with RWAC_TABLE_INITIAL_SIZE
+ *    empty slots.  Return 0 on success, or -1 on allocation failure.
+ */
+static int
+tableCreate(
+    countTable_t       *tbl)
+{
+    memset(tbl, 0, sizeof(countTable_t));
+    tbl->slots = (countRecord_t*)calloc(RWAC_TABLE_INITIAL_SIZE,
+                                        sizeof(countRecord_t));
+    if (NULL == tbl->slots) {
+        return -1;
+    }
+    tbl->size = RWAC_TABLE_INITIAL_SIZE;
+    return 0;
+}
+
+
+/*
+ *  tableGrow(tbl);
+ *
+ *    Double the number of slots in the hash table 'tbl' and re-insert
+ *    its bins.  Exit the application on allocation failure.
  */
 static void
-addToBin(
-    countRecord_t      *bin,
-    const rwRec        *rwrec)
+tableGrow(
+    countTable_t       *tbl)
 {
-    assert(bin->cr_key == GETIP(rwrec));
-    bin->cr_bytes += rwRecGetBytes(rwrec);
-    bin->cr_packets += rwRecGetPkts(rwrec);
-    ++bin->cr_records;
-    if (rwRecGetStartSeconds(rwrec) < bin->cr_start) {
-        bin->cr_start = rwRecGetStartSeconds(rwrec);
+    countRecord_t *old_slots = tbl->slots;
+    countRecord_t *old_end = tbl->slots + tbl->size;
+    countRecord_t *cr;
+    uint64_t mask;
+    uint64_t h;
+
+    tbl->slots = (countRecord_t*)calloc(2 * tbl->size, sizeof(countRecord_t));
+    if (NULL == tbl->slots) {
+        skAppPrintErr("Error allocating memory for %" PRIu64 " bins",
+                      2 * tbl->size);
+        exit(EXIT_FAILURE);
     }
-    if (bin->cr_end < rwRecGetEndSeconds(rwrec)) {
-        bin->cr_end = rwRecGetEndSeconds(rwrec);
+    tbl->size *= 2;
+    mask = tbl->size - 1;
+
+    for (cr = old_slots; cr < old_end; ++cr) {
+        if (cr->cr_records) {
+            HASHKEY(h, cr->cr_key_hi, cr->cr_key_lo);
+            h &= mask;
+            while (tbl->slots[h].cr_records) {
+                h = (h + 1) & mask;
+            }
+            tbl->slots[h] = *cr;
+        }
     }
+    free(old_slots);
 }
 
 
 /*
- * int newBin(rwRec *rwrec)
+ *  bin = tableFind(tbl, key_hi, key_lo);
  *
- * Creates a new countRecord and initializes it with the values from
- * the record.
+ *    Return the bin in 'tbl' whose key is 'key_hi','key_lo'.  When
+ *    the key is not present, return an empty slot whose key has been
+ *    set; the caller must initialize the counters of the bin.
  */
 static countRecord_t *
-newBin(
-    const rwRec        *rwrec)
+tableFind(
+    countTable_t       *tbl,
+    uint64_t            key_hi,
+    uint64_t            key_lo)
 {
-    static countRecord_t *current_block = NULL;
-    static uint32_t available = 0;
-    countRecord_t *bin;
+    countRecord_t *cr;
+    uint64_t mask;
+    uint64_t h;
 
-    if (available) {
-        --available;
-        bin = current_block;
-        ++current_block;
-    } else {
-        current_block
-            = (countRecord_t*)malloc(RWAC_BLOCK_SIZE * sizeof(countRecord_t));
-        if (NULL == current_block) {
-            skAppPrintErr("Error allocating memory for bin");
-            exit(EXIT_FAILURE);
+    /* keep the table no more than half full */
+    if (2 * (tbl->count + 1) > tbl->size) {
+        tableGrow(tbl);
+    }
+
+    mask = tbl->size - 1;
+    HASHKEY(h, key_hi, key_lo);
+    for (h &= mask; ; h = (h + 1) & mask) {
+        cr = &tbl->slots[h];
+        if (0 == cr->cr_records) {
+            ++tbl->count;
+            cr->cr_key_hi = key_hi;
+            cr->cr_key_lo = key_lo;
+            return cr;
         }
-        if (skVectorAppendValue(mem_vector, &current_block)) {
-            skAppPrintErr("Error allocating memory for bin");
-            exit(EXIT_FAILURE);
+        if (cr->cr_key_lo == key_lo && cr->cr_key_hi == key_hi) {
+            return cr;
         }
-        bin = current_block;
-        ++current_block;
-        available = RWAC_BLOCK_SIZE - 1;
     }
-
-    bin->cr_bytes = rwRecGetBytes(rwrec);
-    bin->cr_packets = rwRecGetPkts(rwrec);
-    bin->cr_records = 1;
-    bin->cr_key = GETIP(rwrec);
-    bin->cr_start = rwRecGetStartSeconds(rwrec);
-    bin->cr_end = rwRecGetEndSeconds(rwrec);
-    bin->cr_next = NULL;
-
-    return bin;
 }
 
 
 /*
- * SECTION: Dumping
+ *  addRecord(tbl, rwrec);
  *
- * All the output routines are in this section of the text.
+ *    Add the byte, packet, and record counts and the times of 'rwrec'
+ *    to the bin for its IP address in 'tbl', creating the bin if
+ *    needed.
  */
+static void
+addRecord(
+    countTable_t       *tbl,
+    const rwRec        *rwrec)
+{
+    countRecord_t *bin;
+    uint64_t key_hi = 0;
+    uint64_t key_lo;
+#if SK_ENABLE_IPV6
+    uint8_t ipv6[16];
+
+    if (rwRecIsIPv6(rwrec)) {
+        if (use_dest) {
+            rwRecMemGetDIPv6(rwrec, ipv6);
+        } else {
+            rwRecMemGetSIPv6(rwrec, ipv6);
+        }
+        memcpy(&key_hi, ipv6, sizeof(uint64_t));
+        memcpy(&key_lo, ipv6 + sizeof(uint64_t), sizeof(uint64_t));
+        key_hi = ntoh64(key_hi);
+        key_lo = ntoh64(key_lo);
+    } else {
+        key_lo = KEY_V4_PREFIX | GETIP(rwrec);
+    }
+#else
+    key_lo = KEY_V4_PREFIX | GETIP(rwrec);
+#endif  /* SK_ENABLE_IPV6 */
+
+    bin = tableFind(tbl, key_hi, key_lo);
+    if (0 == bin->cr_records) {
+        bin->cr_bytes = rwRecGetBytes(rwrec);
+        bin->cr_packets = rwRecGetPkts(rwrec);
+        bin->cr_records = 1;
+        bin->cr_start = rwRecGetStartSeconds(rwrec);
+        bin->cr_end = rwRecGetEndSeconds(rwrec);
+        if (!KEY_IS_V4(bin)) {
+            tbl->has_ipv6 = 1;
+        }
+        return;
+    }
+
+    bin->cr_bytes += rwRecGetBytes(rwrec);
+    bin->cr_packets += rwRecGetPkts(rwrec);
+    if (bin->cr_records < UINT32_MAX) {
+        ++bin->cr_records;
+    }
+    if (rwRecGetStartSeconds(rwrec) < bin->cr_start) {
+        bin->cr_start = rwRecGetStartSeconds(rwrec);
+    }
+    if (bin->cr_end < rwRecGetEndSeconds(rwrec)) {
+        bin->cr_end = rwRecGetEndSeconds(rwrec);
+    }
+}
 
 
 /*
- *  hashToIPTree(&iptree);
+ *  tableMerge(dst, src);
  *
- *    Fills in the 'iptree' with all the IPs in global hash_bins array.
+ *    Add the bins of the hash table 'src' to the hash table 'dst' and
+ *    free the slots of 'src'.
  */
 static void
-hashToIPTree(
-    skIPTree_t        **ip_tree)
+tableMerge(
+    countTable_t       *dst,
+    countTable_t       *src)
 {
+    countRecord_t *cr;
+    countRecord_t *end;
     countRecord_t *bin;
-    uint32_t i;
-
-    skIPTreeCreate(ip_tree);
 
-    for (i = 0; i < RWAC_ARRAYSIZE; i++) {
-        if (NULL != hash_bins[i]) {
-            bin = hash_bins[i];
-            do {
-                if (IS_RECORD_WITHIN_LIMITS(bin)) {
-                    skIPTreeAddAddress((*ip_tree), (bin->cr_key));
-                }
-                bin = bin->cr_next;
-            } while (bin != hash_bins[i]);
+    end = src->slots + src->size;
+    for (cr = src->slots; cr < end; ++cr) {
+        if (0 == cr->cr_records) {
+            continue;
         }
+        bin = tableFind(dst, cr->cr_key_hi, cr->cr_key_lo);
+        if (0 == bin->cr_records) {
+            *bin = *cr;
+            continue;
+        }
+        bin->cr_bytes += cr->cr_bytes;
+        bin->cr_packets += cr->cr_packets;
+        if (bin->cr_records > UINT32_MAX - cr->cr_records) {
+            bin->cr_records = UINT32_MAX;
+        } else {
+            bin->cr_records += cr->cr_records;
+        }
+        if (cr->cr_start < bin->cr_start) {
+            bin->cr_start = cr->cr_start;
+        }
+        if (bin->cr_end < cr->cr_end) {
+            bin->cr_end = cr->cr_end;
+        }
+    }
+    if (src->has_ipv6) {
+        dst->has_ipv6 = 1;
     }
+    free(src->slots);
+    src->slots = NULL;
 }
 
 
 /*
- *  int dumpRecords(outfp)
- *
- *    Dumps the addrcount contents as a record of bytes, packets,
- *    times &c to 'outfp'
- *
- *    This is the typical text output from addrcount.
+ *  tableCompact(tbl);
  *
+ *    Move the bins of the hash table 'tbl' to the start of its slots
+ *    so that they occupy the first 'count' slots.  The table may no
+ *    longer be used for lookups.
  */
-static int
-dumpRecords(
-    FILE               *outfp)
+static void
+tableCompact(
+    countTable_t       *tbl)
 {
-    int w[] = FMT_REC_WIDTH;
-    uint32_t i;
-    countRecord_t *bin;
-    char ip_st[SK_NUM2DOT_STRLEN];
-    char start_st[SKTIMESTAMP_STRLEN];
-    char end_st[SKTIMESTAMP_STRLEN];
-    skipaddr_t ipaddr;
+    uint64_t i, j;
 
-    if (no_columns) {
-        memset(w, 0, sizeof(w));
+    for (i = 0, j = 0; i < tbl->size; ++i) {
+        if (tbl->slots[i].cr_records) {
+            if (i != j) {
+                tbl->slots[j] = tbl->slots[i];
+            }
+            ++j;
+        }
     }
+    assert(j == tbl->count);
+}
 
-    if ( !no_titles) {
-        fprintf(outfp, FMT_REC_TITLE,
-                w[0], (use_dest ? "dIP" : "sIP"), delimiter,
-                w[1], "Bytes",      delimiter,
-                w[2], "Packets",    delimiter,
-                w[3], "Records",    delimiter,
-                w[4], "Start_Time", delimiter,
-                w[5], "End_Time",   final_delim);
-    }
 
-    for (i = 0; i < RWAC_ARRAYSIZE; i++) {
-        if (NULL != hash_bins[i]) {
-            bin = hash_bins[i];
-            do {
-                if (IS_RECORD_WITHIN_LIMITS(bin)) {
-                    skipaddrSetV4(&ipaddr, &bin->cr_key);
-                    fprintf(outfp, FMT_REC_VALUE,
-                            w[0], skipaddrString(ip_st, &ipaddr, ip_format),
-                            delimiter,
-                            w[1], bin->cr_bytes,   delimiter,
-                            w[2], bin->cr_packets, delimiter,
-                            w[3], bin->cr_records, delimiter,
-                            w[4], sktimestamp_r(start_st,
-                                                sktimeCreate(bin->cr_start, 0),
-                                                time_flags),
-                            delimiter,
-                            w[5], sktimestamp_r(end_st,
-                                                sktimeCreate(bin->cr_end, 0),
-                                                time_flags),
-                            final_delim);
-                }
-                bin = bin->cr_next;
-            } while (bin != hash_bins[i]);
+/*
+ *  status = tableSort(tbl);
+ *
+ *    Sort the bins of the compacted hash table 'tbl' by IP address
+ *    using a least-significant-digit radix sort on the bytes of the
+ *    key.  Only the low 32 bits of the keys are examined when the
+ *    table holds no IPv6 addresses, and a pass is skipped when every
+ *    key has the same value for that byte.  Return 0 on success, or
+ *    -1 on allocation failure.
+ */
+static int
+tableSort(
+    countTable_t       *tbl)
+{
+    uint64_t hist[256];
+    countRecord_t *tmp;
+    countRecord_t *src;
+    countRecord_t *dst;
+    countRecord_t *swap;
+    uint64_t i;
+    uint64_t offset;
+    uint64_t c;
+    unsigned int num_passes;
+    unsigned int p;
+
+    if (tbl->count < 2) {
+        return 0;
+    }
+    tmp = (countRecord_t*)malloc(tbl->count * sizeof(countRecord_t));
+    if (NULL == tmp) {
+        return -1;
+    }
+    num_passes = ((tbl->has_ipv6) ? 16 : 4);
+
+    src = tbl->slots;
+    dst = tmp;
+    for (p = 0; p < num_passes; ++p) {
+        memset(hist, 0, sizeof(hist));
+        for (i = 0; i < tbl->count; ++i) {
+            ++hist[KEY_BYTE(&src[i], p)];
+        }
+        if (hist[KEY_BYTE(&src[0], p)] == tbl->count) {
+            /* every key has the same byte */
+            continue;
+        }
+        for (i = 0, offset = 0; i < 256; ++i) {
+            c = hist[i];
+            hist[i] = offset;
+            offset += c;
         }
+        for (i = 0; i < tbl->count; ++i) {
+            dst[hist[KEY_BYTE(&src[i], p)]++] = src[i];
+        }
+        swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != tbl->slots) {
+        memcpy(tbl->slots, src, tbl->count * sizeof(countRecord_t));
     }
+    free(tmp);
     return 0;
 }
 
 
 /*
- *  int dumpRecordsSorted(outfp)
+ *  binToIP(ipaddr, bin);
+ *
+ *    Fill 'ipaddr' with the IP address that is the key of 'bin'.
+ */
+static void
+binToIP(
+    skipaddr_t         *ipaddr,
+    const countRecord_t *bin)
+{
+    uint32_t ipv4;
+#if SK_ENABLE_IPV6
+    uint8_t ipv6[16];
+    uint64_t tmp;
+
+    if (!KEY_IS_V4(bin)) {
+        tmp = hton64(bin->cr_key_hi);
+        memcpy(ipv6, &tmp, sizeof(uint64_t));
+        tmp = hton64(bin->cr_key_lo);
+        memcpy(ipv6 + sizeof(uint64_t), &tmp, sizeof(uint64_t));
+        skipaddrSetV6(ipaddr, ipv6);
+        return;
+    }
+#endif  /* SK_ENABLE_IPV6 */
+    ipv4 = (uint32_t)bin->cr_key_lo;
+    skipaddrSetV4(ipaddr, &ipv4);
+}
+
+
+/*
+ * SECTION: Dumping
+ *
+ * All the output routines are in this section of the text.  They
+ * expect the hash table to have been compacted, and sorted when the
+ * output is to be sorted.
+ */
+
+
+/*
+ *  int dumpRecords(outfp)
  *
  *    Dumps the addrcount contents as a record of bytes, packets,
- *    times &c to 'outfp', sorted by the IP address.
+ *    times &c to 'outfp'
+ *
+ *    This is the typical text output from addrcount.
  *
  */
 static int
-dumpRecordsSorted(
+dumpRecords(
     FILE               *outfp)
 {
     int w[] = FMT_REC_WIDTH;
-    uint32_t ip, key;
-    countRecord_t *bin;
-    skIPTree_t *ipset;
-    skIPTreeIterator_t iter;
+    uint64_t i;
+    const countRecord_t *bin;
     char ip_st[SK_NUM2DOT_STRLEN];
     char start_st[SKTIMESTAMP_STRLEN];
     char end_st[SKTIMESTAMP_STRLEN];
     skipaddr_t ipaddr;
 
+    if (table.has_ipv6) {
+        w[0] = IPV6_WIDTH;
+    }
     if (no_columns) {
         memset(w, 0, sizeof(w));
     }
 
-    hashToIPTree(&ipset);
-    if (skIPTreeIteratorBind(&iter, ipset)) {
-        skAppPrintErr("Unable to bind IPTree iterator");
-        skIPTreeDelete(&ipset);
-        return 1;
-    }
-
     if ( !no_titles) {
         fprintf(outfp, FMT_REC_TITLE,
                 w[0], (use_dest ? "dIP" : "sIP"), delimiter,
@@ -1167,39 +1375,25 @@ dumpRecordsSorted(
                 w[5], "End_Time",   final_delim);
     }
 
-    while (skIPTreeIteratorNext(&ip, &iter) == SK_ITERATOR_OK) {
-
-        /* find the ip's entry in the hash table */
-        key = HASHFUNC(ip);
-
-        /* loop through the list of records at this hash table entry
-         * until we find the one that has the IP we want */
-        bin = hash_bins[key];
-        while (ip != bin->cr_key) {
-            /* not the ip we wanted; goto next */
-            bin = bin->cr_next;
-            /* if we've looped all the around, we missed the
-             * IP we wanted, and things are horked */
-            assert(bin != hash_bins[key]);
+    for (i = 0, bin = table.slots; i < table.count; ++i, ++bin) {
+        if (IS_RECORD_WITHIN_LIMITS(bin)) {
+            binToIP(&ipaddr, bin);
+            fprintf(outfp, FMT_REC_VALUE,
+                    w[0], skipaddrString(ip_st, &ipaddr, ip_format),
+                    delimiter,
+                    w[1], bin->cr_bytes,   delimiter,
+                    w[2], bin->cr_packets, delimiter,
+                    w[3], bin->cr_records, delimiter,
+                    w[4], sktimestamp_r(start_st,
+                                        sktimeCreate(bin->cr_start, 0),
+                                        time_flags),
+                    delimiter,
+                    w[5], sktimestamp_r(end_st,
+                                        sktimeCreate(bin->cr_end, 0),
+                                        time_flags),
+                    final_delim);
         }
-
-        skipaddrSetV4(&ipaddr, &bin->cr_key);
-        fprintf(outfp, FMT_REC_VALUE,
-                w[0], skipaddrString(ip_st, &ipaddr, ip_format), delimiter,
-                w[1], bin->cr_bytes,   delimiter,
-                w[2], bin->cr_packets, delimiter,
-                w[3], bin->cr_records, delimiter,
-                w[4], sktimestamp_r(start_st,
-                                    sktimeCreate(bin->cr_start, 0),
-                                    time_flags),
-                delimiter,
-                w[5], sktimestamp_r(end_st,
-                                    sktimeCreate(bin->cr_end, 0),
-                                    time_flags),
-                final_delim);
-    }
-
-    skIPTreeDelete(&ipset);
+    }
     return 0;
 }
 
@@ -1207,8 +1401,7 @@ dumpRecordsSorted(
 /*
  *  int dumpIPs(outfp)
  *
- *    writes IP addresses to the stream 'outfp' in hash-table order
- *    (unsorted).
+ *    writes IP addresses to the stream 'outfp'.
  *
  *    Returns 0 on success.
  */
@@ -1216,68 +1409,27 @@ static int
 dumpIPs(
     FILE               *outfp)
 {
-    uint32_t i;
-    countRecord_t *bin;
+    uint64_t i;
+    const countRecord_t *bin;
     char ip_st[SK_NUM2DOT_STRLEN];
     skipaddr_t ipaddr;
+    int w = ((table.has_ipv6) ? IPV6_WIDTH : 15);
 
     if ( !no_titles) {
-        fprintf(outfp, "%15s\n", (use_dest ? "dIP" : "sIP"));
+        fprintf(outfp, "%*s\n", w, (use_dest ? "dIP" : "sIP"));
     }
 
-    for (i = 0; i < RWAC_ARRAYSIZE; i++) {
-        if (NULL != hash_bins[i]) {
-            bin = hash_bins[i];
-            do {
-                if (IS_RECORD_WITHIN_LIMITS(bin)) {
-                    skipaddrSetV4(&ipaddr, &bin->cr_key);
-                    fprintf(outfp, "%15s\n",
-                            skipaddrString(ip_st, &ipaddr, ip_format));
-                }
-                bin = bin->cr_next;
-            } while (bin != hash_bins[i]);
+    for (i = 0, bin = table.slots; i < table.count; ++i, ++bin) {
+        if (IS_RECORD_WITHIN_LIMITS(bin)) {
+            binToIP(&ipaddr, bin);
+            fprintf(outfp, "%*s\n",
+                    w, skipaddrString(ip_st, &ipaddr, ip_format));
         }
     }
     return 0;
 }
 
 
-/*
- *  int dumpIPsSorted(outfp)
- *
- *    Writes the IPs to the stream 'outfp' in sorted order.
- *
- */
-static int
-dumpIPsSorted(
-    FILE               *outfp)
-{
-    uint32_t ip;
-    skIPTree_t *ipset;
-    skIPTreeIterator_t iter;
-    char ip_st[SK_NUM2DOT_STRLEN];
-    skipaddr_t ipaddr;
-
-    hashToIPTree(&ipset);
-    if (skIPTreeIteratorBind(&iter, ipset)) {
-        skAppPrintErr("Unable to create IPTree iterator");
-        skIPTreeDelete(&ipset);
-        return 1;
-    }
-
-    if ( !no_titles) {
-        fprintf(outfp, "%15s\n", (use_dest ? "dIP" : "sIP"));
-    }
-    while (skIPTreeIteratorNext(&ip, &iter) == SK_ITERATOR_OK) {
-        skipaddrSetV4(&ipaddr, &ip);
-        fprintf(outfp, "%15s\n", skipaddrString(ip_st, &ipaddr, ip_format));
-    }
-
-    skIPTreeDelete(&ipset);
-    return 0;
-}
-
-
 /*
  *  int dumpStats(outfp)
  *
@@ -1289,12 +1441,12 @@ dumpStats(
     FILE               *outfp)
 {
     int fmt_width[] = FMT_STAT_WIDTH;
-    uint32_t i;
-    uint32_t qual_ips;
-    uint32_t tot_ips;
+    uint64_t i;
+    uint64_t qual_ips;
+    uint64_t tot_ips;
     uint64_t qual_bytes, qual_packets, qual_records;
     uint64_t tot_bytes,  tot_packets,  tot_records;
-    countRecord_t *bin;
+    const countRecord_t *bin;
 
     qual_ips = 0;
     tot_ips = 0;
@@ -1304,23 +1456,17 @@ dumpStats(
     if (no_columns) {
         memset(fmt_width, 0, sizeof(fmt_width));
     }
-    for (i = 0; i < RWAC_ARRAYSIZE; i++) {
-        if (NULL != hash_bins[i]) {
-            bin = hash_bins[i];
-            do {
-                ++tot_ips;
-                tot_bytes   += bin->cr_bytes;
-                tot_packets += bin->cr_packets;
-                tot_records += bin->cr_records;
-
-                if (IS_RECORD_WITHIN_LIMITS(bin)) {
-                    ++qual_ips;
-                    qual_bytes   += bin->cr_bytes;
-                    qual_packets += bin->cr_packets;
-                    qual_records += bin->cr_records;
-                }
-                bin = bin->cr_next;
-            } while (bin != hash_bins[i]);
+    for (i = 0, bin = table.slots; i < table.count; ++i, ++bin) {
+        ++tot_ips;
+        tot_bytes   += bin->cr_bytes;
+        tot_packets += bin->cr_packets;
+        tot_records += bin->cr_records;
+
+        if (IS_RECORD_WITHIN_LIMITS(bin)) {
+            ++qual_ips;
+            qual_bytes   += bin->cr_bytes;
+            qual_packets += bin->cr_packets;
+            qual_records += bin->cr_records;
         }
     }
 
@@ -1368,74 +1514,70 @@ static int
 dumpIPSet(
     const char         *path)
 {
-    skIPTree_t *ipset;
+    skipset_t *ipset;
+    const countRecord_t *bin;
+    skipaddr_t ipaddr;
+    uint64_t i;
+    int rv;
 
-    /* Create the ip tree */
-    hashToIPTree(&ipset);
+    rv = skIPSetCreate(&ipset, table.has_ipv6);
+    if (rv) {
+        skAppPrintErr("Unable to create IPset: %s", skIPSetStrerror(rv));
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0, bin = table.slots; i < table.count; ++i, ++bin) {
+        if (IS_RECORD_WITHIN_LIMITS(bin)) {
+            binToIP(&ipaddr, bin);
+            rv = skIPSetInsertAddress(ipset, &ipaddr, 0);
+            if (rv) {
+                skAppPrintErr("Unable to add IP to IPset: %s",
+                              skIPSetStrerror(rv));
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    skIPSetClean(ipset);
 
     /*
      * Okay, now we write to disk.
      */
-    if (skIPTreeSave(ipset, path)) {
+    rv = skIPSetSave(ipset, path);
+    if (rv) {
+        skAppPrintErr("Unable to write IPset to '%s': %s",
+                      path, skIPSetStrerror(rv));
         exit(EXIT_FAILURE);
     }
 
-    skIPTreeDelete(&ipset);
+    skIPSetDestroy(&ipset);
     return 0;
 }
 
 
 /*
- *  void countFile(stream)
+ * SECTION: Counting
+ */
+
+
+/*
+ *  void countFile(tbl, stream)
  *
- *    Read the flow records from stream and fill the hash table with
- *    countRecord_t's.
+ *    Read the flow records from stream and add them to the hash table
+ *    'tbl'.
  */
 static void
 countFile(
+    countTable_t       *tbl,
     skstream_t         *rwIOS)
 {
-    uint32_t hash_idx;
-    countRecord_t *bin;
     rwRec rwrec;
     int rv;
 
+    skStreamSetIPv6Policy(rwIOS, ipv6_policy);
+
     /* Read records */
     while ((rv = skStreamReadRecord(rwIOS, &rwrec)) == SKSTREAM_OK) {
-        hash_idx = HASHFUNC(GETIP(&rwrec));
-
-        /*
-         * standard hash foo - check to see if we've got a value.
-         * If not, create and stuff.  If so, check to see if they
-         * match - if so, stuff.  If not, move down until you do -
-         * if you find nothing, stuff.
-         */
-        if (hash_bins[hash_idx] == NULL) {
-            /* new bin */
-            hash_bins[hash_idx] = newBin(&rwrec);
-            hash_bins[hash_idx]->cr_next = hash_bins[hash_idx];
-        } else {
-            /* hash collision */
-            bin = hash_bins[hash_idx];
-            while ((bin->cr_next != hash_bins[hash_idx]) &&
-                   !CMPFNC(&rwrec, bin))
-            {
-                bin = bin->cr_next;
-            }
-            /*
-             * Alright, we've either hit the end of the linked
-             * list or we've found the value (or both).  Check if
-             * we found the value. */
-            if (CMPFNC(&rwrec, bin)) {
-                addToBin(bin, &rwrec);
-            } else {
-                assert(bin->cr_next == hash_bins[hash_idx]);
-                bin->cr_next = newBin(&rwrec);
-                bin = bin->cr_next;
-                bin->cr_next = hash_bins[hash_idx]; /* Restore the loop */
-            }
-            hash_bins[hash_idx] = bin;
-        }
+        addRecord(tbl, &rwrec);
     }
     if (rv != SKSTREAM_ERR_EOF) {
         skStreamPrintLastErr(rwIOS, rv, &skAppPrintErr);
@@ -1443,6 +1585,111 @@ countFile(
 }
 
 
+/*
+ *  workerThread(thread);
+ *
+ *    THREAD ENTRY POINT.
+ *
+ *    Count the records of the input files into the hash table of the
+ *    countThread_t 'thread' until there are no more files.
+ */
+static void *
+workerThread(
+    void               *v_thread)
+{
+    countThread_t *thr = (countThread_t*)v_thread;
+    skstream_t *rwios;
+    int rv;
+
+    for (;;) {
+        pthread_mutex_lock(&next_file_mutex);
+        rv = skOptionsCtxNextSilkFile(optctx, &rwios, &skAppPrintErr);
+        pthread_mutex_unlock(&next_file_mutex);
+        if (rv) {
+            if (rv < 0) {
+                thr->rv = rv;
+            }
+            break;
+        }
+        /* create the table once the thread has a file to count */
+        if (NULL == thr->table.slots && tableCreate(&thr->table)) {
+            skAppPrintOutOfMemory("hash table");
+            exit(EXIT_FAILURE);
+        }
+        countFile(&thr->table, rwios);
+        skStreamDestroy(&rwios);
+    }
+
+    return NULL;
+}
+
+
+/*
+ *  status = countThreads();
+ *
+ *    Spawn 'thread_count' threads that each count records into their
+ *    own hash table, then merge the tables into the global table.
+ *    Return 0 on success, or non-zero if a file could not be opened.
+ */
+static int
+countThreads(
+    void)
+{
+    countThread_t *thread;
+    uint32_t started;
+    uint32_t j;
+    int rv = 0;
+
+    thread = (countThread_t*)calloc(thread_count, sizeof(countThread_t));
+    if (NULL == thread) {
+        skAppPrintOutOfMemory("thread data");
+        return -1;
+    }
+
+    /* the first thread uses the global table; the others create
+     * their tables when they get a file */
+    thread[0].table = table;
+
+    /* if a thread cannot be created, the threads that were started
+     * count all the files; if none was, the main thread does */
+    for (started = 0; started < thread_count; ++started) {
+        if (pthread_create(&thread[started].thread, NULL, &workerThread,
+                           &thread[started]))
+        {
+            skAppPrintErr("Unable to create worker thread; using %" PRIu32
+                          " thread%s", (started ? started : 1),
+                          ((started > 1) ? "s" : ""));
+            break;
+        }
+    }
+    if (0 == started) {
+        workerThread(&thread[0]);
+    }
+    for (j = 0; j < thread_count; ++j) {
+        if (j < started) {
+            pthread_join(thread[j].thread, NULL);
+        }
+        if (thread[j].rv) {
+            rv = thread[j].rv;
+        }
+    }
+
+    /* merge the smaller tables into the largest one */
+    table = thread[0].table;
+    for (j = 1; j < thread_count; ++j) {
+        if (thread[j].table.count > table.count) {
+            tableMerge(&thread[j].table, &table);
+            table = thread[j].table;
+        } else {
+            tableMerge(&table, &thread[j].table);
+        }
+    }
+    free(thread);
+
+    return rv;
+}
+
+
 int main(int argc, char **argv)
 {
     skstream_t *rwios;
@@ -1451,15 +1698,36 @@ int main(int argc, char **argv)
     appSetup(argc, argv);                 /* never returns on error */
 
     /* Read in records from all input files */
-    while ((rv = skOptionsCtxNextSilkFile(optctx, &rwios, &skAppPrintErr))
-           == 0)
-    {
-        skStreamSetIPv6Policy(rwios, SK_IPV6POLICY_ASV4);
-        countFile(rwios);
-        skStreamDestroy(&rwios);
+    if (thread_count > 1) {
+        if (countThreads()) {
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        while ((rv = skOptionsCtxNextSilkFile(optctx, &rwios,
+                                              &skAppPrintErr))
+               == 0)
+        {
+            countFile(&table, rwios);
+            skStreamDestroy(&rwios);
+        }
+        if (rv < 0) {
+            exit(EXIT_FAILURE);
+        }
     }
-    if (rv < 0) {
-        exit(EXIT_FAILURE);
+
+    /* Gather the bins at the front of the table, and sort them by IP
+     * when requested */
+    tableCompact(&table);
+    switch (print_mode) {
+      case RWAC_PMODE_SORTED_RECORDS:
+      case RWAC_PMODE_SORTED_IPS:
+        if (tableSort(&table)) {
+            skAppPrintOutOfMemory("sort buffer");
+            exit(EXIT_FAILURE);
+        }
+        break;
+      default:
+        break;
     }
 
     /* Invoke the pager when appropriate. */
@@ -1491,16 +1759,12 @@ int main(int argc, char **argv)
         dumpIPSet(ipset_file);
         break;
       case RWAC_PMODE_RECORDS:
+      case RWAC_PMODE_SORTED_RECORDS:
         dumpRecords(output.of_fp);
         break;
       case RWAC_PMODE_IPS:
-        dumpIPs(output.of_fp);
-        break;
-      case RWAC_PMODE_SORTED_RECORDS:
-        dumpRecordsSorted(output.of_fp);
-        break;
       case RWAC_PMODE_SORTED_IPS:
-        dumpIPsSorted(output.of_fp);
+        dumpIPs(output.of_fp);
         break;
       case RWAC_PMODE_NONE:
         skAbortBadCase(print_mode);
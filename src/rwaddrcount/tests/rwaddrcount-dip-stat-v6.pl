@@ -0,0 +1,15 @@
+#! /usr/bin/perl -w
+# MD5: f869dfd34aaeeb41a8dc60e3550f0bae
+# TEST: ./rwaddrcount --print-stat --use-dest ../../tests/data-v6.rwf
+
+use strict;
+use SiLKTests;
+
+my $rwaddrcount = check_silk_app('rwaddrcount');
+my %file;
+$file{v6data} = get_data_or_exit77('v6data');
+check_features(qw(ipv6));
+my $cmd = "$rwaddrcount --print-stat --use-dest $file{v6data}";
+my $md5 = "f869dfd34aaeeb41a8dc60e3550f0bae";
+
+check_md5_output($md5, $cmd);
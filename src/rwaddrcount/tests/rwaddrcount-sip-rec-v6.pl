@@ -0,0 +1,15 @@
+#! /usr/bin/perl -w
+# MD5: 30588bde2f8cc1e0bd0c353d82900343
+# TEST: ./rwaddrcount --print-rec --sort-ips ../../tests/data-v6.rwf
+
+use strict;
+use SiLKTests;
+
+my $rwaddrcount = check_silk_app('rwaddrcount');
+my %file;
+$file{v6data} = get_data_or_exit77('v6data');
+check_features(qw(ipv6));
+my $cmd = "$rwaddrcount --print-rec --sort-ips $file{v6data}";
+my $md5 = "30588bde2f8cc1e0bd0c353d82900343";
+
+check_md5_output($md5, $cmd);
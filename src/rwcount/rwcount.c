@@ -83,21 +83,22 @@ RCSIDENT("$SiLK: rwcount.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 /* Maximum possible number of bins */
 #define BIN_COUNT_MAX ((uint32_t)(UINT32_MAX / sizeof(count_bin_t)))
 
-/* note that the variables are defined below */
-#define GET_BIN(gb_t)                                           \
-    ((uint32_t)(((gb_t) - bins.window_min) / bins.size))
+/* Return the index of the bin in the count_data_t 'gb_d' that holds
+ * the time 'gb_t' */
+#define GET_BIN(gb_d, gb_t)                                     \
+    ((uint32_t)(((gb_t) - (gb_d)->window_min) / (gb_d)->size))
 
 /* This macro is TRUE if the time '_t' is too large (or too small) to
- * fit into the current countFile 'data' */
-#define TIME_OUT_OF_RANGE(toor_t)               \
-    (((toor_t) < bins.window_min)               \
-     || ((toor_t) >= bins.window_max))
+ * fit into the count_data_t 'toor_d' */
+#define TIME_OUT_OF_RANGE(toor_d, toor_t)       \
+    (((toor_t) < (toor_d)->window_min)          \
+     || ((toor_t) >= (toor_d)->window_max))
 
 /* This macro is true if the flow whose start time is '_s' and end
  * time is '_e' is outside the range the user is interested in */
-#define IGNORE_FLOW(ign_s, ign_e)               \
-    (((ign_e) < (bins.start_time))              \
-     || ((ign_s) >= (bins.end_time)))
+#define IGNORE_FLOW(ign_d, ign_s, ign_e)        \
+    (((ign_e) < ((ign_d)->start_time))          \
+     || ((ign_s) >= ((ign_d)->end_time)))
 
 
 /* EXPORTED VARIABLES */
@@ -108,6 +109,8 @@ count_flags_t flags;
 
 sk_options_ctx_t *optctx;
 
+uint32_t thread_count = 1;
+
 
 /* OPTIONS SETUP */
 
@@ -123,7 +126,7 @@ sk_options_ctx_t *optctx;
  *
  *    Returns 0 on success, or -1 for failure.
  */
-static int
+int
 initBins(
     sktime_t            start_time)
 {
@@ -217,14 +220,18 @@ initBins(
 
 
 /*
- *  reallocBins(time);
+ *  reallocBins(cdata, time);
  *
- *    Reallocate memory for the bins so that the bins will hold 'time'.
+ *    Reallocate memory for the bins in 'cdata' so that the bins will
+ *    hold 'time'.  The window is always grown by a whole number of
+ *    bins, so count_data_t objects that start from the same window
+ *    remain aligned with one another.
  *
  *    Exits application if realloc fails.
  */
-static void
+void
 reallocBins(
+    count_data_t       *cdata,
     sktime_t            t)
 {
     count_bin_t *new_ptr;
@@ -232,86 +239,87 @@ reallocBins(
     int64_t new_count;
     sktime_t new_window_min;
 
-    assert(TIME_OUT_OF_RANGE(t));
+    assert(TIME_OUT_OF_RANGE(cdata, t));
 
     /* Always extend the rear of array, no matter which end we
      * actually overflow on.  Afterwards, we'll check if it's the
      * front, and shift data around. */
 
-    if (t < bins.window_min) {
+    if (t < cdata->window_min) {
         /* To extend front, we want to add enough room to cover the
          * time we're trying to insert. */
-        extension_bins = 1 + (bins.window_min - t) / bins.size;
+        extension_bins = 1 + (cdata->window_min - t) / cdata->size;
         if (extension_bins < BIN_COUNT_STD) {
-            new_count = bins.count + BIN_COUNT_STD;
+            new_count = cdata->count + BIN_COUNT_STD;
         } else {
-            new_count = bins.count + extension_bins;
+            new_count = cdata->count + extension_bins;
         }
-        new_window_min = (bins.window_min
-                          - ((new_count - bins.count) * bins.size));
+        new_window_min = (cdata->window_min
+                          - ((new_count - cdata->count) * cdata->size));
     } else {
         /* To extend rear, we want to add enough room to cover the
          * time we're trying to insert, plus an additional 30 days.
          * Slightly different calc since we don't have the
          * window_max. */
-        extension_bins = 1 + (t - bins.window_max) / bins.size;
+        extension_bins = 1 + (t - cdata->window_max) / cdata->size;
         if (extension_bins < BIN_COUNT_STD) {
-            new_count = bins.count + BIN_COUNT_STD;
+            new_count = cdata->count + BIN_COUNT_STD;
         } else {
-            new_count = bins.count + extension_bins;
+            new_count = cdata->count + extension_bins;
         }
-        new_window_min = bins.window_min;
+        new_window_min = cdata->window_min;
     }
 
     /* When end_time is set, adjust the bin count so it doesn't go
      * beyond the end_time */
-    if ((bins.end_time != RWCO_UNINIT_END)
-        && (new_window_min + bins.size * new_count) > bins.end_time)
+    if ((cdata->end_time != RWCO_UNINIT_END)
+        && (new_window_min + cdata->size * new_count) > cdata->end_time)
     {
-        new_count = 1 + (bins.end_time - new_window_min) / bins.size;
+        new_count = 1 + (cdata->end_time - new_window_min) / cdata->size;
     }
 
     if (new_count > BIN_COUNT_MAX) {
         new_count = BIN_COUNT_MAX;
-        if (new_count - bins.count < extension_bins) {
+        if (new_count - cdata->count < extension_bins) {
             goto MEM_FAILURE;
         }
     }
 
     /* Allocate */
     while (NULL == (new_ptr = (count_bin_t*)realloc(
-                        bins.data, (new_count *sizeof(count_bin_t)))))
+                        cdata->data, (new_count *sizeof(count_bin_t)))))
     {
-        if (new_count == bins.count + extension_bins) {
+        if (new_count == cdata->count + extension_bins) {
             goto MEM_FAILURE;
         }
         /* reduce the growth factor by 2 */
-        new_count -= (new_count - bins.count) / 2;
-        if (new_count < (bins.count + extension_bins)) {
-            new_count = bins.count + extension_bins;
+        new_count -= (new_count - cdata->count) / 2;
+        if (new_count < (cdata->count + extension_bins)) {
+            new_count = cdata->count + extension_bins;
         }
     }
 
     /* Compute the number of bins we actually added */
-    extension_bins = new_count - bins.count;
+    extension_bins = new_count - cdata->count;
 
-    if (t < bins.window_min) {
+    if (t < cdata->window_min) {
         /* Shift the data so that the newly allocated empty space is
          * at the front of the array. */
         memmove((new_ptr + extension_bins), new_ptr,
-                (bins.count * sizeof(count_bin_t)));
+                (cdata->count * sizeof(count_bin_t)));
         /* Clear the space that we just moved the data out of */
         memset(new_ptr, 0, (extension_bins * sizeof(count_bin_t)));
     } else {
         /* Clear the newly allocated space */
-        memset((new_ptr+bins.count), 0, (extension_bins*sizeof(count_bin_t)));
+        memset((new_ptr + cdata->count), 0,
+               (extension_bins * sizeof(count_bin_t)));
     }
 
     /* Adjust the values */
-    bins.count = new_count;
-    bins.window_min = new_window_min;
-    bins.window_max = bins.window_min + bins.size * bins.count;
-    bins.data = new_ptr;
+    cdata->count = new_count;
+    cdata->window_min = new_window_min;
+    cdata->window_max = cdata->window_min + cdata->size * cdata->count;
+    cdata->data = new_ptr;
 
     return;
 
@@ -321,7 +329,8 @@ reallocBins(
         skAppPrintErr(("Cannot allocate %" PRId64 " bins required to hold\n"
                        "\tdata from %s to %s"),
                       extension_bins, sktimestamp_r(buf, new_window_min, 0),
-                      sktimestamp(new_window_min + bins.size * new_count, 0));
+                      sktimestamp((new_window_min + cdata->size * new_count),
+                                  0));
 #if 0
 /*
 **      if (bins.start_time == RWCO_UNINIT_START) {
@@ -355,91 +364,94 @@ reallocBins(
 
 
 /*
- *  startAdd(rwrec);
+ *  startAdd(cdata, rwrec);
  *
  *    Add the record and its byte and packet counts to the first bin
  *    relevant to the record.
  */
 static void
 startAdd(
+    count_data_t       *cdata,
     const rwRec        *rwrec)
 {
     uint32_t bin;
     sktime_t t = rwRecGetStartTime(rwrec);
 
-    if (IGNORE_FLOW(t, t)) {
+    if (IGNORE_FLOW(cdata, t, t)) {
         /* user not interested in this flow */
         return;
     }
 
-    if (TIME_OUT_OF_RANGE(t)) {
-        reallocBins(t);
+    if (TIME_OUT_OF_RANGE(cdata, t)) {
+        reallocBins(cdata, t);
     }
-    bin = GET_BIN(t);
-    bins.data[bin].flows++;
-    bins.data[bin].bytes += rwRecGetBytes(rwrec);
-    bins.data[bin].pkts += rwRecGetPkts(rwrec);
+    bin = GET_BIN(cdata, t);
+    cdata->data[bin].flows++;
+    cdata->data[bin].bytes += rwRecGetBytes(rwrec);
+    cdata->data[bin].pkts += rwRecGetPkts(rwrec);
 }
 
 
 /*
- *  endAdd(rwrec);
+ *  endAdd(cdata, rwrec);
  *
  *    Add the record and its byte and packet counts to the final bin
  *    relevant to the record.
  */
 static void
 endAdd(
+    count_data_t       *cdata,
     const rwRec        *rwrec)
 {
     uint32_t bin;
     sktime_t t = rwRecGetEndTime(rwrec);
 
-    if (IGNORE_FLOW(t, t)) {
+    if (IGNORE_FLOW(cdata, t, t)) {
         /* user not interested in this flow */
         return;
     }
 
-    if (TIME_OUT_OF_RANGE(t)) {
-        reallocBins(t);
+    if (TIME_OUT_OF_RANGE(cdata, t)) {
+        reallocBins(cdata, t);
     }
-    bin = GET_BIN(t);
-    bins.data[bin].flows++;
-    bins.data[bin].bytes += rwRecGetBytes(rwrec);
-    bins.data[bin].pkts += rwRecGetPkts(rwrec);
+    bin = GET_BIN(cdata, t);
+    cdata->data[bin].flows++;
+    cdata->data[bin].bytes += rwRecGetBytes(rwrec);
+    cdata->data[bin].pkts += rwRecGetPkts(rwrec);
 }
 
 
 /*
- *  middleAdd(rwrec);
+ *  middleAdd(cdata, rwrec);
  *
  *    Add the record and its byte and packet counts to the middle bin
  *    relevant to the flow.
  */
 static void
 middleAdd(
+    count_data_t       *cdata,
     const rwRec        *rwrec)
 {
     uint32_t bin;
     sktime_t t = rwRecGetStartTime(rwrec) + (rwRecGetElapsed(rwrec) / 2);
 
-    if (IGNORE_FLOW(t, t)) {
+    if (IGNORE_FLOW(cdata, t, t)) {
         /* user not interested in this flow */
         return;
     }
 
-    if (TIME_OUT_OF_RANGE(t)) {
-        reallocBins(t);
+    if (TIME_OUT_OF_RANGE(cdata, t)) {
+        reallocBins(cdata, t);
     }
-    bin = GET_BIN(t);
-    bins.data[bin].flows++;
-    bins.data[bin].bytes += rwRecGetBytes(rwrec);
-    bins.data[bin].pkts += rwRecGetPkts(rwrec);
+    bin = GET_BIN(cdata, t);
+    cdata->data[bin].flows++;
+    cdata->data[bin].bytes += rwRecGetBytes(rwrec);
+    cdata->data[bin].pkts += rwRecGetPkts(rwrec);
 }
 
 
 /*
- *  meanAdd(rwrec);
+ *  meanAdd(cdata, rwrec);
  *
  *    Equally distribute the record among all the BINs by adding the
  *    mean of the bytes and packets to each bin.  Note that a
@@ -448,6 +460,7 @@ middleAdd(
  */
 static void
 meanAdd(
+    count_data_t       *cdata,
     const rwRec        *rwrec)
 {
     uint32_t start_bin, end_bin, i;
@@ -456,47 +469,47 @@ meanAdd(
     sktime_t eTime = rwRecGetEndTime(rwrec);
     double flows, bytes, pkts;
 
-    if (IGNORE_FLOW(sTime, eTime)) {
+    if (IGNORE_FLOW(cdata, sTime, eTime)) {
         /* user not interested in this flow */
         return;
     }
 
-    if (sTime < bins.start_time) {
+    if (sTime < cdata->start_time) {
         /* the flow started before the time we care about. Increase
          * 'extra_bins' by the number of bins the flow covers before
          * the start_time (==window_min).  To compute 'extra_bins',
          * expand the GET_BIN() macro but reverse the times. */
         start_bin = 0;
-        extra_bins += 1 + ((bins.window_min - sTime) / bins.size);
+        extra_bins += 1 + ((cdata->window_min - sTime) / cdata->size);
     } else {
         /* maybe grow the bins to allow for the start time */
-        if (TIME_OUT_OF_RANGE(sTime)) {
-            reallocBins(sTime);
+        if (TIME_OUT_OF_RANGE(cdata, sTime)) {
+            reallocBins(cdata, sTime);
         }
-        start_bin = GET_BIN(sTime);
+        start_bin = GET_BIN(cdata, sTime);
     }
 
     /* find the ending bin, reallocating the bins if needed */
-    if (eTime >= bins.end_time) {
+    if (eTime >= cdata->end_time) {
         /* set 'end_bin' to the final bin.  Increase 'extra_bins' by
          * the bins beyond the time window. */
-        end_bin = bins.count - 1;
-        extra_bins += 1 + ((eTime - bins.window_max) / bins.size);
+        end_bin = cdata->count - 1;
+        extra_bins += 1 + ((eTime - cdata->window_max) / cdata->size);
     } else {
-        if (TIME_OUT_OF_RANGE(eTime)) {
-            reallocBins(eTime);
+        if (TIME_OUT_OF_RANGE(cdata, eTime)) {
+            reallocBins(cdata, eTime);
         }
-        end_bin = GET_BIN(eTime);
+        end_bin = GET_BIN(cdata, eTime);
     }
 
     assert(start_bin <= end_bin);
-    assert(end_bin < bins.count);
+    assert(end_bin < cdata->count);
 
     if ((start_bin == end_bin) && (0 == extra_bins)) {
         /* handle simple case where everything is in one bin */
-        bins.data[start_bin].flows++;
-        bins.data[start_bin].bytes += rwRecGetBytes(rwrec);
-        bins.data[start_bin].pkts += rwRecGetPkts(rwrec);
+        cdata->data[start_bin].flows++;
+        cdata->data[start_bin].bytes += rwRecGetBytes(rwrec);
+        cdata->data[start_bin].pkts += rwRecGetPkts(rwrec);
         return;
     }
 
@@ -512,15 +525,15 @@ meanAdd(
     pkts = (double)rwRecGetPkts(rwrec) * flows;
 
     for (i = start_bin; i <= end_bin; ++i) {
-        bins.data[i].flows += flows;
-        bins.data[i].bytes += bytes;
-        bins.data[i].pkts += pkts;
+        cdata->data[i].flows += flows;
+        cdata->data[i].bytes += bytes;
+        cdata->data[i].pkts += pkts;
     }
 }
 
 
 /*
- *  durationAdd(rwrec);
+ *  durationAdd(cdata, rwrec);
  *
  *    Divide the flow evenly across each millisecond in the flow, and
  *    then apply that value to each bin according to the number of
@@ -528,6 +541,7 @@ meanAdd(
  */
 static void
 durationAdd(
+    count_data_t       *cdata,
     const rwRec        *rwrec)
 {
     uint32_t start_bin, end_bin, i;
@@ -536,53 +550,53 @@ durationAdd(
     double flows, bytes, pkts;
     double ratio;
 
-    if (IGNORE_FLOW(sTime, eTime)) {
+    if (IGNORE_FLOW(cdata, sTime, eTime)) {
         /* user not interested in this flow */
         return;
     }
 
     /* find the starting bin, reallocating the bins if needed */
-    if (sTime < bins.start_time) {
+    if (sTime < cdata->start_time) {
         /* flow started before the time we care about */
         start_bin = 0;
     } else {
-        if (TIME_OUT_OF_RANGE(sTime)) {
-            reallocBins(sTime);
+        if (TIME_OUT_OF_RANGE(cdata, sTime)) {
+            reallocBins(cdata, sTime);
         }
-        start_bin = GET_BIN(sTime);
+        start_bin = GET_BIN(cdata, sTime);
     }
 
     /* find the ending bin, reallocating the bins if needed */
-    if (eTime >= bins.end_time) {
+    if (eTime >= cdata->end_time) {
         /* put end_bin beyond end of array */
-        end_bin = GET_BIN(bins.window_max);
+        end_bin = GET_BIN(cdata, cdata->window_max);
     } else {
-        if (TIME_OUT_OF_RANGE(eTime)) {
-            reallocBins(eTime);
+        if (TIME_OUT_OF_RANGE(cdata, eTime)) {
+            reallocBins(cdata, eTime);
         }
-        end_bin = GET_BIN(eTime);
+        end_bin = GET_BIN(cdata, eTime);
     }
 
     /* handle the simple case where everything is in one bin */
     if ((start_bin == end_bin)
-        && (sTime >= bins.start_time)
-        && (eTime < bins.end_time))
+        && (sTime >= cdata->start_time)
+        && (eTime < cdata->end_time))
     {
-        bins.data[start_bin].flows++;
-        bins.data[start_bin].bytes += rwRecGetBytes(rwrec);
-        bins.data[start_bin].pkts += rwRecGetPkts(rwrec);
+        cdata->data[start_bin].flows++;
+        cdata->data[start_bin].bytes += rwRecGetBytes(rwrec);
+        cdata->data[start_bin].pkts += rwRecGetPkts(rwrec);
         return;
     }
 
     /* calculate the amount of data in a fully covered bin by
      * calculating the data per millisecond and multiplying that by
      * the bin size */
-    flows = (double)bins.size / (double)(1 + eTime - sTime);
+    flows = (double)cdata->size / (double)(1 + eTime - sTime);
     bytes = (double)rwRecGetBytes(rwrec) * flows;
     pkts = (double)rwRecGetPkts(rwrec) * flows;
 
 
-    if (sTime >= bins.start_time) {
+    if (sTime >= cdata->start_time) {
         /* handle the part of the flow that partially occurs in the
          * start_bin: find the "floating point" start bin, subtract
          * the "integer" start_bin from that, and then subtract that
@@ -591,25 +605,27 @@ durationAdd(
          * r = 1.0 - (((sTime - window_min) / bin_size) - start_bin)
          */
         ratio = ((double)start_bin + 1.0
-                 - ((double)(sTime - bins.window_min) / (double)bins.size));
-        bins.data[start_bin].flows += ratio * flows;
-        bins.data[start_bin].bytes += ratio * bytes;
-        bins.data[start_bin].pkts += ratio * pkts;
+                 - ((double)(sTime - cdata->window_min)
+                    / (double)cdata->size));
+        cdata->data[start_bin].flows += ratio * flows;
+        cdata->data[start_bin].bytes += ratio * bytes;
+        cdata->data[start_bin].pkts += ratio * pkts;
 
         /* move start_bin to first complete bin */
         ++start_bin;
     }
 
-    if (eTime < bins.end_time) {
+    if (eTime < cdata->end_time) {
         /* handle the part of the flow that partially occurs in the
          * end_bin: calculation is similar to that for start_bin.  Add
          * a millisecond here since at least part of the flow must be
          * active in this bin. */
-        ratio = (((double)(eTime + 1 - bins.window_min) / (double)bins.size)
+        ratio = (((double)(eTime + 1 - cdata->window_min)
+                  / (double)cdata->size)
                  - (double)(end_bin));
-        bins.data[end_bin].flows += ratio * flows;
-        bins.data[end_bin].bytes += ratio * bytes;
-        bins.data[end_bin].pkts += ratio * pkts;
+        cdata->data[end_bin].flows += ratio * flows;
+        cdata->data[end_bin].bytes += ratio * bytes;
+        cdata->data[end_bin].pkts += ratio * pkts;
 
         /* don't move end_bin; we'll stop when we get to it */
     }
@@ -621,15 +637,15 @@ durationAdd(
 
     /* Handle the bins that had complete coverage */
     for (i = start_bin; i < end_bin; ++i) {
-        bins.data[i].flows += flows;
-        bins.data[i].bytes += bytes;
-        bins.data[i].pkts += pkts;
+        cdata->data[i].flows += flows;
+        cdata->data[i].bytes += bytes;
+        cdata->data[i].pkts += pkts;
     }
 }
 
 
 /*
- *  maximumAdd(rwrec);
+ *  maximumAdd(cdata, rwrec);
  *
  *    Add the flow record and its complete packet and byte count to
  *    EVERY bin where the flow is active.  This will allow one to see
@@ -638,53 +654,54 @@ durationAdd(
  */
 static void
 maximumAdd(
+    count_data_t       *cdata,
     const rwRec        *rwrec)
 {
     uint32_t start_bin, end_bin, i;
     sktime_t sTime = rwRecGetStartTime(rwrec);
     sktime_t eTime = rwRecGetEndTime(rwrec);
 
-    if (IGNORE_FLOW(sTime, eTime)) {
+    if (IGNORE_FLOW(cdata, sTime, eTime)) {
         /* user not interested in this flow */
         return;
     }
 
-    if (sTime < bins.start_time) {
+    if (sTime < cdata->start_time) {
         /* the flow started before the time we care about. */
         start_bin = 0;
     } else {
         /* maybe grow the bins to allow for the start time */
-        if (TIME_OUT_OF_RANGE(sTime)) {
-            reallocBins(sTime);
+        if (TIME_OUT_OF_RANGE(cdata, sTime)) {
+            reallocBins(cdata, sTime);
         }
-        start_bin = GET_BIN(sTime);
+        start_bin = GET_BIN(cdata, sTime);
     }
 
     /* find the ending bin, reallocating the bins if needed */
-    if (eTime >= bins.end_time) {
+    if (eTime >= cdata->end_time) {
         /* flow ended after the time we care about. */
-        end_bin = bins.count - 1;
+        end_bin = cdata->count - 1;
     } else {
-        if (TIME_OUT_OF_RANGE(eTime)) {
-            reallocBins(eTime);
+        if (TIME_OUT_OF_RANGE(cdata, eTime)) {
+            reallocBins(cdata, eTime);
         }
-        end_bin = GET_BIN(eTime);
+        end_bin = GET_BIN(cdata, eTime);
     }
 
     assert(start_bin <= end_bin);
-    assert(end_bin < bins.count);
+    assert(end_bin < cdata->count);
 
     /* add everything to all bins */
     for (i = start_bin; i <= end_bin; ++i) {
-        bins.data[i].flows++;
-        bins.data[i].bytes += rwRecGetBytes(rwrec);
-        bins.data[i].pkts += rwRecGetPkts(rwrec);
+        cdata->data[i].flows++;
+        cdata->data[i].bytes += rwRecGetBytes(rwrec);
+        cdata->data[i].pkts += rwRecGetPkts(rwrec);
     }
 }
 
 
 /*
- *  minimumAdd(rwrec);
+ *  minimumAdd(cdata, rwrec);
  *
  *    Add the flow record to EVERY bin where it is active.  Only add
  *    the flow's packet and byte counts to a bin if the flow is
@@ -694,152 +711,151 @@ maximumAdd(
  */
 static void
 minimumAdd(
+    count_data_t       *cdata,
     const rwRec        *rwrec)
 {
     uint32_t start_bin, end_bin, i;
     sktime_t sTime = rwRecGetStartTime(rwrec);
     sktime_t eTime = rwRecGetEndTime(rwrec);
 
-    if (IGNORE_FLOW(sTime, eTime)) {
+    if (IGNORE_FLOW(cdata, sTime, eTime)) {
         /* user not interested in this flow */
         return;
     }
 
-    if (sTime < bins.start_time) {
+    if (sTime < cdata->start_time) {
         /* the flow started before the time we care about. */
         start_bin = 0;
     } else {
         /* maybe grow the bins to allow for the start time */
-        if (TIME_OUT_OF_RANGE(sTime)) {
-            reallocBins(sTime);
+        if (TIME_OUT_OF_RANGE(cdata, sTime)) {
+            reallocBins(cdata, sTime);
         }
-        start_bin = GET_BIN(sTime);
+        start_bin = GET_BIN(cdata, sTime);
     }
 
     /* find the ending bin, reallocating the bins if needed */
-    if (eTime >= bins.end_time) {
+    if (eTime >= cdata->end_time) {
         /* flow ended after the time we care about. */
-        end_bin = bins.count - 1;
+        end_bin = cdata->count - 1;
     } else {
-        if (TIME_OUT_OF_RANGE(eTime)) {
-            reallocBins(eTime);
+        if (TIME_OUT_OF_RANGE(cdata, eTime)) {
+            reallocBins(cdata, eTime);
         }
-        end_bin = GET_BIN(eTime);
+        end_bin = GET_BIN(cdata, eTime);
     }
 
     assert(start_bin <= end_bin);
-    assert(end_bin < bins.count);
+    assert(end_bin < cdata->count);
 
     /* handle the simple case where everything is in one bin */
     if ((start_bin == end_bin)
-        && (sTime >= bins.start_time)
-        && (eTime < bins.end_time))
+        && (sTime >= cdata->start_time)
+        && (eTime < cdata->end_time))
     {
-        bins.data[start_bin].flows++;
-        bins.data[start_bin].bytes += rwRecGetBytes(rwrec);
-        bins.data[start_bin].pkts += rwRecGetPkts(rwrec);
+        cdata->data[start_bin].flows++;
+        cdata->data[start_bin].bytes += rwRecGetBytes(rwrec);
+        cdata->data[start_bin].pkts += rwRecGetPkts(rwrec);
         return;
     }
 
     /* add the flow to every bin; ignore bytes and packets, since flow
      * spans multiple bins */
     for (i = start_bin; i <= end_bin; ++i) {
-        bins.data[i].flows++;
+        cdata->data[i].flows++;
     }
 }
 
 
 /*
- *  ok = countFile(stream);
+ *  countRecord(cdata, rwrec);
  *
- *    Process the records in 'stream'.  Return 0 on success, or
- *    non-zero on error reading the file.
+ *    Add 'rwrec' to the bins in 'cdata' according to the load
+ *    scheme.
  */
-static int
-countFile(
+void
+countRecord(
+    count_data_t       *cdata,
+    const rwRec        *rwrec)
+{
+    switch (flags.load_scheme) {
+      case LOAD_START:
+        startAdd(cdata, rwrec);
+        break;
+      case LOAD_END:
+        endAdd(cdata, rwrec);
+        break;
+      case LOAD_MIDDLE:
+        middleAdd(cdata, rwrec);
+        break;
+      case LOAD_MEAN:
+        meanAdd(cdata, rwrec);
+        break;
+      case LOAD_DURATION:
+        durationAdd(cdata, rwrec);
+        break;
+      case LOAD_MAXIMUM:
+        maximumAdd(cdata, rwrec);
+        break;
+      case LOAD_MINIMUM:
+        minimumAdd(cdata, rwrec);
+        break;
+    }
+}
+
+
+/*
+ *  ok = countStream(cdata, stream);
+ *
+ *    Add the records in 'stream' to the bins in 'cdata'.  Return 0
+ *    on success, or non-zero on error reading the file.
+ */
+int
+countStream(
+    count_data_t       *cdata,
     skstream_t         *rwIOS)
 {
-    /* protect initBins from multiple calls */
-    static int initialized = 0;
     rwRec rwrec;
     int rv = 0;
 
-    /* initialize bins if necessary */
-    if (!initialized) {
-        initialized = 1;
-        rv = skStreamReadRecord(rwIOS, &rwrec);
-        if (rv) {
-            goto END;
-        }
-        if (initBins(rwRecGetStartTime(&rwrec))) {
-            skAppPrintErr("Cannot allocate space for bins. "
-                          "Try a larger bin size or fewer records");
-            return 1;
-        }
-        switch (flags.load_scheme) {
-          case LOAD_START:
-            startAdd(&rwrec);
-            break;
-          case LOAD_END:
-            endAdd(&rwrec);
-            break;
-          case LOAD_MIDDLE:
-            middleAdd(&rwrec);
-            break;
-          case LOAD_MEAN:
-            meanAdd(&rwrec);
-            break;
-          case LOAD_DURATION:
-            durationAdd(&rwrec);
-            break;
-          case LOAD_MAXIMUM:
-            maximumAdd(&rwrec);
-            break;
-          case LOAD_MINIMUM:
-            minimumAdd(&rwrec);
-            break;
-        }
-    }
-
     switch (flags.load_scheme) {
       case LOAD_START:
         while ((rv = skStreamReadRecord(rwIOS, &rwrec)) == SKSTREAM_OK) {
-            startAdd(&rwrec);
+            startAdd(cdata, &rwrec);
         }
         break;
       case LOAD_END:
         while ((rv = skStreamReadRecord(rwIOS, &rwrec)) == SKSTREAM_OK) {
-            endAdd(&rwrec);
+            endAdd(cdata, &rwrec);
         }
         break;
       case LOAD_MIDDLE:
         while ((rv = skStreamReadRecord(rwIOS, &rwrec)) == SKSTREAM_OK) {
-            middleAdd(&rwrec);
+            middleAdd(cdata, &rwrec);
         }
         break;
       case LOAD_MEAN:
         while ((rv = skStreamReadRecord(rwIOS, &rwrec)) == SKSTREAM_OK) {
-            meanAdd(&rwrec);
+            meanAdd(cdata, &rwrec);
         }
         break;
       case LOAD_DURATION:
         while ((rv = skStreamReadRecord(rwIOS, &rwrec)) == SKSTREAM_OK) {
-            durationAdd(&rwrec);
+            durationAdd(cdata, &rwrec);
         }
         break;
       case LOAD_MAXIMUM:
         while ((rv = skStreamReadRecord(rwIOS, &rwrec)) == SKSTREAM_OK) {
-            maximumAdd(&rwrec);
+            maximumAdd(cdata, &rwrec);
         }
         break;
       case LOAD_MINIMUM:
         while ((rv = skStreamReadRecord(rwIOS, &rwrec)) == SKSTREAM_OK) {
-            minimumAdd(&rwrec);
+            minimumAdd(cdata, &rwrec);
         }
         break;
     }
 
-  END:
     if (rv == SKSTREAM_ERR_EOF) {
         rv = 0;
     } else {
@@ -849,6 +865,44 @@ countFile(
 }
 
 
+/*
+ *  ok = countFile(stream);
+ *
+ *    Process the records in 'stream'.  Return 0 on success, or
+ *    non-zero on error reading the file.
+ */
+static int
+countFile(
+    skstream_t         *rwIOS)
+{
+    /* protect initBins from multiple calls */
+    static int initialized = 0;
+    rwRec rwrec;
+    int rv;
+
+    /* initialize bins if necessary */
+    if (!initialized) {
+        initialized = 1;
+        rv = skStreamReadRecord(rwIOS, &rwrec);
+        if (rv) {
+            if (rv == SKSTREAM_ERR_EOF) {
+                return 0;
+            }
+            skStreamPrintLastErr(rwIOS, rv, &skAppPrintErr);
+            return rv;
+        }
+        if (initBins(rwRecGetStartTime(&rwrec))) {
+            skAppPrintErr("Cannot allocate space for bins. "
+                          "Try a larger bin size or fewer records");
+            return 1;
+        }
+        countRecord(&bins, &rwrec);
+    }
+
+    return countStream(&bins, rwIOS);
+}
+
+
 /*
  *  printBins(output_fh);
  *
@@ -1058,17 +1112,24 @@ int main(int argc, char ** argv)
     appSetup(argc, argv);
 
     /* process input */
-    while ((rv = skOptionsCtxNextSilkFile(optctx, &rwios, &skAppPrintErr))
-           == 0)
-    {
-        rv = countFile(rwios);
-        skStreamDestroy(&rwios);
-        if (rv) {
+    if (thread_count > 1) {
+        if (countThreads()) {
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        while ((rv = skOptionsCtxNextSilkFile(optctx, &rwios,
+                                              &skAppPrintErr))
+               == 0)
+        {
+            rv = countFile(rwios);
+            skStreamDestroy(&rwios);
+            if (rv) {
+                exit(EXIT_FAILURE);
+            }
+        }
+        if (rv < 0) {
             exit(EXIT_FAILURE);
         }
-    }
-    if (rv < 0) {
-        exit(EXIT_FAILURE);
     }
 
     /* Print the records */
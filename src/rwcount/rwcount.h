@@ -84,6 +84,9 @@ typedef enum {
 #define DEFAULT_LOAD_SCHEME LOAD_DURATION
 
 
+/* environment variable that specifies the number of threads */
+#define RWCOUNT_THREADS_ENVAR  "SILK_RWCOUNT_THREADS"
+
 /* default size of bins, in milliseconds */
 #define DEFAULT_BINSIZE 30000
 
@@ -159,6 +162,27 @@ FILE *
 getOutputHandle(
     void);
 
+int
+initBins(
+    sktime_t            start_time);
+void
+reallocBins(
+    count_data_t       *cdata,
+    sktime_t            t);
+void
+countRecord(
+    count_data_t       *cdata,
+    const rwRec        *rwrec);
+int
+countStream(
+    count_data_t       *cdata,
+    skstream_t         *rwIOS);
+
+/* functions in rwcountthread.c */
+int
+countThreads(
+    void);
+
 
 /* VARIABLES */
 
@@ -170,6 +194,9 @@ extern count_data_t bins;
 /* flags */
 extern count_flags_t flags;
 
+/* number of threads to use to bin records; 1 for no threading */
+extern uint32_t thread_count;
+
 #ifdef __cplusplus
 }
 #endif
@@ -134,7 +134,7 @@ typedef enum {
     OPT_BIN_SLOTS, OPT_EPOCH_SLOTS,
     OPT_TIMESTAMP_FORMAT, OPT_NO_TITLES, OPT_NO_COLUMNS,
     OPT_COLUMN_SEPARATOR, OPT_NO_FINAL_DELIMITER, OPT_DELIMITED,
-    OPT_OUTPUT_PATH, OPT_PAGER, OPT_LEGACY_TIMESTAMPS
+    OPT_OUTPUT_PATH, OPT_PAGER, OPT_THREADS, OPT_LEGACY_TIMESTAMPS
 } appOptionsEnum;
 
 static const struct option appOptions[] = {
@@ -153,6 +153,7 @@ static const struct option appOptions[] = {
     {"delimited",           OPTIONAL_ARG, 0, OPT_DELIMITED},
     {"output-path",         REQUIRED_ARG, 0, OPT_OUTPUT_PATH},
     {"pager",               REQUIRED_ARG, 0, OPT_PAGER},
+    {"threads",             REQUIRED_ARG, 0, OPT_THREADS},
     {"legacy-timestamps",   OPTIONAL_ARG, 0, OPT_LEGACY_TIMESTAMPS},
     {0,0,0,0}               /* sentinel entry */
 };
@@ -173,6 +174,8 @@ static const char *appHelp[] = {
     "Shortcut for --no-columns --no-final-del --column-sep=CHAR",
     "Send output to given file path. Def. stdout",
     "Program to invoke to page output. Def. $SILK_PAGER or $PAGER",
+    ("Bin records using this number of threads.\n"
+     "\tDef. $" RWCOUNT_THREADS_ENVAR " or 1"),
     "DEPRECATED. Equivalent to --timestamp-format=m/d/y",
     (char *)NULL
 };
@@ -325,6 +328,8 @@ appSetup(
     unsigned int end_precision;
     unsigned int is_epoch;
     int64_t bin_count;
+    const char *env;
+    uint32_t tc;
     int rv;
 
     /* make sure count of option's declarations and help-strings match */
@@ -372,6 +377,14 @@ appSetup(
         exit(EXIT_FAILURE);
     }
 
+    /* check the thread count envar */
+    env = getenv(RWCOUNT_THREADS_ENVAR);
+    if (env && env[0]) {
+        if (skStringParseUint32(&tc, env, 1, 0) == 0) {
+            thread_count = tc;
+        }
+    }
+
     /* parse options; print usage if error */
     rv = skOptionsCtxOptionsParse(optctx, argc, argv);
     if (rv < 0) {
@@ -458,6 +471,12 @@ appSetup(
         }
     }
 
+    /* the --copy-input stream is written as each record is read, so
+     * records must be read by a single thread */
+    if (skOptionsCtxCopyStreamIsActive(optctx)) {
+        thread_count = 1;
+    }
+
     /* open the --output-path: the 'of_name' member is non-NULL when
      * the switch is given */
     if (output.of_name) {
@@ -583,6 +602,13 @@ appOptionsHandler(
         pager = opt_arg;
         break;
 
+      case OPT_THREADS:
+        rv = skStringParseUint32(&thread_count, opt_arg, 1, 0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
+
       case OPT_TIMESTAMP_FORMAT:
         if (timestampFormatParse(opt_arg, &flags.timeflags)) {
             return 1;
@@ -0,0 +1,438 @@
+/*
+** Copyright (C) 2001-2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+
+/*
+**  rwcountthread.c
+**
+**    Variables/Functions to support having rwcount use multiple
+**    threads to bin the records.
+**
+**    The main thread opens every input and reads the start hour from
+**    the header of each file.  These hours are used to size the time
+**    window of the bins before any records are read, so the bins
+**    rarely need to be reallocated.  Each worker thread then takes
+**    the next input, and adds its records to a private array of bins
+**    that covers the same time window.  Once all inputs have been
+**    read, the main thread sums the bins of the workers.
+*/
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: rwcountthread.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
+
+#include <silk/skheader.h>
+#include "rwcount.h"
+
+
+/* TYPEDEFS AND DEFINES */
+
+/* Number of milliseconds in an hour */
+#define HOUR_MILLISEC 3600000
+
+/*
+ *    An input found during the pre-scan.  The stream is closed after
+ *    its header is read, and the worker re-opens the file by name.
+ *    The stream of the first input and of inputs that are not
+ *    regular files (such as the standard input) are kept open.
+ */
+typedef struct count_input_st {
+    skstream_t         *stream;
+    char               *path;
+} count_input_t;
+
+/*
+ *    A worker thread and its private bins.
+ */
+typedef struct count_thread_st {
+    count_data_t        cdata;
+    pthread_t           thread;
+    int                 rv;
+} count_thread_t;
+
+
+/* LOCAL VARIABLE DEFINITIONS */
+
+/* the inputs found by the pre-scan */
+static count_input_t *input = NULL;
+static size_t input_count = 0;
+
+/* index into 'input' of the next input to process */
+static size_t next_input = 0;
+static pthread_mutex_t next_input_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* the first record of the first input, read by the pre-scan to set
+ * the start of the time window; 'have_first_rec' is non-zero when
+ * the record exists */
+static rwRec first_rec;
+static int have_first_rec = 0;
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  status = scanInputs();
+ *
+ *    Open each of the inputs, note its path and the start hour in
+ *    its header, and size the time window in the global 'bins' to
+ *    cover those hours.  Return 0 on success or non-zero on error.
+ */
+static int
+scanInputs(
+    void)
+{
+    const sk_header_entry_t *hentry;
+    struct stat st;
+    skstream_t *stream;
+    size_t input_size = 0;
+    count_input_t *old_input;
+    sktime_t min_hour = INT64_MAX;
+    sktime_t max_hour = INT64_MIN;
+    sktime_t t;
+    int rv;
+
+    while ((rv = skOptionsCtxNextSilkFile(optctx, &stream, &skAppPrintErr))
+           == 0)
+    {
+        if (input_count == input_size) {
+            input_size = ((input_size) ? (2 * input_size) : 256);
+            old_input = input;
+            input = ((count_input_t*)
+                     realloc(input, input_size * sizeof(count_input_t)));
+            if (NULL == input) {
+                input = old_input;
+                skAppPrintOutOfMemory("input list");
+                skStreamDestroy(&stream);
+                return -1;
+            }
+        }
+        input[input_count].stream = NULL;
+        input[input_count].path = strdup(skStreamGetPathname(stream));
+        if (NULL == input[input_count].path) {
+            skAppPrintOutOfMemory("input path");
+            skStreamDestroy(&stream);
+            return -1;
+        }
+        ++input_count;
+
+        hentry = skHeaderGetFirstMatch(skStreamGetSilkHeader(stream),
+                                       SK_HENTRY_PACKEDFILE_ID);
+        if (hentry) {
+            t = skHentryPackedfileGetStartTime(
+                (sk_hentry_packedfile_t*)hentry);
+            if (t < min_hour) {
+                min_hour = t;
+            }
+            if (t > max_hour) {
+                max_hour = t;
+            }
+        }
+
+        if (1 == input_count) {
+            /* as in the single-threaded case, the first record
+             * determines the start of the time window */
+            rv = skStreamReadRecord(stream, &first_rec);
+            if (SKSTREAM_OK == rv) {
+                have_first_rec = 1;
+                if (initBins(rwRecGetStartTime(&first_rec))) {
+                    skAppPrintErr("Cannot allocate space for bins. "
+                                  "Try a larger bin size or fewer records");
+                    skStreamDestroy(&stream);
+                    return -1;
+                }
+            } else if (SKSTREAM_ERR_EOF != rv) {
+                skStreamPrintLastErr(stream, rv, &skAppPrintErr);
+                skStreamDestroy(&stream);
+                return -1;
+            }
+            input[0].stream = stream;
+        } else if (stat(input[input_count - 1].path, &st) == -1
+                   || !S_ISREG(st.st_mode))
+        {
+            /* cannot re-open it; keep it open */
+            input[input_count - 1].stream = stream;
+        } else {
+            skStreamDestroy(&stream);
+        }
+    }
+    if (rv < 0) {
+        return -1;
+    }
+
+    /* grow the window to cover the hours found in the headers.  the
+     * records in an hourly file start within an hour of the time in
+     * its header.  when there is no window, the first input was
+     * empty; leave the window to be grown as records arrive just as
+     * in the single-threaded case. */
+    if (bins.data && (min_hour <= max_hour)) {
+        t = max_hour + HOUR_MILLISEC - 1;
+        if (min_hour < bins.window_min && min_hour >= bins.start_time
+            && min_hour < bins.end_time)
+        {
+            reallocBins(&bins, min_hour);
+        }
+        if (t >= bins.window_max && t >= bins.start_time
+            && t < bins.end_time)
+        {
+            reallocBins(&bins, t);
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ *  workerThread(thread);
+ *
+ *    THREAD ENTRY POINT.
+ *
+ *    Process inputs until there are no more, adding their records to
+ *    the bins of the count_thread_t 'thread'.
+ */
+static void *
+workerThread(
+    void               *v_thread)
+{
+    count_thread_t *thr = (count_thread_t*)v_thread;
+    skstream_t *stream;
+    size_t idx;
+    int rv;
+
+    for (;;) {
+        pthread_mutex_lock(&next_input_mutex);
+        idx = next_input++;
+        pthread_mutex_unlock(&next_input_mutex);
+        if (idx >= input_count) {
+            break;
+        }
+
+        stream = input[idx].stream;
+        input[idx].stream = NULL;
+        if (NULL == stream) {
+            rv = skStreamOpenSilkFlow(&stream, input[idx].path, SK_IO_READ);
+            if (rv) {
+                skStreamPrintLastErr(stream, rv, &skAppPrintErr);
+                skStreamDestroy(&stream);
+                thr->rv = -1;
+                break;
+            }
+        }
+        if (0 == idx && have_first_rec) {
+            countRecord(&thr->cdata, &first_rec);
+        }
+        rv = countStream(&thr->cdata, stream);
+        skStreamDestroy(&stream);
+        if (rv) {
+            thr->rv = rv;
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ *  mergeBins(cdata);
+ *
+ *    Add the bins in 'cdata' to the global 'bins', growing the window
+ *    of 'bins' as needed, and free the data in 'cdata'.
+ */
+static void
+mergeBins(
+    count_data_t       *cdata)
+{
+    count_bin_t *src;
+    count_bin_t *dst;
+    int64_t i;
+
+    if (0 == cdata->count) {
+        free(cdata->data);
+        return;
+    }
+    if (0 == bins.count) {
+        free(bins.data);
+        bins = *cdata;
+        return;
+    }
+
+    /* the windows share their origin and bin size, so the bins of
+     * 'cdata' line up with those of 'bins' */
+    if (cdata->window_min < bins.window_min) {
+        reallocBins(&bins, cdata->window_min);
+    }
+    if (cdata->window_max > bins.window_max) {
+        reallocBins(&bins, cdata->window_max - 1);
+    }
+    assert(0 == (cdata->window_min - bins.window_min) % bins.size);
+
+    src = cdata->data;
+    dst = &bins.data[(cdata->window_min - bins.window_min) / bins.size];
+    for (i = 0; i < cdata->count; ++i, ++src, ++dst) {
+        dst->flows += src->flows;
+        dst->bytes += src->bytes;
+        dst->pkts += src->pkts;
+    }
+    free(cdata->data);
+    cdata->data = NULL;
+}
+
+
+/*
+ *  status = countThreads();
+ *
+ *    Pre-scan the inputs, spawn 'thread_count' worker threads to bin
+ *    the records, and sum the results into the global 'bins'.  Return
+ *    0 on success, or non-zero on error.
+ */
+int
+countThreads(
+    void)
+{
+    count_thread_t *thread;
+    uint32_t num_threads;
+    uint32_t started;
+    uint32_t j;
+    int rv = 0;
+
+    if (scanInputs()) {
+        rv = -1;
+        goto END;
+    }
+    if (0 == input_count) {
+        goto END;
+    }
+
+    num_threads = thread_count;
+    if (num_threads > input_count) {
+        num_threads = (uint32_t)input_count;
+    }
+
+    thread = (count_thread_t*)calloc(num_threads, sizeof(count_thread_t));
+    if (NULL == thread) {
+        skAppPrintOutOfMemory("thread data");
+        rv = -1;
+        goto END;
+    }
+
+    /* each thread gets its own bins over the window; the first
+     * thread takes over the bins allocated by the pre-scan */
+    for (j = 0; j < num_threads; ++j) {
+        thread[j].cdata = bins;
+        if (0 == j || NULL == bins.data) {
+            continue;
+        }
+        thread[j].cdata.data = (count_bin_t*)calloc(bins.count,
+                                                    sizeof(count_bin_t));
+        if (NULL == thread[j].cdata.data) {
+            skAppPrintErr("Cannot allocate space for bins. "
+                          "Try a larger bin size or fewer threads");
+            while (j > 1) {
+                --j;
+                free(thread[j].cdata.data);
+            }
+            free(thread);
+            rv = -1;
+            goto END;
+        }
+    }
+    bins.data = NULL;
+    bins.count = 0;
+
+    /* if a thread cannot be created, the threads that were started
+     * process all the inputs; if none was, the main thread does */
+    for (started = 0; started < num_threads; ++started) {
+        if (pthread_create(&thread[started].thread, NULL, &workerThread,
+                           &thread[started]))
+        {
+            skAppPrintErr("Unable to create worker thread; using %" PRIu32
+                          " thread%s", (started ? started : 1),
+                          ((started > 1) ? "s" : ""));
+            break;
+        }
+    }
+    if (0 == started) {
+        workerThread(&thread[0]);
+    }
+    for (j = 0; j < num_threads; ++j) {
+        if (j < started) {
+            pthread_join(thread[j].thread, NULL);
+        }
+        if (thread[j].rv) {
+            rv = thread[j].rv;
+        }
+    }
+
+    for (j = 0; j < num_threads; ++j) {
+        mergeBins(&thread[j].cdata);
+    }
+    free(thread);
+
+  END:
+    for ( ; input_count > 0; --input_count) {
+        skStreamDestroy(&input[input_count - 1].stream);
+        free(input[input_count - 1].path);
+    }
+    free(input);
+    input = NULL;
+    return rv;
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -0,0 +1,14 @@
+#! /usr/bin/perl -w
+# MD5: 1b51951a45ed73a6b03f06c1c076913e
+# TEST: ./rwcount --bin-size=1800 --load-scheme=minimum-volume --bin-slots --threads=2 ../../tests/data.rwf ../../tests/data.rwf
+
+use strict;
+use SiLKTests;
+
+my $rwcount = check_silk_app('rwcount');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwcount --bin-size=1800 --load-scheme=minimum-volume --bin-slots --threads=2 $file{data} $file{data}";
+my $md5 = "1b51951a45ed73a6b03f06c1c076913e";
+
+check_md5_output($md5, $cmd);
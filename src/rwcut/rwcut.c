@@ -102,6 +102,15 @@ rwRec *tail_buf = NULL;
 /* how to handle IPv6 flows */
 sk_ipv6policy_t ipv6_policy = SK_IPV6POLICY_MIX;
 
+/* The output stream: where to print the records */
+sk_fileptr_t output;
+
+/* number of threads to use to format records; 1 for no threading */
+uint32_t thread_count = 1;
+
+/* the format of the output */
+cut_output_format_t output_format = CUT_OUTPUT_TEXT;
+
 
 /* LOCAL VARIABLES */
 
@@ -114,6 +123,45 @@ static int tail_buf_full = 0;
 
 /* FUNCTION DEFINITIONS */
 
+/*
+ *  printRecord(rwrec);
+ *
+ *    Print 'rwrec' using the global 'ascii_str', give it to the
+ *    threads that format records when threading is active, or add it
+ *    to the Arrow output.
+ */
+static void
+printRecord(
+    const rwRec        *rwrec)
+{
+    if (CUT_OUTPUT_TEXT != output_format) {
+        cutArrowAddRecord(rwrec);
+    } else if (thread_count > 1) {
+        cutThreadsAddRecord(rwrec);
+    } else {
+        rwAsciiPrintRec(ascii_str, rwrec);
+    }
+}
+
+
+/*
+ *  startThreads();
+ *
+ *    Start the threads that format records when threading was
+ *    requested.  Must be called after the titles have been printed.
+ */
+static void
+startThreads(
+    void)
+{
+    if (thread_count > 1) {
+        if (cutThreadsStart()) {
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+
 /*
  *  status = tailFile(stream);
  *
@@ -176,9 +224,10 @@ printTailBuffer(
     }
 
     rwAsciiPrintTitles(ascii_str);
+    startThreads();
 
     while (num_recs) {
-        rwAsciiPrintRec(ascii_str, tail_buf_cur);
+        printRecord(tail_buf_cur);
         --num_recs;
         ++tail_buf_cur;
         if (tail_buf_cur == &tail_buf[tail_recs]) {
@@ -240,7 +289,7 @@ cutFile(
     if (0 == num_recs) {
         /* print all records */
         while ((rv = skStreamReadRecord(rwios, &rwrec)) == SKSTREAM_OK) {
-            rwAsciiPrintRec(ascii_str, &rwrec);
+            printRecord(&rwrec);
         }
         if (SKSTREAM_ERR_EOF != rv) {
             ret_val = -1;
@@ -249,7 +298,7 @@ cutFile(
         while (num_recs
                && ((rv = skStreamReadRecord(rwios, &rwrec)) == SKSTREAM_OK))
         {
-            rwAsciiPrintRec(ascii_str, &rwrec);
+            printRecord(&rwrec);
             --num_recs;
         }
         switch (rv) {
@@ -329,6 +378,8 @@ int main(int argc, char **argv)
             return 0;
         }
 
+        startThreads();
+
         do {
             skStreamSetIPv6Policy(rwios, ipv6_policy);
             rv = cutFile(rwios);
@@ -76,9 +76,29 @@ RCSIDENTVAR(rcsID_RWCUT_H, "$SiLK: rwcut.h b7b8edebba12 2015-01-05 18:05:21Z mth
 
 /* TYPEDEFS AND DEFINES */
 
+/* environment variable that specifies the number of threads */
+#define RWCUT_THREADS_ENVAR  "SILK_RWCUT_THREADS"
+
+/* maximum number of threads to use; each thread has its own set of
+ * record and text buffers */
+#define RWCUT_THREADS_MAX  256
+
+/* the formats in which rwcut can write the records */
+typedef enum cut_output_format_en {
+    /* text produced by the rwAsciiStream */
+    CUT_OUTPUT_TEXT,
+    /* an Apache Arrow IPC file */
+    CUT_OUTPUT_ARROW_FILE,
+    /* an Apache Arrow IPC stream */
+    CUT_OUTPUT_ARROW_STREAM
+} cut_output_format_t;
+
 /* The object to convert the record to text */
 extern rwAsciiStream_t *ascii_str;
 
+/* The output stream: where to print the records */
+extern sk_fileptr_t output;
+
 /* handle input streams */
 extern sk_options_ctx_t *optctx;
 
@@ -97,6 +117,12 @@ extern rwRec *tail_buf;
 /* how to handle IPv6 flows */
 extern sk_ipv6policy_t ipv6_policy;
 
+/* number of threads to use to format records; 1 for no threading */
+extern uint32_t thread_count;
+
+/* the format of the output */
+extern cut_output_format_t output_format;
+
 void
 appTeardown(
     void);
@@ -105,6 +131,30 @@ appSetup(
     int                 argc,
     char              **argv);
 
+/* functions in rwcutthread.c */
+int
+cutThreadsStart(
+    void);
+void
+cutThreadsAddRecord(
+    const rwRec        *rwrec);
+void
+cutThreadsStop(
+    void);
+
+/* functions in rwcutarrow.c */
+int
+cutArrowStart(
+    int                 file_format,
+    int                 icmp_type_and_code,
+    int                 integer_sensors);
+void
+cutArrowAddRecord(
+    const rwRec        *rwrec);
+void
+cutArrowStop(
+    void);
+
 
 #ifdef __cplusplus
 }
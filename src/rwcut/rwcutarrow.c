@@ -0,0 +1,1743 @@
+/*
+** Copyright (C) 2001-2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  rwcutarrow.c
+**
+**    Write the records in the Apache Arrow IPC format, either as an
+**    Arrow file (which a reader may memory map) or as an Arrow
+**    stream.
+**
+**    The columns are the fields that the user selected in the global
+**    'ascii_str'.  Each column has a type suited to the field: IP
+**    addresses are uint32 or 16-byte fixed-size binary, times are
+**    timestamp[ms, UTC], durations are duration[ms], ports and other
+**    numbers are unsigned integers, and the sensor, class, and type
+**    are dictionary-encoded strings.  Plug-in fields are utf8
+**    strings holding the text the plug-in produces.
+**
+**    The encoder is self-contained: the small FlatBuffers builder
+**    needed for the Arrow metadata is implemented below.
+*/
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: rwcutarrow.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
+
+#include "rwcut.h"
+
+
+/* TYPEDEFS AND DEFINES */
+
+/*
+ *    The maximum number of records in an Arrow record batch.
+ */
+#define ARROW_BATCH_RECS  65536
+
+/*
+ *    Arrow buffers are padded to a multiple of this many bytes.
+ */
+#define ARROW_ALIGN  8
+
+/*
+ *    The size of the buffer used to get the value of a plug-in field.
+ */
+#define ARROW_TEXT_BUFSIZE  1024
+
+/*
+ *    Values from the Arrow format specification (Schema.fbs and
+ *    Message.fbs).
+ */
+#define ARROW_METADATA_V5       4
+#define ARROW_HEADER_SCHEMA     1
+#define ARROW_HEADER_DICTIONARY 2
+#define ARROW_HEADER_RECORDS    3
+#define ARROW_TYPE_INT          2
+#define ARROW_TYPE_UTF8         5
+#define ARROW_TYPE_TIMESTAMP    10
+#define ARROW_TYPE_FIXEDBINARY  15
+#define ARROW_TYPE_DURATION     18
+#define ARROW_UNIT_MILLISECOND  1
+#define ARROW_ENDIAN_LITTLE     0
+#define ARROW_ENDIAN_BIG        1
+
+/*
+ *    The magic string that begins and ends an Arrow file.
+ */
+#define ARROW_MAGIC      "ARROW1"
+#define ARROW_MAGIC_LEN  6
+
+/*
+ *    The types of the columns.
+ */
+typedef enum arrow_coltype_en {
+    ARROW_COL_UINT8,
+    ARROW_COL_UINT16,
+    ARROW_COL_UINT32,
+    ARROW_COL_IPV6,
+    ARROW_COL_TIMESTAMP,
+    ARROW_COL_DURATION,
+    ARROW_COL_DICT,
+    ARROW_COL_UTF8
+} arrow_coltype_t;
+
+/*
+ *    A growable buffer of bytes.
+ */
+typedef struct arrow_buf_st {
+    uint8_t            *data;
+    size_t              len;
+    size_t              cap;
+} arrow_buf_t;
+
+/*
+ *    A dictionary of strings.  'index' maps an ID (such as a sensor
+ *    ID) to the position of its string in the dictionary, or to -1
+ *    when the ID is not known.
+ */
+typedef struct arrow_dict_st {
+    int16_t            *index;
+    size_t              index_count;
+    arrow_buf_t         offsets;
+    arrow_buf_t         values;
+    int32_t             count;
+    int64_t             id;
+} arrow_dict_t;
+
+/*
+ *    A column in the output.
+ */
+typedef struct arrow_column_st {
+    /* the column's title */
+    char                name[ARROW_TEXT_BUFSIZE];
+    /* the dictionary for ARROW_COL_DICT columns */
+    arrow_dict_t       *dict;
+    /* the validity bitmap, the values, and, for ARROW_COL_UTF8 only,
+     * the offsets into the values */
+    arrow_buf_t         validity;
+    arrow_buf_t         values;
+    arrow_buf_t         offsets;
+    /* number of nulls in the current batch */
+    uint32_t            null_count;
+    /* position of the field in 'ascii_str' and its identifier */
+    uint32_t            position;
+    uint32_t            field_id;
+    arrow_coltype_t     type;
+} arrow_column_t;
+
+/*
+ *    The location of a message in an Arrow file; the footer of the
+ *    file lists the locations of the dictionaries and record batches.
+ */
+typedef struct arrow_block_st {
+    int64_t             offset;
+    int32_t             metadata_len;
+    int64_t             body_len;
+} arrow_block_t;
+
+/*
+ *    A FlatBuffers builder.  The buffer is built from the end toward
+ *    the beginning, so that objects are written before the objects
+ *    that refer to them.  The data occupies buf[head..cap).  An
+ *    object is referenced by its distance from the end of the buffer.
+ */
+typedef struct fb_builder_st {
+    uint8_t            *buf;
+    size_t              cap;
+    size_t              head;
+    size_t              minalign;
+    /* distance from the end to the start of the current table and
+     * to each field of the table; 0 for fields not present */
+    uint32_t            table_start;
+    uint32_t            field_ref[8];
+    uint32_t            field_count;
+} fb_builder_t;
+
+
+/* LOCAL VARIABLE DEFINITIONS */
+
+/* the columns */
+static arrow_column_t *column = NULL;
+static uint32_t column_count = 0;
+
+/* the dictionaries for the sensor, the class, and the type */
+static arrow_dict_t sensor_dict;
+static arrow_dict_t class_dict;
+static arrow_dict_t type_dict;
+
+/* whether to write the Arrow file format or the Arrow stream format */
+static int arrow_file_format = 0;
+
+/* whether to put the ICMP type and code into the sPort and dPort */
+static int arrow_legacy_icmp = 0;
+
+/* whether to write the sensor as an integer */
+static int arrow_integer_sensors = 0;
+
+/* number of records in the current batch */
+static uint32_t batch_rows = 0;
+
+/* number of bytes written to the output */
+static int64_t bytes_written = 0;
+
+/* locations of dictionaries and record batches for the file footer */
+static arrow_block_t *block = NULL;
+static size_t block_count = 0;
+static size_t block_capacity = 0;
+
+/* number of entries in 'block' that locate dictionaries */
+static size_t dict_block_count = 0;
+
+/* the builder for the metadata */
+static fb_builder_t fbb;
+
+/* non-zero once cutArrowStart() has run */
+static int started = 0;
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  arrowBufReserve(buf, len);
+ *
+ *    Make certain 'buf' can hold 'len' more bytes.  Exit the
+ *    application on allocation failure.
+ */
+static void
+arrowBufReserve(
+    arrow_buf_t        *buf,
+    size_t              len)
+{
+    uint8_t *old_data;
+
+    if (buf->len + len <= buf->cap) {
+        return;
+    }
+    if (0 == buf->cap) {
+        buf->cap = 256;
+    }
+    while (buf->len + len > buf->cap) {
+        buf->cap *= 2;
+    }
+    old_data = buf->data;
+    buf->data = (uint8_t*)realloc(buf->data, buf->cap);
+    if (NULL == buf->data) {
+        free(old_data);
+        skAppPrintOutOfMemory("arrow buffer");
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+/*
+ *  arrowBufAppend(buf, data, len);
+ *
+ *    Append 'len' bytes from 'data' to 'buf'.
+ */
+static void
+arrowBufAppend(
+    arrow_buf_t        *buf,
+    const void         *data,
+    size_t              len)
+{
+    arrowBufReserve(buf, len);
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+
+/*
+ *  arrowBufFree(buf);
+ *
+ *    Free the memory held by 'buf'.
+ */
+static void
+arrowBufFree(
+    arrow_buf_t        *buf)
+{
+    free(buf->data);
+    memset(buf, 0, sizeof(arrow_buf_t));
+}
+
+
+/*
+ *  arrowWrite(data, len);
+ *
+ *    Write 'len' bytes from 'data' to the output.
+ */
+static void
+arrowWrite(
+    const void         *data,
+    size_t              len)
+{
+    if (len && fwrite(data, len, 1, output.of_fp) != 1) {
+        skAppPrintSyserror("Error writing to output");
+        exit(EXIT_FAILURE);
+    }
+    bytes_written += len;
+}
+
+
+/*
+ *  arrowWritePadding(len);
+ *
+ *    Write zeros to pad data of 'len' bytes to the Arrow alignment.
+ */
+static void
+arrowWritePadding(
+    size_t              len)
+{
+    static const uint8_t zero[ARROW_ALIGN] = {0};
+
+    if (len % ARROW_ALIGN) {
+        arrowWrite(zero, ARROW_ALIGN - (len % ARROW_ALIGN));
+    }
+}
+
+
+/*
+ *    Convert a value to little endian.  The FlatBuffers metadata is
+ *    always little endian.
+ */
+static void
+fbEncode(
+    uint8_t            *dst,
+    uint64_t            value,
+    size_t              len)
+{
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        dst[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+
+/*
+ *  fbReset(b);
+ *
+ *    Prepare the builder 'b' to build a new buffer.
+ */
+static void
+fbReset(
+    fb_builder_t       *b)
+{
+    if (NULL == b->buf) {
+        b->cap = 1024;
+        b->buf = (uint8_t*)malloc(b->cap);
+        if (NULL == b->buf) {
+            skAppPrintOutOfMemory("metadata buffer");
+            exit(EXIT_FAILURE);
+        }
+    }
+    b->head = b->cap;
+    b->minalign = 1;
+    b->field_count = 0;
+}
+
+
+/*
+ *  ref = fbRef(b);
+ *
+ *    Return the reference to the most recently pushed data.
+ */
+static uint32_t
+fbRef(
+    const fb_builder_t *b)
+{
+    return (uint32_t)(b->cap - b->head);
+}
+
+
+/*
+ *  fbGrow(b, len);
+ *
+ *    Make room for 'len' more bytes at the front of the buffer.
+ */
+static void
+fbGrow(
+    fb_builder_t       *b,
+    size_t              len)
+{
+    uint8_t *new_buf;
+    size_t used;
+    size_t new_cap;
+
+    if (len <= b->head) {
+        return;
+    }
+    used = b->cap - b->head;
+    new_cap = 2 * b->cap;
+    while (new_cap - used < len) {
+        new_cap *= 2;
+    }
+    new_buf = (uint8_t*)malloc(new_cap);
+    if (NULL == new_buf) {
+        skAppPrintOutOfMemory("metadata buffer");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(new_buf + new_cap - used, b->buf + b->head, used);
+    free(b->buf);
+    b->buf = new_buf;
+    b->head = new_cap - used;
+    b->cap = new_cap;
+}
+
+
+/*
+ *  fbPrep(b, align, len);
+ *
+ *    Add padding so that after 'len' bytes are pushed the data is
+ *    aligned on a multiple of 'align'.
+ */
+static void
+fbPrep(
+    fb_builder_t       *b,
+    size_t              align,
+    size_t              len)
+{
+    size_t pad;
+
+    if (align > b->minalign) {
+        b->minalign = align;
+    }
+    pad = (align - ((b->cap - b->head + len) % align)) % align;
+    fbGrow(b, pad + len);
+    b->head -= pad;
+    memset(b->buf + b->head, 0, pad);
+}
+
+
+/*
+ *  fbPushScalar(b, value, len);
+ *
+ *    Push an aligned scalar of 'len' bytes onto the buffer.
+ */
+static void
+fbPushScalar(
+    fb_builder_t       *b,
+    uint64_t            value,
+    size_t              len)
+{
+    fbPrep(b, len, len);
+    b->head -= len;
+    fbEncode(b->buf + b->head, value, len);
+}
+
+
+/*
+ *  fbPushOffset(b, ref);
+ *
+ *    Push an offset to the object whose reference is 'ref'.
+ */
+static void
+fbPushOffset(
+    fb_builder_t       *b,
+    uint32_t            ref)
+{
+    fbPrep(b, 4, 4);
+    b->head -= 4;
+    fbEncode(b->buf + b->head, fbRef(b) - ref, 4);
+}
+
+
+/*
+ *  ref = fbCreateString(b, str);
+ *
+ *    Add the NUL-terminated string 'str' and return its reference.
+ */
+static uint32_t
+fbCreateString(
+    fb_builder_t       *b,
+    const char         *str)
+{
+    size_t len = strlen(str);
+
+    fbPrep(b, 4, len + 1);
+    b->head -= len + 1;
+    memcpy(b->buf + b->head, str, len + 1);
+    fbPushScalar(b, len, 4);
+    return fbRef(b);
+}
+
+
+/*
+ *  ref = fbCreateStructVector(b, data, count, size, align);
+ *
+ *    Add a vector of 'count' structures of 'size' bytes that have
+ *    already been encoded into 'data', and return its reference.
+ */
+static uint32_t
+fbCreateStructVector(
+    fb_builder_t       *b,
+    const uint8_t      *data,
+    size_t              count,
+    size_t              size,
+    size_t              align)
+{
+    fbPrep(b, 4, count * size);
+    fbPrep(b, align, count * size);
+    b->head -= count * size;
+    if (count) {
+        memcpy(b->buf + b->head, data, count * size);
+    }
+    fbPushScalar(b, count, 4);
+    return fbRef(b);
+}
+
+
+/*
+ *  ref = fbCreateOffsetVector(b, refs, count);
+ *
+ *    Add a vector of offsets to the 'count' objects in 'refs', and
+ *    return its reference.
+ */
+static uint32_t
+fbCreateOffsetVector(
+    fb_builder_t       *b,
+    const uint32_t     *refs,
+    size_t              count)
+{
+    size_t i;
+
+    fbPrep(b, 4, 4 * (count + 1));
+    for (i = count; i > 0; --i) {
+        fbPushOffset(b, refs[i - 1]);
+    }
+    fbPushScalar(b, count, 4);
+    return fbRef(b);
+}
+
+
+/*
+ *  fbStartTable(b);
+ *
+ *    Begin a table.  All objects the table refers to must be created
+ *    before calling this function.
+ */
+static void
+fbStartTable(
+    fb_builder_t       *b)
+{
+    memset(b->field_ref, 0, sizeof(b->field_ref));
+    b->field_count = 0;
+    b->table_start = fbRef(b);
+}
+
+
+/*
+ *  fbAddScalar(b, field, value, len);
+ *
+ *    Add to the current table the scalar 'value' of 'len' bytes as
+ *    field number 'field'.
+ */
+static void
+fbAddScalar(
+    fb_builder_t       *b,
+    uint32_t            field,
+    uint64_t            value,
+    size_t              len)
+{
+    assert(field < sizeof(b->field_ref)/sizeof(b->field_ref[0]));
+    fbPushScalar(b, value, len);
+    b->field_ref[field] = fbRef(b);
+    if (field >= b->field_count) {
+        b->field_count = field + 1;
+    }
+}
+
+
+/*
+ *  fbAddOffset(b, field, ref);
+ *
+ *    Add to the current table an offset to the object 'ref' as field
+ *    number 'field'.
+ */
+static void
+fbAddOffset(
+    fb_builder_t       *b,
+    uint32_t            field,
+    uint32_t            ref)
+{
+    assert(field < sizeof(b->field_ref)/sizeof(b->field_ref[0]));
+    fbPushOffset(b, ref);
+    b->field_ref[field] = fbRef(b);
+    if (field >= b->field_count) {
+        b->field_count = field + 1;
+    }
+}
+
+
+/*
+ *  ref = fbEndTable(b);
+ *
+ *    Finish the current table, write its vtable, and return the
+ *    table's reference.
+ */
+static uint32_t
+fbEndTable(
+    fb_builder_t       *b)
+{
+    uint32_t table_ref;
+    uint32_t i;
+
+    /* placeholder for the offset to the vtable */
+    fbPushScalar(b, 0, 4);
+    table_ref = fbRef(b);
+
+    /* the vtable: the offset of each field from the start of the
+     * table, the size of the table, and the size of the vtable */
+    fbPrep(b, 2, 2 * (b->field_count + 2));
+    for (i = b->field_count; i > 0; --i) {
+        fbPushScalar(b, (b->field_ref[i - 1]
+                         ? (table_ref - b->field_ref[i - 1]) : 0), 2);
+    }
+    fbPushScalar(b, table_ref - b->table_start, 2);
+    fbPushScalar(b, 2 * (b->field_count + 2), 2);
+
+    /* the table refers to the vtable that precedes it */
+    fbEncode(b->buf + b->cap - table_ref, fbRef(b) - table_ref, 4);
+
+    b->field_count = 0;
+    return table_ref;
+}
+
+
+/*
+ *  len = fbFinish(b, root_ref);
+ *
+ *    Finish the buffer whose root object is 'root_ref' and return the
+ *    length of the buffer, which begins at b->buf + b->head.  The
+ *    length is a multiple of ARROW_ALIGN.
+ */
+static size_t
+fbFinish(
+    fb_builder_t       *b,
+    uint32_t            root_ref)
+{
+    fbPrep(b, ARROW_ALIGN, 4);
+    fbPushOffset(b, root_ref);
+    return fbRef(b);
+}
+
+
+/*
+ *  ref = arrowCreateIntType(signed, bit_width);
+ *
+ *    Create an Arrow Int table.
+ */
+static uint32_t
+arrowCreateIntType(
+    int                 is_signed,
+    int                 bit_width)
+{
+    fbStartTable(&fbb);
+    fbAddScalar(&fbb, 0, bit_width, 4);
+    fbAddScalar(&fbb, 1, is_signed, 1);
+    return fbEndTable(&fbb);
+}
+
+
+/*
+ *  ref = arrowCreateField(col);
+ *
+ *    Create the Arrow Field table that describes the column 'col'.
+ */
+static uint32_t
+arrowCreateField(
+    const arrow_column_t   *col)
+{
+    uint32_t name_ref;
+    uint32_t type_ref;
+    uint32_t tz_ref = 0;
+    uint32_t dict_ref = 0;
+    uint32_t children_ref;
+    uint32_t index_ref;
+    int type_type;
+
+    name_ref = fbCreateString(&fbb, col->name);
+    children_ref = fbCreateOffsetVector(&fbb, NULL, 0);
+
+    switch (col->type) {
+      case ARROW_COL_UINT8:
+        type_type = ARROW_TYPE_INT;
+        type_ref = arrowCreateIntType(0, 8);
+        break;
+      case ARROW_COL_UINT16:
+        type_type = ARROW_TYPE_INT;
+        type_ref = arrowCreateIntType(0, 16);
+        break;
+      case ARROW_COL_UINT32:
+        type_type = ARROW_TYPE_INT;
+        type_ref = arrowCreateIntType(0, 32);
+        break;
+      case ARROW_COL_IPV6:
+        type_type = ARROW_TYPE_FIXEDBINARY;
+        fbStartTable(&fbb);
+        fbAddScalar(&fbb, 0, 16, 4);
+        type_ref = fbEndTable(&fbb);
+        break;
+      case ARROW_COL_TIMESTAMP:
+        type_type = ARROW_TYPE_TIMESTAMP;
+        tz_ref = fbCreateString(&fbb, "UTC");
+        fbStartTable(&fbb);
+        fbAddScalar(&fbb, 0, ARROW_UNIT_MILLISECOND, 2);
+        fbAddOffset(&fbb, 1, tz_ref);
+        type_ref = fbEndTable(&fbb);
+        break;
+      case ARROW_COL_DURATION:
+        type_type = ARROW_TYPE_DURATION;
+        fbStartTable(&fbb);
+        fbAddScalar(&fbb, 0, ARROW_UNIT_MILLISECOND, 2);
+        type_ref = fbEndTable(&fbb);
+        break;
+      case ARROW_COL_DICT:
+        /* the type of a dictionary-encoded field is the type of the
+         * dictionary's values; the indexes are int16 */
+        index_ref = arrowCreateIntType(1, 16);
+        fbStartTable(&fbb);
+        fbAddScalar(&fbb, 0, col->dict->id, 8);
+        fbAddOffset(&fbb, 1, index_ref);
+        dict_ref = fbEndTable(&fbb);
+        /* FALLTHROUGH */
+      case ARROW_COL_UTF8:
+        type_type = ARROW_TYPE_UTF8;
+        fbStartTable(&fbb);
+        type_ref = fbEndTable(&fbb);
+        break;
+      default:
+        skAbortBadCase(col->type);
+    }
+
+    fbStartTable(&fbb);
+    fbAddOffset(&fbb, 0, name_ref);
+    fbAddScalar(&fbb, 1, 1, 1);
+    fbAddScalar(&fbb, 2, type_type, 1);
+    fbAddOffset(&fbb, 3, type_ref);
+    if (dict_ref) {
+        fbAddOffset(&fbb, 4, dict_ref);
+    }
+    fbAddOffset(&fbb, 5, children_ref);
+    return fbEndTable(&fbb);
+}
+
+
+/*
+ *  ref = arrowCreateSchema();
+ *
+ *    Create the Arrow Schema table that describes the columns.
+ */
+static uint32_t
+arrowCreateSchema(
+    void)
+{
+    uint32_t *field_ref;
+    uint32_t fields_ref;
+    uint32_t i;
+
+    field_ref = (uint32_t*)malloc((column_count + 1) * sizeof(uint32_t));
+    if (NULL == field_ref) {
+        skAppPrintOutOfMemory("schema");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < column_count; ++i) {
+        field_ref[i] = arrowCreateField(&column[i]);
+    }
+    fields_ref = fbCreateOffsetVector(&fbb, field_ref, column_count);
+    free(field_ref);
+
+    fbStartTable(&fbb);
+#if SK_LITTLE_ENDIAN
+    fbAddScalar(&fbb, 0, ARROW_ENDIAN_LITTLE, 2);
+#else
+    fbAddScalar(&fbb, 0, ARROW_ENDIAN_BIG, 2);
+#endif
+    fbAddOffset(&fbb, 1, fields_ref);
+    return fbEndTable(&fbb);
+}
+
+
+/*
+ *  arrowBlockAdd(offset, metadata_len, body_len);
+ *
+ *    Remember the location of a dictionary or record batch for the
+ *    footer of the Arrow file.
+ */
+static void
+arrowBlockAdd(
+    int64_t             offset,
+    int32_t             metadata_len,
+    int64_t             body_len)
+{
+    arrow_block_t *old_block;
+
+    if (block_count == block_capacity) {
+        block_capacity = (block_capacity ? 2 * block_capacity : 64);
+        old_block = block;
+        block = (arrow_block_t*)realloc(block,
+                                        block_capacity * sizeof(*block));
+        if (NULL == block) {
+            free(old_block);
+            skAppPrintOutOfMemory("block list");
+            exit(EXIT_FAILURE);
+        }
+    }
+    block[block_count].offset = offset;
+    block[block_count].metadata_len = metadata_len;
+    block[block_count].body_len = body_len;
+    ++block_count;
+}
+
+
+/*
+ *  metadata_len = arrowWriteMessage(header_type, header_ref, body_len);
+ *
+ *    Finish a Message whose header is 'header_ref' and write it to
+ *    the output.  The caller writes the body of 'body_len' bytes.
+ *    Return the number of bytes written.
+ */
+static int32_t
+arrowWriteMessage(
+    int                 header_type,
+    uint32_t            header_ref,
+    int64_t             body_len)
+{
+    uint8_t prefix[8];
+    uint32_t message_ref;
+    size_t len;
+
+    fbStartTable(&fbb);
+    fbAddScalar(&fbb, 0, ARROW_METADATA_V5, 2);
+    fbAddScalar(&fbb, 1, header_type, 1);
+    fbAddOffset(&fbb, 2, header_ref);
+    fbAddScalar(&fbb, 3, body_len, 8);
+    message_ref = fbEndTable(&fbb);
+    len = fbFinish(&fbb, message_ref);
+
+    /* the continuation marker and the length of the metadata */
+    fbEncode(prefix, UINT32_MAX, 4);
+    fbEncode(prefix + 4, len, 4);
+    arrowWrite(prefix, sizeof(prefix));
+    arrowWrite(fbb.buf + fbb.head, len);
+
+    return (int32_t)(sizeof(prefix) + len);
+}
+
+
+/*
+ *  ref = arrowCreateRecordBatch(length, nodes, node_count, buffers, buffer_count);
+ *
+ *    Create a RecordBatch table.  'nodes' and 'buffers' hold the
+ *    lengths (and null counts or offsets) of the nodes and buffers.
+ */
+static uint32_t
+arrowCreateRecordBatch(
+    int64_t             length,
+    const int64_t      *nodes,
+    size_t              node_count,
+    const int64_t      *buffers,
+    size_t              buffer_count)
+{
+    uint8_t *encoded;
+    uint32_t nodes_ref;
+    uint32_t buffers_ref;
+    size_t i;
+
+    encoded = (uint8_t*)malloc(16 * (node_count + buffer_count + 1));
+    if (NULL == encoded) {
+        skAppPrintOutOfMemory("record batch");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < 2 * node_count; ++i) {
+        fbEncode(encoded + 8 * i, nodes[i], 8);
+    }
+    nodes_ref = fbCreateStructVector(&fbb, encoded, node_count, 16, 8);
+    for (i = 0; i < 2 * buffer_count; ++i) {
+        fbEncode(encoded + 8 * i, buffers[i], 8);
+    }
+    buffers_ref = fbCreateStructVector(&fbb, encoded, buffer_count, 16, 8);
+    free(encoded);
+
+    fbStartTable(&fbb);
+    fbAddScalar(&fbb, 0, length, 8);
+    fbAddOffset(&fbb, 1, nodes_ref);
+    fbAddOffset(&fbb, 2, buffers_ref);
+    return fbEndTable(&fbb);
+}
+
+
+/*
+ *  arrowPaddedLen(len);
+ *
+ *    Return 'len' rounded up to a multiple of ARROW_ALIGN.
+ */
+static int64_t
+arrowPaddedLen(
+    size_t              len)
+{
+    return (int64_t)((len + ARROW_ALIGN - 1) / ARROW_ALIGN * ARROW_ALIGN);
+}
+
+
+/*
+ *  arrowWriteDictionary(dict);
+ *
+ *    Write the DictionaryBatch message that holds the strings of
+ *    'dict'.
+ */
+static void
+arrowWriteDictionary(
+    const arrow_dict_t *dict)
+{
+    int64_t nodes[2];
+    int64_t buffers[6];
+    uint32_t batch_ref;
+    uint32_t header_ref;
+    int64_t offset;
+    int64_t body_len;
+    int32_t metadata_len;
+
+    nodes[0] = dict->count;
+    nodes[1] = 0;
+    /* validity (none), offsets, values */
+    buffers[0] = 0;
+    buffers[1] = 0;
+    buffers[2] = 0;
+    buffers[3] = dict->offsets.len;
+    buffers[4] = arrowPaddedLen(dict->offsets.len);
+    buffers[5] = dict->values.len;
+    body_len = buffers[4] + arrowPaddedLen(dict->values.len);
+
+    fbReset(&fbb);
+    batch_ref = arrowCreateRecordBatch(dict->count, nodes, 1, buffers, 3);
+    fbStartTable(&fbb);
+    fbAddScalar(&fbb, 0, dict->id, 8);
+    fbAddOffset(&fbb, 1, batch_ref);
+    header_ref = fbEndTable(&fbb);
+
+    offset = bytes_written;
+    metadata_len = arrowWriteMessage(ARROW_HEADER_DICTIONARY, header_ref,
+                                     body_len);
+    arrowWrite(dict->offsets.data, dict->offsets.len);
+    arrowWritePadding(dict->offsets.len);
+    arrowWrite(dict->values.data, dict->values.len);
+    arrowWritePadding(dict->values.len);
+
+    arrowBlockAdd(offset, metadata_len, body_len);
+    ++dict_block_count;
+}
+
+
+/*
+ *  arrowWriteBatch();
+ *
+ *    Write the records in the current batch as a RecordBatch message
+ *    and reset the columns for the next batch.
+ */
+static void
+arrowWriteBatch(
+    void)
+{
+    int64_t *nodes;
+    int64_t *buffers;
+    arrow_column_t *col;
+    const arrow_buf_t *buf[3];
+    size_t buffer_count = 0;
+    uint32_t header_ref;
+    int64_t offset;
+    int64_t body_len = 0;
+    int32_t metadata_len;
+    size_t validity_len;
+    uint32_t i;
+    int j;
+
+    nodes = (int64_t*)malloc(2 * column_count * sizeof(int64_t));
+    buffers = (int64_t*)malloc(6 * column_count * sizeof(int64_t));
+    if (NULL == nodes || NULL == buffers) {
+        skAppPrintOutOfMemory("record batch");
+        exit(EXIT_FAILURE);
+    }
+    validity_len = (batch_rows + 7) / 8;
+
+    /* compute the location of each buffer within the body; the
+     * validity bitmap is only written when the column has nulls */
+    for (i = 0, col = column; i < column_count; ++i, ++col) {
+        nodes[2 * i] = batch_rows;
+        nodes[2 * i + 1] = col->null_count;
+
+        buf[0] = (col->null_count ? &col->validity : NULL);
+        buf[1] = ((ARROW_COL_UTF8 == col->type) ? &col->offsets : NULL);
+        buf[2] = &col->values;
+        for (j = 0; j < 3; ++j) {
+            if (1 == j && NULL == buf[j]) {
+                continue;
+            }
+            buffers[2 * buffer_count] = body_len;
+            if (NULL == buf[j]) {
+                buffers[2 * buffer_count + 1] = 0;
+            } else if (0 == j) {
+                buffers[2 * buffer_count + 1] = validity_len;
+            } else {
+                buffers[2 * buffer_count + 1] = buf[j]->len;
+            }
+            body_len += arrowPaddedLen(buffers[2 * buffer_count + 1]);
+            ++buffer_count;
+        }
+    }
+
+    fbReset(&fbb);
+    header_ref = arrowCreateRecordBatch(batch_rows, nodes, column_count,
+                                        buffers, buffer_count);
+    offset = bytes_written;
+    metadata_len = arrowWriteMessage(ARROW_HEADER_RECORDS, header_ref,
+                                     body_len);
+
+    /* write the body */
+    for (i = 0, col = column; i < column_count; ++i, ++col) {
+        if (col->null_count) {
+            arrowWrite(col->validity.data, validity_len);
+            arrowWritePadding(validity_len);
+        }
+        if (ARROW_COL_UTF8 == col->type) {
+            arrowWrite(col->offsets.data, col->offsets.len);
+            arrowWritePadding(col->offsets.len);
+            /* first offset of next batch is 0 */
+            col->offsets.len = sizeof(int32_t);
+        }
+        arrowWrite(col->values.data, col->values.len);
+        arrowWritePadding(col->values.len);
+
+        col->values.len = 0;
+        col->null_count = 0;
+        memset(col->validity.data, 0, col->validity.cap);
+    }
+
+    if (arrow_file_format) {
+        arrowBlockAdd(offset, metadata_len, body_len);
+    }
+    batch_rows = 0;
+
+    free(nodes);
+    free(buffers);
+}
+
+
+/*
+ *  arrowDictAdd(dict, id, name);
+ *
+ *    Add the string 'name' for 'id' to the dictionary 'dict', reusing
+ *    the existing entry when 'name' is already in the dictionary.
+ */
+static void
+arrowDictAdd(
+    arrow_dict_t       *dict,
+    size_t              id,
+    const char         *name)
+{
+    const int32_t *offsets = (const int32_t*)dict->offsets.data;
+    size_t len = strlen(name);
+    int32_t end;
+    int32_t i;
+
+    assert(id < dict->index_count);
+    for (i = 0; i < dict->count; ++i) {
+        if ((size_t)(offsets[i + 1] - offsets[i]) == len
+            && 0 == memcmp(dict->values.data + offsets[i], name, len))
+        {
+            dict->index[id] = (int16_t)i;
+            return;
+        }
+    }
+    if (dict->count == INT16_MAX) {
+        /* no room for more entries */
+        return;
+    }
+    arrowBufAppend(&dict->values, name, len);
+    end = (int32_t)dict->values.len;
+    arrowBufAppend(&dict->offsets, &end, sizeof(end));
+    dict->index[id] = (int16_t)dict->count;
+    ++dict->count;
+}
+
+
+/*
+ *  arrowDictInit(dict, id, index_count);
+ *
+ *    Initialize the dictionary 'dict' to have the identifier 'id' and
+ *    to map IDs from 0 to 'index_count'-1.
+ */
+static void
+arrowDictInit(
+    arrow_dict_t       *dict,
+    int64_t             id,
+    size_t              index_count)
+{
+    int32_t zero = 0;
+    size_t i;
+
+    memset(dict, 0, sizeof(arrow_dict_t));
+    dict->id = id;
+    dict->index_count = index_count;
+    dict->index = (int16_t*)malloc((index_count + 1) * sizeof(int16_t));
+    if (NULL == dict->index) {
+        skAppPrintOutOfMemory("dictionary");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < index_count; ++i) {
+        dict->index[i] = -1;
+    }
+    arrowBufAppend(&dict->offsets, &zero, sizeof(zero));
+}
+
+
+/*
+ *  arrowDictFree(dict);
+ *
+ *    Free the memory used by 'dict'.
+ */
+static void
+arrowDictFree(
+    arrow_dict_t       *dict)
+{
+    free(dict->index);
+    arrowBufFree(&dict->offsets);
+    arrowBufFree(&dict->values);
+    memset(dict, 0, sizeof(arrow_dict_t));
+}
+
+
+/*
+ *  arrowCreateDictionaries();
+ *
+ *    Fill the sensor, class, and type dictionaries from the site
+ *    configuration.  The sensor dictionary holds the sensors the site
+ *    defines and maps their IDs; the class and type dictionaries map
+ *    flowtype IDs.
+ */
+static void
+arrowCreateDictionaries(
+    void)
+{
+    char name[ARROW_TEXT_BUFSIZE];
+    sensor_iter_t iter;
+    sensorID_t sensor_id;
+    sensorID_t sensor_max;
+    flowtypeID_t flowtype_max;
+    size_t count;
+    size_t i;
+
+    /* the maximum IDs are the invalid ID when the site defines none */
+    sensor_max = sksiteSensorGetMaxID();
+    arrowDictInit(&sensor_dict, 0, ((SK_INVALID_SENSOR == sensor_max)
+                                    ? 0 : ((size_t)sensor_max + 1)));
+    sksiteSensorIterator(&iter);
+    while (sksiteSensorIteratorNext(&iter, &sensor_id)) {
+        sksiteSensorGetName(name, sizeof(name), sensor_id);
+        arrowDictAdd(&sensor_dict, sensor_id, name);
+    }
+
+    flowtype_max = sksiteFlowtypeGetMaxID();
+    count = ((SK_INVALID_FLOWTYPE == flowtype_max)
+             ? 0 : ((size_t)flowtype_max + 1));
+    arrowDictInit(&class_dict, 1, count);
+    arrowDictInit(&type_dict, 2, count);
+    for (i = 0; i < count; ++i) {
+        sksiteFlowtypeGetClass(name, sizeof(name), (flowtypeID_t)i);
+        arrowDictAdd(&class_dict, i, name);
+        sksiteFlowtypeGetType(name, sizeof(name), (flowtypeID_t)i);
+        arrowDictAdd(&type_dict, i, name);
+    }
+}
+
+
+/*
+ *  arrowSetValid(col);
+ *
+ *    Mark the current row of 'col' as valid (not null).
+ */
+#define arrowSetValid(col)                                              \
+    ((col)->validity.data[batch_rows >> 3] |= (uint8_t)(1u << (batch_rows & 7)))
+
+
+/*
+ *  arrowAppendValue(col, value, len);
+ *
+ *    Append 'len' bytes of 'value' to 'col' and mark the row valid.
+ */
+static void
+arrowAppendValue(
+    arrow_column_t     *col,
+    const void         *value,
+    size_t              len)
+{
+    memcpy(col->values.data + col->values.len, value, len);
+    col->values.len += len;
+    arrowSetValid(col);
+}
+
+
+/*
+ *  arrowAppendNull(col, len);
+ *
+ *    Append a null value of 'len' bytes to 'col'.
+ */
+static void
+arrowAppendNull(
+    arrow_column_t     *col,
+    size_t              len)
+{
+    memset(col->values.data + col->values.len, 0, len);
+    col->values.len += len;
+    ++col->null_count;
+}
+
+
+/*
+ *  arrowAppendDict(col, id);
+ *
+ *    Append to the dictionary-encoded column 'col' the index for
+ *    'id'; append a null when 'id' is not in the dictionary.
+ */
+static void
+arrowAppendDict(
+    arrow_column_t     *col,
+    size_t              id)
+{
+    int16_t idx = -1;
+
+    if (id < col->dict->index_count) {
+        idx = col->dict->index[id];
+    }
+    if (idx < 0) {
+        arrowAppendNull(col, sizeof(idx));
+    } else {
+        arrowAppendValue(col, &idx, sizeof(idx));
+    }
+}
+
+
+/*
+ *  status = cutArrowStart(file_format, icmp_type_and_code, integer_sensors);
+ *
+ *    Create the columns from the fields in the global 'ascii_str'
+ *    and write the schema and the dictionaries to the output.  Write
+ *    the Arrow file format when 'file_format' is non-zero, or the
+ *    stream format otherwise.  When 'icmp_type_and_code' is non-zero,
+ *    put the ICMP type and code into the sPort and dPort columns.
+ *    When 'integer_sensors' is non-zero, write the sensor as a uint16
+ *    instead of as a string.  Return 0 on success, or -1 on failure.
+ */
+int
+cutArrowStart(
+    int                 file_format,
+    int                 icmp_type_and_code,
+    int                 integer_sensors)
+{
+    static const uint8_t magic[8] = ARROW_MAGIC;
+    arrow_column_t *col;
+    uint32_t header_ref;
+    int ip_as_v6 = 0;
+    int use_dict[3] = {0, 0, 0};
+    size_t width;
+    uint32_t i;
+
+    assert(!started);
+
+    if (isatty(fileno(output.of_fp))) {
+        skAppPrintErr("Will not write binary data on a terminal");
+        return -1;
+    }
+
+    arrow_file_format = file_format;
+    arrow_legacy_icmp = icmp_type_and_code;
+    /* without any sensors in the site configuration, a dictionary
+     * would make every sensor null; write the IDs instead */
+    arrow_integer_sensors = (integer_sensors
+                             || SK_INVALID_SENSOR == sksiteSensorGetMaxID());
+
+#if SK_ENABLE_IPV6
+    /* addresses are IPv4 only when the policy guarantees it */
+    if (ipv6_policy > SK_IPV6POLICY_ASV4) {
+        ip_as_v6 = 1;
+    }
+#endif
+
+    column_count = rwAsciiGetFieldCount(ascii_str);
+    column = (arrow_column_t*)calloc(column_count, sizeof(arrow_column_t));
+    if (NULL == column) {
+        skAppPrintOutOfMemory("columns");
+        return -1;
+    }
+
+    for (i = 0, col = column; i < column_count; ++i, ++col) {
+        col->position = i;
+        rwAsciiGetFieldInfo(ascii_str, i, &col->field_id,
+                            col->name, sizeof(col->name));
+        switch (col->field_id) {
+          case RWREC_FIELD_SIP:
+          case RWREC_FIELD_DIP:
+          case RWREC_FIELD_NHIP:
+            col->type = (ip_as_v6 ? ARROW_COL_IPV6 : ARROW_COL_UINT32);
+            break;
+          case RWREC_FIELD_PKTS:
+          case RWREC_FIELD_BYTES:
+            col->type = ARROW_COL_UINT32;
+            break;
+          case RWREC_FIELD_SPORT:
+          case RWREC_FIELD_DPORT:
+          case RWREC_FIELD_INPUT:
+          case RWREC_FIELD_OUTPUT:
+          case RWREC_FIELD_APPLICATION:
+            col->type = ARROW_COL_UINT16;
+            break;
+          case RWREC_FIELD_PROTO:
+          case RWREC_FIELD_FLAGS:
+          case RWREC_FIELD_INIT_FLAGS:
+          case RWREC_FIELD_REST_FLAGS:
+          case RWREC_FIELD_TCP_STATE:
+          case RWREC_FIELD_ICMP_TYPE:
+          case RWREC_FIELD_ICMP_CODE:
+            col->type = ARROW_COL_UINT8;
+            break;
+          case RWREC_FIELD_STIME:
+          case RWREC_FIELD_STIME_MSEC:
+          case RWREC_FIELD_ETIME:
+          case RWREC_FIELD_ETIME_MSEC:
+            col->type = ARROW_COL_TIMESTAMP;
+            break;
+          case RWREC_FIELD_ELAPSED:
+          case RWREC_FIELD_ELAPSED_MSEC:
+            col->type = ARROW_COL_DURATION;
+            break;
+          case RWREC_FIELD_SID:
+            if (arrow_integer_sensors) {
+                col->type = ARROW_COL_UINT16;
+            } else {
+                col->type = ARROW_COL_DICT;
+                col->dict = &sensor_dict;
+                use_dict[0] = 1;
+            }
+            break;
+          case RWREC_FIELD_FTYPE_CLASS:
+            col->type = ARROW_COL_DICT;
+            col->dict = &class_dict;
+            use_dict[1] = 1;
+            break;
+          case RWREC_FIELD_FTYPE_TYPE:
+            col->type = ARROW_COL_DICT;
+            col->dict = &type_dict;
+            use_dict[2] = 1;
+            break;
+          case RWASCII_CALLBACK_FIELD:
+            col->type = ARROW_COL_UTF8;
+            break;
+          default:
+            skAbortBadCase(col->field_id);
+        }
+
+        switch (col->type) {
+          case ARROW_COL_UINT8:     width = sizeof(uint8_t);  break;
+          case ARROW_COL_UINT16:    width = sizeof(uint16_t); break;
+          case ARROW_COL_DICT:      width = sizeof(int16_t);  break;
+          case ARROW_COL_UINT32:    width = sizeof(uint32_t); break;
+          case ARROW_COL_IPV6:      width = 16;               break;
+          case ARROW_COL_TIMESTAMP: width = sizeof(int64_t);  break;
+          case ARROW_COL_DURATION:  width = sizeof(int64_t);  break;
+          case ARROW_COL_UTF8:
+            width = 0;
+            arrowBufReserve(&col->offsets,
+                            (ARROW_BATCH_RECS + 1) * sizeof(int32_t));
+            memset(col->offsets.data, 0, sizeof(int32_t));
+            col->offsets.len = sizeof(int32_t);
+            arrowBufReserve(&col->values, ARROW_BATCH_RECS);
+            break;
+          default:
+            skAbortBadCase(col->type);
+        }
+        if (width) {
+            arrowBufReserve(&col->values, width * ARROW_BATCH_RECS);
+        }
+        arrowBufReserve(&col->validity, ARROW_BATCH_RECS / 8);
+        memset(col->validity.data, 0, col->validity.cap);
+    }
+
+    arrowCreateDictionaries();
+
+    started = 1;
+
+    /* write the magic bytes and the schema */
+    if (arrow_file_format) {
+        arrowWrite(magic, sizeof(magic));
+    }
+    fbReset(&fbb);
+    header_ref = arrowCreateSchema();
+    arrowWriteMessage(ARROW_HEADER_SCHEMA, header_ref, 0);
+
+    /* write the dictionaries that are used; the blocks that locate
+     * them are the first entries in the 'block' array */
+    if (use_dict[0]) {
+        arrowWriteDictionary(&sensor_dict);
+    }
+    if (use_dict[1]) {
+        arrowWriteDictionary(&class_dict);
+    }
+    if (use_dict[2]) {
+        arrowWriteDictionary(&type_dict);
+    }
+
+    return 0;
+}
+
+
+/*
+ *  cutArrowAddRecord(rwrec);
+ *
+ *    Add 'rwrec' to the current batch, writing the batch when it is
+ *    full.
+ */
+void
+cutArrowAddRecord(
+    const rwRec        *rwrec)
+{
+    char text[ARROW_TEXT_BUFSIZE];
+    arrow_column_t *col;
+    uint8_t u8;
+    uint16_t u16;
+    uint32_t u32;
+    int64_t i64;
+    int32_t end;
+    size_t len;
+    uint32_t i;
+#if SK_ENABLE_IPV6
+    uint8_t ipv6[16];
+#endif
+
+    assert(started);
+
+    for (i = 0, col = column; i < column_count; ++i, ++col) {
+        switch (col->field_id) {
+          case RWREC_FIELD_SIP:
+#if SK_ENABLE_IPV6
+            if (ARROW_COL_IPV6 == col->type) {
+                rwRecMemGetSIPv6(rwrec, ipv6);
+                arrowAppendValue(col, ipv6, sizeof(ipv6));
+                break;
+            }
+#endif
+            u32 = rwRecGetSIPv4(rwrec);
+            arrowAppendValue(col, &u32, sizeof(u32));
+            break;
+
+          case RWREC_FIELD_DIP:
+#if SK_ENABLE_IPV6
+            if (ARROW_COL_IPV6 == col->type) {
+                rwRecMemGetDIPv6(rwrec, ipv6);
+                arrowAppendValue(col, ipv6, sizeof(ipv6));
+                break;
+            }
+#endif
+            u32 = rwRecGetDIPv4(rwrec);
+            arrowAppendValue(col, &u32, sizeof(u32));
+            break;
+
+          case RWREC_FIELD_NHIP:
+#if SK_ENABLE_IPV6
+            if (ARROW_COL_IPV6 == col->type) {
+                rwRecMemGetNhIPv6(rwrec, ipv6);
+                arrowAppendValue(col, ipv6, sizeof(ipv6));
+                break;
+            }
+#endif
+            u32 = rwRecGetNhIPv4(rwrec);
+            arrowAppendValue(col, &u32, sizeof(u32));
+            break;
+
+          case RWREC_FIELD_SPORT:
+            if (arrow_legacy_icmp && rwRecIsICMP(rwrec)) {
+                u16 = rwRecGetIcmpType(rwrec);
+            } else {
+                u16 = rwRecGetSPort(rwrec);
+            }
+            arrowAppendValue(col, &u16, sizeof(u16));
+            break;
+
+          case RWREC_FIELD_DPORT:
+            if (arrow_legacy_icmp && rwRecIsICMP(rwrec)) {
+                u16 = rwRecGetIcmpCode(rwrec);
+            } else {
+                u16 = rwRecGetDPort(rwrec);
+            }
+            arrowAppendValue(col, &u16, sizeof(u16));
+            break;
+
+          case RWREC_FIELD_PROTO:
+            u8 = rwRecGetProto(rwrec);
+            arrowAppendValue(col, &u8, sizeof(u8));
+            break;
+
+          case RWREC_FIELD_PKTS:
+            u32 = rwRecGetPkts(rwrec);
+            arrowAppendValue(col, &u32, sizeof(u32));
+            break;
+
+          case RWREC_FIELD_BYTES:
+            u32 = rwRecGetBytes(rwrec);
+            arrowAppendValue(col, &u32, sizeof(u32));
+            break;
+
+          case RWREC_FIELD_FLAGS:
+            u8 = rwRecGetFlags(rwrec);
+            arrowAppendValue(col, &u8, sizeof(u8));
+            break;
+
+          case RWREC_FIELD_INIT_FLAGS:
+            u8 = rwRecGetInitFlags(rwrec);
+            arrowAppendValue(col, &u8, sizeof(u8));
+            break;
+
+          case RWREC_FIELD_REST_FLAGS:
+            u8 = rwRecGetRestFlags(rwrec);
+            arrowAppendValue(col, &u8, sizeof(u8));
+            break;
+
+          case RWREC_FIELD_TCP_STATE:
+            u8 = rwRecGetTcpState(rwrec);
+            arrowAppendValue(col, &u8, sizeof(u8));
+            break;
+
+          case RWREC_FIELD_STIME:
+          case RWREC_FIELD_STIME_MSEC:
+            i64 = rwRecGetStartTime(rwrec);
+            arrowAppendValue(col, &i64, sizeof(i64));
+            break;
+
+          case RWREC_FIELD_ETIME:
+          case RWREC_FIELD_ETIME_MSEC:
+            i64 = rwRecGetEndTime(rwrec);
+            arrowAppendValue(col, &i64, sizeof(i64));
+            break;
+
+          case RWREC_FIELD_ELAPSED:
+          case RWREC_FIELD_ELAPSED_MSEC:
+            i64 = rwRecGetElapsed(rwrec);
+            arrowAppendValue(col, &i64, sizeof(i64));
+            break;
+
+          case RWREC_FIELD_SID:
+            if (ARROW_COL_DICT == col->type) {
+                arrowAppendDict(col, rwRecGetSensor(rwrec));
+            } else {
+                u16 = rwRecGetSensor(rwrec);
+                arrowAppendValue(col, &u16, sizeof(u16));
+            }
+            break;
+
+          case RWREC_FIELD_INPUT:
+            u16 = rwRecGetInput(rwrec);
+            arrowAppendValue(col, &u16, sizeof(u16));
+            break;
+
+          case RWREC_FIELD_OUTPUT:
+            u16 = rwRecGetOutput(rwrec);
+            arrowAppendValue(col, &u16, sizeof(u16));
+            break;
+
+          case RWREC_FIELD_APPLICATION:
+            u16 = rwRecGetApplication(rwrec);
+            arrowAppendValue(col, &u16, sizeof(u16));
+            break;
+
+          case RWREC_FIELD_FTYPE_CLASS:
+          case RWREC_FIELD_FTYPE_TYPE:
+            arrowAppendDict(col, rwRecGetFlowType(rwrec));
+            break;
+
+          case RWREC_FIELD_ICMP_TYPE:
+            if (rwRecIsICMP(rwrec)) {
+                u8 = rwRecGetIcmpType(rwrec);
+                arrowAppendValue(col, &u8, sizeof(u8));
+            } else {
+                arrowAppendNull(col, sizeof(u8));
+            }
+            break;
+
+          case RWREC_FIELD_ICMP_CODE:
+            if (rwRecIsICMP(rwrec)) {
+                u8 = rwRecGetIcmpCode(rwrec);
+                arrowAppendValue(col, &u8, sizeof(u8));
+            } else {
+                arrowAppendNull(col, sizeof(u8));
+            }
+            break;
+
+          case RWASCII_CALLBACK_FIELD:
+            text[0] = '\0';
+            rwAsciiGetCallbackFieldValue(ascii_str, col->position, rwrec,
+                                         NULL, text, sizeof(text));
+            len = strlen(text);
+            arrowBufReserve(&col->values, len);
+            arrowAppendValue(col, text, len);
+            end = (int32_t)col->values.len;
+            arrowBufAppend(&col->offsets, &end, sizeof(end));
+            break;
+
+          default:
+            skAbortBadCase(col->field_id);
+        }
+    }
+
+    if (++batch_rows == ARROW_BATCH_RECS) {
+        arrowWriteBatch();
+    }
+}
+
+
+/*
+ *  cutArrowStop();
+ *
+ *    Write any records in the current batch, the end-of-stream
+ *    marker, and for the Arrow file format, the footer.  Free all
+ *    memory.  Does nothing if cutArrowStart() was not called.
+ */
+void
+cutArrowStop(
+    void)
+{
+    static const uint8_t magic[ARROW_MAGIC_LEN] = {'A','R','R','O','W','1'};
+    uint8_t eos[8];
+    uint8_t *encoded;
+    uint32_t schema_ref;
+    uint32_t dicts_ref;
+    uint32_t batches_ref;
+    uint32_t footer_ref;
+    size_t len;
+    size_t i;
+
+    if (!started) {
+        return;
+    }
+    started = 0;
+
+    if (batch_rows) {
+        arrowWriteBatch();
+    }
+
+    /* the end-of-stream marker */
+    fbEncode(eos, UINT32_MAX, 4);
+    fbEncode(eos + 4, 0, 4);
+    arrowWrite(eos, sizeof(eos));
+
+    if (arrow_file_format) {
+        /* the footer repeats the schema and locates the dictionaries
+         * and the record batches */
+        encoded = (uint8_t*)calloc(block_count + 1, 24);
+        if (NULL == encoded) {
+            skAppPrintOutOfMemory("footer");
+            exit(EXIT_FAILURE);
+        }
+        for (i = 0; i < block_count; ++i) {
+            fbEncode(encoded + 24 * i, block[i].offset, 8);
+            fbEncode(encoded + 24 * i + 8, block[i].metadata_len, 4);
+            fbEncode(encoded + 24 * i + 16, block[i].body_len, 8);
+        }
+
+        fbReset(&fbb);
+        schema_ref = arrowCreateSchema();
+        dicts_ref = fbCreateStructVector(&fbb, encoded, dict_block_count,
+                                         24, 8);
+        batches_ref = fbCreateStructVector(
+            &fbb, encoded + 24 * dict_block_count,
+            block_count - dict_block_count, 24, 8);
+        free(encoded);
+
+        fbStartTable(&fbb);
+        fbAddScalar(&fbb, 0, ARROW_METADATA_V5, 2);
+        fbAddOffset(&fbb, 1, schema_ref);
+        fbAddOffset(&fbb, 2, dicts_ref);
+        fbAddOffset(&fbb, 3, batches_ref);
+        footer_ref = fbEndTable(&fbb);
+        len = fbFinish(&fbb, footer_ref);
+        arrowWrite(fbb.buf + fbb.head, len);
+
+        fbEncode(eos, len, 4);
+        arrowWrite(eos, 4);
+        arrowWrite(magic, sizeof(magic));
+    }
+
+    for (i = 0; i < column_count; ++i) {
+        arrowBufFree(&column[i].validity);
+        arrowBufFree(&column[i].values);
+        arrowBufFree(&column[i].offsets);
+    }
+    free(column);
+    column = NULL;
+    column_count = 0;
+    arrowDictFree(&sensor_dict);
+    arrowDictFree(&class_dict);
+    arrowDictFree(&type_dict);
+    free(block);
+    block = NULL;
+    block_count = 0;
+    block_capacity = 0;
+    dict_block_count = 0;
+    free(fbb.buf);
+    memset(&fbb, 0, sizeof(fbb));
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -96,9 +96,6 @@ static uint64_t start_rec_num = 0;
 static uint64_t end_rec_num = 0;
 /* num_recs and tail_recs are globals */
 
-/* The output stream: where to print the records */
-static sk_fileptr_t output;
-
 /* name of program to run to page output */
 static char *pager = NULL;
 
@@ -140,6 +137,17 @@ static const char *app_plugin_names[] = {
     NULL /* sentinel */
 };
 
+/* output formats: the first of these will be the default */
+static const sk_stringmap_entry_t output_format_names[] = {
+    {"text",         CUT_OUTPUT_TEXT,         NULL,
+     "the text described by the switches above"},
+    {"arrow",        CUT_OUTPUT_ARROW_FILE,   NULL,
+     "an Apache Arrow IPC file"},
+    {"arrow-stream", CUT_OUTPUT_ARROW_STREAM, NULL,
+     "an Apache Arrow IPC stream"},
+    SK_STRINGMAP_SENTINEL
+};
+
 /* timestamp formats: the first of these will be the default */
 static const sk_stringmap_entry_t timestamp_names[] = {
     {"default", 0,                    NULL, "yyyy/mm/ddThh:mm:ss.sss"},
@@ -186,7 +194,9 @@ typedef enum {
     OPT_DELIMITED,
     OPT_OUTPUT_PATH,
     OPT_PAGER,
-    OPT_LEGACY_TIMESTAMPS
+    OPT_LEGACY_TIMESTAMPS,
+    OPT_THREADS,
+    OPT_OUTPUT_FORMAT
 } appOptionsEnum;
 
 static struct option appOptions[] = {
@@ -212,6 +222,8 @@ static struct option appOptions[] = {
     {"output-path",         REQUIRED_ARG, 0, OPT_OUTPUT_PATH},
     {"pager",               REQUIRED_ARG, 0, OPT_PAGER},
     {"legacy-timestamps",   OPTIONAL_ARG, 0, OPT_LEGACY_TIMESTAMPS},
+    {"threads",             REQUIRED_ARG, 0, OPT_THREADS},
+    {"output-format",       REQUIRED_ARG, 0, OPT_OUTPUT_FORMAT},
     {0,0,0,0}               /* sentinel entry */
 };
 
@@ -243,6 +255,8 @@ static const char *appHelp[] = {
     "Send output to given file path. Def. stdout",
     "Program to invoke to page output. Def. $SILK_PAGER or $PAGER",
     "DEPRECATED. Equivalent to --timestamp-format=m/d/y,no-msec",
+    NULL, /* generated dynamically */
+    NULL, /* generated dynamically */
     (char *)NULL
 };
 
@@ -252,6 +266,8 @@ static const char *appHelp[] = {
 static int  appOptionsHandler(clientData cData, int opt_index, char *opt_arg);
 static int  timestampFormatParse(const char* opt_arg, uint32_t *out_flags);
 static void timestampFormatUsage(FILE *fh);
+static int  outputFormatParse(const char *format_name);
+static void outputFormatUsage(FILE *fh);
 static void usageFields(FILE *fh);
 static void helpFields(FILE *fh);
 static int  createStringmaps(void);
@@ -306,6 +322,14 @@ appUsageLong(
             timestampFormatUsage(fh);
             skOptionsIPFormatUsage(fh);
             break;
+          case OPT_THREADS:
+            fprintf(fh, ("Format records to text using this number of"
+                         " threads.\n\tRange 1-%d. Def. $%s or 1\n"),
+                    RWCUT_THREADS_MAX, RWCUT_THREADS_ENVAR);
+            break;
+          case OPT_OUTPUT_FORMAT:
+            outputFormatUsage(fh);
+            break;
           default:
             /* Simple static help text from the appHelp array */
             fprintf(fh, "%s\n", appHelp[i]);
@@ -338,6 +362,12 @@ appTeardown(
     }
     teardownFlag = 1;
 
+    /* stop the formatting threads and write their output */
+    cutThreadsStop();
+
+    /* write the end of the Arrow output */
+    cutArrowStop();
+
     /* Plugin teardown */
     skPluginRunCleanup(SKPLUGIN_APP_CUT);
     skPluginTeardown();
@@ -345,14 +375,14 @@ appTeardown(
     /* close copy input stream */
     skOptionsCtxCopyStreamClose(optctx, skAppPrintErr);
 
+    /* destroy output; this writes any buffered text */
+    rwAsciiStreamDestroy(&ascii_str);
+
     /* close the output file or process */
     if (output.of_name) {
         skFileptrClose(&output, &skAppPrintErr);
     }
 
-    /* destroy output */
-    rwAsciiStreamDestroy(&ascii_str);
-
     /* destroy field map */
     if (key_field_map != NULL) {
         skStringMapDestroy(key_field_map);
@@ -386,6 +416,8 @@ appSetup(
     char              **argv)
 {
     SILK_FEATURES_DEFINE_STRUCT(features);
+    uint32_t tc;
+    char *env;
     int optctx_flags;
     int rv;
     int j;
@@ -441,6 +473,14 @@ appSetup(
         skPluginLoadPlugin(app_plugin_names[j], 0);
     }
 
+    /* check the thread count envar */
+    env = getenv(RWCUT_THREADS_ENVAR);
+    if (env && env[0]) {
+        if (skStringParseUint32(&tc, env, 1, RWCUT_THREADS_MAX) == 0) {
+            thread_count = tc;
+        }
+    }
+
     /* parse options */
     rv = skOptionsCtxOptionsParse(optctx, argc, argv);
     if (rv < 0) {
@@ -476,6 +516,14 @@ appSetup(
         exit(EXIT_FAILURE);
     }
 
+    /* do not use threading when a plug-in does not support it or
+     * when writing Arrow, which does not format the records as text */
+    if ((thread_count > 1)
+        && (!skPluginIsThreadSafe() || CUT_OUTPUT_TEXT != output_format))
+    {
+        thread_count = 1;
+    }
+
     /* check limits; main loop uses 'num_recs' with either 'skip_recs'
      * or 'tail_recs' */
     if (tail_recs) {
@@ -530,7 +578,7 @@ appSetup(
     rwAsciiSetIPFormatFlags(ascii_str, ip_format);
     rwAsciiSetTimestampFlags(ascii_str, time_flags);
 
-    if (cut_opts.no_titles) {
+    if (cut_opts.no_titles || CUT_OUTPUT_TEXT != output_format) {
         rwAsciiSetNoTitles(ascii_str);
     }
     if (cut_opts.no_columns) {
@@ -569,7 +617,7 @@ appSetup(
                           output.of_name, skFileptrStrerror(rv));
             exit(EXIT_FAILURE);
         }
-    } else {
+    } else if (CUT_OUTPUT_TEXT == output_format) {
         /* Invoke the pager */
         rv = skFileptrOpenPager(&output, pager);
         if (rv && rv != SK_FILEPTR_PAGER_IGNORED) {
@@ -579,6 +627,17 @@ appSetup(
 
     rwAsciiSetOutputHandle(ascii_str, output.of_fp);
 
+    /* write the Arrow schema; for a dry-run, the output contains the
+     * schema and no records */
+    if (CUT_OUTPUT_TEXT != output_format) {
+        if (cutArrowStart((CUT_OUTPUT_ARROW_FILE == output_format),
+                          cut_opts.icmp_type_and_code,
+                          cut_opts.integer_sensors))
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
+
     /* if dry-run, print the column titles and exit */
     if (cut_opts.dry_run) {
         rwAsciiPrintTitles(ascii_str);
@@ -749,6 +808,20 @@ appOptionsHandler(
         pager = opt_arg;
         break;
 
+      case OPT_THREADS:
+        rv = skStringParseUint32(&thread_count, opt_arg, 1,
+                                 RWCUT_THREADS_MAX);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
+
+      case OPT_OUTPUT_FORMAT:
+        if (outputFormatParse(opt_arg)) {
+            return 1;
+        }
+        break;
+
       case OPT_LEGACY_TIMESTAMPS:
         if ((opt_arg == NULL) || (opt_arg[0] == '\0') || (opt_arg[0] == '1')) {
             rv = timestampFormatParse("m/d/y,no-msec", &time_flags);
@@ -880,6 +953,86 @@ timestampFormatParse(
 }
 
 
+/*
+ *  status = outputFormatParse(format_name);
+ *
+ *    Parse the name of the output format in 'format_name' and set the
+ *    global 'output_format' to the result.  Return 0 on success, or
+ *    -1 if parsing of the value fails.
+ */
+static int
+outputFormatParse(
+    const char         *format_name)
+{
+    sk_stringmap_t *str_map = NULL;
+    sk_stringmap_status_t sm_err;
+    sk_stringmap_entry_t *sm_entry;
+    int rv = -1;
+
+    /* create a stringmap of the available output formats */
+    if (SKSTRINGMAP_OK != skStringMapCreate(&str_map)) {
+        skAppPrintOutOfMemory(NULL);
+        goto END;
+    }
+    if (skStringMapAddEntries(str_map, -1, output_format_names)
+        != SKSTRINGMAP_OK)
+    {
+        skAppPrintOutOfMemory(NULL);
+        goto END;
+    }
+
+    /* attempt to match */
+    sm_err = skStringMapGetByName(str_map, format_name, &sm_entry);
+    switch (sm_err) {
+      case SKSTRINGMAP_OK:
+        output_format = (cut_output_format_t)sm_entry->id;
+        rv = 0;
+        break;
+
+      case SKSTRINGMAP_PARSE_AMBIGUOUS:
+        skAppPrintErr("Invalid %s: '%s' is ambiguous",
+                      appOptions[OPT_OUTPUT_FORMAT].name, format_name);
+        break;
+
+      case SKSTRINGMAP_PARSE_NO_MATCH:
+        skAppPrintErr("Invalid %s: '%s' is not recognized",
+                      appOptions[OPT_OUTPUT_FORMAT].name, format_name);
+        break;
+
+      default:
+        skAppPrintErr("Unexpected return value from string-map parser (%d)",
+                      sm_err);
+        break;
+    }
+
+  END:
+    if (str_map) {
+        skStringMapDestroy(str_map);
+    }
+    return rv;
+}
+
+
+/*
+ *  outputFormatUsage(fh);
+ *
+ *    Print the description of the argument to the --output-format
+ *    switch to the 'fh' file handle.
+ */
+static void
+outputFormatUsage(
+    FILE               *fh)
+{
+    const sk_stringmap_entry_t *e;
+
+    fprintf(fh, "Write the records in this format. Def. %s. Choices:\n",
+            output_format_names[0].name);
+    for (e = output_format_names; e->name; ++e) {
+        fprintf(fh, "\t%-12s - %s\n", e->name, (const char*)e->userdata);
+    }
+}
+
+
 /*
  *  timestampFormatUsage(fh);
  *
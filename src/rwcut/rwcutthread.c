@@ -0,0 +1,510 @@
+/*
+** Copyright (C) 2001-2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  rwcutthread.c
+**
+**    Variables/Functions to support having rwcut use multiple threads
+**    to convert records to text.
+**
+**    The main thread reads the records and packs them into blocks.
+**    Each worker thread takes the next unformatted block and formats
+**    its records into a text buffer using its own copy of the
+**    rwAsciiStream_t.  A single writer thread writes the text of the
+**    blocks to the output in the order the blocks were filled, so
+**    the output is identical to that of the non-threaded rwcut.
+*/
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: rwcutthread.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
+
+#include "rwcut.h"
+
+
+/* TYPEDEFS AND DEFINES */
+
+/*
+ *    The number of records in a block.
+ */
+#define CUT_BLOCK_RECS  4096
+
+/*
+ *    The number of blocks per worker thread.  Allows the main thread
+ *    to fill blocks while the workers format and the writer writes.
+ */
+#define CUT_BLOCKS_PER_THREAD  4
+
+/*
+ *    The initial size of the text buffer of each block; the buffer
+ *    grows as needed.
+ */
+#define CUT_BLOCK_TEXT_SIZE  0x40000
+
+/*
+ *    The states of a block
+ */
+typedef enum cut_block_state_en {
+    CUT_BLOCK_EMPTY, CUT_BLOCK_FILLED, CUT_BLOCK_FORMATTING,
+    CUT_BLOCK_FORMATTED
+} cut_block_state_t;
+
+/*
+ *    A block of records and the text generated for them.
+ */
+typedef struct cut_block_st {
+    rwRec              *recs;
+    char               *text;
+    size_t              rec_count;
+    size_t              text_len;
+    size_t              text_size;
+    cut_block_state_t   state;
+} cut_block_t;
+
+/*
+ *    A worker thread and its private copy of the ascii stream.
+ */
+typedef struct cut_worker_st {
+    rwAsciiStream_t    *astream;
+    cut_block_t        *block;
+    pthread_t           thread;
+} cut_worker_t;
+
+
+/* LOCAL VARIABLE DEFINITIONS */
+
+/* the main thread */
+static pthread_t main_thread;
+
+/* protects all the variables below and the states of the blocks;
+ * 'cond' is broadcast whenever a block changes state */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+/* the ring of blocks */
+static cut_block_t *block = NULL;
+static size_t block_count = 0;
+
+/* the workers and the writer */
+static cut_worker_t *worker = NULL;
+static pthread_t writer_thread;
+
+/* sequence number of the block being filled by the main thread, of
+ * the next block to be formatted, and of the next block to write */
+static uint64_t fill_seq = 0;
+static uint64_t format_seq = 0;
+static uint64_t write_seq = 0;
+
+/* set when the main thread has no more records */
+static int done = 0;
+
+/* non-zero once cutThreadsStart() has successfully run */
+static int started = 0;
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  ignoreSignals();
+ *
+ *    Prevent the calling thread from receiving signals so that they
+ *    are handled by the main thread.
+ */
+static void
+ignoreSignals(
+    void)
+{
+    sigset_t sigs;
+
+    sigfillset(&sigs);
+    sigdelset(&sigs, SIGABRT);
+    sigdelset(&sigs, SIGBUS);
+    sigdelset(&sigs, SIGILL);
+    sigdelset(&sigs, SIGSEGV);
+    pthread_sigmask(SIG_SETMASK, &sigs, NULL);
+}
+
+
+/*
+ *  appendText(text, text_len, worker);
+ *
+ *    Callback invoked by the rwAsciiStream_t of 'worker' to append
+ *    'text_len' bytes of formatted text to the worker's current block.
+ */
+static void
+appendText(
+    const char         *text,
+    size_t              text_len,
+    void               *v_worker)
+{
+    cut_block_t *blk = ((cut_worker_t*)v_worker)->block;
+    char *old_text;
+
+    if (blk->text_len + text_len > blk->text_size) {
+        old_text = blk->text;
+        do {
+            blk->text_size *= 2;
+        } while (blk->text_len + text_len > blk->text_size);
+        blk->text = (char*)realloc(blk->text, blk->text_size);
+        if (NULL == blk->text) {
+            free(old_text);
+            skAppPrintOutOfMemory("text buffer");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(blk->text + blk->text_len, text, text_len);
+    blk->text_len += text_len;
+}
+
+
+/*
+ *  workerMain(worker);
+ *
+ *    THREAD ENTRY POINT for the workers.
+ *
+ *    Format the records in the next filled block, and mark the block
+ *    as formatted.  Return once all blocks have been formatted.
+ */
+static void *
+workerMain(
+    void               *v_worker)
+{
+    cut_worker_t *w = (cut_worker_t*)v_worker;
+    cut_block_t *blk;
+    const rwRec *rec;
+    const rwRec *end_rec;
+
+    ignoreSignals();
+
+    pthread_mutex_lock(&mutex);
+    for (;;) {
+        while (format_seq == fill_seq
+               || block[format_seq % block_count].state != CUT_BLOCK_FILLED)
+        {
+            if (done && format_seq == fill_seq) {
+                pthread_mutex_unlock(&mutex);
+                return NULL;
+            }
+            pthread_cond_wait(&cond, &mutex);
+        }
+        blk = &block[format_seq % block_count];
+        blk->state = CUT_BLOCK_FORMATTING;
+        ++format_seq;
+        pthread_mutex_unlock(&mutex);
+
+        w->block = blk;
+        blk->text_len = 0;
+        end_rec = blk->recs + blk->rec_count;
+        for (rec = blk->recs; rec < end_rec; ++rec) {
+            rwAsciiPrintRec(w->astream, rec);
+        }
+        rwAsciiFlush(w->astream);
+        w->block = NULL;
+
+        pthread_mutex_lock(&mutex);
+        blk->state = CUT_BLOCK_FORMATTED;
+        pthread_cond_broadcast(&cond);
+    }
+
+    return NULL;                /* NOTREACHED */
+}
+
+
+/*
+ *  writerMain(NULL);
+ *
+ *    THREAD ENTRY POINT for the writer.
+ *
+ *    Write the text of the formatted blocks to the output in the
+ *    order the blocks were filled, and mark each block as empty.
+ *    Return once all blocks have been written.
+ */
+static void *
+writerMain(
+    void        UNUSED(*dummy))
+{
+    cut_block_t *blk;
+
+    ignoreSignals();
+
+    pthread_mutex_lock(&mutex);
+    for (;;) {
+        while (write_seq == fill_seq
+               || block[write_seq % block_count].state != CUT_BLOCK_FORMATTED)
+        {
+            if (done && write_seq == fill_seq) {
+                pthread_mutex_unlock(&mutex);
+                return NULL;
+            }
+            pthread_cond_wait(&cond, &mutex);
+        }
+        blk = &block[write_seq % block_count];
+        pthread_mutex_unlock(&mutex);
+
+        if (blk->text_len) {
+            fwrite(blk->text, blk->text_len, 1, output.of_fp);
+        }
+
+        pthread_mutex_lock(&mutex);
+        blk->state = CUT_BLOCK_EMPTY;
+        blk->rec_count = 0;
+        ++write_seq;
+        pthread_cond_broadcast(&cond);
+    }
+
+    return NULL;                /* NOTREACHED */
+}
+
+
+/*
+ *  submitBlock();
+ *
+ *    Mark the block being filled by the main thread as ready to be
+ *    formatted and wait for the next block in the ring to be empty.
+ *    The caller must hold the mutex.
+ */
+static void
+submitBlock(
+    void)
+{
+    block[fill_seq % block_count].state = CUT_BLOCK_FILLED;
+    ++fill_seq;
+    pthread_cond_broadcast(&cond);
+    while (block[fill_seq % block_count].state != CUT_BLOCK_EMPTY) {
+        pthread_cond_wait(&cond, &mutex);
+    }
+}
+
+
+/*
+ *  freeThreadData();
+ *
+ *    Destroy the ascii streams of the workers and free the workers
+ *    and the blocks.  The data may be only partially created.
+ */
+static void
+freeThreadData(
+    void)
+{
+    size_t i;
+
+    if (worker) {
+        for (i = 0; i < thread_count; ++i) {
+            rwAsciiStreamDestroy(&worker[i].astream);
+        }
+        free(worker);
+        worker = NULL;
+    }
+    if (block) {
+        for (i = 0; i < block_count; ++i) {
+            free(block[i].recs);
+            free(block[i].text);
+        }
+        free(block);
+        block = NULL;
+    }
+}
+
+
+/*
+ *  status = cutThreadsStart();
+ *
+ *    Create the blocks and start 'thread_count' worker threads and
+ *    the writer thread.  The titles must have been printed to the
+ *    global 'ascii_str' before calling this function.  Return 0 on
+ *    success, or -1 on failure.
+ */
+int
+cutThreadsStart(
+    void)
+{
+    size_t i;
+    size_t j;
+
+    assert(thread_count > 1);
+    assert(!started);
+
+    main_thread = pthread_self();
+
+    /* make certain the titles are written before any records */
+    rwAsciiFlush(ascii_str);
+
+    block_count = CUT_BLOCKS_PER_THREAD * thread_count;
+    block = (cut_block_t*)calloc(block_count, sizeof(cut_block_t));
+    worker = (cut_worker_t*)calloc(thread_count, sizeof(cut_worker_t));
+    if (NULL == block || NULL == worker) {
+        skAppPrintOutOfMemory("thread data");
+        freeThreadData();
+        return -1;
+    }
+    for (i = 0; i < block_count; ++i) {
+        block[i].recs = (rwRec*)malloc(CUT_BLOCK_RECS * sizeof(rwRec));
+        block[i].text = (char*)malloc(CUT_BLOCK_TEXT_SIZE);
+        if (NULL == block[i].recs || NULL == block[i].text) {
+            skAppPrintOutOfMemory("record block");
+            freeThreadData();
+            return -1;
+        }
+        block[i].text_size = CUT_BLOCK_TEXT_SIZE;
+        block[i].state = CUT_BLOCK_EMPTY;
+    }
+    for (i = 0; i < thread_count; ++i) {
+        if (rwAsciiStreamClone(&worker[i].astream, ascii_str)) {
+            skAppPrintOutOfMemory("ascii stream");
+            freeThreadData();
+            return -1;
+        }
+        rwAsciiSetOutputCallback(worker[i].astream, &appendText, &worker[i]);
+    }
+
+    started = 1;
+
+    if (pthread_create(&writer_thread, NULL, &writerMain, NULL)) {
+        skAppPrintErr("Unable to create writer thread");
+        started = 0;
+        freeThreadData();
+        return -1;
+    }
+    for (i = 0; i < thread_count; ++i) {
+        if (pthread_create(&worker[i].thread, NULL, &workerMain, &worker[i])) {
+            skAppPrintErr("Unable to create worker thread");
+            /* run with the workers that were created */
+            if (0 == i) {
+                pthread_mutex_lock(&mutex);
+                done = 1;
+                pthread_cond_broadcast(&cond);
+                pthread_mutex_unlock(&mutex);
+                pthread_join(writer_thread, NULL);
+                started = 0;
+                freeThreadData();
+                return -1;
+            }
+            for (j = i; j < thread_count; ++j) {
+                rwAsciiStreamDestroy(&worker[j].astream);
+            }
+            thread_count = i;
+            break;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ *  cutThreadsAddRecord(rwrec);
+ *
+ *    Copy 'rwrec' into the block being filled.  When the block is
+ *    full, pass it to the workers.  Called by the main thread only.
+ */
+void
+cutThreadsAddRecord(
+    const rwRec        *rwrec)
+{
+    cut_block_t *blk = &block[fill_seq % block_count];
+
+    assert(started);
+    assert(blk->state == CUT_BLOCK_EMPTY);
+
+    RWREC_COPY(&blk->recs[blk->rec_count], rwrec);
+    if (++blk->rec_count == CUT_BLOCK_RECS) {
+        pthread_mutex_lock(&mutex);
+        submitBlock();
+        pthread_mutex_unlock(&mutex);
+    }
+}
+
+
+/*
+ *  cutThreadsStop();
+ *
+ *    Pass any partially filled block to the workers, wait for all the
+ *    text to be written, stop the threads, and free the blocks.  Does
+ *    nothing if the threads were never started or if called from a
+ *    thread other than the main thread (such as when a worker exits
+ *    because it could not allocate memory).
+ */
+void
+cutThreadsStop(
+    void)
+{
+    size_t i;
+
+    if (!started || !pthread_equal(main_thread, pthread_self())) {
+        return;
+    }
+    started = 0;
+
+    pthread_mutex_lock(&mutex);
+    if (block[fill_seq % block_count].rec_count) {
+        submitBlock();
+    }
+    done = 1;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+
+    for (i = 0; i < thread_count; ++i) {
+        pthread_join(worker[i].thread, NULL);
+    }
+    pthread_join(writer_thread, NULL);
+
+    freeThreadData();
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -0,0 +1,14 @@
+#! /usr/bin/perl -w
+# MD5: e3d21adb31b498867efc22344babec0a
+# TEST: ./rwcut --fields=1-12,20,21,iType,iCode --ipv6-policy=asv4 --output-format=arrow ../../tests/data.rwf
+
+use strict;
+use SiLKTests;
+
+my $rwcut = check_silk_app('rwcut');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwcut --fields=1-12,20,21,iType,iCode --ipv6-policy=asv4 --output-format=arrow $file{data}";
+my $md5 = "e3d21adb31b498867efc22344babec0a";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,15 @@
+#! /usr/bin/perl -w
+# MD5: 7c018d620dff6e87c61cbc6d3d5ebafc
+# TEST: ./rwcut --fields=sip,dip,stime,dur+msec,sensor,type --ipv6-policy=force --output-format=arrow-stream ../../tests/data.rwf
+
+use strict;
+use SiLKTests;
+
+my $rwcut = check_silk_app('rwcut');
+my %file;
+$file{data} = get_data_or_exit77('data');
+check_features(qw(ipv6));
+my $cmd = "$rwcut --fields=sip,dip,stime,dur+msec,sensor,type --ipv6-policy=force --output-format=arrow-stream $file{data}";
+my $md5 = "7c018d620dff6e87c61cbc6d3d5ebafc";
+
+check_md5_output($md5, $cmd);
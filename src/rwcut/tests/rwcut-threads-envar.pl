@@ -0,0 +1,15 @@
+#! /usr/bin/perl -w
+# MD5: bde923ac1b86163bad21f3ee355a683c
+# TEST: ./rwcut --fields=sport,dport --delimited ../../tests/data.rwf
+
+use strict;
+use SiLKTests;
+
+my $rwcut = check_silk_app('rwcut');
+my %file;
+$file{data} = get_data_or_exit77('data');
+$ENV{SILK_RWCUT_THREADS} = 100000;
+my $cmd = "$rwcut --fields=sport,dport --delimited $file{data}";
+my $md5 = "bde923ac1b86163bad21f3ee355a683c";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,14 @@
+#! /usr/bin/perl -w
+# ERR_MD5: 2eeb678c797f4f2208e6a40d842a04f4
+# TEST: ./rwcut --fields=sport,dport --delimited --threads=257 ../../tests/data.rwf 2>&1
+
+use strict;
+use SiLKTests;
+
+my $rwcut = check_silk_app('rwcut');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwcut --fields=sport,dport --delimited --threads=257 $file{data} 2>&1";
+my $md5 = "2eeb678c797f4f2208e6a40d842a04f4";
+
+check_md5_output($md5, $cmd, 1);
@@ -0,0 +1,14 @@
+#! /usr/bin/perl -w
+# MD5: bde923ac1b86163bad21f3ee355a683c
+# TEST: ./rwcut --fields=sport,dport --delimited --threads=256 ../../tests/data.rwf
+
+use strict;
+use SiLKTests;
+
+my $rwcut = check_silk_app('rwcut');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwcut --fields=sport,dport --delimited --threads=256 $file{data}";
+my $md5 = "bde923ac1b86163bad21f3ee355a683c";
+
+check_md5_output($md5, $cmd);
@@ -85,6 +85,22 @@ RCSIDENT("$SiLK: fglob.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 /* Output handle for --print-missing-files output */
 #define MISSING_FH stderr
 
+/* How --shard assigns files to shards: by a hash of the file's hour,
+ * sensor, and flowtype, or by balancing the sizes of the files */
+#define FGLOB_SHARD_HASH  0
+#define FGLOB_SHARD_SIZE  1
+
+/*
+ *  A file that exists, its size, and its position in the order that
+ *  fglob visits the files.  Used when --shard-balance=size.
+ */
+typedef struct fglob_shard_file_st {
+    char           *path;
+    int64_t         size;
+    size_t          pos;
+    uint32_t        shard;
+} fglob_shard_file_t;
+
 /*
  *  Structure for all pertinent information for a given find request.
  */
@@ -122,6 +138,20 @@ typedef struct fglobListStruct_st {
      * created once we know the number of options.*/
     char          **fg_option;
 
+    /* the shard to return, numbered from 0, and the number of
+     * shards.  All files are returned when fg_shard_count < 2 */
+    uint32_t        fg_shard_id;
+    uint32_t        fg_shard_count;
+    /* how files are assigned to shards; one of FGLOB_SHARD_* */
+    int             fg_shard_balance;
+
+    /* when --shard-balance=size, the names of the files in this
+     * shard, the number of files, and the index of the next file to
+     * return */
+    char          **fg_shard_files;
+    size_t          fg_shard_file_count;
+    size_t          fg_shard_file_idx;
+
 } fglobListStruct_t;
 
 
@@ -137,6 +167,9 @@ static int fglobInitTimes(void);
 static int fglobHandler(clientData cData, int opt_index, char *opt_arg);
 static void fglobEnableAllSensors(void);
 static int fglobParseSensors(sk_bitmap_t **sensor_bits_ptr);
+static char *fglobNextFile(char *buf, size_t bufsize);
+static uint32_t fglobShardHash(void);
+static int fglobShardBySize(void);
 
 
 /* INTERNAL VARIABLES */
@@ -153,7 +186,8 @@ enum fglobOptionEnum {
     FGLOB_OPT_CLASS, FGLOB_OPT_TYPE, FGLOB_OPT_FLOWTYPES, FGLOB_OPT_SENSORS,
     FGLOB_OPT_START_DATE, FGLOB_OPT_END_DATE,
     FGLOB_OPT_PRINT_MISSING_FILES,
-    FGLOB_OPT_DATA_ROOTDIR
+    FGLOB_OPT_DATA_ROOTDIR,
+    FGLOB_OPT_SHARD, FGLOB_OPT_SHARD_BALANCE
 };
 
 static struct option fglobOptions[] = {
@@ -165,6 +199,8 @@ static struct option fglobOptions[] = {
     {"end-date",             REQUIRED_ARG, 0, FGLOB_OPT_END_DATE},
     {"print-missing-files",  NO_ARG,       0, FGLOB_OPT_PRINT_MISSING_FILES},
     {"data-rootdir",         REQUIRED_ARG, 0, FGLOB_OPT_DATA_ROOTDIR},
+    {"shard",                REQUIRED_ARG, 0, FGLOB_OPT_SHARD},
+    {"shard-balance",        REQUIRED_ARG, 0, FGLOB_OPT_SHARD_BALANCE},
     {0, 0, 0, 0}
 };
 
@@ -196,6 +232,12 @@ static const char *fglobHelp[] = {
     ("Print the names of missing files to STDERR.\n"
      "\tDef. No"),
     ("Root of directory tree containing packed data"),
+    ("Process only the files in shard K of N, where K is\n"
+     "\tbetween 1 and N, so that N processes started with the same\n"
+     "\tswitches together process every file once. Def. All files"),
+    ("Assign files to shards by a 'hash' of the file's\n"
+     "\thour, sensor, and flowtype, or balance the shards by file 'size'.\n"
+     "\tDef. hash"),
     (char*)NULL
 };
 
@@ -522,6 +564,7 @@ fglobTeardown(
     void)
 {
     static int teardownFlag = 0;
+    size_t j;
     int i;
 
     /* Idempotency check. */
@@ -549,6 +592,15 @@ fglobTeardown(
         fList->fg_sensor_count = NULL;
     }
 
+    /* free the files in the shard */
+    if (fList->fg_shard_files) {
+        for (j = 0; j < fList->fg_shard_file_count; ++j) {
+            free(fList->fg_shard_files[j]);
+        }
+        free(fList->fg_shard_files);
+        fList->fg_shard_files = NULL;
+    }
+
     /* free the options */
     if (fList->fg_option) {
         free(fList->fg_option);
@@ -563,7 +615,8 @@ fglobTeardown(
  *  filename = fglobNext();
  *
  *    Return the name of next available file.  Returns NULL if all
- *    files have been processed.
+ *    files have been processed.  When --shard was given, only the
+ *    files in the requested shard are returned.
  *
  *    Will complete the initialization of the library if required.
  */
@@ -572,13 +625,6 @@ fglobNext(
     char               *buf,
     size_t              bufsize)
 {
-    int (*file_exists_fn)(const char *path);
-    char *ext;
-
-    {
-        file_exists_fn = &skFileExists;
-    }
-
     if (!fList->fg_initialized) {
         if (fglobInit()) {
             /* error */
@@ -586,6 +632,56 @@ fglobNext(
         }
     }
 
+    if (fList->fg_shard_count < 2) {
+        return fglobNextFile(buf, bufsize);
+    }
+
+    if (FGLOB_SHARD_SIZE == fList->fg_shard_balance) {
+        if (NULL == fList->fg_shard_files) {
+            if (fglobShardBySize()) {
+                /* error */
+                return NULL;
+            }
+        }
+        if (fList->fg_shard_file_idx >= fList->fg_shard_file_count) {
+            return NULL;
+        }
+        strncpy(buf, fList->fg_shard_files[fList->fg_shard_file_idx],
+                bufsize);
+        buf[bufsize-1] = '\0';
+        ++fList->fg_shard_file_idx;
+        return buf;
+    }
+
+    while (fglobNextFile(buf, bufsize) != NULL) {
+        if (fglobShardHash() == fList->fg_shard_id) {
+            return buf;
+        }
+    }
+    return NULL;
+}
+
+
+/*
+ *  filename = fglobNextFile(buf, bufsize);
+ *
+ *    Fill 'buf', a buffer of size 'bufsize', with the name of the
+ *    next file that exists, ignoring --shard, and return 'buf'.
+ *    Return NULL if all files have been visited.  fglobInit() must
+ *    be called before calling this function.
+ */
+static char *
+fglobNextFile(
+    char               *buf,
+    size_t              bufsize)
+{
+    int (*file_exists_fn)(const char *path);
+    char *ext;
+
+    {
+        file_exists_fn = &skFileExists;
+    }
+
     /* keep adjusting the counters until we find a file that exists */
     while (fglobAdjustCountersFlowtype()) {
         /* Create the full path to the data file from the root dir,
@@ -626,6 +722,157 @@ fglobNext(
 }
 
 
+/*
+ *  shard = fglobShardHash();
+ *
+ *    Return the shard, numbered from 0, of the file that
+ *    fglobNextFile() most recently returned.  The shard is computed
+ *    from a hash of the file's hour, sensor, and flowtype, so that
+ *    every process that is given the same selection switches assigns
+ *    the file to the same shard.
+ */
+static uint32_t
+fglobShardHash(
+    void)
+{
+    uint64_t h;
+
+    h = (((uint64_t)(fList->fg_time_idx / 3600000) << 24)
+         | ((uint64_t)fList->fg_flowtype_list[fList->fg_flowtype_idx] << 16)
+         | (uint64_t)(fList->fg_sensor_list[fList->fg_flowtype_idx]
+                      [fList->fg_sensor_idx]));
+
+    /* mix the bits (the 64-bit finalizer from MurmurHash3) so that
+     * consecutive hours and sensors are spread across the shards */
+    h ^= h >> 33;
+    h *= UINT64_C(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    h *= UINT64_C(0xc4ceb9fe1a85ec53);
+    h ^= h >> 33;
+
+    return (uint32_t)(h % fList->fg_shard_count);
+}
+
+
+/*
+ *    Callback for qsort() used by fglobShardBySize() to sort files by
+ *    decreasing size, and by the order fglob visits them when the
+ *    sizes are equal.
+ */
+static int
+fglobShardCompare(
+    const void         *v_a,
+    const void         *v_b)
+{
+    const fglob_shard_file_t *a = *(const fglob_shard_file_t**)v_a;
+    const fglob_shard_file_t *b = *(const fglob_shard_file_t**)v_b;
+
+    if (a->size != b->size) {
+        return ((a->size > b->size) ? -1 : 1);
+    }
+    return ((a->pos < b->pos) ? -1 : (a->pos > b->pos));
+}
+
+
+/*
+ *  status = fglobShardBySize();
+ *
+ *    Visit every file that exists, and assign the files to shards so
+ *    that the total size of the files in each shard is nearly the
+ *    same: Starting with the largest file, each file is put into the
+ *    shard that has the smallest total so far.  Store the names of
+ *    the files in the requested shard in 'fg_shard_files' in the
+ *    order fglob visited them.  Every process that is given the same
+ *    selection switches computes the same assignment as long as the
+ *    files do not change.
+ *
+ *    Return 0 on success, or -1 on error.
+ */
+static int
+fglobShardBySize(
+    void)
+{
+    char path[PATH_MAX];
+    fglob_shard_file_t *file = NULL;
+    fglob_shard_file_t **sorted = NULL;
+    fglob_shard_file_t *new_file;
+    uint64_t *total = NULL;
+    size_t file_count = 0;
+    size_t file_alloc = 0;
+    size_t i;
+    uint32_t t;
+    uint32_t smallest;
+    int rv = -1;
+
+    /* visit every file */
+    while (fglobNextFile(path, sizeof(path)) != NULL) {
+        if (file_count == file_alloc) {
+            file_alloc = (file_alloc ? 2 * file_alloc : 256);
+            new_file = (fglob_shard_file_t*)realloc(
+                file, file_alloc * sizeof(fglob_shard_file_t));
+            if (NULL == new_file) {
+                skAppPrintOutOfMemory("shard file list");
+                goto END;
+            }
+            file = new_file;
+        }
+        file[file_count].path = strdup(path);
+        if (NULL == file[file_count].path) {
+            skAppPrintOutOfMemory("shard file name");
+            goto END;
+        }
+        file[file_count].size = (int64_t)skFileSize(path);
+        file[file_count].pos = file_count;
+        file[file_count].shard = 0;
+        ++file_count;
+    }
+
+    /* sort the files by size and assign each to the smallest shard */
+    sorted = (fglob_shard_file_t**)malloc((file_count + 1)
+                                          * sizeof(fglob_shard_file_t*));
+    total = (uint64_t*)calloc(fList->fg_shard_count, sizeof(uint64_t));
+    fList->fg_shard_files = (char**)calloc(file_count + 1, sizeof(char*));
+    if (NULL == sorted || NULL == total || NULL == fList->fg_shard_files) {
+        skAppPrintOutOfMemory("shard file list");
+        goto END;
+    }
+    for (i = 0; i < file_count; ++i) {
+        sorted[i] = &file[i];
+    }
+    qsort(sorted, file_count, sizeof(fglob_shard_file_t*),
+          &fglobShardCompare);
+    for (i = 0; i < file_count; ++i) {
+        smallest = 0;
+        for (t = 1; t < fList->fg_shard_count; ++t) {
+            if (total[t] < total[smallest]) {
+                smallest = t;
+            }
+        }
+        sorted[i]->shard = smallest;
+        total[smallest] += sorted[i]->size;
+    }
+
+    /* keep the files in this shard, in the order they were visited */
+    for (i = 0; i < file_count; ++i) {
+        if (file[i].shard == fList->fg_shard_id) {
+            fList->fg_shard_files[fList->fg_shard_file_count++]
+                = file[i].path;
+            file[i].path = NULL;
+        }
+    }
+    rv = 0;
+
+  END:
+    for (i = 0; i < file_count; ++i) {
+        free(file[i].path);
+    }
+    free(file);
+    free(sorted);
+    free(total);
+    return rv;
+}
+
+
 /*
  *  count = fglobFileCount();
  *
@@ -736,6 +983,8 @@ fglobHandler(
     int                 opt_index,
     char               *opt_arg)
 {
+    int rv;
+
     fList->fg_user_option_count++;
 
     switch (opt_index) {
@@ -757,6 +1006,38 @@ fglobHandler(
         fList->fg_missing = 1;
         break;
 
+      case FGLOB_OPT_SHARD:
+        if (fList->fg_shard_count) {
+            skAppPrintErr("Invalid %s: Switch used multiple times",
+                          fglobOptions[opt_index].name);
+            return 1;
+        }
+        rv = skStringParseUint32(&fList->fg_shard_id, opt_arg, 1, 0);
+        if (rv <= 0 || opt_arg[rv] != '/') {
+            goto SHARD_ERROR;
+        }
+        if (skStringParseUint32(&fList->fg_shard_count, &opt_arg[rv+1], 1, 0)
+            || fList->fg_shard_id > fList->fg_shard_count)
+        {
+            goto SHARD_ERROR;
+        }
+        /* number the shards from 0 */
+        --fList->fg_shard_id;
+        break;
+
+      case FGLOB_OPT_SHARD_BALANCE:
+        if (0 == strcmp(opt_arg, "hash")) {
+            fList->fg_shard_balance = FGLOB_SHARD_HASH;
+        } else if (0 == strcmp(opt_arg, "size")) {
+            fList->fg_shard_balance = FGLOB_SHARD_SIZE;
+        } else {
+            skAppPrintErr(("Invalid %s '%s': Expected one of"
+                           " hash or size"),
+                          fglobOptions[opt_index].name, opt_arg);
+            return 1;
+        }
+        break;
+
       case FGLOB_OPT_DATA_ROOTDIR:
         if (!skDirExists(opt_arg)) {
             skAppPrintErr("Root data directory '%s' does not exist", opt_arg);
@@ -774,6 +1055,13 @@ fglobHandler(
     }
 
     return 0;                     /* OK */
+
+  SHARD_ERROR:
+    skAppPrintErr(("Invalid %s '%s': Expected K/N, where N is the number"
+                   " of shards and K is between 1 and N"),
+                  fglobOptions[opt_index].name, opt_arg);
+    fList->fg_shard_count = 0;
+    return 1;
 }
 
 
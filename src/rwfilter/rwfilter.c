@@ -115,6 +115,9 @@ int print_volume_stats = 0;
 /* total number of threads */
 uint32_t thread_count = RWFILTER_THREADS_DEFAULT;
 
+/* how the threads write their output */
+int thread_output = THREAD_OUTPUT_SHARED;
+
 /* number of checks to preform */
 int checker_count = 0;
 
@@ -526,10 +529,11 @@ closeOneOutput(
 
 
 /*
- *  ok = filterFile(datafile, ipfile_basename, stats);
+ *  ok = filterFile(datafile, ipfile_basename, stats, plan);
  *
  *    This is the actual filtering of the file 'datafile'.  The
  *    function will call the function to write the header if required.
+ *    The records are checked using the check 'plan'.
  *    The 'ipfile_basename' parameter is passed to filterCheckFile();
  *    it should be NULL or contain the full-path (minus extension) of the
  *    file that contains Bloom filter or IPset information about the
@@ -543,11 +547,22 @@ static int
 filterFile(
     const char         *datafile,
     const char         *ipfile_basename,
-    filter_stats_t     *stats)
+    filter_stats_t     *stats,
+    filter_plan_t      *plan)
 {
-    rwRec rwrec;
+    rwRec rwrec[FILTER_BATCH_SIZE];
+    checktype_t result_list[FILTER_BATCH_SIZE];
+    const rwRec *rec;
     skstream_t *in_rwios;
-    int i;
+    skstream_t *cache_ios;
+    filter_cache_entry_t *cache_entry = NULL;
+    rec_count_t cache_read;
+    rec_count_t read_before = {0, 0, 0};
+    uint64_t remaining;
+    size_t batch_size;
+    size_t count;
+    size_t j;
+    int from_cache = 0;
     int fail_entire_file = 0;
     int result = RWF_PASS;
     int rv = SKSTREAM_OK;
@@ -608,8 +623,17 @@ filterFile(
         }
     }
 
-    /* determine if all the records in the file will fail the checks */
-    if (filterCheckFile(in_rwios, ipfile_basename) == 1) {
+    /* use the records that passed when the file was last processed,
+     * or else store the records that pass this time */
+    cache_ios = cacheLookup(datafile, &cache_read);
+    if (cache_ios) {
+        skStreamDestroy(&in_rwios);
+        in_rwios = cache_ios;
+        from_cache = 1;
+        stats->read.flows += cache_read.flows;
+        stats->read.pkts  += cache_read.pkts;
+        stats->read.bytes += cache_read.bytes;
+    } else if (filterCheckFile(in_rwios, ipfile_basename) == 1) {
         /* all records in the file will fail the user's tests */
         fail_entire_file = 1;
         result = RWF_FAIL;
@@ -635,77 +659,130 @@ filterFile(
             /* else computing volume stats, and we need to read each
              * record to get its byte and packet counts. */
         }
-    }
+    } else {
+        cache_entry = cacheEntryCreate(datafile);
+        read_before = stats->read;
+    }
+
+    /* read the records in batches and process each record */
+    while (reading_records && SKSTREAM_OK == in_rv) {
+        /* when an output has a record limit, read no more records
+         * than could still be written to it.  The limit can then
+         * only be reached by the final record of the batch, and
+         * neither the checks nor the plug-in filters see a record
+         * that follows it. */
+        batch_size = FILTER_BATCH_SIZE;
+        if (dest_type[DEST_PASS].count && dest_type[DEST_PASS].max_records) {
+            remaining = (dest_type[DEST_PASS].max_records
+                         - stats->pass.flows);
+            if (remaining < batch_size) {
+                batch_size = (size_t)remaining;
+            }
+        }
+        if (dest_type[DEST_FAIL].count && dest_type[DEST_FAIL].max_records) {
+            remaining = (dest_type[DEST_FAIL].max_records
+                         - (stats->read.flows - stats->pass.flows));
+            if (remaining < batch_size) {
+                batch_size = (size_t)remaining;
+            }
+        }
+        assert(batch_size > 0);
 
-    /* read and process each record */
-    while (reading_records
-           && (SKSTREAM_OK == (in_rv = skStreamReadRecord(in_rwios, &rwrec))))
-    {
-        /* increment number of read records */
-        INCR_REC_COUNT(stats->read, &rwrec);
+        for (count = 0;
+             (count < batch_size
+              && (SKSTREAM_OK
+                  == (in_rv = skStreamReadRecord(in_rwios, &rwrec[count]))));
+             ++count)
+            ;                   /* empty */
 
-        /* the all-dest */
-        if (dest_type[DEST_ALL].count) {
-            PRINT_REC_TO_DEST_ID(&rwrec, DEST_ALL);
-#if 0 /* dest_type[DEST_ALL].max_records is never set */
-            /* close all streams for this destination type if we are
-             * at user's requested max.  If max_records is 0, this
-             * will never be true, and all records will be
-             * processed. */
-            if (stats->read.flows == dest_type[DEST_ALL].max_records) {
-                reading_records = closeOutputDests(DEST_ALL, 0);
-            }
-#endif  /* 0 */
+        if (!fail_entire_file && !from_cache) {
+            filterCheckBatch(plan, rwrec, result_list, count);
         }
 
-        if (!fail_entire_file) {
-            /* run all checker()'s until end or one doesn't pass */
-            for (i=0, result=RWF_PASS;
-                 i < checker_count && result == RWF_PASS;
-                 ++i)
-            {
-                result = (*(checker[i]))(&rwrec);
+        for (j = 0; j < count && reading_records; ++j) {
+            rec = &rwrec[j];
+
+            /* increment number of read records; the cache holds only
+             * the records that pass and their count is already known */
+            if (!from_cache) {
+                INCR_REC_COUNT(stats->read, rec);
             }
-        }
 
-        switch (result) {
-          case RWF_PASS:
-          case RWF_PASS_NOW:
-            /* increment number of record that pass */
-            INCR_REC_COUNT(stats->pass, &rwrec);
-
-            /* the pass-dest */
-            if (dest_type[DEST_PASS].count) {
-                PRINT_REC_TO_DEST_ID(&rwrec, DEST_PASS);
-                if (stats->pass.flows == dest_type[DEST_PASS].max_records) {
-                    /* close all streams for this destination type
-                     * since we are at user's specified max. */
-                    reading_records = closeOutputDests(DEST_PASS, 0);
+            /* the all-dest */
+            if (dest_type[DEST_ALL].count) {
+                PRINT_REC_TO_DEST_ID(rec, DEST_ALL);
+#if 0 /* dest_type[DEST_ALL].max_records is never set */
+                /* close all streams for this destination type if we are
+                 * at user's requested max.  If max_records is 0, this
+                 * will never be true, and all records will be
+                 * processed. */
+                if (stats->read.flows == dest_type[DEST_ALL].max_records) {
+                    reading_records = closeOutputDests(DEST_ALL, 0);
                 }
+#endif  /* 0 */
             }
-            break;
-
-          case RWF_FAIL:
-            /* the fail-dest */
-            if (dest_type[DEST_FAIL].count) {
-                PRINT_REC_TO_DEST_ID(&rwrec, DEST_FAIL);
-                if ((stats->read.flows - stats->pass.flows)
-                    == dest_type[DEST_FAIL].max_records)
-                {
-                    /* close all streams for this destination type
-                     * since we are at user's specified max. */
-                    reading_records = closeOutputDests(DEST_FAIL, 0);
-                }
+
+            if (!fail_entire_file && !from_cache) {
+                result = result_list[j];
             }
-            break;
 
-          default:
-            break;
+            switch (result) {
+              case RWF_PASS:
+              case RWF_PASS_NOW:
+                /* increment number of record that pass */
+                INCR_REC_COUNT(stats->pass, rec);
+
+                if (cache_entry) {
+                    cacheEntryAddRecord(cache_entry, rec);
+                }
+
+                /* the pass-dest */
+                if (dest_type[DEST_PASS].count) {
+                    PRINT_REC_TO_DEST_ID(rec, DEST_PASS);
+                    if (stats->pass.flows
+                        == dest_type[DEST_PASS].max_records)
+                    {
+                        /* close all streams for this destination type
+                         * since we are at user's specified max. */
+                        reading_records = closeOutputDests(DEST_PASS, 0);
+                    }
+                }
+                break;
+
+              case RWF_FAIL:
+                /* the fail-dest */
+                if (dest_type[DEST_FAIL].count) {
+                    PRINT_REC_TO_DEST_ID(rec, DEST_FAIL);
+                    if ((stats->read.flows - stats->pass.flows)
+                        == dest_type[DEST_FAIL].max_records)
+                    {
+                        /* close all streams for this destination type
+                         * since we are at user's specified max. */
+                        reading_records = closeOutputDests(DEST_FAIL, 0);
+                    }
+                }
+                break;
+
+              default:
+                break;
+            }
         }
 
-    } /* while (reading_records && skStreamReadRecord()) */
+    } /* while (reading_records && in_rv == SKSTREAM_OK) */
 
   END:
+    if (cache_entry) {
+        /* store the entry only when every record was processed */
+        if (SKSTREAM_ERR_EOF == in_rv && reading_records && 0 == rv) {
+            cache_read.flows = stats->read.flows - read_before.flows;
+            cache_read.pkts  = stats->read.pkts  - read_before.pkts;
+            cache_read.bytes = stats->read.bytes - read_before.bytes;
+            cacheEntryCommit(cache_entry, &cache_read);
+        } else {
+            cacheEntryDestroy(cache_entry);
+        }
+    }
+
     if (in_rv == SKSTREAM_OK || in_rv == SKSTREAM_ERR_EOF) {
         in_rv = 0;
     } else {
@@ -802,6 +879,7 @@ int main(int argc, char **argv)
     SILK_FEATURES_DEFINE_STRUCT(features);
     char datafile[PATH_MAX];
     filter_stats_t stats;
+    filter_plan_t *plan;
     int rv_file;
     int rv = 0;
     time_t start_timer;
@@ -833,8 +911,13 @@ int main(int argc, char **argv)
     {
         /* non-threaded */
         filterIgnoreSigPipe();
+        plan = filterPlanCreate();
+        if (NULL == plan) {
+            skAppPrintOutOfMemory("check plan");
+            return EXIT_FAILURE;
+        }
         while (appNextInput(datafile, sizeof(datafile)) != NULL) {
-            rv_file = filterFile(datafile, NULL, &stats);
+            rv_file = filterFile(datafile, NULL, &stats, plan);
             if (rv_file < 0) {
                 /* fatal */
                 return EXIT_FAILURE;
@@ -842,6 +925,7 @@ int main(int argc, char **argv)
             /* if (rv_file > 0) there was an error opening/reading
              * input: ignore */
         }
+        filterPlanDestroy(plan);
     }
 
     /*
@@ -93,6 +93,24 @@ RCSIDENTVAR(rcsID_RWFILTER_H, "$SiLK: rwfilter.h b7b8edebba12 2015-01-05 18:05:2
 /* default number of threads to use */
 #define RWFILTER_THREADS_DEFAULT 1
 
+/* environment variable that names the query result cache directory */
+#define RWFILTER_CACHE_DIR_ENVAR  "SILK_RWFILTER_CACHE_DIRECTORY"
+
+/*
+ *  How the threads write records to the output destinations; the
+ *  argument to --thread-output.  SHARED: the threads take turns
+ *  writing to each destination stream.  WRITER: the threads hand
+ *  filled buffers to a writer thread that writes every stream.
+ *  SHARD: each thread writes to its own files.
+ */
+#define THREAD_OUTPUT_SHARED  0
+#define THREAD_OUTPUT_WRITER  1
+#define THREAD_OUTPUT_SHARD   2
+
+/* the string in a destination pathname that is replaced by the
+ * thread number when --thread-output=shard */
+#define THREAD_SHARD_MARKER  "%T"
+
 
 /* maximum number of dynamic libraries that we support */
 #define APP_MAX_DYNLIBS 8
@@ -100,6 +118,10 @@ RCSIDENTVAR(rcsID_RWFILTER_H, "$SiLK: rwfilter.h b7b8edebba12 2015-01-05 18:05:2
 /* maximum number of filter checks */
 #define MAX_CHECKERS (APP_MAX_DYNLIBS + 2)
 
+/* number of records read and checked at once, so that plug-in
+ * filters which support it may be called on a batch of records */
+#define FILTER_BATCH_SIZE 256
+
 /*
  *  The number and types of skstream_t output streams: pass, fail, all
  */
@@ -114,6 +136,9 @@ typedef struct destination_st destination_t;
 struct destination_st {
     skstream_t     *ios;
     destination_t  *next;
+    /* the thread that writes to this stream when
+     * --thread-output=shard */
+    uint32_t        shard;
 };
 
 typedef struct dest_type_st {
@@ -122,6 +147,10 @@ typedef struct dest_type_st {
     int             count;
 } dest_type_t;
 
+/* the order in which one thread runs the checks; see
+ * filterPlanCreate() */
+typedef struct filter_plan_st filter_plan_t;
+
 /* for counting the flows, packets, and bytes */
 typedef struct rec_count_st {
     uint64_t  flows;
@@ -205,6 +234,9 @@ extern int print_volume_stats;
 /* number of total threads */
 extern uint32_t thread_count;
 
+/* how the threads write their output; one of THREAD_OUTPUT_* */
+extern int thread_output;
+
 /* number of checks to preform */
 extern int checker_count;
 
@@ -258,6 +290,12 @@ filterOpenInputData(
     skstream_t        **stream,
     skcontent_t         content_type,
     const char         *filename);
+void
+filterCheckBatch(
+    filter_plan_t      *plan,
+    const rwRec        *rec_array,
+    checktype_t        *result_list,
+    size_t              count);
 
 
 /* application functions (rwfilter.c) */
@@ -285,9 +323,18 @@ int
 filterCheckFile(
     skstream_t         *path,
     const char         *ip_dir);
-checktype_t
-filterCheck(
-    const rwRec        *rwrec);
+filter_plan_t *
+filterPlanCreate(
+    void);
+void
+filterPlanDestroy(
+    filter_plan_t      *plan);
+void
+filterCheckPlanned(
+    filter_plan_t      *plan,
+    const rwRec        *rec_array,
+    checktype_t        *result_list,
+    size_t              count);
 void
 filterUsage(
     FILE*);
@@ -297,6 +344,9 @@ filterGetCheckCount(
 int
 filterGetFGlobFilters(
     void);
+void
+filterAddTupleCheck(
+    void);
 int
 filterSetup(
     void);
@@ -324,6 +374,43 @@ tupleGetCheckCount(
     void);
 
 
+/* query result cache (rwfiltercache.c) */
+
+/* an entry being added to the cache */
+typedef struct filter_cache_entry_st filter_cache_entry_t;
+
+int
+cacheSetup(
+    void);
+void
+cacheTeardown(
+    void);
+void
+cacheUsage(
+    FILE               *fh);
+int
+cacheInitialize(
+    char              **argv);
+skstream_t *
+cacheLookup(
+    const char         *datafile,
+    rec_count_t        *read_count);
+filter_cache_entry_t *
+cacheEntryCreate(
+    const char         *datafile);
+void
+cacheEntryAddRecord(
+    filter_cache_entry_t   *entry,
+    const rwRec            *rec);
+void
+cacheEntryCommit(
+    filter_cache_entry_t   *entry,
+    const rec_count_t      *read_count);
+void
+cacheEntryDestroy(
+    filter_cache_entry_t   *entry);
+
+
 
 /* "main" for filtering when threaded (rwfilterthread.c) */
 
@@ -0,0 +1,1082 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**    rwfiltercache.c
+**
+**    The query result cache lets rwfilter reuse the records that
+**    passed the checks when an input file was processed by an earlier
+**    invocation that used the same partitioning switches.
+**
+**    Each entry in the cache directory is a SiLK Flow file holding
+**    the records of one input file that passed.  The entry's name is
+**    a hash of its key: the input file's real path, size, and
+**    modification time, and a signature of the partitioning switches
+**    and of the files and environment the checks read, such as the
+**    Country Code map.  The cache is not used when a plug-in provides
+**    a check, since what a plug-in reads cannot be known.
+**    The key and the number of records, packets, and bytes that were
+**    read from the input file are stored as an annotation in the
+**    entry's header, so that a collision in the hash is detected and
+**    --print-volume-statistics still reports the totals.  The records
+**    are written to the entry as the file is processed; since the
+**    counts are not known until then, the annotation is written with
+**    fixed-width counts of zero that are overwritten once the file has
+**    been read.
+**
+**    Files modified within the last CACHE_MIN_AGE seconds, such as
+**    the file for the current hour that rwflowpack is still writing,
+**    are always processed and are never stored.
+**
+**    An entry is written to a temporary file and renamed into place,
+**    so processes that share the directory never see a partial
+**    entry.  A hit updates the entry's modification time.  When
+**    rwfilter added entries or was given --cache-size, it removes the
+**    entries with the oldest times once the total size of the entries
+**    exceeds the limit.
+*/
+
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: rwfiltercache.c $");
+
+#include <dirent.h>
+#include <silk/skcountry.h>
+#include <silk/skheader.h>
+#include "rwfilter.h"
+
+
+/* DEFINES AND TYPEDEFS */
+
+/* default limit on the total size of the entries, in bytes */
+#define CACHE_SIZE_DEFAULT  (UINT64_C(1) << 30)
+
+/* files modified within this many seconds are not cached */
+#define CACHE_MIN_AGE  3600
+
+/* temporary files older than this many seconds were left by a
+ * process that died; they are removed when the cache is trimmed */
+#define CACHE_STALE_TEMP_AGE  86400
+
+/* the start of the annotation that holds an entry's key */
+#define CACHE_ANNOTATION  "rwfilter-cache-v1"
+
+/* the counts in the annotation of an entry being written; each count
+ * is later overwritten by CACHE_COUNT_FORMAT, which has the same
+ * width */
+#define CACHE_COUNT_PLACEHOLDER                         \
+    "00000000000000000000 00000000000000000000 00000000000000000000"
+#define CACHE_COUNT_FORMAT                                      \
+    "%020" PRIu64 " %020" PRIu64 " %020" PRIu64
+
+/* the suffix of entries and of temporary files */
+#define CACHE_ENTRY_SUFFIX  ".rwf"
+#define CACHE_TEMP_SUFFIX   ".tmp"
+
+/* the number of hexadecimal digits in the name of an entry */
+#define CACHE_HASH_DIGITS  16
+
+/* the number of items that describe the files and environment that
+ * the checks read but that are not named on the command line */
+#define CACHE_EXTRA_ITEMS  3
+
+/* the identity of an input file and the paths of its entry */
+typedef struct cache_source_st {
+    /* the key: signature, size, mtime, and real path of the file */
+    char            key[PATH_MAX + 64];
+    /* the path to the entry in the cache directory */
+    char            entry_path[PATH_MAX];
+} cache_source_t;
+
+/* an entry that is being created */
+struct filter_cache_entry_st {
+    cache_source_t  source;
+    /* the entry, to which the records that pass are written while the
+     * file is processed */
+    skstream_t     *records;
+    /* the temporary file that holds 'records' */
+    char            temp_path[PATH_MAX + 32];
+    /* whether writing 'records' failed */
+    int             failed;
+};
+
+/* an entry found while trimming the cache */
+typedef struct cache_trim_st {
+    char           *name;
+    time_t          mtime;
+    uint64_t        size;
+} cache_trim_t;
+
+
+/* LOCAL VARIABLES */
+
+/* the cache directory; NULL when the cache is not in use */
+static const char *cache_dir = NULL;
+
+/* the limit on the total size of the entries */
+static uint64_t cache_size_limit = CACHE_SIZE_DEFAULT;
+
+/* whether --cache-size was given */
+static int cache_size_given = 0;
+
+/* whether the cache is used for this invocation */
+static int cache_active = 0;
+
+/* signature of the partitioning switches */
+static uint64_t cache_signature = 0;
+
+/* permission bits to give entries: those of the cache directory */
+static mode_t cache_entry_mode = 0644;
+
+/* number of entries this process has begun; makes the names of the
+ * temporary files unique */
+static uint32_t cache_temp_id = 0;
+
+/* whether a message about failing to write an entry was printed */
+static int cache_warned = 0;
+
+/* number of entries this process added to the cache directory */
+static uint32_t cache_added = 0;
+
+/* protects cache_temp_id, cache_warned, and cache_added */
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* names of the switches that do not change which records pass; the
+ * signature ignores them */
+static const char *cache_ignored_switches[] = {
+    "dry-run", "threads", "thread-output", "print-filenames",
+    "input-pipe", "xargs",
+    "pass-destination", "fail-destination", "all-destination",
+    "print-statistics", "print-volume-statistics",
+    "max-pass-records", "max-fail-records",
+    "note-strip", "note-add", "note-file-add", "compression-method",
+    "cache-directory", "cache-size",
+    NULL    /* sentinel */
+};
+
+/* names of the file selection switches, which the signature ignores
+ * when they select the files instead of filtering the records */
+static const char *cache_fglob_switches[] = {
+    "class", "type", "flowtypes", "sensors", "start-date", "end-date",
+    "print-missing-files", "data-rootdir", "shard", "shard-balance",
+    NULL    /* sentinel */
+};
+
+
+/* OPTIONS SETUP */
+
+typedef enum {
+    OPT_CACHE_DIRECTORY, OPT_CACHE_SIZE
+} cacheOptionsEnum;
+
+static struct option cacheOptions[] = {
+    {"cache-directory",     REQUIRED_ARG, 0, OPT_CACHE_DIRECTORY},
+    {"cache-size",          REQUIRED_ARG, 0, OPT_CACHE_SIZE},
+    {0, 0, 0, 0}            /* sentinel */
+};
+
+static const char *cacheOptionsHelp[] = {
+    ("Reuse the records that passed when unchanged input\n"
+     "\tfiles were processed with the same partitioning switches, keeping\n"
+     "\tthem in this directory. Def. $" RWFILTER_CACHE_DIR_ENVAR
+     " or no cache"),
+    ("Remove the least recently used entries once the\n"
+     "\tentries in the cache directory exceed this size, in bytes;\n"
+     "\tmay use k,m,g,t suffix. Def. 1g"),
+    (char*)NULL
+};
+
+
+/* LOCAL FUNCTION DECLARATIONS */
+
+static int cacheOptionsHandler(clientData cData, int opt_index, char *opt_arg);
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  hash = cacheHash(hash, data, len);
+ *
+ *    Add the 'len' bytes at 'data' to the 64-bit FNV-1a hash 'hash'
+ *    and return the result.
+ */
+static uint64_t
+cacheHash(
+    uint64_t            hash,
+    const void         *data,
+    size_t              len)
+{
+    const uint8_t *cp = (const uint8_t*)data;
+
+    while (len) {
+        hash ^= *cp;
+        hash *= UINT64_C(0x100000001b3);
+        ++cp;
+        --len;
+    }
+    return hash;
+}
+
+#define CACHE_HASH_INIT  UINT64_C(0xcbf29ce484222325)
+
+
+/*
+ *  ok = cacheSetup();
+ *
+ *    Register the options of the cache module.  Return 0 on success,
+ *    or non-zero on error.
+ */
+int
+cacheSetup(
+    void)
+{
+    const char *env;
+
+    /* verify same number of options and help strings */
+    assert((sizeof(cacheOptions)/sizeof(struct option))
+           == (sizeof(cacheOptionsHelp)/sizeof(char*)));
+
+    if (skOptionsRegister(cacheOptions, &cacheOptionsHandler, NULL)) {
+        skAppPrintErr("Unable to register cache options");
+        return 1;
+    }
+
+    /* the environment names the directory unless the switch does */
+    env = getenv(RWFILTER_CACHE_DIR_ENVAR);
+    if (env && env[0]) {
+        cache_dir = env;
+    }
+
+    return 0;
+}
+
+
+/*
+ *  cacheUsage(fh);
+ *
+ *    Print the --help output for the options this module supports to
+ *    the file handle 'fh'.
+ */
+void
+cacheUsage(
+    FILE               *fh)
+{
+    int i;
+
+    for (i = 0; cacheOptions[i].name != NULL; ++i) {
+        fprintf(fh, "--%s %s. %s\n", cacheOptions[i].name,
+                SK_OPTION_HAS_ARG(cacheOptions[i]), cacheOptionsHelp[i]);
+    }
+}
+
+
+/*
+ *  status = cacheOptionsHandler(cData, opt_index, opt_arg);
+ *
+ *    Handle the options of the cache module.  Return 0 on success, or
+ *    non-zero on error.
+ */
+static int
+cacheOptionsHandler(
+    clientData   UNUSED(cData),
+    int                 opt_index,
+    char               *opt_arg)
+{
+    int rv;
+
+    switch ((cacheOptionsEnum)opt_index) {
+      case OPT_CACHE_DIRECTORY:
+        if (!skDirExists(opt_arg)) {
+            skAppPrintErr("Invalid %s '%s': Not a directory",
+                          cacheOptions[opt_index].name, opt_arg);
+            return 1;
+        }
+        cache_dir = opt_arg;
+        break;
+
+      case OPT_CACHE_SIZE:
+        rv = skStringParseHumanUint64(&cache_size_limit, opt_arg,
+                                      SK_HUMAN_NORMAL);
+        if (rv) {
+            skAppPrintErr("Invalid %s '%s': %s",
+                          cacheOptions[opt_index].name, opt_arg,
+                          skStringParseStrerror(rv));
+            return 1;
+        }
+        cache_size_given = 1;
+        break;
+    }
+
+    return 0;
+}
+
+
+/*
+ *  is_member = cacheSwitchInList(name, list);
+ *
+ *    Return 1 if the complete switch name 'name' is in 'list'.
+ *    Return 0 otherwise.
+ */
+static int
+cacheSwitchInList(
+    const char         *name,
+    const char        **list)
+{
+    size_t i;
+
+    for (i = 0; list[i]; ++i) {
+        if (0 == strcmp(name, list[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ *  cmp = cacheCompareStrings(a, b);
+ *
+ *    Callback for qsort() to sort an array of C strings.
+ */
+static int
+cacheCompareStrings(
+    const void         *v_a,
+    const void         *v_b)
+{
+    return strcmp(*(const char**)v_a, *(const char**)v_b);
+}
+
+
+/*
+ *  cacheFileItem(buf, bufsize, label, path);
+ *
+ *    Write "label=realpath:size:mtime" for the file 'path' to the
+ *    character array 'buf' whose length is 'bufsize'.  Write
+ *    "label=path" when 'path' does not exist.
+ */
+static void
+cacheFileItem(
+    char               *buf,
+    size_t              bufsize,
+    const char         *label,
+    const char         *path)
+{
+    char real[PATH_MAX];
+    struct stat st;
+
+    if (stat(path, &st) != 0 || NULL == realpath(path, real)) {
+        snprintf(buf, bufsize, "%s=%s", label, path);
+        return;
+    }
+    snprintf(buf, bufsize, "%s=%s:%" PRId64 ":%" PRId64,
+             label, real, (int64_t)st.st_size, (int64_t)st.st_mtime);
+}
+
+
+/*
+ *  status = cacheComputeSignature(argv);
+ *
+ *    Set 'cache_signature' to a hash of the switches in 'argv' that
+ *    may change which records pass.  Each switch and its argument is
+ *    written as "name=value" using the switch's complete name, so
+ *    abbreviations do not matter; when the value names a file, the size
+ *    and modification time of the file are added.  The strings are
+ *    sorted so the order of the switches does not matter.  The
+ *    identity of the data files the checks read without a switch and,
+ *    in a local-time build, the time zone are also added.  Return 0
+ *    on success, or -1 on error.
+ */
+static int
+cacheComputeSignature(
+    char              **argv)
+{
+    const struct option *opt;
+    struct stat st;
+    char **item;
+    char buf[PATH_MAX + 128];
+    const char *name;
+    const char *value;
+    const char *file;
+    char extra[CACHE_EXTRA_ITEMS][PATH_MAX + 128];
+    char path[PATH_MAX];
+    size_t name_len;
+    int extra_count = 0;
+    int item_count = 0;
+    int fglob_active;
+    int i;
+    int len;
+
+    fglob_active = fglobValid();
+
+    item = (char**)calloc(arg_index + 1, sizeof(char*));
+    if (NULL == item) {
+        skAppPrintOutOfMemory("switch list");
+        return -1;
+    }
+
+    /* skOptionsParse() moved the switches and their arguments to the
+     * front of argv.  A switch may have one or two leading hyphens
+     * and may be abbreviated; an argument that is not joined to its
+     * switch by '=' is the next element of argv */
+    for (i = 1; i < arg_index; ++i) {
+        name = argv[i];
+        value = NULL;
+        opt = NULL;
+        if ('-' == name[0] && '\0' != name[1] && 0 != strcmp(name, "--")) {
+            name += ('-' == name[1]) ? 2 : 1;
+            value = strchr(name, '=');
+            name_len = (value ? (size_t)(value - name) : strlen(name));
+            opt = skOptionsLookupName(name, name_len);
+        }
+        if (NULL == opt) {
+            /* not expected; keep the element so that it still
+             * distinguishes the signature */
+            len = snprintf(buf, sizeof(buf), "%s", argv[i]);
+        } else {
+            if (value) {
+                ++value;
+            } else if (REQUIRED_ARG == opt->has_arg && i + 1 < arg_index) {
+                value = argv[++i];
+            }
+            if (cacheSwitchInList(opt->name, cache_ignored_switches)
+                || (fglob_active
+                    && cacheSwitchInList(opt->name, cache_fglob_switches)))
+            {
+                continue;
+            }
+            len = snprintf(buf, sizeof(buf), "%s=%s",
+                           opt->name, (value ? value : ""));
+        }
+        if (value) {
+            /* for a file, such as an IPset, include its identity.
+             * check "label:path" arguments, such as for --pmap-file,
+             * when the entire value is not a file */
+            file = value;
+            if (stat(file, &st) != 0 && strchr(value, ':')) {
+                file = strchr(value, ':') + 1;
+            }
+            if (stat(file, &st) == 0 && S_ISREG(st.st_mode)
+                && (size_t)len < sizeof(buf))
+            {
+                snprintf(buf + len, sizeof(buf) - len,
+                         ":%" PRId64 ":%" PRId64,
+                         (int64_t)st.st_size, (int64_t)st.st_mtime);
+            }
+        }
+        item[item_count] = strdup(buf);
+        if (NULL == item[item_count]) {
+            skAppPrintOutOfMemory("switch list");
+            goto ERROR;
+        }
+        ++item_count;
+    }
+
+    qsort(item, item_count, sizeof(char*), &cacheCompareStrings);
+
+    /* the checks also read files that the environment or the data
+     * root directory may choose: the site configuration file, which
+     * maps the names of classes, types, and sensors to their IDs,
+     * and the Country Code map.  in a local-time build, the time
+     * switches depend on the time zone */
+    if (sksiteGetConfigPath(path, sizeof(path))) {
+        cacheFileItem(extra[extra_count], sizeof(extra[0]), "silk.conf",
+                      path);
+        ++extra_count;
+    }
+    file = skCountryGetMapPath();
+    if (file) {
+        cacheFileItem(extra[extra_count], sizeof(extra[0]),
+                      "country-codes", file);
+        ++extra_count;
+    }
+#if  SK_ENABLE_LOCALTIME
+    value = getenv("TZ");
+    snprintf(extra[extra_count], sizeof(extra[0]), "TZ=%s",
+             (value ? value : ""));
+    ++extra_count;
+#endif
+    assert(extra_count <= CACHE_EXTRA_ITEMS);
+
+    /* a new release of rwfilter may pass different records */
+    cache_signature = cacheHash(CACHE_HASH_INIT, SK_PACKAGE_VERSION,
+                                sizeof(SK_PACKAGE_VERSION));
+    for (i = 0; i < item_count; ++i) {
+        cache_signature = cacheHash(cache_signature, item[i],
+                                    1 + strlen(item[i]));
+        free(item[i]);
+    }
+    free(item);
+    for (i = 0; i < extra_count; ++i) {
+        cache_signature = cacheHash(cache_signature, extra[i],
+                                    1 + strlen(extra[i]));
+    }
+    return 0;
+
+  ERROR:
+    for (i = 0; i < item_count; ++i) {
+        free(item[i]);
+    }
+    free(item);
+    return -1;
+}
+
+
+/*
+ *  status = cacheInitialize(argv);
+ *
+ *    Decide whether to use the cache once all switches have been
+ *    parsed, and compute the signature of the partitioning switches
+ *    in 'argv'.  The cache is used only when a cache directory was
+ *    given, the output does not depend on the records that fail or
+ *    on the number of records written, and no plug-in provides a
+ *    check.  Return 0 on success, or -1 on error.
+ */
+int
+cacheInitialize(
+    char              **argv)
+{
+    struct stat st;
+
+    if (NULL == cache_dir || dryrun_fp
+        || dest_type[DEST_FAIL].count || dest_type[DEST_ALL].count
+        || dest_type[DEST_PASS].max_records
+        || dest_type[DEST_FAIL].max_records
+        || skPluginFiltersRegistered())
+    {
+        return 0;
+    }
+    if (stat(cache_dir, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        /* the directory from the environment does not exist */
+        return 0;
+    }
+    cache_entry_mode = st.st_mode & 0666;
+
+    if (cacheComputeSignature(argv)) {
+        return -1;
+    }
+    cache_active = 1;
+    return 0;
+}
+
+
+/*
+ *  cmp = cacheCompareTrim(a, b);
+ *
+ *    Callback for qsort() to sort an array of cache_trim_t from the
+ *    least to the most recently used.
+ */
+static int
+cacheCompareTrim(
+    const void         *v_a,
+    const void         *v_b)
+{
+    const cache_trim_t *a = (const cache_trim_t*)v_a;
+    const cache_trim_t *b = (const cache_trim_t*)v_b;
+
+    if (a->mtime < b->mtime) {
+        return -1;
+    }
+    return (a->mtime > b->mtime);
+}
+
+
+/*
+ *  cacheTrim();
+ *
+ *    Remove the least recently used entries from the cache directory
+ *    until the total size of the entries is within the limit, and
+ *    remove temporary files that were abandoned.
+ */
+static void
+cacheTrim(
+    void)
+{
+    char path[PATH_MAX];
+    struct dirent *ent;
+    struct stat st;
+    cache_trim_t *trim = NULL;
+    cache_trim_t *new_trim;
+    size_t trim_count = 0;
+    size_t trim_alloc = 0;
+    uint64_t total = 0;
+    time_t now;
+    size_t len;
+    size_t i;
+    DIR *dir;
+
+    dir = opendir(cache_dir);
+    if (NULL == dir) {
+        return;
+    }
+    now = time(NULL);
+
+    while ((ent = readdir(dir)) != NULL) {
+        len = strlen(ent->d_name);
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, ent->d_name);
+        if (len > strlen(CACHE_TEMP_SUFFIX)
+            && 0 == strcmp(ent->d_name + len - strlen(CACHE_TEMP_SUFFIX),
+                           CACHE_TEMP_SUFFIX))
+        {
+            if (stat(path, &st) == 0
+                && now - st.st_mtime > CACHE_STALE_TEMP_AGE)
+            {
+                unlink(path);
+            }
+            continue;
+        }
+        if (len != CACHE_HASH_DIGITS + strlen(CACHE_ENTRY_SUFFIX)
+            || strspn(ent->d_name, "0123456789abcdef") != CACHE_HASH_DIGITS
+            || 0 != strcmp(ent->d_name + CACHE_HASH_DIGITS,
+                           CACHE_ENTRY_SUFFIX)
+            || stat(path, &st) != 0)
+        {
+            continue;
+        }
+        if (trim_count == trim_alloc) {
+            trim_alloc = (trim_alloc ? 2 * trim_alloc : 256);
+            new_trim = (cache_trim_t*)realloc(trim,
+                                              trim_alloc * sizeof(*trim));
+            if (NULL == new_trim) {
+                goto END;
+            }
+            trim = new_trim;
+        }
+        trim[trim_count].name = strdup(ent->d_name);
+        if (NULL == trim[trim_count].name) {
+            goto END;
+        }
+        trim[trim_count].mtime = st.st_mtime;
+        trim[trim_count].size = (uint64_t)st.st_size;
+        total += trim[trim_count].size;
+        ++trim_count;
+    }
+
+    if (total > cache_size_limit) {
+        qsort(trim, trim_count, sizeof(cache_trim_t), &cacheCompareTrim);
+        for (i = 0; i < trim_count && total > cache_size_limit; ++i) {
+            snprintf(path, sizeof(path), "%s/%s", cache_dir, trim[i].name);
+            /* another process may have removed it */
+            unlink(path);
+            total -= trim[i].size;
+        }
+    }
+
+  END:
+    for (i = 0; i < trim_count; ++i) {
+        free(trim[i].name);
+    }
+    free(trim);
+    closedir(dir);
+}
+
+
+/*
+ *  cacheTeardown();
+ *
+ *    Trim the cache when it was in use and the entries may exceed the
+ *    limit: when this process added entries, or when --cache-size was
+ *    given, since it may be smaller than the limit of the process
+ *    that added the entries.
+ */
+void
+cacheTeardown(
+    void)
+{
+    static int teardownFlag = 0;
+
+    if (teardownFlag) {
+        return;
+    }
+    teardownFlag = 1;
+
+    if (cache_active && (cache_added || cache_size_given)) {
+        cacheTrim();
+    }
+    cache_active = 0;
+}
+
+
+/*
+ *  eligible = cacheGetSource(datafile, source);
+ *
+ *    Fill 'source' with the key and the entry path of the input file
+ *    'datafile'.  Return 1 if the records of the file may be stored
+ *    in or read from the cache, or 0 if the file is not a regular
+ *    file or may still be growing.
+ */
+static int
+cacheGetSource(
+    const char         *datafile,
+    cache_source_t     *source)
+{
+    char path[PATH_MAX];
+    struct stat st;
+    uint64_t hash;
+
+    if (stat(datafile, &st) != 0 || !S_ISREG(st.st_mode)
+        || time(NULL) - st.st_mtime < CACHE_MIN_AGE)
+    {
+        return 0;
+    }
+    if (NULL == realpath(datafile, path)) {
+        return 0;
+    }
+    snprintf(source->key, sizeof(source->key),
+             "%016" PRIx64 " %" PRId64 " %" PRId64 " %s",
+             cache_signature, (int64_t)st.st_size, (int64_t)st.st_mtime,
+             path);
+    hash = cacheHash(CACHE_HASH_INIT, source->key, strlen(source->key));
+    if ((size_t)snprintf(source->entry_path, sizeof(source->entry_path),
+                         "%s/%016" PRIx64 CACHE_ENTRY_SUFFIX,
+                         cache_dir, hash)
+        >= sizeof(source->entry_path))
+    {
+        return 0;
+    }
+    return 1;
+}
+
+
+/*
+ *  stream = cacheLookup(datafile, read_count);
+ *
+ *    Return a stream, positioned at the first record, that holds the
+ *    records of the input file 'datafile' that passed the checks
+ *    when an earlier invocation processed the file with the same
+ *    partitioning switches; set 'read_count' to the number of
+ *    records, packets, and bytes in 'datafile'.  Return NULL when the
+ *    cache is not in use or it does not contain the file.
+ */
+skstream_t *
+cacheLookup(
+    const char         *datafile,
+    rec_count_t        *read_count)
+{
+    cache_source_t source;
+    skstream_t *stream = NULL;
+    sk_header_entry_t *hentry;
+    sk_hentry_iterator_t iter;
+    const char *annotation;
+    int pos;
+
+    if (!cache_active || !cacheGetSource(datafile, &source)) {
+        return NULL;
+    }
+    if (skStreamOpenSilkFlow(&stream, source.entry_path, SK_IO_READ)) {
+        skStreamDestroy(&stream);
+        return NULL;
+    }
+
+    /* verify that the entry is for this file */
+    skHeaderIteratorBindType(&iter, skStreamGetSilkHeader(stream),
+                             SK_HENTRY_ANNOTATION_ID);
+    while ((hentry = skHeaderIteratorNext(&iter)) != NULL) {
+        annotation = ((sk_hentry_annotation_t*)hentry)->annotation;
+        pos = 0;
+        if (3 == sscanf(annotation,
+                        (CACHE_ANNOTATION " %" SCNu64 " %" SCNu64
+                         " %" SCNu64 " %n"),
+                        &read_count->flows, &read_count->pkts,
+                        &read_count->bytes, &pos)
+            && pos > 0
+            && 0 == strcmp(annotation + pos, source.key))
+        {
+            /* mark the entry as recently used */
+            utimes(source.entry_path, NULL);
+            return stream;
+        }
+    }
+
+    skStreamDestroy(&stream);
+    return NULL;
+}
+
+
+/*
+ *  cacheWarn(stream, rv);
+ *
+ *    Print the error 'rv' on 'stream' the first time an entry cannot
+ *    be written.  The records are still processed, so the error is
+ *    not fatal.
+ */
+static void
+cacheWarn(
+    skstream_t         *stream,
+    int                 rv)
+{
+    pthread_mutex_lock(&cache_mutex);
+    if (!cache_warned) {
+        cache_warned = 1;
+        skStreamPrintLastErr(stream, rv, &skAppPrintErr);
+        skAppPrintErr("Unable to add entries to the cache in '%s'",
+                      cache_dir);
+    }
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+
+/*
+ *  entry = cacheEntryCreate(datafile);
+ *
+ *    Begin an entry for the input file 'datafile'.  Pass each record
+ *    of the file that passes the checks to cacheEntryAddRecord(),
+ *    then call cacheEntryCommit() once every record was read, or
+ *    cacheEntryDestroy() otherwise.  Return NULL when the cache is
+ *    not in use or the file may not be cached.
+ */
+filter_cache_entry_t *
+cacheEntryCreate(
+    const char         *datafile)
+{
+    char annotation[PATH_MAX + 192];
+    filter_cache_entry_t *entry;
+    uint32_t id;
+    int rv;
+
+    if (!cache_active) {
+        return NULL;
+    }
+    entry = (filter_cache_entry_t*)calloc(1, sizeof(filter_cache_entry_t));
+    if (NULL == entry) {
+        return NULL;
+    }
+    if (!cacheGetSource(datafile, &entry->source)) {
+        free(entry);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache_mutex);
+    id = cache_temp_id++;
+    pthread_mutex_unlock(&cache_mutex);
+
+    snprintf(entry->temp_path, sizeof(entry->temp_path),
+             "%s.%ld-%" PRIu32 CACHE_TEMP_SUFFIX,
+             entry->source.entry_path, (long)getpid(), id);
+
+    /* the counts are overwritten by cacheEntryCommit() */
+    snprintf(annotation, sizeof(annotation),
+             CACHE_ANNOTATION " " CACHE_COUNT_PLACEHOLDER " %s",
+             entry->source.key);
+    if ((rv = skStreamCreate(&entry->records, SK_IO_WRITE,
+                             SK_CONTENT_SILK_FLOW))
+        || (rv = skStreamBind(entry->records, entry->temp_path))
+        || (rv = skHeaderAddAnnotation(skStreamGetSilkHeader(entry->records),
+                                       annotation))
+        || (rv = skStreamOpen(entry->records))
+        || (rv = skStreamWriteSilkHeader(entry->records)))
+    {
+        cacheWarn(entry->records, rv);
+        cacheEntryDestroy(entry);
+        return NULL;
+    }
+
+    return entry;
+}
+
+
+/*
+ *  cacheEntryAddRecord(entry, rec);
+ *
+ *    Add the record 'rec', which passed the checks, to 'entry'.
+ */
+void
+cacheEntryAddRecord(
+    filter_cache_entry_t   *entry,
+    const rwRec            *rec)
+{
+    int rv;
+
+    if (!entry->failed) {
+        rv = skStreamWriteRecord(entry->records, rec);
+        if (rv) {
+            cacheWarn(entry->records, rv);
+            entry->failed = 1;
+        }
+    }
+}
+
+
+/*
+ *  status = cacheEntryWriteCounts(entry, read_count);
+ *
+ *    Overwrite the counts of zero in the annotation in the header of
+ *    the closed entry 'entry' with the number of records, packets,
+ *    and bytes in 'read_count'.  Return 0 on success, or -1 on error.
+ */
+static int
+cacheEntryWriteCounts(
+    filter_cache_entry_t   *entry,
+    const rec_count_t      *read_count)
+{
+    const char placeholder[] = CACHE_ANNOTATION " " CACHE_COUNT_PLACEHOLDER;
+    char counts[sizeof(CACHE_COUNT_PLACEHOLDER)];
+    char *header;
+    size_t header_len;
+    size_t i;
+    off_t offset = -1;
+    int fd;
+    int rv = -1;
+
+    header_len = skHeaderGetLength(skStreamGetSilkHeader(entry->records));
+    header = (char*)malloc(header_len);
+    if (NULL == header) {
+        return -1;
+    }
+    fd = open(entry->temp_path, O_RDWR);
+    if (-1 == fd) {
+        free(header);
+        return -1;
+    }
+
+    /* the header is never compressed; find the annotation in it */
+    if (skreadn(fd, header, header_len) == (ssize_t)header_len) {
+        for (i = 0; i + sizeof(placeholder) <= header_len; ++i) {
+            if (0 == memcmp(header + i, placeholder, sizeof(placeholder)-1)) {
+                offset = (off_t)(i + strlen(CACHE_ANNOTATION " "));
+                break;
+            }
+        }
+    }
+    if (offset != -1) {
+        snprintf(counts, sizeof(counts), CACHE_COUNT_FORMAT,
+                 read_count->flows, read_count->pkts, read_count->bytes);
+        if (strlen(counts) == sizeof(counts) - 1
+            && lseek(fd, offset, SEEK_SET) == offset
+            && (skwriten(fd, counts, sizeof(counts) - 1)
+                == (ssize_t)(sizeof(counts) - 1)))
+        {
+            rv = 0;
+        }
+    }
+    if (close(fd) != 0) {
+        rv = -1;
+    }
+    free(header);
+    return rv;
+}
+
+
+/*
+ *  cacheEntryCommit(entry, read_count);
+ *
+ *    Complete 'entry' once every record of its input file was read,
+ *    where 'read_count' is the number of records, packets, and bytes
+ *    in the file, and move it into the cache directory.  Destroy
+ *    'entry'.
+ */
+void
+cacheEntryCommit(
+    filter_cache_entry_t   *entry,
+    const rec_count_t      *read_count)
+{
+    int rv;
+
+    if (entry->failed) {
+        goto END;
+    }
+    rv = skStreamClose(entry->records);
+    if (rv) {
+        cacheWarn(entry->records, rv);
+        goto END;
+    }
+
+    /* fill in the counts, share the entry with the users who may
+     * write the directory, then replace any existing entry */
+    if (0 == cacheEntryWriteCounts(entry, read_count)) {
+        chmod(entry->temp_path, cache_entry_mode);
+        if (0 == rename(entry->temp_path, entry->source.entry_path)) {
+            pthread_mutex_lock(&cache_mutex);
+            ++cache_added;
+            pthread_mutex_unlock(&cache_mutex);
+            goto END;
+        }
+    }
+    pthread_mutex_lock(&cache_mutex);
+    if (!cache_warned) {
+        cache_warned = 1;
+        skAppPrintSyserror("Unable to add entries to the cache in '%s'",
+                           cache_dir);
+    }
+    pthread_mutex_unlock(&cache_mutex);
+
+  END:
+    cacheEntryDestroy(entry);
+}
+
+
+/*
+ *  cacheEntryDestroy(entry);
+ *
+ *    Discard 'entry', removing its temporary file if it was not moved
+ *    into the cache directory, and free it.
+ */
+void
+cacheEntryDestroy(
+    filter_cache_entry_t   *entry)
+{
+    if (NULL == entry) {
+        return;
+    }
+    skStreamDestroy(&entry->records);
+    unlink(entry->temp_path);
+    free(entry);
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -94,6 +94,18 @@ RCSIDENT("$SiLK: rwfiltercheck.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 /* number of filter checks.  Approx equal to number of options */
 #define FILTER_CHECK_MAX 64
 
+/* number of batches of records on which every check is run and timed
+ * each time a check plan is adapted */
+#define FILTER_PLAN_SAMPLE_BATCHES  16
+
+/* number of batches of records between the starts of the samples
+ * that adapt a check plan */
+#define FILTER_PLAN_PERIOD_BATCHES  4096
+
+/* environment variable that, when non-empty, causes the order of the
+ * checks to be printed each time a check plan is adapted */
+#define FILTER_PLAN_DEBUG_ENVAR  "SILK_RWFILTER_PLAN_DEBUG"
+
 /* number of IP Wildcards, IPsets, lists of CIDR blocks */
 #define IP_INDEX_COUNT     4
 
@@ -218,6 +230,37 @@ typedef struct filter_checks_st {
 
 } filter_checks_t;
 
+/*
+ *    A check plan holds the order in which one thread runs the checks
+ *    in checkSet[].  Since a record must pass every check, the order
+ *    does not change the result, only the time needed to reach it.
+ *
+ *    For the first FILTER_PLAN_SAMPLE_BATCHES batches of every
+ *    FILTER_PLAN_PERIOD_BATCHES batches, every check is run on every
+ *    record, and the number of records each check passes and the time
+ *    each check takes are measured.  The checks are then ordered so
+ *    that those which reject the most records for the least time run
+ *    first.
+ */
+struct filter_plan_st {
+    /* the order in which to run the checks; each value is a position
+     * in checkSet[] */
+    uint8_t     order[FILTER_CHECK_MAX];
+    /* the number of records that passed each check and the number of
+     * microseconds spent in each check while sampling, indexed by
+     * position in checkSet[] */
+    uint64_t    passed[FILTER_CHECK_MAX];
+    uint64_t    usec[FILTER_CHECK_MAX];
+    /* the number of records tested while sampling */
+    uint64_t    tested;
+    /* the number of records checked using this plan */
+    uint64_t    records;
+    /* the number of batches checked since sampling last began */
+    uint32_t    batches;
+    /* whether to print the order each time it is adapted */
+    int         debug;
+};
+
 
 
 /* LOCAL VARIABLES */
@@ -268,6 +311,9 @@ enum {
     OPT_SCC, OPT_DCC, OPT_ANY_CC,
 
     OPT_SENSORS, OPT_FLOW_TYPE,
+
+    /* the --tuple-file check, which rwfiltertuple.c implements */
+    OPT_TUPLE,
     _OPT_FINAL_OPTION_ /* must be last */
 };
 
@@ -1060,18 +1106,19 @@ compatOptionsHandler(
 
 
 /*
- *  pass = filterCheck(&rwrec)
+ *  pass = filterCheckOne(&rwrec, check_key);
  *
- *    Check the rw record 'rwrec' against all of the checks the user
- *    specified.  If the record fails any check, RWF_PASS is returned.
- *    If the record passes all of the checks, RWF_FAIL is returned.
+ *    Check the rw record 'rwrec' against the check 'check_key', a
+ *    value from checkSet[].  If the record fails the check, RWF_FAIL
+ *    is returned.  If the record passes the check, RWF_PASS is
+ *    returned.
  */
-checktype_t
-filterCheck(
-    const rwRec        *rwrec)
+static inline checktype_t
+filterCheckOne(
+    const rwRec        *rwrec,
+    unsigned int        check_key)
 {
     unsigned int i;
-    int j;
     int wanted;
     skipaddr_t ip1;
     skipaddr_t ip2;
@@ -1083,375 +1130,831 @@ filterCheck(
     if (test) {/*pass*/} else return RWF_FAIL
 
 
-    for (j = 0; j < checks->check_count; j++) {
-        switch (checks->checkSet[j]) {
+    switch (check_key) {
 
-          case OPT_STIME:
-            FILTER_CHECK(CHECK_RANGE((uint64_t)rwRecGetStartTime(rwrec),
-                                     checks->sTime));
-            break;
+      case OPT_STIME:
+        FILTER_CHECK(CHECK_RANGE((uint64_t)rwRecGetStartTime(rwrec),
+                                 checks->sTime));
+        break;
 
-          case OPT_ETIME:
-            FILTER_CHECK(CHECK_RANGE((uint64_t)rwRecGetEndTime(rwrec),
-                                     checks->eTime));
-            break;
+      case OPT_ETIME:
+        FILTER_CHECK(CHECK_RANGE((uint64_t)rwRecGetEndTime(rwrec),
+                                 checks->eTime));
+        break;
 
-          case OPT_ACTIVE_TIME:
-            /* to pass the record; check that flow's start time is
-             * less than the max value of range and that flow's end
-             * time is greater than the min value of the range. */
-            FILTER_CHECK((uint64_t)rwRecGetStartTime(rwrec)
-                         <= checks->active_time.max);
-            FILTER_CHECK((uint64_t)rwRecGetEndTime(rwrec)
-                         >= checks->active_time.min);
-            break;
+      case OPT_ACTIVE_TIME:
+        /* to pass the record; check that flow's start time is
+         * less than the max value of range and that flow's end
+         * time is greater than the min value of the range. */
+        FILTER_CHECK((uint64_t)rwRecGetStartTime(rwrec)
+                     <= checks->active_time.max);
+        FILTER_CHECK((uint64_t)rwRecGetEndTime(rwrec)
+                     >= checks->active_time.min);
+        break;
 
-          case OPT_DURATION:
-            FILTER_CHECK(CHECK_RANGE(rwRecGetElapsed(rwrec),
-                                     checks->elapsed));
-            break;
+      case OPT_DURATION:
+        FILTER_CHECK(CHECK_RANGE(rwRecGetElapsed(rwrec),
+                                 checks->elapsed));
+        break;
 
-          case OPT_SPORT:
-            FILTER_CHECK(skBitmapGetBit(checks->sPort, rwRecGetSPort(rwrec)));
-            break;
+      case OPT_SPORT:
+        FILTER_CHECK(skBitmapGetBit(checks->sPort, rwRecGetSPort(rwrec)));
+        break;
 
-          case OPT_DPORT:
-            FILTER_CHECK(skBitmapGetBit(checks->dPort, rwRecGetDPort(rwrec)));
-            break;
+      case OPT_DPORT:
+        FILTER_CHECK(skBitmapGetBit(checks->dPort, rwRecGetDPort(rwrec)));
+        break;
 
-          case OPT_APORT:
-            FILTER_CHECK(skBitmapGetBit(checks->any_port, rwRecGetSPort(rwrec))
-                         || skBitmapGetBit(checks->any_port,
-                                           rwRecGetDPort(rwrec)));
-            break;
+      case OPT_APORT:
+        FILTER_CHECK(skBitmapGetBit(checks->any_port, rwRecGetSPort(rwrec))
+                     || skBitmapGetBit(checks->any_port,
+                                       rwRecGetDPort(rwrec)));
+        break;
 
-          case OPT_PROTOCOL:
-            FILTER_CHECK(skBitmapGetBit(checks->proto, rwRecGetProto(rwrec)));
-            break;
+      case OPT_PROTOCOL:
+        FILTER_CHECK(skBitmapGetBit(checks->proto, rwRecGetProto(rwrec)));
+        break;
 
-          case OPT_ICMP_TYPE:
-            FILTER_CHECK(rwRecIsICMP(rwrec)
-                         && skBitmapGetBit(checks->icmp_type,
-                                           rwRecGetIcmpType(rwrec)));
-            break;
+      case OPT_ICMP_TYPE:
+        FILTER_CHECK(rwRecIsICMP(rwrec)
+                     && skBitmapGetBit(checks->icmp_type,
+                                       rwRecGetIcmpType(rwrec)));
+        break;
 
-          case OPT_ICMP_CODE:
-            FILTER_CHECK(rwRecIsICMP(rwrec)
-                         && skBitmapGetBit(checks->icmp_code,
-                                           rwRecGetIcmpCode(rwrec)));
-            break;
+      case OPT_ICMP_CODE:
+        FILTER_CHECK(rwRecIsICMP(rwrec)
+                     && skBitmapGetBit(checks->icmp_code,
+                                       rwRecGetIcmpCode(rwrec)));
+        break;
 
-          case OPT_BYTES:
-            FILTER_CHECK(CHECK_RANGE(rwRecGetBytes(rwrec), checks->bytes));
-            break;
+      case OPT_BYTES:
+        FILTER_CHECK(CHECK_RANGE(rwRecGetBytes(rwrec), checks->bytes));
+        break;
 
-          case OPT_PACKETS:
-            FILTER_CHECK(CHECK_RANGE(rwRecGetPkts(rwrec), checks->pkts));
-            break;
+      case OPT_PACKETS:
+        FILTER_CHECK(CHECK_RANGE(rwRecGetPkts(rwrec), checks->pkts));
+        break;
 
-          case OPT_BYTES_PER_PACKET:
-            FILTER_CHECK(CHECK_RANGE(((double)rwRecGetBytes(rwrec)
-                                      / (double)rwRecGetPkts(rwrec)),
-                                     checks->bytes_per_packet));
-            break;
+      case OPT_BYTES_PER_PACKET:
+        FILTER_CHECK(CHECK_RANGE(((double)rwRecGetBytes(rwrec)
+                                  / (double)rwRecGetPkts(rwrec)),
+                                 checks->bytes_per_packet));
+        break;
 
 #if RATE_FILTERS
-          case OPT_BYTES_PER_SECOND:
-            if (rwRecGetElapsed(rwrec) > 0) {
-                FILTER_CHECK(CHECK_RANGE(((double)rwRecGetBytes(rwrec)
-                                          / (double)rwRecGetElapsed(rwrec)),
-                                         checks->bytes_per_second));
-            } else {
-                /* use a one second duration */
-                FILTER_CHECK(CHECK_RANGE((double)rwRecGetBytes(rwrec),
-                                         checks->bytes_per_second));
-            }
-            break;
+      case OPT_BYTES_PER_SECOND:
+        if (rwRecGetElapsed(rwrec) > 0) {
+            FILTER_CHECK(CHECK_RANGE(((double)rwRecGetBytes(rwrec)
+                                      / (double)rwRecGetElapsed(rwrec)),
+                                     checks->bytes_per_second));
+        } else {
+            /* use a one second duration */
+            FILTER_CHECK(CHECK_RANGE((double)rwRecGetBytes(rwrec),
+                                     checks->bytes_per_second));
+        }
+        break;
 
-          case OPT_PACKETS_PER_SECOND:
-            if (rwRecGetElapsed(rwrec) > 0) {
-                FILTER_CHECK(CHECK_RANGE(((double)rwRecGetPkts(rwrec)
-                                          / (double)rwRecGetElapsed(rwrec)),
-                                         checks->packets_per_second));
-            } else {
-                /* use a one second duration */
-                FILTER_CHECK(CHECK_RANGE((double)rwRecGetPkts(rwrec),
-                                         checks->packets_per_second));
-            }
-            break;
+      case OPT_PACKETS_PER_SECOND:
+        if (rwRecGetElapsed(rwrec) > 0) {
+            FILTER_CHECK(CHECK_RANGE(((double)rwRecGetPkts(rwrec)
+                                      / (double)rwRecGetElapsed(rwrec)),
+                                     checks->packets_per_second));
+        } else {
+            /* use a one second duration */
+            FILTER_CHECK(CHECK_RANGE((double)rwRecGetPkts(rwrec),
+                                     checks->packets_per_second));
+        }
+        break;
 #endif  /* RATE_FILTERS */
 
-          case OPT_NOT_SCIDR:
-          case OPT_SCIDR:
-            rwRecMemGetSIP(rwrec, &ip1);
-            wanted = checks->cidr_negated[SRC];
-            for (i = 0, cidr = checks->cidr_list[SRC];
-                 i < checks->cidr_list_len[SRC];
-                 ++i, ++cidr)
-            {
-                if (skcidrCheckIP(cidr, &ip1)) {
-                    wanted = !wanted;
-                    break;
-                }
+      case OPT_NOT_SCIDR:
+      case OPT_SCIDR:
+        rwRecMemGetSIP(rwrec, &ip1);
+        wanted = checks->cidr_negated[SRC];
+        for (i = 0, cidr = checks->cidr_list[SRC];
+             i < checks->cidr_list_len[SRC];
+             ++i, ++cidr)
+        {
+            if (skcidrCheckIP(cidr, &ip1)) {
+                wanted = !wanted;
+                break;
             }
-            FILTER_CHECK(wanted);
-            break;
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_NOT_DCIDR:
-          case OPT_DCIDR:
-            rwRecMemGetDIP(rwrec, &ip1);
-            wanted = checks->cidr_negated[DST];
-            for (i = 0, cidr = checks->cidr_list[DST];
-                 i < checks->cidr_list_len[DST];
-                 ++i, ++cidr)
-            {
-                if (skcidrCheckIP(cidr, &ip1)) {
-                    wanted = !wanted;
-                    break;
-                }
+      case OPT_NOT_DCIDR:
+      case OPT_DCIDR:
+        rwRecMemGetDIP(rwrec, &ip1);
+        wanted = checks->cidr_negated[DST];
+        for (i = 0, cidr = checks->cidr_list[DST];
+             i < checks->cidr_list_len[DST];
+             ++i, ++cidr)
+        {
+            if (skcidrCheckIP(cidr, &ip1)) {
+                wanted = !wanted;
+                break;
             }
-            FILTER_CHECK(wanted);
-            break;
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_NOT_NHCIDR:
-          case OPT_NHCIDR:
-            rwRecMemGetNhIP(rwrec, &ip1);
-            wanted = checks->cidr_negated[NHIP];
-            for (i = 0, cidr = checks->cidr_list[NHIP];
-                 i < checks->cidr_list_len[NHIP];
-                 ++i, ++cidr)
-            {
-                if (skcidrCheckIP(cidr, &ip1)) {
-                    wanted = !wanted;
-                    break;
-                }
+      case OPT_NOT_NHCIDR:
+      case OPT_NHCIDR:
+        rwRecMemGetNhIP(rwrec, &ip1);
+        wanted = checks->cidr_negated[NHIP];
+        for (i = 0, cidr = checks->cidr_list[NHIP];
+             i < checks->cidr_list_len[NHIP];
+             ++i, ++cidr)
+        {
+            if (skcidrCheckIP(cidr, &ip1)) {
+                wanted = !wanted;
+                break;
             }
-            FILTER_CHECK(wanted);
-            break;
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_NOT_ANY_CIDR:
-          case OPT_ANY_CIDR:
-            rwRecMemGetSIP(rwrec, &ip1);
-            rwRecMemGetDIP(rwrec, &ip2);
-            wanted = checks->cidr_negated[ANY];
-            for (i = 0, cidr = checks->cidr_list[ANY];
-                 i < checks->cidr_list_len[ANY];
-                 ++i, ++cidr)
+      case OPT_NOT_ANY_CIDR:
+      case OPT_ANY_CIDR:
+        rwRecMemGetSIP(rwrec, &ip1);
+        rwRecMemGetDIP(rwrec, &ip2);
+        wanted = checks->cidr_negated[ANY];
+        for (i = 0, cidr = checks->cidr_list[ANY];
+             i < checks->cidr_list_len[ANY];
+             ++i, ++cidr)
+        {
+            if (skcidrCheckIP(cidr, &ip1)
+                || skcidrCheckIP(cidr, &ip2))
             {
-                if (skcidrCheckIP(cidr, &ip1)
-                    || skcidrCheckIP(cidr, &ip2))
-                {
-                    wanted = !wanted;
-                    break;
-                }
+                wanted = !wanted;
+                break;
             }
-            FILTER_CHECK(wanted);
-            break;
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_NOT_SADDRESS:
-          case OPT_SADDRESS:
-            /* Check if record's sIP matches the bitmap.  The record
-             * FAILS the filter when the result of the check MATCHES
-             * the status of the negate flag.  E.g., the record
-             * matches the address-bitmap (skIPWildcardCheckIp()==1)
-             * and the user entered --not-saddr (ipwild_negate==1).
-             * Since the record FAILS when the values are equal, it
-             * will PASS when they are not-equal; i.e., when the
-             * XOR(^) of the two values is true.
-             */
-            rwRecMemGetSIP(rwrec, &ip1);
-            FILTER_CHECK(skIPWildcardCheckIp(&checks->ipwild[SRC], &ip1)
-                         ^ checks->ipwild_negate[SRC]);
-            break;
+      case OPT_NOT_SADDRESS:
+      case OPT_SADDRESS:
+        /* Check if record's sIP matches the bitmap.  The record
+         * FAILS the filter when the result of the check MATCHES
+         * the status of the negate flag.  E.g., the record
+         * matches the address-bitmap (skIPWildcardCheckIp()==1)
+         * and the user entered --not-saddr (ipwild_negate==1).
+         * Since the record FAILS when the values are equal, it
+         * will PASS when they are not-equal; i.e., when the
+         * XOR(^) of the two values is true.
+         */
+        rwRecMemGetSIP(rwrec, &ip1);
+        FILTER_CHECK(skIPWildcardCheckIp(&checks->ipwild[SRC], &ip1)
+                     ^ checks->ipwild_negate[SRC]);
+        break;
 
-          case OPT_NOT_DADDRESS:
-          case OPT_DADDRESS:
-            rwRecMemGetDIP(rwrec, &ip1);
-            FILTER_CHECK(skIPWildcardCheckIp(&checks->ipwild[DST], &ip1)
-                         ^ checks->ipwild_negate[DST]);
-            break;
+      case OPT_NOT_DADDRESS:
+      case OPT_DADDRESS:
+        rwRecMemGetDIP(rwrec, &ip1);
+        FILTER_CHECK(skIPWildcardCheckIp(&checks->ipwild[DST], &ip1)
+                     ^ checks->ipwild_negate[DST]);
+        break;
 
-          case OPT_NOT_NEXT_HOP_ID:
-          case OPT_NEXT_HOP_ID:
-            rwRecMemGetNhIP(rwrec, &ip1);
-            FILTER_CHECK(skIPWildcardCheckIp(&checks->ipwild[NHIP], &ip1)
-                         ^ checks->ipwild_negate[NHIP]);
-            break;
+      case OPT_NOT_NEXT_HOP_ID:
+      case OPT_NEXT_HOP_ID:
+        rwRecMemGetNhIP(rwrec, &ip1);
+        FILTER_CHECK(skIPWildcardCheckIp(&checks->ipwild[NHIP], &ip1)
+                     ^ checks->ipwild_negate[NHIP]);
+        break;
 
-          case OPT_NOT_ANY_ADDRESS:
-          case OPT_ANY_ADDRESS:
-            rwRecMemGetSIP(rwrec, &ip1);
-            rwRecMemGetDIP(rwrec, &ip2);
-            FILTER_CHECK((skIPWildcardCheckIp(&checks->ipwild[ANY], &ip1)
-                          | skIPWildcardCheckIp(&checks->ipwild[ANY], &ip2))
-                         ^ checks->ipwild_negate[ANY]);
-            break;
+      case OPT_NOT_ANY_ADDRESS:
+      case OPT_ANY_ADDRESS:
+        rwRecMemGetSIP(rwrec, &ip1);
+        rwRecMemGetDIP(rwrec, &ip2);
+        FILTER_CHECK((skIPWildcardCheckIp(&checks->ipwild[ANY], &ip1)
+                      | skIPWildcardCheckIp(&checks->ipwild[ANY], &ip2))
+                     ^ checks->ipwild_negate[ANY]);
+        break;
 
-          case OPT_NOT_SET_SIP:
-          case OPT_SET_SIP:
-            /* As with OPT_SADDRESS, for the record to pass the
-             * filter, the result of the check must not equal the
-             * result of the negate flag. */
-            FILTER_CHECK(skIPSetCheckRecordSIP(checks->ipset[SRC], rwrec)
-                         ^ checks->ipset_reject[SRC]);
-            break;
+      case OPT_NOT_SET_SIP:
+      case OPT_SET_SIP:
+        /* As with OPT_SADDRESS, for the record to pass the
+         * filter, the result of the check must not equal the
+         * result of the negate flag. */
+        FILTER_CHECK(skIPSetCheckRecordSIP(checks->ipset[SRC], rwrec)
+                     ^ checks->ipset_reject[SRC]);
+        break;
 
-          case OPT_NOT_SET_DIP:
-          case OPT_SET_DIP:
-            FILTER_CHECK(skIPSetCheckRecordDIP(checks->ipset[DST], rwrec)
-                         ^ checks->ipset_reject[DST]);
-            break;
+      case OPT_NOT_SET_DIP:
+      case OPT_SET_DIP:
+        FILTER_CHECK(skIPSetCheckRecordDIP(checks->ipset[DST], rwrec)
+                     ^ checks->ipset_reject[DST]);
+        break;
 
-          case OPT_NOT_SET_NHIP:
-          case OPT_SET_NHIP:
-            FILTER_CHECK(skIPSetCheckRecordNhIP(checks->ipset[NHIP], rwrec)
-                         ^ checks->ipset_reject[NHIP]);
-            break;
+      case OPT_NOT_SET_NHIP:
+      case OPT_SET_NHIP:
+        FILTER_CHECK(skIPSetCheckRecordNhIP(checks->ipset[NHIP], rwrec)
+                     ^ checks->ipset_reject[NHIP]);
+        break;
 
-          case OPT_NOT_SET_ANY:
-          case OPT_SET_ANY:
-            FILTER_CHECK((skIPSetCheckRecordSIP(checks->ipset[ANY], rwrec)
-                          | skIPSetCheckRecordDIP(checks->ipset[ANY], rwrec))
-                         ^ checks->ipset_reject[ANY]);
-            break;
+      case OPT_NOT_SET_ANY:
+      case OPT_SET_ANY:
+        FILTER_CHECK((skIPSetCheckRecordSIP(checks->ipset[ANY], rwrec)
+                      | skIPSetCheckRecordDIP(checks->ipset[ANY], rwrec))
+                     ^ checks->ipset_reject[ANY]);
+        break;
 
-          case OPT_INPUT_INDEX:
-            FILTER_CHECK(skBitmapGetBit(checks->input_index,
-                                        rwRecGetInput(rwrec)));
-            break;
+      case OPT_INPUT_INDEX:
+        FILTER_CHECK(skBitmapGetBit(checks->input_index,
+                                    rwRecGetInput(rwrec)));
+        break;
 
-          case OPT_OUTPUT_INDEX:
-            FILTER_CHECK(skBitmapGetBit(checks->output_index,
-                                        rwRecGetOutput(rwrec)));
-            break;
+      case OPT_OUTPUT_INDEX:
+        FILTER_CHECK(skBitmapGetBit(checks->output_index,
+                                    rwRecGetOutput(rwrec)));
+        break;
 
-          case OPT_ANY_INDEX:
-            FILTER_CHECK(skBitmapGetBit(checks->any_index,rwRecGetInput(rwrec))
-                         || skBitmapGetBit(checks->any_index,
-                                           rwRecGetOutput(rwrec)));
-            break;
+      case OPT_ANY_INDEX:
+        FILTER_CHECK(skBitmapGetBit(checks->any_index,rwRecGetInput(rwrec))
+                     || skBitmapGetBit(checks->any_index,
+                                       rwRecGetOutput(rwrec)));
+        break;
 
-            /*
-             * TCP check.  Passes if there's an intersection between
-             * the raised flags and the filter flags.
-             */
-          case OPT_TCP_FLAGS:
-            FILTER_CHECK(checks->flags & rwRecGetFlags(rwrec));
-            break;
+        /*
+         * TCP check.  Passes if there's an intersection between
+         * the raised flags and the filter flags.
+         */
+      case OPT_TCP_FLAGS:
+        FILTER_CHECK(checks->flags & rwRecGetFlags(rwrec));
+        break;
 
-          case OPT_FLAGS_ALL:
-            wanted = 0;
-            for (i = 0; i < checks->count_flags_all; ++i) {
-                if (CHECK_TCP_HIGH_MASK(rwRecGetFlags(rwrec),
-                                        checks->flags_all[i]))
-                {
-                    wanted = 1;
-                    break; /* wanted */
-                }
+      case OPT_FLAGS_ALL:
+        wanted = 0;
+        for (i = 0; i < checks->count_flags_all; ++i) {
+            if (CHECK_TCP_HIGH_MASK(rwRecGetFlags(rwrec),
+                                    checks->flags_all[i]))
+            {
+                wanted = 1;
+                break; /* wanted */
             }
-            FILTER_CHECK(wanted);
-            break;
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_FLAGS_INITIAL:
-            wanted = 0;
-            for (i = 0; i < checks->count_flags_init; ++i) {
-                if (CHECK_TCP_HIGH_MASK(rwRecGetInitFlags(rwrec),
-                                        checks->flags_init[i]))
-                {
-                    wanted = 1;
-                    break; /* wanted */
-                }
+      case OPT_FLAGS_INITIAL:
+        wanted = 0;
+        for (i = 0; i < checks->count_flags_init; ++i) {
+            if (CHECK_TCP_HIGH_MASK(rwRecGetInitFlags(rwrec),
+                                    checks->flags_init[i]))
+            {
+                wanted = 1;
+                break; /* wanted */
             }
-            FILTER_CHECK(wanted);
-            break;
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_FLAGS_SESSION:
-            wanted = 0;
-            for (i = 0; i < checks->count_flags_session; ++i) {
-                if (CHECK_TCP_HIGH_MASK(rwRecGetRestFlags(rwrec),
-                                        checks->flags_session[i]))
-                {
-                    wanted = 1;
-                    break;
-                }
+      case OPT_FLAGS_SESSION:
+        wanted = 0;
+        for (i = 0; i < checks->count_flags_session; ++i) {
+            if (CHECK_TCP_HIGH_MASK(rwRecGetRestFlags(rwrec),
+                                    checks->flags_session[i]))
+            {
+                wanted = 1;
+                break;
             }
-            FILTER_CHECK(wanted);
-            break;
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_ATTRIBUTES:
-            wanted = 0;
-            for (i = 0; i < checks->count_attributes; ++i) {
-                if (CHECK_TCP_HIGH_MASK(rwRecGetTcpState(rwrec),
-                                        checks->attributes[i]))
-                {
-                    wanted = 1;
-                    break;
-                }
+      case OPT_ATTRIBUTES:
+        wanted = 0;
+        for (i = 0; i < checks->count_attributes; ++i) {
+            if (CHECK_TCP_HIGH_MASK(rwRecGetTcpState(rwrec),
+                                    checks->attributes[i]))
+            {
+                wanted = 1;
+                break;
             }
-            FILTER_CHECK(wanted);
-            break;
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_APPLICATION:
-            FILTER_CHECK(skBitmapGetBit(checks->application,
-                                        rwRecGetApplication(rwrec)));
-            break;
+      case OPT_APPLICATION:
+        FILTER_CHECK(skBitmapGetBit(checks->application,
+                                    rwRecGetApplication(rwrec)));
+        break;
 
-          case OPT_IP_VERSION:
-            switch (checks->ipv6_policy) {
-              case SK_IPV6POLICY_MIX:
-                break;
-              case SK_IPV6POLICY_ONLY:
-                FILTER_CHECK(rwRecIsIPv6(rwrec));
-                break;
-              case SK_IPV6POLICY_IGNORE:
-                FILTER_CHECK(!rwRecIsIPv6(rwrec));
-                break;
-              case SK_IPV6POLICY_ASV4:
-              case SK_IPV6POLICY_FORCE:
-                /* can't happen */
-                skAbortBadCase(checks->ipv6_policy);
-            }
+      case OPT_IP_VERSION:
+        switch (checks->ipv6_policy) {
+          case SK_IPV6POLICY_MIX:
             break;
-
-          case OPT_SENSORS:
-            FILTER_CHECK(skBitmapGetBit(checks->sID, rwRecGetSensor(rwrec)));
+          case SK_IPV6POLICY_ONLY:
+            FILTER_CHECK(rwRecIsIPv6(rwrec));
             break;
-
-          case OPT_FLOW_TYPE:
-            FILTER_CHECK(skBitmapGetBit(checks->flow_type,
-                                        rwRecGetFlowType(rwrec)));
+          case SK_IPV6POLICY_IGNORE:
+            FILTER_CHECK(!rwRecIsIPv6(rwrec));
             break;
+          case SK_IPV6POLICY_ASV4:
+          case SK_IPV6POLICY_FORCE:
+            /* can't happen */
+            skAbortBadCase(checks->ipv6_policy);
+        }
+        break;
 
-          case OPT_SCC:
-            rwRecMemGetSIP(rwrec, &ip1);
-            FILTER_CHECK(skBitmapGetBit(checks->scc,
-                                        skCountryLookupCode(&ip1)));
-            break;
+      case OPT_SENSORS:
+        FILTER_CHECK(skBitmapGetBit(checks->sID, rwRecGetSensor(rwrec)));
+        break;
 
-          case OPT_DCC:
-            rwRecMemGetDIP(rwrec, &ip1);
-            FILTER_CHECK(skBitmapGetBit(checks->dcc,
-                                        skCountryLookupCode(&ip1)));
-            break;
+      case OPT_FLOW_TYPE:
+        FILTER_CHECK(skBitmapGetBit(checks->flow_type,
+                                    rwRecGetFlowType(rwrec)));
+        break;
 
-          case OPT_ANY_CC:
-            rwRecMemGetSIP(rwrec, &ip1);
-            rwRecMemGetDIP(rwrec, &ip2);
-            FILTER_CHECK(skBitmapGetBit(checks->any_cc,
-                                        skCountryLookupCode(&ip1))
-                         || skBitmapGetBit(checks->any_cc,
-                                           skCountryLookupCode(&ip2)));
-            break;
+      case OPT_SCC:
+        rwRecMemGetSIP(rwrec, &ip1);
+        FILTER_CHECK(skBitmapGetBit(checks->scc,
+                                    skCountryLookupCode(&ip1)));
+        break;
 
-          default:
-            skAbortBadCase(checks->checkSet[j]);
-        }
-    } /* outer for */
+      case OPT_DCC:
+        rwRecMemGetDIP(rwrec, &ip1);
+        FILTER_CHECK(skBitmapGetBit(checks->dcc,
+                                    skCountryLookupCode(&ip1)));
+        break;
+
+      case OPT_ANY_CC:
+        rwRecMemGetSIP(rwrec, &ip1);
+        rwRecMemGetDIP(rwrec, &ip2);
+        FILTER_CHECK(skBitmapGetBit(checks->any_cc,
+                                    skCountryLookupCode(&ip1))
+                     || skBitmapGetBit(checks->any_cc,
+                                       skCountryLookupCode(&ip2)));
+        break;
+
+      case OPT_TUPLE:
+        FILTER_CHECK(RWF_PASS == tupleCheck(rwrec));
+        break;
+
+      default:
+        skAbortBadCase(check_key);
+    }
 
     return RWF_PASS;                     /* WANTED! */
 }
 
 
+/*
+ *    The column kernels used by filterCheckSelect().  Each copies one
+ *    field of the selected records into a column array, tests every
+ *    entry in the column, and then compacts the selection vector to
+ *    the records that passed.  Neither the test loop nor the
+ *    compaction loop contains a branch that depends on the data, so
+ *    the compiler may vectorize the test and a check that rejects
+ *    records at random costs no mispredicted branches.
+ *
+ *    The tests have the same form as CHECK_RANGE() and
+ *    skBitmapGetBit(), so a record passes a kernel exactly when it
+ *    passes the same check in filterCheckOne().
+ */
+
+/*
+ *  count = filterSelectCompact(sel, keep, nsel);
+ *
+ *    Remove from the 'nsel' entries in the selection vector 'sel'
+ *    those whose value in 'keep' is 0.  Return the number of entries
+ *    that remain.
+ */
+static size_t
+filterSelectCompact(
+    uint16_t           *sel,
+    const uint8_t      *keep,
+    size_t              nsel)
+{
+    size_t i;
+    size_t n;
+
+    for (i = 0, n = 0; i < nsel; ++i) {
+        sel[n] = sel[i];
+        n += keep[i];
+    }
+    return n;
+}
+
+/*
+ *  count = filterSelectRange(col, range, sel, nsel);
+ *
+ *    Keep the selected records whose value in 'col' is within
+ *    'range'.
+ */
+static size_t
+filterSelectRange(
+    const uint64_t         *col,
+    const uint64_range_t   *range,
+    uint16_t               *sel,
+    size_t                  nsel)
+{
+    uint8_t keep[FILTER_BATCH_SIZE];
+    const uint64_t min = range->min;
+    const uint64_t max = range->max;
+    size_t i;
+
+    for (i = 0; i < nsel; ++i) {
+        keep[i] = (uint8_t)!((col[i] < min) | (col[i] > max));
+    }
+    return filterSelectCompact(sel, keep, nsel);
+}
+
+/*
+ *  count = filterSelectDoubleRange(col, range, sel, nsel);
+ *
+ *    Keep the selected records whose value in 'col' is within
+ *    'range'.  As with CHECK_RANGE(), a value that is not a number
+ *    passes.
+ */
+static size_t
+filterSelectDoubleRange(
+    const double           *col,
+    const double_range_t   *range,
+    uint16_t               *sel,
+    size_t                  nsel)
+{
+    uint8_t keep[FILTER_BATCH_SIZE];
+    const double min = range->min;
+    const double max = range->max;
+    size_t i;
+
+    for (i = 0; i < nsel; ++i) {
+        keep[i] = (uint8_t)!((col[i] < min) | (col[i] > max));
+    }
+    return filterSelectCompact(sel, keep, nsel);
+}
+
+/*
+ *  count = filterSelectBitmap(col, bitmap, sel, nsel);
+ *
+ *    Keep the selected records whose value in 'col' is set in
+ *    'bitmap'.  As with skBitmapGetBit(), a value beyond the end of
+ *    the bitmap passes.
+ */
+static size_t
+filterSelectBitmap(
+    const uint32_t     *col,
+    const sk_bitmap_t  *bitmap,
+    uint16_t           *sel,
+    size_t              nsel)
+{
+    uint8_t keep[FILTER_BATCH_SIZE];
+    size_t i;
+
+    for (i = 0; i < nsel; ++i) {
+        keep[i] = (uint8_t)(0 != skBitmapGetBit(bitmap, col[i]));
+    }
+    return filterSelectCompact(sel, keep, nsel);
+}
+
+
+/*
+ *  count = filterCheckSelect(check_key, rec_array, sel, nsel);
+ *
+ *    Run the check 'check_key' on the records in 'rec_array' whose
+ *    indexes are given by the 'nsel' entries in the selection vector
+ *    'sel'.  Remove from 'sel' the records that fail the check, and
+ *    return the number of records that remain.  The order of the
+ *    entries in 'sel' is maintained.
+ *
+ *    The range and bitmap checks on the fixed-size fields of the
+ *    record are run column-wise; all other checks call
+ *    filterCheckOne() on each record.
+ */
+static size_t
+filterCheckSelect(
+    unsigned int        check_key,
+    const rwRec        *rec_array,
+    uint16_t           *sel,
+    size_t              nsel)
+{
+    uint64_t col64[FILTER_BATCH_SIZE];
+    uint32_t col32[FILTER_BATCH_SIZE];
+    double col_d[FILTER_BATCH_SIZE];
+    uint8_t keep[FILTER_BATCH_SIZE];
+    const rwRec *r;
+    size_t i;
+
+    switch (check_key) {
+      case OPT_STIME:
+        for (i = 0; i < nsel; ++i) {
+            col64[i] = (uint64_t)rwRecGetStartTime(&rec_array[sel[i]]);
+        }
+        return filterSelectRange(col64, &checks->sTime, sel, nsel);
+
+      case OPT_ETIME:
+        for (i = 0; i < nsel; ++i) {
+            col64[i] = (uint64_t)rwRecGetEndTime(&rec_array[sel[i]]);
+        }
+        return filterSelectRange(col64, &checks->eTime, sel, nsel);
+
+      case OPT_ACTIVE_TIME:
+        for (i = 0; i < nsel; ++i) {
+            r = &rec_array[sel[i]];
+            keep[i] = (uint8_t)(
+                ((uint64_t)rwRecGetStartTime(r) <= checks->active_time.max)
+                & ((uint64_t)rwRecGetEndTime(r) >= checks->active_time.min));
+        }
+        return filterSelectCompact(sel, keep, nsel);
+
+      case OPT_DURATION:
+        for (i = 0; i < nsel; ++i) {
+            col64[i] = rwRecGetElapsed(&rec_array[sel[i]]);
+        }
+        return filterSelectRange(col64, &checks->elapsed, sel, nsel);
+
+      case OPT_BYTES:
+        for (i = 0; i < nsel; ++i) {
+            col64[i] = rwRecGetBytes(&rec_array[sel[i]]);
+        }
+        return filterSelectRange(col64, &checks->bytes, sel, nsel);
+
+      case OPT_PACKETS:
+        for (i = 0; i < nsel; ++i) {
+            col64[i] = rwRecGetPkts(&rec_array[sel[i]]);
+        }
+        return filterSelectRange(col64, &checks->pkts, sel, nsel);
+
+      case OPT_BYTES_PER_PACKET:
+        for (i = 0; i < nsel; ++i) {
+            r = &rec_array[sel[i]];
+            col_d[i] = ((double)rwRecGetBytes(r) / (double)rwRecGetPkts(r));
+        }
+        return filterSelectDoubleRange(col_d, &checks->bytes_per_packet,
+                                       sel, nsel);
+
+      case OPT_SPORT:
+        for (i = 0; i < nsel; ++i) {
+            col32[i] = rwRecGetSPort(&rec_array[sel[i]]);
+        }
+        return filterSelectBitmap(col32, checks->sPort, sel, nsel);
+
+      case OPT_DPORT:
+        for (i = 0; i < nsel; ++i) {
+            col32[i] = rwRecGetDPort(&rec_array[sel[i]]);
+        }
+        return filterSelectBitmap(col32, checks->dPort, sel, nsel);
+
+      case OPT_APORT:
+        for (i = 0; i < nsel; ++i) {
+            r = &rec_array[sel[i]];
+            keep[i] = (uint8_t)(
+                (0 != skBitmapGetBit(checks->any_port, rwRecGetSPort(r)))
+                | (0 != skBitmapGetBit(checks->any_port, rwRecGetDPort(r))));
+        }
+        return filterSelectCompact(sel, keep, nsel);
+
+      case OPT_PROTOCOL:
+        for (i = 0; i < nsel; ++i) {
+            col32[i] = rwRecGetProto(&rec_array[sel[i]]);
+        }
+        return filterSelectBitmap(col32, checks->proto, sel, nsel);
+
+      default:
+        for (i = 0; i < nsel; ++i) {
+            keep[i] = (uint8_t)(RWF_PASS == filterCheckOne(&rec_array[sel[i]],
+                                                           check_key));
+        }
+        return filterSelectCompact(sel, keep, nsel);
+    }
+}
+
+
+/*
+ *  name = filterCheckName(check_key);
+ *
+ *    Return the name of the switch that created the check
+ *    'check_key'.
+ */
+static const char *
+filterCheckName(
+    unsigned int        check_key)
+{
+    switch (check_key) {
+      case OPT_SENSORS:
+        return "sensors";
+      case OPT_FLOW_TYPE:
+        return "flowtypes";
+      case OPT_TUPLE:
+        return "tuple-file";
+      default:
+        return filterSwitch[check_key].option.name;
+    }
+}
+
+
+/*
+ *  filterPlanAdapt(plan);
+ *
+ *    Use the measurements taken while sampling to reorder the checks
+ *    in 'plan', and then clear the measurements.
+ *
+ *    The checks are sorted by the expected time spent per record that
+ *    is rejected: the time the check takes on a record divided by the
+ *    fraction of records it rejects.  A check that rejects no records
+ *    is run last.  The sort is stable, so checks that rank the same
+ *    keep their current order.
+ */
+static void
+filterPlanAdapt(
+    filter_plan_t      *plan)
+{
+    double rank[FILTER_CHECK_MAX];
+    double nsec;
+    char buf[4096];
+    unsigned int k;
+    unsigned int m;
+    uint8_t pos;
+    int len;
+
+    for (k = 0; k < checks->check_count; ++k) {
+        if (plan->passed[k] >= plan->tested) {
+            rank[k] = DBL_MAX;
+        } else {
+            /* add one nanosecond so a check that was too fast to
+             * measure still has a cost */
+            nsec = 1000.0 * (double)plan->usec[k] / (double)plan->tested;
+            rank[k] = ((1.0 + nsec) * (double)plan->tested
+                       / (double)(plan->tested - plan->passed[k]));
+        }
+    }
+
+    for (k = 1; k < checks->check_count; ++k) {
+        pos = plan->order[k];
+        for (m = k; m > 0 && rank[plan->order[m - 1]] > rank[pos]; --m) {
+            plan->order[m] = plan->order[m - 1];
+        }
+        plan->order[m] = pos;
+    }
+
+    if (plan->debug) {
+        len = snprintf(buf, sizeof(buf),
+                       "Check plan after %" PRIu64 " records:",
+                       plan->records);
+        for (k = 0;
+             k < checks->check_count && (size_t)len < sizeof(buf);
+             ++k)
+        {
+            pos = plan->order[k];
+            len += snprintf(buf + len, sizeof(buf) - len,
+                            " --%s (%.1f%% pass, %.1f ns)",
+                            filterCheckName(checks->checkSet[pos]),
+                            (100.0 * (double)plan->passed[pos]
+                             / (double)plan->tested),
+                            (1000.0 * (double)plan->usec[pos]
+                             / (double)plan->tested));
+        }
+        skAppPrintErr("%s", buf);
+    }
+
+    memset(plan->passed, 0, sizeof(plan->passed));
+    memset(plan->usec, 0, sizeof(plan->usec));
+    plan->tested = 0;
+}
+
+
+/*
+ *  plan = filterPlanCreate();
+ *
+ *    Create a check plan that runs the checks in the order they were
+ *    given until it has been adapted.  Each thread that checks
+ *    records must use its own plan.  Return NULL on allocation
+ *    error.
+ */
+filter_plan_t *
+filterPlanCreate(
+    void)
+{
+    filter_plan_t *plan;
+    const char *env;
+    unsigned int k;
+
+    plan = (filter_plan_t*)calloc(1, sizeof(filter_plan_t));
+    if (NULL == plan) {
+        return NULL;
+    }
+    for (k = 0; k < checks->check_count; ++k) {
+        plan->order[k] = (uint8_t)k;
+    }
+    env = getenv(FILTER_PLAN_DEBUG_ENVAR);
+    if (env && env[0]) {
+        plan->debug = 1;
+    }
+    return plan;
+}
+
+
+/*
+ *  filterPlanDestroy(plan);
+ *
+ *    Destroy the check plan 'plan'.
+ */
+void
+filterPlanDestroy(
+    filter_plan_t      *plan)
+{
+    free(plan);
+}
+
+
+/*
+ *  filterCheckPlanned(plan, rec_array, result_list, count);
+ *
+ *    Check each of the 'count' records in 'rec_array' against all of
+ *    the checks the user specified, and set the corresponding entry
+ *    in 'result_list' to RWF_FAIL if the record fails any check or to
+ *    RWF_PASS if it passes all of them.  The checks are run in the
+ *    order given by 'plan', which this function adapts periodically.
+ *    Each check is run over the entire batch before the next check
+ *    begins; see filterCheckSelect().  'count' must not exceed
+ *    FILTER_BATCH_SIZE.
+ */
+void
+filterCheckPlanned(
+    filter_plan_t      *plan,
+    const rwRec        *rec_array,
+    checktype_t        *result_list,
+    size_t              count)
+{
+    uint16_t sel[FILTER_BATCH_SIZE];
+    uint8_t pass_count[FILTER_BATCH_SIZE];
+    struct timeval t0;
+    struct timeval t1;
+    unsigned int k;
+    int64_t usec;
+    size_t nsel;
+    size_t j;
+
+    assert(count <= FILTER_BATCH_SIZE);
+
+    if (0 == count) {
+        return;
+    }
+
+    if (checks->check_count < 2
+        || plan->batches >= FILTER_PLAN_SAMPLE_BATCHES)
+    {
+        /* run the checks in the plan's order, where each check only
+         * sees the records that passed the checks before it */
+        for (j = 0; j < count; ++j) {
+            sel[j] = (uint16_t)j;
+        }
+        nsel = count;
+        for (k = 0; k < checks->check_count && nsel > 0; ++k) {
+            nsel = filterCheckSelect(checks->checkSet[plan->order[k]],
+                                     rec_array, sel, nsel);
+        }
+        for (j = 0; j < count; ++j) {
+            result_list[j] = RWF_FAIL;
+        }
+        for (j = 0; j < nsel; ++j) {
+            result_list[sel[j]] = RWF_PASS;
+        }
+        if (checks->check_count < 2) {
+            return;
+        }
+    } else {
+        /* sample: run every check on every record and time each
+         * check over the entire batch */
+        memset(pass_count, 0, count);
+        for (k = 0; k < checks->check_count; ++k) {
+            for (j = 0; j < count; ++j) {
+                sel[j] = (uint16_t)j;
+            }
+            gettimeofday(&t0, NULL);
+            nsel = filterCheckSelect(checks->checkSet[k], rec_array,
+                                     sel, count);
+            gettimeofday(&t1, NULL);
+            usec = ((int64_t)(t1.tv_sec - t0.tv_sec) * 1000000
+                    + (t1.tv_usec - t0.tv_usec));
+            if (usec > 0) {
+                plan->usec[k] += usec;
+            }
+            plan->passed[k] += nsel;
+            for (j = 0; j < nsel; ++j) {
+                ++pass_count[sel[j]];
+            }
+        }
+        plan->tested += count;
+        for (j = 0; j < count; ++j) {
+            result_list[j] = ((checks->check_count == pass_count[j])
+                              ? RWF_PASS : RWF_FAIL);
+        }
+    }
+
+    plan->records += count;
+    ++plan->batches;
+    if (FILTER_PLAN_SAMPLE_BATCHES == plan->batches) {
+        filterPlanAdapt(plan);
+    } else if (FILTER_PLAN_PERIOD_BATCHES == plan->batches) {
+        plan->batches = 0;
+    }
+}
+
+
 /*
  *  pass = filterCheckFile(rwio, ip_dir)
  *
@@ -2042,6 +2545,22 @@ filterGetCheckCount(
 }
 
 
+/*
+ *  filterAddTupleCheck();
+ *
+ *    Add the --tuple-file check to the checks that
+ *    filterCheckPlanned() runs, so that it is ordered along with the
+ *    other checks.
+ */
+void
+filterAddTupleCheck(
+    void)
+{
+    checks->checkSet[checks->check_count] = OPT_TUPLE;
+    checks->check_count++;
+}
+
+
 /*
  *  status = filterGetFGlobFilters();
  *
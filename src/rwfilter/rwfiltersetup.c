@@ -77,6 +77,16 @@ RCSIDENT("$SiLK: rwfiltersetup.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
  * to the value the user specifies. */
 static sk_compmethod_t comp_method;
 
+/* whether the plug-in filters are run on a batch of records by
+ * filterCheckBatch() instead of being a member of checker[] */
+static int plugin_filter_batch = 0;
+
+/* whether the built-in checks and the --tuple-file check are in use.
+ * filterCheckPlanned() runs them before the checker[] functions, in
+ * an order it adapts to the data; they are not members of
+ * checker[] */
+static int planned_checks = 0;
+
 /* fields that get defined just like plugins */
 static const struct app_static_plugins_st {
     const char         *name;
@@ -106,7 +116,7 @@ static const char *app_plugin_names[] = {
 typedef enum {
     OPT_DRY_RUN,
 #if SK_RWFILTER_THREADED
-    OPT_THREADS,
+    OPT_THREADS, OPT_THREAD_OUTPUT,
 #endif
     OPT_MAX_PASS_RECORDS, OPT_MAX_FAIL_RECORDS,
     OPT_PRINT_FILE, OPT_PLUGIN,
@@ -119,6 +129,7 @@ static struct option appOptions[] = {
     {"dry-run",                 NO_ARG,       0, OPT_DRY_RUN},
 #if SK_RWFILTER_THREADED
     {"threads",                 REQUIRED_ARG, 0, OPT_THREADS},
+    {"thread-output",           REQUIRED_ARG, 0, OPT_THREAD_OUTPUT},
 #endif
     {"max-pass-records",        REQUIRED_ARG, 0, OPT_MAX_PASS_RECORDS},
     {"max-fail-records",        REQUIRED_ARG, 0, OPT_MAX_FAIL_RECORDS},
@@ -139,6 +150,10 @@ static const char *appHelp[] = {
     "Parse command line switches but do not process records",
 #if SK_RWFILTER_THREADED
     "Use this number of threads. Def $SILK_RWFILTER_THREADS or 1",
+    ("Specify how the threads write their output: 'shared'\n"
+     "\tstreams, a 'writer' thread, or a 'shard' file per thread, where\n"
+     "\t" THREAD_SHARD_MARKER " in each destination is the thread"
+     " number. Def. shared"),
 #endif
     ("Write at most this many records to\n"
      "\tthe pass-destination; 0 for all.  Def. 0"),
@@ -171,6 +186,9 @@ static const char *appHelp[] = {
 static int  appOptionsHandler(clientData cData, int opt_index, char *opt_arg);
 static int  filterCheckInputs(int argc);
 static int  filterCheckOutputs(void);
+#if SK_RWFILTER_THREADED
+static int  filterShardOutputs(void);
+#endif
 static int  filterOpenOutputs(void);
 static checktype_t filterPluginCheck(rwRec *rec);
 static int  filterSetCheckers(void);
@@ -215,6 +233,7 @@ appUsageLong(
 
     skOptionsNotesUsage(fh);
     sksiteCompmethodOptionsUsage(fh);
+    cacheUsage(fh);
 
     /* print remaining options */
     fprintf(fh, ("\nINPUT/OUTPUT SWITCHES."
@@ -286,6 +305,12 @@ appSetup(
         exit(EXIT_FAILURE);
     }
 
+    /* load cache module */
+    if (cacheSetup()) {
+        skAppPrintErr("Unable to setup cache module");
+        exit(EXIT_FAILURE);
+    }
+
     skPluginSetup(1, SKPLUGIN_APP_FILTER);
 
     /* register the options */
@@ -352,6 +377,12 @@ appSetup(
     if ((thread_count > 1) && !skPluginIsThreadSafe()) {
         thread_count = 1;
     }
+
+    /* create a destination for each thread from each template */
+    if (filterShardOutputs()) {
+        /* fatal error. msg already printed */
+        exit(EXIT_FAILURE);
+    }
 #endif  /* SK_RWFILTER_THREADED */
 
     /* Check that there is one and only one source of input to process */
@@ -394,7 +425,7 @@ appSetup(
         /* fatal error */
         exit(EXIT_FAILURE);
     }
-    if (checker_count == 0) {
+    if (checker_count == 0 && !planned_checks && !plugin_filter_batch) {
         if (dest_type[DEST_PASS].dest_list) {
             skAppPrintErr("Must specify partitioning rules when using --%s",
                           appOptions[OPT_PASS_DEST].name);
@@ -425,6 +456,11 @@ appSetup(
         }
     }
 
+    /* determine whether to use the query result cache */
+    if (cacheInitialize(argv)) {
+        exit(EXIT_FAILURE);
+    }
+
     /* Try to load site config file; if it fails, we will not be able
      * to resolve flowtype and sensor from input file names.  If fglob
      * is active, it will require the configuration file. */
@@ -501,6 +537,21 @@ appOptionsHandler(
             goto PARSE_ERROR;
         }
         break;
+
+      case OPT_THREAD_OUTPUT:
+        if (0 == strcmp(opt_arg, "shared")) {
+            thread_output = THREAD_OUTPUT_SHARED;
+        } else if (0 == strcmp(opt_arg, "writer")) {
+            thread_output = THREAD_OUTPUT_WRITER;
+        } else if (0 == strcmp(opt_arg, "shard")) {
+            thread_output = THREAD_OUTPUT_SHARD;
+        } else {
+            skAppPrintErr(("Invalid %s '%s': Expected one of"
+                           " shared, writer, or shard"),
+                          appOptions[opt_index].name, opt_arg);
+            return 1;
+        }
+        break;
 #endif  /* SK_RWFILTER_THREADED */
 
       case OPT_INPUT_PIPE:
@@ -620,6 +671,7 @@ appTeardown(
     skPluginRunCleanup(SKPLUGIN_APP_FILTER);
     skPluginTeardown();
 
+    cacheTeardown();
     tupleTeardown();
     filterTeardown();
     skOptionsNotesTeardown();
@@ -820,6 +872,132 @@ filterCheckOutputs(
 }
 
 
+#if SK_RWFILTER_THREADED
+/*
+ *  status = filterShardOutputs()
+ *
+ *    When --thread-output=shard, replace each output destination with
+ *    one destination per thread, whose pathname is that of the
+ *    original destination with every THREAD_SHARD_MARKER replaced by
+ *    the thread number.  Do nothing for other values of
+ *    --thread-output.
+ *
+ *    Return 0 on success, or -1 on failure.
+ */
+static int
+filterShardOutputs(
+    void)
+{
+    char path[PATH_MAX];
+    const char *template;
+    const char *cp;
+    const char *marker;
+    destination_t *old_list;
+    destination_t *old_dest;
+    destination_t *dest;
+    destination_t **end;
+    uint32_t shard_count;
+    uint32_t t;
+    size_t len;
+    int dest_id;
+    int rv;
+
+    if (THREAD_OUTPUT_SHARD != thread_output) {
+        return 0;
+    }
+    shard_count = ((thread_count > 1) ? thread_count : 1);
+
+    for (dest_id = 0; dest_id < DESTINATION_TYPES; ++dest_id) {
+        old_list = dest_type[dest_id].dest_list;
+        dest_type[dest_id].dest_list = NULL;
+        dest_type[dest_id].count = 0;
+        end = &dest_type[dest_id].dest_list;
+
+        while (old_list) {
+            old_dest = old_list;
+            old_list = old_dest->next;
+            template = skStreamGetPathname(old_dest->ios);
+            if (NULL == strstr(template, THREAD_SHARD_MARKER)) {
+                skAppPrintErr(("Invalid %s '%s': The name must contain"
+                               " '%s' when --%s=shard"),
+                              appOptions[dest_id+OPT_PASS_DEST].name,
+                              template, THREAD_SHARD_MARKER,
+                              appOptions[OPT_THREAD_OUTPUT].name);
+                skStreamDestroy(&old_dest->ios);
+                free(old_dest);
+                goto ERROR;
+            }
+
+            for (t = 0; t < shard_count; ++t) {
+                /* build the pathname of this thread's file */
+                path[0] = '\0';
+                len = 0;
+                cp = template;
+                while ((marker = strstr(cp, THREAD_SHARD_MARKER)) != NULL) {
+                    len += snprintf(path + len,
+                                    (len < sizeof(path)
+                                     ? sizeof(path) - len : 0),
+                                    "%.*s%" PRIu32,
+                                    (int)(marker - cp), cp, t);
+                    cp = marker + strlen(THREAD_SHARD_MARKER);
+                }
+                len += snprintf(path + len,
+                                (len < sizeof(path) ? sizeof(path) - len : 0),
+                                "%s", cp);
+                if (len >= sizeof(path)) {
+                    skAppPrintErr("Invalid %s '%s': The name is too long",
+                                  appOptions[dest_id+OPT_PASS_DEST].name,
+                                  template);
+                    skStreamDestroy(&old_dest->ios);
+                    free(old_dest);
+                    goto ERROR;
+                }
+
+                dest = (destination_t*)calloc(1, sizeof(destination_t));
+                if (dest == NULL) {
+                    skAppPrintOutOfMemory(NULL);
+                    skStreamDestroy(&old_dest->ios);
+                    free(old_dest);
+                    goto ERROR;
+                }
+                dest->shard = t;
+                if ((rv = skStreamCreate(&dest->ios, SK_IO_WRITE,
+                                         SK_CONTENT_SILK_FLOW))
+                    || (rv = skStreamBind(dest->ios, path)))
+                {
+                    skStreamPrintLastErr(dest->ios, rv, &skAppPrintErr);
+                    skStreamDestroy(&dest->ios);
+                    free(dest);
+                    skStreamDestroy(&old_dest->ios);
+                    free(old_dest);
+                    goto ERROR;
+                }
+                *end = dest;
+                end = &dest->next;
+                ++dest_type[dest_id].count;
+            }
+
+            skStreamDestroy(&old_dest->ios);
+            free(old_dest);
+        }
+    }
+
+    return 0;
+
+  ERROR:
+    /* free the destinations that remain in the list that was being
+     * replaced; those in dest_type[] are freed by closeAllDests() */
+    while (old_list) {
+        old_dest = old_list;
+        old_list = old_dest->next;
+        skStreamDestroy(&old_dest->ios);
+        free(old_dest);
+    }
+    return -1;
+}
+#endif  /* SK_RWFILTER_THREADED */
+
+
 /*
  *  status = filterOpenOutputs()
  *
@@ -879,8 +1057,17 @@ filterOpenOutputs(
  *    Set the array of function pointers to the pass/fail checking
  *    routines, and return the number of pointers that were set.  If a
  *    check-routine is a plug-in, call the plug-in's initialize()
- *    routine.  If the initialize() routine fails, return -1.  A
- *    return code of 0 means no filtering rules were specified.
+ *    routine.  If the initialize() routine fails, return -1.
+ *
+ *    The built-in checks and the --tuple-file check are not added to
+ *    checker[]; 'planned_checks' is set when any are in use.  When the
+ *    plug-in filters are to be run in batches, they are not added to
+ *    checker[] and 'plugin_filter_batch' is set.  A return code of 0
+ *    means no filtering rules were specified unless one of those
+ *    variables is set.
+ *
+ *    The plug-in checks always run after the others, since a plug-in
+ *    may pass a record immediately or ignore it.
  */
 static int
 filterSetCheckers(
@@ -889,29 +1076,97 @@ filterSetCheckers(
     int count = 0;
     int rv;
 
-    if (filterGetCheckCount() > 0) {
-        checker[count] = (checktype_t (*)(rwRec*))filterCheck;
-        ++count;
-    }
-
     rv = tupleGetCheckCount();
     if (rv == -1) {
         return -1;
     }
     if (rv) {
-        checker[count] = (checktype_t (*)(rwRec*))tupleCheck;
-        ++count;
+        filterAddTupleCheck();
+    }
+
+    if (filterGetCheckCount() > 0) {
+        planned_checks = 1;
     }
 
     if (skPluginFiltersRegistered()) {
-        checker[count] = &filterPluginCheck;
-        ++count;
+        if (skPluginFiltersSupportBatch()) {
+            plugin_filter_batch = 1;
+        } else {
+            checker[count] = &filterPluginCheck;
+            ++count;
+        }
     }
 
     return count;
 }
 
 
+/*
+ *  filterCheckBatch(plan, rec_array, result_list, count);
+ *
+ *    Run the built-in checks in the order given by the check 'plan'
+ *    and then the checker()s over each of the 'count' records in
+ *    'rec_array' and store the RWF result for each record in
+ *    'result_list'.  When the plug-in filters are run in batches,
+ *    the records that pass all other checks are then handed to the
+ *    plug-ins at once.  'count' must not exceed FILTER_BATCH_SIZE.
+ */
+void
+filterCheckBatch(
+    filter_plan_t      *plan,
+    const rwRec        *rec_array,
+    checktype_t        *result_list,
+    size_t              count)
+{
+    const rwRec *rec_list[FILTER_BATCH_SIZE];
+    uint8_t pass_list[FILTER_BATCH_SIZE];
+    skplugin_err_t err;
+    checktype_t result;
+    size_t j;
+    int i;
+
+    assert(count <= FILTER_BATCH_SIZE);
+
+    if (planned_checks) {
+        filterCheckPlanned(plan, rec_array, result_list, count);
+    } else {
+        for (j = 0; j < count; ++j) {
+            result_list[j] = RWF_PASS;
+        }
+    }
+
+    for (j = 0; j < count; ++j) {
+        /* run all checker()'s until end or one doesn't pass */
+        for (i = 0, result = result_list[j];
+             i < checker_count && result == RWF_PASS;
+             ++i)
+        {
+            result = (*(checker[i]))((rwRec*)&rec_array[j]);
+        }
+        result_list[j] = result;
+    }
+
+    if (!plugin_filter_batch) {
+        return;
+    }
+
+    for (j = 0; j < count; ++j) {
+        rec_list[j] = &rec_array[j];
+        pass_list[j] = (RWF_PASS == result_list[j]);
+    }
+    err = skPluginRunFilterBatchFn(rec_list, pass_list, count, NULL);
+    if (SKPLUGIN_OK != err) {
+        skAppPrintErr("Plugin-based filter failed with error code %d", err);
+        exit(EXIT_FAILURE);
+    }
+    for (j = 0; j < count; ++j) {
+        if (RWF_PASS == result_list[j] && !pass_list[j]) {
+            result_list[j] = RWF_FAIL;
+        }
+    }
+}
+
+
 /*
  *  result = filterPluginCheck(rec);
  *
@@ -73,12 +73,34 @@ RCSIDENT("$SiLK: rwfilterthread.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
  */
 #define THREAD_RECBUF_SIZE   0x10000
 
+/*
+ *    When --thread-output=writer, the number of buffers per thread per
+ *    destination type.  A thread fills one buffer while the others
+ *    wait to be written by the writer thread.
+ */
+#define THREAD_WRITER_BUFFERS  2
+
+
+/*
+ *    A buffer of records for one destination type.  When
+ *    --thread-output=writer, a thread hands its filled buffer to the
+ *    writer thread and takes an empty one in exchange.
+ */
+typedef struct filter_outbuf_st filter_outbuf_t;
+struct filter_outbuf_st {
+    filter_outbuf_t    *next;
+    rwRec              *recbuf;
+    uint32_t            reccount;
+    int                 dest_id;
+};
 
 typedef struct filter_thread_st {
-    rwRec          *recbuf[DESTINATION_TYPES];
-    filter_stats_t  stats;
-    pthread_t       thread;
-    int             rv;
+    filter_outbuf_t    *outbuf[DESTINATION_TYPES];
+    filter_plan_t      *plan;
+    filter_stats_t      stats;
+    pthread_t           thread;
+    uint32_t            id;
+    int                 rv;
 } filter_thread_t;
 
 
@@ -94,6 +116,26 @@ static pthread_mutex_t dest_mutex[DESTINATION_TYPES];
 /* max number of records the recbuf can hold */
 static const size_t recbuf_max_recs = THREAD_RECBUF_SIZE / sizeof(rwRec);
 
+/* when --thread-output=shard, the number of records written to each
+ * destination type across all threads, used to honor the
+ * --max-pass-records and --max-fail-records limits */
+static uint64_t shard_rec_count[DESTINATION_TYPES];
+static pthread_mutex_t shard_count_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* when --thread-output=writer, the filled buffers waiting for the
+ * writer thread, and the empty buffers waiting for the filtering
+ * threads.  Both lists are protected by writer_mutex. */
+static filter_outbuf_t *writer_queue_head = NULL;
+static filter_outbuf_t *writer_queue_tail = NULL;
+static filter_outbuf_t *writer_free_list = NULL;
+static pthread_mutex_t writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_queue_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t writer_free_cond = PTHREAD_COND_INITIALIZER;
+
+/* when --thread-output=writer, set once the filtering threads have
+ * queued their last buffer */
+static int writer_done = 0;
+
 
 /* FUNCTION DEFINITIONS */
 
@@ -221,39 +263,215 @@ dumpBuffer(
 
 
 /*
- *  ok = filterFileThreaded(datafile, ipfile_basename, stats, recbuf,reccount);
+ *  status = dumpShardBuffer(shard, dest_id, rec_buffer, rec_count);
+ *
+ *    Write 'rec_count' records from 'rec_buffer' to the destinations
+ *    indexed by 'dest_id' (PASS, FAIL, ALL) that belong to the thread
+ *    'shard'.  Used when --thread-output=shard.  Since no other
+ *    thread writes to those destinations, no lock is held while
+ *    writing.  Return SKSTREAM_OK on success, non-zero on error.
+ */
+static int
+dumpShardBuffer(
+    uint32_t            shard,
+    int                 dest_id,
+    const rwRec        *recbuf,
+    uint32_t            reccount)
+{
+    destination_t *dest;
+    const rwRec *recbuf_pos;
+    const rwRec *end_rec;
+    uint64_t max_records;
+    int num_outs;
+    int i;
+    int rv;
+
+    /* if an output limit was specified, reserve room for these
+     * records in the total across all threads.  Once every output
+     * has reached its limit, stop reading. */
+    max_records = dest_type[dest_id].max_records;
+    if (max_records) {
+        pthread_mutex_lock(&shard_count_mutex);
+        if (shard_rec_count[dest_id] + reccount >= max_records) {
+            reccount = max_records - shard_rec_count[dest_id];
+            shard_rec_count[dest_id] = max_records;
+            num_outs = 0;
+            for (i = 0; i < DESTINATION_TYPES; ++i) {
+                if (dest_type[i].count
+                    && (0 == dest_type[i].max_records
+                        || shard_rec_count[i] < dest_type[i].max_records))
+                {
+                    ++num_outs;
+                }
+            }
+            if (!num_outs) {
+                reading_records = 0;
+            }
+        } else {
+            shard_rec_count[dest_id] += reccount;
+        }
+        pthread_mutex_unlock(&shard_count_mutex);
+    }
+
+    end_rec = recbuf + reccount;
+
+    for (dest = dest_type[dest_id].dest_list; dest != NULL; dest = dest->next){
+        if (dest->shard != shard) {
+            continue;
+        }
+        for (recbuf_pos = recbuf; recbuf_pos < end_rec; ++recbuf_pos) {
+            rv = skStreamWriteRecord(dest->ios, recbuf_pos);
+            if (SKSTREAM_ERROR_IS_FATAL(rv)) {
+                skStreamPrintLastErr(dest->ios, rv, &skAppPrintErr);
+                reading_records = 0;
+                return rv;
+            }
+        }
+    }
+
+    return SKSTREAM_OK;
+}
+
+
+/*
+ *  empty_buffer = writerExchangeBuffer(full_buffer);
+ *
+ *    Append 'full_buffer' to the queue of buffers for the writer
+ *    thread, and return an empty buffer, waiting for the writer
+ *    thread to empty one if necessary.  Used when
+ *    --thread-output=writer.
+ */
+static filter_outbuf_t *
+writerExchangeBuffer(
+    filter_outbuf_t    *outbuf)
+{
+    filter_outbuf_t *empty;
+
+    pthread_mutex_lock(&writer_mutex);
+
+    outbuf->next = NULL;
+    if (writer_queue_tail) {
+        writer_queue_tail->next = outbuf;
+    } else {
+        writer_queue_head = outbuf;
+    }
+    writer_queue_tail = outbuf;
+    pthread_cond_signal(&writer_queue_cond);
+
+    while (NULL == writer_free_list) {
+        pthread_cond_wait(&writer_free_cond, &writer_mutex);
+    }
+    empty = writer_free_list;
+    writer_free_list = empty->next;
+
+    pthread_mutex_unlock(&writer_mutex);
+
+    empty->next = NULL;
+    empty->reccount = 0;
+    empty->dest_id = outbuf->dest_id;
+    return empty;
+}
+
+
+/*
+ *  status = flushBuffer(thread, dest_id);
+ *
+ *    Write the records in the buffer for the destination type
+ *    'dest_id' of 'thread', as determined by --thread-output, and
+ *    leave the thread with an empty buffer.  Return SKSTREAM_OK on
+ *    success, non-zero on error.
+ */
+static int
+flushBuffer(
+    filter_thread_t    *thread,
+    int                 dest_id)
+{
+    filter_outbuf_t *outbuf = thread->outbuf[dest_id];
+    int rv;
+
+    if (0 == outbuf->reccount) {
+        return SKSTREAM_OK;
+    }
+
+    switch (thread_output) {
+      case THREAD_OUTPUT_WRITER:
+        thread->outbuf[dest_id] = writerExchangeBuffer(outbuf);
+        return SKSTREAM_OK;
+      case THREAD_OUTPUT_SHARD:
+        rv = dumpShardBuffer(thread->id, dest_id, outbuf->recbuf,
+                             outbuf->reccount);
+        break;
+      default:
+        rv = dumpBuffer(dest_id, outbuf->recbuf, outbuf->reccount);
+        break;
+    }
+    outbuf->reccount = 0;
+    return rv;
+}
+
+
+/*
+ *  status = addToBuffer(thread, dest_id, rwrec);
+ *
+ *    Copy 'rwrec' into the buffer for the destination type 'dest_id'
+ *    of 'thread', and write the buffer when it is full.  Return
+ *    SKSTREAM_OK on success, non-zero on error.
+ */
+static int
+addToBuffer(
+    filter_thread_t    *thread,
+    int                 dest_id,
+    const rwRec        *rwrec)
+{
+    filter_outbuf_t *outbuf = thread->outbuf[dest_id];
+
+    memcpy(&outbuf->recbuf[outbuf->reccount], rwrec, sizeof(rwRec));
+    if (++outbuf->reccount < recbuf_max_recs) {
+        return SKSTREAM_OK;
+    }
+    return flushBuffer(thread, dest_id);
+}
+
+
+/*
+ *  ok = filterFileThreaded(datafile, ipfile_basename, thread);
  *
  *    This is the actual filtering of the file named 'datafile'.
  *    The 'ipfile_basename' parameter is passed to filterCheckFile();
  *    it should be NULL or contain the full-path (minus extension) of the
  *    file that contains Bloom filter or IPset information about the
- *    'datafile'.  The function returns 0 on success; or 1 if the
- *    input file could not be opened.
+ *    'datafile'.  The records are checked using the check plan of
+ *    'thread', and the statistics of 'thread' are updated.  The
+ *    function returns 0 on success; or 1 if the input file could not
+ *    be opened.
  *
- *    'recbuf' contains pointers to DESTINATION_TYPES number of record
- *    buffers.  A record buffer may be NULL if that output was not
- *    requested to that dest_id.  'reccount' is the current number of
- *    records in each record buffer.  Records that PASS or FAIL the
- *    checks are written into the appropriate record buffer.  When the
- *    count for the buffer reaches the buffer size, the records in the
- *    buffer are written to the output stream.
+ *    Records that PASS or FAIL the checks are written into the record
+ *    buffer of 'thread' for the appropriate destination type.  When a
+ *    buffer is full, the records in the buffer are written to the
+ *    output stream(s); see flushBuffer().
  */
 static int
 filterFileThreaded(
     const char         *datafile,
     const char         *ipfile_basename,
-    filter_stats_t     *stats,
-    rwRec              *recbuf[],
-    uint32_t            recbuf_count[])
+    filter_thread_t    *thread)
 {
-    rwRec rwrec;
+    rwRec rwrec[FILTER_BATCH_SIZE];
+    checktype_t result_list[FILTER_BATCH_SIZE];
+    filter_stats_t *stats = &thread->stats;
+    const rwRec *rec;
     skstream_t *in_rwios;
-    int i;
+    skstream_t *cache_ios;
+    filter_cache_entry_t *cache_entry = NULL;
+    rec_count_t cache_read;
+    rec_count_t read_before = {0, 0, 0};
+    size_t count;
+    size_t j;
+    int from_cache = 0;
     int fail_entire_file = 0;
     int result = RWF_PASS;
     int rv = SKSTREAM_OK;
     int in_rv = SKSTREAM_OK;
-    rwRec *recbuf_pos[DESTINATION_TYPES];
 
     /* nothing to do in dry-run mode but print the file names */
     if (dryrun_fp) {
@@ -265,18 +483,6 @@ filterFileThreaded(
         return 0;
     }
 
-    /* initialize: set each buffer's current record pointer to the
-     * appropriate location */
-    for (i = 0; i < DESTINATION_TYPES; ++i) {
-        if (dest_type[i].count) {
-            assert(NULL != recbuf[i]);
-            recbuf_pos[i] = recbuf[i] + recbuf_count[i];
-        } else {
-            /* not used.  initialize to avoid gcc warning. */
-            recbuf_pos[i] = NULL;
-        }
-    }
-
     /* print filenames if requested */
     if (filenames_fp) {
         fprintf(filenames_fp, "%s\n", datafile);
@@ -290,8 +496,17 @@ filterFileThreaded(
 
     ++stats->files;
 
-    /* determine if all the records in the file will fail the checks */
-    if (filterCheckFile(in_rwios, ipfile_basename) == 1) {
+    /* use the records that passed when the file was last processed,
+     * or else store the records that pass this time */
+    cache_ios = cacheLookup(datafile, &cache_read);
+    if (cache_ios) {
+        skStreamDestroy(&in_rwios);
+        in_rwios = cache_ios;
+        from_cache = 1;
+        stats->read.flows += cache_read.flows;
+        stats->read.pkts  += cache_read.pkts;
+        stats->read.bytes += cache_read.bytes;
+    } else if (filterCheckFile(in_rwios, ipfile_basename) == 1) {
         /* all records in the file will fail the user's tests */
         fail_entire_file = 1;
         result = RWF_FAIL;
@@ -317,89 +532,94 @@ filterFileThreaded(
             /* else computing volume stats, and we need to read each
              * record to get its byte and packet counts. */
         }
+    } else {
+        cache_entry = cacheEntryCreate(datafile);
+        read_before = stats->read;
     }
 
-    /* read and process each record */
-    while (reading_records
-           && (SKSTREAM_OK == (in_rv = skStreamReadRecord(in_rwios, &rwrec))))
-    {
-        /* increment number of read records */
-        INCR_REC_COUNT(stats->read, &rwrec);
-
-        /* the all-dest */
-        if (dest_type[DEST_ALL].count) {
-            memcpy(recbuf_pos[DEST_ALL], &rwrec, sizeof(rwRec));
-            ++recbuf_pos[DEST_ALL];
-            ++recbuf_count[DEST_ALL];
-            if (recbuf_count[DEST_ALL] == recbuf_max_recs) {
-                rv = dumpBuffer(DEST_ALL, recbuf[DEST_ALL],
-                                recbuf_count[DEST_ALL]);
+    /* read the records in batches and process each record */
+    while (reading_records && SKSTREAM_OK == in_rv) {
+        for (count = 0;
+             (count < FILTER_BATCH_SIZE
+              && (SKSTREAM_OK
+                  == (in_rv = skStreamReadRecord(in_rwios, &rwrec[count]))));
+             ++count)
+            ;                   /* empty */
+
+        if (!fail_entire_file && !from_cache) {
+            filterCheckBatch(thread->plan, rwrec, result_list, count);
+        }
+
+        for (j = 0; j < count && reading_records; ++j) {
+            rec = &rwrec[j];
+
+            /* increment number of read records; the cache holds only
+             * the records that pass and their count is already known */
+            if (!from_cache) {
+                INCR_REC_COUNT(stats->read, rec);
+            }
+
+            /* the all-dest */
+            if (dest_type[DEST_ALL].count) {
+                rv = addToBuffer(thread, DEST_ALL, rec);
                 if (rv) {
                     goto END;
                 }
-                recbuf_pos[DEST_ALL] = recbuf[DEST_ALL];
-                recbuf_count[DEST_ALL] = 0;
             }
-        }
 
-        if (!fail_entire_file) {
-            /* run all checker()'s until end or one doesn't pass */
-            for (i=0, result=RWF_PASS;
-                 i < checker_count && result == RWF_PASS;
-                 ++i)
-            {
-                result = (*(checker[i]))(&rwrec);
+            if (!fail_entire_file && !from_cache) {
+                result = result_list[j];
             }
-        }
 
-        switch (result) {
-          case RWF_PASS:
-          case RWF_PASS_NOW:
-            /* increment number of record that pass */
-            INCR_REC_COUNT(stats->pass, &rwrec);
-
-            /* the pass-dest */
-            if (dest_type[DEST_PASS].count) {
-                memcpy(recbuf_pos[DEST_PASS], &rwrec, sizeof(rwRec));
-                ++recbuf_pos[DEST_PASS];
-                ++recbuf_count[DEST_PASS];
-                if (recbuf_count[DEST_PASS] == recbuf_max_recs) {
-                    rv = dumpBuffer(DEST_PASS, recbuf[DEST_PASS],
-                                    recbuf_count[DEST_PASS]);
+            switch (result) {
+              case RWF_PASS:
+              case RWF_PASS_NOW:
+                /* increment number of record that pass */
+                INCR_REC_COUNT(stats->pass, rec);
+
+                if (cache_entry) {
+                    cacheEntryAddRecord(cache_entry, rec);
+                }
+
+                /* the pass-dest */
+                if (dest_type[DEST_PASS].count) {
+                    rv = addToBuffer(thread, DEST_PASS, rec);
                     if (rv) {
                         goto END;
                     }
-                    recbuf_pos[DEST_PASS] = recbuf[DEST_PASS];
-                    recbuf_count[DEST_PASS] = 0;
                 }
-            }
-            break;
+                break;
 
-          case RWF_FAIL:
-            /* the fail-dest */
-            if (dest_type[DEST_FAIL].count) {
-                memcpy(recbuf_pos[DEST_FAIL], &rwrec, sizeof(rwRec));
-                ++recbuf_pos[DEST_FAIL];
-                ++recbuf_count[DEST_FAIL];
-                if (recbuf_count[DEST_FAIL] == recbuf_max_recs) {
-                    rv = dumpBuffer(DEST_FAIL, recbuf[DEST_FAIL],
-                                    recbuf_count[DEST_FAIL]);
+              case RWF_FAIL:
+                /* the fail-dest */
+                if (dest_type[DEST_FAIL].count) {
+                    rv = addToBuffer(thread, DEST_FAIL, rec);
                     if (rv) {
                         goto END;
                     }
-                    recbuf_pos[DEST_FAIL] = recbuf[DEST_FAIL];
-                    recbuf_count[DEST_FAIL] = 0;
                 }
-            }
-            break;
+                break;
 
-          default:
-            break;
+              default:
+                break;
+            }
         }
 
-    } /* while (reading_records && skStreamReadRecord()) */
+    } /* while (reading_records && in_rv == SKSTREAM_OK) */
 
   END:
+    if (cache_entry) {
+        /* store the entry only when every record was processed */
+        if (SKSTREAM_ERR_EOF == in_rv && reading_records && 0 == rv) {
+            cache_read.flows = stats->read.flows - read_before.flows;
+            cache_read.pkts  = stats->read.pkts  - read_before.pkts;
+            cache_read.bytes = stats->read.bytes - read_before.bytes;
+            cacheEntryCommit(cache_entry, &cache_read);
+        } else {
+            cacheEntryDestroy(cache_entry);
+        }
+    }
+
     if (in_rv == SKSTREAM_OK || in_rv == SKSTREAM_ERR_EOF) {
         in_rv = 0;
     } else {
@@ -485,27 +705,23 @@ static void *
 workerThread(
     void               *v_thread)
 {
-    filter_stats_t *stats = &(((filter_thread_t*)v_thread)->stats);
-    rwRec **recbuf = ((filter_thread_t*)v_thread)->recbuf;
-    uint32_t recbuf_count[DESTINATION_TYPES];
+    filter_thread_t *thread = (filter_thread_t*)v_thread;
     char datafile[PATH_MAX];
     int rv = 0;
     int i;
 
     /* ignore all signals unless this thread is the main thread */
-    if (!pthread_equal(main_thread, ((filter_thread_t*)v_thread)->thread)) {
+    if (!pthread_equal(main_thread, thread->thread)) {
         skthread_ignore_signals();
     }
 
-    memset(recbuf_count, 0, sizeof(recbuf_count));
-
-    ((filter_thread_t*)v_thread)->rv = 0;
+    thread->rv = 0;
 
     while (nextInputThreaded(datafile, sizeof(datafile)) != NULL) {
-        rv = filterFileThreaded(datafile, NULL, stats, recbuf, recbuf_count);
+        rv = filterFileThreaded(datafile, NULL, thread);
         if (rv < 0) {
             /* fatal error */
-            ((filter_thread_t*)v_thread)->rv = rv;
+            thread->rv = rv;
             return NULL;
         }
         /* if (rv > 0) there was an error opening/reading input: ignore */
@@ -513,8 +729,8 @@ workerThread(
 
     /* dump any records still in the buffers */
     for (i = 0; i < DESTINATION_TYPES; ++i) {
-        if (recbuf_count[i]) {
-            dumpBuffer(i, recbuf[i], recbuf_count[i]);
+        if (thread->outbuf[i]) {
+            flushBuffer(thread, i);
         }
     }
 
@@ -522,6 +738,61 @@ workerThread(
 }
 
 
+/*
+ *  writerThread(&status);
+ *
+ *    THREAD ENTRY POINT when --thread-output=writer.
+ *
+ *    Writes the buffers that the filtering threads queue to the
+ *    output streams and returns each buffer to the list of empty
+ *    buffers.  Since this is the only thread that writes to the
+ *    streams, no filtering thread waits while records are compressed
+ *    and written.  Stops once the filtering threads have finished
+ *    and the queue is empty.  Sets 'status' to non-zero on error.
+ */
+static void *
+writerThread(
+    void               *v_status)
+{
+    int *status = (int*)v_status;
+    filter_outbuf_t *outbuf;
+
+    skthread_ignore_signals();
+
+    pthread_mutex_lock(&writer_mutex);
+    for (;;) {
+        while (NULL == writer_queue_head && !writer_done) {
+            pthread_cond_wait(&writer_queue_cond, &writer_mutex);
+        }
+        outbuf = writer_queue_head;
+        if (NULL == outbuf) {
+            break;
+        }
+        writer_queue_head = outbuf->next;
+        if (NULL == writer_queue_head) {
+            writer_queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&writer_mutex);
+
+        /* after an error, discard the records; the filtering threads
+         * stop since dumpBuffer() clears 'reading_records' */
+        if (0 == *status) {
+            *status = dumpBuffer(outbuf->dest_id, outbuf->recbuf,
+                                 outbuf->reccount);
+        }
+        outbuf->reccount = 0;
+
+        pthread_mutex_lock(&writer_mutex);
+        outbuf->next = writer_free_list;
+        writer_free_list = outbuf;
+        pthread_cond_signal(&writer_free_cond);
+    }
+    pthread_mutex_unlock(&writer_mutex);
+
+    return NULL;
+}
+
+
 /*
  *  status = threadedFilter(&stats);
  *
@@ -537,8 +808,14 @@ threadedFilter(
     filter_stats_t     *stats)
 {
     filter_thread_t *thread;
+    filter_outbuf_t *outbuf = NULL;
+    pthread_t writer;
+    size_t outbuf_count;
+    size_t k;
+    int writer_status = 0;
     int i;
     uint32_t j;
+    uint32_t started;
     int rv = 0;
 
     /* get the main thread */
@@ -562,24 +839,76 @@ threadedFilter(
     if (thread == NULL) {
         goto END;
     }
+    for (j = 0; j < thread_count; ++j) {
+        thread[j].id = j;
+        thread[j].plan = filterPlanCreate();
+        if (thread[j].plan == NULL) {
+            goto END;
+        }
+    }
+
+    /* create the record buffers: one per thread per destination type
+     * in use, and, for the writer thread, additional buffers to hold
+     * the records waiting to be written */
+    outbuf_count = 0;
+    for (i = 0; i < DESTINATION_TYPES; ++i) {
+        if (dest_type[i].count) {
+            outbuf_count += thread_count;
+        }
+    }
+    if (THREAD_OUTPUT_WRITER == thread_output) {
+        outbuf_count *= THREAD_WRITER_BUFFERS;
+    }
+    /* add one so calloc() is not asked for zero bytes */
+    outbuf = (filter_outbuf_t*)calloc(outbuf_count + 1,
+                                      sizeof(filter_outbuf_t));
+    if (outbuf == NULL) {
+        goto END;
+    }
+    for (k = 0; k < outbuf_count; ++k) {
+        outbuf[k].recbuf = (rwRec*)malloc(recbuf_max_recs * sizeof(rwRec));
+        if (outbuf[k].recbuf == NULL) {
+            goto END;
+        }
+    }
+    k = 0;
     for (i = 0; i < DESTINATION_TYPES; ++i) {
         if (dest_type[i].count) {
             for (j = 0; j < thread_count; ++j) {
-                thread[j].recbuf[i]
-                    = (rwRec*)malloc(recbuf_max_recs * sizeof(rwRec));
-                if (thread[j].recbuf[i] == NULL) {
-                    goto END;
-                }
+                outbuf[k].dest_id = i;
+                thread[j].outbuf[i] = &outbuf[k];
+                ++k;
             }
         }
     }
+    for ( ; k < outbuf_count; ++k) {
+        outbuf[k].next = writer_free_list;
+        writer_free_list = &outbuf[k];
+    }
+
+    /* start the writer thread */
+    if (THREAD_OUTPUT_WRITER == thread_output) {
+        if (pthread_create(&writer, NULL, &writerThread, &writer_status)) {
+            skAppPrintErr("Unable to create writer thread");
+            rv = -1;
+            goto END;
+        }
+    }
 
     /* thread[0] is the main_thread */
     thread[0].thread = main_thread;
 
-    /* create the threads, skip 0 since that is the main thread */
-    for (j = 1; j < thread_count; ++j) {
-        pthread_create(&thread[j].thread, NULL, &workerThread, &thread[j]);
+    /* create the threads, skip 0 since that is the main thread.  If
+     * a thread cannot be created, the threads that were started
+     * process all the files */
+    for (started = 1; started < thread_count; ++started) {
+        if (pthread_create(&thread[started].thread, NULL, &workerThread,
+                           &thread[started]))
+        {
+            skAppPrintErr("Unable to create worker thread; using %" PRIu32
+                          " thread%s", started, ((started > 1) ? "s" : ""));
+            break;
+        }
     }
 
     /* allow the main thread to also process files */
@@ -587,7 +916,7 @@ threadedFilter(
 
     /* join with the threads as they die off */
     for (j = 0; j < thread_count; ++j) {
-        if (j > 0) {
+        if (j > 0 && j < started) {
             pthread_join(thread[j].thread, NULL);
         }
         rv |= thread[j].rv;
@@ -607,14 +936,28 @@ threadedFilter(
 #endif
     }
 
+    /* wait for the writer thread to write the queued records */
+    if (THREAD_OUTPUT_WRITER == thread_output) {
+        pthread_mutex_lock(&writer_mutex);
+        writer_done = 1;
+        pthread_cond_signal(&writer_queue_cond);
+        pthread_mutex_unlock(&writer_mutex);
+        pthread_join(writer, NULL);
+        if (writer_status) {
+            rv = -1;
+        }
+    }
+
   END:
+    if (outbuf) {
+        for (k = 0; k < outbuf_count; ++k) {
+            free(outbuf[k].recbuf);
+        }
+        free(outbuf);
+    }
     if (thread) {
-        for (i = 0; i < DESTINATION_TYPES; ++i) {
-            for (j = 0; j < thread_count; ++j) {
-                if (thread[j].recbuf[i]) {
-                    free(thread[j].recbuf[i]);
-                }
-            }
+        for (j = 0; j < thread_count; ++j) {
+            filterPlanDestroy(thread[j].plan);
         }
         free(thread);
     }
@@ -0,0 +1,96 @@
+#! /usr/bin/perl -w
+#
+#
+# RCSIDENT("$SiLK: rwfglob-shard.pl $")
+
+use strict;
+use SiLKTests;
+
+my $rwfglob = check_silk_app('rwfglob');
+
+my $num_shards = 3;
+my $tmpdir = make_tempdir();
+my $glob_args = ("--data-rootdir=$tmpdir --start-date=2009/02/12:00"
+                 ." --end-date=2009/02/12:23 --sensors=S0,S1,S2,S3"
+                 ." --type=in,out");
+
+# create a repository where every third file is missing and the file
+# sizes vary
+my @missing = `$rwfglob $glob_args --print-missing 2>&1`;
+my $size = 0;
+my $i = 0;
+for (@missing) {
+    next unless m{^Missing (\S+)};
+    my $path = $1;
+    next if 0 == (++$i % 3);
+    (my $dir = $path) =~ s{/[^/]+$}{};
+    system("mkdir", "-p", $dir) == 0
+        or die "ERROR: Cannot create directory '$dir'\n";
+    open my $fh, '>', $path
+        or die "ERROR: Cannot create file '$path': $!\n";
+    $size = ($size * 7 + 1013) % 8192;
+    print $fh 'x' x $size;
+    close $fh;
+}
+
+# the files when no shard is given
+my %all = map { $_ => 1 } list_files("");
+die "ERROR: Repository is empty\n"
+    unless keys %all;
+
+for my $balance (qw(hash size)) {
+    my %seen;
+    my @load;
+    for my $k (1 .. $num_shards) {
+        my @files = list_files("--shard=$k/$num_shards"
+                               ." --shard-balance=$balance");
+        die "ERROR: Shard $k/$num_shards ($balance) is empty\n"
+            unless @files;
+        for my $f (@files) {
+            die "ERROR: File '$f' is in shards $seen{$f} and $k ($balance)\n"
+                if $seen{$f};
+            die "ERROR: Shard $k/$num_shards ($balance) has unknown '$f'\n"
+                unless $all{$f};
+            $seen{$f} = $k;
+            $load[$k] += -s $f;
+        }
+    }
+    for my $f (keys %all) {
+        die "ERROR: File '$f' is not in any shard ($balance)\n"
+            unless $seen{$f};
+    }
+    if ($balance eq 'size') {
+        # greedy assignment keeps the shards within one file of each
+        # other
+        my ($min, $max) = (sort { $a <=> $b } @load[1 .. $num_shards])[0,-1];
+        die "ERROR: Shard sizes range from $min to $max\n"
+            if $max - $min > 8192;
+    }
+}
+
+# the shard number must be between 1 and the number of shards
+for my $bad (qw(0/3 4/3 1/0 2 1/x)) {
+    if (check_exit_status("$rwfglob $glob_args --shard=$bad")) {
+        die "ERROR: Accepted --shard=$bad\n";
+    }
+}
+if (check_exit_status("$rwfglob $glob_args --shard=1/2 --shard-balance=x")) {
+    die "ERROR: Accepted --shard-balance=x\n";
+}
+
+exit 0;
+
+
+sub list_files
+{
+    my ($shard_args) = @_;
+
+    my @files;
+    for (`$rwfglob $glob_args $shard_args --no-summary`) {
+        chomp;
+        push @files, $_;
+    }
+    die "ERROR: Failed running rwfglob $shard_args\n"
+        if $?;
+    return @files;
+}
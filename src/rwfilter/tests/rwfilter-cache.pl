@@ -0,0 +1,217 @@
+#! /usr/bin/perl -w
+#
+#
+# RCSIDENT("$SiLK: rwfilter-cache.pl $")
+
+use strict;
+use SiLKTests;
+
+my $rwfilter = check_silk_app('rwfilter');
+my $rwfglob = check_silk_app('rwfglob');
+my $rwsplit = check_silk_app('rwsplit');
+my $rwuniq = check_silk_app('rwuniq');
+my $rwfileinfo = check_silk_app('rwfileinfo');
+my %file;
+$file{data} = get_data_or_exit77('data');
+$file{fake_cc} = get_data_or_exit77('fake_cc');
+$file{address_types} = get_data_or_exit77('address_types');
+
+my $tmpdir = make_tempdir();
+my $cache = "$tmpdir/cache";
+my $temp = make_tempname('cache');
+my $select_args = ("--data-rootdir=$tmpdir/repo --start-date=2009/02/12:00"
+                   ." --end-date=2009/02/12:23 --sensors=S0,S1,S2,S3"
+                   ." --type=in,out");
+my $filter_args = "--proto=6 --bytes=100-";
+my $uniq = ("$rwuniq --fields=1-5 --ipv6-policy=ignore"
+            ." --timestamp-format=epoch --values=bytes,packets,records"
+            ." --sort-output --delimited --no-titles");
+
+# files modified within the last hour are never cached
+my $old = time - 2 * 86400;
+
+# split the data into pieces and place the pieces into a repository
+for my $dir ("$tmpdir/repo", $cache) {
+    mkdir $dir
+        or die "ERROR: Cannot create directory '$dir': $!\n";
+}
+my @missing = `$rwfglob $select_args --print-missing 2>&1`;
+my $cmd = "$rwsplit --flow-limit=20000 --basename=$tmpdir/piece $file{data}";
+if (!check_exit_status($cmd)) {
+    exit 1;
+}
+my @pieces = sort glob("$tmpdir/piece*");
+my @repo;
+for (@missing) {
+    next unless m{^Missing (\S+)};
+    my $path = $1;
+    my $piece = shift @pieces
+        or last;
+    (my $dir = $path) =~ s{/[^/]+$}{};
+    system("mkdir", "-p", $dir) == 0
+        or die "ERROR: Cannot create directory '$dir'\n";
+    rename $piece, $path
+        or die "ERROR: Cannot rename '$piece' to '$path': $!\n";
+    utime $old, $old, $path;
+    push @repo, $path;
+}
+die "ERROR: Repository is empty\n"
+    unless @repo;
+
+# the outputs when no cache is used
+my ($want_stats, $want_recs) = run_query($filter_args);
+die "ERROR: Query passed no records\n"
+    unless length $want_recs;
+
+# the first run fills the cache
+check_query("$filter_args --cache-directory=$cache", "first run");
+my @entries = list_entries();
+die "ERROR: Cache has ", scalar(@entries), " entries; expected ",
+    scalar(@repo), "\n"
+    unless @entries == @repo;
+for my $entry (@entries) {
+    my $info = `$rwfileinfo --fields=annotations $entry`;
+    die "ERROR: Entry '$entry' has no key\n"
+        unless $info =~ /rwfilter-cache-v1 (\d{20}) \d{20} \d{20} /;
+    die "ERROR: Entry '$entry' has no record count\n"
+        unless $1 > 0;
+    utime $old, $old, $entry;
+}
+
+# a temporary file abandoned by a process that died
+my $abandoned = "$cache/abandoned.tmp";
+open my $fh, '>', $abandoned
+    or die "ERROR: Cannot create '$abandoned': $!\n";
+close $fh;
+utime $old, $old, $abandoned;
+
+# the second run reads every file from the cache, which marks the
+# entries as used; spelling the switches differently does not matter.
+# since it adds no entries, it does not trim the cache
+check_query("--cache-dir $cache -bytes 100- --pro 6", "second run", 1);
+die "ERROR: Cache trimmed by a run that added no entries\n"
+    unless -f $abandoned;
+die "ERROR: Second run changed the entries\n"
+    unless "@entries" eq join(" ", list_entries());
+for my $entry (@entries) {
+    die "ERROR: Second run did not use entry '$entry'\n"
+        unless (stat $entry)[9] > $old;
+}
+
+# a file that changed is processed again but is not cached while it
+# may still be growing
+utime undef, undef, $repo[0];
+check_query("$filter_args --cache-directory=$cache", "changed file");
+die "ERROR: Cached a file that may still be growing\n"
+    unless @entries == list_entries();
+
+# a different query uses different entries; the environment variable
+# names the directory
+{
+    local $ENV{SILK_RWFILTER_CACHE_DIRECTORY} = $cache;
+    $cmd = "$rwfilter $select_args --proto=17 --pass=$temp-udp.rwf";
+    if (!check_exit_status($cmd)) {
+        exit 1;
+    }
+}
+die "ERROR: Different query did not add entries\n"
+    unless list_entries() == @entries + @repo - 1;
+
+# the cache is not used when the records that fail are written
+$cmd = ("$rwfilter $select_args $filter_args --cache-directory=$cache"
+        ." --fail=$temp-fail.rwf --pass=$temp-pass.rwf");
+if (!check_exit_status($cmd)) {
+    exit 1;
+}
+die "ERROR: Cache used with --fail-destination\n"
+    unless list_entries() == @entries + @repo - 1;
+unlink "$temp-fail.rwf", "$temp-pass.rwf";
+
+# the Country Code map is part of the key although no switch names it;
+# $repo[0] may still be growing and is not cached
+my $count = list_entries();
+$cmd = "cp $file{fake_cc} $tmpdir/cc.pmap";
+if (!check_exit_status($cmd)) {
+    exit 1;
+}
+for my $mtime ($old, $old + 60) {
+    local $ENV{SILK_COUNTRY_CODES} = "$tmpdir/cc.pmap";
+    utime $mtime, $mtime, "$tmpdir/cc.pmap";
+    $cmd = ("$rwfilter $select_args --scc=xa,xb,xc"
+            ." --cache-directory=$cache --pass=$temp-pass.rwf");
+    if (!check_exit_status($cmd)) {
+        exit 1;
+    }
+    unlink "$temp-pass.rwf";
+    $count += @repo - 1;
+    die "ERROR: Cache reused entries after the Country Code map changed\n"
+        unless list_entries() == $count;
+}
+
+# the cache is not used when a plug-in provides a check
+{
+    local $ENV{SILK_ADDRESS_TYPES}
+        = "$SiLKTests::PWD/$file{address_types}";
+    $cmd = ("$rwfilter $select_args --stype=1 --cache-directory=$cache"
+            ." --pass=$temp-pass.rwf");
+    if (!check_exit_status($cmd)) {
+        exit 1;
+    }
+    unlink "$temp-pass.rwf";
+}
+die "ERROR: Cache used with a plug-in check\n"
+    unless list_entries() == $count;
+
+# the least recently used entries are removed once the cache is full
+check_query("$filter_args --cache-directory=$cache --cache-size=1",
+            "small cache");
+die "ERROR: Entries remain after exceeding --cache-size\n"
+    if list_entries();
+die "ERROR: Temporary files remain in the cache\n"
+    if glob("$cache/*.tmp");
+
+exit 0;
+
+
+# run the query with the partitioning and cache switches in $args and
+# return the statistics and the records that pass
+sub run_query
+{
+    my ($args) = @_;
+
+    $cmd = ("$rwfilter $select_args $args"
+            ." --print-volume-statistics=$temp-stats.txt"
+            ." --pass=$temp-pass.rwf");
+    if (!check_exit_status($cmd)) {
+        exit 1;
+    }
+    my $stats = `cat $temp-stats.txt`;
+    my $recs = `$uniq $temp-pass.rwf`;
+    unlink "$temp-stats.txt", "$temp-pass.rwf";
+    return ($stats, $recs);
+}
+
+
+# run the query with the switches in $args and verify that its outputs
+# match those when no cache is used
+sub check_query
+{
+    my ($args, $what, $threads) = @_;
+
+    for my $t (1 .. ($threads ? 2 : 1)) {
+        my ($stats, $recs) = run_query($args . " --threads=$t");
+        die "ERROR: Statistics differ ($what):\n$stats\nexpected:\n",
+            "$want_stats\n"
+            unless $stats eq $want_stats;
+        die "ERROR: Records differ ($what)\n"
+            unless $recs eq $want_recs;
+    }
+}
+
+
+# return the entries in the cache, or their number in scalar context
+sub list_entries
+{
+    my @entries = sort glob("$cache/*.rwf");
+    return @entries;
+}
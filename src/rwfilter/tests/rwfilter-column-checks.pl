@@ -0,0 +1,19 @@
+#! /usr/bin/perl -w
+# MD5: ffa1d6a378ce1b4eec2f05276cb658a8
+# TEST: ./rwfilter --stime=2009/02/12:05-2009/02/12:20 --duration=0-1800 --packets=2- --bytes-per-packet=40-1000 --dport=0-1023 --protocol=6,17 --flags-all=S/S --pass=stdout ../../tests/data.rwf | ../rwcat/rwcat --compression-method=none --byte-order=little --ipv4-output
+
+use strict;
+use SiLKTests;
+
+my $rwfilter = check_silk_app('rwfilter');
+my $rwcat = check_silk_app('rwcat');
+my %file;
+$file{data} = get_data_or_exit77('data');
+
+# the range and bitmap checks are run column-wise over each batch,
+# and --flags-all is run record-by-record on those records that
+# remain
+my $cmd = "$rwfilter --stime=2009/02/12:05-2009/02/12:20 --duration=0-1800 --packets=2- --bytes-per-packet=40-1000 --dport=0-1023 --protocol=6,17 --flags-all=S/S --pass=stdout $file{data} | $rwcat --compression-method=none --byte-order=little --ipv4-output";
+my $md5 = "ffa1d6a378ce1b4eec2f05276cb658a8";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,14 @@
+#! /usr/bin/perl -w
+# MD5: e71c308e7bcaca2374cd2a3b4ad59ad2
+# TEST: ./rwfilter --proto=6 --max-pass-records=3 --pass=/dev/null --print-statistics=stdout ../../tests/data.rwf
+
+use strict;
+use SiLKTests;
+
+my $rwfilter = check_silk_app('rwfilter');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwfilter --proto=6 --max-pass-records=3 --pass=/dev/null --print-statistics=stdout $file{data}";
+my $md5 = "e71c308e7bcaca2374cd2a3b4ad59ad2";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,21 @@
+#! /usr/bin/perl -w
+# MD5: 079ec36b8e958d5eed379f1ad7948844
+# TEST: echo 25,6 | ./rwfilter --not-sipset=../../tests/set1-v4.set --bytes=100- --aport=25 --tuple-file=- --tuple-delim=, --tuple-fields=sport,proto --pass=stdout ../../tests/data.rwf ../../tests/data.rwf ../../tests/data.rwf | ../rwcat/rwcat --compression-method=none --byte-order=little --ipv4-output
+
+use strict;
+use SiLKTests;
+
+my $rwfilter = check_silk_app('rwfilter');
+my $rwcat = check_silk_app('rwcat');
+my %file;
+$file{data} = get_data_or_exit77('data');
+$file{v4set1} = get_data_or_exit77('v4set1');
+
+# the checks are listed from least to most selective; the check plan
+# reorders them after the first batches and again after a million
+# records, which must not change the result
+$ENV{SILK_RWFILTER_PLAN_DEBUG} = 1;
+my $cmd = "echo 25,6 | $rwfilter --not-sipset=$file{v4set1} --bytes=100- --aport=25 --tuple-file=- --tuple-delim=, --tuple-fields=sport,proto --pass=stdout $file{data} $file{data} $file{data} | $rwcat --compression-method=none --byte-order=little --ipv4-output";
+my $md5 = "079ec36b8e958d5eed379f1ad7948844";
+
+check_md5_output($md5, $cmd);
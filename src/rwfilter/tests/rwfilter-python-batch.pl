@@ -0,0 +1,38 @@
+#! /usr/bin/perl -w
+# MD5: 0647abf67bceb044255aa526c55a6ea4
+# TEST: ./rwfilter --python-file=/tmp/rwfilter-python-batch.py --pass=stdout ../../tests/data.rwf | ../rwcat/rwcat --compression-method=none --byte-order=little --ipv4-output
+
+use strict;
+use SiLKTests;
+
+my $NAME = $0;
+$NAME =~ s,.*/,,;
+
+my $rwfilter = check_silk_app('rwfilter');
+my $rwcat = check_silk_app('rwcat');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my %temp;
+$temp{python} = make_tempname('batch.py');
+$ENV{PYTHONPATH} = $SiLKTests::testsdir.((defined $ENV{PYTHONPATH}) ? ":$ENV{PYTHONPATH}" : "");
+add_plugin_dirs('/src/pysilk');
+
+# same records as the filter_same_port() filter in pysilk-plugin.py,
+# but the filter is registered as a batch filter
+open my $py, '>', $temp{python}
+    or die "$NAME: Cannot open $temp{python}: $!\n";
+print $py <<'EOF_PYTHON';
+def same_port(recs):
+    return [rec.sport == rec.dport for rec in recs]
+
+register_filter(None, batch_filter=same_port)
+EOF_PYTHON
+close $py
+    or die "$NAME: Cannot close $temp{python}: $!\n";
+
+skip_test('Cannot use --python-file')
+    unless check_exit_status(qq|$rwfilter --python-file=$temp{python} --help|);
+my $cmd = "$rwfilter --python-file=$temp{python} --pass=stdout $file{data} | $rwcat --compression-method=none --byte-order=little --ipv4-output";
+my $md5 = "0647abf67bceb044255aa526c55a6ea4";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,103 @@
+#! /usr/bin/perl -w
+#
+#
+# RCSIDENT("$SiLK: rwfilter-shard.pl $")
+
+use strict;
+use SiLKTests;
+
+my $rwfilter = check_silk_app('rwfilter');
+my $rwfglob = check_silk_app('rwfglob');
+my $rwsplit = check_silk_app('rwsplit');
+my $rwuniq = check_silk_app('rwuniq');
+my $rwshardmerge = check_silk_app('rwshardmerge');
+$ENV{RWCAT} = check_silk_app('rwcat');
+my %file;
+$file{data} = get_data_or_exit77('data');
+
+my $num_shards = 4;
+my $tmpdir = make_tempdir();
+my $temp = make_tempname('shard');
+my $select_args = ("--data-rootdir=$tmpdir/repo --start-date=2009/02/12:00"
+                   ." --end-date=2009/02/12:23 --sensors=S0,S1,S2,S3"
+                   ." --type=in,out");
+my $filter_args = "--proto=6 --bytes=100-";
+my $uniq = ("$rwuniq --fields=1-5 --ipv6-policy=ignore"
+            ." --timestamp-format=epoch --values=bytes,packets,records"
+            ." --sort-output --delimited --no-titles");
+
+# split the data into pieces and place the pieces into a repository
+mkdir "$tmpdir/repo"
+    or die "ERROR: Cannot create directory '$tmpdir/repo': $!\n";
+my @missing = `$rwfglob $select_args --print-missing 2>&1`;
+my $cmd = "$rwsplit --flow-limit=4000 --basename=$tmpdir/piece $file{data}";
+if (!check_exit_status($cmd)) {
+    exit 1;
+}
+my @pieces = sort glob("$tmpdir/piece*");
+for (@missing) {
+    next unless m{^Missing (\S+)};
+    my $path = $1;
+    my $piece = shift @pieces
+        or last;
+    (my $dir = $path) =~ s{/[^/]+$}{};
+    system("mkdir", "-p", $dir) == 0
+        or die "ERROR: Cannot create directory '$dir'\n";
+    rename $piece, $path
+        or die "ERROR: Cannot rename '$piece' to '$path': $!\n";
+}
+
+# run the query as a single process
+for my $stats (qw(print-statistics print-volume-statistics)) {
+    $cmd = ("$rwfilter $select_args $filter_args --$stats=$temp-all.txt"
+            ." --pass=$temp-all.rwf");
+    if (!check_exit_status($cmd)) {
+        exit 1;
+    }
+
+    # run one process per shard at the same time
+    my %pids;
+    for my $k (1 .. $num_shards) {
+        $cmd = ("$rwfilter $select_args $filter_args --shard=$k/$num_shards"
+                ." --$stats=$temp-$k.txt --pass=$temp-$k.rwf");
+        print STDERR "RUNNING: $cmd\n"
+            if $ENV{SK_TESTS_VERBOSE};
+        my $pid = fork;
+        die "ERROR: Cannot fork: $!\n"
+            unless defined $pid;
+        if (0 == $pid) {
+            exec $cmd
+                or die "ERROR: Cannot exec rwfilter: $!\n";
+        }
+        $pids{$pid} = $k;
+    }
+    while (keys %pids) {
+        my $pid = wait;
+        last if -1 == $pid;
+        die "ERROR: Shard $pids{$pid} failed\n"
+            if $?;
+        delete $pids{$pid};
+    }
+
+    # merge the shards
+    $cmd = ("$rwshardmerge --output-path=$temp-merged.rwf"
+            ." --statistics-output=$temp-merged.txt"
+            .join("", map {" --statistics=$temp-$_.txt"} 1 .. $num_shards)
+            .join("", map {" $temp-$_.rwf"} 1 .. $num_shards));
+    if (!check_exit_status($cmd)) {
+        exit 1;
+    }
+
+    # the merged outputs must match those of the single process
+    my $want = `cat $temp-all.txt`;
+    my $got = `cat $temp-merged.txt`;
+    die "ERROR: Merged $stats differ:\n$got\nexpected:\n$want\n"
+        unless $got eq $want;
+    $want = `$uniq $temp-all.rwf`;
+    $got = `$uniq $temp-merged.rwf`;
+    die "ERROR: Merged records differ ($stats)\n"
+        unless $got eq $want && length $want;
+    unlink glob("$temp-*");
+}
+
+exit 0;
@@ -0,0 +1,52 @@
+#! /usr/bin/perl -w
+# MD5: dd4ad291c05df4f4cc2ca9dfe918c876
+# TEST: ./rwfilter --threads=4 --thread-output=shard --proto=17 --pass=$temp-%T.rwf ../../tests/data.rwf ../../tests/data.rwf ../../tests/data.rwf && ../rwcat/rwcat $temp-*.rwf | ../rwuniq/rwuniq --fields=1-5 --ipv6-policy=ignore --timestamp-format=epoch --values=bytes,packets,records,stime,etime --sort-output --delimited --no-titles
+
+use strict;
+use SiLKTests;
+
+my $rwfilter = check_silk_app('rwfilter');
+my $rwcat = check_silk_app('rwcat');
+my $rwuniq = check_silk_app('rwuniq');
+my $rwfileinfo = check_silk_app('rwfileinfo');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $temp = make_tempname('shard');
+
+# clean up when we're done
+END {
+    if (!$ENV{SK_TESTS_SAVEOUTPUT}) {
+        # remove files
+        unlink glob($temp."*");
+    }
+}
+
+my $cmd = "$rwfilter --threads=4 --thread-output=shard --proto=17 --pass=$temp-%T.rwf $file{data} $file{data} $file{data}";
+if (!check_exit_status($cmd)) {
+    exit 1;
+}
+
+# each thread writes its own file
+for my $t (0 .. 3) {
+    die "ERROR: Missing output file for thread $t\n"
+        unless -f "$temp-$t.rwf";
+}
+
+# together, the files hold the records that pass
+$cmd = "$rwcat $temp-*.rwf | $rwuniq --fields=1-5 --ipv6-policy=ignore --timestamp-format=epoch --values=bytes,packets,records,stime,etime --sort-output --delimited --no-titles";
+my $md5 = "dd4ad291c05df4f4cc2ca9dfe918c876";
+check_md5_output($md5, $cmd);
+
+# the limit on the number of records applies across all the files
+$cmd = "$rwfilter --threads=4 --thread-output=shard --proto=17 --max-pass-records=5000 --pass=$temp-max-%T.rwf $file{data} $file{data} $file{data}";
+if (!check_exit_status($cmd)) {
+    exit 1;
+}
+my $count = 0;
+for (`$rwfileinfo --fields=count-records --no-titles $temp-max-*.rwf`) {
+    $count += $1 if /(\d+)/;
+}
+die "ERROR: Files contain $count records; expected 5000\n"
+    unless 5000 == $count;
+
+exit 0;
@@ -0,0 +1,11 @@
+#! /usr/bin/perl -w
+# STATUS: ERR
+# TEST: ./rwshardmerge
+
+use strict;
+use SiLKTests;
+
+my $rwshardmerge = check_silk_app('rwshardmerge');
+my $cmd = "$rwshardmerge";
+
+exit (check_exit_status($cmd) ? 1 : 0);
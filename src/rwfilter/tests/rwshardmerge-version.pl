@@ -0,0 +1,11 @@
+#! /usr/bin/perl -w
+# STATUS: OK
+# TEST: ./rwshardmerge --version
+
+use strict;
+use SiLKTests;
+
+my $rwshardmerge = check_silk_app('rwshardmerge');
+my $cmd = "$rwshardmerge --version";
+
+exit (check_exit_status($cmd) ? 0 : 1);
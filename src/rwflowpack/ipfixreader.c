@@ -249,6 +249,26 @@ readerPrintStats(
 }
 
 
+/*
+ *  status = readerGetTelemetry(flow_processor, &telemetry);
+ *
+ *    Invoked by input_mode_type->telemetry_fn();
+ */
+static int
+readerGetTelemetry(
+    flow_proc_t                *fproc,
+    skFlowSourceTelemetry_t    *telemetry)
+{
+    skIPFIXSource_t *ipfix_src = (skIPFIXSource_t*)fproc->flow_src;
+
+    if (NULL == ipfix_src) {
+        return -1;
+    }
+    skIPFIXSourceGetTelemetry(ipfix_src, telemetry);
+    return 0;
+}
+
+
 /*
  *  status = readerSetup(&out_daemon_mode, probe_vector, options);
  *
@@ -318,6 +338,7 @@ ipfixReaderInitialize(
     input_mode_type->setup_fn       = &readerSetup;
     input_mode_type->start_fn       = &readerStart;
     input_mode_type->stop_fn        = &readerStop;
+    input_mode_type->telemetry_fn   = &readerGetTelemetry;
     input_mode_type->want_probe_fn  = &readerWantProbe;
 
     return 0;
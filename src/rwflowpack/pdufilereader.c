@@ -223,6 +223,26 @@ readerPrintStats(
 }
 
 
+/*
+ *  status = readerGetTelemetry(flow_processor, &telemetry);
+ *
+ *    Invoked by input_mode_type->telemetry_fn();
+ */
+static int
+readerGetTelemetry(
+    flow_proc_t                *fproc,
+    skFlowSourceTelemetry_t    *telemetry)
+{
+    skPDUSource_t *pdu_src = (skPDUSource_t*)fproc->flow_src;
+
+    if (NULL == pdu_src) {
+        return -1;
+    }
+    skPDUSourceGetTelemetry(pdu_src, telemetry);
+    return 0;
+}
+
+
 /*
  *  status = readerSetup(&out_daemon_mode, probe_vector, options);
  *
@@ -307,6 +327,7 @@ pduFileReaderInitialize(
     input_mode_type->setup_fn      = &readerSetup;
     input_mode_type->start_fn      = &readerStart;
     input_mode_type->stop_fn       = &readerStop;
+    input_mode_type->telemetry_fn  = &readerGetTelemetry;
     input_mode_type->want_probe_fn = &readerWantProbe;
 
     return 0;
@@ -102,6 +102,7 @@ readerGetRecord(
 
     if (0 == skPDUSourceGetGeneric(pdu_src, out_rwrec)) {
         *out_probe = fproc->probe;
+        fproc->rec_arrival = skPDUSourceGetArrivalTime(pdu_src);
 
         /* When reading from the network, any point is a valid
          * stopping point */
@@ -220,6 +221,26 @@ readerPrintStats(
 }
 
 
+/*
+ *  status = readerGetTelemetry(flow_processor, &telemetry);
+ *
+ *    Invoked by input_mode_type->telemetry_fn();
+ */
+static int
+readerGetTelemetry(
+    flow_proc_t                *fproc,
+    skFlowSourceTelemetry_t    *telemetry)
+{
+    skPDUSource_t *pdu_src = (skPDUSource_t*)fproc->flow_src;
+
+    if (NULL == pdu_src) {
+        return -1;
+    }
+    skPDUSourceGetTelemetry(pdu_src, telemetry);
+    return 0;
+}
+
+
 /*
  *  status = readerSetup(&out_daemon_mode, probe_vector, options);
  *
@@ -284,6 +305,7 @@ pduReaderInitialize(
     input_mode_type->setup_fn       = &readerSetup;
     input_mode_type->start_fn       = &readerStart;
     input_mode_type->stop_fn        = &readerStop;
+    input_mode_type->telemetry_fn   = &readerGetTelemetry;
     input_mode_type->want_probe_fn  = &readerWantProbe;
 
     return 0;
@@ -131,9 +131,11 @@ RCSIDENT("$SiLK: rwflowpack.c d0a292b2508d 2015-01-26 16:42:32Z mthomas $");
 
 #include <silk/redblack.h>
 #include <silk/skdaemon.h>
+#include <silk/skdedupe.h>
 #include <silk/skplugin.h>
 #include <silk/skpolldir.h>
 #include <silk/sksite.h>
+#include <silk/sktelemetry.h>
 #include <silk/sktimer.h>
 #include <silk/skvector.h>
 #include "rwflowpack_priv.h"
@@ -201,6 +203,10 @@ RCSIDENT("$SiLK: rwflowpack.c d0a292b2508d 2015-01-26 16:42:32Z mthomas $");
  * default may be changed with the --polling-interval switch. */
 #define POLLING_INTERVAL 15
 
+/* How often, in seconds, to rewrite the telemetry file.  This default
+ * may be changed with the --telemetry-interval switch. */
+#define TELEMETRY_INTERVAL 10
+
 /* Helper macro for messages */
 #define CHECK_PLURAL(cp_x) ((1 == (cp_x)) ? "" : "s")
 
@@ -389,6 +395,54 @@ static pthread_cond_t  input_filehandles_cond  = PTHREAD_COND_INITIALIZER;
  * files, use the files' existing byte order. */
 static silk_endian_t byte_order = SILK_ENDIAN_NATIVE;
 
+/* When non-negative, a record is dropped when it duplicates a record
+ * from any probe whose start time is within this many milliseconds
+ * of the latest start time seen.  Set by --dedupe-window. */
+static int64_t dedupe_window = -1;
+
+/* Start times of duplicate records may differ by this many
+ * milliseconds.  Set by --dedupe-stime-delta. */
+static uint32_t dedupe_stime_delta = 0;
+
+/* The recent records used to find duplicates, shared by all flow
+ * processors, and the mutex that protects it */
+static sk_dedupe_t *dedupe = NULL;
+static pthread_mutex_t dedupe_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* The file to which performance metrics are written every
+ * 'telemetry_interval' seconds, and the object that writes it.  Set
+ * by --telemetry-file and --telemetry-interval. */
+static const char *telemetry_path = NULL;
+static uint32_t telemetry_interval = TELEMETRY_INTERVAL;
+static sk_telemetry_t *telemetry = NULL;
+
+/* The stages of processing a record that are timed when the
+ * telemetry file is enabled.  'receive' is from the arrival of the
+ * packet holding the record until the record is returned by the
+ * flow source, and it is only known for NetFlow v5 from the network.
+ * 'read' is the time spent in the get_record_fn(), including time
+ * spent waiting for data.  'write' includes finding the output file
+ * in the stream_cache. */
+typedef enum {
+    STAGE_RECEIVE, STAGE_READ, STAGE_DEDUPE, STAGE_PACK, STAGE_WRITE
+} pack_stage_t;
+
+#define PACK_STAGE_COUNT  5
+
+static const char *pack_stage_names[PACK_STAGE_COUNT] = {
+    "receive", "read", "dedupe", "pack", "write"
+};
+
+/* The fields compared to find duplicates.  The sensor, flowtype, and
+ * router-specific fields are not compared since exporters that see
+ * the same traffic differ in these. */
+static const uint32_t dedupe_fields[] = {
+    RWREC_FIELD_SIP, RWREC_FIELD_DIP, RWREC_FIELD_SPORT, RWREC_FIELD_DPORT,
+    RWREC_FIELD_PROTO, RWREC_FIELD_PKTS, RWREC_FIELD_BYTES, RWREC_FIELD_FLAGS,
+    RWREC_FIELD_STIME, RWREC_FIELD_ELAPSED, RWREC_FIELD_INIT_FLAGS,
+    RWREC_FIELD_REST_FLAGS, RWREC_FIELD_TCP_STATE, RWREC_FIELD_APPLICATION
+};
+
 /* When the output_mode is "local-storage" (which is the default),
  * rwflowpack writes the flows to the hourly files located under the
  * root directory (sksiteGetRootDir()). */
@@ -505,6 +559,8 @@ typedef enum {
     OPT_FLUSH_TIMEOUT,
     OPT_STREAM_CACHE_SIZE,
     OPT_PACK_INTERFACES, OPT_BYTE_ORDER,
+    OPT_DEDUPE_WINDOW, OPT_DEDUPE_STIME_DELTA,
+    OPT_TELEMETRY_FILE, OPT_TELEMETRY_INTERVAL,
     OPT_ERROR_DIRECTORY,
     OPT_ARCHIVE_DIRECTORY, OPT_FLAT_ARCHIVE, OPT_POST_ARCHIVE_COMMAND,
     OPT_SENSOR_CONFIG, OPT_VERIFY_SENSOR_CONFIG,
@@ -527,6 +583,10 @@ static struct option appOptions[] = {
     {"file-cache-size",         REQUIRED_ARG, 0, OPT_STREAM_CACHE_SIZE},
     {"pack-interfaces",         NO_ARG,       0, OPT_PACK_INTERFACES},
     {"byte-order",              REQUIRED_ARG, 0, OPT_BYTE_ORDER},
+    {"dedupe-window",           REQUIRED_ARG, 0, OPT_DEDUPE_WINDOW},
+    {"dedupe-stime-delta",      REQUIRED_ARG, 0, OPT_DEDUPE_STIME_DELTA},
+    {"telemetry-file",          REQUIRED_ARG, 0, OPT_TELEMETRY_FILE},
+    {"telemetry-interval",      REQUIRED_ARG, 0, OPT_TELEMETRY_INTERVAL},
 
     {"error-directory",         REQUIRED_ARG, 0, OPT_ERROR_DIRECTORY},
     {"archive-directory",       REQUIRED_ARG, 0, OPT_ARCHIVE_DIRECTORY},
@@ -567,6 +627,17 @@ static const char *appHelp[] = {
      "\t(useful for debugging the router configuration). Def. No"),
     ("Byte order to use for newly packed files:\n"
      "\tChoices: 'native', 'little', or 'big'. Def. native"),
+    ("Drop records that duplicate a record from any probe\n"
+     "\twhose start time is within this number of milliseconds of the\n"
+     "\tlatest start time seen. Def. Keep duplicates"),
+    ("Treat the start times of two records as identical\n"
+     "\tif they differ by this number of milliseconds or less. Requires\n"
+     "\t--dedupe-window. Def. 0"),
+    ("Periodically write performance metrics for the\n"
+     "\tsources, record processing stages, and output files to this file\n"
+     "\tin the Prometheus text format. Def. No metrics"),
+    ("Time (in seconds) between updates of the\n"
+     "\ttelemetry file. Requires --telemetry-file"),
 
     ("Move input files that are NOT successfully processed\n"
      "\tinto this directory.  If not specified, rwflowpack exits when it\n"
@@ -627,6 +698,7 @@ static int  flowpackSetMaximumFileHandles(int new_max_fh);
 static int  startAllProcessors(void);
 static void stopAllProcessors(void);
 static void printReaderStats(void);
+static int  startTelemetry(void);
 static int  getProbes(sk_vector_t *probe_vec);
 static int  createFlowProcessorsFlowcap(void);
 static int  createFlowProcessorsRespool(void);
@@ -691,7 +763,7 @@ appUsageLong(
     skOptionsDefaultUsage(fh);
 
     /* print the "common" (non-mode-specific) options */
-    for (i = 0; i <= OPT_BYTE_ORDER; ++i) {
+    for (i = 0; i <= OPT_TELEMETRY_INTERVAL; ++i) {
         fprintf(fh, "--%s %s. ", appOptions[i].name,
                 SK_OPTION_HAS_ARG(appOptions[i]));
         switch (appOptions[i].val) {
@@ -699,6 +771,10 @@ appUsageLong(
             fprintf(fh, "%s. Def. %d", appHelp[i], FLUSH_TIMEOUT);
             break;
 
+          case OPT_TELEMETRY_INTERVAL:
+            fprintf(fh, "%s. Def. %d", appHelp[i], TELEMETRY_INTERVAL);
+            break;
+
           case OPT_STREAM_CACHE_SIZE:
             fprintf(fh, "%s. Range %d-%d. Def. %d",
                     appHelp[i], STREAM_CACHE_MIN,
@@ -835,6 +911,7 @@ appTeardown(
             free(packlogic.path);
         }
         skpcTeardown();
+        skDedupeDestroy(&dedupe);
         skdaemonTeardown();
         skAppUnregister();
         return;
@@ -889,6 +966,7 @@ appTeardown(
             if (fproc->input_mode_type->free_fn != NULL) {
                 fproc->input_mode_type->free_fn(fproc);
             }
+            skTelemetryLatencyDestroy(&fproc->latency);
         }
     }
 
@@ -926,6 +1004,8 @@ appTeardown(
     /* teardown the probe configuration */
     skpcTeardown();
 
+    skDedupeDestroy(&dedupe);
+
     if (input_mode == INPUT_PDUFILE) {
        INFOMSG("Finished processing PDU file.");
     } else {
@@ -1053,6 +1133,18 @@ appSetup(
         skAppUsage();  /* never returns */
     }
 
+    /* create the set of recent records used to drop duplicates */
+    if (dedupe_window >= 0) {
+        if (skDedupeCreate(&dedupe, dedupe_fields,
+                           (sizeof(dedupe_fields)/sizeof(dedupe_fields[0])),
+                           dedupe_window))
+        {
+            skAppPrintOutOfMemory("duplicate record table");
+            exit(EXIT_FAILURE);
+        }
+        skDedupeSetDelta(dedupe, RWREC_FIELD_STIME, dedupe_stime_delta);
+    }
+
     /* set input file handles based on stream_cache_size */
     max_fh = (int)((double)stream_cache_size * INPUT_FILEHANDLES_FRACTION);
     if (max_fh < INPUT_FILEHANDLES_MIN) {
@@ -1232,6 +1324,39 @@ appOptionsProcessOpt(
       case OPT_BYTE_ORDER:
         return byteOrderParse(opt_arg);
 
+      case OPT_DEDUPE_WINDOW:
+        rv = skStringParseUint32(&opt_val, opt_arg, 0, 0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        dedupe_window = opt_val;
+        break;
+
+      case OPT_DEDUPE_STIME_DELTA:
+        rv = skStringParseUint32(&opt_val, opt_arg, 0, 0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        dedupe_stime_delta = opt_val;
+        break;
+
+      case OPT_TELEMETRY_FILE:
+        if ('\0' == opt_arg[0]) {
+            skAppPrintErr("Invalid %s: Empty string",
+                          appOptions[opt_index].name);
+            return 1;
+        }
+        telemetry_path = opt_arg;
+        break;
+
+      case OPT_TELEMETRY_INTERVAL:
+        rv = skStringParseUint32(&opt_val, opt_arg, 1, 0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        telemetry_interval = opt_val;
+        break;
+
       case OPT_PACK_INTERFACES:
         if (determine_fileformat_fn != &defaultDetermineFileFormat) {
             /* use a function to "round up" the results of calling the
@@ -1530,6 +1655,22 @@ validateOptions(
         options_error = -1;
     }
 
+    /* --dedupe-stime-delta requires --dedupe-window */
+    if (ocache[OPT_DEDUPE_STIME_DELTA].seen && dedupe_window < 0) {
+        skAppPrintErr("The --%s switch is required when using --%s",
+                      appOptions[OPT_DEDUPE_WINDOW].name,
+                      appOptions[OPT_DEDUPE_STIME_DELTA].name);
+        options_error = -1;
+    }
+
+    /* --telemetry-interval requires --telemetry-file */
+    if (ocache[OPT_TELEMETRY_INTERVAL].seen && NULL == telemetry_path) {
+        skAppPrintErr("The --%s switch is required when using --%s",
+                      appOptions[OPT_TELEMETRY_FILE].name,
+                      appOptions[OPT_TELEMETRY_INTERVAL].name);
+        options_error = -1;
+    }
+
     /* return if we have options problems */
     if (options_error) {
         return -1;
@@ -2102,6 +2243,176 @@ printReaderStats(
             fproc->input_mode_type->print_stats_fn(fproc);
         }
     }
+
+    if (dedupe) {
+        pthread_mutex_lock(&dedupe_mutex);
+        INFOMSG("Dropped %" PRIu64 " duplicate records",
+                skDedupeGetDuplicateCount(dedupe));
+        pthread_mutex_unlock(&dedupe_mutex);
+    }
+}
+
+
+/*
+ *  telemetryReport(telemetry, NULL);
+ *
+ *    Report the metrics for each flow processor and for the
+ *    stream_cache.  Invoked by skTelemetryWrite() on the telemetry
+ *    timer's thread.
+ *
+ *    The counts on the flow processors are read without a lock.  A
+ *    count may be one record behind, which is fine for monitoring.
+ */
+static void
+telemetryReport(
+    sk_telemetry_t     *tel,
+    void        UNUSED(*dummy))
+{
+    skFlowSourceTelemetry_t src;
+    stream_cache_stats_t cache_stats;
+    sk_telemetry_hist_t hist;
+    flow_proc_t *fproc;
+    const char *name;
+    uint64_t lookups = 0;
+    size_t i;
+    size_t s;
+
+    for (i = 0; i < num_flow_processors; ++i) {
+        fproc = &flow_processors[i];
+        /* a processor that handles every probe has no probe; use the
+         * name of its input mode */
+        name = ((fproc->probe)
+                ? skpcProbeGetName(fproc->probe)
+                : fproc->input_mode_type->reader_name);
+        lookups += fproc->rec_write_all;
+
+        skTelemetryAddCounter(tel, "records_total",
+                              "Records read from the flow source",
+                              fproc->rec_total_all, "probe", name, NULL);
+        skTelemetryAddCounter(tel, "duplicate_records_total",
+                              "Records dropped as duplicates",
+                              fproc->rec_dup_all, "probe", name, NULL);
+        skTelemetryAddCounter(tel, "bad_records_total",
+                              "Records that could not be categorized or"
+                              " written",
+                              fproc->rec_bad_all, "probe", name, NULL);
+
+        if (fproc->input_mode_type->telemetry_fn
+            && 0 == fproc->input_mode_type->telemetry_fn(fproc, &src))
+        {
+            skTelemetryAddCounter(tel, "source_packets_total",
+                                  "Packets received by the flow source",
+                                  src.stats.procPkts, "probe", name, NULL);
+            skTelemetryAddCounter(tel, "source_bad_packets_total",
+                                  "Packets rejected by the flow source",
+                                  src.stats.badPkts, "probe", name, NULL);
+            skTelemetryAddCounter(tel, "source_bytes_total",
+                                  "Octets in the packets received by the"
+                                  " flow source",
+                                  src.procBytes, "probe", name, NULL);
+            skTelemetryAddCounter(tel, "source_records_total",
+                                  "Records decoded by the flow source",
+                                  src.stats.goodRecs, "probe", name, NULL);
+            skTelemetryAddCounter(tel, "source_bad_records_total",
+                                  "Records rejected by the flow source",
+                                  src.stats.badRecs, "probe", name, NULL);
+            skTelemetryAddGauge(tel, "source_missing_records",
+                                "Records missing according to the"
+                                " sequence numbers",
+                                (double)src.stats.missingRecs,
+                                "probe", name, NULL);
+            if (src.bufCapacity) {
+                skTelemetryAddGauge(tel, "source_buffer_packets",
+                                    "Packets waiting in the source's buffer",
+                                    (double)src.bufCount,
+                                    "probe", name, NULL);
+                skTelemetryAddGauge(tel, "source_buffer_capacity_packets",
+                                    "Packets the source's buffer holds",
+                                    (double)src.bufCapacity,
+                                    "probe", name, NULL);
+                skTelemetryAddCounter(tel, "source_buffer_full_waits_total",
+                                      "Times the collector waited on a"
+                                      " full buffer",
+                                      src.bufFullWaits, "probe", name, NULL);
+                skTelemetryAddCounter(tel, "source_buffer_empty_waits_total",
+                                      "Times the reader waited on an"
+                                      " empty buffer",
+                                      src.bufEmptyWaits, "probe", name, NULL);
+            }
+        }
+
+        if (fproc->latency) {
+            for (s = 0; s < PACK_STAGE_COUNT; ++s) {
+                if (STAGE_DEDUPE == s && NULL == dedupe) {
+                    continue;
+                }
+                skTelemetryLatencyGet(fproc->latency, s, &hist);
+                if (STAGE_RECEIVE == s && 0 == hist.count) {
+                    continue;
+                }
+                skTelemetryAddHistogram(tel, "stage_latency_seconds",
+                                        "Time spent in each stage of"
+                                        " processing a record",
+                                        &hist, "probe", name,
+                                        "stage", pack_stage_names[s], NULL);
+            }
+        }
+    }
+
+    if (stream_cache) {
+        skCacheGetStats(stream_cache, &cache_stats);
+        skTelemetryAddCounter(tel, "file_cache_lookups_total",
+                              "Lookups of an output file in the file cache",
+                              lookups, NULL);
+        skTelemetryAddCounter(tel, "file_cache_misses_total",
+                              "Lookups that did not find an open file",
+                              cache_stats.misses, NULL);
+        skTelemetryAddCounter(tel, "file_cache_evictions_total",
+                              "Files closed to make room in the file cache",
+                              cache_stats.evicted, NULL);
+        skTelemetryAddCounter(tel, "files_opened_total",
+                              "Output files opened",
+                              cache_stats.added, NULL);
+        skTelemetryAddCounter(tel, "files_closed_total",
+                              "Output files closed",
+                              cache_stats.closed, NULL);
+        skTelemetryAddGauge(tel, "files_open",
+                            "Output files currently open",
+                            (double)cache_stats.size, NULL);
+        skTelemetryAddGauge(tel, "file_cache_size_files",
+                            "Maximum number of open output files",
+                            (double)cache_stats.max_size, NULL);
+    }
+}
+
+
+/*
+ *  status = startTelemetry();
+ *
+ *    Start the thread that writes the telemetry file when the
+ *    --telemetry-file switch was given.  Return 0 on success, or -1
+ *    on failure.
+ */
+static int
+startTelemetry(
+    void)
+{
+    if (NULL == telemetry_path) {
+        return 0;
+    }
+    if (skTelemetryCreate(&telemetry, telemetry_path, telemetry_interval,
+                          "rwflowpack", &telemetryReport, NULL))
+    {
+        ERRMSG("Unable to create the telemetry writer.");
+        return -1;
+    }
+    INFOMSG("Writing telemetry to '%s' every %" PRIu32 " seconds",
+            telemetry_path, telemetry_interval);
+    if (skTelemetryStart(telemetry)) {
+        ERRMSG("Unable to start telemetry timer.");
+        return -1;
+    }
+    return 0;
 }
 
 
@@ -3206,12 +3517,13 @@ openOutputStreamRepo(
 
 
 /*
- *  ok = packRecord(probe, rwrec);
+ *  ok = packRecord(probe, rwrec, fproc);
  *
  *    Given a flow record, 'rwrec', that has been read from 'probe',
  *    determine the flowtype- and sensor-value(s) for that record and
  *    pack it into the correct file(s) using the appropriate file
- *    output format(s).
+ *    output format(s).  Update the write count and, when enabled,
+ *    the stage latencies on the flow processor 'fproc'.
  *
  *    Return 0 on success.  Return -1 to indicate a fatal error.
  *    Return 1 to indicate a non-fatal write error or an error to
@@ -3220,17 +3532,24 @@ openOutputStreamRepo(
 static int
 packRecord(
     const skpc_probe_t *probe,
-    rwRec              *rwrec)
+    rwRec              *rwrec,
+    flow_proc_t        *fproc)
 {
     cache_entry_t *entry;
     cache_key_t key;
     flowtypeID_t ftypes[MAX_SPLIT_FLOWTYPES];
     sensorID_t sensorids[MAX_SPLIT_FLOWTYPES];
+    uint64_t t_start = 0;
+    uint64_t t_end;
     int count;
     int rec_is_bad;
     int i;
     int rv;
 
+    if (fproc->latency) {
+        t_start = skTelemetryNow();
+    }
+
     /* Get the record's sensor(s) and flow_type(s) by calling
      * the packLogicDetermineFlowtype() function */
     count = packlogic.determine_flowtype_fn(probe, rwrec, ftypes, sensorids);
@@ -3256,6 +3575,13 @@ packRecord(
     key.time_stamp = rwRecGetStartTime(rwrec);
     key.time_stamp -= key.time_stamp % 3600000;
 
+    if (fproc->latency) {
+        t_end = skTelemetryNow();
+        skTelemetryLatencyAdd(fproc->latency, STAGE_PACK, t_start, t_end);
+        t_start = t_end;
+    }
+    fproc->rec_write_all += count;
+
     /* Store the record in each flowtype/sensor file. */
     for (i = 0; i < count; ++i) {
         /* The flowtype (class/type) and sensor says where the flow
@@ -3306,10 +3632,39 @@ packRecord(
         skCacheEntryRelease(entry);
     }
 
+    if (fproc->latency) {
+        skTelemetryLatencyAdd(fproc->latency, STAGE_WRITE,
+                              t_start, skTelemetryNow());
+    }
+
     return rec_is_bad;
 }
 
 
+/*
+ *  is_dup = isDuplicateRecord(rwrec);
+ *
+ *    Return 1 if 'rwrec' duplicates a recent record from any probe;
+ *    0 otherwise.  If there is no memory to remember 'rwrec', log an
+ *    error and return 0 so the record is packed.
+ */
+static int
+isDuplicateRecord(
+    const rwRec        *rwrec)
+{
+    int rv;
+
+    pthread_mutex_lock(&dedupe_mutex);
+    rv = skDedupeCheckRecord(dedupe, rwrec);
+    pthread_mutex_unlock(&dedupe_mutex);
+    if (-1 == rv) {
+        ERRMSG("Out of memory storing record to find duplicates");
+        return 0;
+    }
+    return rv;
+}
+
+
 /*
  *  manageProcessor(fproc);
  *
@@ -3328,11 +3683,17 @@ manageProcessor(
     input_mode_type_t *input_mode_type = fproc->input_mode_type;
     rwRec rec;
     const skpc_probe_t *probe;
+    uint64_t t_start = 0;
+    uint64_t t_end;
+    int is_dup;
     int rv;
 
     DEBUGMSG("Started manager thread for %s", input_mode_type->reader_name);
 
     for (;;) {
+        if (fproc->latency) {
+            t_start = skTelemetryNow();
+        }
         /* get the next record that was read by the reader */
         switch (input_mode_type->get_record_fn(&rec, &probe, fproc)) {
           case FP_FILE_BREAK:
@@ -3382,13 +3743,36 @@ manageProcessor(
             /* We got a record and we may NOT stop processing.
              * Process the record. */
             ++fproc->rec_count_total;
-            rv = packRecord(probe, &rec);
+            ++fproc->rec_total_all;
+            if (fproc->latency) {
+                t_end = skTelemetryNow();
+                skTelemetryLatencyAdd(fproc->latency, STAGE_READ,
+                                      t_start, t_end);
+                if (fproc->rec_arrival) {
+                    skTelemetryLatencyAdd(fproc->latency, STAGE_RECEIVE,
+                                          fproc->rec_arrival, t_end);
+                }
+                t_start = t_end;
+            }
+            if (dedupe) {
+                is_dup = isDuplicateRecord(&rec);
+                if (fproc->latency) {
+                    skTelemetryLatencyAdd(fproc->latency, STAGE_DEDUPE,
+                                          t_start, skTelemetryNow());
+                }
+                if (is_dup) {
+                    ++fproc->rec_dup_all;
+                    break;
+                }
+            }
+            rv = packRecord(probe, &rec, fproc);
             if (rv) {
                 if (-1 == rv) {
                     shuttingDown = 1;
                     goto END;
                 }
                 ++fproc->rec_count_bad;
+                ++fproc->rec_bad_all;
             }
             break;
 
@@ -3398,6 +3782,10 @@ manageProcessor(
   END:
     DEBUGMSG("Stopping manager thread for %s", input_mode_type->reader_name);
 
+    if (fproc->latency) {
+        skTelemetryLatencyFlush(fproc->latency);
+    }
+
     /* thread is ending, decrement the count */
     pthread_mutex_lock(&fproc_thread_count_mutex);
     --fproc_thread_count;
@@ -3489,6 +3877,17 @@ startAllProcessors(
         }
     }
 
+    /* Create the recorders of each processor's stage latencies */
+    if (telemetry_path) {
+        for (i = 0; i < num_flow_processors; ++i) {
+            fproc = &flow_processors[i];
+            if (skTelemetryLatencyCreate(&fproc->latency, PACK_STAGE_COUNT)) {
+                ERRMSG("Unable to allocate telemetry histograms");
+                return 1;
+            }
+        }
+    }
+
     reading = 1;
 
     /* Spawn threads to read records from each processor */
@@ -3517,6 +3916,10 @@ startAllProcessors(
         return 1;
     }
 
+    if (startTelemetry()) {
+        return 1;
+    }
+
     return 0;
 }
 
@@ -3552,6 +3955,12 @@ stopAllProcessors(
         }
 
         INFOMSG("Stopped processors.");
+
+        if (telemetry) {
+            /* write the final values */
+            skTelemetryWrite(telemetry);
+            skTelemetryDestroy(&telemetry);
+        }
     }
 }
 
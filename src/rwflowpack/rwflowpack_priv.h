@@ -71,6 +71,7 @@ RCSIDENTVAR(rcsID_RWFLOWPACK_PRIV_H, "$SiLK: rwflowpack_priv.h b7b8edebba12 2015
 #include <silk/rwrec.h>
 #include <silk/sklog.h>
 #include <silk/sksite.h>
+#include <silk/sktelemetry.h>
 #include <silk/skvector.h>
 #include <silk/utils.h>
 #include "rwflow_utils.h"
@@ -211,6 +212,15 @@ struct input_mode_type_st {
      * processed by the flow processor. */
     void      (*print_stats_fn)(flow_proc_t *fproc);
 
+    /* When --telemetry-file is given, rwflowpack periodically calls
+     * telemetry_fn() from another thread to get the cumulative
+     * statistics and the buffer state of the flow processor's
+     * source.  The function should fill 'telemetry' and return 0, or
+     * return -1 when the processor has no source.  This function
+     * pointer may be NULL. */
+    int       (*telemetry_fn)(flow_proc_t              *fproc,
+                              skFlowSourceTelemetry_t  *telemetry);
+
     /* When rwflowpack has been signaled to terminate, it will call
      * the stop_fn() to stop the flow processor.  This function must
      * also unblock a any call to get_record_fn(). */
@@ -237,6 +247,25 @@ struct flow_proc_st {
     /* Number of bad records processed */
     uint64_t            rec_count_bad;
 
+    /* Number of records processed, dropped as duplicates, and not
+     * packed due to an error since the processor was started, and
+     * the number of records written to output files.  Unlike the
+     * counts above, these are never cleared.  They are reported in
+     * the telemetry file. */
+    uint64_t            rec_total_all;
+    uint64_t            rec_dup_all;
+    uint64_t            rec_bad_all;
+    uint64_t            rec_write_all;
+
+    /* When the telemetry file is enabled, the time spent in each
+     * stage of processing a record; NULL otherwise */
+    sk_telemetry_latency_t *latency;
+
+    /* The get_record_fn() sets this to the time the record it
+     * returns arrived at rwflowpack, as returned by skTelemetryNow(),
+     * or to 0 when the time is not known. */
+    uint64_t            rec_arrival;
+
     /* The class of this processor */
     input_mode_type_t      *input_mode_type;
 
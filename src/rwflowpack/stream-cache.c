@@ -92,6 +92,14 @@ struct stream_cache_st {
     int                 size;
     /* maximum number of valid entries */
     int                 max_size;
+    /* number of streams added to the cache, the number of those that
+     * were added by skCacheLookupOrOpenAdd(), the number of streams
+     * closed to make room for a new stream, and the total number of
+     * streams closed.  Modified under the write lock. */
+    uint64_t            added;
+    uint64_t            misses;
+    uint64_t            evicted;
+    uint64_t            closed;
     /* mutex for the cache */
     RWMUTEX             mutex;
 };
@@ -188,7 +196,9 @@ cacheEntryAdd(
         if (cacheEntryDestroyFile(cache, entry, 0)) {
             retval = 1;
         }
+        ++cache->evicted;
     }
+    ++cache->added;
 
     /* fill the new entry */
     entry->key.time_stamp = key->time_stamp;
@@ -337,6 +347,7 @@ cacheEntryDestroyFile(
     }
     skStreamDestroy(&entry->stream);
     rbdelete(entry, cache->rbtree);
+    ++cache->closed;
 
     MUTEX_UNLOCK(&entry->mutex);
 
@@ -705,6 +716,7 @@ skCacheLookupOrOpenAdd(
 #endif  /* SK_HAVE_PTHREAD_RWLOCK */
 
     /* use the callback to open the file */
+    ++cache->misses;
     rwio = cache->open_callback(key, caller_data);
     if (NULL == rwio) {
         retval = -1;
@@ -723,6 +735,26 @@ skCacheLookupOrOpenAdd(
 }
 
 
+/* fill 'stats' with the statistics for the cache */
+void
+skCacheGetStats(
+    stream_cache_t         *cache,
+    stream_cache_stats_t   *stats)
+{
+    assert(cache);
+    assert(stats);
+
+    READ_LOCK(&cache->mutex);
+    stats->added = cache->added;
+    stats->misses = cache->misses;
+    stats->evicted = cache->evicted;
+    stats->closed = cache->closed;
+    stats->size = cache->size;
+    stats->max_size = cache->max_size;
+    RW_MUTEX_UNLOCK(&cache->mutex);
+}
+
+
 /* unlocks a cache locked by skCacheLockAndCloseAll(). */
 void
 skCacheUnlock(
@@ -130,6 +130,27 @@ typedef struct cache_entry_st {
 } cache_entry_t;
 
 
+/*
+ *  The stream_cache_stats_t reports the activity of the cache.  It
+ *  is filled by skCacheGetStats().
+ */
+typedef struct stream_cache_stats_st {
+    /* the number of streams added to the cache */
+    uint64_t        added;
+    /* the number of calls to skCacheLookupOrOpenAdd() that did not
+     * find the stream in the cache */
+    uint64_t        misses;
+    /* the number of streams closed to make room for another */
+    uint64_t        evicted;
+    /* the total number of streams closed */
+    uint64_t        closed;
+    /* the number of streams currently open */
+    int             size;
+    /* the maximum number of streams that may be open */
+    int             max_size;
+} stream_cache_stats_t;
+
+
 /*
  *  rwio = cache_open_fn_t(key, caller_data);
  *
@@ -251,6 +272,18 @@ skCacheFlush(
     stream_cache_t     *cache);
 
 
+/*
+ *  skCacheGetStats(cache, stats);
+ *
+ *    Fill 'stats' with the number of streams the cache has opened
+ *    and closed since it was created and the number it has open.
+ */
+void
+skCacheGetStats(
+    stream_cache_t         *cache,
+    stream_cache_stats_t   *stats);
+
+
 /*
  *  status = skCacheLockAndCloseAll(cache);
  *
@@ -0,0 +1,141 @@
+#! /usr/bin/perl -w
+#
+#
+# RCSIDENT("$SiLK: rwflowpack-pack-pdu-file-telemetry.pl $")
+
+use strict;
+use SiLKTests;
+use File::Find;
+
+my $rwflowpack = check_silk_app('rwflowpack');
+
+# find the apps we need.  this will exit 77 if they're not available
+my $rwcat = check_silk_app('rwcat');
+
+# find the data files we use as sources, or exit 77
+my %file;
+$file{pdu} = get_data_or_exit77('pdu_small');
+
+# prefix any existing PYTHONPATH with the proper directories
+check_python_bin();
+
+# set the environment variables required for rwflowpack to find its
+# packing logic plug-in
+add_plugin_dirs('/site/twoway');
+
+# Skip this test if we cannot load the packing logic
+check_exit_status("$rwflowpack --sensor-conf=$srcdir/tests/sensor77.conf"
+                  ." --verify-sensor-conf")
+    or skip_test("Cannot load packing logic");
+
+# create our tempdir
+my $tmpdir = make_tempdir();
+
+# Generate the sensor.conf file
+my $sensor_conf = "$tmpdir/sensor-templ.conf";
+make_packer_sensor_conf($sensor_conf, 'netflow-v5', 0, 'file');
+
+# create a copy of the PDU input file
+my $pdus = File::Temp::mktemp("$tmpdir/pdu.XXXXXX");
+system "cp", $file{pdu}, $pdus;
+
+# the file of performance metrics
+my $telemetry = "$tmpdir/rwflowpack.prom";
+
+# the command that wraps rwflowpack
+my $cmd = join " ", ("$SiLKTests::PYTHON $srcdir/tests/rwflowpack-daemon.py",
+                     ($ENV{SK_TESTS_VERBOSE} ? "--verbose" : ()),
+                     ($ENV{SK_TESTS_LOG_DEBUG} ? "--log-level=debug" : ()),
+                     "--sensor-conf=$sensor_conf",
+                     "--basedir=$tmpdir",
+                     "--",
+                     "--input-mode=pdufile",
+                     "--sensor-name=S0",
+                     "--netflow-file=$pdus",
+                     "--telemetry-file=$telemetry",
+    );
+
+# run it and check the MD5 hash of its output; the telemetry file
+# must not change the packed records
+check_md5_output('dba69618fe40eafc6a1dca7d888db2b0', $cmd);
+
+# the following directories should be empty
+verify_empty_dirs($tmpdir, qw(error incoming incremental sender));
+
+# path to the data directory
+my $data_dir = "$tmpdir/root";
+die "ERROR: Missing data directory '$data_dir'\n"
+    unless -d $data_dir;
+
+# count the packed files; the MD5 sums are checked by
+# rwflowpack-pack-pdu-file.pl
+my $file_count = 0;
+File::Find::find({wanted => sub { ++$file_count if -f $_ }, no_chdir => 1},
+                 $data_dir);
+
+# read the metrics, making certain every metric has a type
+my %value;
+my %type;
+open F, $telemetry
+    or die "ERROR: Cannot open $telemetry: $!\n";
+while (my $line = <F>) {
+    chomp $line;
+    if ($line =~ /^# TYPE (\S+) (counter|gauge|histogram)$/) {
+        $type{$1} = $2;
+    }
+    elsif ($line =~ /^#/) {
+        next;
+    }
+    elsif ($line =~ /^(rwflowpack_\w+)(\{[^}]*\})? (\S+)$/) {
+        my ($name, $labels, $val) = ($1, ($2 || '{}'), $3);
+        (my $family = $name) =~ s/_(bucket|sum|count)$//;
+        die "ERROR: Metric $name has no TYPE\n"
+            unless $type{$name} || $type{$family};
+        $value{$name.$labels} = $val;
+    }
+    else {
+        die "ERROR: Unexpected line in telemetry file: '$line'\n";
+    }
+}
+close F;
+
+# every 1464-byte block of the input is a packet
+my $pkts = (-s $file{pdu}) / 1464;
+my $probe = '{probe="P0"}';
+my %expect = (
+    "rwflowpack_source_packets_total$probe" => $pkts,
+    "rwflowpack_source_bad_packets_total$probe" => 0,
+    "rwflowpack_source_bytes_total$probe" => 1464 * $pkts,
+    "rwflowpack_bad_records_total$probe" => 0,
+    "rwflowpack_duplicate_records_total$probe" => 0,
+    "rwflowpack_files_opened_total{}" => $file_count,
+    );
+for my $k (sort keys %expect) {
+    die "ERROR: Missing metric $k\n"
+        unless defined $value{$k};
+    die "ERROR: Metric $k is $value{$k}; expected $expect{$k}\n"
+        unless $value{$k} == $expect{$k};
+}
+
+# each record read is timed in the read, pack, and write stages; the
+# receive time is not known when reading from a file
+my $recs = $value{"rwflowpack_records_total$probe"};
+die "ERROR: Read $recs records; source decoded "
+    .$value{"rwflowpack_source_records_total$probe"}."\n"
+    unless $recs && $recs == $value{"rwflowpack_source_records_total$probe"};
+for my $stage (qw(read pack write)) {
+    my $k = "rwflowpack_stage_latency_seconds_count"
+        .qq({probe="P0",stage="$stage"});
+    die "ERROR: Stage $stage has ".($value{$k} // 'no')." records;"
+        ." expected $recs\n"
+        unless defined $value{$k} && $value{$k} == $recs;
+    my $inf = "rwflowpack_stage_latency_seconds_bucket"
+        .qq({probe="P0",stage="$stage",le="+Inf"});
+    die "ERROR: Stage $stage has bad +Inf bucket\n"
+        unless defined $value{$inf} && $value{$inf} == $recs;
+}
+die "ERROR: Unexpected receive stage\n"
+    if grep /stage="receive"/, keys %value;
+
+# successful!
+exit 0;
@@ -72,6 +72,7 @@ RCSIDENT("$SiLK: rwipfix2silk.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 #include <silk/skstream.h>
 #include <silk/skstringmap.h>
 #include <silk/utils.h>
+#include "rwipfixpipeline.h"
 
 
 /* LOCAL DEFINES AND TYPEDEFS */
@@ -100,6 +101,9 @@ static char log_destination[PATH_MAX];
 /* whether to print statistics (--print-statistics) */
 static int print_statistics = 0;
 
+/* whether to print the rate of each stage (--benchmark) */
+static int benchmark = 0;
+
 /* whether to decode vlan values (--interface-values) */
 static int decode_vlan = 0;
 
@@ -111,12 +115,18 @@ static sk_compmethod_t comp_method;
 /* required to process the IPFIX records */
 static skpc_probe_t *probe;
 
+/* the IPFIX file currently being read, and whether all the inputs
+ * have been read */
+static skIPFIXSource_t *ipfix_src = NULL;
+static int input_done = 0;
+
 
 /* OPTIONS SETUP */
 
 typedef enum {
     OPT_SILK_OUTPUT,
     OPT_PRINT_STATISTICS,
+    OPT_BENCHMARK,
     OPT_INTERFACE_VALUES,
     OPT_LOG_DESTINATION
 } appOptionsEnum;
@@ -124,6 +134,7 @@ typedef enum {
 static struct option appOptions[] = {
     {"silk-output",             REQUIRED_ARG, 0, OPT_SILK_OUTPUT},
     {"print-statistics",        NO_ARG,       0, OPT_PRINT_STATISTICS},
+    {"benchmark",               NO_ARG,       0, OPT_BENCHMARK},
     {"interface-values",        REQUIRED_ARG, 0, OPT_INTERFACE_VALUES},
     {"log-destination",         REQUIRED_ARG, 0, OPT_LOG_DESTINATION},
     {0,0,0,0}                   /* sentinel entry */
@@ -132,6 +143,8 @@ static struct option appOptions[] = {
 static const char *appHelp[] = {
     ("Write the SiLK Flow records to the specified path.\n\tDef. stdout"),
     "Print the number of records written. Def. No.",
+    ("Print the number of records each stage of the conversion\n"
+     "\thandled and its records per second to the standard error. Def. No"),
     ("Specify value to store in 'input' and 'output'\n"
      "\tfields.  Def. snmp.  Choices: snmp, vlan"),
     ("Write messages about number of records read from each\n"
@@ -197,6 +210,11 @@ appTeardown(
     }
     teardownFlag = 1;
 
+    if (ipfix_src) {
+        skIPFIXSourceDestroy(ipfix_src);
+        ipfix_src = NULL;
+    }
+
     /* close SiLK flow output file */
     if (silk_output) {
         rv = skStreamClose(silk_output);
@@ -381,6 +399,10 @@ appOptionsHandler(
         print_statistics = 1;
         break;
 
+      case OPT_BENCHMARK:
+        benchmark = 1;
+        break;
+
       case OPT_INTERFACE_VALUES:
         if (parseInterfaceValue(opt_arg)) {
             return 1;
@@ -508,23 +530,18 @@ logprefix(
 
 
 /*
- *  count = ipfix2silk(filename);
+ *  status = openIpfixSource(filename);
  *
- *    Read IPFIX records from 'filename' and write records to the
- *    global 'silk_output' file.  Return number of records processed,
- *    or -1 on error.
+ *    Create the global 'ipfix_src' to read IPFIX records from
+ *    'filename'.  Return 0 on success or -1 on error.
  */
-static int64_t
-ipfix2silk(
+static int
+openIpfixSource(
     const char         *filename)
 {
     static unsigned int file_count = 0;
     char probe_name[128];
-    skIPFIXSource_t *ipfix_src;
     skFlowSourceParams_t params;
-    int64_t count;
-    rwRec rwrec;
-    int rv;
 
     ++file_count;
     snprintf(probe_name, sizeof(probe_name), "input%04u", file_count);
@@ -535,55 +552,108 @@ ipfix2silk(
     if (ipfix_src == NULL) {
         return -1;
     }
+    return 0;
+}
+
+
+/*
+ *  status = readIpfixBatch(batch, ctx);
+ *
+ *    Pipeline read callback.  Fill 'batch' with records from the
+ *    IPFIX inputs, moving to the next input as each is exhausted.
+ *    Leave the batch empty once every input has been read.  Return
+ *    -1 if an input cannot be opened.
+ *
+ *    libfixbuf decodes and libflowsource converts each record in a
+ *    single call, so this stage does all the IPFIX work; the writer
+ *    packs and compresses the SiLK records in parallel with it.
+ */
+static int
+readIpfixBatch(
+    rwipfix_batch_t    *batch,
+    void        UNUSED(*ctx))
+{
+    char *path;
+    rwRec *rwrec;
+    int rv;
 
-    count = 0;
-    while (-1 != skIPFIXSourceGetGeneric(ipfix_src, &rwrec)) {
+    while (batch->count < batch->capacity && !input_done) {
+        if (NULL == ipfix_src) {
+            rv = skOptionsCtxNextArgument(optctx, &path);
+            if (rv) {
+                input_done = 1;
+                return ((rv < 0) ? -1 : 0);
+            }
+            if (openIpfixSource(path)) {
+                return -1;
+            }
+        }
+        rwrec = &batch->recs[batch->count];
+        if (-1 == skIPFIXSourceGetGeneric(ipfix_src, rwrec)) {
+            skIPFIXSourceLogStatsAndClear(ipfix_src);
+            skIPFIXSourceDestroy(ipfix_src);
+            ipfix_src = NULL;
+            continue;
+        }
         /* remove any firewallEvent, NF_F_FW_EVENT, NF_F_FW_EXT_EVENT
          * value stored by libflowsource */
-        rwRecSetMemo(&rwrec, 0);
-        ++count;
-        rv = skStreamWriteRecord(silk_output, &rwrec);
+        rwRecSetMemo(rwrec, 0);
+        ++batch->count;
+    }
+
+    return 0;
+}
+
+
+/*
+ *  status = writeSilkBatch(batch, ctx);
+ *
+ *    Pipeline write callback.  Write the records in 'batch' to the
+ *    global 'silk_output' file.  Return -1 on a fatal write error.
+ */
+static int
+writeSilkBatch(
+    rwipfix_batch_t    *batch,
+    void        UNUSED(*ctx))
+{
+    size_t i;
+    int rv;
+
+    for (i = 0; i < batch->count; ++i) {
+        rv = skStreamWriteRecord(silk_output, &batch->recs[i]);
         if (rv) {
             skStreamPrintLastErr(silk_output, rv, &skAppPrintErr);
             if (SKSTREAM_ERROR_IS_FATAL(rv)) {
-                exit(EXIT_FAILURE);
+                return -1;
             }
         }
     }
-
-    skIPFIXSourceLogStatsAndClear(ipfix_src);
-    skIPFIXSourceDestroy(ipfix_src);
-
-    return count;
+    return 0;
 }
 
 
 int main(int argc, char **argv)
 {
-    char *path;
-    int64_t total_count;
-    int64_t count;
-    int rv;
+    rwipfix_pipeline_t pipeline;
 
     appSetup(argc, argv);       /* never returns on failure */
 
-    total_count = 0;
-
-    /* process each file on the command line */
-    while ((rv = skOptionsCtxNextArgument(optctx, &path)) == 0) {
-        count = ipfix2silk(path);
-        if (count < 0) {
-            exit(EXIT_FAILURE);
-        }
-        total_count += count;
-    }
-    if (rv < 0) {
+    /* read and convert the IPFIX records on one thread while this
+     * thread writes them */
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.read_fn = &readIpfixBatch;
+    pipeline.write_fn = &writeSilkBatch;
+    if (rwipfixPipelineRun(&pipeline)) {
         exit(EXIT_FAILURE);
     }
 
     if (print_statistics) {
         fprintf(STATS_FH, ("%s: Wrote %" PRIu64 " records to '%s'\n"),
-                skAppName(), total_count, skStreamGetPathname(silk_output));
+                skAppName(), pipeline.stats[RWIPFIX_STAGE_WRITE].records,
+                skStreamGetPathname(silk_output));
+    }
+    if (benchmark) {
+        rwipfixPipelinePrintStats(&pipeline, STATS_FH);
     }
 
     return 0;
@@ -0,0 +1,455 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  rwipfixpipeline.c
+**
+**    A batched conversion pipeline shared by rwsilk2ipfix and
+**    rwipfix2silk.  See rwipfixpipeline.h for details.
+*/
+
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: rwipfixpipeline.c $");
+
+#include <silk/utils.h>
+#include "rwipfixpipeline.h"
+
+
+/* LOCAL DEFINES AND TYPEDEFS */
+
+/* where a batch is in the pipeline */
+typedef enum {
+    /* available to the reader */
+    SLOT_EMPTY,
+    /* filled by the reader; waiting for a worker */
+    SLOT_READ,
+    /* converted, or read when there are no workers; waiting for the
+     * writer */
+    SLOT_READY
+} slot_state_t;
+
+typedef struct pipe_slot_st {
+    rwipfix_batch_t     batch;
+    slot_state_t        state;
+} pipe_slot_t;
+
+/* the state shared by the threads of a running pipeline */
+typedef struct pipe_state_st {
+    rwipfix_pipeline_t *pipeline;
+    pipe_slot_t        *slot;
+    size_t              slot_count;
+    /* sequence number of the next batch to read; once 'eof' is set,
+     * this is the number of batches */
+    uint64_t            next_read;
+    /* sequence number of the next batch to convert */
+    uint64_t            next_convert;
+    /* set once the reader has seen the end of the input */
+    unsigned            eof     :1;
+    /* set when any callback fails */
+    unsigned            stop    :1;
+    pthread_mutex_t     mutex;
+    pthread_cond_t      cond;
+} pipe_state_t;
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  seconds = pipeNow();
+ *
+ *    Return the current time as a number of seconds.
+ */
+static double
+pipeNow(
+    void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1.0e6;
+}
+
+
+/*
+ *    THREAD ENTRY POINT
+ *
+ *    Fill the batches in sequence with the pipeline's read_fn until
+ *    it returns an empty batch.
+ */
+static void *
+pipeReader(
+    void               *v_state)
+{
+    pipe_state_t *state = (pipe_state_t *)v_state;
+    rwipfix_pipeline_t *pipeline = state->pipeline;
+    rwipfix_stage_stats_t *stats = &pipeline->stats[RWIPFIX_STAGE_READ];
+    pipe_slot_t *slot;
+    double start;
+    int rv;
+
+    pthread_mutex_lock(&state->mutex);
+    while (!state->stop) {
+        slot = &state->slot[state->next_read % state->slot_count];
+        if (SLOT_EMPTY != slot->state) {
+            pthread_cond_wait(&state->cond, &state->mutex);
+            continue;
+        }
+        pthread_mutex_unlock(&state->mutex);
+
+        slot->batch.count = 0;
+        start = pipeNow();
+        rv = pipeline->read_fn(&slot->batch, pipeline->ctx);
+        stats->busy += pipeNow() - start;
+
+        pthread_mutex_lock(&state->mutex);
+        if (rv) {
+            state->stop = 1;
+        } else if (0 == slot->batch.count) {
+            state->eof = 1;
+        } else {
+            stats->records += slot->batch.count;
+            slot->state = ((pipeline->convert_fn) ? SLOT_READ : SLOT_READY);
+            ++state->next_read;
+        }
+        pthread_cond_broadcast(&state->cond);
+        if (state->eof) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&state->mutex);
+
+    return NULL;
+}
+
+
+/*
+ *    THREAD ENTRY POINT
+ *
+ *    Convert batches with the pipeline's convert_fn as the reader
+ *    fills them.  Any number of these threads may run.
+ */
+static void *
+pipeWorker(
+    void               *v_state)
+{
+    pipe_state_t *state = (pipe_state_t *)v_state;
+    rwipfix_pipeline_t *pipeline = state->pipeline;
+    rwipfix_stage_stats_t *stats = &pipeline->stats[RWIPFIX_STAGE_CONVERT];
+    pipe_slot_t *slot;
+    double busy;
+    int rv;
+
+    pthread_mutex_lock(&state->mutex);
+    for (;;) {
+        while (!state->stop && !state->eof
+               && state->next_convert == state->next_read)
+        {
+            pthread_cond_wait(&state->cond, &state->mutex);
+        }
+        if (state->stop || state->next_convert == state->next_read) {
+            break;
+        }
+        /* claim the batch; the reader cannot reuse its slot until the
+         * writer has consumed it, so no lock is needed to convert */
+        slot = &state->slot[state->next_convert % state->slot_count];
+        ++state->next_convert;
+        pthread_mutex_unlock(&state->mutex);
+
+        busy = pipeNow();
+        rv = pipeline->convert_fn(&slot->batch, pipeline->ctx);
+        busy = pipeNow() - busy;
+
+        pthread_mutex_lock(&state->mutex);
+        stats->busy += busy;
+        if (rv) {
+            state->stop = 1;
+        } else {
+            stats->records += slot->batch.count;
+            slot->state = SLOT_READY;
+        }
+        pthread_cond_broadcast(&state->cond);
+    }
+    pthread_mutex_unlock(&state->mutex);
+
+    return NULL;
+}
+
+
+/*
+ *  status = pipeWriter(state);
+ *
+ *    Write the batches in the order they were read with the
+ *    pipeline's write_fn.  Return 0 once every batch has been
+ *    written, or -1 if the pipeline was stopped.
+ */
+static int
+pipeWriter(
+    pipe_state_t       *state)
+{
+    rwipfix_pipeline_t *pipeline = state->pipeline;
+    rwipfix_stage_stats_t *stats = &pipeline->stats[RWIPFIX_STAGE_WRITE];
+    pipe_slot_t *slot;
+    uint64_t seq;
+    double start;
+    int done;
+    int rv = 0;
+
+    for (seq = 0; ; ++seq) {
+        slot = &state->slot[seq % state->slot_count];
+
+        pthread_mutex_lock(&state->mutex);
+        while (!state->stop && SLOT_READY != slot->state
+               && !(state->eof && seq == state->next_read))
+        {
+            pthread_cond_wait(&state->cond, &state->mutex);
+        }
+        if (state->stop) {
+            rv = -1;
+        }
+        done = (SLOT_READY != slot->state);
+        pthread_mutex_unlock(&state->mutex);
+        if (done) {
+            break;
+        }
+
+        start = pipeNow();
+        rv = pipeline->write_fn(&slot->batch, pipeline->ctx);
+        stats->busy += pipeNow() - start;
+
+        pthread_mutex_lock(&state->mutex);
+        if (rv) {
+            state->stop = 1;
+            rv = -1;
+        } else {
+            stats->records += slot->batch.count;
+            slot->state = SLOT_EMPTY;
+        }
+        pthread_cond_broadcast(&state->cond);
+        pthread_mutex_unlock(&state->mutex);
+        if (rv) {
+            break;
+        }
+    }
+
+    return rv;
+}
+
+
+/*
+ *  status = rwipfixPipelineRun(pipeline);
+ *
+ *    Run 'pipeline'.  See header for details.
+ */
+int
+rwipfixPipelineRun(
+    rwipfix_pipeline_t *pipeline)
+{
+    pipe_state_t state;
+    pthread_t reader;
+    pthread_t *workers = NULL;
+    uint32_t worker_count;
+    uint32_t started = 0;
+    double start;
+    size_t i;
+    int rv = -1;
+
+    assert(pipeline);
+    assert(pipeline->read_fn);
+    assert(pipeline->write_fn);
+
+    start = pipeNow();
+    memset(pipeline->stats, 0, sizeof(pipeline->stats));
+    pipeline->elapsed = 0.0;
+    if (0 == pipeline->batch_size) {
+        pipeline->batch_size = RWIPFIX_BATCH_SIZE;
+    }
+
+    worker_count = 0;
+    if (pipeline->convert_fn) {
+        worker_count = ((pipeline->worker_count) ? pipeline->worker_count : 1);
+    }
+    pipeline->stats[RWIPFIX_STAGE_READ].threads = 1;
+    pipeline->stats[RWIPFIX_STAGE_CONVERT].threads = worker_count;
+    pipeline->stats[RWIPFIX_STAGE_WRITE].threads = 1;
+
+    memset(&state, 0, sizeof(state));
+    state.pipeline = pipeline;
+    pthread_mutex_init(&state.mutex, NULL);
+    pthread_cond_init(&state.cond, NULL);
+
+    /* give every worker two batches so a slow batch does not stall
+     * the others, plus one each for the reader and writer */
+    state.slot_count = 2 * worker_count + 2;
+    state.slot = (pipe_slot_t *)calloc(state.slot_count, sizeof(pipe_slot_t));
+    if (NULL == state.slot) {
+        skAppPrintOutOfMemory("pipeline batches");
+        goto END;
+    }
+    for (i = 0; i < state.slot_count; ++i) {
+        state.slot[i].batch.capacity = pipeline->batch_size;
+        state.slot[i].batch.recs
+            = (rwRec *)malloc(pipeline->batch_size * sizeof(rwRec));
+        if (NULL == state.slot[i].batch.recs) {
+            skAppPrintOutOfMemory("pipeline records");
+            goto END;
+        }
+        if (pipeline->data_size) {
+            state.slot[i].batch.data
+                = malloc(pipeline->batch_size * pipeline->data_size);
+            if (NULL == state.slot[i].batch.data) {
+                skAppPrintOutOfMemory("pipeline records");
+                goto END;
+            }
+        }
+    }
+
+    if (worker_count) {
+        workers = (pthread_t *)calloc(worker_count, sizeof(pthread_t));
+        if (NULL == workers) {
+            skAppPrintOutOfMemory("thread handles");
+            goto END;
+        }
+    }
+
+    /* start the threads */
+    if (pthread_create(&reader, NULL, &pipeReader, &state)) {
+        skAppPrintErr("Unable to create reader thread");
+        goto END;
+    }
+    for (started = 0; started < worker_count; ++started) {
+        if (pthread_create(&workers[started], NULL, &pipeWorker, &state)) {
+            skAppPrintErr("Unable to create conversion thread");
+            pthread_mutex_lock(&state.mutex);
+            state.stop = 1;
+            pthread_cond_broadcast(&state.cond);
+            pthread_mutex_unlock(&state.mutex);
+            break;
+        }
+    }
+
+    rv = pipeWriter(&state);
+
+    pthread_join(reader, NULL);
+    for (i = 0; i < started; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+
+  END:
+    if (state.slot) {
+        for (i = 0; i < state.slot_count; ++i) {
+            free(state.slot[i].batch.recs);
+            free(state.slot[i].batch.data);
+        }
+        free(state.slot);
+    }
+    free(workers);
+    pthread_mutex_destroy(&state.mutex);
+    pthread_cond_destroy(&state.cond);
+
+    pipeline->elapsed = pipeNow() - start;
+    return rv;
+}
+
+
+/*
+ *  rwipfixPipelinePrintStats(pipeline, fh);
+ *
+ *    Print the statistics for 'pipeline'.  See header for details.
+ */
+void
+rwipfixPipelinePrintStats(
+    const rwipfix_pipeline_t   *pipeline,
+    FILE                       *fh)
+{
+    static const char *stage_name[RWIPFIX_STAGE_COUNT] = {
+        "read", "convert", "write"
+    };
+    const rwipfix_stage_stats_t *stats;
+    double rate;
+    unsigned int i;
+
+    for (i = 0; i < RWIPFIX_STAGE_COUNT; ++i) {
+        stats = &pipeline->stats[i];
+        if (0 == stats->threads) {
+            continue;
+        }
+        /* the rate the stage would sustain if it were never starved
+         * or blocked by its neighbors */
+        rate = ((stats->busy > 0.0)
+                ? (double)stats->records * stats->threads / stats->busy
+                : 0.0);
+        fprintf(fh, ("%s: %7s: %" PRIu64 " records in %.3f busy seconds"
+                     " on %" PRIu32 " thread%s; %.0f records/second\n"),
+                skAppName(), stage_name[i], stats->records, stats->busy,
+                stats->threads, ((1 == stats->threads) ? "" : "s"), rate);
+    }
+    rate = ((pipeline->elapsed > 0.0)
+            ? (double)pipeline->stats[RWIPFIX_STAGE_WRITE].records
+              / pipeline->elapsed
+            : 0.0);
+    fprintf(fh, ("%s: %7s: %" PRIu64 " records in %.3f seconds;"
+                 " %.0f records/second\n"),
+            skAppName(), "total",
+            pipeline->stats[RWIPFIX_STAGE_WRITE].records,
+            pipeline->elapsed, rate);
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -0,0 +1,193 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+#ifndef _RWIPFIXPIPELINE_H
+#define _RWIPFIXPIPELINE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <silk/silk.h>
+
+RCSIDENTVAR(rcsID_RWIPFIXPIPELINE_H, "$SiLK: rwipfixpipeline.h $");
+
+#include <silk/rwrec.h>
+
+
+/*
+**  rwipfixpipeline.h
+**
+**    A batched conversion pipeline shared by rwsilk2ipfix and
+**    rwipfix2silk.
+**
+**    The pipeline has three stages.  A reader thread fills batches
+**    of records; an optional pool of worker threads converts the
+**    batches; and the thread that calls rwipfixPipelineRun() writes
+**    the batches in the order they were read.  A fixed ring of
+**    batches connects the stages, so a slow stage blocks the stages
+**    in front of it instead of letting memory grow.
+**
+**    The time each stage spends in its callback is recorded so that
+**    the applications may report where the time goes.
+*/
+
+
+/* the default number of records in a batch */
+#define RWIPFIX_BATCH_SIZE  4096
+
+/* the stages of the pipeline, used to index the statistics */
+typedef enum {
+    RWIPFIX_STAGE_READ,
+    RWIPFIX_STAGE_CONVERT,
+    RWIPFIX_STAGE_WRITE
+} rwipfix_stage_t;
+
+#define RWIPFIX_STAGE_COUNT  3
+
+
+/*
+ *    A batch of records moving through the pipeline.  'recs' holds
+ *    'capacity' SiLK Flow records.  When the pipeline was given a
+ *    non-zero 'data_size', 'data' holds 'capacity' items of that
+ *    many octets each; otherwise it is NULL.  The reader sets
+ *    'count'; the pipeline treats a count of 0 as end of input.
+ */
+typedef struct rwipfix_batch_st {
+    rwRec              *recs;
+    void               *data;
+    size_t              capacity;
+    size_t              count;
+} rwipfix_batch_t;
+
+/*
+ *    The signature of a stage callback.  The callback is given the
+ *    batch to operate on and the 'ctx' member of the pipeline.  It
+ *    must return 0 on success; on failure it should report the
+ *    error and return non-zero, which stops the pipeline.
+ */
+typedef int (*rwipfix_stage_fn_t)(
+    rwipfix_batch_t    *batch,
+    void               *ctx);
+
+/*
+ *    Statistics for one stage.  'busy' is the number of seconds
+ *    spent in the stage's callback summed across the stage's
+ *    'threads'.
+ */
+typedef struct rwipfix_stage_stats_st {
+    uint64_t            records;
+    double              busy;
+    uint32_t            threads;
+} rwipfix_stage_stats_t;
+
+/*
+ *    The description of a pipeline.  The caller fills in the
+ *    callbacks and sizes; rwipfixPipelineRun() fills in 'stats' and
+ *    'elapsed'.
+ */
+typedef struct rwipfix_pipeline_st {
+    /* fills the batch; called on the reader thread */
+    rwipfix_stage_fn_t      read_fn;
+    /* converts the batch; called on the worker threads, possibly
+     * concurrently with itself.  May be NULL, in which case batches
+     * pass directly from the reader to the writer */
+    rwipfix_stage_fn_t      convert_fn;
+    /* writes the batch; called on the calling thread in the order
+     * the batches were read */
+    rwipfix_stage_fn_t      write_fn;
+    /* passed to each callback */
+    void                   *ctx;
+    /* number of records per batch; 0 means RWIPFIX_BATCH_SIZE */
+    size_t                  batch_size;
+    /* octets per record in each batch's 'data' array; may be 0 */
+    size_t                  data_size;
+    /* number of threads that run 'convert_fn' */
+    uint32_t                worker_count;
+    /* results */
+    rwipfix_stage_stats_t   stats[RWIPFIX_STAGE_COUNT];
+    double                  elapsed;
+} rwipfix_pipeline_t;
+
+
+/*
+ *  status = rwipfixPipelineRun(pipeline);
+ *
+ *    Run 'pipeline' until its read_fn produces an empty batch or
+ *    until a callback fails.  Return 0 on success, or -1 if a
+ *    callback failed or the pipeline could not be started.
+ */
+int
+rwipfixPipelineRun(
+    rwipfix_pipeline_t *pipeline);
+
+/*
+ *  rwipfixPipelinePrintStats(pipeline, fh);
+ *
+ *    Print the number of records each stage of 'pipeline' handled
+ *    and the rate at which it handled them to 'fh'.
+ */
+void
+rwipfixPipelinePrintStats(
+    const rwipfix_pipeline_t   *pipeline,
+    FILE                       *fh);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _RWIPFIXPIPELINE_H */
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -68,6 +68,7 @@ RCSIDENT("$SiLK: rwsilk2ipfix.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 #include <silk/sksite.h>
 #include <silk/skstream.h>
 #include <silk/utils.h>
+#include "rwipfixpipeline.h"
 
 
 /* LOCAL DEFINES AND TYPEDEFS */
@@ -78,6 +79,9 @@ RCSIDENT("$SiLK: rwsilk2ipfix.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 /* where to write --print-stat output */
 #define STATS_FH stderr
 
+/* environment variable that specifies the number of threads */
+#define RWS2I_THREADS_ENVAR  "SILK_RWSILK2IPFIX_THREADS"
+
 
 /* LOCAL VARIABLE DEFINITIONS */
 
@@ -90,23 +94,45 @@ static sk_fileptr_t ipfix_output;
 /* whether to print statistics */
 static int print_statistics = 0;
 
+/* whether to print the rate of each stage (--benchmark) */
+static int benchmark = 0;
+
+/* number of threads that convert records (--threads) */
+static uint32_t thread_count = 1;
+
+/* the IPFIX buffer the records are appended to */
+static fBuf_t *fbuf = NULL;
+
+/* the SiLK file currently being read, and whether all the inputs
+ * have been read */
+static skstream_t *rwios = NULL;
+static int input_done = 0;
+
 
 /* OPTIONS SETUP */
 
 typedef enum {
     OPT_IPFIX_OUTPUT,
-    OPT_PRINT_STATISTICS
+    OPT_PRINT_STATISTICS,
+    OPT_BENCHMARK,
+    OPT_THREADS
 } appOptionsEnum;
 
 static struct option appOptions[] = {
     {"ipfix-output",            REQUIRED_ARG, 0, OPT_IPFIX_OUTPUT},
     {"print-statistics",        NO_ARG,       0, OPT_PRINT_STATISTICS},
+    {"benchmark",               NO_ARG,       0, OPT_BENCHMARK},
+    {"threads",                 REQUIRED_ARG, 0, OPT_THREADS},
     {0,0,0,0}                   /* sentinel entry */
 };
 
 static const char *appHelp[] = {
     ("Write IPFIX records to the specified path. Def. stdout"),
     ("Print the count of processed records. Def. No"),
+    ("Print the number of records each stage of the conversion\n"
+     "\thandled and its records per second to the standard error. Def. No"),
+    ("Convert records to IPFIX using this many threads.\n"
+     "\tDef. $" RWS2I_THREADS_ENVAR " or 1"),
     (char *)NULL
 };
 
@@ -164,6 +190,7 @@ appTeardown(
     }
     teardownFlag = 1;
 
+    skStreamDestroy(&rwios);
     if (ipfix_output.of_fp) {
         skFileptrClose(&ipfix_output, &skAppPrintErr);
     }
@@ -191,6 +218,8 @@ appSetup(
 {
     SILK_FEATURES_DEFINE_STRUCT(features);
     int optctx_flags;
+    const char *env;
+    uint32_t tc;
     int rv;
 
     /* verify same number of options and help strings */
@@ -222,6 +251,14 @@ appSetup(
         exit(EXIT_FAILURE);
     }
 
+    /* check the thread count envar */
+    env = getenv(RWS2I_THREADS_ENVAR);
+    if (env && env[0]) {
+        if (skStringParseUint32(&tc, env, 1, 0) == 0) {
+            thread_count = tc;
+        }
+    }
+
     /* parse the options */
     rv = skOptionsCtxOptionsParse(optctx, argc, argv);
     if (rv < 0) {
@@ -259,6 +296,8 @@ appOptionsHandler(
     int                 opt_index,
     char               *opt_arg)
 {
+    int rv;
+
     switch ((appOptionsEnum)opt_index) {
       case OPT_IPFIX_OUTPUT:
         if (ipfix_output.of_name) {
@@ -272,19 +311,118 @@ appOptionsHandler(
       case OPT_PRINT_STATISTICS:
         print_statistics = 1;
         break;
+
+      case OPT_BENCHMARK:
+        benchmark = 1;
+        break;
+
+      case OPT_THREADS:
+        rv = skStringParseUint32(&thread_count, opt_arg, 1, 0);
+        if (rv) {
+            skAppPrintErr("Invalid %s '%s': %s",
+                          appOptions[opt_index].name, opt_arg,
+                          skStringParseStrerror(rv));
+            return 1;
+        }
+        break;
     }
 
     return 0;  /* OK */
 }
 
 
+/*
+ *  status = readSilkBatch(batch, ctx);
+ *
+ *    Pipeline read callback.  Fill 'batch' with records from the
+ *    SiLK input files, moving to the next file as each is
+ *    exhausted.  Leave the batch empty once every file has been
+ *    read.
+ */
+static int
+readSilkBatch(
+    rwipfix_batch_t    *batch,
+    void        UNUSED(*ctx))
+{
+    int rv;
+
+    while (batch->count < batch->capacity && !input_done) {
+        if (NULL == rwios) {
+            if (skOptionsCtxNextSilkFile(optctx, &rwios, &skAppPrintErr)) {
+                input_done = 1;
+                break;
+            }
+        }
+        rv = skStreamReadRecord(rwios, &batch->recs[batch->count]);
+        if (SKSTREAM_OK == rv) {
+            ++batch->count;
+            continue;
+        }
+        if (rv != SKSTREAM_ERR_EOF) {
+            skStreamPrintLastErr(rwios, rv, &skAppPrintErr);
+        }
+        skStreamDestroy(&rwios);
+    }
+
+    return 0;
+}
+
+
+/*
+ *  status = convertBatch(batch, ctx);
+ *
+ *    Pipeline conversion callback.  Convert each SiLK record in
+ *    'batch' to an IPFIX record in the batch's data array.  This
+ *    uses no fixbuf state, so several threads may run it at once.
+ */
+static int
+convertBatch(
+    rwipfix_batch_t    *batch,
+    void        UNUSED(*ctx))
+{
+    const size_t fixrec_size = skiRwFixrecSize();
+    uint8_t *fixrec = (uint8_t *)batch->data;
+    size_t i;
+
+    for (i = 0; i < batch->count; ++i, fixrec += fixrec_size) {
+        skiRwToFixrec(&batch->recs[i], fixrec);
+    }
+    return 0;
+}
+
+
+/*
+ *  status = writeIpfixBatch(batch, ctx);
+ *
+ *    Pipeline write callback.  Append the converted records in
+ *    'batch' to the IPFIX buffer.
+ */
+static int
+writeIpfixBatch(
+    rwipfix_batch_t    *batch,
+    void        UNUSED(*ctx))
+{
+    const size_t fixrec_size = skiRwFixrecSize();
+    const uint8_t *fixrec = (const uint8_t *)batch->data;
+    GError *err = NULL;
+    size_t i;
+
+    for (i = 0; i < batch->count; ++i, fixrec += fixrec_size) {
+        if (!skiRwAppendFixrec(fbuf, fixrec, &err)) {
+            skAppPrintErr("Could not write IPFIX record: %s",
+                          err->message);
+            g_clear_error(&err);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
 int main(int argc, char **argv)
 {
-    fBuf_t *fbuf = NULL;
+    rwipfix_pipeline_t pipeline;
     GError *err = NULL;
-    skstream_t *rwios = NULL;
-    rwRec rwrec;
-    uint64_t rec_count = 0;
     int rv;
 
     appSetup(argc, argv);                       /* never returns on error */
@@ -320,23 +458,18 @@ int main(int argc, char **argv)
         exit(EXIT_FAILURE);
     }
 
-    /* For each input, process each record */
-    while ((rv = skOptionsCtxNextSilkFile(optctx, &rwios, &skAppPrintErr))
-           == 0)
-    {
-        while ((rv = skStreamReadRecord(rwios, &rwrec)) == SKSTREAM_OK) {
-            /* process record */
-            ++rec_count;
-            if (!skiRwAppendRecord(fbuf, &rwrec, &err)) {
-                skAppPrintErr("Could not write IPFIX record: %s",
-                              err->message);
-                exit(EXIT_FAILURE);
-            }
-        }
-        if (rv != SKSTREAM_ERR_EOF) {
-            skStreamPrintLastErr(rwios, rv, &skAppPrintErr);
-        }
-        skStreamDestroy(&rwios);
+    /* Read, convert, and write the records in batches: one thread
+     * reads the SiLK files, 'thread_count' threads convert the
+     * records, and this thread appends them to the IPFIX buffer in
+     * their original order */
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.read_fn = &readSilkBatch;
+    pipeline.convert_fn = &convertBatch;
+    pipeline.write_fn = &writeIpfixBatch;
+    pipeline.data_size = skiRwFixrecSize();
+    pipeline.worker_count = thread_count;
+    if (rwipfixPipelineRun(&pipeline)) {
+        exit(EXIT_FAILURE);
     }
 
     /* finalize the output */
@@ -355,7 +488,11 @@ int main(int argc, char **argv)
     /* print record count */
     if (print_statistics) {
         fprintf(STATS_FH, ("%s: Wrote %" PRIu64 " IPFIX records to '%s'\n"),
-                skAppName(), rec_count, ipfix_output.of_name);
+                skAppName(), pipeline.stats[RWIPFIX_STAGE_WRITE].records,
+                ipfix_output.of_name);
+    }
+    if (benchmark) {
+        rwipfixPipelinePrintStats(&pipeline, STATS_FH);
     }
 
     return 0;
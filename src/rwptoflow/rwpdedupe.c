@@ -65,6 +65,7 @@
 RCSIDENT("$SiLK: rwpdedupe.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 
 #include "rwppacketheaders.h"
+#include "rwppcapfile.h"
 #include <silk/skdllist.h>
 
 
@@ -136,7 +137,7 @@ enum selectionHeuristic {
 };
 
 static struct timeval g_duplicate_margin;
-static pcap_t **g_inputs = NULL;
+static rwp_pcapfile_t **g_inputs = NULL;
 static int g_input_count = 0;
 static pcap_t *g_output = NULL;
 static pcap_dumper_t *g_output_dumper = NULL;
@@ -246,9 +247,7 @@ appTeardown(
     /* close inputs */
     if (g_inputs) {
         for (i = 0; i < g_input_count; ++i) {
-            if (g_inputs[i]) {
-                pcap_close(g_inputs[i]);
-            }
+            rwpPcapFileClose(g_inputs[i]);
         }
         free(g_inputs);
     }
@@ -329,12 +328,12 @@ appSetup(
         skAppPrintErr("Two or more inputs required");
         exit(EXIT_FAILURE);
     }
-    g_inputs = (pcap_t **)malloc(sizeof (pcap_t *) * g_input_count);
+    g_inputs = ((rwp_pcapfile_t **)
+                calloc(g_input_count, sizeof(rwp_pcapfile_t *)));
     ASSERT_MEM(g_inputs);
 
     for (i = arg_index, j = 0; i < arg_index + g_input_count; ++i, ++j) {
-        g_inputs[j] = pcap_open_offline(argv[i], errbuf);
-        if (g_inputs[j] == NULL) {
+        if (rwpPcapFileOpen(&g_inputs[j], argv[i], errbuf)) {
             skAppPrintErr("Error opening input %s: %s", argv[i],
                           errbuf);
             exit(EXIT_FAILURE);
@@ -353,8 +352,9 @@ appSetup(
     /* XXX - we should probably check all the datalink and snaplens of
        input files and make sure they match up.  if they don't, throw
        an error?  or somehow pick the 'correct' or l.c.d. value? */
-    g_output = pcap_open_dead(pcap_datalink(g_inputs[0]),
-                              pcap_snapshot(g_inputs[0]));
+    g_output = pcap_open_dead(
+        pcap_datalink(rwpPcapFileGetPcap(g_inputs[0])),
+        pcap_snapshot(rwpPcapFileGetPcap(g_inputs[0])));
     if (g_output == NULL) {
         skAppPrintErr("Error opening stdout: %s", errbuf);
         exit(EXIT_FAILURE);
@@ -496,7 +496,7 @@ bufferInputList(
             pcap_pkt_t *cur_pkt;
             cur_pkt = (pcap_pkt_t *) malloc(sizeof(pcap_pkt_t));
             ASSERT_MEM(cur_pkt);
-            cur_pkt->data = pcap_next(g_inputs[idx], &cur_pkt->hdr);
+            cur_pkt->data = rwpPcapFileNext(g_inputs[idx], &cur_pkt->hdr);
             if (cur_pkt->data == NULL) {
                 /* cannot read more records from input */
                 buffer[idx].eof = 1;
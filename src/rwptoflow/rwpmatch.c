@@ -66,6 +66,7 @@ RCSIDENT("$SiLK: rwpmatch.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 #include <silk/rwrec.h>
 #include <silk/skstream.h>
 #include "rwppacketheaders.h"
+#include "rwppcapfile.h"
 
 
 /* LOCAL DEFINES AND TYPEDEFS */
@@ -75,6 +76,7 @@ RCSIDENT("$SiLK: rwpmatch.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 
 /* LOCAL VARIABLES */
 
+static rwp_pcapfile_t *packet_file = NULL;
 static pcap_t *packet_input = NULL;
 static skstream_t *flow_input = NULL;
 static pcap_dumper_t *packet_match = NULL;
@@ -180,8 +182,9 @@ appTeardown(
         packet_match = NULL;
     }
 
-    if (packet_input) {
-        pcap_close(packet_input);
+    if (packet_file) {
+        rwpPcapFileClose(packet_file);
+        packet_file = NULL;
         packet_input = NULL;
     }
 
@@ -283,12 +286,12 @@ appSetup(
     }
 
     /* open packet-input file; verify it contains ethernet data */
-    packet_input = pcap_open_offline(packet_input_path, errbuf);
-    if (packet_input == NULL) {
+    if (rwpPcapFileOpen(&packet_file, packet_input_path, errbuf)) {
         skAppPrintErr("Unable to open input file %s: %s", packet_input_path,
                       errbuf);
         exit(EXIT_FAILURE);
     }
+    packet_input = rwpPcapFileGetPcap(packet_file);
     if (DLT_EN10MB != pcap_datalink(packet_input)) {
         skAppPrintErr("Input file %s does not contain Ethernet data",
                       packet_input_path);
@@ -541,7 +544,7 @@ int main(int argc, char **argv)
         /* If the current packet data is stale, load the next packet */
         if (load_next_pkt) {
             load_next_pkt = 0;
-            pkt_data = pcap_next(packet_input, &pkt_hdr);
+            pkt_data = rwpPcapFileNext(packet_file, &pkt_hdr);
             if (pkt_data == NULL) {
                 done = 1;
             }
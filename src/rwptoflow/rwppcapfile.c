@@ -0,0 +1,383 @@
+/*
+** Copyright (C) 2005-2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  rwppcapfile.c
+**
+**    Reader for packet capture files shared by the rwptoflow tools.
+**    See rwppcapfile.h for details.
+*/
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: rwppcapfile.c $");
+
+#include <silk/utils.h>
+#include "rwppcapfile.h"
+
+
+/* LOCAL DEFINES AND TYPEDEFS */
+
+/* magic numbers of the classic tcpdump format, with microsecond and
+ * nanosecond timestamps, as read in the native byte order */
+#define PCAP_MAGIC_USEC     0xa1b2c3d4
+#define PCAP_MAGIC_NSEC     0xa1b23c4d
+#define PCAP_MAGIC_USEC_SWAPPED  0xd4c3b2a1
+#define PCAP_MAGIC_NSEC_SWAPPED  0x4d3cb2a1
+
+/* sizes of the file header and of the header on each packet */
+#define PCAP_FILE_HDR_LEN   24
+#define PCAP_PKT_HDR_LEN    16
+
+/* number of packet offsets to allocate initially */
+#define PCAP_INDEX_INITIAL  (1 << 16)
+
+struct rwp_pcapfile_st {
+    /* the libpcap handle; used for reading when 'map' is NULL */
+    pcap_t         *pcap;
+    /* the mapped file and its size */
+    const u_char   *map;
+    size_t          map_size;
+    /* offset of the packet rwpPcapFileNext() returns next */
+    size_t          pos;
+    /* offsets of the packets, once indexed */
+    uint64_t       *offsets;
+    uint64_t        count;
+    /* the snapshot length from the file header */
+    uint32_t        snaplen;
+    /* whether the file's byte order differs from ours */
+    unsigned        swapped :1;
+    /* whether the file has nanosecond timestamps */
+    unsigned        nsec    :1;
+};
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  value = pcapfileGetU32(pf, p);
+ *
+ *    Return the 32-bit value at 'p', which need not be aligned, in
+ *    native byte order.
+ */
+static uint32_t
+pcapfileGetU32(
+    const rwp_pcapfile_t   *pf,
+    const u_char           *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return (pf->swapped ? BSWAP32(v) : v);
+}
+
+
+/*
+ *  data = pcapfileReadAt(pf, offset, hdr, &next);
+ *
+ *    Fill 'hdr' from the packet header at 'offset' in the mapped file,
+ *    return a pointer to the packet's data, and set 'next' to the
+ *    offset of the following packet.  Return NULL at the end of the
+ *    file or when the packet is truncated.
+ */
+static const u_char *
+pcapfileReadAt(
+    const rwp_pcapfile_t   *pf,
+    size_t                  offset,
+    struct pcap_pkthdr     *hdr,
+    size_t                 *next)
+{
+    const u_char *p;
+    uint32_t caplen;
+
+    if (pf->map_size - offset < PCAP_PKT_HDR_LEN) {
+        return NULL;
+    }
+    p = pf->map + offset;
+    caplen = pcapfileGetU32(pf, p + 8);
+    if (pf->map_size - offset - PCAP_PKT_HDR_LEN < caplen) {
+        return NULL;
+    }
+    hdr->ts.tv_sec = pcapfileGetU32(pf, p);
+    hdr->ts.tv_usec = pcapfileGetU32(pf, p + 4);
+    if (pf->nsec) {
+        hdr->ts.tv_usec /= 1000;
+    }
+    hdr->len = pcapfileGetU32(pf, p + 12);
+    *next = offset + PCAP_PKT_HDR_LEN + caplen;
+
+    /* as libpcap does, ignore data beyond the snapshot length */
+    if (pf->snaplen && caplen > pf->snaplen) {
+        caplen = pf->snaplen;
+    }
+    hdr->caplen = caplen;
+
+    return p + PCAP_PKT_HDR_LEN;
+}
+
+
+/*
+ *  pcapfileMap(pf, path);
+ *
+ *    Map the file at 'path' into memory if it is a regular file in
+ *    the classic tcpdump format.  Leave 'pf->map' NULL otherwise, in
+ *    which case libpcap reads the file.
+ */
+static void
+pcapfileMap(
+    rwp_pcapfile_t     *pf,
+    const char         *path)
+{
+    struct stat st;
+    void *map;
+    uint32_t magic;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (-1 == fd) {
+        return;
+    }
+    if (-1 == fstat(fd, &st)
+        || !S_ISREG(st.st_mode)
+        || st.st_size < PCAP_FILE_HDR_LEN
+        || (uint64_t)st.st_size > SIZE_MAX)
+    {
+        close(fd);
+        return;
+    }
+    map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == map) {
+        return;
+    }
+
+    memcpy(&magic, map, sizeof(magic));
+    switch (magic) {
+      case PCAP_MAGIC_USEC:
+        break;
+      case PCAP_MAGIC_NSEC:
+        pf->nsec = 1;
+        break;
+      case PCAP_MAGIC_USEC_SWAPPED:
+        pf->swapped = 1;
+        break;
+      case PCAP_MAGIC_NSEC_SWAPPED:
+        pf->swapped = 1;
+        pf->nsec = 1;
+        break;
+      default:
+        /* pcap-ng or a variant that libpcap must handle */
+        munmap(map, st.st_size);
+        return;
+    }
+
+#ifdef MADV_SEQUENTIAL
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+#endif
+    pf->map = (const u_char*)map;
+    pf->map_size = st.st_size;
+    pf->snaplen = pcapfileGetU32(pf, pf->map + 16);
+    pf->pos = PCAP_FILE_HDR_LEN;
+}
+
+
+int
+rwpPcapFileOpen(
+    rwp_pcapfile_t    **pf,
+    const char         *path,
+    char               *errbuf)
+{
+    rwp_pcapfile_t *p;
+
+    p = (rwp_pcapfile_t*)calloc(1, sizeof(rwp_pcapfile_t));
+    if (NULL == p) {
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "Out of memory");
+        return -1;
+    }
+    p->pcap = pcap_open_offline(path, errbuf);
+    if (NULL == p->pcap) {
+        free(p);
+        return -1;
+    }
+    if (strcmp(path, "-")) {
+        pcapfileMap(p, path);
+    }
+
+    *pf = p;
+    return 0;
+}
+
+
+void
+rwpPcapFileClose(
+    rwp_pcapfile_t     *pf)
+{
+    if (NULL == pf) {
+        return;
+    }
+    if (pf->map) {
+        munmap((void*)pf->map, pf->map_size);
+    }
+    if (pf->pcap) {
+        pcap_close(pf->pcap);
+    }
+    free(pf->offsets);
+    free(pf);
+}
+
+
+pcap_t *
+rwpPcapFileGetPcap(
+    const rwp_pcapfile_t   *pf)
+{
+    return pf->pcap;
+}
+
+
+int
+rwpPcapFileIsMapped(
+    const rwp_pcapfile_t   *pf)
+{
+    return (NULL != pf->map);
+}
+
+
+const u_char *
+rwpPcapFileNext(
+    rwp_pcapfile_t     *pf,
+    struct pcap_pkthdr *hdr)
+{
+    const u_char *data;
+
+    if (NULL == pf->map) {
+        return pcap_next(pf->pcap, hdr);
+    }
+    data = pcapfileReadAt(pf, pf->pos, hdr, &pf->pos);
+    if (NULL == data) {
+        /* stay at the end */
+        pf->pos = pf->map_size;
+    }
+    return data;
+}
+
+
+int
+rwpPcapFileIndex(
+    rwp_pcapfile_t     *pf)
+{
+    struct pcap_pkthdr hdr;
+    uint64_t *old_offsets;
+    uint64_t alloc;
+    size_t offset;
+    size_t next;
+
+    if (NULL == pf->map) {
+        return -1;
+    }
+
+    alloc = PCAP_INDEX_INITIAL;
+    free(pf->offsets);
+    pf->count = 0;
+    pf->offsets = (uint64_t*)malloc(alloc * sizeof(uint64_t));
+    if (NULL == pf->offsets) {
+        return -1;
+    }
+
+    offset = PCAP_FILE_HDR_LEN;
+    while (pcapfileReadAt(pf, offset, &hdr, &next)) {
+        if (pf->count == alloc) {
+            alloc *= 2;
+            old_offsets = pf->offsets;
+            pf->offsets = (uint64_t*)realloc(pf->offsets,
+                                             alloc * sizeof(uint64_t));
+            if (NULL == pf->offsets) {
+                free(old_offsets);
+                pf->count = 0;
+                return -1;
+            }
+        }
+        pf->offsets[pf->count++] = offset;
+        offset = next;
+    }
+
+    return 0;
+}
+
+
+uint64_t
+rwpPcapFileGetCount(
+    const rwp_pcapfile_t   *pf)
+{
+    return pf->count;
+}
+
+
+const u_char *
+rwpPcapFileGetPacket(
+    const rwp_pcapfile_t   *pf,
+    uint64_t                idx,
+    struct pcap_pkthdr     *hdr)
+{
+    size_t next;
+
+    assert(idx < pf->count);
+    return pcapfileReadAt(pf, pf->offsets[idx], hdr, &next);
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -0,0 +1,188 @@
+/*
+** Copyright (C) 2005-2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+#ifndef _RWPPCAPFILE_H
+#define _RWPPCAPFILE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <silk/silk.h>
+
+RCSIDENTVAR(rcsID_RWPPCAPFILE_H, "$SiLK: rwppcapfile.h $");
+
+#include "rwppacketheaders.h"
+
+
+/*
+**  rwppcapfile.h
+**
+**    A reader for packet capture files that is shared by rwptoflow,
+**    rwpmatch, and rwpdedupe.
+**
+**    When the input is a regular file in the classic tcpdump format,
+**    the reader maps the file into memory and returns pointers into
+**    the mapping, so the packets remain valid until the file is
+**    closed and may be visited in any order after the file has been
+**    indexed.  For other inputs (the standard input, pcap-ng files)
+**    the reader uses pcap_next(), and a packet is only valid until
+**    the next packet is read.
+**
+**    In both cases a pcap_t is opened on the input so that callers
+**    may query its datalink type and pass it to pcap_dump_open().
+*/
+
+
+typedef struct rwp_pcapfile_st rwp_pcapfile_t;
+
+
+/*
+ *  status = rwpPcapFileOpen(&pf, path, errbuf);
+ *
+ *    Open the packet capture file at 'path' ("-" for the standard
+ *    input) and store the reader in the location referenced by 'pf'.
+ *    Return 0 on success.  On failure, return -1 and put an error
+ *    message into 'errbuf', which must hold PCAP_ERRBUF_SIZE bytes.
+ */
+int
+rwpPcapFileOpen(
+    rwp_pcapfile_t    **pf,
+    const char         *path,
+    char               *errbuf);
+
+/*
+ *  rwpPcapFileClose(pf);
+ *
+ *    Unmap and close the file and free the reader.  Does nothing
+ *    when 'pf' is NULL.
+ */
+void
+rwpPcapFileClose(
+    rwp_pcapfile_t     *pf);
+
+/*
+ *  pcap = rwpPcapFileGetPcap(pf);
+ *
+ *    Return the libpcap handle for the file.
+ */
+pcap_t *
+rwpPcapFileGetPcap(
+    const rwp_pcapfile_t   *pf);
+
+/*
+ *  is_mapped = rwpPcapFileIsMapped(pf);
+ *
+ *    Return 1 if the file has been mapped into memory, 0 if packets
+ *    are read by libpcap.
+ */
+int
+rwpPcapFileIsMapped(
+    const rwp_pcapfile_t   *pf);
+
+/*
+ *  data = rwpPcapFileNext(pf, hdr);
+ *
+ *    Fill 'hdr' with the header of the next packet in the file and
+ *    return a pointer to its data, as pcap_next() does.  Return NULL
+ *    at the end of the file or when the file is truncated.
+ */
+const u_char *
+rwpPcapFileNext(
+    rwp_pcapfile_t     *pf,
+    struct pcap_pkthdr *hdr);
+
+/*
+ *  status = rwpPcapFileIndex(pf);
+ *
+ *    Make one pass over a mapped file to record the offset of each
+ *    packet.  Return 0 on success, or -1 if the file is not mapped or
+ *    memory cannot be allocated.  A truncated final packet is not
+ *    indexed, as pcap_next() would not return it.
+ */
+int
+rwpPcapFileIndex(
+    rwp_pcapfile_t     *pf);
+
+/*
+ *  count = rwpPcapFileGetCount(pf);
+ *
+ *    Return the number of packets found by rwpPcapFileIndex().
+ */
+uint64_t
+rwpPcapFileGetCount(
+    const rwp_pcapfile_t   *pf);
+
+/*
+ *  data = rwpPcapFileGetPacket(pf, idx, hdr);
+ *
+ *    Fill 'hdr' with the header of the packet at position 'idx' in
+ *    an indexed file and return a pointer to its data.  May be
+ *    called from multiple threads.
+ */
+const u_char *
+rwpPcapFileGetPacket(
+    const rwp_pcapfile_t   *pf,
+    uint64_t                idx,
+    struct pcap_pkthdr     *hdr);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _RWPPCAPFILE_H */
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
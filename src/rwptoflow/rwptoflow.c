@@ -79,6 +79,7 @@ RCSIDENT("$SiLK: rwptoflow.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 #include <silk/skstream.h>
 #include <silk/utils.h>
 #include "rwppacketheaders.h"
+#include "rwppcapfile.h"
 
 
 /* LOCAL DEFINES AND TYPEDEFS */
@@ -89,6 +90,17 @@ RCSIDENT("$SiLK: rwptoflow.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 /* where to print the statistics */
 #define STATS_STREAM stderr
 
+/* environment variable that specifies the number of threads */
+#define RWP2F_THREADS_ENVAR  "SILK_RWPTOFLOW_THREADS"
+
+/* number of packets a thread converts at a time */
+#define P2F_CHUNK_PACKETS  16384
+
+/* what to do with a packet; see packetToFlow() */
+typedef enum {
+    P2F_WRITE, P2F_REJECT, P2F_IGNORE, P2F_ERROR
+} p2f_result_t;
+
 
 /* LOCAL VARIABLES */
 
@@ -100,8 +112,9 @@ RCSIDENT("$SiLK: rwptoflow.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
  */
 static const char *plugin_extra_args[] = RWP2F_EXTRA_ARGUMENTS;
 
-/* the packet file to read */
+/* the packet file to read; 'packet_input' is its libpcap handle */
 static const char *packet_input_path = NULL;
+static rwp_pcapfile_t *packet_file = NULL;
 static pcap_t *packet_input = NULL;
 
 /* the flow file to write */
@@ -164,6 +177,41 @@ static struct statistics_st {
 
 static int print_statistics = 0;
 
+/* number of plug-ins loaded */
+static int plugin_count = 0;
+
+/* number of threads to use to convert packets; 1 for no threading */
+static uint32_t thread_count = 1;
+
+/* a range of packets converted by a thread */
+typedef struct p2f_chunk_st {
+    /* index of the first packet and number of packets */
+    uint64_t                first;
+    uint64_t                count;
+    /* the p2f_result_t and the flow for each packet */
+    uint8_t                *result;
+    rwRec                  *flows;
+    /* the statistics for these packets */
+    struct statistics_st    stats;
+    /* whether the chunk is ready to be written */
+    int                     ready;
+} p2f_chunk_t;
+
+/* the chunks being converted or written; chunk N uses the slot at
+ * index N % chunk_slots */
+static p2f_chunk_t *chunks = NULL;
+static uint32_t chunk_slots;
+
+/* number of chunks in the file, the next chunk to be claimed by a
+ * thread, and the number of chunks that have been written */
+static uint64_t chunk_total;
+static uint64_t chunk_next = 0;
+static uint64_t chunk_written = 0;
+
+/* protects the chunk counters and the 'ready' members */
+static pthread_mutex_t chunk_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t chunk_cond = PTHREAD_COND_INITIALIZER;
+
 /* value passed to pcap_open for stdin/stdout */
 static const char *pcap_stdio = "-";
 
@@ -186,7 +234,8 @@ typedef enum {
     OPT_SET_INPUTINDEX,
     OPT_SET_OUTPUTINDEX,
     OPT_SET_NEXTHOPIP,
-    OPT_PRINT_STATISTICS
+    OPT_PRINT_STATISTICS,
+    OPT_THREADS
 } appOptionsEnum;
 
 
@@ -204,6 +253,7 @@ static struct option appOptions[] = {
     {"set-outputindex",         REQUIRED_ARG, 0, OPT_SET_OUTPUTINDEX},
     {"set-nexthopip",           REQUIRED_ARG, 0, OPT_SET_NEXTHOPIP},
     {"print-statistics",        NO_ARG,       0, OPT_PRINT_STATISTICS},
+    {"threads",                 REQUIRED_ARG, 0, OPT_THREADS},
     {0,0,0,0}                   /* sentinel entry */
 };
 
@@ -233,6 +283,9 @@ static const char *appHelp[] = {
     "Set next hop IP address for all flows. Def. 0.0.0.0",
     ("Print the count of packets read, packets processed,\n"
      "\tand bad packets to the standard error"),
+    ("Convert packets using this number of threads when the\n"
+     "\tinput is a tcpdump file that can be memory-mapped and no plug-in\n"
+     "\tis loaded. Def. $" RWP2F_THREADS_ENVAR " or 1"),
     (char*)NULL
 };
 
@@ -338,8 +391,9 @@ appTeardown(
     }
 
     /* packet input */
-    if (packet_input) {
-        pcap_close(packet_input);
+    if (packet_file) {
+        rwpPcapFileClose(packet_file);
+        packet_file = NULL;
         packet_input = NULL;
     }
 
@@ -369,6 +423,8 @@ appSetup(
     int arg_index;
     int stdout_used = 0;
     sk_file_header_t *hdr;
+    const char *env;
+    uint32_t tc;
 #ifdef SILK_CLOBBER_ENVAR
     const char *clobber_env = getenv(SILK_CLOBBER_ENVAR);
 #endif
@@ -408,6 +464,14 @@ appSetup(
         exit(EXIT_FAILURE);
     }
 
+    /* check the thread count envar */
+    env = getenv(RWP2F_THREADS_ENVAR);
+    if (env && env[0]) {
+        if (skStringParseUint32(&tc, env, 1, 0) == 0) {
+            thread_count = tc;
+        }
+    }
+
     /* parse options */
     arg_index = skOptionsParse(argc, argv);
     if (arg_index < 0) {
@@ -493,12 +557,12 @@ appSetup(
     }
 
     /* open packet-input file; verify it contains ethernet data */
-    packet_input = pcap_open_offline(packet_input_path, errbuf);
-    if (packet_input == NULL) {
+    if (rwpPcapFileOpen(&packet_file, packet_input_path, errbuf)) {
         skAppPrintErr("Error opening input %s: %s",
                       packet_input_path, errbuf);
         exit(EXIT_FAILURE);
     }
+    packet_input = rwpPcapFileGetPcap(packet_file);
     if (DLT_EN10MB != pcap_datalink(packet_input)) {
         skAppPrintErr("Input file %s does not contain Ethernet data",
                       packet_input_path);
@@ -589,6 +653,7 @@ appOptionsHandler(
             skAppPrintErr("Fatal error loading plug-in '%s'", opt_arg);
             return 1;
         }
+        ++plugin_count;
         break;
 
       case OPT_ACTIVE_TIME:
@@ -709,6 +774,13 @@ appOptionsHandler(
       case OPT_PRINT_STATISTICS:
         print_statistics = 1;
         break;
+
+      case OPT_THREADS:
+        rv = skStringParseUint32(&thread_count, opt_arg, 1, 0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
     }
 
     return 0; /* OK */
@@ -725,27 +797,23 @@ appOptionsHandler(
 
 
 /*
- *  status = packetsToFlows();
+ *  result = packetToFlow(pcaph, data, flow, stats);
  *
- *    For every packet in the global 'packet_input' file, try to
- *    produce a SiLK flow record, and write that record to the
- *    'flow_output' rwio-stream.  In addition, print the packets to
- *    the 'packet_pass' and/or 'packet_fail' dump files if requested.
- *    Update the global 'statistics' struct.  Return 0 on success, or
- *    -1 if writing a flow to the 'flow_output' stream fails.
+ *    Try to produce a SiLK Flow record in 'flow' from the packet
+ *    whose header is 'pcaph' and whose content is 'data'.  Update the
+ *    counters in 'stats'.  Return P2F_WRITE when 'flow' should be
+ *    written, P2F_REJECT when the packet should be written to the
+ *    packet-reject-output file, P2F_IGNORE when the packet should be
+ *    ignored, or P2F_ERROR when a plug-in returns an error.
  */
-static int
-packetsToFlows(
-    void)
+static p2f_result_t
+packetToFlow(
+    const struct pcap_pkthdr   *pcaph,
+    const u_char               *data,
+    rwRec                      *flow,
+    struct statistics_st       *stats)
 {
-#define DUMP_REJECT_PACKET                                        \
-    if ( !packet_reject) { /* no-op */}                           \
-    else {pcap_dump((u_char*)packet_reject, &pcaph, data);}
-
     sk_pktsrc_t pktsrc;
-    struct pcap_pkthdr pcaph;
-    const u_char *data;
-    rwRec flow;
     /* pointer to the ethernet header inside of 'data' */
     eth_header_t *ethh;
     /* pointer to the IP header inside of 'data' */
@@ -755,202 +823,214 @@ packetsToFlows(
     /* the advertised length of the IP header */
     uint32_t iph_len;
     uint32_t len;
-    int rv;
     void *pktptr;
     skplugin_err_t err;
 
-    /* set up the sk_pktsrc_t for communicating with the plugins */
-    pktsrc.pcap_src = packet_input;
-    pktsrc.pcap_hdr = &pcaph;
-
-    while (NULL != (data = pcap_next(packet_input, &pcaph))) {
-        ++statistics.s_total;
-
-        /* see if the packet's time is within our time window */
-        if (time_window.tw_end.tv_sec) {
-            if (pcaph.ts.tv_sec < time_window.tw_begin.tv_sec
-                || (pcaph.ts.tv_sec == time_window.tw_begin.tv_sec
-                    && pcaph.ts.tv_usec < time_window.tw_begin.tv_usec))
-            {
-                /* packet's time is before window */
-                ++statistics.s_prewindow;
-                continue;
-            }
-            if (pcaph.ts.tv_sec > time_window.tw_end.tv_sec
-                || (pcaph.ts.tv_sec == time_window.tw_end.tv_sec
-                    && pcaph.ts.tv_usec > time_window.tw_end.tv_usec))
-            {
-                /* packet's time is after window */
-                ++statistics.s_postwindow;
-                continue;
-            }
-        }
+    ++stats->s_total;
 
-        /* make certain we captured the ethernet header */
-        len = pcaph.caplen;
-        if (len < sizeof(eth_header_t)) {
-            /* short packet */
-            ++statistics.s_short;
-            DUMP_REJECT_PACKET;
-            continue;
+    /* see if the packet's time is within our time window */
+    if (time_window.tw_end.tv_sec) {
+        if (pcaph->ts.tv_sec < time_window.tw_begin.tv_sec
+            || (pcaph->ts.tv_sec == time_window.tw_begin.tv_sec
+                && pcaph->ts.tv_usec < time_window.tw_begin.tv_usec))
+        {
+            /* packet's time is before window */
+            ++stats->s_prewindow;
+            return P2F_IGNORE;
         }
-
-        /* get the ethernet header; goto next packet if not Ethernet. */
-        ethh = (eth_header_t*)data;
-        if (ntohs(ethh->ether_type) != ETHERTYPE_IP) {
-            /* ignoring non IP packet */
-            ++statistics.s_nonipv4;
-            DUMP_REJECT_PACKET;
-            continue;
+        if (pcaph->ts.tv_sec > time_window.tw_end.tv_sec
+            || (pcaph->ts.tv_sec == time_window.tw_end.tv_sec
+                && pcaph->ts.tv_usec > time_window.tw_end.tv_usec))
+        {
+            /* packet's time is after window */
+            ++stats->s_postwindow;
+            return P2F_IGNORE;
         }
+    }
 
-        /* get the IP header; verify that we have the entire IP header
-         * that the version is 4. */
-        iph = (ip_header_t*)(data + sizeof(eth_header_t));
-        len -= sizeof(eth_header_t);
-        if (len < sizeof(ip_header_t)) {
-            ++statistics.s_short;
-            DUMP_REJECT_PACKET;
-            continue;
-        }
-        if ((iph->ver_ihl >> 4) != 4) {
-            /* ignoring non IPv4 packet */
-            ++statistics.s_nonipv4;
-            DUMP_REJECT_PACKET;
-            continue;
-        }
+    /* make certain we captured the ethernet header */
+    len = pcaph->caplen;
+    if (len < sizeof(eth_header_t)) {
+        /* short packet */
+        ++stats->s_short;
+        return P2F_REJECT;
+    }
 
-        /* the protocol-specific header begins after the advertised
-         * length of the IP header */
-        iph_len = (iph->ver_ihl & 0x0F) << 2;
-        if (len > iph_len) {
-            protoh = (u_char*)(((u_char*)iph) + iph_len);
-            len -= iph_len;
-        } else {
-            protoh = NULL;
-        }
+    /* get the ethernet header; goto next packet if not Ethernet. */
+    ethh = (eth_header_t*)data;
+    if (ntohs(ethh->ether_type) != ETHERTYPE_IP) {
+        /* ignoring non IP packet */
+        ++stats->s_nonipv4;
+        return P2F_REJECT;
+    }
 
-        /* check for fragmentation */
-        if (ntohs(iph->flags_fo) & (IP_MF | IPHEADER_FO_MASK)) {
-            ++statistics.s_fragmented;
+    /* get the IP header; verify that we have the entire IP header
+     * that the version is 4. */
+    iph = (ip_header_t*)(data + sizeof(eth_header_t));
+    len -= sizeof(eth_header_t);
+    if (len < sizeof(ip_header_t)) {
+        ++stats->s_short;
+        return P2F_REJECT;
+    }
+    if ((iph->ver_ihl >> 4) != 4) {
+        /* ignoring non IPv4 packet */
+        ++stats->s_nonipv4;
+        return P2F_REJECT;
+    }
 
-            if (reject_frags_all) {
-                DUMP_REJECT_PACKET;
-                continue;
-            }
-            if ((ntohs(iph->flags_fo) & IPHEADER_FO_MASK) == 0) {
-                ++statistics.s_zerofrag;
-            } else if (reject_frags_subsequent) {
-                DUMP_REJECT_PACKET;
-                continue;
-            }
+    /* the protocol-specific header begins after the advertised
+     * length of the IP header */
+    iph_len = (iph->ver_ihl & 0x0F) << 2;
+    if (len > iph_len) {
+        protoh = (u_char*)(((u_char*)iph) + iph_len);
+        len -= iph_len;
+    } else {
+        protoh = NULL;
+    }
+
+    /* check for fragmentation */
+    if (ntohs(iph->flags_fo) & (IP_MF | IPHEADER_FO_MASK)) {
+        ++stats->s_fragmented;
+
+        if (reject_frags_all) {
+            return P2F_REJECT;
         }
+        if ((ntohs(iph->flags_fo) & IPHEADER_FO_MASK) == 0) {
+            ++stats->s_zerofrag;
+        } else if (reject_frags_subsequent) {
+            return P2F_REJECT;
+        }
+    }
 
-        /* we have enough data to generate a flow; fill it in with
-         * what we know so far. */
-        memcpy(&flow, &default_flow_values, sizeof(rwRec));
-
-        rwRecSetSIPv4(&flow, ntohl(iph->saddr));
-        rwRecSetDIPv4(&flow, ntohl(iph->daddr));
-        rwRecSetProto(&flow, iph->proto);
-        rwRecSetBytes(&flow, ntohs(iph->tlen));
-        rwRecSetStartTime(&flow, sktimeCreateFromTimeval(&pcaph.ts));
-
-        /* Get the port information from unfragmented datagrams or
-         * from the zero-packet of fragmented datagrams. */
-        if (protoh && ((ntohs(iph->flags_fo) & IPHEADER_FO_MASK) == 0)) {
-
-            /* Set ports and flags based on the IP protocol */
-            switch (iph->proto) {
-              case 1: /* ICMP */
-                /* did we capture enough to get ICMP data? */
-                if (len < 2) {
-                    ++statistics.s_incomplete;
-                    if (reject_incomplete) {
-                        DUMP_REJECT_PACKET;
-                        continue;
-                    }
-                } else {
-                    icmp_header_t *icmphdr = (icmp_header_t*)protoh;
-                    rwRecSetDPort(&flow,
-                                  ((icmphdr->type << 8) | icmphdr->code));
+    /* we have enough data to generate a flow; fill it in with
+     * what we know so far. */
+    memcpy(flow, &default_flow_values, sizeof(rwRec));
+
+    rwRecSetSIPv4(flow, ntohl(iph->saddr));
+    rwRecSetDIPv4(flow, ntohl(iph->daddr));
+    rwRecSetProto(flow, iph->proto);
+    rwRecSetBytes(flow, ntohs(iph->tlen));
+    rwRecSetStartTime(flow, sktimeCreateFromTimeval(&pcaph->ts));
+
+    /* Get the port information from unfragmented datagrams or
+     * from the zero-packet of fragmented datagrams. */
+    if (protoh && ((ntohs(iph->flags_fo) & IPHEADER_FO_MASK) == 0)) {
+
+        /* Set ports and flags based on the IP protocol */
+        switch (iph->proto) {
+          case 1: /* ICMP */
+            /* did we capture enough to get ICMP data? */
+            if (len < 2) {
+                ++stats->s_incomplete;
+                if (reject_incomplete) {
+                    return P2F_REJECT;
                 }
-                break;
-
-              case 6: /* TCP */
-                /* did we capture enough to get the TCP flags? */
-                if (len < 14) {
-                    ++statistics.s_incomplete;
-                    if (reject_incomplete) {
-                        DUMP_REJECT_PACKET;
-                        continue;
-                    }
-                    /* can we at least get the ports? */
-                    if (len >= 4) {
-                        tcp_header_t *tcphdr = (tcp_header_t*)protoh;
-                        rwRecSetSPort(&flow, ntohs(tcphdr->sport));
-                        rwRecSetDPort(&flow, ntohs(tcphdr->dport));
-                    }
-                } else {
+            } else {
+                icmp_header_t *icmphdr = (icmp_header_t*)protoh;
+                rwRecSetDPort(flow, ((icmphdr->type << 8) | icmphdr->code));
+            }
+            break;
+
+          case 6: /* TCP */
+            /* did we capture enough to get the TCP flags? */
+            if (len < 14) {
+                ++stats->s_incomplete;
+                if (reject_incomplete) {
+                    return P2F_REJECT;
+                }
+                /* can we at least get the ports? */
+                if (len >= 4) {
                     tcp_header_t *tcphdr = (tcp_header_t*)protoh;
-                    rwRecSetSPort(&flow, ntohs(tcphdr->sport));
-                    rwRecSetDPort(&flow, ntohs(tcphdr->dport));
-                    rwRecSetFlags(&flow, tcphdr->flags);
+                    rwRecSetSPort(flow, ntohs(tcphdr->sport));
+                    rwRecSetDPort(flow, ntohs(tcphdr->dport));
                 }
-                break;
-
-              case 17: /* UDP */
-                /* did we capture enough to get UDP sport and dport? */
-                if (len < 4) {
-                    ++statistics.s_incomplete;
-                    if (reject_incomplete) {
-                        DUMP_REJECT_PACKET;
-                        continue;
-                    }
-                } else {
-                    udp_header_t *udphdr = (udp_header_t*)protoh;
-                    rwRecSetSPort(&flow, ntohs(udphdr->sport));
-                    rwRecSetDPort(&flow, ntohs(udphdr->dport));
+            } else {
+                tcp_header_t *tcphdr = (tcp_header_t*)protoh;
+                rwRecSetSPort(flow, ntohs(tcphdr->sport));
+                rwRecSetDPort(flow, ntohs(tcphdr->dport));
+                rwRecSetFlags(flow, tcphdr->flags);
+            }
+            break;
+
+          case 17: /* UDP */
+            /* did we capture enough to get UDP sport and dport? */
+            if (len < 4) {
+                ++stats->s_incomplete;
+                if (reject_incomplete) {
+                    return P2F_REJECT;
                 }
-                break;
+            } else {
+                udp_header_t *udphdr = (udp_header_t*)protoh;
+                rwRecSetSPort(flow, ntohs(udphdr->sport));
+                rwRecSetDPort(flow, ntohs(udphdr->dport));
             }
+            break;
         }
+    }
 
-        /* If the user provided plug-in(s), call it(them) */
-        pktsrc.pcap_data = data;
-        pktptr = &pktsrc;
-        err = skPluginRunTransformFn(&flow, &pktptr);
-        switch (err) {
-          case SKPLUGIN_FILTER_PASS:
-            /* success, but no opinion; try next plug-in */
-            break;
+    if (0 == plugin_count) {
+        return P2F_WRITE;
+    }
+
+    /* If the user provided plug-in(s), call it(them) */
+    pktsrc.pcap_src = packet_input;
+    pktsrc.pcap_hdr = pcaph;
+    pktsrc.pcap_data = data;
+    pktptr = &pktsrc;
+    err = skPluginRunTransformFn(flow, &pktptr);
+    switch (err) {
+      case SKPLUGIN_FILTER_PASS:
+        /* success, but no opinion; try next plug-in */
+        break;
+
+      case SKPLUGIN_FILTER_PASS_NOW:
+        /* success, immediately write flow */
+        break;
+
+      case SKPLUGIN_FILTER_FAIL:
+        /* success, but immediately reject the flow */
+        ++stats->s_plugin_rej;
+        return P2F_REJECT;
+
+      case SKPLUGIN_FILTER_IGNORE:
+        /* success, immediately ignore the flow */
+        ++stats->s_plugin_ign;
+        return P2F_IGNORE;
+
+      default:
+        /* an error */
+        skAppPrintErr("Quitting on error code %d from plug-in",
+                      err);
+        return P2F_ERROR;
+    }
+
+    return P2F_WRITE;
+}
 
-          case SKPLUGIN_FILTER_PASS_NOW:
-            /* success, immediately write flow */
-            goto WRITE_FLOW;
-
-          case SKPLUGIN_FILTER_FAIL:
-            /* success, but immediately reject the flow */
-            ++statistics.s_plugin_rej;
-            DUMP_REJECT_PACKET;
-            goto NEXT_PACKET;
-
-          case SKPLUGIN_FILTER_IGNORE:
-            /* success, immediately ignore the flow */
-            ++statistics.s_plugin_ign;
-            goto NEXT_PACKET;
-
-          default:
-            /* an error */
-            skAppPrintErr("Quitting on error code %d from plug-in",
-                          err);
-            return -1;
-        }
 
-      WRITE_FLOW:
+/*
+ *  status = writeResult(result, pcaph, data, flow);
+ *
+ *    Act on the 'result' of packetToFlow() for the packet whose
+ *    header is 'pcaph' and whose content is 'data': write 'flow' to
+ *    the 'flow_output' stream and the packet to the packet-pass-output
+ *    file, or write the packet to the packet-reject-output file.
+ *    Return 0 on success, or -1 if writing the flow fails.
+ */
+static int
+writeResult(
+    p2f_result_t                result,
+    const struct pcap_pkthdr   *pcaph,
+    const u_char               *data,
+    const rwRec                *flow)
+{
+    int rv;
+
+    switch (result) {
+      case P2F_WRITE:
         /* FINALLY, write the record to the SiLK Flow file and write
          * the packet to the packet-pass-output file */
-        rv = skStreamWriteRecord(flow_output, &flow);
+        rv = skStreamWriteRecord(flow_output, flow);
         if (rv) {
             skStreamPrintLastErr(flow_output, rv, &skAppPrintErr);
             if (SKSTREAM_ERROR_IS_FATAL(rv)) {
@@ -958,17 +1038,232 @@ packetsToFlows(
             }
         }
         if (packet_pass) {
-            pcap_dump((u_char*)packet_pass, &pcaph, data);
+            pcap_dump((u_char*)packet_pass, pcaph, data);
+        }
+        break;
+
+      case P2F_REJECT:
+        if (packet_reject) {
+            pcap_dump((u_char*)packet_reject, pcaph, data);
         }
+        break;
+
+      case P2F_IGNORE:
+        break;
+
+      case P2F_ERROR:
+        return -1;
+    }
+    return 0;
+}
+
 
-      NEXT_PACKET:
-        ; /* empty */
+/*
+ *  status = packetsToFlows();
+ *
+ *    For every packet in the global 'packet_file', try to produce a
+ *    SiLK flow record, and write that record to the 'flow_output'
+ *    rwio-stream.  In addition, print the packets to the
+ *    'packet_pass' and/or 'packet_fail' dump files if requested.
+ *    Update the global 'statistics' struct.  Return 0 on success, or
+ *    -1 if writing a flow to the 'flow_output' stream fails.
+ */
+static int
+packetsToFlows(
+    void)
+{
+    struct pcap_pkthdr pcaph;
+    const u_char *data;
+    p2f_result_t result;
+    rwRec flow;
+
+    while (NULL != (data = rwpPcapFileNext(packet_file, &pcaph))) {
+        result = packetToFlow(&pcaph, data, &flow, &statistics);
+        if (writeResult(result, &pcaph, data, &flow)) {
+            return -1;
+        }
     }
 
     return 0;
 }
 
 
+/*
+ *  statisticsAdd(dst, src);
+ *
+ *    Add the counters in 'src' to those in 'dst'.
+ */
+static void
+statisticsAdd(
+    struct statistics_st       *dst,
+    const struct statistics_st *src)
+{
+    dst->s_total        += src->s_total;
+    dst->s_short        += src->s_short;
+    dst->s_nonipv4      += src->s_nonipv4;
+    dst->s_prewindow    += src->s_prewindow;
+    dst->s_postwindow   += src->s_postwindow;
+    dst->s_fragmented   += src->s_fragmented;
+    dst->s_zerofrag     += src->s_zerofrag;
+    dst->s_plugin_ign   += src->s_plugin_ign;
+    dst->s_plugin_rej   += src->s_plugin_rej;
+    dst->s_incomplete   += src->s_incomplete;
+}
+
+
+/*
+ *  p2fWorker(NULL);
+ *
+ *    THREAD ENTRY POINT.
+ *
+ *    Convert chunks of packets from the indexed 'packet_file' until
+ *    all chunks have been claimed.  A thread does not claim a chunk
+ *    until the writer has released the slot the chunk uses.
+ */
+static void *
+p2fWorker(
+    void        UNUSED(*arg))
+{
+    p2f_chunk_t *chunk;
+    struct pcap_pkthdr pcaph;
+    const u_char *data;
+    uint64_t chunk_id;
+    uint64_t i;
+
+    for (;;) {
+        pthread_mutex_lock(&chunk_mutex);
+        while (chunk_next < chunk_total
+               && chunk_next >= chunk_written + chunk_slots)
+        {
+            pthread_cond_wait(&chunk_cond, &chunk_mutex);
+        }
+        if (chunk_next >= chunk_total) {
+            pthread_mutex_unlock(&chunk_mutex);
+            return NULL;
+        }
+        chunk_id = chunk_next++;
+        pthread_mutex_unlock(&chunk_mutex);
+
+        chunk = &chunks[chunk_id % chunk_slots];
+        memset(&chunk->stats, 0, sizeof(chunk->stats));
+        chunk->first = chunk_id * P2F_CHUNK_PACKETS;
+        chunk->count = P2F_CHUNK_PACKETS;
+        if (chunk->first + chunk->count > rwpPcapFileGetCount(packet_file)) {
+            chunk->count = (rwpPcapFileGetCount(packet_file) - chunk->first);
+        }
+        for (i = 0; i < chunk->count; ++i) {
+            data = rwpPcapFileGetPacket(packet_file, chunk->first + i, &pcaph);
+            chunk->result[i] = packetToFlow(&pcaph, data, &chunk->flows[i],
+                                            &chunk->stats);
+        }
+
+        pthread_mutex_lock(&chunk_mutex);
+        chunk->ready = 1;
+        pthread_cond_broadcast(&chunk_cond);
+        pthread_mutex_unlock(&chunk_mutex);
+    }
+}
+
+
+/*
+ *  status = packetsToFlowsThreaded();
+ *
+ *    Do the work of packetsToFlows() for a mapped input file using
+ *    'thread_count' threads.  The file is indexed, the threads
+ *    convert chunks of packets in parallel, and this thread writes
+ *    the chunks in the order of the packets.  Return 0 on success,
+ *    -1 on failure.
+ */
+static int
+packetsToFlowsThreaded(
+    void)
+{
+    pthread_t *threads;
+    p2f_chunk_t *chunk;
+    struct pcap_pkthdr pcaph;
+    const u_char *data;
+    uint64_t chunk_id;
+    uint64_t i;
+    uint32_t t;
+    int rv = 0;
+
+    if (rwpPcapFileIndex(packet_file)) {
+        skAppPrintOutOfMemory("packet index");
+        return -1;
+    }
+    chunk_total = ((rwpPcapFileGetCount(packet_file) + P2F_CHUNK_PACKETS - 1)
+                   / P2F_CHUNK_PACKETS);
+    chunk_slots = 2 * thread_count;
+
+    chunks = (p2f_chunk_t*)calloc(chunk_slots, sizeof(p2f_chunk_t));
+    threads = (pthread_t*)calloc(thread_count, sizeof(pthread_t));
+    if (NULL == chunks || NULL == threads) {
+        skAppPrintOutOfMemory("thread data");
+        free(chunks);
+        free(threads);
+        return -1;
+    }
+    for (t = 0; t < chunk_slots; ++t) {
+        chunks[t].flows = (rwRec*)malloc(P2F_CHUNK_PACKETS * sizeof(rwRec));
+        chunks[t].result = (uint8_t*)malloc(P2F_CHUNK_PACKETS);
+        if (NULL == chunks[t].flows || NULL == chunks[t].result) {
+            skAppPrintOutOfMemory("packet chunk");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (t = 0; t < thread_count; ++t) {
+        if (pthread_create(&threads[t], NULL, &p2fWorker, NULL)) {
+            skAppPrintErr("Unable to create thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* write the chunks in order */
+    for (chunk_id = 0; chunk_id < chunk_total; ++chunk_id) {
+        chunk = &chunks[chunk_id % chunk_slots];
+        pthread_mutex_lock(&chunk_mutex);
+        while (!chunk->ready) {
+            pthread_cond_wait(&chunk_cond, &chunk_mutex);
+        }
+        pthread_mutex_unlock(&chunk_mutex);
+
+        for (i = 0; i < chunk->count && 0 == rv; ++i) {
+            data = rwpPcapFileGetPacket(packet_file, chunk->first + i, &pcaph);
+            rv = writeResult((p2f_result_t)chunk->result[i], &pcaph, data,
+                             &chunk->flows[i]);
+        }
+        statisticsAdd(&statistics, &chunk->stats);
+
+        pthread_mutex_lock(&chunk_mutex);
+        chunk->ready = 0;
+        ++chunk_written;
+        if (rv) {
+            /* stop the threads from claiming more chunks */
+            chunk_total = chunk_next;
+        }
+        pthread_cond_broadcast(&chunk_cond);
+        pthread_mutex_unlock(&chunk_mutex);
+        if (rv) {
+            break;
+        }
+    }
+
+    for (t = 0; t < thread_count; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+    for (t = 0; t < chunk_slots; ++t) {
+        free(chunks[t].flows);
+        free(chunks[t].result);
+    }
+    free(chunks);
+    free(threads);
+    chunks = NULL;
+
+    return rv;
+}
+
+
 /*
  *  printStatistics(fh);
  *
@@ -1047,9 +1342,20 @@ printStatistics(
 
 int main(int argc, char **argv)
 {
+    int rv;
+
     appSetup(argc, argv);
 
-    if (packetsToFlows()) {
+    /* plug-ins may not be thread-safe, and only a mapped file may be
+     * indexed */
+    if (thread_count > 1 && 0 == plugin_count
+        && rwpPcapFileIsMapped(packet_file))
+    {
+        rv = packetsToFlowsThreaded();
+    } else {
+        rv = packetsToFlows();
+    }
+    if (rv) {
         exit(EXIT_FAILURE);
     }
 
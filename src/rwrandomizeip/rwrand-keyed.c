@@ -0,0 +1,526 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  rwrand-keyed.c
+**
+**    Functions to consistently randomize an IP address with a keyed,
+**    prefix-preserving mapping in the manner of Crypto-PAn: two
+**    addresses that share a k-bit prefix before randomization share a
+**    k-bit prefix afterwards.
+**
+**    Bit i of the result is bit i of the input exclusive-or'ed with
+**    one bit of a pseudo-random function of the i bits that precede
+**    it.  The pseudo-random function is SipHash-2-4 keyed with 128
+**    bits that are derived from the contents of the file given to
+**    --key-file, so the mapping is the same for a given key file on
+**    every run, every platform, and for any number of threads.
+**
+**    Since the top 24 bits of the result depend only on the top 24
+**    bits of the input, each thread keeps a cache of the /24 prefixes
+**    it has randomized, and only the final 8 bits of an address whose
+**    /24 is in the cache need to be computed.
+**
+**    rwrandKeyedLoad() is called by the main rwrandomizeip
+**    application to register this back-end and its switch.
+*/
+
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: rwrand-keyed.c $");
+
+#include "rwrandomizeip.h"
+
+
+/* LOCAL DEFINES AND TYPEDEFS */
+
+/* the fewest bytes that the key file may contain */
+#define KEY_FILE_MIN_BYTES  16
+
+/* the number of entries in each thread's cache of /24 prefixes; must
+ * be a power of 2 */
+#define PREFIX_CACHE_BITS   14
+#define PREFIX_CACHE_SIZE   (1u << PREFIX_CACHE_BITS)
+
+/* a cache entry holds this bit when it is in use, the input /24 in
+ * bits 24-47, and the randomized /24 in bits 0-23 */
+#define PREFIX_CACHE_VALID  UINT64_C(0x8000000000000000)
+
+#define ROTL64(x, b)  (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND(v0, v1, v2, v3)                                        \
+    {                                                                   \
+        (v0) += (v1); (v1) = ROTL64((v1), 13); (v1) ^= (v0);            \
+        (v0) = ROTL64((v0), 32);                                        \
+        (v2) += (v3); (v3) = ROTL64((v3), 16); (v3) ^= (v2);            \
+        (v0) += (v3); (v3) = ROTL64((v3), 21); (v3) ^= (v0);            \
+        (v2) += (v1); (v1) = ROTL64((v1), 17); (v1) ^= (v2);            \
+        (v2) = ROTL64((v2), 32);                                        \
+    }
+
+typedef struct keyed_key_st {
+    uint64_t    k0;
+    uint64_t    k1;
+} keyed_key_t;
+
+
+/* LOCAL VARIABLE DEFINITIONS */
+
+/* the key for the pseudo-random function */
+static keyed_key_t prf_key;
+
+/* the per-thread cache of /24 prefixes */
+static pthread_key_t cache_key;
+static int cache_key_created = 0;
+
+
+/* OPTIONS SETUP */
+
+typedef enum {
+    OPT_KEY_FILE
+} keyedOptionEnum;
+
+static struct keyed_option_st {
+    const char *name;
+    int         has_arg;
+    int         id;
+    const char *help;
+}  keyed_options[] = {
+    {"key-file",    REQUIRED_ARG, OPT_KEY_FILE,
+     ("Consistently randomize IP addresses with a prefix-\n"
+      "\tpreserving mapping keyed by the contents of this file. Def. No")},
+    {0,0,0,0}       /* sentinel entry */
+};
+
+
+/* LOCAL FUNCTION PROTOTYPES */
+
+static int  optionHandler(char *opt_arg, void *data);
+static int  rwrandKeyedActivate(void *data);
+static int  rwrandKeyedDeactivate(void *data);
+static void rwrandKeyedRandIP(uint32_t *ip);
+static void rwrandKeyedRandBatch(uint32_t *ips, size_t count);
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  status = rwrandKeyedLoad();
+ *
+ *    This function is called by rwrandomizeip to initialize this
+ *    back-end.
+ */
+int
+rwrandKeyedLoad(
+    void)
+{
+    int rv;
+    int i;
+
+    /* register the functions */
+    rv = rwrandomizerRegister(&rwrandKeyedActivate, &rwrandKeyedRandIP,
+                              &rwrandKeyedDeactivate, NULL, NULL);
+    if (rv) {
+        return rv;
+    }
+    rv = rwrandomizerRegisterBatch(&rwrandKeyedRandBatch);
+    if (rv) {
+        return rv;
+    }
+
+    /* register the options */
+    for (i = 0; keyed_options[i].name; ++i) {
+        rv = rwrandomizerRegisterOption(keyed_options[i].name,
+                                        keyed_options[i].help, &optionHandler,
+                                        &(keyed_options[i].id),
+                                        keyed_options[i].has_arg);
+        if (rv) {
+            return rv;
+        }
+    }
+
+    return rv;
+}
+
+
+/*
+ *  hash = keyedSipHash(key, msg, len);
+ *
+ *    Return the SipHash-2-4 of the 'len' bytes in 'msg' using 'key'.
+ */
+static uint64_t
+keyedSipHash(
+    const keyed_key_t  *key,
+    const uint8_t      *msg,
+    size_t              len)
+{
+    uint64_t v0 = key->k0 ^ UINT64_C(0x736f6d6570736575);
+    uint64_t v1 = key->k1 ^ UINT64_C(0x646f72616e646f6d);
+    uint64_t v2 = key->k0 ^ UINT64_C(0x6c7967656e657261);
+    uint64_t v3 = key->k1 ^ UINT64_C(0x7465646279746573);
+    uint64_t b = (uint64_t)len << 56;
+    uint64_t m;
+    size_t i;
+
+    for ( ; len >= 8; len -= 8, msg += 8) {
+        m = 0;
+        for (i = 0; i < 8; ++i) {
+            m |= (uint64_t)msg[i] << (8 * i);
+        }
+        v3 ^= m;
+        SIPROUND(v0, v1, v2, v3);
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+    for (i = 0; i < len; ++i) {
+        b |= (uint64_t)msg[i] << (8 * i);
+    }
+
+    v3 ^= b;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= b;
+    v2 ^= 0xff;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+
+    return (v0 ^ v1 ^ v2 ^ v3);
+}
+
+
+/*
+ *  flip = keyedPrefixBit(ip, bits);
+ *
+ *    Return the bit that is exclusive-or'ed with bit 'bits' (counting
+ *    from the most significant bit) of 'ip'; it depends only on the
+ *    'bits' most significant bits of 'ip'.
+ */
+static uint32_t
+keyedPrefixBit(
+    uint32_t            ip,
+    unsigned int        bits)
+{
+    uint8_t msg[8];
+    uint32_t prefix;
+
+    prefix = ((bits == 0) ? 0 : (ip & (UINT32_MAX << (32 - bits))));
+
+    /* include the prefix length so that, e.g., 0/1 and 0/2 differ */
+    msg[0] = (uint8_t)(prefix >> 24);
+    msg[1] = (uint8_t)(prefix >> 16);
+    msg[2] = (uint8_t)(prefix >> 8);
+    msg[3] = (uint8_t)(prefix);
+    msg[4] = (uint8_t)bits;
+    msg[5] = msg[6] = msg[7] = 0;
+
+    return (uint32_t)(keyedSipHash(&prf_key, msg, sizeof(msg)) & 1);
+}
+
+
+/*
+ *  result = keyedRandomizeBits(ip, first, last);
+ *
+ *    Return 'ip' with bits 'first' through 'last'-1 (counting from
+ *    the most significant bit) randomized and the other bits
+ *    unchanged.
+ */
+static uint32_t
+keyedRandomizeBits(
+    uint32_t            ip,
+    unsigned int        first,
+    unsigned int        last)
+{
+    uint32_t flips = 0;
+    unsigned int i;
+
+    for (i = first; i < last; ++i) {
+        flips |= keyedPrefixBit(ip, i) << (31 - i);
+    }
+    return ip ^ flips;
+}
+
+
+/*
+ *  cache = keyedGetCache();
+ *
+ *    Return the calling thread's cache of /24 prefixes, creating it
+ *    if necessary.  Return NULL if it cannot be created.
+ */
+static uint64_t *
+keyedGetCache(
+    void)
+{
+    uint64_t *cache;
+
+    if (!cache_key_created) {
+        return NULL;
+    }
+    cache = (uint64_t*)pthread_getspecific(cache_key);
+    if (NULL == cache) {
+        cache = (uint64_t*)calloc(PREFIX_CACHE_SIZE, sizeof(uint64_t));
+        if (cache && pthread_setspecific(cache_key, cache)) {
+            free(cache);
+            cache = NULL;
+        }
+    }
+    return cache;
+}
+
+
+/*
+ *  result = keyedRandomize(cache, ip);
+ *
+ *    Return the randomized value of 'ip', using and updating the
+ *    /24 cache in 'cache' when it is not NULL.
+ */
+static uint32_t
+keyedRandomize(
+    uint64_t           *cache,
+    uint32_t            ip)
+{
+    uint64_t *entry;
+    uint64_t tag;
+    uint32_t prefix;
+
+    if (NULL == cache) {
+        return keyedRandomizeBits(ip, 0, 32);
+    }
+
+    /* find the randomized /24 */
+    tag = PREFIX_CACHE_VALID | ((uint64_t)(ip >> 8) << 24);
+    entry = &cache[(((ip >> 8) * UINT32_C(2654435761))
+                    >> (32 - PREFIX_CACHE_BITS))];
+    if ((*entry & ~UINT64_C(0xffffff)) == tag) {
+        prefix = (uint32_t)(*entry & 0xffffff) << 8;
+    } else {
+        prefix = keyedRandomizeBits(ip, 0, 24) & 0xffffff00;
+        *entry = tag | (prefix >> 8);
+    }
+
+    /* the final octet depends on the unmodified input */
+    return prefix | (keyedRandomizeBits(ip, 24, 32) & 0xff);
+}
+
+
+/*
+ *  status = rwrandKeyedActivate(data);
+ *
+ *    Create the key for the per-thread caches.
+ */
+static int
+rwrandKeyedActivate(
+    void        UNUSED(*dummy))
+{
+    if (pthread_key_create(&cache_key, &free)) {
+        /* work without the caches */
+        return 0;
+    }
+    cache_key_created = 1;
+    return 0;
+}
+
+
+/*
+ *  status = rwrandKeyedDeactivate(data);
+ *
+ *    Free the calling thread's cache and the key for the per-thread
+ *    caches.  The caches of other threads were freed when those
+ *    threads exited.
+ */
+static int
+rwrandKeyedDeactivate(
+    void        UNUSED(*dummy))
+{
+    if (cache_key_created) {
+        free(pthread_getspecific(cache_key));
+        pthread_setspecific(cache_key, NULL);
+        pthread_key_delete(cache_key);
+        cache_key_created = 0;
+    }
+    return 0;
+}
+
+
+/*
+ *  rwrandKeyedRandIP(&ip)
+ *
+ *    Writes the keyed, prefix-preserving randomization of the address
+ *    at 'ip' to that location.
+ */
+static void
+rwrandKeyedRandIP(
+    uint32_t           *ip)
+{
+    *ip = keyedRandomize(keyedGetCache(), *ip);
+}
+
+
+/*
+ *  rwrandKeyedRandBatch(ips, count)
+ *
+ *    Randomize the 'count' addresses in 'ips' in place.  This may be
+ *    called from multiple threads since each uses its own cache.
+ */
+static void
+rwrandKeyedRandBatch(
+    uint32_t           *ips,
+    size_t              count)
+{
+    uint64_t *cache = keyedGetCache();
+    size_t i;
+
+    for (i = 0; i < count; ++i) {
+        ips[i] = keyedRandomize(cache, ips[i]);
+    }
+}
+
+
+/*
+ *  status = loadKeyFile(filename);
+ *
+ *    Derive the key for the pseudo-random function from the contents
+ *    of 'filename'.
+ */
+static int
+loadKeyFile(
+    const char         *filename)
+{
+    /* fixed keys used to derive the two halves of the real key */
+    static const keyed_key_t derive_key[2] = {
+        {UINT64_C(0x0706050403020100), UINT64_C(0x0f0e0d0c0b0a0908)},
+        {UINT64_C(0x1716151413121110), UINT64_C(0x1f1e1d1c1b1a1918)}
+    };
+    uint8_t *contents = NULL;
+    size_t len = 0;
+    size_t alloc = 0;
+    size_t n;
+    FILE *fp;
+    int rv = -1;
+
+    fp = fopen(filename, "rb");
+    if (NULL == fp) {
+        skAppPrintSyserror("Unable to open key file '%s'", filename);
+        return -1;
+    }
+
+    do {
+        if (len == alloc) {
+            uint8_t *old_contents = contents;
+            alloc = ((alloc) ? 2 * alloc : 4096);
+            contents = (uint8_t*)realloc(contents, alloc);
+            if (NULL == contents) {
+                free(old_contents);
+                skAppPrintOutOfMemory("key file contents");
+                goto END;
+            }
+        }
+        n = fread(contents + len, 1, alloc - len, fp);
+        len += n;
+    } while (n > 0);
+
+    if (ferror(fp)) {
+        skAppPrintSyserror("Error reading key file '%s'", filename);
+        goto END;
+    }
+    if (len < KEY_FILE_MIN_BYTES) {
+        skAppPrintErr("Key file '%s' must contain at least %d bytes",
+                      filename, KEY_FILE_MIN_BYTES);
+        goto END;
+    }
+
+    prf_key.k0 = keyedSipHash(&derive_key[0], contents, len);
+    prf_key.k1 = keyedSipHash(&derive_key[1], contents, len);
+    rv = 0;
+
+  END:
+    free(contents);
+    fclose(fp);
+    return rv;
+}
+
+
+/*
+ *  status = optionHandler(opt_arg, data);
+ *
+ *    Handle the switches this back-end registered.  'data' points to
+ *    the identifier of the switch.  Return 0 on success or non-zero
+ *    if the switch's argument is invalid.
+ */
+static int
+optionHandler(
+    char               *opt_arg,
+    void               *data)
+{
+    int id = *((int*)data);
+
+    switch ((keyedOptionEnum)id) {
+      case OPT_KEY_FILE:
+        if (loadKeyFile(opt_arg)) {
+            return 1;
+        }
+        break;
+    }
+
+    return 0;                     /* OK */
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -129,6 +129,7 @@ static struct rand_option_st {
 static int  optionHandler(char *opt_arg, void *data);
 static int  rwrandShuffleActivate(void *data);
 static void rwrandShuffleRandIP(uint32_t *ip);
+static void rwrandShuffleRandBatch(uint32_t *ips, size_t count);
 static void createShuffleTable(void);
 static int  loadShuffleFile(const char *filename);
 static int  saveShuffleFile(const char *filename);
@@ -155,6 +156,10 @@ rwrandShuffleLoad(
     if (rv) {
         return rv;
     }
+    rv = rwrandomizerRegisterBatch(&rwrandShuffleRandBatch);
+    if (rv) {
+        return rv;
+    }
 
     /* register the options */
     for (i = 0; rand_options[i].name; ++i) {
@@ -273,6 +278,26 @@ rwrandShuffleRandIP(
 }
 
 
+/*
+ *  rwrandShuffleRandBatch(ips, count)
+ *
+ *    Modifies the 'count' addresses in 'ips' using the shuffle table.
+ *    Since the table is not modified once it is built, this may be
+ *    called from multiple threads.
+ */
+static void
+rwrandShuffleRandBatch(
+    uint32_t           *ips,
+    size_t              count)
+{
+    size_t i;
+
+    for (i = 0; i < count; ++i) {
+        rwrandShuffleRandIP(&ips[i]);
+    }
+}
+
+
 /*
  *  createShuffleTable();
  *
@@ -86,10 +86,17 @@ RCSIDENT("$SiLK: rwrandomizeip.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 /* File handle for --help output */
 #define USAGE_FH stdout
 
+/* environment variable that sets the default number of threads */
+#define RWRAND_THREADS_ENVAR  "SILK_RWRANDOMIZEIP_THREADS"
+
+/* number of records each thread randomizes at a time */
+#define RWRAND_BLOCK_SIZE  4096
+
 /* An interface to a randomization back-end */
 typedef struct randomizer_st {
     randomizer_activate_fn_t    activate_fn;
     randomizer_modifyip_fn_t    modifyip_fn;
+    randomizer_modifyip_batch_fn_t  batch_fn;
     randomizer_deactivate_fn_t  deactivate_fn;
     randomizer_unload_fn_t      unload_fn;
     void                       *back_end_data;
@@ -107,6 +114,41 @@ typedef struct backend_option_st {
     int                         seen;
 } backend_option_t;
 
+/* A block of records that a thread randomizes at once */
+typedef struct rand_block_st {
+    rwRec      *recs;
+    /* the addresses being randomized */
+    uint32_t   *ips;
+    /* for each record, whether its sIP (bit 0) and dIP (bit 1) are
+     * among the 'ips' */
+    uint8_t    *which;
+    size_t      count;
+    /* where the block is in the pipeline; see randomizeThreaded() */
+    int         state;
+} rand_block_t;
+
+/* The state shared by the threads of randomizeThreaded() */
+typedef struct rand_pipeline_st {
+    skstream_t         *in_ios;
+    rand_block_t       *block;
+    size_t              block_count;
+    randomizer_modifyip_batch_fn_t  batch_fn;
+    /* sequence number of the next block to read; once 'eof' is set,
+     * this is the number of blocks */
+    uint64_t            next_read;
+    /* sequence number of the next block to randomize */
+    uint64_t            next_randomize;
+    unsigned            eof     :1;
+    unsigned            stop    :1;
+    pthread_mutex_t     mutex;
+    pthread_cond_t      cond;
+} rand_pipeline_t;
+
+/* states of a block */
+enum {
+    BLOCK_EMPTY, BLOCK_READ, BLOCK_READY
+};
+
 
 /* LOCAL VARIABLES */
 
@@ -123,6 +165,7 @@ static int seed_specified = 0;
 
 static randomizer_load_fn_t randomizer_load[] = {
     &rwrandShuffleLoad,
+    &rwrandKeyedLoad,
     NULL /* sentinel */
 };
 
@@ -142,17 +185,21 @@ static randomizer_t *g_randomizer = NULL;
 /* back-end ID.  this is only used when registering back-ends */
 static int back_end_id = -1;
 
+/* number of threads to use when the back-end supports them */
+static uint32_t thread_count = 1;
+
 
 /* OPTIONS */
 
 enum {
-    OPT_SEED, OPT_ONLY_CHANGE_SET, OPT_DONT_CHANGE_SET
+    OPT_SEED, OPT_ONLY_CHANGE_SET, OPT_DONT_CHANGE_SET, OPT_THREADS
 };
 
 static struct option appOptions[] = {
     {"seed",                    REQUIRED_ARG, 0, OPT_SEED},
     {"only-change-set",         REQUIRED_ARG, 0, OPT_ONLY_CHANGE_SET},
     {"dont-change-set",         REQUIRED_ARG, 0, OPT_DONT_CHANGE_SET},
+    {"threads",                 REQUIRED_ARG, 0, OPT_THREADS},
     {0,0,0,0}  /* sentinel entry */
 };
 
@@ -162,6 +209,9 @@ static const char *appHelp[] = {
      "\tfile. Def. Change all IPs"),
     ("Do not modify IPs that appear in the specified IPset\n"
      "\tfile.  Supersedes IPs in only-change-set. Def. Change all IPs"),
+    ("Randomize blocks of records using this many threads when\n"
+     "\tthe randomization is consistent. Def. $" RWRAND_THREADS_ENVAR
+     " or 1"),
     NULL
 };
 
@@ -173,6 +223,8 @@ static int  appOptionsHandler(clientData cData, int opt_index, char *opt_arg);
 static int  addBackends(void);
 static int  determineBackend(randomizer_t **back_end);
 static int  randomizeFile(const char *in, const char *out);
+static int  changeSIP(const rwRec *rwrec);
+static int  changeDIP(const rwRec *rwrec);
 static void randomizeIP(uint32_t *ip);
 
 
@@ -298,6 +350,8 @@ appSetup(
     char              **argv)
 {
     SILK_FEATURES_DEFINE_STRUCT(features);
+    const char *env;
+    uint32_t tc;
     int arg_index;
 
     /* verify same number of options and help strings */
@@ -329,6 +383,14 @@ appSetup(
         exit(EXIT_FAILURE);
     }
 
+    /* check the thread count envar */
+    env = getenv(RWRAND_THREADS_ENVAR);
+    if (env && env[0]) {
+        if (skStringParseUint32(&tc, env, 1, 0) == 0) {
+            thread_count = tc;
+        }
+    }
+
     /* parse options */
     arg_index = skOptionsParse(argc, argv);
     assert(arg_index <= argc);
@@ -472,6 +534,16 @@ appOptionsHandler(
         }
         skStreamDestroy(&stream);
         break;
+
+      case OPT_THREADS:
+        rv = skStringParseUint32(&thread_count, opt_arg, 1, 0);
+        if (rv) {
+            skAppPrintErr("Invalid %s '%s': %s",
+                          appOptions[opt_index].name, opt_arg,
+                          skStringParseStrerror(rv));
+            return 1;
+        }
+        break;
     }
 
     return 0;                     /* OK */
@@ -655,6 +727,31 @@ rwrandomizerRegister(
 }
 
 
+/* Register a back-end's batch function.  See rwrandomizeip.h */
+int
+rwrandomizerRegisterBatch(
+    randomizer_modifyip_batch_fn_t  batch_fn)
+{
+    randomizer_t *backend;
+    size_t count;
+
+    assert(backend_vec);
+    assert(back_end_id != -1);
+
+    /* the back-end being loaded is the most recently registered */
+    count = skVectorGetCount(backend_vec);
+    if (0 == count
+        || skVectorGetValue(&backend, backend_vec, count - 1)
+        || backend->id != back_end_id)
+    {
+        return -1;
+    }
+    backend->batch_fn = batch_fn;
+
+    return 0;
+}
+
+
 /* Register an option for a back-end.  See rwrandomizeip.h */
 int
 rwrandomizerRegisterOption(
@@ -758,6 +855,308 @@ randomizeIP(
 }
 
 
+/*
+ *  yes = changeSIP(rwrec);
+ *  yes = changeDIP(rwrec);
+ *
+ *    Return true if the source (destination) address of 'rwrec'
+ *    should be randomized given the --only-change-set and
+ *    --dont-change-set switches.
+ */
+static int
+changeSIP(
+    const rwRec        *rwrec)
+{
+    return ((!dont_change_set
+             || !skIPSetCheckRecordSIP(dont_change_set, rwrec))
+            && (!only_change_set
+                || skIPSetCheckRecordSIP(only_change_set, rwrec)));
+}
+
+static int
+changeDIP(
+    const rwRec        *rwrec)
+{
+    return ((!dont_change_set
+             || !skIPSetCheckRecordDIP(dont_change_set, rwrec))
+            && (!only_change_set
+                || skIPSetCheckRecordDIP(only_change_set, rwrec)));
+}
+
+
+/*
+ *  randomizeBlock(block, batch_fn);
+ *
+ *    Randomize the addresses of the records in 'block' by gathering
+ *    the addresses to change into one array, passing that array to
+ *    'batch_fn', and storing the results back into the records.
+ */
+static void
+randomizeBlock(
+    rand_block_t                   *block,
+    randomizer_modifyip_batch_fn_t  batch_fn)
+{
+    size_t n = 0;
+    size_t i;
+
+    for (i = 0; i < block->count; ++i) {
+        block->which[i] = 0;
+        if (changeSIP(&block->recs[i])) {
+            block->which[i] |= 1;
+            block->ips[n++] = rwRecGetSIPv4(&block->recs[i]);
+        }
+        if (changeDIP(&block->recs[i])) {
+            block->which[i] |= 2;
+            block->ips[n++] = rwRecGetDIPv4(&block->recs[i]);
+        }
+    }
+
+    batch_fn(block->ips, n);
+
+    n = 0;
+    for (i = 0; i < block->count; ++i) {
+        if (block->which[i] & 1) {
+            rwRecSetSIPv4(&block->recs[i], block->ips[n++]);
+        }
+        if (block->which[i] & 2) {
+            rwRecSetDIPv4(&block->recs[i], block->ips[n++]);
+        }
+    }
+}
+
+
+/*
+ *    THREAD ENTRY POINT
+ *
+ *    Fill the blocks in sequence with records from the input stream
+ *    until the stream is exhausted.
+ */
+static void *
+randomizeReader(
+    void               *v_pipe)
+{
+    rand_pipeline_t *pipe = (rand_pipeline_t *)v_pipe;
+    rand_block_t *block;
+    int in_rv = SKSTREAM_OK;
+
+    pthread_mutex_lock(&pipe->mutex);
+    while (!pipe->stop) {
+        block = &pipe->block[pipe->next_read % pipe->block_count];
+        if (BLOCK_EMPTY != block->state) {
+            pthread_cond_wait(&pipe->cond, &pipe->mutex);
+            continue;
+        }
+        pthread_mutex_unlock(&pipe->mutex);
+
+        for (block->count = 0; block->count < RWRAND_BLOCK_SIZE; ) {
+            in_rv = skStreamReadRecord(pipe->in_ios,
+                                       &block->recs[block->count]);
+            if (SKSTREAM_OK != in_rv) {
+                break;
+            }
+            ++block->count;
+        }
+
+        pthread_mutex_lock(&pipe->mutex);
+        if (block->count) {
+            block->state = BLOCK_READ;
+            ++pipe->next_read;
+        }
+        if (SKSTREAM_OK != in_rv) {
+            pipe->eof = 1;
+        }
+        pthread_cond_broadcast(&pipe->cond);
+        if (pipe->eof) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pipe->mutex);
+
+    if (SKSTREAM_OK != in_rv && SKSTREAM_ERR_EOF != in_rv) {
+        skStreamPrintLastErr(pipe->in_ios, in_rv, &skAppPrintErr);
+    }
+
+    return NULL;
+}
+
+
+/*
+ *    THREAD ENTRY POINT
+ *
+ *    Randomize blocks as the reader fills them.  Any number of these
+ *    threads may run.
+ */
+static void *
+randomizeWorker(
+    void               *v_pipe)
+{
+    rand_pipeline_t *pipe = (rand_pipeline_t *)v_pipe;
+    rand_block_t *block;
+
+    pthread_mutex_lock(&pipe->mutex);
+    for (;;) {
+        while (!pipe->stop && !pipe->eof
+               && pipe->next_randomize == pipe->next_read)
+        {
+            pthread_cond_wait(&pipe->cond, &pipe->mutex);
+        }
+        if (pipe->stop || pipe->next_randomize == pipe->next_read) {
+            break;
+        }
+        /* claim the block; the reader cannot reuse it until it has
+         * been written, so no lock is needed to randomize it */
+        block = &pipe->block[pipe->next_randomize % pipe->block_count];
+        ++pipe->next_randomize;
+        pthread_mutex_unlock(&pipe->mutex);
+
+        randomizeBlock(block, pipe->batch_fn);
+
+        pthread_mutex_lock(&pipe->mutex);
+        block->state = BLOCK_READY;
+        pthread_cond_broadcast(&pipe->cond);
+    }
+    pthread_mutex_unlock(&pipe->mutex);
+
+    return NULL;
+}
+
+
+/*
+ *  status = randomizeThreaded(in_ios, out_ios, batch_fn);
+ *
+ *    Copy the records from 'in_ios' to 'out_ios' while 'thread_count'
+ *    threads randomize the addresses with 'batch_fn'.  A reader
+ *    thread fills blocks of records, the workers randomize the blocks
+ *    in any order, and the calling thread writes the blocks in the
+ *    order they were read, so the output matches that of a single
+ *    thread.  Return 0 on success or the status of the write that
+ *    failed.
+ */
+static int
+randomizeThreaded(
+    skstream_t                     *in_ios,
+    skstream_t                     *out_ios,
+    randomizer_modifyip_batch_fn_t  batch_fn)
+{
+    rand_pipeline_t pipe;
+    rand_block_t *block;
+    pthread_t reader;
+    pthread_t *workers = NULL;
+    uint32_t started = 0;
+    uint64_t seq;
+    size_t i;
+    int done;
+    int rv = SKSTREAM_ERR_ALLOC;
+
+    memset(&pipe, 0, sizeof(pipe));
+    pipe.in_ios = in_ios;
+    pipe.batch_fn = batch_fn;
+    pthread_mutex_init(&pipe.mutex, NULL);
+    pthread_cond_init(&pipe.cond, NULL);
+
+    /* give every worker two blocks so a slow block does not stall the
+     * others, plus one each for the reader and writer */
+    pipe.block_count = 2 * thread_count + 2;
+    pipe.block = (rand_block_t *)calloc(pipe.block_count,
+                                        sizeof(rand_block_t));
+    if (NULL == pipe.block) {
+        skAppPrintOutOfMemory("record blocks");
+        goto END;
+    }
+    for (i = 0; i < pipe.block_count; ++i) {
+        block = &pipe.block[i];
+        block->recs = (rwRec *)malloc(RWRAND_BLOCK_SIZE * sizeof(rwRec));
+        block->ips = (uint32_t *)malloc(2 * RWRAND_BLOCK_SIZE
+                                        * sizeof(uint32_t));
+        block->which = (uint8_t *)malloc(RWRAND_BLOCK_SIZE);
+        if (!block->recs || !block->ips || !block->which) {
+            skAppPrintOutOfMemory("record blocks");
+            goto END;
+        }
+    }
+    workers = (pthread_t *)calloc(thread_count, sizeof(pthread_t));
+    if (NULL == workers) {
+        skAppPrintOutOfMemory("thread handles");
+        goto END;
+    }
+
+    /* start the threads */
+    if (pthread_create(&reader, NULL, &randomizeReader, &pipe)) {
+        skAppPrintErr("Unable to create reader thread");
+        goto END;
+    }
+    for (started = 0; started < thread_count; ++started) {
+        if (pthread_create(&workers[started], NULL, &randomizeWorker, &pipe)){
+            skAppPrintErr("Unable to create randomization thread");
+            if (0 == started) {
+                pthread_mutex_lock(&pipe.mutex);
+                pipe.stop = 1;
+                pthread_cond_broadcast(&pipe.cond);
+                pthread_mutex_unlock(&pipe.mutex);
+            }
+            break;
+        }
+    }
+
+    /* write the blocks in order */
+    rv = 0;
+    for (seq = 0; ; ++seq) {
+        block = &pipe.block[seq % pipe.block_count];
+
+        pthread_mutex_lock(&pipe.mutex);
+        while (!pipe.stop && BLOCK_READY != block->state
+               && !(pipe.eof && seq == pipe.next_read))
+        {
+            pthread_cond_wait(&pipe.cond, &pipe.mutex);
+        }
+        done = (pipe.stop || BLOCK_READY != block->state);
+        pthread_mutex_unlock(&pipe.mutex);
+        if (done) {
+            break;
+        }
+
+        for (i = 0; i < block->count; ++i) {
+            rv = skStreamWriteRecord(out_ios, &block->recs[i]);
+            if (SKSTREAM_ERROR_IS_FATAL(rv)) {
+                break;
+            }
+        }
+
+        pthread_mutex_lock(&pipe.mutex);
+        if (SKSTREAM_ERROR_IS_FATAL(rv)) {
+            pipe.stop = 1;
+        } else {
+            block->state = BLOCK_EMPTY;
+        }
+        pthread_cond_broadcast(&pipe.cond);
+        pthread_mutex_unlock(&pipe.mutex);
+        if (SKSTREAM_ERROR_IS_FATAL(rv)) {
+            break;
+        }
+    }
+
+    pthread_join(reader, NULL);
+    for (i = 0; i < started; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+
+  END:
+    if (pipe.block) {
+        for (i = 0; i < pipe.block_count; ++i) {
+            free(pipe.block[i].recs);
+            free(pipe.block[i].ips);
+            free(pipe.block[i].which);
+        }
+        free(pipe.block);
+    }
+    free(workers);
+    pthread_mutex_destroy(&pipe.mutex);
+    pthread_cond_destroy(&pipe.cond);
+
+    return rv;
+}
+
+
 /*
  *  randomizeFile(input_path, output_path)
  *
@@ -821,23 +1220,22 @@ randomizeFile(
         goto END;
     }
 
+    /* the back-ends that supply a batch function give the same
+     * results regardless of the number of threads */
+    if (thread_count > 1 && g_randomizer && g_randomizer->batch_fn) {
+        rv = randomizeThreaded(in_ios, out_ios, g_randomizer->batch_fn);
+        goto END;
+    }
+
     /* read the records and randomize the IP addresses */
     while ((in_rv = skStreamReadRecord(in_ios, &rwrec)) == SKSTREAM_OK) {
-        if ((!dont_change_set
-             || !skIPSetCheckRecordSIP(dont_change_set, &rwrec))
-            && (!only_change_set
-                || skIPSetCheckRecordSIP(only_change_set, &rwrec)))
-        {
+        if (changeSIP(&rwrec)) {
             uint32_t ipv4 = rwRecGetSIPv4(&rwrec);
             rand_ip_fn(&ipv4);
             rwRecSetSIPv4(&rwrec, ipv4);
         }
 
-        if ((!dont_change_set
-             || !skIPSetCheckRecordDIP(dont_change_set, &rwrec))
-            && (!only_change_set
-                || skIPSetCheckRecordDIP(only_change_set, &rwrec)))
-        {
+        if (changeDIP(&rwrec)) {
             uint32_t ipv4 = rwRecGetDIPv4(&rwrec);
             rand_ip_fn(&ipv4);
             rwRecSetDIPv4(&rwrec, ipv4);
@@ -108,6 +108,16 @@ typedef int (*randomizer_activate_fn_t)(void *back_end_data);
  */
 typedef void (*randomizer_modifyip_fn_t)(uint32_t *ip);
 
+/*
+ *    A back-end may also supply this function to modify the 'count'
+ *    addresses in the array 'ips' in place.  By supplying it, the
+ *    back-end promises that it may be called from several threads at
+ *    once and that the value it gives an address does not depend on
+ *    the order in which addresses are seen; rwrandomizeip only uses
+ *    multiple threads when the active back-end provides one.
+ */
+typedef void (*randomizer_modifyip_batch_fn_t)(uint32_t *ips, size_t count);
+
 
 /*
  *    Once processing of input is complete, the deactivate function is
@@ -155,6 +165,16 @@ rwrandomizerRegister(
     void                       *back_end_data);
 
 
+/*
+ *    A back-end that can modify a batch of addresses from multiple
+ *    threads calls this function after rwrandomizerRegister() to
+ *    register the function that does so.
+ */
+int
+rwrandomizerRegisterBatch(
+    randomizer_modifyip_batch_fn_t  batch_fn);
+
+
 /*
  *    Any options that the back-end accepts must be registered with
  *    the main rwrandomizeip application by calling this function.
@@ -188,6 +208,10 @@ int
 rwrandShuffleLoad(
     void);
 
+int
+rwrandKeyedLoad(
+    void);
+
 
 #ifdef __cplusplus
 }
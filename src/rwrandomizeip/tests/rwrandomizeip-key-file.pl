@@ -0,0 +1,17 @@
+#! /usr/bin/perl -w
+# MD5: 11f2a12bb7fbd0ee8bf57023588b4283
+# TEST: printf 'rwrandomizeip test key 0123456789\n' > /tmp/rwrandomizeip-key-file-key && ./rwrandomizeip --key-file=/tmp/rwrandomizeip-key-file-key ../../tests/data.rwf - | ../rwcat/rwcat --compression-method=none --byte-order=little --ipv4-output
+
+use strict;
+use SiLKTests;
+
+my $rwrandomizeip = check_silk_app('rwrandomizeip');
+my $rwcat = check_silk_app('rwcat');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my %temp;
+$temp{key} = make_tempname('key');
+my $cmd = "printf 'rwrandomizeip test key 0123456789\\n' > $temp{key} && $rwrandomizeip --key-file=$temp{key} $file{data} - | $rwcat --compression-method=none --byte-order=little --ipv4-output";
+my $md5 = "11f2a12bb7fbd0ee8bf57023588b4283";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,662 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  flow-export.c
+**
+**    Send flow records to a collector as NetFlow v5 or IPFIX.  See
+**    flow-export.h for details.
+*/
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: flow-export.c $");
+
+#include <silk/utils.h>
+#include <silk/v5pdu.h>
+#if SK_ENABLE_IPFIX
+#include <fixbuf/public.h>
+#endif
+#include "flow-export.h"
+
+
+/* LOCAL DEFINES AND TYPEDEFS */
+
+/*
+ *    Number of records to put into each IPFIX message.  This is small
+ *    enough that a message of export_ipfix_rec_t records fits into
+ *    the MTU libfixbuf uses for UDP, so every message the exporter
+ *    emits is one packet.
+ */
+#define FLOW_EXPORT_IPFIX_RECS  20
+
+/* template ID of the IPFIX records */
+#define FLOW_EXPORT_IPFIX_TID  0x5C10
+
+#if SK_ENABLE_IPFIX
+/* The IPFIX template; keep in sync with export_ipfix_rec_t */
+static fbInfoElementSpec_t export_ipfix_spec[] = {
+    { (char*)"flowStartMilliseconds",              8, 0 },
+    { (char*)"flowEndMilliseconds",                8, 0 },
+    { (char*)"packetDeltaCount",                   8, 0 },
+    { (char*)"octetDeltaCount",                    8, 0 },
+    { (char*)"sourceIPv4Address",                  4, 0 },
+    { (char*)"destinationIPv4Address",             4, 0 },
+    { (char*)"ipNextHopIPv4Address",               4, 0 },
+    { (char*)"ingressInterface",                   4, 0 },
+    { (char*)"egressInterface",                    4, 0 },
+    { (char*)"sourceTransportPort",                2, 0 },
+    { (char*)"destinationTransportPort",           2, 0 },
+    { (char*)"protocolIdentifier",                 1, 0 },
+    { (char*)"tcpControlBits",                     1, 0 },
+    { (char*)"paddingOctets",                      6, 0 },
+    FB_IESPEC_NULL
+};
+
+typedef struct export_ipfix_rec_st {
+    uint64_t        flowStartMilliseconds;          /*  0- 7 */
+    uint64_t        flowEndMilliseconds;            /*  8-15 */
+    uint64_t        packetDeltaCount;               /* 16-23 */
+    uint64_t        octetDeltaCount;                /* 24-31 */
+    uint32_t        sourceIPv4Address;              /* 32-35 */
+    uint32_t        destinationIPv4Address;         /* 36-39 */
+    uint32_t        ipNextHopIPv4Address;           /* 40-43 */
+    uint32_t        ingressInterface;               /* 44-47 */
+    uint32_t        egressInterface;                /* 48-51 */
+    uint16_t        sourceTransportPort;            /* 52-53 */
+    uint16_t        destinationTransportPort;       /* 54-55 */
+    uint8_t         protocolIdentifier;             /* 56    */
+    uint8_t         tcpControlBits;                 /* 57    */
+    uint8_t         pad[6];                         /* 58-63 */
+} export_ipfix_rec_t;
+#endif  /* SK_ENABLE_IPFIX */
+
+
+struct flow_export_st {
+    /* the collector, for error messages */
+    char                host_port[256];
+    /* the socket for NetFlow v5 */
+    int                 fd;
+    /* the NetFlow v5 PDU being built */
+    v5PDU               pdu;
+    /* when the pretend router booted */
+    sktime_t            boot_time;
+    /* the latest end time in the PDU, used as its export time */
+    sktime_t            pdu_time;
+    /* the sequence number of the next PDU */
+    uint32_t            flow_sequence;
+#if SK_ENABLE_IPFIX
+    fbInfoModel_t      *model;
+    fBuf_t             *fbuf;
+#endif
+    /* number of records in the packet being built */
+    uint32_t            pending;
+    /* the limits set by flowExportSetRate() */
+    double              records_per_sec;
+    double              packets_per_sec;
+    /* when the first and the most recent packets were sent */
+    struct timeval      first_send;
+    struct timeval      last_send;
+    flow_export_stats_t stats;
+    flow_export_proto_t proto;
+};
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  exportElapsed(exporter, now);
+ *
+ *    Return the seconds between the first packet 'exporter' sent and
+ *    'now'.
+ */
+static double
+exportElapsed(
+    const flow_export_t    *exporter,
+    const struct timeval   *now)
+{
+    return ((double)(now->tv_sec - exporter->first_send.tv_sec)
+            + ((double)(now->tv_usec - exporter->first_send.tv_usec)
+               / 1000000.0));
+}
+
+
+/*
+ *  exportPace(exporter);
+ *
+ *    Called immediately before 'exporter' sends a packet.  Sleep
+ *    until the time the packet is due under the limits set by
+ *    flowExportSetRate().  The first packet is never delayed; it
+ *    starts the clock.
+ */
+static void
+exportPace(
+    flow_export_t      *exporter)
+{
+    struct timeval now;
+    struct timespec ts;
+    double due = 0.0;
+    double wait;
+
+    gettimeofday(&now, NULL);
+    if (0 == exporter->stats.packets) {
+        exporter->first_send = now;
+        exporter->last_send = now;
+        return;
+    }
+    if (exporter->records_per_sec > 0.0) {
+        due = (double)exporter->stats.records / exporter->records_per_sec;
+    }
+    if (exporter->packets_per_sec > 0.0) {
+        wait = (double)exporter->stats.packets / exporter->packets_per_sec;
+        if (wait > due) {
+            due = wait;
+        }
+    }
+    wait = due - exportElapsed(exporter, &now);
+    if (wait > 0.0) {
+        ts.tv_sec = (time_t)wait;
+        ts.tv_nsec = (long)((wait - (double)ts.tv_sec) * 1e9);
+        while (nanosleep(&ts, &ts) == -1 && EINTR == errno)
+            ;                   /* empty */
+        gettimeofday(&now, NULL);
+    }
+    exporter->last_send = now;
+}
+
+
+/*
+ *  status = exportSendV5(exporter);
+ *
+ *    Fill the header of the PDU 'exporter' has built and send it.
+ *    Return 0 unless the operating system refused the PDU for a
+ *    reason other than UDP's unreliability, in which case return -1.
+ */
+static int
+exportSendV5(
+    flow_export_t      *exporter)
+{
+    v5Header *hdr = &exporter->pdu.hdr;
+    uint32_t count = exporter->pending;
+    ssize_t rv;
+
+    if (0 == count) {
+        return 0;
+    }
+
+    hdr->version = htons(5);
+    hdr->count = htons((uint16_t)count);
+    hdr->SysUptime = htonl((uint32_t)(exporter->pdu_time
+                                      - exporter->boot_time));
+    hdr->unix_secs = htonl((uint32_t)(exporter->pdu_time / 1000));
+    hdr->unix_nsecs = htonl((uint32_t)(exporter->pdu_time % 1000) * 1000000);
+    hdr->flow_sequence = htonl(exporter->flow_sequence);
+
+    exportPace(exporter);
+    do {
+        rv = send(exporter->fd, &exporter->pdu,
+                  sizeof(v5Header) + count * sizeof(v5Record), 0);
+    } while (-1 == rv && EINTR == errno);
+
+    /* advance the sequence number even when the send fails so the
+     * collector counts the records as missing */
+    exporter->flow_sequence += count;
+    exporter->stats.records += count;
+    ++exporter->stats.packets;
+    exporter->pending = 0;
+    exporter->pdu_time = 0;
+
+    if (-1 == rv) {
+        switch (errno) {
+          case ECONNREFUSED:
+          case ENOBUFS:
+          case EAGAIN:
+            /* nothing is listening or the buffers are full */
+            ++exporter->stats.send_errors;
+            return 0;
+          default:
+            skAppPrintErr("Error sending to %s: %s",
+                          exporter->host_port, strerror(errno));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ *  exportAddV5(exporter, rwrec);
+ *
+ *    Add 'rwrec' to the NetFlow v5 PDU that 'exporter' is building.
+ */
+static void
+exportAddV5(
+    flow_export_t      *exporter,
+    const rwRec        *rwrec)
+{
+    v5Record *v5r = &exporter->pdu.data[exporter->pending];
+    sktime_t etime = rwRecGetEndTime(rwrec);
+
+    memset(v5r, 0, sizeof(v5Record));
+    v5r->srcaddr = htonl(rwRecGetSIPv4(rwrec));
+    v5r->dstaddr = htonl(rwRecGetDIPv4(rwrec));
+    v5r->nexthop = htonl(rwRecGetNhIPv4(rwrec));
+    v5r->input = htons(rwRecGetInput(rwrec));
+    v5r->output = htons(rwRecGetOutput(rwrec));
+    v5r->dPkts = htonl(rwRecGetPkts(rwrec));
+    v5r->dOctets = htonl(rwRecGetBytes(rwrec));
+    /* times are milliseconds since boot; they wrap as a router's do */
+    v5r->First = htonl((uint32_t)(rwRecGetStartTime(rwrec)
+                                  - exporter->boot_time));
+    v5r->Last = htonl((uint32_t)(etime - exporter->boot_time));
+    v5r->srcport = htons(rwRecGetSPort(rwrec));
+    v5r->dstport = htons(rwRecGetDPort(rwrec));
+    v5r->tcp_flags = rwRecGetFlags(rwrec);
+    v5r->prot = rwRecGetProto(rwrec);
+
+    if (etime > exporter->pdu_time) {
+        exporter->pdu_time = etime;
+    }
+    ++exporter->pending;
+}
+
+
+#if SK_ENABLE_IPFIX
+/*
+ *  exportPrintGError(exporter, err);
+ *
+ *    Print the message in 'err' and free it.
+ */
+static void
+exportPrintGError(
+    const flow_export_t    *exporter,
+    GError                 *err)
+{
+    skAppPrintErr("Error sending IPFIX to %s: %s",
+                  exporter->host_port, (err ? err->message : "unknown"));
+    g_clear_error(&err);
+}
+
+
+/*
+ *  status = exportCreateIpfix(exporter, addr);
+ *
+ *    Create the libfixbuf session and buffer that send IPFIX from
+ *    'exporter' to 'addr', and add the template to the session.
+ */
+static int
+exportCreateIpfix(
+    flow_export_t          *exporter,
+    const sk_sockaddr_t    *addr)
+{
+    char host[NI_MAXHOST];
+    char svc[NI_MAXSERV];
+    fbConnSpec_t spec;
+    fbExporter_t *fbexp;
+    fbSession_t *session;
+    fbTemplate_t *tmpl;
+    GError *err = NULL;
+    int rv;
+
+    rv = getnameinfo(&addr->sa, skSockaddrLen(addr), host, sizeof(host),
+                     svc, sizeof(svc), NI_NUMERICHOST | NI_NUMERICSERV);
+    if (rv) {
+        skAppPrintErr("Cannot get address of %s: %s",
+                      exporter->host_port, gai_strerror(rv));
+        return -1;
+    }
+
+    memset(&spec, 0, sizeof(spec));
+    spec.transport = ((FLOW_EXPORT_IPFIX_TCP == exporter->proto)
+                      ? FB_TCP : FB_UDP);
+    spec.host = host;
+    spec.svc = svc;
+
+    exporter->model = fbInfoModelAlloc();
+    fbexp = fbExporterAllocNet(&spec);
+    if (NULL == fbexp) {
+        skAppPrintErr("Cannot create IPFIX exporter for %s",
+                      exporter->host_port);
+        return -1;
+    }
+    session = fbSessionAlloc(exporter->model);
+    tmpl = fbTemplateAlloc(exporter->model);
+    if (!fbTemplateAppendSpecArray(tmpl, export_ipfix_spec, 0, &err)
+        || !fbSessionAddTemplate(session, TRUE, FLOW_EXPORT_IPFIX_TID,
+                                 tmpl, &err)
+        || !fbSessionAddTemplate(session, FALSE, FLOW_EXPORT_IPFIX_TID,
+                                 tmpl, &err))
+    {
+        exportPrintGError(exporter, err);
+        fbTemplateFreeUnused(tmpl);
+        fbSessionFree(session);
+        fbExporterFree(fbexp);
+        return -1;
+    }
+
+    /* the buffer owns the session and the exporter from here on */
+    exporter->fbuf = fBufAllocForExport(session, fbexp);
+    if (!fbSessionExportTemplates(session, &err)
+        || !fBufSetInternalTemplate(exporter->fbuf, FLOW_EXPORT_IPFIX_TID,
+                                    &err)
+        || !fBufSetExportTemplate(exporter->fbuf, FLOW_EXPORT_IPFIX_TID,
+                                  &err))
+    {
+        exportPrintGError(exporter, err);
+        return -1;
+    }
+    return 0;
+}
+
+
+/*
+ *  status = exportSendIpfix(exporter);
+ *
+ *    Emit the IPFIX message 'exporter' has built.  Return 0 on
+ *    success or -1 on failure.
+ */
+static int
+exportSendIpfix(
+    flow_export_t      *exporter)
+{
+    uint32_t count = exporter->pending;
+    GError *err = NULL;
+
+    if (0 == count) {
+        return 0;
+    }
+
+    exportPace(exporter);
+    exporter->stats.records += count;
+    ++exporter->stats.packets;
+    exporter->pending = 0;
+    if (!fBufEmit(exporter->fbuf, &err)) {
+        exportPrintGError(exporter, err);
+        return -1;
+    }
+    return 0;
+}
+
+
+/*
+ *  status = exportAddIpfix(exporter, rwrec);
+ *
+ *    Append 'rwrec' to the IPFIX message that 'exporter' is
+ *    building.  Return 0 on success or -1 on failure.
+ */
+static int
+exportAddIpfix(
+    flow_export_t      *exporter,
+    const rwRec        *rwrec)
+{
+    export_ipfix_rec_t rec;
+    GError *err = NULL;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.flowStartMilliseconds = (uint64_t)rwRecGetStartTime(rwrec);
+    rec.flowEndMilliseconds = (uint64_t)rwRecGetEndTime(rwrec);
+    rec.packetDeltaCount = rwRecGetPkts(rwrec);
+    rec.octetDeltaCount = rwRecGetBytes(rwrec);
+    rec.sourceIPv4Address = rwRecGetSIPv4(rwrec);
+    rec.destinationIPv4Address = rwRecGetDIPv4(rwrec);
+    rec.ipNextHopIPv4Address = rwRecGetNhIPv4(rwrec);
+    rec.ingressInterface = rwRecGetInput(rwrec);
+    rec.egressInterface = rwRecGetOutput(rwrec);
+    rec.sourceTransportPort = rwRecGetSPort(rwrec);
+    rec.destinationTransportPort = rwRecGetDPort(rwrec);
+    rec.protocolIdentifier = rwRecGetProto(rwrec);
+    rec.tcpControlBits = rwRecGetFlags(rwrec);
+
+    if (!fBufAppend(exporter->fbuf, (uint8_t*)&rec, sizeof(rec), &err)) {
+        exportPrintGError(exporter, err);
+        return -1;
+    }
+    ++exporter->pending;
+    return 0;
+}
+#endif  /* SK_ENABLE_IPFIX */
+
+
+/*
+ *  status = exportCreateV5(exporter, addrs);
+ *
+ *    Create the UDP socket that sends NetFlow v5 from 'exporter' to
+ *    the first address in 'addrs' that accepts a connection.
+ */
+static int
+exportCreateV5(
+    flow_export_t                  *exporter,
+    const sk_sockaddr_array_t      *addrs)
+{
+    const sk_sockaddr_t *addr;
+    uint32_t i;
+
+    for (i = 0; i < skSockaddrArraySize(addrs); ++i) {
+        addr = skSockaddrArrayGet(addrs, i);
+        exporter->fd = socket(addr->sa.sa_family, SOCK_DGRAM, 0);
+        if (-1 == exporter->fd) {
+            continue;
+        }
+        if (0 == connect(exporter->fd, &addr->sa, skSockaddrLen(addr))) {
+            return 0;
+        }
+        close(exporter->fd);
+        exporter->fd = -1;
+    }
+    skAppPrintErr("Cannot create UDP socket for %s: %s",
+                  exporter->host_port, strerror(errno));
+    return -1;
+}
+
+
+int
+flowExportCreate(
+    flow_export_t         **exporter,
+    flow_export_proto_t     proto,
+    const char             *host_port,
+    sktime_t                boot_time)
+{
+    sk_sockaddr_array_t *addrs = NULL;
+    flow_export_t *exp;
+    int rv;
+
+    assert(exporter);
+    assert(host_port);
+
+#if !SK_ENABLE_IPFIX
+    if (FLOW_EXPORT_NETFLOW_V5 != proto) {
+        skAppPrintErr("Cannot send IPFIX: SiLK was built without"
+                      " IPFIX support");
+        return -1;
+    }
+#endif
+
+    rv = skStringParseHostPortPair(&addrs, host_port,
+                                   HOST_REQUIRED | PORT_REQUIRED);
+    if (rv) {
+        skAppPrintErr("Invalid collector '%s': %s",
+                      host_port, skStringParseStrerror(rv));
+        return -1;
+    }
+
+    exp = (flow_export_t*)calloc(1, sizeof(flow_export_t));
+    if (NULL == exp) {
+        skAppPrintOutOfMemory("flow exporter");
+        skSockaddrArrayDestroy(addrs);
+        return -1;
+    }
+    exp->proto = proto;
+    exp->fd = -1;
+    exp->boot_time = boot_time;
+    snprintf(exp->host_port, sizeof(exp->host_port), "%s", host_port);
+
+    rv = -1;
+    switch (proto) {
+      case FLOW_EXPORT_NETFLOW_V5:
+        rv = exportCreateV5(exp, addrs);
+        break;
+      case FLOW_EXPORT_IPFIX_TCP:
+      case FLOW_EXPORT_IPFIX_UDP:
+#if SK_ENABLE_IPFIX
+        rv = exportCreateIpfix(exp, skSockaddrArrayGet(addrs, 0));
+#endif
+        break;
+    }
+    skSockaddrArrayDestroy(addrs);
+    if (rv) {
+        flowExportDestroy(&exp);
+        return -1;
+    }
+
+    *exporter = exp;
+    return 0;
+}
+
+
+void
+flowExportDestroy(
+    flow_export_t         **exporter)
+{
+    flow_export_t *exp;
+
+    if (NULL == exporter || NULL == *exporter) {
+        return;
+    }
+    exp = *exporter;
+    *exporter = NULL;
+
+    flowExportFlush(exp);
+    if (-1 != exp->fd) {
+        close(exp->fd);
+    }
+#if SK_ENABLE_IPFIX
+    if (exp->fbuf) {
+        fBufFree(exp->fbuf);
+    }
+    if (exp->model) {
+        fbInfoModelFree(exp->model);
+    }
+#endif
+    free(exp);
+}
+
+
+int
+flowExportFlush(
+    flow_export_t          *exporter)
+{
+    if (FLOW_EXPORT_NETFLOW_V5 == exporter->proto) {
+        return exportSendV5(exporter);
+    }
+#if SK_ENABLE_IPFIX
+    if (exporter->fbuf) {
+        return exportSendIpfix(exporter);
+    }
+#endif
+    return 0;
+}
+
+
+void
+flowExportGetStats(
+    const flow_export_t    *exporter,
+    flow_export_stats_t    *stats)
+{
+    *stats = exporter->stats;
+    stats->elapsed = ((exporter->stats.packets)
+                      ? exportElapsed(exporter, &exporter->last_send)
+                      : 0.0);
+}
+
+
+int
+flowExportRecord(
+    flow_export_t          *exporter,
+    const rwRec            *rwrec)
+{
+    if (FLOW_EXPORT_NETFLOW_V5 == exporter->proto) {
+        exportAddV5(exporter, rwrec);
+        if (exporter->pending == V5PDU_MAX_RECS) {
+            return exportSendV5(exporter);
+        }
+        return 0;
+    }
+#if SK_ENABLE_IPFIX
+    if (exportAddIpfix(exporter, rwrec)) {
+        return -1;
+    }
+    if (exporter->pending == FLOW_EXPORT_IPFIX_RECS) {
+        return exportSendIpfix(exporter);
+    }
+#endif
+    return 0;
+}
+
+
+void
+flowExportSetRate(
+    flow_export_t          *exporter,
+    double                  records_per_sec,
+    double                  packets_per_sec)
+{
+    exporter->records_per_sec = records_per_sec;
+    exporter->packets_per_sec = packets_per_sec;
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
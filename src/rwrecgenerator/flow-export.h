@@ -0,0 +1,210 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+#ifndef _FLOW_EXPORT_H
+#define _FLOW_EXPORT_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <silk/silk.h>
+
+RCSIDENTVAR(rcsID_FLOW_EXPORT_H, "$SiLK: flow-export.h $");
+
+#include <silk/rwrec.h>
+
+/*
+**  flow-export.h
+**
+**    Send flow records to a collector, such as rwflowpack or flowcap,
+**    as NetFlow v5 PDUs over UDP or as IPFIX messages over TCP or
+**    UDP.  The sender may be limited to a target rate, and it counts
+**    the records and packets it sends so the counts may be compared
+**    with the statistics the collector logs.
+*/
+
+
+/* The flow exporter object. */
+struct flow_export_st;
+typedef struct flow_export_st flow_export_t;
+
+
+/*
+ *  The protocols the exporter can speak.
+ */
+typedef enum flow_export_proto_en {
+    FLOW_EXPORT_NETFLOW_V5,
+    FLOW_EXPORT_IPFIX_TCP,
+    FLOW_EXPORT_IPFIX_UDP
+} flow_export_proto_t;
+
+
+/*
+ *  The counts that flowExportGetStats() fills.
+ */
+typedef struct flow_export_stats_st {
+    /* number of flow records sent, including those in packets the
+     * operating system refused */
+    uint64_t    records;
+    /* number of NetFlow v5 PDUs or IPFIX messages sent */
+    uint64_t    packets;
+    /* number of packets the operating system refused to send */
+    uint64_t    send_errors;
+    /* seconds between sending the first packet and the most recent
+     * packet */
+    double      elapsed;
+} flow_export_stats_t;
+
+
+/*
+ *  status = flowExportCreate(&exporter, proto, host_port, boot_time);
+ *
+ *    Create an exporter that sends records using 'proto' to the
+ *    collector at 'host_port', a string of the form HOST:PORT, and
+ *    store the exporter in the location referenced by 'exporter'.
+ *
+ *    When 'proto' is FLOW_EXPORT_NETFLOW_V5, the exporter pretends to
+ *    be a router that booted at 'boot_time', and the start and end
+ *    times of every record passed to flowExportRecord() must be no
+ *    earlier than 'boot_time'.
+ *
+ *    Return 0 on success.  Print an error and return -1 when
+ *    'host_port' cannot be parsed, when the socket cannot be created,
+ *    or when 'proto' requires IPFIX support and SiLK was built
+ *    without it.
+ */
+int
+flowExportCreate(
+    flow_export_t         **exporter,
+    flow_export_proto_t     proto,
+    const char             *host_port,
+    sktime_t                boot_time);
+
+
+/*
+ *  flowExportDestroy(&exporter);
+ *
+ *    Send any records that 'exporter' has buffered, close its
+ *    connection, and destroy it.  Do nothing when 'exporter' or the
+ *    location it references is NULL.
+ */
+void
+flowExportDestroy(
+    flow_export_t         **exporter);
+
+
+/*
+ *  status = flowExportFlush(exporter);
+ *
+ *    Send the records that 'exporter' has buffered.  Return 0 on
+ *    success, or -1 on a fatal error, such as the collector closing
+ *    a TCP connection.
+ */
+int
+flowExportFlush(
+    flow_export_t          *exporter);
+
+
+/*
+ *  flowExportGetStats(exporter, &stats);
+ *
+ *    Fill 'stats' with the counts of what 'exporter' has sent.
+ */
+void
+flowExportGetStats(
+    const flow_export_t    *exporter,
+    flow_export_stats_t    *stats);
+
+
+/*
+ *  status = flowExportRecord(exporter, rwrec);
+ *
+ *    Add 'rwrec' to the packet 'exporter' is building, and send the
+ *    packet once it is full, sleeping first if necessary to keep to
+ *    the rate set by flowExportSetRate().  Only the IPv4 fields of
+ *    'rwrec' are exported.
+ *
+ *    Return 0 on success, or -1 on a fatal error.  A UDP packet the
+ *    operating system refuses to send is counted as a send error and
+ *    is not fatal.
+ */
+int
+flowExportRecord(
+    flow_export_t          *exporter,
+    const rwRec            *rwrec);
+
+
+/*
+ *  flowExportSetRate(exporter, records_per_sec, packets_per_sec);
+ *
+ *    Limit 'exporter' to sending no more than 'records_per_sec' flow
+ *    records or 'packets_per_sec' packets per second, measured from
+ *    the first packet it sends.  A value of 0 removes that limit.
+ */
+void
+flowExportSetRate(
+    flow_export_t          *exporter,
+    double                  records_per_sec,
+    double                  packets_per_sec);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _FLOW_EXPORT_H */
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -83,6 +83,7 @@ RCSIDENT("$SiLK: rwrecgenerator.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 #include <silk/skstream.h>
 #include <silk/skstringmap.h>
 #include <silk/utils.h>
+#include "flow-export.h"
 #include "stream-cache.h"
 #include "skheap-rwrec.h"
 
@@ -131,6 +132,9 @@ typedef enum rand_flowtype_en {
 /* milliseconds per hour */
 #define MILLISEC_PER_HOUR  3600000
 
+/* milliseconds per day */
+#define MILLISEC_PER_DAY  86400000
+
 /* how to adjust the seed of the subprocesses */
 #define RECGEN_SUBPROC_SEED_ADJUST(rssa_seed, rssa_index) \
     ((rssa_seed) + ((rssa_index) * 0x00353535))
@@ -368,6 +372,22 @@ static const char *output_directory;
  * set by the --processing-directory switch. */
 static const char *processing_directory;
 
+/* when sending flow records to a collector, the exporter and its
+ * protocol and address.  set by the --netflow-v5-output or the
+ * --ipfix-output switch. */
+static flow_export_t *flow_export = NULL;
+static flow_export_proto_t export_proto;
+static const char *export_host_port = NULL;
+
+/* the IPFIX transport to use.  set by the --ipfix-transport switch */
+static flow_export_proto_t ipfix_transport = FLOW_EXPORT_IPFIX_TCP;
+
+/* the rates at which to send flow records and packets to a
+ * collector.  set by the --flows-per-second and --packets-per-second
+ * switches. */
+static double export_flows_per_sec = 0.0;
+static double export_packets_per_sec = 0.0;
+
 /* number of subprocesses to use when filling the output directory
  * with incremental files.  set by the --num-subprocesses switch.  */
 static uint32_t num_subprocesses = 0;
@@ -448,6 +468,12 @@ typedef enum {
     OPT_NO_FINAL_DELIMITER,
     OPT_DELIMITED,
 
+    OPT_NETFLOW_V5_OUTPUT,
+    OPT_IPFIX_OUTPUT,
+    OPT_IPFIX_TRANSPORT,
+    OPT_FLOWS_PER_SECOND,
+    OPT_PACKETS_PER_SECOND,
+
     OPT_SENSOR_PREFIX_MAP,
     OPT_FLOWTYPE_IN,
     OPT_FLOWTYPE_INWEB,
@@ -481,6 +507,12 @@ static const struct option appOptions[] = {
     {"no-final-delimiter",      NO_ARG,       0, OPT_NO_FINAL_DELIMITER},
     {"delimited",               OPTIONAL_ARG, 0, OPT_DELIMITED},
 
+    {"netflow-v5-output",       REQUIRED_ARG, 0, OPT_NETFLOW_V5_OUTPUT},
+    {"ipfix-output",            REQUIRED_ARG, 0, OPT_IPFIX_OUTPUT},
+    {"ipfix-transport",         REQUIRED_ARG, 0, OPT_IPFIX_TRANSPORT},
+    {"flows-per-second",        REQUIRED_ARG, 0, OPT_FLOWS_PER_SECOND},
+    {"packets-per-second",      REQUIRED_ARG, 0, OPT_PACKETS_PER_SECOND},
+
     {"sensor-prefix-map",       REQUIRED_ARG, 0, OPT_SENSOR_PREFIX_MAP},
     {"flowtype-in",             REQUIRED_ARG, 0, OPT_FLOWTYPE_IN},
     {"flowtype-inweb",          REQUIRED_ARG, 0, OPT_FLOWTYPE_INWEB},
@@ -528,6 +560,17 @@ static const char *appHelp[] = {
     "Suppress column delimiter at end of line. Def. No",
     "Shortcut for --no-columns --no-final-del --column-sep=CHAR",
 
+    ("Send the flow records as NetFlow v5 PDUs over UDP to\n"
+     "\tthe collector at this HOST:PORT"),
+    ("Send the flow records as IPFIX to the collector at\n"
+     "\tthis HOST:PORT. Requires SiLK built with libfixbuf"),
+    ("Use this transport for IPFIX. Choices: tcp, udp.\n"
+     "\tDef. tcp"),
+    ("Send no more than this many flow records per second\n"
+     "\tto the collector. Def. No limit"),
+    ("Send no more than this many packets per second to\n"
+     "\tthe collector. Def. No limit"),
+
     ("Specify a prefix map file that maps source IPs to\n"
      "\tsensor IDs.  If not provided, all flows belong to sensor 0"),
     ("Use this flowtype (class/type pair) for incoming flows\n"
@@ -591,6 +634,10 @@ appUsageLong(
             fprintf(fh, "\nIncremental Files Output Switches:\n");
             break;
 
+          case OPT_NETFLOW_V5_OUTPUT:
+            fprintf(fh, "\nCollector Output Switches:\n");
+            break;
+
           case OPT_SENSOR_PREFIX_MAP:
             fprintf(fh, "\nSiLK Site Specific Switches:\n");
             sksiteOptionsUsage(fh);
@@ -670,6 +717,8 @@ appTeardown(
 
     skStreamDestroy(&silk_output_path);
 
+    flowExportDestroy(&flow_export);
+
     if (text_output_ascii) {
         rwAsciiStreamDestroy(&text_output_ascii);
         text_output_ascii = NULL;
@@ -879,17 +928,29 @@ appSetup(
     /* some sort of output is required */
     if (NULL == output_directory
         && NULL == silk_output_path
-        && NULL == text_output.of_name)
+        && NULL == text_output.of_name
+        && NULL == export_host_port)
     {
         skAppPrintErr("One of the output switches is required");
         skAppUsage();
     }
-    if ((output_directory && (silk_output_path || text_output.of_name))
-        || (silk_output_path && text_output.of_name))
+    if ((output_directory
+         && (silk_output_path || text_output.of_name || export_host_port))
+        || (silk_output_path && (text_output.of_name || export_host_port))
+        || (text_output.of_name && export_host_port))
     {
         skAppPrintErr("Only one output switch may be specified");
         skAppUsage();
     }
+    if ((export_flows_per_sec > 0.0 || export_packets_per_sec > 0.0)
+        && NULL == export_host_port)
+    {
+        skAppPrintErr("May only specify --%s or --%s when sending flow"
+                      " records to a collector",
+                      appOptions[OPT_FLOWS_PER_SECOND].name,
+                      appOptions[OPT_PACKETS_PER_SECOND].name);
+        appExit(EXIT_FAILURE);
+    }
 
     /* need both or neither directory switches */
     if (output_directory) {
@@ -918,6 +979,22 @@ appSetup(
         }
     }
 
+    /* create the exporter.  the pretend router booted a day before
+     * the first flow so that its uptimes never go negative */
+    if (export_host_port) {
+        if (FLOW_EXPORT_NETFLOW_V5 != export_proto) {
+            export_proto = ipfix_transport;
+        }
+        if (flowExportCreate(&flow_export, export_proto, export_host_port,
+                             ((start_time > MILLISEC_PER_DAY)
+                              ? (start_time - MILLISEC_PER_DAY) : 0)))
+        {
+            appExit(EXIT_FAILURE);
+        }
+        flowExportSetRate(flow_export, export_flows_per_sec,
+                          export_packets_per_sec);
+    }
+
     /* bind the ascii stream if using it; otherwise destroy it */
     if (text_output.of_name) {
         rwAsciiSetOutputHandle(text_output_ascii, text_output.of_fp);
@@ -1193,6 +1270,44 @@ appOptionsHandler(
         rwAsciiSetDelimiter(text_output_ascii, opt_arg[0]);
         break;
 
+      case OPT_NETFLOW_V5_OUTPUT:
+      case OPT_IPFIX_OUTPUT:
+        if (export_host_port) {
+            skAppPrintErr("Invalid %s '%s': Only one collector may be given",
+                          appOptions[opt_index].name, opt_arg);
+            return -1;
+        }
+        export_host_port = opt_arg;
+        export_proto = ((OPT_NETFLOW_V5_OUTPUT == opt_index)
+                        ? FLOW_EXPORT_NETFLOW_V5 : FLOW_EXPORT_IPFIX_TCP);
+        break;
+
+      case OPT_IPFIX_TRANSPORT:
+        if (0 == strcmp(opt_arg, "tcp")) {
+            ipfix_transport = FLOW_EXPORT_IPFIX_TCP;
+        } else if (0 == strcmp(opt_arg, "udp")) {
+            ipfix_transport = FLOW_EXPORT_IPFIX_UDP;
+        } else {
+            skAppPrintErr("Invalid %s '%s': Choose tcp or udp",
+                          appOptions[opt_index].name, opt_arg);
+            return -1;
+        }
+        break;
+
+      case OPT_FLOWS_PER_SECOND:
+        rv = skStringParseDouble(&export_flows_per_sec, opt_arg, 0.0, 0.0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
+
+      case OPT_PACKETS_PER_SECOND:
+        rv = skStringParseDouble(&export_packets_per_sec, opt_arg, 0.0, 0.0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
+
       case OPT_DELIMITED:
         rwAsciiSetNoColumns(text_output_ascii);
         rwAsciiSetNoFinalDelimiter(text_output_ascii);
@@ -1830,6 +1945,10 @@ writeRecord(
         }
     } else if (text_output_ascii) {
         rwAsciiPrintRec(text_output_ascii, rec);
+    } else if (flow_export) {
+        if (flowExportRecord(flow_export, rec)) {
+            appExit(EXIT_FAILURE);
+        }
     }
 
     skMemPoolElementFree(mempool, rec);
@@ -3178,6 +3297,39 @@ generateFlows(
 }
 
 
+/*
+ *  printExportStats();
+ *
+ *    Print the number of flow records and packets sent to the
+ *    collector and the rates at which they were sent.  A load test
+ *    compares these numbers with the statistics the collector logs to
+ *    find the records it dropped.
+ */
+static void
+printExportStats(
+    void)
+{
+    flow_export_stats_t stats;
+    double rec_rate = 0.0;
+    double pkt_rate = 0.0;
+
+    flowExportGetStats(flow_export, &stats);
+    if (stats.elapsed > 0.0) {
+        rec_rate = (double)stats.records / stats.elapsed;
+        pkt_rate = (double)stats.packets / stats.elapsed;
+    }
+    printf(("Sent %" PRIu64 " flow records in %" PRIu64 " packets"
+            " to %s; %" PRIu64 " packets failed to send\n"
+            "Sent for %.3f seconds at %.1f records/sec, %.1f packets/sec\n"),
+           stats.records, stats.packets, export_host_port,
+           stats.send_errors, stats.elapsed, rec_rate, pkt_rate);
+    NOTICEMSG(("Sent %" PRIu64 " flow records in %" PRIu64 " packets"
+               " to %s in %.3f seconds; %" PRIu64 " packets failed"),
+              stats.records, stats.packets, export_host_port,
+              stats.elapsed, stats.send_errors);
+}
+
+
 /*
  *  runSubprocess();
  *
@@ -3233,6 +3385,13 @@ runSubprocess(
         appExit(EXIT_FAILURE);
     }
 
+    if (flow_export) {
+        if (flowExportFlush(flow_export)) {
+            appExit(EXIT_FAILURE);
+        }
+        printExportStats();
+    }
+
     appExit(EXIT_SUCCESS);
 }
 
@@ -0,0 +1,96 @@
+#! /usr/bin/perl -w
+#
+#
+# RCSIDENT("$SiLK: rwrecgenerator-netflow-v5.pl $")
+
+use strict;
+use SiLKTests;
+use IO::Select;
+use IO::Socket::INET;
+
+my $rwrecgenerator = check_silk_app('rwrecgenerator');
+my $rwcut = check_silk_app('rwcut');
+
+my $gen_args = ("--seed 987654321 --log-dest=none"
+                ." --start-time=2011/01/01:00 --end-time=2011/01/01:01"
+                ." --time-step=60000");
+
+# listen for the PDUs on an ephemeral port
+my $host = '127.0.0.1';
+my $sock = IO::Socket::INET->new(Proto     => 'udp',
+                                 LocalAddr => $host,
+                                 LocalPort => 0,
+    );
+unless ($sock) {
+    skip_test("Cannot create UDP socket on $host: $!");
+}
+my $port = $sock->sockport;
+
+# send the records; they wait in the socket's buffer
+my $cmd = "$rwrecgenerator $gen_args --netflow-v5-output=$host:$port";
+print STDERR "RUNNING: $cmd\n"
+    if $ENV{SK_TESTS_VERBOSE};
+my $summary = `$cmd`;
+die "ERROR: Failed running rwrecgenerator\n"
+    if $?;
+$summary =~ /^Sent (\d+) flow records in (\d+) packets.*; 0 packets failed/
+    or die "ERROR: Unexpected summary '$summary'\n";
+my ($sent_recs, $sent_pdus) = ($1, $2);
+
+# read the PDUs and decode the records
+my $sel = IO::Select->new($sock);
+my @got;
+my $pdus = 0;
+my $expect_seq = 0;
+while ($sel->can_read(2)) {
+    my $pdu;
+    defined $sock->recv($pdu, 2048)
+        or die "ERROR: Cannot read PDU: $!\n";
+    my ($version, $count, $uptime, $secs, $nsecs, $seq)
+        = unpack('nnNNNN', $pdu);
+    die "ERROR: Bad version $version\n"
+        unless 5 == $version;
+    die "ERROR: PDU $pdus has sequence $seq; expected $expect_seq\n"
+        unless $seq == $expect_seq;
+    die "ERROR: PDU $pdus has length ".length($pdu)." for $count records\n"
+        unless length($pdu) == 24 + 48 * $count;
+    for my $i (0 .. $count - 1) {
+        my ($sip, $dip, $nh, $in, $out, $pkts, $bytes, $first, $last,
+            $sport, $dport, $pad1, $flags, $proto)
+            = unpack('NNNnnNNNNnnCCC', substr($pdu, 24 + 48 * $i, 48));
+        die "ERROR: Record ends after its PDU was sent\n"
+            if $last > $uptime;
+        push @got, join('|', join('.', unpack('C4', pack('N', $sip))),
+                        join('.', unpack('C4', pack('N', $dip))),
+                        $sport, $dport, $proto, $pkts, $bytes,
+                        $last - $first);
+    }
+    ++$pdus;
+    $expect_seq += $count;
+}
+
+die "ERROR: Received $pdus PDUs; rwrecgenerator sent $sent_pdus\n"
+    unless $pdus == $sent_pdus;
+die "ERROR: Received ".scalar(@got)." records; rwrecgenerator sent"
+    ." $sent_recs\n"
+    unless scalar(@got) == $sent_recs;
+
+# the records must match those written to a SiLK file
+$cmd = ("$rwrecgenerator $gen_args --silk-output-path=-"
+        ." | $rwcut --no-titles --no-columns --no-final-delimiter"
+        ." --ipv6-policy=ignore"
+        ." --fields=sip,dip,sport,dport,protocol,packets,bytes,duration");
+my @want = split /\n/, `$cmd`;
+# print the duration in milliseconds
+for (@want) {
+    s/\|(\d+)\.(\d{3})$/'|'.($1 * 1000 + $2)/e;
+}
+
+die "ERROR: rwcut printed ".scalar(@want)." records; expected $sent_recs\n"
+    unless scalar(@want) == $sent_recs;
+for my $i (0 .. $#want) {
+    die "ERROR: Record $i differs: '$got[$i]' vs '$want[$i]'\n"
+        unless $got[$i] eq $want[$i];
+}
+
+exit 0;
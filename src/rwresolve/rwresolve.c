@@ -84,6 +84,11 @@
 **      has seen before.  If the hash table completely fills, it is
 **      destroyed and re-created.
 **
+**      When the --cache-file switch is given, an IP that is not in the
+**      hash table is next looked up in a persistent, file-based cache
+**      (see rwresolvecache.c) that is shared by all invocations, and
+**      the results of DNS lookups are added to that file.
+**
 **      For the asynchronous DNS resolution:
 **
 **      The reading of a single line of input is similar to the above.
@@ -111,6 +116,7 @@ RCSIDENT("$SiLK: rwresolve.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 #include <silk/skstringmap.h>
 #include <silk/skvector.h>
 #include <silk/utils.h>
+#include "rwresolvecache.h"
 #ifdef SK_HAVE_ADNS_H
 #include <adns.h>
 #endif
@@ -140,6 +146,19 @@ RCSIDENT("$SiLK: rwresolve.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 /* initializer for hash table creation */
 #define HASH_INITIAL_SIZE       500000
 
+/* default number of seconds names and failed lookups are kept in the
+ * persistent cache (--cache-ttl, --cache-negative-ttl) */
+#define RWRESOLVE_CACHE_TTL_DEF         86400
+#define RWRESOLVE_CACHE_NEG_TTL_DEF     3600
+
+#ifdef RWRESOLVE_TESTING_STUB
+/* environment variable that, when set to a file name, replaces the
+ * synchronous resolvers with a stub that logs its lookups to that
+ * file.  Only the rwresolve-stub test program, which #includes this
+ * file, is compiled with this code. */
+#define RWRESOLVE_STUB_ENVAR    "SILK_RWRESOLVE_STUB"
+#endif
+
 /* size of a hostname */
 #ifdef NI_MAXHOST
 #  define RWRESOLVE_MAXHOST     NI_MAXHOST
@@ -365,12 +384,27 @@ static size_t namebuf_avail = 0;
 /* maintain list of line objects previous allocated */
 static line_t *free_list = NULL;
 
+/* the persistent name cache shared across invocations (--cache-file)
+ * and the parameters used to create and fill it */
+static rescache_t *name_cache = NULL;
+static const char *cache_path = NULL;
+static uint32_t cache_entries = RESCACHE_ENTRIES_DEF;
+static uint32_t cache_ttl = RWRESOLVE_CACHE_TTL_DEF;
+static uint32_t cache_negative_ttl = RWRESOLVE_CACHE_NEG_TTL_DEF;
+
+#ifdef RWRESOLVE_TESTING_STUB
+/* when non-NULL, lookups are done by stubResolve(), which appends
+ * each address to this file */
+static const char *stub_log = NULL;
+#endif
+
 
 
 /* OPTIONS SETUP */
 
 typedef enum {
-    OPT_IP_FIELDS, OPT_DELIMITER, OPT_COLUMN_WIDTH, OPT_RESOLVER
+    OPT_IP_FIELDS, OPT_DELIMITER, OPT_COLUMN_WIDTH, OPT_RESOLVER,
+    OPT_CACHE_FILE, OPT_CACHE_ENTRIES, OPT_CACHE_TTL, OPT_CACHE_NEGATIVE_TTL
 #if defined(SK_HAVE_ADNS_H) || defined(SK_HAVE_CARES_H)
     , OPT_MAX_REQUESTS
 #endif
@@ -382,6 +416,10 @@ static struct option appOptions[] = {
     {"delimiter",       REQUIRED_ARG, 0, OPT_DELIMITER},
     {"column-width",    REQUIRED_ARG, 0, OPT_COLUMN_WIDTH},
     {"resolver",        REQUIRED_ARG, 0, OPT_RESOLVER},
+    {"cache-file",      REQUIRED_ARG, 0, OPT_CACHE_FILE},
+    {"cache-entries",   REQUIRED_ARG, 0, OPT_CACHE_ENTRIES},
+    {"cache-ttl",       REQUIRED_ARG, 0, OPT_CACHE_TTL},
+    {"cache-negative-ttl", REQUIRED_ARG, 0, OPT_CACHE_NEGATIVE_TTL},
 #if defined(SK_HAVE_ADNS_H) || defined(SK_HAVE_CARES_H)
     {"max-requests",    REQUIRED_ARG, 0, OPT_MAX_REQUESTS},
 #endif
@@ -395,6 +433,11 @@ static const char *appHelp[] = {
     ("Specify the output width of the column(s) specified\n"
      "\tin --fields.  Def. No justification for host names"),
     "Specify IP-to-host mapping function",
+    ("Keep resolved names in this file so that later and\n"
+     "\tconcurrent invocations may reuse them.  Def. None"),
+    (char *)NULL,               /* handled below */
+    (char *)NULL,               /* handled below */
+    (char *)NULL,               /* handled below */
 #if defined(SK_HAVE_ADNS_H) || defined(SK_HAVE_CARES_H)
     (char *)NULL,               /* handled below */
 #endif
@@ -453,6 +496,25 @@ appUsageLong(
             }
             break;
 
+          case OPT_CACHE_ENTRIES:
+            fprintf(fh, ("When creating the --%s, size it to hold\n"
+                         "\tthis many names. Def. %d"),
+                    appOptions[OPT_CACHE_FILE].name, RESCACHE_ENTRIES_DEF);
+            break;
+
+          case OPT_CACHE_TTL:
+            fprintf(fh, ("Keep names in the --%s for this many\n"
+                         "\tseconds. Def. %d"),
+                    appOptions[OPT_CACHE_FILE].name, RWRESOLVE_CACHE_TTL_DEF);
+            break;
+
+          case OPT_CACHE_NEGATIVE_TTL:
+            fprintf(fh, ("Remember in the --%s that an address\n"
+                         "\thas no name for this many seconds. Def. %d"),
+                    appOptions[OPT_CACHE_FILE].name,
+                    RWRESOLVE_CACHE_NEG_TTL_DEF);
+            break;
+
 #if defined(SK_HAVE_ADNS_H) || defined(SK_HAVE_CARES_H)
           case OPT_MAX_REQUESTS:
             {
@@ -511,6 +573,7 @@ appTeardown(
 
     reallocCache(0);
     lineFreeListEmpty();
+    rescacheClose(&name_cache);
 
     skAppUnregister();
 }
@@ -591,6 +654,27 @@ appSetup(
         parseIPFields("1,2");
     }
 
+#ifdef RWRESOLVE_TESTING_STUB
+    /* the stub resolver replaces the synchronous resolvers */
+    stub_log = getenv(RWRESOLVE_STUB_ENVAR);
+    if (stub_log && '\0' == stub_log[0]) {
+        stub_log = NULL;
+    }
+    if (stub_log
+        && RESOLVE_GETHOSTBYADDR != resolver
+        && RESOLVE_GETNAMEINFO != resolver)
+    {
+        resolver = RESOLVE_GETHOSTBYADDR;
+    }
+#endif  /* RWRESOLVE_TESTING_STUB */
+
+    /* open the persistent cache */
+    if (cache_path) {
+        if (rescacheOpen(&name_cache, cache_path, cache_entries)) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
     /* create hash table */
     reallocCache(1);
 
@@ -661,6 +745,42 @@ appOptionsHandler(
         }
         break;
 
+      case OPT_CACHE_FILE:
+        if (cache_path) {
+            skAppPrintErr("Invalid %s: Switch used multiple times",
+                          appOptions[opt_index].name);
+            return 1;
+        }
+        if ('\0' == opt_arg[0]) {
+            skAppPrintErr("Invalid %s: Empty string not valid argument",
+                          appOptions[opt_index].name);
+            return 1;
+        }
+        cache_path = opt_arg;
+        break;
+
+      case OPT_CACHE_ENTRIES:
+        rv = skStringParseUint32(&cache_entries, opt_arg,
+                                 1, RESCACHE_ENTRIES_MAX);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
+
+      case OPT_CACHE_TTL:
+        rv = skStringParseUint32(&cache_ttl, opt_arg, 0, 0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
+
+      case OPT_CACHE_NEGATIVE_TTL:
+        rv = skStringParseUint32(&cache_negative_ttl, opt_arg, 0, 0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
+
 #if defined(SK_HAVE_ADNS_H) || defined(SK_HAVE_CARES_H)
       case OPT_MAX_REQUESTS:
         rv = skStringParseUint32(&max_requests, opt_arg,
@@ -1052,6 +1172,190 @@ cacheName(
 }
 
 
+/*
+ *  persistentStore(ip, name, definitive);
+ *
+ *    Add the result of resolving 'ip' to the persistent cache if
+ *    there is one.  'name' is the name of the address or NULL if the
+ *    lookup failed.  A failed lookup is only remembered when
+ *    'definitive' is non-zero, meaning the DNS reported that the
+ *    address has no name, as opposed to a timeout or other transient
+ *    error.
+ */
+static void
+persistentStore(
+    const skipaddr_t   *ip,
+    const char         *name,
+    int                 definitive)
+{
+    if (NULL == name_cache) {
+        return;
+    }
+    if (name) {
+        rescacheStore(name_cache, ip, name, cache_ttl);
+    } else if (definitive) {
+        rescacheStore(name_cache, ip, NULL, cache_negative_ttl);
+    }
+}
+
+
+#ifdef RWRESOLVE_TESTING_STUB
+/*
+ *  found = stubResolve(ip, hostname, hostsize);
+ *
+ *    A deterministic stand-in for the resolver that is used when the
+ *    environment variable named by RWRESOLVE_STUB_ENVAR is set.  The
+ *    address is appended to the file that variable names, so a test
+ *    can count the lookups.  An address whose final octet is even
+ *    resolves to "host-<ADDRESS>.stub"; other addresses have no
+ *    name.  Since only the rwresolve-stub test program contains this
+ *    function, the made-up names only reach the persistent caches of
+ *    the tests.
+ */
+static int
+stubResolve(
+    const skipaddr_t   *ip,
+    char               *hostname,
+    size_t              hostsize)
+{
+    char ipbuf[SK_NUM2DOT_STRLEN];
+    uint8_t last_octet;
+    FILE *fp;
+
+    skipaddrString(ipbuf, ip, 0);
+
+    fp = fopen(stub_log, "a");
+    if (fp) {
+        fprintf(fp, "%s\n", ipbuf);
+        fclose(fp);
+    }
+
+#if SK_ENABLE_IPV6
+    if (skipaddrIsV6(ip)) {
+        uint8_t ipv6[16];
+        skipaddrGetV6(ip, ipv6);
+        last_octet = ipv6[15];
+    } else
+#endif
+    {
+        last_octet = (uint8_t)(skipaddrGetV4(ip) & 0xFF);
+    }
+    if (last_octet & 0x1) {
+        return 0;
+    }
+    snprintf(hostname, hostsize, "host-%s.stub", ipbuf);
+    return 1;
+}
+#endif  /* RWRESOLVE_TESTING_STUB */
+
+
+/*
+ *  found = lookupName(ip, sa, salen, hostname, hostsize);
+ *
+ *    Find the name of 'ip' for the synchronous resolvers, checking
+ *    and then filling the persistent cache when one is in use.  'sa'
+ *    and 'salen' hold 'ip' as a socket address.  Return 1 and fill
+ *    'hostname' when the address has a name; return 0 otherwise.
+ */
+static int
+lookupName(
+    const skipaddr_t       *ip,
+    const struct sockaddr  *sa,
+    socklen_t               salen,
+    char                   *hostname,
+    size_t                  hostsize)
+{
+    struct hostent *he;
+    int definitive;
+    int found;
+#ifdef SK_HAVE_GETNAMEINFO
+    int rv;
+#endif
+
+    if (name_cache) {
+        switch (rescacheLookup(name_cache, ip, hostname, hostsize)) {
+          case RESCACHE_NAME:
+            return 1;
+          case RESCACHE_NONAME:
+            return 0;
+          case RESCACHE_MISS:
+            break;
+        }
+    }
+
+#ifdef RWRESOLVE_TESTING_STUB
+    if (stub_log) {
+        found = stubResolve(ip, hostname, hostsize);
+        definitive = 1;
+    } else
+#endif
+    if (RESOLVE_GETHOSTBYADDR == resolver) {
+        he = gethostbyaddr((char*)&((const struct sockaddr_in*)sa)->sin_addr,
+                           sizeof(in_addr_t), AF_INET);
+        if (he) {
+            strncpy(hostname, he->h_name, hostsize);
+            hostname[hostsize - 1] = '\0';
+            found = 1;
+            definitive = 1;
+        } else {
+            found = 0;
+            definitive = (HOST_NOT_FOUND == h_errno || NO_DATA == h_errno);
+        }
+    } else {
+#ifdef SK_HAVE_GETNAMEINFO
+        rv = getnameinfo(sa, salen, hostname, hostsize, NULL, 0, NI_NAMEREQD);
+        found = (0 == rv);
+        definitive = (0 == rv || EAI_NONAME == rv);
+#else
+        skAbort();
+#endif
+    }
+
+    persistentStore(ip, (found ? hostname : NULL), definitive);
+    return found;
+}
+
+
+#if defined(SK_HAVE_ADNS_H) || defined(SK_HAVE_CARES_H)
+/*
+ *  found = persistentLookup(ip, cache_id);
+ *
+ *    For the asynchronous resolvers, check the persistent cache for
+ *    'ip' before submitting a query.  When 'ip' is found, set the
+ *    value referenced by 'cache_id' to the ID of the cached name or
+ *    to RWRES_NONAME and return 1.  Return 0 when 'ip' is not found
+ *    or its name cannot be added to the in-memory cache.
+ */
+static int
+persistentLookup(
+    const skipaddr_t   *ip,
+    uint32_t           *cache_id)
+{
+    char hostname[RWRESOLVE_MAXHOST];
+    uint32_t id;
+
+    if (NULL == name_cache) {
+        return 0;
+    }
+    switch (rescacheLookup(name_cache, ip, hostname, sizeof(hostname))) {
+      case RESCACHE_MISS:
+        break;
+      case RESCACHE_NONAME:
+        *cache_id = RWRES_NONAME;
+        return 1;
+      case RESCACHE_NAME:
+        id = cacheName(hostname);
+        if (RWRES_CACHE_FAIL != id) {
+            *cache_id = id;
+            return 1;
+        }
+        break;
+    }
+    return 0;
+}
+#endif  /* SK_HAVE_ADNS_H || SK_HAVE_CARES_H */
+
+
 /*
  *  freeLine(line);
  *
@@ -1392,13 +1696,20 @@ static int
 resolve_gethostbyaddr(
     void)
 {
+    char hostname[RWRESOLVE_MAXHOST];
     line_t *line = NULL;
     uint16_t i;
     uint32_t *cache_id;
-    struct hostent *he;
+    struct sockaddr_in sa4;
     in_addr_t addr;
     int rv;
 
+    memset(&sa4, 0, sizeof(sa4));
+    sa4.sin_family = AF_INET;
+#ifdef SK_HAVE_STRUCT_SOCKADDR_IN_SIN_LEN
+    sa4.sin_len = sizeof(struct sockaddr_in);
+#endif
+
     /* process the input */
     while ((rv = getLine(&line)) == 0) {
         for (i = 0; i < line->part_count; ++i) {
@@ -1436,16 +1747,18 @@ resolve_gethostbyaddr(
 
               case OK:
                 /* new entry; must do the DNS lookup */
-                he = gethostbyaddr((char*)&addr, sizeof(in_addr_t), AF_INET);
-                if (!he) {
+                sa4.sin_addr.s_addr = addr;
+                if (!lookupName(&line->part[i].ip, (struct sockaddr *)&sa4,
+                                sizeof(sa4), hostname, sizeof(hostname)))
+                {
                     /* lookup failed */
                     *cache_id = RWRES_NONAME;
                     PRINT_PART_DEFAULT(line, i);
                 } else {
                     /* lookup succeeded; print result */
-                    PRINT_PART_TEXT(line, i, he->h_name);
+                    PRINT_PART_TEXT(line, i, hostname);
                     /* cache result */
-                    *cache_id = cacheName(he->h_name);
+                    *cache_id = cacheName(hostname);
                     if (RWRES_CACHE_FAIL == *cache_id) {
                         /* allocatation failed. reallocate everything */
                         reallocCache(1);
@@ -1545,12 +1858,11 @@ resolve_getnameinfo(
 
                   case OK:
                     /* new entry; must do the DNS lookup */
-                    rv = getnameinfo((struct sockaddr *)&sa6, sizeof(sa6),
-                                     hostname, sizeof(hostname),
-                                     NULL, 0, NI_NAMEREQD);
-                    if (0 != rv) {
+                    if (!lookupName(&line->part[i].ip,
+                                    (struct sockaddr *)&sa6, sizeof(sa6),
+                                    hostname, sizeof(hostname)))
+                    {
                         /* lookup failed */
-                        assert(-1 == rv);
                         *cache_id = RWRES_NONAME;
                         PRINT_PART_DEFAULT(line, i);
                     } else {
@@ -1600,10 +1912,9 @@ resolve_getnameinfo(
 
               case OK:
                 /* new entry; must do the DNS lookup */
-                rv = getnameinfo((struct sockaddr *)&sa4, sizeof(sa4),
-                                 hostname, sizeof(hostname),
-                                 NULL, 0, NI_NAMEREQD);
-                if (0 != rv) {
+                if (!lookupName(&line->part[i].ip, (struct sockaddr *)&sa4,
+                                sizeof(sa4), hostname, sizeof(hostname)))
+                {
                     /* lookup failed */
                     *cache_id = RWRES_NONAME;
                     PRINT_PART_DEFAULT(line, i);
@@ -1787,6 +2098,8 @@ resolve_adns_submit(
                 } else {
                     if (answers[j]->status == adns_s_ok) {
                         PRINT_PART_TEXT(line, i, *answers[j]->rrs.str);
+                        persistentStore(&line->part[i].ip,
+                                        *answers[j]->rrs.str, 1);
                         *cache_id = cacheName(*answers[j]->rrs.str);
                         if (RWRES_CACHE_FAIL == *cache_id) {
                             /* have pending lines that use the address.
@@ -1796,6 +2109,10 @@ resolve_adns_submit(
                             no_mem = __LINE__;
                         }
                     } else {
+                        persistentStore(&line->part[i].ip, NULL,
+                                        (answers[j]->status == adns_s_nxdomain
+                                         || (answers[j]->status
+                                             == adns_s_nodata)));
                         *cache_id = RWRES_NONAME;
                         PRINT_PART_DEFAULT(line, i);
                     }
@@ -1885,7 +2202,12 @@ resolve_adns_submit(
                 goto LINE_NO_MEM;
 
               case OK:
-                /* new entry; must do the DNS lookup */
+                /* new entry; check the persistent cache */
+                if (persistentLookup(&line->part[i].ip, cache_id)) {
+                    line->part[i].waiting = 0;
+                    break;
+                }
+                /* must do the DNS lookup */
                 snprintf(arpa_addr, sizeof(arpa_addr),
                          "%d.%d.%d.%d.in-addr.arpa",
                          (ipv4 & 0xFF),
@@ -1979,6 +2301,7 @@ rwres_callback(
         break;
 
       case ARES_SUCCESS:
+        persistentStore(&line_part->ip, node, 1);
         line_part->cache_id = cacheName(node);
         if (RWRES_CACHE_FAIL == line_part->cache_id) {
             line_part->cache_id = RWRES_NONAME;
@@ -1987,6 +2310,7 @@ rwres_callback(
         break;
 
       default:
+        persistentStore(&line_part->ip, NULL, (ARES_ENOTFOUND == status));
         line_part->cache_id = RWRES_NONAME;
         break;
     }
@@ -2270,7 +2594,13 @@ resolve_cares_submit(
                     goto LINE_NO_MEM;
 
                   case OK:
-                    /* new entry; must do the DNS lookup */
+                    /* new entry; check the persistent cache */
+                    if (persistentLookup(&line->part[i].ip, cache_id)) {
+                        line->part[i].waiting = 0;
+                        line->part[i].cache_id = *cache_id;
+                        break;
+                    }
+                    /* must do the DNS lookup */
                     *cache_id = RWRES_WAITING;
                     line->part[i].waiting = 1;
                     line->part[i].line = line;
@@ -2303,7 +2633,13 @@ resolve_cares_submit(
                     goto LINE_NO_MEM;
 
                   case OK:
-                    /* new entry; must do the DNS lookup */
+                    /* new entry; check the persistent cache */
+                    if (persistentLookup(&line->part[i].ip, cache_id)) {
+                        line->part[i].waiting = 0;
+                        line->part[i].cache_id = *cache_id;
+                        break;
+                    }
+                    /* must do the DNS lookup */
                     *cache_id = RWRES_WAITING;
                     line->part[i].waiting = 1;
                     line->part[i].line = line;
@@ -0,0 +1,497 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  rwresolvecache.c
+**
+**    A persistent cache of DNS names for rwresolve.  See
+**    rwresolvecache.h for details.
+*/
+
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: rwresolvecache.c $");
+
+#include <silk/utils.h>
+#include "rwresolvecache.h"
+
+
+/* LOCAL DEFINES AND TYPEDEFS */
+
+/* identifies a cache file */
+#define RESCACHE_MAGIC          "SKRESOLV"
+#define RESCACHE_VERSION        1
+
+/* the smallest number of entries in a cache */
+#define RESCACHE_ENTRIES_MIN    (4 * RESCACHE_WAYS)
+
+/* values for the 'state' member of a slot */
+#define RESCACHE_SLOT_EMPTY     0
+#define RESCACHE_SLOT_NAME      1
+#define RESCACHE_SLOT_NONAME    2
+
+/* the header at the start of the file */
+typedef struct rescache_header_st {
+    char                magic[8];
+    uint32_t            version;
+    /* sizeof(rescache_slot_t), to catch layout differences */
+    uint32_t            slot_size;
+    /* number of slots; a power of 2 */
+    uint32_t            slot_count;
+    /* the position of the CLOCK hand */
+    uint32_t            clock_hand;
+    uint8_t             unused[40];
+} rescache_header_t;
+
+/* one entry in the table; 256 octets */
+typedef struct rescache_slot_st {
+    /* the address; IPv4 addresses are stored as ::ffff:0:0/96 */
+    uint8_t             addr[16];
+    /* when the entry expires, in seconds since the UNIX epoch */
+    uint32_t            expires;
+    /* one of the RESCACHE_SLOT_* values */
+    uint8_t             state;
+    /* the CLOCK referenced bit */
+    uint8_t             referenced;
+    uint8_t             unused[2];
+    /* the NUL-terminated name */
+    char                name[RESCACHE_NAME_MAX];
+} rescache_slot_t;
+
+struct rescache_st {
+    /* the mapped file */
+    void               *map;
+    size_t              map_size;
+    rescache_header_t  *header;
+    rescache_slot_t    *slot;
+    /* slot_count - 1 */
+    uint32_t            mask;
+    int                 fd;
+    unsigned            read_only :1;
+};
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  rescacheKey(ip, key);
+ *
+ *    Fill the 16 octets at 'key' with the address in 'ip', mapping
+ *    IPv4 addresses into ::ffff:0:0/96.
+ */
+static void
+rescacheKey(
+    const skipaddr_t   *ip,
+    uint8_t            *key)
+{
+    uint32_t ipv4;
+
+#if SK_ENABLE_IPV6
+    if (skipaddrIsV6(ip)) {
+        skipaddrGetV6(ip, key);
+        return;
+    }
+#endif
+    ipv4 = htonl(skipaddrGetV4(ip));
+    memset(key, 0, 10);
+    key[10] = 0xFF;
+    key[11] = 0xFF;
+    memcpy(key + 12, &ipv4, sizeof(ipv4));
+}
+
+
+/*
+ *  index = rescacheHash(cache, key);
+ *
+ *    Return the first slot in 'cache' that may hold 'key'.  The hash
+ *    is FNV-1a.
+ */
+static uint32_t
+rescacheHash(
+    const rescache_t   *cache,
+    const uint8_t      *key)
+{
+    uint32_t h = 2166136261u;
+    unsigned int i;
+
+    for (i = 0; i < 16; ++i) {
+        h ^= key[i];
+        h *= 16777619u;
+    }
+    return (h & cache->mask);
+}
+
+
+/*
+ *  status = rescacheLock(cache, type);
+ *
+ *    Take a lock of 'type' (F_RDLCK, F_WRLCK, or F_UNLCK) on the
+ *    cache file, waiting if necessary.  Return 0 on success.
+ */
+static int
+rescacheLock(
+    rescache_t         *cache,
+    short               type)
+{
+    while (skFileSetLock(cache->fd, type, F_SETLKW)) {
+        if (EINTR != errno) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ *  status = rescacheOpen(&cache, path, entries);
+ *
+ *    Open or create the cache file.  See header for details.
+ */
+int
+rescacheOpen(
+    rescache_t        **cache_out,
+    const char         *path,
+    uint32_t            entries)
+{
+    rescache_t *cache;
+    rescache_header_t *hdr;
+    struct stat st;
+    uint32_t slot_count;
+    int prot;
+
+    assert(cache_out);
+    assert(path);
+
+    cache = (rescache_t *)calloc(1, sizeof(rescache_t));
+    if (NULL == cache) {
+        skAppPrintOutOfMemory("name cache");
+        return -1;
+    }
+    cache->map = MAP_FAILED;
+
+    cache->fd = open(path, O_RDWR | O_CREAT, 0666);
+    if (-1 == cache->fd && (EACCES == errno || EROFS == errno)) {
+        /* share a cache owned by someone else */
+        cache->fd = open(path, O_RDONLY);
+        cache->read_only = 1;
+    }
+    if (-1 == cache->fd) {
+        skAppPrintSyserror("Unable to open name cache '%s'", path);
+        goto ERROR;
+    }
+
+    /* the exclusive lock makes creation atomic with respect to other
+     * rwresolve processes */
+    if (rescacheLock(cache, (cache->read_only ? F_RDLCK : F_WRLCK))) {
+        skAppPrintSyserror("Unable to lock name cache '%s'", path);
+        goto ERROR;
+    }
+    if (-1 == fstat(cache->fd, &st)) {
+        skAppPrintSyserror("Unable to stat name cache '%s'", path);
+        goto ERROR;
+    }
+
+    prot = PROT_READ | (cache->read_only ? 0 : PROT_WRITE);
+
+    if (0 == st.st_size) {
+        /* create a new cache */
+        if (cache->read_only) {
+            skAppPrintErr("Name cache '%s' is empty and not writable", path);
+            goto ERROR;
+        }
+        if (entries > RESCACHE_ENTRIES_MAX) {
+            entries = RESCACHE_ENTRIES_MAX;
+        }
+        slot_count = RESCACHE_ENTRIES_MIN;
+        while (slot_count < entries) {
+            slot_count <<= 1;
+        }
+        cache->map_size = (sizeof(rescache_header_t)
+                           + (size_t)slot_count * sizeof(rescache_slot_t));
+        if (-1 == ftruncate(cache->fd, (off_t)cache->map_size)) {
+            skAppPrintSyserror("Unable to size name cache '%s'", path);
+            goto ERROR;
+        }
+        cache->map = mmap(NULL, cache->map_size, prot, MAP_SHARED,
+                          cache->fd, 0);
+        if (MAP_FAILED == cache->map) {
+            skAppPrintSyserror("Unable to map name cache '%s'", path);
+            goto ERROR;
+        }
+        /* ftruncate() zeroed the slots, so they are all empty */
+        hdr = (rescache_header_t *)cache->map;
+        memcpy(hdr->magic, RESCACHE_MAGIC, sizeof(hdr->magic));
+        hdr->version = RESCACHE_VERSION;
+        hdr->slot_size = sizeof(rescache_slot_t);
+        hdr->slot_count = slot_count;
+        hdr->clock_hand = 0;
+    } else {
+        /* verify an existing cache */
+        if ((size_t)st.st_size < sizeof(rescache_header_t)) {
+            goto BAD_FILE;
+        }
+        cache->map_size = (size_t)st.st_size;
+        cache->map = mmap(NULL, cache->map_size, prot, MAP_SHARED,
+                          cache->fd, 0);
+        if (MAP_FAILED == cache->map) {
+            skAppPrintSyserror("Unable to map name cache '%s'", path);
+            goto ERROR;
+        }
+        hdr = (rescache_header_t *)cache->map;
+        slot_count = hdr->slot_count;
+        if (memcmp(hdr->magic, RESCACHE_MAGIC, sizeof(hdr->magic))
+            || RESCACHE_VERSION != hdr->version
+            || sizeof(rescache_slot_t) != hdr->slot_size
+            || slot_count < RESCACHE_ENTRIES_MIN
+            || slot_count > RESCACHE_ENTRIES_MAX
+            || 0 != (slot_count & (slot_count - 1))
+            || (cache->map_size
+                != (sizeof(rescache_header_t)
+                    + (size_t)slot_count * sizeof(rescache_slot_t))))
+        {
+            goto BAD_FILE;
+        }
+    }
+
+    rescacheLock(cache, F_UNLCK);
+
+    cache->header = hdr;
+    cache->slot = (rescache_slot_t *)(hdr + 1);
+    cache->mask = slot_count - 1;
+    *cache_out = cache;
+    return 0;
+
+  BAD_FILE:
+    skAppPrintErr("File '%s' is not a valid name cache for this machine",
+                  path);
+  ERROR:
+    rescacheClose(&cache);
+    return -1;
+}
+
+
+/*
+ *  rescacheClose(&cache);
+ *
+ *    Close the cache.  See header for details.
+ */
+void
+rescacheClose(
+    rescache_t        **cache)
+{
+    if (NULL == cache || NULL == *cache) {
+        return;
+    }
+    if (MAP_FAILED != (*cache)->map) {
+        munmap((*cache)->map, (*cache)->map_size);
+    }
+    if (-1 != (*cache)->fd) {
+        close((*cache)->fd);
+    }
+    free(*cache);
+    *cache = NULL;
+}
+
+
+/*
+ *  result = rescacheLookup(cache, ip, name, namesize);
+ *
+ *    Find an address in the cache.  See header for details.
+ */
+rescache_result_t
+rescacheLookup(
+    rescache_t         *cache,
+    const skipaddr_t   *ip,
+    char               *name,
+    size_t              namesize)
+{
+    rescache_result_t result = RESCACHE_MISS;
+    rescache_slot_t *slot;
+    uint8_t key[16];
+    uint32_t now;
+    uint32_t idx;
+    unsigned int i;
+
+    rescacheKey(ip, key);
+    idx = rescacheHash(cache, key);
+    now = (uint32_t)time(NULL);
+
+    if (rescacheLock(cache, F_RDLCK)) {
+        return RESCACHE_MISS;
+    }
+    for (i = 0; i < RESCACHE_WAYS; ++i) {
+        slot = &cache->slot[(idx + i) & cache->mask];
+        if (RESCACHE_SLOT_EMPTY == slot->state
+            || memcmp(slot->addr, key, sizeof(key)))
+        {
+            continue;
+        }
+        if (slot->expires <= now) {
+            /* stale; the caller will resolve and replace it */
+            break;
+        }
+        if (RESCACHE_SLOT_NAME == slot->state) {
+            strncpy(name, slot->name, namesize);
+            name[namesize - 1] = '\0';
+            result = RESCACHE_NAME;
+        } else {
+            result = RESCACHE_NONAME;
+        }
+        /* setting the bit under the shared lock races only with
+         * other processes setting it, which is harmless */
+        if (!cache->read_only) {
+            slot->referenced = 1;
+        }
+        break;
+    }
+    rescacheLock(cache, F_UNLCK);
+
+    return result;
+}
+
+
+/*
+ *  rescacheStore(cache, ip, name, ttl);
+ *
+ *    Add or replace an address in the cache.  See header for
+ *    details.
+ */
+void
+rescacheStore(
+    rescache_t         *cache,
+    const skipaddr_t   *ip,
+    const char         *name,
+    uint32_t            ttl)
+{
+    rescache_slot_t *slot;
+    rescache_slot_t *victim = NULL;
+    uint8_t key[16];
+    uint32_t now;
+    uint32_t idx;
+    uint32_t hand;
+    size_t len = 0;
+    unsigned int i;
+
+    if (cache->read_only) {
+        return;
+    }
+    if (name) {
+        len = strlen(name);
+        if (len >= RESCACHE_NAME_MAX) {
+            return;
+        }
+    }
+
+    rescacheKey(ip, key);
+    idx = rescacheHash(cache, key);
+    now = (uint32_t)time(NULL);
+
+    if (rescacheLock(cache, F_WRLCK)) {
+        return;
+    }
+
+    /* prefer the address's own slot, then an empty slot, then an
+     * expired one */
+    for (i = 0; i < RESCACHE_WAYS; ++i) {
+        slot = &cache->slot[(idx + i) & cache->mask];
+        if (RESCACHE_SLOT_EMPTY == slot->state) {
+            if (NULL == victim || RESCACHE_SLOT_EMPTY != victim->state) {
+                victim = slot;
+            }
+        } else if (0 == memcmp(slot->addr, key, sizeof(key))) {
+            victim = slot;
+            break;
+        } else if (NULL == victim && slot->expires <= now) {
+            victim = slot;
+        }
+    }
+
+    if (NULL == victim) {
+        /* all candidates are live; run the CLOCK hand over them.  it
+         * stops within two sweeps since each step clears a bit */
+        hand = cache->header->clock_hand;
+        for (;;) {
+            slot = &cache->slot[(idx + (hand % RESCACHE_WAYS)) & cache->mask];
+            ++hand;
+            if (!slot->referenced) {
+                victim = slot;
+                break;
+            }
+            slot->referenced = 0;
+        }
+        cache->header->clock_hand = hand;
+    }
+
+    memcpy(victim->addr, key, sizeof(key));
+    victim->expires = (((uint64_t)now + ttl > UINT32_MAX)
+                       ? UINT32_MAX : now + ttl);
+    victim->referenced = 1;
+    if (name) {
+        memcpy(victim->name, name, len + 1);
+        victim->state = RESCACHE_SLOT_NAME;
+    } else {
+        victim->name[0] = '\0';
+        victim->state = RESCACHE_SLOT_NONAME;
+    }
+
+    rescacheLock(cache, F_UNLCK);
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
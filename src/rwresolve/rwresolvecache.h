@@ -0,0 +1,179 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+#ifndef _RWRESOLVECACHE_H
+#define _RWRESOLVECACHE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <silk/silk.h>
+
+RCSIDENTVAR(rcsID_RWRESOLVECACHE_H, "$SiLK: rwresolvecache.h $");
+
+#include <silk/skipaddr.h>
+
+
+/*
+**  rwresolvecache.h
+**
+**    A persistent cache of DNS names for rwresolve.
+**
+**    The cache is a file of fixed size that is mapped into memory.
+**    After a small header, the file holds an open-addressing table
+**    of fixed-size slots keyed by IP address, where each slot holds
+**    the host name (or a flag noting that the address has no name)
+**    and the time at which the entry expires.
+**
+**    An address may only live in one of RESCACHE_WAYS consecutive
+**    slots starting at its hash.  When all of those slots are in use,
+**    one is chosen with the CLOCK (second chance) algorithm: every
+**    hit sets a slot's referenced bit, and the hand passes over the
+**    candidate slots clearing the bits until it finds a slot whose
+**    bit is clear.  The file therefore never grows and is never
+**    flushed wholesale.
+**
+**    Several rwresolve processes may share one file.  Lookups hold a
+**    shared fcntl() lock and stores hold an exclusive lock.  When the
+**    file cannot be opened for writing, it is used read-only.
+**
+**    The file is in the native byte order of the machine that
+**    created it.
+*/
+
+
+/* the number of slots an address may occupy */
+#define RESCACHE_WAYS           8
+
+/* the default and the maximum number of entries in a new cache */
+#define RESCACHE_ENTRIES_DEF    (1 << 16)
+#define RESCACHE_ENTRIES_MAX    (1 << 22)
+
+/* names of this length or longer are not cached */
+#define RESCACHE_NAME_MAX       232
+
+typedef struct rescache_st rescache_t;
+
+/* the result of a lookup */
+typedef enum rescache_result_en {
+    /* the address is not in the cache or its entry has expired */
+    RESCACHE_MISS,
+    /* the address has a name, which was copied to the caller */
+    RESCACHE_NAME,
+    /* a previous lookup found that the address has no name */
+    RESCACHE_NONAME
+} rescache_result_t;
+
+
+/*
+ *  status = rescacheOpen(&cache, path, entries);
+ *
+ *    Open the cache file at 'path' and store the handle in the
+ *    location referenced by 'cache'.  If 'path' does not exist or is
+ *    empty, create a cache that holds 'entries' names, rounded up to
+ *    a power of 2; otherwise 'entries' is ignored.  Return 0 on
+ *    success.  Print an error and return -1 on failure.
+ */
+int
+rescacheOpen(
+    rescache_t        **cache,
+    const char         *path,
+    uint32_t            entries);
+
+/*
+ *  rescacheClose(&cache);
+ *
+ *    Unmap and close the cache file and destroy the handle.  Does
+ *    nothing if 'cache' references NULL.
+ */
+void
+rescacheClose(
+    rescache_t        **cache);
+
+/*
+ *  result = rescacheLookup(cache, ip, name, namesize);
+ *
+ *    Find 'ip' in 'cache'.  When the result is RESCACHE_NAME, the
+ *    name is copied into 'name', whose size is 'namesize'.
+ */
+rescache_result_t
+rescacheLookup(
+    rescache_t         *cache,
+    const skipaddr_t   *ip,
+    char               *name,
+    size_t              namesize);
+
+/*
+ *  rescacheStore(cache, ip, name, ttl);
+ *
+ *    Store 'name' as the name of 'ip' in 'cache' for 'ttl' seconds.
+ *    When 'name' is NULL, record that 'ip' has no name.  Does
+ *    nothing when the cache is read-only or 'name' is too long.
+ */
+void
+rescacheStore(
+    rescache_t         *cache,
+    const skipaddr_t   *ip,
+    const char         *name,
+    uint32_t            ttl);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _RWRESOLVECACHE_H */
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -0,0 +1,42 @@
+#! /usr/bin/perl -w
+#
+#
+# RCSIDENT("$SiLK: rwresolve-cache-stub.pl $")
+
+use strict;
+use SiLKTests;
+
+my $rwresolve = check_silk_app('rwresolve-stub');
+my %temp;
+$temp{log} = make_tempname('log');
+$temp{cache} = make_tempname('cache');
+
+# The stub resolver, which only the rwresolve-stub test program
+# contains, names addresses whose final octet is even and appends
+# each lookup to the log.  The first run fills the persistent cache;
+# the second run must be answered entirely from the cache.
+my $run = ("printf '10.0.0.2|10.0.0.3|x\\n10.0.0.2|10.0.0.4|y\\n'"
+           ." | SILK_RWRESOLVE_STUB=$temp{log} $rwresolve"
+           ." --resolver=gethostbyaddr --cache-file=$temp{cache}");
+my $want = ("host-10.0.0.2.stub|10.0.0.3|x\n"
+            ."host-10.0.0.2.stub|host-10.0.0.4.stub|y\n");
+
+my $first = `$run`;
+die "ERROR: First run failed\n"
+    if $?;
+die "ERROR: First run produced unexpected output:\n$first"
+    unless $first eq $want;
+my $lookups = `cat $temp{log}`;
+die "ERROR: First run made unexpected lookups:\n$lookups"
+    unless $lookups eq "10.0.0.2\n10.0.0.3\n10.0.0.4\n";
+
+my $second = `$run`;
+die "ERROR: Second run failed\n"
+    if $?;
+die "ERROR: Second run produced different output:\n$second"
+    unless $second eq $first;
+my $after = `cat $temp{log}`;
+die "ERROR: Second run was not answered from the cache:\n$after"
+    unless $after eq $lookups;
+
+exit 0;
@@ -125,7 +125,7 @@ invoke_trw_model(
 
         rwcurr   = &(flows[i]);
         dip_curr = rwRecGetDIPv4(rwcurr);
-        if (options.verbose_flows) {
+        if (options.verbose_flows && !metrics->quiet) {
             fprintf(RWSCAN_VERBOSE_FH, "%4u/%4u  ", i + 1,
                     metrics->event_size);
             print_flow(rwcurr);
@@ -133,7 +133,7 @@ invoke_trw_model(
         counters->flows++;
 
         if (dip_curr != dip_prev) {
-            pthread_mutex_lock(&trw_data.mutex);
+            /* the IPset is not modified, so no lock is needed */
             if (skIPSetCheckRecordDIP(trw_data.existing, rwcurr)) {
                 counters->hits++;
             } else {
@@ -143,7 +143,6 @@ invoke_trw_model(
                     counters->hits++;
                 }
             }
-            pthread_mutex_unlock(&trw_data.mutex);
             counters->dips++;
         }
         if ((rwRecGetFlags(rwcurr) & TCP_FLAGS_STATE) == SYN_FLAG) {
@@ -249,7 +248,7 @@ invoke_blr_model(
          * counters which will be used later. */
         for (i = 0; i < metrics->event_size; i++) {
             rwcurr = &(flows[i]);
-            if (options.verbose_flows) {
+            if (options.verbose_flows && !metrics->quiet) {
                 fprintf(RWSCAN_VERBOSE_FH, "%4u/%4u  ", i + 1,
                         metrics->event_size);
                 print_flow(rwcurr);
@@ -300,13 +299,133 @@ invoke_blr_model(
 }
 
 
+/*
+ *  status = classify_event(work);
+ *
+ *    Run the models selected by --scan-model on the event in 'work',
+ *    whose flows must be sorted by dip, and set the event_class of
+ *    its metrics.  The flows are reordered.  The TRW counters are
+ *    allocated in 'work' and must be freed by the caller.  Return 0
+ *    on success or -1 on an allocation failure.
+ */
+int
+classify_event(
+    worker_thread_data_t   *work)
+{
+    event_metrics_t *metrics = work->metrics;
+
+    if ((metrics->protocol == IPPROTO_TCP)
+        && (options.scan_model == RWSCAN_MODEL_HYBRID
+            || options.scan_model == RWSCAN_MODEL_TRW))
+    {
+        work->counters = (trw_counters_t*)calloc(1, sizeof(trw_counters_t));
+        if (work->counters == NULL) {
+            skAppPrintOutOfMemory("TRW counters");
+            return -1;
+        }
+        invoke_trw_model(work);
+    }
+    if ((metrics->event_class != EVENT_SCAN
+         && metrics->event_class != EVENT_FLOOD
+         && metrics->event_class != EVENT_BACKSCATTER)
+        && (options.scan_model == RWSCAN_MODEL_HYBRID
+            || options.scan_model == RWSCAN_MODEL_BLR))
+    {
+        qsort(work->flows, metrics->event_size, sizeof(rwRec),
+              rwrec_compare_proto_stime);
+        invoke_blr_model(work);
+    }
+    return 0;
+}
+
+
+/*
+ *  status = report_event(metrics);
+ *
+ *    Count the classified event in 'metrics' in the summary, and
+ *    write it to the output when it is a scan.  Return 0 on success
+ *    or -1 on an allocation failure.
+ */
+int
+report_event(
+    const event_metrics_t  *metrics)
+{
+    switch (metrics->event_class) {
+      case EVENT_SCAN:
+      {
+          scan_info_t *scan = (scan_info_t*)malloc(sizeof(scan_info_t));
+
+          print_verbose_results((RWSCAN_VERBOSE_FH, "\tscan (%.3f)\n",
+                                 metrics->scan_probability));
+
+          if (scan == NULL) {
+              skAppPrintOutOfMemory("scan data");
+              return -1;
+          }
+
+          /* yup, it's a scan */
+          pthread_mutex_lock(&summary_metrics.mutex);
+          summary_metrics.scanners++;
+          pthread_mutex_unlock(&summary_metrics.mutex);
+          memset(scan, 0, sizeof(scan_info_t));
+          scan->ip        = metrics->sip;
+          scan->model     = metrics->model;
+          scan->stime     = metrics->stime;
+          scan->etime     = metrics->etime;
+          scan->flows     = metrics->event_size;
+          scan->pkts      = metrics->pkts;
+          scan->bytes     = metrics->bytes;
+          scan->proto     = metrics->protocol;
+          scan->scan_prob = metrics->scan_probability;
+
+          assert(scan->scan_prob > 0);
+
+          pthread_mutex_lock(&output_mutex);
+          write_scan_record(scan, out_scans.of_fp, options.no_columns,
+                            options.delimiter,
+                            options.model_fields);
+          pthread_mutex_unlock(&output_mutex);
+          free(scan);
+      }
+        break;
+      case EVENT_BENIGN:
+        print_verbose_results((RWSCAN_VERBOSE_FH, "\tbenign (%.3f)\n",
+                               metrics->scan_probability));
+        pthread_mutex_lock(&summary_metrics.mutex);
+        summary_metrics.benign++;
+        pthread_mutex_unlock(&summary_metrics.mutex);
+        break;
+      case EVENT_BACKSCATTER:
+        print_verbose_results((RWSCAN_VERBOSE_FH, "\tbackscatter\n"));
+        pthread_mutex_lock(&summary_metrics.mutex);
+        summary_metrics.backscatter++;
+        pthread_mutex_unlock(&summary_metrics.mutex);
+        break;
+      case EVENT_FLOOD:
+        print_verbose_results((RWSCAN_VERBOSE_FH, "\tflood\n"));
+        pthread_mutex_lock(&summary_metrics.mutex);
+        summary_metrics.flooders++;
+        pthread_mutex_unlock(&summary_metrics.mutex);
+        break;
+      case EVENT_UNKNOWN:
+        print_verbose_results((RWSCAN_VERBOSE_FH, "\tunknown (%.3f)\n",
+                               metrics->scan_probability));
+        pthread_mutex_lock(&summary_metrics.mutex);
+        summary_metrics.unknown++;
+        pthread_mutex_unlock(&summary_metrics.mutex);
+        break;
+    }
+    return 0;
+}
+
+
 #ifndef SKTHREAD_UNKNOWN_ID
 /* Create a local copy of the function from libsilk-thrd. */
 /*
  *    Tell the current thread to ignore all signals except those
  *    indicating a failure (e.g., SIGBUS and SIGSEGV).
  */
-static void
+void
 skthread_ignore_signals(
     void)
 {
@@ -342,7 +461,6 @@ worker_thread(
     worker_thread_data_t *mywork;
     cleanup_node_t       *cleanup_node;
 
-    rwRec           *flows;
     event_metrics_t *metrics;
 
     /* ignore all signals */
@@ -364,7 +482,6 @@ worker_thread(
         workqueue_get(work_queue, &mynode);
         mywork = (worker_thread_data_t *) mynode;
 
-        flows   = mywork->flows;
         metrics = mywork->metrics;
 
         pthread_mutex_unlock(&work_queue->mutex);
@@ -374,93 +491,8 @@ worker_thread(
                                num2dot(metrics->sip),
                                metrics->protocol, metrics->event_size));
 
-        if ((metrics->protocol == IPPROTO_TCP)
-            && (options.scan_model == RWSCAN_MODEL_HYBRID
-                || options.scan_model == RWSCAN_MODEL_TRW))
-        {
-            mywork->counters
-                = (trw_counters_t*)calloc(1, sizeof(trw_counters_t));
-            if (mywork->counters == NULL) {
-                skAppPrintOutOfMemory("TRW counters");
-                return NULL;
-            }
-            memset(mywork->counters, 0, sizeof(trw_counters_t));
-            invoke_trw_model(mywork);
-        }
-        if ((metrics->event_class != EVENT_SCAN
-             && metrics->event_class != EVENT_FLOOD
-             && metrics->event_class != EVENT_BACKSCATTER)
-            && (options.scan_model == RWSCAN_MODEL_HYBRID
-                || options.scan_model == RWSCAN_MODEL_BLR))
-        {
-            qsort(flows, metrics->event_size, sizeof(rwRec),
-                  rwrec_compare_proto_stime);
-            invoke_blr_model(mywork);
-        }
-        switch (metrics->event_class) {
-          case EVENT_SCAN:
-          {
-              scan_info_t *scan = (scan_info_t*)malloc(sizeof(scan_info_t));
-
-              print_verbose_results((RWSCAN_VERBOSE_FH, "\tscan (%.3f)\n",
-                                     metrics->scan_probability));
-
-              if (scan == NULL) {
-                  skAppPrintOutOfMemory("scan data");
-                  return NULL;
-              }
-
-              /* yup, it's a scan */
-              pthread_mutex_lock(&summary_metrics.mutex);
-              summary_metrics.scanners++;
-              pthread_mutex_unlock(&summary_metrics.mutex);
-              memset(scan, 0, sizeof(scan_info_t));
-              scan->ip        = metrics->sip;
-              scan->model     = metrics->model;
-              scan->stime     = metrics->stime;
-              scan->etime     = metrics->etime;
-              scan->flows     = metrics->event_size;
-              scan->pkts      = metrics->pkts;
-              scan->bytes     = metrics->bytes;
-              scan->proto     = metrics->protocol;
-              scan->scan_prob = metrics->scan_probability;
-
-              assert(scan->scan_prob > 0);
-
-              pthread_mutex_lock(&output_mutex);
-              write_scan_record(scan, out_scans.of_fp, options.no_columns,
-                                options.delimiter,
-                                options.model_fields);
-              pthread_mutex_unlock(&output_mutex);
-              free(scan);
-          }
-            break;
-          case EVENT_BENIGN:
-            print_verbose_results((RWSCAN_VERBOSE_FH, "\tbenign (%.3f)\n",
-                                   metrics->scan_probability));
-            pthread_mutex_lock(&summary_metrics.mutex);
-            summary_metrics.benign++;
-            pthread_mutex_unlock(&summary_metrics.mutex);
-            break;
-          case EVENT_BACKSCATTER:
-            print_verbose_results((RWSCAN_VERBOSE_FH, "\tbackscatter\n"));
-            pthread_mutex_lock(&summary_metrics.mutex);
-            summary_metrics.backscatter++;
-            pthread_mutex_unlock(&summary_metrics.mutex);
-            break;
-          case EVENT_FLOOD:
-            print_verbose_results((RWSCAN_VERBOSE_FH, "\tflood\n"));
-            pthread_mutex_lock(&summary_metrics.mutex);
-            summary_metrics.flooders++;
-            pthread_mutex_unlock(&summary_metrics.mutex);
-            break;
-          case EVENT_UNKNOWN:
-            print_verbose_results((RWSCAN_VERBOSE_FH, "\tunknown (%.3f)\n",
-                                   metrics->scan_probability));
-            pthread_mutex_lock(&summary_metrics.mutex);
-            summary_metrics.unknown++;
-            pthread_mutex_unlock(&summary_metrics.mutex);
-            break;
+        if (classify_event(mywork) || report_event(metrics)) {
+            return NULL;
         }
 
         if (mywork->flows) {
@@ -728,15 +760,22 @@ int main(
 
     pthread_mutex_init(&summary_metrics.mutex, NULL);
 
-    cleanup_queue = workqueue_create(options.worker_threads);
-
-    work_queue = workqueue_create(options.work_queue_depth);
-
     if (!options.no_titles) {
         write_scan_header(out_scans.of_fp, options.no_columns,
                           options.delimiter, options.model_fields);
     }
 
+    if (options.stream) {
+        if (process_stream()) {
+            rv = EXIT_FAILURE;
+        }
+        goto SUMMARY;
+    }
+
+    cleanup_queue = workqueue_create(options.worker_threads);
+
+    work_queue = workqueue_create(options.work_queue_depth);
+
     if (create_worker_threads()) {
         fprintf(RWSCAN_VERBOSE_FH, "Error starting worker threads!\n");
         skAbort();
@@ -765,6 +804,7 @@ int main(
     workqueue_destroy(work_queue);
     workqueue_destroy(cleanup_queue);
 
+  SUMMARY:
     if (options.verbose_progress) {
         fprintf(RWSCAN_VERBOSE_FH, "Read %u flows\n",
                 summary_metrics.total_flows);
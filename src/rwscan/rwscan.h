@@ -145,10 +145,13 @@ RCSIDENTVAR(rcsID_RWSCAN_H, "$SiLK: rwscan.h b7b8edebba12 2015-01-05 18:05:21Z m
 
 #define RWSCAN_MAX_FIELD_DEFS 256
 
+/* default for --stream-idle-time, in seconds */
+#define RWSCAN_STREAM_IDLE_TIME 3600
+
 #define RWSCAN_VERBOSE_FH stderr
 
 #define print_verbose_results(args)                                  \
-    if (options.verbose_results &&                                   \
+    if (options.verbose_results && !metrics->quiet &&                \
         (metrics->event_size >= options.verbose_results))            \
     {                                                                \
         flockfile(RWSCAN_VERBOSE_FH);                                \
@@ -214,6 +217,8 @@ typedef struct options_st {
     uint32_t     verbose_progress;
     uint32_t     worker_threads;
     uint32_t     work_queue_depth;
+    uint8_t      stream;
+    uint32_t     stream_idle_time;
 } options_t;
 
 typedef struct summary_metrics_st {
@@ -300,6 +305,10 @@ typedef struct event_metrics_st {
     enum EventClassification event_class;
     double scan_probability;
     enum ScanModel model;
+
+    /* when non-zero, do not print verbose flows or results; set
+     * while an unfinished event is evaluated in --stream mode */
+    uint8_t quiet;
 } event_metrics_t;
 
 typedef struct trw_counters_st {
@@ -381,6 +390,25 @@ void
 join_threads(
     void);
 
+int
+classify_event(
+    worker_thread_data_t   *work);
+int
+report_event(
+    const event_metrics_t  *metrics);
+
+/* scan detection on input ordered by time (--stream) */
+int
+process_stream(
+    void);
+
+#ifndef SKTHREAD_UNKNOWN_ID
+/* local copy of the function from libsilk-thrd, in rwscan.c */
+void
+skthread_ignore_signals(
+    void);
+#endif
+
 void
 print_flow(
     const rwRec        *rwcurr);
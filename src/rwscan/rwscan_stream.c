@@ -0,0 +1,723 @@
+/*
+** Copyright (C) 2006-2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+
+/*
+**  rwscan_stream.c
+**
+**    Scan detection for input that is ordered by time rather than
+**    sorted by sip, proto, and dip (--stream).
+**
+**    The main thread reads the records and passes each one to the
+**    worker thread that owns its source IP, chosen by hashing the
+**    source IP.  Records are passed in batches through a work queue
+**    that belongs to the worker, so the workers do not share a
+**    queue or its lock.  Each worker keeps a table of the events
+**    (source IP and protocol) it owns, with the flows of each event.
+**
+**    An event is evaluated with the scan models each time its number
+**    of flows doubles, beginning at EVENT_FLOW_THRESHOLD flows.  Once
+**    an evaluation finds a scan, the event's flows are freed and
+**    later flows only update its totals.  An event is finished when
+**    the input moves more than --stream-idle-time seconds past the
+**    event's latest flow, or when the input ends.  A scan that has
+**    been found is then written, and any other event is classified
+**    from all its flows exactly as in the sorted mode.
+*/
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: rwscan_stream.c $");
+
+#include "rwscan.h"
+
+
+/* TYPEDEFS AND DEFINES */
+
+/* number of records in a batch passed to a worker */
+#define STREAM_BATCH_SIZE  1024
+
+/* minimum number of batches that may be queued for each worker */
+#define STREAM_MIN_QUEUE_DEPTH  4
+
+/* number of flows an event initially has room for */
+#define STREAM_INITIAL_FLOWS  64
+
+/* number of events a worker's table initially holds; must be a power
+ * of 2 */
+#define STREAM_INITIAL_CAPACITY  (1 << 12)
+
+/* index that ends a list of events */
+#define STREAM_NONE  UINT32_MAX
+
+/* A batch of records for one worker */
+typedef struct stream_batch_st {
+    /* must be first */
+    work_queue_node_t node;
+    /* the latest start time (seconds) of the input when the batch
+     * was queued */
+    uint32_t          now;
+    uint32_t          count;
+    rwRec             recs[STREAM_BATCH_SIZE];
+} stream_batch_t;
+
+/* An event that has not been finished */
+typedef struct stream_event_st {
+    event_metrics_t  *metrics;
+    /* the flows, or NULL once a scan has been found */
+    rwRec            *flows;
+    uint32_t          flows_alloc;
+    /* number of flows at which to evaluate the event next */
+    uint32_t          next_check;
+    /* latest start time (seconds) of a flow in the event */
+    uint32_t          last_time;
+    uint32_t          sip;
+    uint8_t           proto;
+    /* whether an evaluation has found a scan */
+    uint8_t           detected;
+    /* next event in the same hash bucket or on the free list */
+    uint32_t          hash_next;
+    /* neighbors in the list ordered by time of last update */
+    uint32_t          lru_prev;
+    uint32_t          lru_next;
+} stream_event_t;
+
+/* A worker and the events it owns.  Only the worker uses the event
+ * table.  Events are referenced by index so that the array may be
+ * grown with realloc(). */
+typedef struct stream_worker_st {
+    pthread_t         thread;
+    int               threadnum;
+    work_queue_t     *queue;
+    /* the batch the main thread is filling */
+    stream_batch_t   *batch;
+
+    stream_event_t   *events;
+    uint32_t         *buckets;
+    uint32_t          bucket_mask;
+    uint32_t          capacity;
+    /* number of entries in 'events' that have ever been used */
+    uint32_t          used;
+    /* list of unused entries below 'used' */
+    uint32_t          free_list;
+    /* events updated least and most recently */
+    uint32_t          lru_head;
+    uint32_t          lru_tail;
+} stream_worker_t;
+
+
+/* LOCAL VARIABLE DEFINITIONS */
+
+static stream_worker_t *workers;
+static uint32_t num_workers;
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  h = streamHash(sip, proto);
+ *
+ *    Return the hash of an event's key.  The high bits choose the
+ *    worker and the low bits choose the bucket.
+ */
+static uint32_t
+streamHash(
+    uint32_t            sip,
+    uint8_t             proto)
+{
+    uint64_t h = ((uint64_t)sip << 8) | proto;
+
+    h *= UINT64_C(0x9e3779b97f4a7c15);
+    h ^= h >> 29;
+    return (uint32_t)h;
+}
+
+
+/*
+ *  streamTableResize(w, num_buckets);
+ *
+ *    Replace the hash table of worker 'w' with one having
+ *    'num_buckets' buckets, a power of 2, and rehash its events.
+ */
+static void
+streamTableResize(
+    stream_worker_t    *w,
+    uint32_t            num_buckets)
+{
+    stream_event_t *ev;
+    uint32_t b;
+    uint32_t idx;
+
+    free(w->buckets);
+    w->buckets = (uint32_t*)malloc(num_buckets * sizeof(uint32_t));
+    if (NULL == w->buckets) {
+        skAppPrintOutOfMemory("stream event table");
+        exit(EXIT_FAILURE);
+    }
+    for (b = 0; b < num_buckets; ++b) {
+        w->buckets[b] = STREAM_NONE;
+    }
+    w->bucket_mask = num_buckets - 1;
+
+    for (idx = w->lru_head; idx != STREAM_NONE; idx = ev->lru_next) {
+        ev = &w->events[idx];
+        b = streamHash(ev->sip, ev->proto) & w->bucket_mask;
+        ev->hash_next = w->buckets[b];
+        w->buckets[b] = idx;
+    }
+}
+
+
+/*
+ *  idx = streamEventGet(w, rwrec);
+ *
+ *    Return the index of the event in worker 'w' for the source and
+ *    protocol of 'rwrec', creating the event if needed, and make it
+ *    the most recently updated event.
+ */
+static uint32_t
+streamEventGet(
+    stream_worker_t    *w,
+    const rwRec        *rwrec)
+{
+    stream_event_t *ev;
+    uint32_t sip = rwRecGetSIPv4(rwrec);
+    uint8_t proto = rwRecGetProto(rwrec);
+    uint32_t b = streamHash(sip, proto) & w->bucket_mask;
+    uint32_t idx;
+
+    for (idx = w->buckets[b]; idx != STREAM_NONE; idx = ev->hash_next) {
+        ev = &w->events[idx];
+        if (ev->sip == sip && ev->proto == proto) {
+            /* move to the most recently updated end */
+            if (w->lru_tail != idx) {
+                w->events[ev->lru_next].lru_prev = ev->lru_prev;
+                if (STREAM_NONE == ev->lru_prev) {
+                    w->lru_head = ev->lru_next;
+                } else {
+                    w->events[ev->lru_prev].lru_next = ev->lru_next;
+                }
+                ev->lru_prev = w->lru_tail;
+                ev->lru_next = STREAM_NONE;
+                w->events[w->lru_tail].lru_next = idx;
+                w->lru_tail = idx;
+            }
+            return idx;
+        }
+    }
+
+    /* create the event */
+    if (STREAM_NONE != w->free_list) {
+        idx = w->free_list;
+        w->free_list = w->events[idx].hash_next;
+    } else {
+        if (w->used == w->capacity) {
+            w->capacity *= 2;
+            ev = w->events;
+            w->events = (stream_event_t*)realloc(
+                w->events, w->capacity * sizeof(stream_event_t));
+            if (NULL == w->events) {
+                skAppPrintOutOfMemory("stream event table");
+                exit(EXIT_FAILURE);
+            }
+            streamTableResize(w, w->capacity);
+            b = streamHash(sip, proto) & w->bucket_mask;
+        }
+        idx = w->used++;
+    }
+    ev = &w->events[idx];
+    memset(ev, 0, sizeof(*ev));
+    ev->sip = sip;
+    ev->proto = proto;
+    ev->next_check = EVENT_FLOW_THRESHOLD;
+    ev->flows_alloc = STREAM_INITIAL_FLOWS;
+    ev->flows = (rwRec*)malloc(ev->flows_alloc * sizeof(rwRec));
+    ev->metrics = (event_metrics_t*)calloc(1, sizeof(event_metrics_t));
+    if (NULL == ev->flows || NULL == ev->metrics) {
+        skAppPrintOutOfMemory("event flow data");
+        exit(EXIT_FAILURE);
+    }
+    ev->metrics->protocol = proto;
+    ev->metrics->sip      = sip;
+    ev->metrics->stime    = rwRecGetStartSeconds(rwrec);
+    ev->metrics->etime    = rwRecGetEndSeconds(rwrec);
+
+    ev->hash_next = w->buckets[b];
+    w->buckets[b] = idx;
+
+    ev->lru_prev = w->lru_tail;
+    ev->lru_next = STREAM_NONE;
+    if (STREAM_NONE == w->lru_tail) {
+        w->lru_head = idx;
+    } else {
+        w->events[w->lru_tail].lru_next = idx;
+    }
+    w->lru_tail = idx;
+
+    return idx;
+}
+
+
+/*
+ *  streamEventCheck(ev);
+ *
+ *    Evaluate the unfinished event 'ev' with the scan models.  When
+ *    it is a scan, keep the result and free the event's flows.
+ */
+static void
+streamEventCheck(
+    stream_event_t     *ev)
+{
+    worker_thread_data_t work;
+    event_metrics_t check;
+
+    memset(&check, 0, sizeof(check));
+    check.protocol   = ev->metrics->protocol;
+    check.sip        = ev->metrics->sip;
+    check.stime      = ev->metrics->stime;
+    check.etime      = ev->metrics->etime;
+    check.event_size = ev->metrics->event_size;
+    check.quiet      = 1;
+
+    memset(&work, 0, sizeof(work));
+    work.flows = ev->flows;
+    work.metrics = &check;
+
+    qsort(ev->flows, check.event_size, sizeof(rwRec), rwrec_compare_dip);
+    if (classify_event(&work)) {
+        exit(EXIT_FAILURE);
+    }
+    free(work.counters);
+
+    if (EVENT_SCAN == check.event_class) {
+        check.quiet = 0;
+        memcpy(ev->metrics, &check, sizeof(check));
+        ev->detected = 1;
+        free(ev->flows);
+        ev->flows = NULL;
+    } else {
+        ev->next_check *= 2;
+    }
+}
+
+
+/*
+ *  streamEventAddFlow(ev, rwrec);
+ *
+ *    Add the flow 'rwrec' to the event 'ev'.
+ */
+static void
+streamEventAddFlow(
+    stream_event_t     *ev,
+    const rwRec        *rwrec)
+{
+    event_metrics_t *metrics = ev->metrics;
+    rwRec *old_flows;
+
+    /* update the times as process_file() does */
+    if (rwRecGetStartSeconds(rwrec) < metrics->stime) {
+        metrics->stime = rwRecGetStartSeconds(rwrec);
+    }
+    if (rwRecGetStartSeconds(rwrec) > metrics->etime) {
+        metrics->etime = rwRecGetEndSeconds(rwrec);
+    }
+    if (rwRecGetStartSeconds(rwrec) > ev->last_time) {
+        ev->last_time = rwRecGetStartSeconds(rwrec);
+    }
+    metrics->event_size++;
+
+    if (ev->detected) {
+        metrics->pkts  += rwRecGetPkts(rwrec);
+        metrics->bytes += rwRecGetBytes(rwrec);
+        return;
+    }
+
+    if (metrics->event_size > ev->flows_alloc) {
+        old_flows = ev->flows;
+        ev->flows_alloc *= 2;
+        ev->flows = (rwRec*)realloc(ev->flows,
+                                    ev->flows_alloc * sizeof(rwRec));
+        if (NULL == ev->flows) {
+            skAppPrintOutOfMemory("event flow data");
+            free(old_flows);
+            exit(EXIT_FAILURE);
+        }
+    }
+    RWREC_COPY(&ev->flows[metrics->event_size - 1], rwrec);
+
+    if (metrics->event_size == ev->next_check) {
+        streamEventCheck(ev);
+    }
+}
+
+
+/*
+ *  streamEventFinish(w, idx);
+ *
+ *    Classify and report the event at 'idx' in worker 'w' and remove
+ *    it from the worker's table.
+ */
+static void
+streamEventFinish(
+    stream_worker_t    *w,
+    uint32_t            idx)
+{
+    stream_event_t *ev = &w->events[idx];
+    event_metrics_t *metrics = ev->metrics;
+    worker_thread_data_t work;
+    uint32_t *prev;
+
+    /* unlink from the hash bucket */
+    prev = &w->buckets[streamHash(ev->sip, ev->proto) & w->bucket_mask];
+    while (*prev != idx) {
+        assert(*prev != STREAM_NONE);
+        prev = &w->events[*prev].hash_next;
+    }
+    *prev = ev->hash_next;
+
+    /* unlink from the list ordered by update */
+    if (STREAM_NONE == ev->lru_prev) {
+        w->lru_head = ev->lru_next;
+    } else {
+        w->events[ev->lru_prev].lru_next = ev->lru_next;
+    }
+    if (STREAM_NONE == ev->lru_next) {
+        w->lru_tail = ev->lru_prev;
+    } else {
+        w->events[ev->lru_next].lru_prev = ev->lru_prev;
+    }
+    ev->hash_next = w->free_list;
+    w->free_list = idx;
+
+    print_verbose_results((RWSCAN_VERBOSE_FH, "%d. %s [%d] (%u) ",
+                           w->threadnum, num2dot(metrics->sip),
+                           metrics->protocol, metrics->event_size));
+
+    if (!ev->detected) {
+        memset(&work, 0, sizeof(work));
+        work.flows = ev->flows;
+        work.metrics = metrics;
+        qsort(ev->flows, metrics->event_size, sizeof(rwRec),
+              rwrec_compare_dip);
+        if (classify_event(&work)) {
+            exit(EXIT_FAILURE);
+        }
+        free(work.counters);
+    }
+    if (report_event(metrics)) {
+        exit(EXIT_FAILURE);
+    }
+    free(ev->flows);
+    free(ev->metrics);
+    ev->flows = NULL;
+    ev->metrics = NULL;
+}
+
+
+/* Key of an event; used to finish the events remaining at the end
+ * of the input in the order of the sorted mode */
+typedef struct stream_key_st {
+    uint32_t    sip;
+    uint32_t    proto;
+    uint32_t    idx;
+} stream_key_t;
+
+/*
+ *  cmp = streamKeyCompare(a, b);
+ *
+ *    Compare two stream_key_t by sip then proto.
+ */
+static int
+streamKeyCompare(
+    const void         *a,
+    const void         *b)
+{
+    const stream_key_t *ka = (const stream_key_t*)a;
+    const stream_key_t *kb = (const stream_key_t*)b;
+
+    if (ka->sip != kb->sip) {
+        return ((ka->sip < kb->sip) ? -1 : 1);
+    }
+    return ((int)ka->proto - (int)kb->proto);
+}
+
+
+/*  THREAD ENTRY POINT  */
+static void *
+streamWorker(
+    void               *arg)
+{
+    stream_worker_t *w = (stream_worker_t*)arg;
+    work_queue_node_t *node;
+    stream_batch_t *batch;
+    stream_key_t *order;
+    uint32_t count;
+    uint32_t idx;
+    uint32_t i;
+
+    skthread_ignore_signals();
+
+    for (;;) {
+        pthread_mutex_lock(&w->queue->mutex);
+        while (workqueue_depth(w->queue) == 0 && w->queue->active) {
+            pthread_cond_wait(&w->queue->cond_posted, &w->queue->mutex);
+        }
+        if (workqueue_depth(w->queue) == 0) {
+            /* deactivated and drained */
+            pthread_mutex_unlock(&w->queue->mutex);
+            break;
+        }
+        workqueue_get(w->queue, &node);
+        pthread_mutex_unlock(&w->queue->mutex);
+        batch = (stream_batch_t*)node;
+
+        for (i = 0; i < batch->count; ++i) {
+            idx = streamEventGet(w, &batch->recs[i]);
+            if (rwRecGetStartSeconds(&batch->recs[i])
+                > ((uint64_t)w->events[idx].last_time
+                   + options.stream_idle_time)
+                && w->events[idx].metrics->event_size > 0)
+            {
+                /* the event was idle too long; begin a new one */
+                streamEventFinish(w, idx);
+                idx = streamEventGet(w, &batch->recs[i]);
+            }
+            streamEventAddFlow(&w->events[idx], &batch->recs[i]);
+        }
+
+        /* finish the events that have been idle too long */
+        while (w->lru_head != STREAM_NONE
+               && (batch->now - w->events[w->lru_head].last_time
+                   > options.stream_idle_time))
+        {
+            streamEventFinish(w, w->lru_head);
+        }
+        free(batch);
+
+        pthread_mutex_lock(&w->queue->mutex);
+        w->queue->pending--;
+        pthread_cond_signal(&w->queue->cond_avail);
+        pthread_mutex_unlock(&w->queue->mutex);
+    }
+
+    /* finish the remaining events in order by sip and proto */
+    count = 0;
+    order = (stream_key_t*)malloc((w->used + 1) * sizeof(stream_key_t));
+    if (NULL == order) {
+        skAppPrintOutOfMemory("stream event list");
+        exit(EXIT_FAILURE);
+    }
+    for (idx = w->lru_head; idx != STREAM_NONE; idx = w->events[idx].lru_next) {
+        order[count].sip = w->events[idx].sip;
+        order[count].proto = w->events[idx].proto;
+        order[count].idx = idx;
+        ++count;
+    }
+    qsort(order, count, sizeof(stream_key_t), streamKeyCompare);
+    for (i = 0; i < count; ++i) {
+        streamEventFinish(w, order[i].idx);
+    }
+    free(order);
+
+    return NULL;
+}
+
+
+/*
+ *  streamSendBatch(w, now);
+ *
+ *    Queue the batch of worker 'w' for the worker, marking it with
+ *    the time 'now', and start a new batch.
+ */
+static void
+streamSendBatch(
+    stream_worker_t    *w,
+    uint32_t            now)
+{
+    w->batch->now = now;
+    workqueue_put(w->queue, &w->batch->node);
+    w->batch = (stream_batch_t*)malloc(sizeof(stream_batch_t));
+    if (NULL == w->batch) {
+        skAppPrintOutOfMemory("stream batch");
+        exit(EXIT_FAILURE);
+    }
+    w->batch->count = 0;
+}
+
+
+int
+process_stream(
+    void)
+{
+    skstream_t *in;
+    char *input_file;
+    rwRec rwrec;
+    stream_worker_t *w;
+    uint32_t depth;
+    uint32_t now = 0;
+    uint32_t total_flows = 0;
+    uint32_t ignored_flows = 0;
+    uint32_t i;
+    int rv;
+
+    num_workers = options.worker_threads;
+    if (num_workers < 1) {
+        num_workers = 1;
+    }
+    depth = options.work_queue_depth;
+    if (depth < STREAM_MIN_QUEUE_DEPTH) {
+        depth = STREAM_MIN_QUEUE_DEPTH;
+    }
+
+    workers = (stream_worker_t*)calloc(num_workers, sizeof(stream_worker_t));
+    if (NULL == workers) {
+        skAppPrintOutOfMemory("stream workers");
+        return -1;
+    }
+    for (i = 0; i < num_workers; ++i) {
+        w = &workers[i];
+        w->threadnum = i + 1;
+        w->queue = workqueue_create(depth);
+        w->batch = (stream_batch_t*)malloc(sizeof(stream_batch_t));
+        w->capacity = STREAM_INITIAL_CAPACITY;
+        w->events = (stream_event_t*)malloc(w->capacity
+                                            * sizeof(stream_event_t));
+        if (NULL == w->queue || NULL == w->batch || NULL == w->events) {
+            skAppPrintOutOfMemory("stream workers");
+            return -1;
+        }
+        w->batch->count = 0;
+        w->free_list = STREAM_NONE;
+        w->lru_head = STREAM_NONE;
+        w->lru_tail = STREAM_NONE;
+        streamTableResize(w, w->capacity);
+
+        if (pthread_create(&w->thread, NULL, streamWorker, (void*)w)) {
+            fprintf(RWSCAN_VERBOSE_FH, "Error starting worker threads!\n");
+            skAbort();
+        }
+        if (options.verbose_progress) {
+            fprintf(RWSCAN_VERBOSE_FH, "created worker thread %u\n", i + 1);
+        }
+    }
+
+    RWREC_CLEAR(&rwrec);
+    while (skOptionsCtxNextArgument(optctx, &input_file) == 0) {
+        if (options.verbose_progress) {
+            fprintf(RWSCAN_VERBOSE_FH, "processing: %s\n", input_file);
+        }
+        rv = skStreamOpenSilkFlow(&in, input_file, SK_IO_READ);
+        if (rv) {
+            skStreamPrintLastErr(in, rv, &skAppPrintErr);
+            skStreamDestroy(&in);
+            continue;
+        }
+        skStreamSetIPv6Policy(in, SK_IPV6POLICY_ASV4);
+
+        while (skStreamReadRecord(in, &rwrec) == SKSTREAM_OK) {
+            ++total_flows;
+            if ((rwRecGetProto(&rwrec) != IPPROTO_ICMP)
+                && (rwRecGetProto(&rwrec) != IPPROTO_TCP)
+                && (rwRecGetProto(&rwrec) != IPPROTO_UDP))
+            {
+                ++ignored_flows;
+                continue;
+            }
+            if (rwRecGetStartSeconds(&rwrec) > now) {
+                now = rwRecGetStartSeconds(&rwrec);
+            }
+            w = &workers[((uint64_t)streamHash(rwRecGetSIPv4(&rwrec),
+                                               rwRecGetProto(&rwrec))
+                          * num_workers) >> 32];
+            RWREC_COPY(&w->batch->recs[w->batch->count], &rwrec);
+            if (++w->batch->count == STREAM_BATCH_SIZE) {
+                streamSendBatch(w, now);
+            }
+        }
+        skStreamDestroy(&in);
+    }
+
+    /* send the partial batches and wait for the workers */
+    for (i = 0; i < num_workers; ++i) {
+        w = &workers[i];
+        if (w->batch->count) {
+            streamSendBatch(w, now);
+        }
+        free(w->batch);
+        workqueue_deactivate(w->queue);
+    }
+    for (i = 0; i < num_workers; ++i) {
+        w = &workers[i];
+        pthread_join(w->thread, NULL);
+        workqueue_destroy(w->queue);
+        free(w->events);
+        free(w->buckets);
+    }
+    free(workers);
+    workers = NULL;
+
+    pthread_mutex_lock(&summary_metrics.mutex);
+    summary_metrics.total_flows += total_flows;
+    summary_metrics.ignored_flows += ignored_flows;
+    pthread_mutex_unlock(&summary_metrics.mutex);
+
+    return 0;
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -84,6 +84,8 @@ typedef enum {
     OPT_VERBOSE_PROGRESS,
     OPT_VERBOSE_FLOWS,
     OPT_VERBOSE_RESULTS,
+    OPT_STREAM,
+    OPT_STREAM_IDLE_TIME,
     OPT_TRW_SIP_SET
 } appOptionsEnum;
 
@@ -106,6 +108,8 @@ static struct option appOptions[] = {
     {"verbose-progress",   REQUIRED_ARG, 0, OPT_VERBOSE_PROGRESS  },
     {"verbose-flows",      NO_ARG,       0, OPT_VERBOSE_FLOWS     },
     {"verbose-results",    OPTIONAL_ARG, 0, OPT_VERBOSE_RESULTS   },
+    {"stream",             NO_ARG,       0, OPT_STREAM            },
+    {"stream-idle-time",   REQUIRED_ARG, 0, OPT_STREAM_IDLE_TIME  },
     {"trw-sip-set",        REQUIRED_ARG, 0, OPT_TRW_SIP_SET       },
     {0, 0, 0, 0} /* sentinel entry */
 };
@@ -137,6 +141,9 @@ static const char *appHelp[] = {
     ("Write individual flows for events.  This produces\n"
      "\ta lot of output, mostly useful for debugging. Def. No"),
     ("Print verbose results for each source IP.  Def. No"),
+    ("Accept input ordered by time, such as the output of\n"
+     "\trwfilter, rather than input sorted by sip, proto, and dip. Def. No"),
+    NULL, /* generate dynamically */
     ("Deprecated alias for --trw-internal-set"),
     (char *)NULL
 };
@@ -161,7 +168,8 @@ appUsageLong(
      "\tDetects scanning activity in SiLK Flow records.  The output\n"  \
      "\tis a pipe-delimited textual file suitable for loading into a\n" \
      "\trelational database.  The input records should be pre-sorted\n" \
-     "\twith rwsort(1) by sip, proto, and dip.\n")
+     "\twith rwsort(1) by sip, proto, and dip, or --stream should be\n" \
+     "\tgiven.\n")
 
     FILE *fh = USAGE_FH;
     int   i;
@@ -187,6 +195,13 @@ appUsageLong(
                 "\tthat a connection succeeds given the hypothesis that the\n"
                 "\tremote source is benign.  Def. %.6f", TRW_DEFAULT_THETA1);
             break;
+          case OPT_STREAM_IDLE_TIME:
+            fprintf(
+                fh,
+                "When --stream is given, finish the flows from a source\n"
+                "\tonce the input has moved this many seconds past the source's\n"
+                "\tlatest flow.  Def. %d", RWSCAN_STREAM_IDLE_TIME);
+            break;
           default:
             fprintf(fh, "%s", appHelp[i]);
             break;
@@ -348,6 +363,17 @@ appOptionsHandler(
             goto PARSE_ERROR;
         }
         break;
+
+      case OPT_STREAM:
+        options.stream = 1;
+        break;
+
+      case OPT_STREAM_IDLE_TIME:
+        rv = skStringParseUint32(&options.stream_idle_time, opt_arg, 1, 0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
     }
 
     return 0;                                    /* OK */
@@ -405,6 +431,7 @@ appSetup(
     options.delimiter               = '|';
     options.trw_theta0              = TRW_DEFAULT_THETA0;
     options.trw_theta1              = TRW_DEFAULT_THETA1;
+    options.stream_idle_time        = RWSCAN_STREAM_IDLE_TIME;
 
     memset(&trw_data, 0, sizeof(trw_data_t));
     pthread_mutex_init(&trw_data.mutex, NULL);
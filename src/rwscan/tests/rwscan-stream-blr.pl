@@ -0,0 +1,17 @@
+#! /usr/bin/perl -w
+# MD5: f2139c4ff3ad18e59c7ac9aeebc2b3d4
+# TEST: ../rwfilter/rwfilter --daddr=192.168.0.0/16 --pass=stdout ../../tests/data.rwf | ../rwsort/rwsort --fields=stime - ../../tests/scandata.rwf | ./rwscan --scan-mode=2 --stream
+
+use strict;
+use SiLKTests;
+
+my $rwscan = check_silk_app('rwscan');
+my $rwfilter = check_silk_app('rwfilter');
+my $rwsort = check_silk_app('rwsort');
+my %file;
+$file{data} = get_data_or_exit77('data');
+$file{scandata} = get_data_or_exit77('scandata');
+my $cmd = "$rwfilter --daddr=192.168.0.0/16 --pass=stdout $file{data} | $rwsort --fields=stime - $file{scandata} | $rwscan --scan-mode=2 --stream";
+my $md5 = "f2139c4ff3ad18e59c7ac9aeebc2b3d4";
+
+check_md5_output($md5, $cmd);
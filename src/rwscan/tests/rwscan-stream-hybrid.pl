@@ -0,0 +1,21 @@
+#! /usr/bin/perl -w
+# MD5: a7eb30fec65095966363491278c5a957
+# TEST: ../rwfilter/rwfilter --daddr=192.168.0.0/16 --pass=/tmp/rwscan-stream-hybrid-in ../../tests/data.rwf && ../rwset/rwset --dip=/tmp/rwscan-stream-hybrid-inset /tmp/rwscan-stream-hybrid-in && ../rwsort/rwsort --fields=stime /tmp/rwscan-stream-hybrid-in ../../tests/scandata.rwf | ./rwscan --trw-sip-set=/tmp/rwscan-stream-hybrid-inset --stream --stream-idle-time=1800
+
+use strict;
+use SiLKTests;
+
+my $rwscan = check_silk_app('rwscan');
+my $rwfilter = check_silk_app('rwfilter');
+my $rwset = check_silk_app('rwset');
+my $rwsort = check_silk_app('rwsort');
+my %file;
+$file{data} = get_data_or_exit77('data');
+$file{scandata} = get_data_or_exit77('scandata');
+my %temp;
+$temp{in} = make_tempname('in');
+$temp{inset} = make_tempname('inset');
+my $cmd = "$rwfilter --daddr=192.168.0.0/16 --pass=$temp{in} $file{data} && $rwset --dip=$temp{inset} $temp{in} && $rwsort --fields=stime $temp{in} $file{scandata} | $rwscan --trw-sip-set=$temp{inset} --stream --stream-idle-time=1800";
+my $md5 = "a7eb30fec65095966363491278c5a957";
+
+check_md5_output($md5, $cmd);
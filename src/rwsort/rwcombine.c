@@ -92,6 +92,19 @@
  *    consideration than in rwsort and rwdedupe that sort all of their
  *    input.
  *
+ *    When the --stream switch is given, rwcombine assumes the input
+ *    is ordered by start time and does not sort.  Records that have
+ *    the T flag set are held in an active-flow table keyed by the
+ *    same fields that define a bin.  A record that has the C flag
+ *    set is combined with the active flow that has the same key, and
+ *    the flow is written once a record without the T flag is added
+ *    to it.  An active flow is also written when the start time of
+ *    the input moves more than the --max-idle-time past the flow's
+ *    end time, or when the table is full and the flow is the one
+ *    updated least recently.  The size of the table is limited by
+ *    the --buffer-size, so memory use depends on the number of
+ *    concurrent flows and no temporary files are used.
+ *
  */
 
 #include <silk/silk.h>
@@ -106,6 +119,66 @@ RCSIDENT("$SiLK: rwcombine.c e24d53743a28 2015-01-16 22:48:56Z mthomas $");
 
 #define TIMEOUT_MASK (SK_TCPSTATE_TIMEOUT_KILLED|SK_TCPSTATE_TIMEOUT_STARTED)
 
+/*
+ *    Number of flows the active-flow table initially holds when
+ *    --stream is given.  Must be a power of 2.
+ */
+#define ACTIVE_INITIAL_CAPACITY  (1 << 12)
+
+/*
+ *    Index that ends a list of active flows.
+ */
+#define ACTIVE_NONE  UINT32_MAX
+
+/*
+ *    Mix the 64-bit value 'v' into the hash 'h'.
+ */
+#define ACTIVE_MIX(h, v)                                        \
+    do {                                                        \
+        (h) = ((h) ^ (uint64_t)(v)) * UINT64_C(0x9e3779b97f4a7c15); \
+        (h) ^= (h) >> 32;                                       \
+    } while (0)
+
+/*
+ *    A flow in the active-flow table.
+ */
+typedef struct active_flow_st {
+    rwRec       rec;
+    /* hash of the record's key */
+    uint64_t    hash;
+    /* next flow in the same hash bucket or on the free list */
+    uint32_t    hash_next;
+    /* neighbors in the list ordered by time of last update */
+    uint32_t    lru_prev;
+    uint32_t    lru_next;
+} active_flow_t;
+
+/*
+ *    The active-flow table.  Flows are referenced by their index
+ *    into 'flows' so that the array may be grown with realloc().
+ */
+typedef struct active_table_st {
+    active_flow_t  *flows;
+    /* the hash table; each holds the index of the first flow in the
+     * bucket or ACTIVE_NONE */
+    uint32_t       *buckets;
+    /* number of entries in 'buckets' minus 1 */
+    uint32_t        bucket_mask;
+    /* number of entries allocated in 'flows' */
+    uint32_t        capacity;
+    /* maximum number of flows allowed by the --buffer-size */
+    uint32_t        max_flows;
+    /* number of entries in 'flows' that have ever been used */
+    uint32_t        used;
+    /* number of active flows */
+    uint32_t        count;
+    /* list of unused entries below 'used' */
+    uint32_t        free_list;
+    /* flows updated least and most recently */
+    uint32_t        lru_head;
+    uint32_t        lru_tail;
+} active_table_t;
+
 
 /* EXPORTED VARIABLES */
 
@@ -131,6 +204,9 @@ uint64_t buffer_size = DEFAULT_BUFFER_SIZE;
 /* maximum amount of idle time to allow between flows */
 int64_t max_idle_time = INT64_MAX;
 
+/* whether to combine time-ordered input in a single pass */
+int stream_input = 0;
+
 
 /* LOCAL VARIABLES */
 
@@ -147,6 +223,9 @@ struct counts_st {
     uint64_t    penult_idle;
 } counts;
 
+/* the active flows when --stream is given */
+static active_table_t active;
+
 
 /* FUNCTION DEFINITIONS */
 
@@ -356,28 +435,21 @@ rwrecCompare(
 }
 
 
+/*
+ *  cmp = rwrecCompareKey(a, b);
+ *
+ *     Returns an ordering on the recs pointed to `a' and `b' by
+ *     comparing the fields listed in the sort_fields[] array other
+ *     than the time fields.  Records for which this function returns
+ *     0 are pieces of the same flow.
+ */
 static int
-rwrecCombine(
-    rwRec              *rec1,
-    const rwRec        *rec2)
+rwrecCompareKey(
+    const rwRec        *a,
+    const rwRec        *b)
 {
-    sktime_t sTime1, sTime2;
-    sktime_t eTime1, eTime2;
-    uint32_t bytes1, bytes2;
-    uint32_t pkts1, pkts2;
-    double idle_time;
-    size_t i;
-
-    /* First record must have been killed by an active timeout */
-    if (!(rwRecGetTcpState(rec1) & SK_TCPSTATE_TIMEOUT_KILLED)) {
-        return -1;
-    }
-    /* Second record must be marked as a continuation record */
-    if (!(rwRecGetTcpState(rec2) & SK_TCPSTATE_TIMEOUT_STARTED)) {
-        return -1;
-    }
+    uint32_t i;
 
-    /* All fields other than time must be identical */
     for (i = 0; i < num_fields; ++i) {
         switch (sort_fields[i]) {
           case RWREC_FIELD_STIME:
@@ -385,48 +457,48 @@ rwrecCombine(
             break;
 
           case RWREC_FIELD_SIP:
-            RETURN_IF_SORTED_IPS(rwRecMemGetSIP, rec1, rec2);
+            RETURN_IF_SORTED_IPS(rwRecMemGetSIP, a, b);
             break;
 
           case RWREC_FIELD_DIP:
-            RETURN_IF_SORTED_IPS(rwRecMemGetDIP, rec1, rec2);
+            RETURN_IF_SORTED_IPS(rwRecMemGetDIP, a, b);
             break;
 
           case RWREC_FIELD_NHIP:
-            RETURN_IF_SORTED_IPS(rwRecMemGetNhIP, rec1, rec2);
+            RETURN_IF_SORTED_IPS(rwRecMemGetNhIP, a, b);
             break;
 
           case RWREC_FIELD_SPORT:
-            RETURN_IF_SORTED(rwRecGetSPort, rec1, rec2);
+            RETURN_IF_SORTED(rwRecGetSPort, a, b);
             break;
 
           case RWREC_FIELD_DPORT:
-            RETURN_IF_SORTED(rwRecGetDPort, rec1, rec2);
+            RETURN_IF_SORTED(rwRecGetDPort, a, b);
             break;
 
           case RWREC_FIELD_PROTO:
-            RETURN_IF_SORTED(rwRecGetProto, rec1, rec2);
+            RETURN_IF_SORTED(rwRecGetProto, a, b);
             break;
 
           case RWREC_FIELD_SID:
-            RETURN_IF_SORTED(rwRecGetSensor, rec1, rec2);
+            RETURN_IF_SORTED(rwRecGetSensor, a, b);
             break;
 
           case RWREC_FIELD_INPUT:
-            RETURN_IF_SORTED(rwRecGetInput, rec1, rec2);
+            RETURN_IF_SORTED(rwRecGetInput, a, b);
             break;
 
           case RWREC_FIELD_OUTPUT:
-            RETURN_IF_SORTED(rwRecGetOutput, rec1, rec2);
+            RETURN_IF_SORTED(rwRecGetOutput, a, b);
             break;
 
           case RWREC_FIELD_APPLICATION:
-            RETURN_IF_SORTED(rwRecGetApplication, rec1, rec2);
+            RETURN_IF_SORTED(rwRecGetApplication, a, b);
             break;
 
           case RWREC_FIELD_FTYPE_CLASS:
           case RWREC_FIELD_FTYPE_TYPE:
-            RETURN_IF_SORTED(rwRecGetFlowType, rec1, rec2);
+            RETURN_IF_SORTED(rwRecGetFlowType, a, b);
             break;
 
           case RWREC_FIELD_ETIME:
@@ -445,6 +517,35 @@ rwrecCombine(
         }
     }
 
+    return 0;
+}
+
+
+static int
+rwrecCombine(
+    rwRec              *rec1,
+    const rwRec        *rec2)
+{
+    sktime_t sTime1, sTime2;
+    sktime_t eTime1, eTime2;
+    uint32_t bytes1, bytes2;
+    uint32_t pkts1, pkts2;
+    double idle_time;
+
+    /* First record must have been killed by an active timeout */
+    if (!(rwRecGetTcpState(rec1) & SK_TCPSTATE_TIMEOUT_KILLED)) {
+        return -1;
+    }
+    /* Second record must be marked as a continuation record */
+    if (!(rwRecGetTcpState(rec2) & SK_TCPSTATE_TIMEOUT_STARTED)) {
+        return -1;
+    }
+
+    /* All fields other than time must be identical */
+    if (0 != rwrecCompareKey(rec1, rec2)) {
+        return -1;
+    }
+
     sTime1 = rwRecGetStartTime(rec1);
     sTime2 = rwRecGetStartTime(rec2);
     eTime1 = rwRecGetEndTime(rec1);
@@ -549,6 +650,44 @@ rwrecCombine(
     return 0;
 }
 
+/*
+ *  status = writeRecord(rwrec);
+ *
+ *    Update the counts based on the timeout flags of 'rwrec' and
+ *    write it to the output stream.  Return 0 on success or -1 on a
+ *    fatal write error.
+ */
+static int
+writeRecord(
+    const rwRec        *rwrec)
+{
+    int rv;
+
+    switch (rwRecGetTcpState(rwrec) & TIMEOUT_MASK) {
+      case 0:
+        ++counts.combined;
+        break;
+      case TIMEOUT_MASK:
+        ++counts.miss_start_end;
+        break;
+      case SK_TCPSTATE_TIMEOUT_KILLED:
+        ++counts.miss_end;
+        break;
+      case SK_TCPSTATE_TIMEOUT_STARTED:
+        ++counts.miss_start;
+        break;
+    }
+    rv = skStreamWriteRecord(out_stream, rwrec);
+    if (0 != rv) {
+        skStreamPrintLastErr(out_stream, rv, &skAppPrintErr);
+        if (SKSTREAM_ERROR_IS_FATAL(rv)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
 /*
  *  status = compHeapNodes(b, a, v_recs);
  *
@@ -797,26 +936,8 @@ mergeFiles(
             } else {
                 /* we successfully opened all (remaining) temp files,
                  * write to record to the final destination */
-                switch (rwRecGetTcpState((rwRec*)lowest_rec) & TIMEOUT_MASK) {
-                  case 0:
-                    ++counts.combined;
-                    break;
-                  case TIMEOUT_MASK:
-                    ++counts.miss_start_end;
-                    break;
-                  case SK_TCPSTATE_TIMEOUT_KILLED:
-                    ++counts.miss_end;
-                    break;
-                  case SK_TCPSTATE_TIMEOUT_STARTED:
-                    ++counts.miss_start;
-                    break;
-                }
-                rv = skStreamWriteRecord(out_stream, (rwRec*)lowest_rec);
-                if (0 != rv) {
-                    skStreamPrintLastErr(out_stream, rv, &skAppPrintErr);
-                    if (SKSTREAM_ERROR_IS_FATAL(rv)) {
-                        appExit(EXIT_FAILURE);
-                    }
+                if (writeRecord((rwRec*)lowest_rec)) {
+                    appExit(EXIT_FAILURE);
                 }
             }
         } while (heap_count > 0);
@@ -1074,27 +1195,9 @@ sortRandom(
         for (c = 1; c < record_count; ++c) {
             if (0 != rwrecCombine((rwRec*)cur_node, (rwRec*)next_node)) {
                 /* records differ. print earlier record */
-                switch (rwRecGetTcpState((rwRec*)cur_node) & TIMEOUT_MASK) {
-                  case 0:
-                    ++counts.combined;
-                    break;
-                  case TIMEOUT_MASK:
-                    ++counts.miss_start_end;
-                    break;
-                  case SK_TCPSTATE_TIMEOUT_KILLED:
-                    ++counts.miss_end;
-                    break;
-                  case SK_TCPSTATE_TIMEOUT_STARTED:
-                    ++counts.miss_start;
-                    break;
-                }
-                rv = skStreamWriteRecord(out_stream, (rwRec*)cur_node);
-                if (0 != rv) {
-                    skStreamPrintLastErr(out_stream, rv, &skAppPrintErr);
-                    if (SKSTREAM_ERROR_IS_FATAL(rv)) {
-                        free(record_buffer);
-                        appExit(EXIT_FAILURE);
-                    }
+                if (writeRecord((rwRec*)cur_node)) {
+                    free(record_buffer);
+                    appExit(EXIT_FAILURE);
                 }
                 cur_node = next_node;
             }
@@ -1103,27 +1206,9 @@ sortRandom(
             next_node += NODE_SIZE;
         }
         /* print remaining record */
-        switch (rwRecGetTcpState((rwRec*)cur_node) & TIMEOUT_MASK) {
-          case 0:
-            ++counts.combined;
-            break;
-          case TIMEOUT_MASK:
-            ++counts.miss_start_end;
-            break;
-          case SK_TCPSTATE_TIMEOUT_KILLED:
-            ++counts.miss_end;
-            break;
-          case SK_TCPSTATE_TIMEOUT_STARTED:
-            ++counts.miss_start;
-            break;
-        }
-        rv = skStreamWriteRecord(out_stream, (rwRec*)cur_node);
-        if (0 != rv) {
-            skStreamPrintLastErr(out_stream, rv, &skAppPrintErr);
-            if (SKSTREAM_ERROR_IS_FATAL(rv)) {
-                free(record_buffer);
-                appExit(EXIT_FAILURE);
-            }
+        if (writeRecord((rwRec*)cur_node)) {
+            free(record_buffer);
+            appExit(EXIT_FAILURE);
         }
     } else {
         /* no longer have a need for the record buffer */
@@ -1140,6 +1225,506 @@ sortRandom(
 }
 
 
+/*
+ *  h = activeHashIP(h, ipaddr);
+ *
+ *    Mix the IP address 'ipaddr' into the hash 'h' and return the
+ *    result.
+ */
+static uint64_t
+activeHashIP(
+    uint64_t            h,
+    const skipaddr_t   *ipaddr)
+{
+#if SK_ENABLE_IPV6
+    if (skipaddrIsV6(ipaddr)) {
+        uint64_t ip6[2];
+
+        skipaddrGetV6(ipaddr, ip6);
+        ACTIVE_MIX(h, ip6[0]);
+        ACTIVE_MIX(h, ip6[1]);
+        return h;
+    }
+#endif
+    ACTIVE_MIX(h, skipaddrGetV4(ipaddr));
+    return h;
+}
+
+
+/*
+ *  h = activeHashKey(rwrec);
+ *
+ *    Compute the hash of the fields of 'rwrec' that rwrecCompareKey()
+ *    compares.
+ */
+static uint64_t
+activeHashKey(
+    const rwRec        *rwrec)
+{
+    skipaddr_t ipaddr;
+    uint64_t h = 0;
+    uint32_t i;
+
+    for (i = 0; i < num_fields; ++i) {
+        switch (sort_fields[i]) {
+          case RWREC_FIELD_SIP:
+            rwRecMemGetSIP(rwrec, &ipaddr);
+            h = activeHashIP(h, &ipaddr);
+            break;
+          case RWREC_FIELD_DIP:
+            rwRecMemGetDIP(rwrec, &ipaddr);
+            h = activeHashIP(h, &ipaddr);
+            break;
+          case RWREC_FIELD_NHIP:
+            rwRecMemGetNhIP(rwrec, &ipaddr);
+            h = activeHashIP(h, &ipaddr);
+            break;
+          case RWREC_FIELD_SPORT:
+            ACTIVE_MIX(h, rwRecGetSPort(rwrec));
+            break;
+          case RWREC_FIELD_DPORT:
+            ACTIVE_MIX(h, rwRecGetDPort(rwrec));
+            break;
+          case RWREC_FIELD_PROTO:
+            ACTIVE_MIX(h, rwRecGetProto(rwrec));
+            break;
+          case RWREC_FIELD_SID:
+            ACTIVE_MIX(h, rwRecGetSensor(rwrec));
+            break;
+          case RWREC_FIELD_INPUT:
+            ACTIVE_MIX(h, rwRecGetInput(rwrec));
+            break;
+          case RWREC_FIELD_OUTPUT:
+            ACTIVE_MIX(h, rwRecGetOutput(rwrec));
+            break;
+          case RWREC_FIELD_APPLICATION:
+            ACTIVE_MIX(h, rwRecGetApplication(rwrec));
+            break;
+          case RWREC_FIELD_FTYPE_CLASS:
+          case RWREC_FIELD_FTYPE_TYPE:
+            ACTIVE_MIX(h, rwRecGetFlowType(rwrec));
+            break;
+          default:
+            break;
+        }
+    }
+
+    h ^= h >> 33;
+    h *= UINT64_C(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    return h;
+}
+
+
+/*
+ *  status = activeTableResize(num_buckets);
+ *
+ *    Replace the hash table of the active-flow table with one having
+ *    'num_buckets' buckets, a power of 2, and rehash the active
+ *    flows.  Return 0 on success or -1 on allocation failure.
+ */
+static int
+activeTableResize(
+    uint32_t            num_buckets)
+{
+    uint32_t *buckets;
+    uint32_t b;
+    uint32_t idx;
+
+    buckets = (uint32_t*)malloc(num_buckets * sizeof(uint32_t));
+    if (NULL == buckets) {
+        return -1;
+    }
+    for (b = 0; b < num_buckets; ++b) {
+        buckets[b] = ACTIVE_NONE;
+    }
+    free(active.buckets);
+    active.buckets = buckets;
+    active.bucket_mask = num_buckets - 1;
+
+    for (idx = active.lru_head;
+         idx != ACTIVE_NONE;
+         idx = active.flows[idx].lru_next)
+    {
+        b = (uint32_t)(active.flows[idx].hash & active.bucket_mask);
+        active.flows[idx].hash_next = active.buckets[b];
+        active.buckets[b] = idx;
+    }
+    return 0;
+}
+
+
+/*
+ *  status = activeTableCreate();
+ *
+ *    Initialize the active-flow table, limiting its size by the
+ *    global 'buffer_size'.  Return 0 on success or -1 on allocation
+ *    failure.
+ */
+static int
+activeTableCreate(
+    void)
+{
+    memset(&active, 0, sizeof(active));
+    active.free_list = ACTIVE_NONE;
+    active.lru_head = ACTIVE_NONE;
+    active.lru_tail = ACTIVE_NONE;
+
+    active.max_flows = (uint32_t)(buffer_size / sizeof(active_flow_t));
+    if (active.max_flows < MIN_IN_CORE_RECORDS) {
+        active.max_flows = MIN_IN_CORE_RECORDS;
+    }
+    active.capacity = ACTIVE_INITIAL_CAPACITY;
+    if (active.capacity > active.max_flows) {
+        active.capacity = active.max_flows;
+    }
+    TRACEMSG((("active flow table max_flows = %" PRIu32),
+              active.max_flows));
+
+    active.flows = (active_flow_t*)malloc(active.capacity
+                                          * sizeof(active_flow_t));
+    if (NULL == active.flows) {
+        return -1;
+    }
+    return activeTableResize(ACTIVE_INITIAL_CAPACITY);
+}
+
+
+/*
+ *  activeTableDestroy();
+ *
+ *    Free the memory used by the active-flow table.
+ */
+static void
+activeTableDestroy(
+    void)
+{
+    free(active.flows);
+    free(active.buckets);
+    memset(&active, 0, sizeof(active));
+}
+
+
+/*
+ *  idx = activeFlowFind(hash, rwrec);
+ *
+ *    Return the index of the active flow whose key matches that of
+ *    'rwrec', where 'hash' is the hash of that key, or ACTIVE_NONE if
+ *    there is no such flow.
+ */
+static uint32_t
+activeFlowFind(
+    uint64_t            hash,
+    const rwRec        *rwrec)
+{
+    uint32_t idx;
+
+    for (idx = active.buckets[hash & active.bucket_mask];
+         idx != ACTIVE_NONE;
+         idx = active.flows[idx].hash_next)
+    {
+        if (active.flows[idx].hash == hash
+            && 0 == rwrecCompareKey(&active.flows[idx].rec, rwrec))
+        {
+            return idx;
+        }
+    }
+    return ACTIVE_NONE;
+}
+
+
+/*
+ *  activeFlowTouch(idx);
+ *
+ *    Move the active flow at 'idx' to the most recently updated end
+ *    of the list of active flows.
+ */
+static void
+activeFlowTouch(
+    uint32_t            idx)
+{
+    active_flow_t *flow = &active.flows[idx];
+
+    if (active.lru_tail == idx) {
+        return;
+    }
+    /* unlink; since 'idx' is not the tail, lru_next is valid */
+    active.flows[flow->lru_next].lru_prev = flow->lru_prev;
+    if (ACTIVE_NONE == flow->lru_prev) {
+        active.lru_head = flow->lru_next;
+    } else {
+        active.flows[flow->lru_prev].lru_next = flow->lru_next;
+    }
+    /* append */
+    flow->lru_prev = active.lru_tail;
+    flow->lru_next = ACTIVE_NONE;
+    active.flows[active.lru_tail].lru_next = idx;
+    active.lru_tail = idx;
+}
+
+
+/*
+ *  status = activeFlowFlush(idx);
+ *
+ *    Write the active flow at 'idx' to the output and remove it from
+ *    the active-flow table.  Return 0 on success or -1 on a fatal
+ *    write error.
+ */
+static int
+activeFlowFlush(
+    uint32_t            idx)
+{
+    active_flow_t *flow = &active.flows[idx];
+    uint32_t *prev;
+
+    /* unlink from the hash bucket */
+    prev = &active.buckets[flow->hash & active.bucket_mask];
+    while (*prev != idx) {
+        assert(*prev != ACTIVE_NONE);
+        prev = &active.flows[*prev].hash_next;
+    }
+    *prev = flow->hash_next;
+
+    /* unlink from the list ordered by update */
+    if (ACTIVE_NONE == flow->lru_prev) {
+        active.lru_head = flow->lru_next;
+    } else {
+        active.flows[flow->lru_prev].lru_next = flow->lru_next;
+    }
+    if (ACTIVE_NONE == flow->lru_next) {
+        active.lru_tail = flow->lru_prev;
+    } else {
+        active.flows[flow->lru_next].lru_prev = flow->lru_prev;
+    }
+
+    flow->hash_next = active.free_list;
+    active.free_list = idx;
+    --active.count;
+
+    return writeRecord(&flow->rec);
+}
+
+
+/*
+ *  status = activeFlowAdd(hash, rwrec);
+ *
+ *    Add 'rwrec', whose key has the hash 'hash', to the active-flow
+ *    table as the most recently updated flow.  If the table is at
+ *    its maximum size, first write and remove the flow updated least
+ *    recently.  Return 0 on success or -1 on an allocation or write
+ *    error.
+ */
+static int
+activeFlowAdd(
+    uint64_t            hash,
+    const rwRec        *rwrec)
+{
+    active_flow_t *flow;
+    active_flow_t *old_flows;
+    uint32_t idx;
+    uint32_t b;
+
+    if (active.count == active.max_flows) {
+        if (activeFlowFlush(active.lru_head)) {
+            return -1;
+        }
+    }
+
+    if (ACTIVE_NONE != active.free_list) {
+        idx = active.free_list;
+        active.free_list = active.flows[idx].hash_next;
+    } else {
+        if (active.used == active.capacity) {
+            /* grow the table */
+            old_flows = active.flows;
+            active.capacity = ((active.capacity > active.max_flows / 2)
+                               ? active.max_flows
+                               : 2 * active.capacity);
+            TRACEMSG((("Growing active flow table to %" PRIu32 " flows"),
+                      active.capacity));
+            active.flows = (active_flow_t*)realloc(
+                active.flows, active.capacity * sizeof(active_flow_t));
+            if (NULL == active.flows) {
+                active.flows = old_flows;
+                skAppPrintOutOfMemory("active flow table");
+                return -1;
+            }
+            if (active.capacity > active.bucket_mask + 1
+                && activeTableResize(2 * (active.bucket_mask + 1)))
+            {
+                skAppPrintOutOfMemory("active flow hash table");
+                return -1;
+            }
+        }
+        idx = active.used;
+        ++active.used;
+    }
+    ++active.count;
+
+    flow = &active.flows[idx];
+    RWREC_COPY(&flow->rec, rwrec);
+    flow->hash = hash;
+
+    b = (uint32_t)(hash & active.bucket_mask);
+    flow->hash_next = active.buckets[b];
+    active.buckets[b] = idx;
+
+    flow->lru_prev = active.lru_tail;
+    flow->lru_next = ACTIVE_NONE;
+    if (ACTIVE_NONE == active.lru_tail) {
+        active.lru_head = idx;
+    } else {
+        active.flows[active.lru_tail].lru_next = idx;
+    }
+    active.lru_tail = idx;
+
+    return 0;
+}
+
+
+/*
+ *  combineStream();
+ *
+ *    Combine the records in input that is ordered by start time in a
+ *    single pass, using the active-flow table to hold the flows that
+ *    may be continued by a later record.
+ *
+ *    Exits the application if an error occurs.
+ */
+static void
+combineStream(
+    void)
+{
+    skstream_t *input_stream = NULL;
+    active_flow_t *flow;
+    rwRec rwrec;
+    sktime_t latest_stime = 0;
+    uint64_t hash;
+    uint32_t idx;
+    int rv;
+
+    counts.min_idle = UINT64_MAX;
+
+    if (activeTableCreate()) {
+        skAppPrintOutOfMemory("active flow table");
+        activeTableDestroy();
+        appExit(EXIT_FAILURE);
+    }
+
+    /* open first file */
+    rv = appNextInput(&input_stream);
+    if (rv < 0) {
+        activeTableDestroy();
+        appExit(EXIT_FAILURE);
+    }
+
+    /* write header to output */
+    rv = skStreamWriteSilkHeader(out_stream);
+    if (0 != rv) {
+        skStreamPrintLastErr(out_stream, rv, &skAppPrintErr);
+        if (SKSTREAM_ERROR_IS_FATAL(rv)) {
+            activeTableDestroy();
+            appExit(EXIT_FAILURE);
+        }
+    }
+
+    while (input_stream != NULL) {
+        /* read record */
+        rv = skStreamReadRecord(input_stream, &rwrec);
+        if (rv != SKSTREAM_OK) {
+            if (rv != SKSTREAM_ERR_EOF) {
+                skStreamPrintLastErr(input_stream, rv, &skAppPrintErr);
+            }
+            /* end of file: close current and open next */
+            skStreamDestroy(&input_stream);
+            rv = appNextInput(&input_stream);
+            if (rv < 0) {
+                activeTableDestroy();
+                appExit(EXIT_FAILURE);
+            }
+            continue;
+        }
+        ++counts.in;
+
+        /* write the flows that are idle too long to be continued by
+         * this or any later record */
+        if (rwRecGetStartTime(&rwrec) > latest_stime) {
+            latest_stime = rwRecGetStartTime(&rwrec);
+            while (active.lru_head != ACTIVE_NONE
+                   && (latest_stime
+                       - rwRecGetEndTime(&active.flows[active.lru_head].rec)
+                       > max_idle_time))
+            {
+                if (activeFlowFlush(active.lru_head)) {
+                    activeTableDestroy();
+                    appExit(EXIT_FAILURE);
+                }
+            }
+        }
+
+        if (0 == (rwRecGetTcpState(&rwrec) & TIMEOUT_MASK)) {
+            /* nothing to do to this record */
+            rv = skStreamWriteRecord(out_stream, &rwrec);
+            if (0 != rv) {
+                skStreamPrintLastErr(out_stream, rv, &skAppPrintErr);
+                if (SKSTREAM_ERROR_IS_FATAL(rv)) {
+                    activeTableDestroy();
+                    appExit(EXIT_FAILURE);
+                }
+            }
+            ++counts.unfrag;
+            continue;
+        }
+
+        hash = activeHashKey(&rwrec);
+        idx = activeFlowFind(hash, &rwrec);
+        if (idx != ACTIVE_NONE) {
+            flow = &active.flows[idx];
+            if (0 == rwrecCombine(&flow->rec, &rwrec)) {
+                /* the record continued the flow.  write the flow if
+                 * the record ended it */
+                if (rwRecGetTcpState(&flow->rec)
+                    & SK_TCPSTATE_TIMEOUT_KILLED)
+                {
+                    activeFlowTouch(idx);
+                } else if (activeFlowFlush(idx)) {
+                    activeTableDestroy();
+                    appExit(EXIT_FAILURE);
+                }
+                continue;
+            }
+            /* the record does not continue the flow, and no later
+             * record can */
+            if (activeFlowFlush(idx)) {
+                activeTableDestroy();
+                appExit(EXIT_FAILURE);
+            }
+        }
+
+        if (rwRecGetTcpState(&rwrec) & SK_TCPSTATE_TIMEOUT_KILLED) {
+            /* a later record may continue this one */
+            if (activeFlowAdd(hash, &rwrec)) {
+                activeTableDestroy();
+                appExit(EXIT_FAILURE);
+            }
+        } else if (writeRecord(&rwrec)) {
+            activeTableDestroy();
+            appExit(EXIT_FAILURE);
+        }
+    }
+
+    /* write the remaining flows */
+    while (active.lru_head != ACTIVE_NONE) {
+        if (activeFlowFlush(active.lru_head)) {
+            activeTableDestroy();
+            appExit(EXIT_FAILURE);
+        }
+    }
+
+    activeTableDestroy();
+}
+
+
 #if 0
 static void
 do_statistics_table(
@@ -1305,7 +1890,11 @@ int main(int argc, char **argv)
 
     appSetup(argc, argv);                 /* never returns on error */
 
-    sortRandom();
+    if (stream_input) {
+        combineStream();
+    } else {
+        sortRandom();
+    }
 
     counts.out = skStreamGetRecordCount(out_stream);
 
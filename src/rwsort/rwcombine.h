@@ -142,6 +142,9 @@ extern uint64_t buffer_size;
 /* maximum amount of idle time to allow between flows */
 extern int64_t max_idle_time;
 
+/* whether to combine time-ordered input in a single pass */
+extern int stream_input;
+
 
 /* FUNCTIONS */
 
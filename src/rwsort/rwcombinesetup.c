@@ -120,6 +120,7 @@ typedef enum {
     OPT_MAX_IDLE_TIME,
     OPT_PRINT_STATISTICS,
     OPT_OUTPUT_PATH,
+    OPT_STREAM,
     OPT_BUFFER_SIZE
 } appOptionsEnum;
 
@@ -130,6 +131,7 @@ static struct option appOptions[] = {
     {"max-idle-time",       REQUIRED_ARG, 0, OPT_MAX_IDLE_TIME},
     {"print-statistics",    OPTIONAL_ARG, 0, OPT_PRINT_STATISTICS},
     {"output-path",         REQUIRED_ARG, 0, OPT_OUTPUT_PATH},
+    {"stream",              NO_ARG,       0, OPT_STREAM},
     {"buffer-size",         REQUIRED_ARG, 0, OPT_BUFFER_SIZE},
     {0,0,0,0}               /* sentinel entry */
 };
@@ -147,6 +149,10 @@ static const char *appHelp[] = {
      "\targument provided to switch. Def. no"),
     ("Write the output to this location (a file, named pipe,\n"
      "\tor '-' or 'stdout'. Def. stdout"),
+    ("Assume the input is ordered by start time and combine\n"
+     "\tthe records in a single pass using a table of active flows. Flows\n"
+     "\tidle longer than --max-idle-time are written as the input advances.\n"
+     "\tDef. Sort the records"),
     NULL, /* generated dynamically */
     (char *)NULL
 };
@@ -218,9 +224,10 @@ appUsageLong(
           case OPT_BUFFER_SIZE:
             fprintf(fh,
                     ("Attempt to allocate this much memory for the in-core\n"
-                     "\tbuffer, in bytes."
-                     "  Append k, m, g, for kilo-, mega-, giga-bytes,\n"
-                     "\trespectively. Def. %" PRIu32 "\n"),
+                     "\tbuffer or the table of active flows, in bytes."
+                     "  Append k, m, g,\n"
+                     "\tfor kilo-, mega-, giga-bytes, respectively."
+                     " Def. %" PRIu32 "\n"),
                     (uint32_t)DEFAULT_BUFFER_SIZE);
             break;
           default:
@@ -539,6 +546,10 @@ appOptionsHandler(
         }
         break;
 
+      case OPT_STREAM:
+        stream_input = 1;
+        break;
+
       case OPT_BUFFER_SIZE:
         rv = skStringParseHumanUint64(&buffer_size, opt_arg,
                                       SK_HUMAN_NORMAL);
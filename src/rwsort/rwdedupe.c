@@ -85,6 +85,13 @@
 **  temporary files will be between 1 and 1.5 times the number of
 **  records.
 **
+**  When the --stream-window switch is given, the input is assumed to
+**  be ordered by start time, and rwdedupe removes duplicates in a
+**  single pass without sorting.  Each record is checked against a
+**  sliding-window set of the unique records whose start time is
+**  within the window of the latest start time seen (see skdedupe.h),
+**  and unique records are written in the order they are read.
+**
 */
 
 #include <silk/silk.h>
@@ -92,6 +99,7 @@
 RCSIDENT("$SiLK: rwdedupe.c e24d53743a28 2015-01-16 22:48:56Z mthomas $");
 
 #include "rwdedupe.h"
+#include <silk/skdedupe.h>
 #include <silk/skheap.h>
 
 
@@ -120,6 +128,11 @@ uint64_t buffer_size = DEFAULT_BUFFER_SIZE;
 /* differences to allow between flows */
 flow_delta_t delta;
 
+/* when non-negative, remove duplicates from time-ordered input in a
+ * single pass, remembering records whose start time is within this
+ * many milliseconds of the latest start time seen */
+int64_t stream_window = -1;
+
 
 /* FUNCTION DEFINITIONS */
 
@@ -836,13 +849,110 @@ sortRandom(
 }
 
 
+/*
+ *  dedupeStream();
+ *
+ *    Assume the input is ordered by start time.  Read each record,
+ *    check it against a sliding window of the unique records that
+ *    precede it, and write the record if it is not a duplicate.
+ *
+ *    Exits the application if an error occurs.
+ */
+static void
+dedupeStream(
+    void)
+{
+    skstream_t *input_rwios = NULL;
+    sk_dedupe_t *dedupe = NULL;
+    rwRec rwrec;
+    int rv;
+
+    if (skDedupeCreate(&dedupe, sort_fields, num_fields, stream_window)) {
+        skAppPrintOutOfMemory("duplicate table");
+        appExit(EXIT_FAILURE);
+    }
+    skDedupeSetDelta(dedupe, RWREC_FIELD_STIME, (uint32_t)delta.d_stime);
+    skDedupeSetDelta(dedupe, RWREC_FIELD_ELAPSED, delta.d_elapsed);
+    skDedupeSetDelta(dedupe, RWREC_FIELD_PKTS, delta.d_packets);
+    skDedupeSetDelta(dedupe, RWREC_FIELD_BYTES, delta.d_bytes);
+
+    /* open the first file; the header is written once its
+     * annotations have been copied */
+    rv = appNextInput(&input_rwios);
+    if (rv < 0) {
+        skDedupeDestroy(&dedupe);
+        appExit(EXIT_FAILURE);
+    }
+    if (0 == rv) {
+        rv = appWriteOutputHeader();
+    } else {
+        rv = skStreamWriteSilkHeader(out_rwios);
+        if (rv) {
+            skStreamPrintLastErr(out_rwios, rv, &skAppPrintErr);
+        }
+    }
+    if (rv) {
+        skStreamDestroy(&input_rwios);
+        skDedupeDestroy(&dedupe);
+        appExit(EXIT_FAILURE);
+    }
+
+    while (input_rwios != NULL) {
+        rv = skStreamReadRecord(input_rwios, &rwrec);
+        if (SKSTREAM_OK != rv) {
+            if (rv != SKSTREAM_ERR_EOF) {
+                skStreamPrintLastErr(input_rwios, rv, &skAppPrintErr);
+            }
+            /* end of file: close current and open next */
+            skStreamDestroy(&input_rwios);
+            rv = appNextInput(&input_rwios);
+            if (rv < 0) {
+                skDedupeDestroy(&dedupe);
+                appExit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        rv = skDedupeCheckRecord(dedupe, &rwrec);
+        if (rv) {
+            if (-1 == rv) {
+                skAppPrintOutOfMemory("duplicate table entry");
+                skStreamDestroy(&input_rwios);
+                skDedupeDestroy(&dedupe);
+                appExit(EXIT_FAILURE);
+            }
+            /* record is a duplicate */
+            continue;
+        }
+
+        rv = skStreamWriteRecord(out_rwios, &rwrec);
+        if (0 != rv) {
+            skStreamPrintLastErr(out_rwios, rv, &skAppPrintErr);
+            if (SKSTREAM_ERROR_IS_FATAL(rv)) {
+                skStreamDestroy(&input_rwios);
+                skDedupeDestroy(&dedupe);
+                appExit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    TRACEMSG((("Removed %" PRIu64 " duplicate records"),
+              skDedupeGetDuplicateCount(dedupe)));
+    skDedupeDestroy(&dedupe);
+}
+
+
 int main(int argc, char **argv)
 {
     int rv;
 
     appSetup(argc, argv);                 /* never returns on error */
 
-    sortRandom();
+    if (stream_window >= 0) {
+        dedupeStream();
+    } else {
+        sortRandom();
+    }
 
     /* close the file */
     if ((rv = skStreamClose(out_rwios))
@@ -152,6 +152,11 @@ extern uint64_t buffer_size;
 /* differences to allow between flows */
 extern flow_delta_t delta;
 
+/* when non-negative, remove duplicates from time-ordered input in a
+ * single pass, remembering records whose start time is within this
+ * many milliseconds of the latest start time seen */
+extern int64_t stream_window;
+
 
 /* FUNCTIONS */
 
@@ -166,6 +171,9 @@ appSetup(
 int
 appNextInput(
     skstream_t        **rwios);
+int
+appWriteOutputHeader(
+    void);
 
 
 #ifdef __cplusplus
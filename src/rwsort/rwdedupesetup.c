@@ -111,6 +111,7 @@ typedef enum {
     OPT_BYTES_DELTA,
     OPT_STIME_DELTA,
     OPT_DURATION_DELTA,
+    OPT_STREAM_WINDOW,
     OPT_OUTPUT_PATH,
     OPT_BUFFER_SIZE
 } appOptionsEnum;
@@ -122,6 +123,7 @@ static struct option appOptions[] = {
     {"bytes-delta",         REQUIRED_ARG, 0, OPT_BYTES_DELTA},
     {"stime-delta",         REQUIRED_ARG, 0, OPT_STIME_DELTA},
     {"duration-delta",      REQUIRED_ARG, 0, OPT_DURATION_DELTA},
+    {"stream-window",       REQUIRED_ARG, 0, OPT_STREAM_WINDOW},
     {"output-path",         REQUIRED_ARG, 0, OPT_OUTPUT_PATH},
     {"buffer-size",         REQUIRED_ARG, 0, OPT_BUFFER_SIZE},
     {0,0,0,0}               /* sentinel entry */
@@ -139,6 +141,11 @@ static const char *appHelp[] = {
      "\ttheir values differ by this number of milliseconds or less. Def. 0 "),
     ("Treat the duration field on two flows as identical if\n"
      "\ttheir values differ by this number of milliseconds or less. Def. 0 "),
+    ("Remove duplicates in a single pass over input that\n"
+     "\tis ordered by start time, comparing each record with the records\n"
+     "\twhose start time is within this number of milliseconds of the\n"
+     "\tlatest start time seen.  Records are written in input order.\n"
+     "\tDef. Sort the records to find duplicates"),
     ("Destination for output (stdout|pipe).\n"
      "\tDefault is stdout if stdout is not a terminal"),
     NULL, /* generated dynamically */
@@ -180,7 +187,8 @@ appUsageLong(
      "\tthe standard input and write the records to the named output path\n"  \
      "\tor to the standard output, removing any duplicate flow records.\n"    \
      "\tTwo records are duplicates when ALL fields are identical.  Note\n"    \
-     "\tthat the order of records is not maintained.\n")
+     "\tthat the order of records is not maintained unless the input is\n"    \
+     "\tordered by time and --stream-window is given.\n")
 
     FILE *fh = USAGE_FH;
     int i;
@@ -488,6 +496,14 @@ appOptionsHandler(
         delta.d_elapsed = tmp32;
         break;
 
+      case OPT_STREAM_WINDOW:
+        rv = skStringParseUint32(&tmp32, opt_arg, 0, 0);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        stream_window = tmp32;
+        break;
+
       case OPT_OUTPUT_PATH:
         /* check for switch given multiple times */
         if (out_rwios) {
@@ -749,7 +765,11 @@ appNextInput(
     int rv;
 
     retval = skOptionsCtxNextSilkFile(optctx, rwios, &skAppPrintErr);
-    if (0 == retval) {
+    if (SKHDR_LOCK_FIXED
+        == skHeaderGetLockStatus(skStreamGetSilkHeader(out_rwios)))
+    {
+        /* the header has been written; it cannot be modified */
+    } else if (0 == retval) {
         /* copy annotations and command line entries from the input to
          * the output */
         if ((rv = skHeaderCopyEntries(skStreamGetSilkHeader(out_rwios),
@@ -777,6 +797,33 @@ appNextInput(
 }
 
 
+/*
+ *  status = appWriteOutputHeader();
+ *
+ *    Add the invocation and the notes to the header of the output
+ *    stream and write the header.  Used when records are written
+ *    before all inputs have been opened; the header then contains
+ *    the annotations of the inputs opened so far.  Return 0 on
+ *    success or -1 on failure.
+ */
+int
+appWriteOutputHeader(
+    void)
+{
+    int rv;
+
+    if ((rv = skHeaderAddInvocation(skStreamGetSilkHeader(out_rwios),
+                                    1, pargc, pargv))
+        || (rv = skOptionsNotesAddToStream(out_rwios))
+        || (rv = skStreamWriteSilkHeader(out_rwios)))
+    {
+        skStreamPrintLastErr(out_rwios, rv, &skAppPrintErr);
+        return -1;
+    }
+    return 0;
+}
+
+
 /*
 ** Local Variables:
 ** mode:c
@@ -390,6 +390,73 @@ compHeapNodes(
 }
 
 
+/*
+ *  status = fillRecord(rwios, buf);
+ *
+ *    Reads a flow record from 'rwios' into the parameter 'buf' without
+ *    computing its key.  Return 1 if a record was read, or 0 if it
+ *    was not.
+ */
+static int
+fillRecord(
+    skstream_t         *rwios,
+    uint8_t            *buf)
+{
+    int rv;
+
+    rv = skStreamReadRecord(rwios, (rwRec*)buf);
+    if (rv) {
+        /* end of file or error getting record */
+        if (SKSTREAM_ERR_EOF != rv) {
+            skStreamPrintLastErr(rwios, rv, &skAppPrintErr);
+        }
+        return 0;
+    }
+    return 1;
+}
+
+
+/*
+ *  fillKeyBatch(buf, count);
+ *
+ *    Computes the key based on the global key_fields[] settings for
+ *    each of the 'count' nodes that begin at 'buf', where each node
+ *    was filled by fillRecord().  The plug-ins are given the records
+ *    as a batch.  'count' must not exceed SORT_KEY_BATCH_SIZE.
+ */
+static void
+fillKeyBatch(
+    uint8_t            *buf,
+    uint32_t            count)
+{
+    const rwRec *rec_list[SORT_KEY_BATCH_SIZE];
+    uint8_t *bin_list[SORT_KEY_BATCH_SIZE];
+    skplugin_err_t err;
+    const char **name;
+    uint32_t j;
+    size_t i;
+
+    assert(count <= SORT_KEY_BATCH_SIZE);
+
+    for (i = 0; i < key_num_fields; ++i) {
+        for (j = 0; j < count; ++j) {
+            rec_list[j] = (rwRec*)&buf[j * node_size];
+            bin_list[j] = &buf[j * node_size + key_fields[i].kf_offset];
+        }
+        err = skPluginFieldRunRecToBinBatchFn(key_fields[i].kf_field_handle,
+                                              bin_list, rec_list, count,
+                                              NULL);
+        if (err != SKPLUGIN_OK) {
+            skPluginFieldName(key_fields[i].kf_field_handle, &name);
+            skAppPrintErr(("Plugin-based field %s failed "
+                           "converting to binary "
+                           "with error code %d"), name[0], err);
+            appExit(EXIT_FAILURE);
+        }
+    }
+}
+
+
 /*
  *  status = fillRecordAndKey(rwios, buf);
  *
@@ -407,14 +474,8 @@ fillRecordAndKey(
     skplugin_err_t err;
     const char **name;
     size_t i;
-    int rv;
 
-    rv = skStreamReadRecord(rwios, rwrec);
-    if (rv) {
-        /* end of file or error getting record */
-        if (SKSTREAM_ERR_EOF != rv) {
-            skStreamPrintLastErr(rwios, rv, &skAppPrintErr);
-        }
+    if (!fillRecord(rwios, buf)) {
         return 0;
     }
 
@@ -1114,8 +1175,9 @@ sortRandom(
     record_count = 0;
     cur_node = record_buffer;
     while (input_rwios != NULL) {
-        /* read record */
-        rv = fillRecordAndKey(input_rwios, cur_node);
+        /* read record; its key is computed once a batch of records
+         * has been read */
+        rv = fillRecord(input_rwios, cur_node);
         if (rv == 0) {
             /* close current and open next */
             skStreamDestroy(&input_rwios);
@@ -1132,6 +1194,12 @@ sortRandom(
         ++record_count;
         cur_node += node_size;
 
+        if (0 == record_count % SORT_KEY_BATCH_SIZE) {
+            fillKeyBatch((record_buffer + ((record_count - SORT_KEY_BATCH_SIZE)
+                                           * node_size)),
+                         SORT_KEY_BATCH_SIZE);
+        }
+
         if (record_count == buffer_recs) {
             /* Filled the current buffer */
 
@@ -1167,6 +1235,13 @@ sortRandom(
             /* Either buffer at maximum size or attempt to grow it
              * failed. */
             if (record_count == buffer_max_recs) {
+                /* Compute keys for the final partial batch */
+                fillKeyBatch((record_buffer
+                              + ((record_count
+                                  - record_count % SORT_KEY_BATCH_SIZE)
+                                 * node_size)),
+                             record_count % SORT_KEY_BATCH_SIZE);
+
                 /* Sort */
                 TRACEMSG(("Sorting %" PRIu32 " records...", record_count));
                 skQSort(record_buffer, record_count, node_size, &rwrecCompare);
@@ -1185,6 +1260,11 @@ sortRandom(
 
     /* Sort (and maybe store) last batch of records */
     if (record_count > 0) {
+        fillKeyBatch((record_buffer
+                      + ((record_count - record_count % SORT_KEY_BATCH_SIZE)
+                         * node_size)),
+                     record_count % SORT_KEY_BATCH_SIZE);
+
         TRACEMSG(("Sorting %" PRIu32 " records...", record_count));
         skQSort(record_buffer, record_count, node_size, &rwrecCompare);
         TRACEMSG(("Sorting %" PRIu32 " records...done", record_count));
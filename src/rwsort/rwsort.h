@@ -119,6 +119,12 @@ RCSIDENTVAR(rcsID_RWSORT_H, "$SiLK: rwsort.h b7b8edebba12 2015-01-05 18:05:21Z m
  */
 #define MAX_PLUGIN_KEY_FIELDS  32
 
+/*
+ *    Number of records whose plug-in key fields are computed at once
+ *    when reading unsorted input.
+ */
+#define SORT_KEY_BATCH_SIZE  256
+
 /*
  *    Maximum bytes allotted to a "node", which is the complete rwRec
  *    and the bytes required by all keys that can come from plug-ins.
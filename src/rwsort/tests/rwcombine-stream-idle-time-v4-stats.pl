@@ -0,0 +1,15 @@
+#! /usr/bin/perl -w
+# MD5: ad9127ec885000dced914c50f82c24f0
+# TEST: ./rwcombine --stream ../../tests/data.rwf ../../tests/empty.rwf --max-idle-time=0.002 --output-path=/dev/null --print-statistics=stdout
+
+use strict;
+use SiLKTests;
+
+my $rwcombine = check_silk_app('rwcombine');
+my %file;
+$file{data} = get_data_or_exit77('data');
+$file{empty} = get_data_or_exit77('empty');
+my $cmd = "$rwcombine --stream $file{data} $file{empty} --max-idle-time=0.002 --output-path=/dev/null --print-statistics=stdout";
+my $md5 = "ad9127ec885000dced914c50f82c24f0";
+
+check_md5_output($md5, $cmd);
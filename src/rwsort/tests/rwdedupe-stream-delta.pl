@@ -0,0 +1,16 @@
+#! /usr/bin/perl -w
+# MD5: c56770f1296fab5a31b393f5128dce3d
+# TEST: ./rwsort --fields=stime ../../tests/data.rwf ../../tests/data.rwf | ./rwdedupe --ignore-fields=sip,sport --stime-delta=2000 --duration-delta=1000 --stream-window=60000 | ../rwuniq/rwuniq --fields=1-5 --ipv6-policy=ignore --timestamp-format=epoch --values=bytes,packets,records,stime,etime --sort-output --delimited --no-title
+
+use strict;
+use SiLKTests;
+
+my $rwdedupe = check_silk_app('rwdedupe');
+my $rwuniq = check_silk_app('rwuniq');
+my $rwsort = check_silk_app('rwsort');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwsort --fields=stime $file{data} $file{data} | $rwdedupe --ignore-fields=sip,sport --stime-delta=2000 --duration-delta=1000 --stream-window=60000 | $rwuniq --fields=1-5 --ipv6-policy=ignore --timestamp-format=epoch --values=bytes,packets,records,stime,etime --sort-output --delimited --no-title";
+my $md5 = "c56770f1296fab5a31b393f5128dce3d";
+
+check_md5_output($md5, $cmd);
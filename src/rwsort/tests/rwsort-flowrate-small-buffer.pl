@@ -0,0 +1,19 @@
+#! /usr/bin/perl -w
+# MD5: b60f015350588b947a26a629a94931b2
+# TEST: ./rwsort --plugin=flowrate.so --fields=pckts/sec,sip --sort-buffer-size=2m ../../tests/data.rwf | ../rwuniq/rwuniq --plugin=flowrate.so --fields=pckts/sec,sip --values=packets --presorted-input
+
+use strict;
+use SiLKTests;
+
+my $rwsort = check_silk_app('rwsort');
+my $rwuniq = check_silk_app('rwuniq');
+my %file;
+$file{data} = get_data_or_exit77('data');
+add_plugin_dirs('/src/plugins');
+
+skip_test('Cannot load flowrate plugin')
+    unless check_app_switch($rwsort.' --plugin=flowrate.so', 'fields', qr/payload-rate/);
+my $cmd = "$rwsort --plugin=flowrate.so --fields=pckts/sec,sip --sort-buffer-size=2m $file{data} | $rwuniq --plugin=flowrate.so --fields=pckts/sec,sip --values=packets --presorted-input";
+my $md5 = "b60f015350588b947a26a629a94931b2";
+
+check_md5_output($md5, $cmd);
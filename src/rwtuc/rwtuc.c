@@ -1061,6 +1061,212 @@ convertOldTime(
 }
 
 
+/*
+ *    The functions fastParse*() handle the common, well-formed input
+ *    produced by rwcut and similar tools without the overhead of the
+ *    general-purpose skStringParse*() functions.  Each returns 0 and
+ *    sets its first argument when the string is in the expected
+ *    form, and returns -1 otherwise.  A return value of -1 does not
+ *    mean the string is invalid: the caller must fall back to the
+ *    skStringParse*() function, which either parses the value or
+ *    reports the error.  Leading whitespace must have been removed;
+ *    trailing whitespace is allowed.
+ */
+
+/*
+ *  ok = fastParseEnd(cp);
+ *
+ *    Return 1 if 'cp' contains only whitespace; 0 otherwise.
+ */
+static int
+fastParseEnd(
+    const char         *cp)
+{
+    while (isspace((int)*cp)) {
+        ++cp;
+    }
+    return ('\0' == *cp);
+}
+
+
+/*
+ *  ok = fastParseUint32(&value, string, min_val, max_val);
+ *
+ *    Parse 'string' as an unsigned decimal integer between 'min_val'
+ *    and 'max_val' inclusive.  A 'max_val' of 0 is treated as
+ *    UINT32_MAX, as in skStringParseUint32().
+ */
+static int
+fastParseUint32(
+    uint32_t           *value,
+    const char         *string,
+    uint32_t            min_val,
+    uint32_t            max_val)
+{
+    const char *cp = string;
+    uint64_t val = 0;
+
+    if (!isdigit((int)*cp)) {
+        return -1;
+    }
+    do {
+        val = val * 10 + (*cp - '0');
+        ++cp;
+    } while (isdigit((int)*cp) && (cp - string) < 10);
+
+    if (val < min_val || val > (max_val ? max_val : UINT32_MAX)) {
+        return -1;
+    }
+    if (!fastParseEnd(cp)) {
+        return -1;
+    }
+    *value = (uint32_t)val;
+    return 0;
+}
+
+
+/*
+ *  ok = fastParseIPv4(&ipaddr, string);
+ *
+ *    Parse 'string' as an IPv4 address in dotted-quad notation.
+ */
+static int
+fastParseIPv4(
+    skipaddr_t         *ipaddr,
+    const char         *string)
+{
+    const char *cp = string;
+    uint32_t ipv4 = 0;
+    uint32_t octet;
+    int i;
+
+    for (i = 0; i < 4; ++i) {
+        if (!isdigit((int)*cp)) {
+            return -1;
+        }
+        octet = *cp++ - '0';
+        if (isdigit((int)*cp)) {
+            if (0 == octet) {
+                /* leading zero; let the general parser decide */
+                return -1;
+            }
+            octet = octet * 10 + (*cp++ - '0');
+            if (isdigit((int)*cp)) {
+                octet = octet * 10 + (*cp++ - '0');
+                if (octet > 255) {
+                    return -1;
+                }
+            }
+        }
+        ipv4 = (ipv4 << 8) | octet;
+        if (i < 3) {
+            if (*cp != '.') {
+                return -1;
+            }
+            ++cp;
+        }
+    }
+    if (!fastParseEnd(cp)) {
+        return -1;
+    }
+    skipaddrSetV4(ipaddr, &ipv4);
+    return 0;
+}
+
+
+/*
+ *  ok = fastParseDatetime(&t, string);
+ *
+ *    Parse 'string' as a time in the form produced by rwcut:
+ *    "YYYY/MM/DD[T:]hh:mm:ss" with an optional ".sss".  Times are
+ *    always treated as UTC, so this function always fails when SiLK
+ *    is configured to use local time.
+ */
+static int
+fastParseDatetime(
+    sktime_t           *t,
+    const char         *string)
+{
+#if  SK_ENABLE_LOCALTIME
+    (void)t;
+    (void)string;
+    return -1;
+#else
+    /* position of each digit in the string; 0 marks a delimiter */
+    static const char pattern[] = "dddd/dd/dd?dd:dd:dd";
+    const char *cp;
+    int64_t days;
+    int64_t msec = 0;
+    int year, month, day, hour, minute, second;
+    int i;
+
+    for (i = 0, cp = string; pattern[i]; ++i, ++cp) {
+        switch (pattern[i]) {
+          case 'd':
+            if (!isdigit((int)*cp)) {
+                return -1;
+            }
+            break;
+          case '?':
+            if (*cp != 'T' && *cp != ':') {
+                return -1;
+            }
+            break;
+          default:
+            if (*cp != pattern[i]) {
+                return -1;
+            }
+            break;
+        }
+    }
+    if ('.' == *cp) {
+        if (!isdigit((int)cp[1]) || !isdigit((int)cp[2])
+            || !isdigit((int)cp[3]) || isdigit((int)cp[4]))
+        {
+            return -1;
+        }
+        msec = (100 * (cp[1] - '0') + 10 * (cp[2] - '0') + (cp[3] - '0'));
+        cp += 4;
+    }
+    if (!fastParseEnd(cp)) {
+        return -1;
+    }
+
+#define FAST_DIGITS2(fd_pos)                                    \
+    (10 * (string[fd_pos] - '0') + (string[(fd_pos)+1] - '0'))
+
+    year = 100 * FAST_DIGITS2(0) + FAST_DIGITS2(2);
+    month = FAST_DIGITS2(5);
+    day = FAST_DIGITS2(8);
+    hour = FAST_DIGITS2(11);
+    minute = FAST_DIGITS2(14);
+    second = FAST_DIGITS2(17);
+
+#undef FAST_DIGITS2
+
+    if (year < 1970 || year > 2039 || month < 1 || month > 12 || day < 1
+        || day > skGetMaxDayInMonth(year, month)
+        || hour > 23 || minute > 59 || second > 59)
+    {
+        return -1;
+    }
+
+    /* number of days since the epoch; the year starts in March to
+     * put the leap day at the end */
+    if (month <= 2) {
+        --year;
+        month += 12;
+    }
+    days = (365 * (int64_t)year + year / 4 - year / 100 + year / 400
+            + (153 * (month - 3) + 2) / 5 + day - 1 - 719468);
+
+    *t = sktimeCreate((days * 86400 + hour * 3600 + minute * 60 + second),
+                      msec);
+    return 0;
+#endif  /* SK_ENABLE_LOCALTIME */
+}
+
+
 /*
  *  ok = processFields(val, field_count, field_types, field_values, curline);
  *
@@ -1106,75 +1312,93 @@ processFields(
             break;
 
           case RWREC_FIELD_ICMP_TYPE:
-            rv = skStringParseUint32(&tmp32, cp, 0, UINT8_MAX);
-            if (rv) {
-                goto PARSE_ERROR;
+            if (fastParseUint32(&tmp32, cp, 0, UINT8_MAX)) {
+                rv = skStringParseUint32(&tmp32, cp, 0, UINT8_MAX);
+                if (rv) {
+                    goto PARSE_ERROR;
+                }
             }
             val->itype = (uint8_t)tmp32;
             break;
 
           case RWREC_FIELD_ICMP_CODE:
-            rv = skStringParseUint32(&tmp32, cp, 0, UINT8_MAX);
-            if (rv) {
-                goto PARSE_ERROR;
+            if (fastParseUint32(&tmp32, cp, 0, UINT8_MAX)) {
+                rv = skStringParseUint32(&tmp32, cp, 0, UINT8_MAX);
+                if (rv) {
+                    goto PARSE_ERROR;
+                }
             }
             val->icode = (uint8_t)tmp32;
             break;
 
           case RWREC_FIELD_SIP:
-            rv = skStringParseIP(&ipaddr, cp);
-            if (rv) {
-                goto PARSE_ERROR;
+            if (fastParseIPv4(&ipaddr, cp)) {
+                rv = skStringParseIP(&ipaddr, cp);
+                if (rv) {
+                    goto PARSE_ERROR;
+                }
             }
             rwRecMemSetSIP(&val->rec, &ipaddr);
             break;
 
           case RWREC_FIELD_DIP:
-            rv = skStringParseIP(&ipaddr, cp);
-            if (rv) {
-                goto PARSE_ERROR;
+            if (fastParseIPv4(&ipaddr, cp)) {
+                rv = skStringParseIP(&ipaddr, cp);
+                if (rv) {
+                    goto PARSE_ERROR;
+                }
             }
             rwRecMemSetDIP(&val->rec, &ipaddr);
             break;
 
           case RWREC_FIELD_SPORT:
-            rv = skStringParseUint32(&tmp32, cp, 0, UINT16_MAX);
-            if (rv) {
-                goto PARSE_ERROR;
+            if (fastParseUint32(&tmp32, cp, 0, UINT16_MAX)) {
+                rv = skStringParseUint32(&tmp32, cp, 0, UINT16_MAX);
+                if (rv) {
+                    goto PARSE_ERROR;
+                }
             }
             rwRecSetSPort(&val->rec, (uint16_t)tmp32);
             break;
 
           case RWREC_FIELD_DPORT:
-            rv = skStringParseUint32(&tmp32, cp, 0, UINT16_MAX);
-            if (rv) {
-                goto PARSE_ERROR;
+            if (fastParseUint32(&tmp32, cp, 0, UINT16_MAX)) {
+                rv = skStringParseUint32(&tmp32, cp, 0, UINT16_MAX);
+                if (rv) {
+                    goto PARSE_ERROR;
+                }
             }
             rwRecSetDPort(&val->rec, (uint16_t)tmp32);
             break;
 
           case RWREC_FIELD_PROTO:
-            rv = skStringParseUint32(&tmp32, cp, 0, UINT8_MAX);
-            if (rv) {
-                goto PARSE_ERROR;
+            if (fastParseUint32(&tmp32, cp, 0, UINT8_MAX)) {
+                rv = skStringParseUint32(&tmp32, cp, 0, UINT8_MAX);
+                if (rv) {
+                    goto PARSE_ERROR;
+                }
             }
             rwRecSetProto(&val->rec, (uint8_t)tmp32);
             break;
 
           case RWREC_FIELD_PKTS:
-            rv = skStringParseUint32(&tmp32, cp, 1, 0);
-            if (rv) {
-                /* FIXME: Clamp value to max instead of rejecting */
-                goto PARSE_ERROR;
+            if (fastParseUint32(&tmp32, cp, 1, 0)) {
+                rv = skStringParseUint32(&tmp32, cp, 1, 0);
+                if (rv) {
+                    /* FIXME: Clamp value to max instead of rejecting */
+                    goto PARSE_ERROR;
+                }
             }
             rwRecSetPkts(&val->rec, tmp32);
             break;
 
           case RWREC_FIELD_BYTES:
-            rv = skStringParseUint32(&tmp32, cp, 1, 0);
-            if (rv) {
-                /* FIXME: Clamp value to max instead of rejecting */
-                goto PARSE_ERROR;
+            if (fastParseUint32(&tmp32, cp, 1, 0)) {
+                rv = skStringParseUint32(&tmp32, cp, 1, 0);
+                if (rv) {
+                    /* FIXME: Clamp value to max instead of rejecting */
+                    goto PARSE_ERROR;
+                }
             }
             rwRecSetBytes(&val->rec, tmp32);
             break;
@@ -1189,13 +1413,17 @@ processFields(
 
           case RWREC_FIELD_STIME:
           case RWREC_FIELD_STIME_MSEC:
-            if (0 == regexec(&time_regex, cp, 0, NULL, 0)) {
+            if (isdigit((int)cp[0]) && isdigit((int)cp[1]) && '/' == cp[2]
+                && 0 == regexec(&time_regex, cp, 0, NULL, 0))
+            {
                 convertOldTime(cp);
             }
-            rv = skStringParseDatetime(&t, cp, NULL);
-            if (rv) {
-                /* FIXME: Allow small integers as epoch times? */
-                goto PARSE_ERROR;
+            if (fastParseDatetime(&t, cp)) {
+                rv = skStringParseDatetime(&t, cp, NULL);
+                if (rv) {
+                    /* FIXME: Allow small integers as epoch times? */
+                    goto PARSE_ERROR;
+                }
             }
             rwRecSetStartTime(&val->rec, t);
             break;
@@ -1217,21 +1445,28 @@ processFields(
 
           case RWREC_FIELD_ETIME:
           case RWREC_FIELD_ETIME_MSEC:
-            if (0 == regexec(&time_regex, cp, 0, NULL, 0)) {
+            if (isdigit((int)cp[0]) && isdigit((int)cp[1]) && '/' == cp[2]
+                && 0 == regexec(&time_regex, cp, 0, NULL, 0))
+            {
                 convertOldTime(cp);
             }
-            rv = skStringParseDatetime(&(val->eTime), cp, NULL);
-            if (rv) {
-                /* FIXME: Allow small integers as epoch times? */
-                goto PARSE_ERROR;
+            if (fastParseDatetime(&(val->eTime), cp)) {
+                rv = skStringParseDatetime(&(val->eTime), cp, NULL);
+                if (rv) {
+                    /* FIXME: Allow small integers as epoch times? */
+                    goto PARSE_ERROR;
+                }
             }
             break;
 
           case RWREC_FIELD_SID:
             if (isdigit((int)*cp)) {
-                rv = skStringParseUint32(&tmp32, cp, 0, SK_INVALID_SENSOR-1);
-                if (rv) {
-                    goto PARSE_ERROR;
+                if (fastParseUint32(&tmp32, cp, 0, SK_INVALID_SENSOR-1)) {
+                    rv = skStringParseUint32(&tmp32, cp, 0,
+                                             SK_INVALID_SENSOR-1);
+                    if (rv) {
+                        goto PARSE_ERROR;
+                    }
                 }
                 rwRecSetSensor(&val->rec, (sensorID_t)tmp32);
             } else {
@@ -1240,27 +1475,33 @@ processFields(
             break;
 
           case RWREC_FIELD_INPUT:
-            rv = skStringParseUint32(&tmp32, cp, 0, UINT16_MAX);
-            if (rv) {
-                /* FIXME: Clamp value to max instead of rejecting */
-                goto PARSE_ERROR;
+            if (fastParseUint32(&tmp32, cp, 0, UINT16_MAX)) {
+                rv = skStringParseUint32(&tmp32, cp, 0, UINT16_MAX);
+                if (rv) {
+                    /* FIXME: Clamp value to max instead of rejecting */
+                    goto PARSE_ERROR;
+                }
             }
             rwRecSetInput(&val->rec, (uint16_t)tmp32);
             break;
 
           case RWREC_FIELD_OUTPUT:
-            rv = skStringParseUint32(&tmp32, cp, 0, UINT16_MAX);
-            if (rv) {
-                /* FIXME: Clamp value to max instead of rejecting */
-                goto PARSE_ERROR;
+            if (fastParseUint32(&tmp32, cp, 0, UINT16_MAX)) {
+                rv = skStringParseUint32(&tmp32, cp, 0, UINT16_MAX);
+                if (rv) {
+                    /* FIXME: Clamp value to max instead of rejecting */
+                    goto PARSE_ERROR;
+                }
             }
             rwRecSetOutput(&val->rec, (uint16_t)tmp32);
             break;
 
           case RWREC_FIELD_NHIP:
-            rv = skStringParseIP(&ipaddr, cp);
-            if (rv) {
-                goto PARSE_ERROR;
+            if (fastParseIPv4(&ipaddr, cp)) {
+                rv = skStringParseIP(&ipaddr, cp);
+                if (rv) {
+                    goto PARSE_ERROR;
+                }
             }
             rwRecMemSetNhIP(&val->rec, &ipaddr);
             break;
@@ -1290,9 +1531,11 @@ processFields(
             break;
 
           case RWREC_FIELD_APPLICATION:
-            rv = skStringParseUint32(&tmp32, cp, 0, UINT16_MAX);
-            if (rv) {
-                goto PARSE_ERROR;
+            if (fastParseUint32(&tmp32, cp, 0, UINT16_MAX)) {
+                rv = skStringParseUint32(&tmp32, cp, 0, UINT16_MAX);
+                if (rv) {
+                    goto PARSE_ERROR;
+                }
             }
             rwRecSetApplication(&val->rec, (uint16_t)tmp32);
             break;
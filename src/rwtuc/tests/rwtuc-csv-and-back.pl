@@ -0,0 +1,16 @@
+#! /usr/bin/perl -w
+# MD5: 9a8b26a141b4907b2dcd8a68b9d2039c
+# TEST: ../rwcut/rwcut --fields=sip,dip,sport,dport,proto,packets,bytes,flags,stime,etime,sensor,nhip --delimited=, --ip-format=zero-padded ../../tests/data.rwf | ./rwtuc --column-sep=, | ../rwcat/rwcat --compression-method=none --byte-order=little --ipv4-output
+
+use strict;
+use SiLKTests;
+
+my $rwtuc = check_silk_app('rwtuc');
+my $rwcut = check_silk_app('rwcut');
+my $rwcat = check_silk_app('rwcat');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwcut --fields=sip,dip,sport,dport,proto,packets,bytes,flags,stime,etime,sensor,nhip --delimited=, --ip-format=zero-padded $file{data} | $rwtuc --column-sep=, | $rwcat --compression-method=none --byte-order=little --ipv4-output";
+my $md5 = "9a8b26a141b4907b2dcd8a68b9d2039c";
+
+check_md5_output($md5, $cmd);
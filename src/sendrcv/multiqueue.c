@@ -533,10 +533,15 @@ mqQueueGet(
 }
 
 
-mq_err_t
-mqGet(
+/*
+ *    Helper for mqGet() and mqGetNoWait().  When 'wait' is zero,
+ *    return MQ_EMPTY rather than blocking on an empty multiqueue.
+ */
+static mq_err_t
+mq_get(
     mq_multi_t         *q,
-    void              **data)
+    void              **data,
+    int                 wait)
 {
     mq_queue_t   *sq;
     sk_dll_iter_t iter;
@@ -546,7 +551,7 @@ mqGet(
 
     MUTEX_LOCK(&q->mutex);
 
-    while (!q->shutdown && !q->disable_remove && q->count == 0) {
+    while (wait && !q->shutdown && !q->disable_remove && q->count == 0) {
         MUTEX_WAIT(&q->cond, &q->mutex);
     }
 
@@ -560,6 +565,12 @@ mqGet(
         goto end;
     }
 
+    if (q->count == 0) {
+        assert(!wait);
+        retval = MQ_EMPTY;
+        goto end;
+    }
+
     skDLLAssignIter(&iter, q->queues);
     while (skDLLIterBackward(&iter, (void **)&sq) == 0) {
         assert(sq->multi == q);
@@ -584,6 +595,24 @@ mqGet(
 }
 
 
+mq_err_t
+mqGet(
+    mq_multi_t         *q,
+    void              **data)
+{
+    return mq_get(q, data, 1);
+}
+
+
+mq_err_t
+mqGetNoWait(
+    mq_multi_t         *q,
+    void              **data)
+{
+    return mq_get(q, data, 0);
+}
+
+
 mq_err_t
 mqPushBack(
     mq_multi_t         *q,
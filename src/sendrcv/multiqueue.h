@@ -84,7 +84,8 @@ typedef enum mq_err_en {
     MQ_DISABLED,
     MQ_SHUTDOWN,
     MQ_MEMERROR,
-    MQ_ILLEGAL
+    MQ_ILLEGAL,
+    MQ_EMPTY
 } mq_err_t;
 
 typedef enum mq_function_en {
@@ -182,6 +183,17 @@ mqGet(
  *    multiqueue was shutdown or disabled.
  */
 
+mq_err_t
+mqGetNoWait(
+    mq_multi_t         *q,
+    void              **data);
+/*
+ *    Get an element from a multiqueue without blocking.
+ *
+ *    As mqGet(), except returns MQ_EMPTY immediately when the
+ *    multiqueue is empty.
+ */
+
 mq_err_t
 mqPushBack(
     mq_multi_t         *q,
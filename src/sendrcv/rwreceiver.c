@@ -88,8 +88,10 @@ RCSIDENT("$SiLK: rwreceiver.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
     (((sndr)->remote_version > 1)               \
      ? CONN_DUPLICATE_FILE                      \
      : CONN_DISCONNECT)
-#define FILE_INFO_ERROR_STATE(sndr)                     \
-    (sndr->remote_version > 1 ? File_info : Error)
+#define FILE_INFO_ERROR_STATE(sndr)                             \
+    (((sndr)->remote_version >= PIPELINE_VERSION)               \
+     ? Skip_file                                                \
+     : (((sndr)->remote_version > 1) ? File_info : Error))
 #define FILESYSTEM_FULL_ERROR_STATE(sndr) Error
 
 
@@ -836,7 +838,6 @@ transferFiles(
     int fd = -1;
     uint64_t size = 0;
     uint64_t pa_size = 0;
-    uint8_t *map = NULL;
     char *name = NULL;
     char *dotname = NULL;
     char dotpath[PATH_MAX];
@@ -847,10 +848,13 @@ transferFiles(
     int rv;
     sk_dll_iter_t iter;
     const char *duplicate_dir;
-    enum transfer_state {File_info, File_info_ack,
-                         Send_file, Complete_ack, Error} state;
+    enum transfer_state {File_info, File_info_ack, Send_file,
+                         Complete_ack, Skip_file, Error} state;
     int thread_exit;
     int transferred_file = 0;
+    uint8_t *uncompr_buf = NULL;
+    size_t uncompr_buf_size = 0;
+    uint32_t methods;
 
     state = File_info;
     proto_err = 0;
@@ -859,6 +863,14 @@ transferFiles(
     dotpath[0] = '\0';
     memset(&st, 0, sizeof(st));
 
+    if (sndr->remote_version >= COMPRESSION_VERSION) {
+        /* Tell the sender which compression methods it may use */
+        methods = htonl(transferCompmethodsAvailable());
+        proto_err = skMsgQueueSendMessage(q, channel,
+                                          CONN_COMPRESSION_METHODS,
+                                          &methods, sizeof(methods));
+    }
+
     while (!shuttingdown && !proto_err && !thread_exit && !sndr->disconnect
            && (state != Error))
     {
@@ -868,6 +880,7 @@ transferFiles(
         switch (state) {
           case File_info:
           case Send_file:
+          case Skip_file:
             rv = skMsgQueueGetMessage(q, &msg);
             if (rv == -1) {
                 ASSERT_ABORT(shuttingdown);
@@ -887,7 +900,7 @@ transferFiles(
         /* Handle all states */
         switch (state) {
           case File_info:
-            /* Create the placeholder and dot files and mmap() the
+            /* Create the placeholder and dot files and allocate the
              * space. */
             {
                 file_info_t *finfo;
@@ -1057,38 +1070,23 @@ transferFiles(
                 }
                 DEBUGMSG("Created '%s'", dotpath);
 
-                /* Allocate space on disk */
-                offrv = lseek(fd, size - 1, SEEK_SET);
-                if (offrv == -1) {
-                    CRITMSG("Could not allocate disk space for '%s': %s",
-                            dotpath, strerror(errno));
-                    thread_exit = 1;
-                    break;
-                }
-                rv = write(fd, "", 1);
-                if (rv == -1) {
-                    CRITMSG("Could not allocate disk space for '%s': %s",
-                            dotpath, strerror(errno));
-                    thread_exit = 1;
-                    break;
-                }
-
-                /* Map space */
-                map = (uint8_t *)mmap(0, size, PROT_READ | PROT_WRITE,
-                                      MAP_SHARED, fd, 0);
-                if ((void *)map == MAP_FAILED) {
-                    CRITMSG("Could not map '%s': %s",
-                            dotpath, strerror(errno));
-                    thread_exit = 1;
-                    break;
-                }
-                rv = close(fd);
-                fd = -1;
-                if (rv == -1) {
-                    CRITMSG("Could not close file '%s': %s",
-                            dotpath, strerror(errno));
-                    thread_exit = 1;
-                    break;
+                /* Allocate space on disk.  The dot file remains open
+                 * while the blocks are written into it. */
+                if (size > 0) {
+                    offrv = lseek(fd, size - 1, SEEK_SET);
+                    if (offrv == -1) {
+                        CRITMSG("Could not allocate disk space for '%s': %s",
+                                dotpath, strerror(errno));
+                        thread_exit = 1;
+                        break;
+                    }
+                    rv = write(fd, "", 1);
+                    if (rv == -1) {
+                        CRITMSG("Could not allocate disk space for '%s': %s",
+                                dotpath, strerror(errno));
+                        thread_exit = 1;
+                        break;
+                    }
                 }
                 GOT_DISK_SPACE(pa_size);
                 pa_size = 0;
@@ -1107,43 +1105,136 @@ transferFiles(
             /* Get the content of the file and write into the dot file */
             {
                 block_info_t *block;
+                compressed_block_info_t *cblock;
+                const uint8_t *bp;
                 uint64_t offset;
                 uint32_t len;
-
-                if (skMsgType(msg) != CONN_FILE_BLOCK) {
+                uint32_t clen;
+                uint32_t compmethod;
+                ssize_t wrv;
+
+                if (skMsgType(msg) == CONN_COMPRESSED_BLOCK
+                    && sndr->remote_version >= COMPRESSION_VERSION)
+                {
+                    /* Uncompress the block; the file is written
+                     * exactly as it exists on the sender */
+                    cblock = (compressed_block_info_t *)skMsgMessage(msg);
+                    clen = (skMsgLength(msg)
+                            - offsetof(compressed_block_info_t, block));
+                    len = ntohl(cblock->uncompressed_size);
+                    compmethod = ntohl(cblock->compmethod);
+                    offset = ((uint64_t)ntohl(cblock->high_offset) << 32 |
+                              ntohl(cblock->low_offset));
+                    DEBUG_CONTENT_PRINT(("Receiving offset=%" PRIu64
+                                         " len=%" PRIu32 " compressed"),
+                                        offset, clen);
+                    if (skMsgLength(msg)
+                        < offsetof(compressed_block_info_t, block)
+                        || offset + len > size
+                        || len > MAXIMUM_FILE_BLOCK_SIZE
+                        || (compmethod == SK_COMPMETHOD_NONE && clen != len))
+                    {
+                        sendString(q, channel, EXTERNAL, CONN_DISCONNECT,
+                                   LOG_WARNING,
+                                   ("Illegal block (offset/size %" PRIu64
+                                    "/%" PRIu32 ")"), offset, len);
+                        state = Error;
+                        break;
+                    }
+                    if (compmethod == SK_COMPMETHOD_NONE) {
+                        bp = cblock->block;
+                    } else {
+                        if (uncompr_buf_size < len) {
+                            free(uncompr_buf);
+                            uncompr_buf = (uint8_t *)malloc(len);
+                            CHECK_ALLOC(uncompr_buf);
+                            uncompr_buf_size = len;
+                        }
+                        if (compmethod >= 32
+                            || !(transferCompmethodsAvailable()
+                                 & (1u << compmethod))
+                            || transferUncompress(
+                                (sk_compmethod_t)compmethod, uncompr_buf,
+                                &len, cblock->block, clen)
+                            || len != ntohl(cblock->uncompressed_size))
+                        {
+                            sendString(q, channel, EXTERNAL, CONN_DISCONNECT,
+                                       LOG_WARNING,
+                                       ("Cannot uncompress block (offset %"
+                                        PRIu64 ", method %" PRIu32 ")"),
+                                       offset, compmethod);
+                            state = Error;
+                            break;
+                        }
+                        bp = uncompr_buf;
+                    }
+                } else if (skMsgType(msg) != CONN_FILE_BLOCK) {
                     if ((proto_err = checkMsg(msg, q, CONN_FILE_COMPLETE))) {
                         break;
                     }
                     DEBUG_PRINT1("Received CONN_FILE_COMPLETE");
                     state = Complete_ack;
                     break;
+                } else {
+                    block = (block_info_t *)skMsgMessage(msg);
+                    len = skMsgLength(msg) - offsetof(block_info_t, block);
+                    offset = (uint64_t)ntohl(block->high_offset) << 32 |
+                             ntohl(block->low_offset);
+                    DEBUG_CONTENT_PRINT(("Receiving offset=%" PRIu64
+                                         " len=%" PRIu32),
+                                        offset, len);
+                    if (offset + len > size) {
+                        sendString(q, channel, EXTERNAL, CONN_DISCONNECT,
+                                   LOG_WARNING,
+                                   ("Illegal block (offset/size %" PRIu64
+                                    "/%" PRIu32 ")"), offset, len);
+                        state = Error;
+                        break;
+                    }
+                    bp = block->block;
                 }
-
-                block = (block_info_t *)skMsgMessage(msg);
-                len = skMsgLength(msg) - offsetof(block_info_t, block);
-                offset = (uint64_t)ntohl(block->high_offset) << 32 |
-                         ntohl(block->low_offset);
-                DEBUG_CONTENT_PRINT("Receiving offset=%" PRIu64 " len=%" PRIu32,
-                                    offset, len);
-                if (offset + len > size) {
-                    sendString(q, channel, EXTERNAL, CONN_DISCONNECT,
-                               LOG_WARNING,
-                               ("Illegal block (offset/size %" PRIu64
-                                "/%" PRIu32 ")"), offset, len);
-                    state = Error;
-                    break;
+                /* Write the block with as few system calls as
+                 * possible; with large blocks, this is usually one */
+                while (len > 0) {
+                    wrv = pwrite(fd, bp, len, (off_t)offset);
+                    if (wrv == -1) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        CRITMSG("Could not write to '%s': %s",
+                                dotpath, strerror(errno));
+                        thread_exit = 1;
+                        break;
+                    }
+                    bp     += wrv;
+                    offset += wrv;
+                    len    -= wrv;
                 }
-                memcpy(map + offset, block->block, len);
             }
             break;
 
+          case Skip_file:
+            /* The file was rejected; the sender sent its blocks
+             * without waiting for a reply.  Discard them. */
+            if (skMsgType(msg) == CONN_FILE_BLOCK
+                || skMsgType(msg) == CONN_COMPRESSED_BLOCK)
+            {
+                break;
+            }
+            if ((proto_err = checkMsg(msg, q, CONN_FILE_COMPLETE))) {
+                break;
+            }
+            DEBUG_PRINT1("Received CONN_FILE_COMPLETE for skipped file");
+            state = File_info;
+            break;
+
           case Complete_ack:
-            /* Un-mmap() the file, create any duplicate files, and
-             * move the dotfile over the placeholder file */
-            rv = munmap(map, size);
-            map = NULL;
+            /* Close the file, create any duplicate files, and move
+             * the dotfile over the placeholder file */
+            rv = close(fd);
+            fd = -1;
             if (rv == -1) {
-                CRITMSG("Could not unmap file '%s': %s",
+                CRITMSG("Could not close file '%s': %s",
                         dotpath, strerror(errno));
                 thread_exit = 1;
                 break;
@@ -1233,9 +1324,7 @@ transferFiles(
     if (fd != -1) {
         close(fd);
     }
-    if (map != NULL) {
-        munmap(map, size);
-    }
+    free(uncompr_buf);
     if (dotname != NULL) {
         free(dotname);
     }
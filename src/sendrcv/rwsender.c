@@ -67,6 +67,7 @@ RCSIDENT("$SiLK: rwsender.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 #include <silk/sklog.h>
 #include <silk/skpolldir.h>
 #include <silk/skdllist.h>
+#include <silk/sksite.h>
 #include "rwtransfer.h"
 
 /* LOCAL DEFINES AND TYPEDEFS */
@@ -100,6 +101,31 @@ typedef enum transfer_rv {
     TR_SUCCEEEDED, TR_FAILED, TR_IMPOSSIBLE, TR_FATAL
 } transfer_rv_t;
 
+/* Maximum number of files that may be in flight to a receiver that
+ * supports pipelined transfers */
+#define FILE_PIPELINE_DEPTH  8
+
+/* A file that has been sent to a receiver as part of a pipelined
+ * transfer but that the receiver has not yet acknowledged */
+typedef struct pipeline_file_st {
+    char       *path;
+    const char *name;
+    uint64_t    size;
+    time_t      dropoff_time;
+    time_t      send_time;
+    /* whether the receiver has accepted the file's CONN_NEW_FILE */
+    unsigned    ready : 1;
+} pipeline_file_t;
+
+/* Maximum number of bytes of compressed file content to keep in the
+ * compressed-file cache once no receiver is using it */
+#define COMPRESSED_CACHE_MAX  (64 * 1024 * 1024)
+
+/* Largest file whose content is compressed for transfer.  The whole
+ * compressed file is held in memory while it is sent, so larger
+ * files are sent uncompressed. */
+#define COMPRESSED_FILE_MAX  (16 * 1024 * 1024)
+
 
 /* EXPORTED VARIABLE DEFINITIONS */
 
@@ -146,9 +172,24 @@ static char *processing_dir;
 /* Error directory (--error-directory) */
 static char *error_dir;
 
-/* Block size to use when transferring file content (--block-size) */
+/* Block size to use when transferring file content (--block-size).
+ * When 0, the size depends on the receiver's protocol version. */
 static uint32_t file_block_size;
 
+/* Compression method to use for file content sent to receivers that
+ * support it (--transfer-compression) */
+static sk_compmethod_t transfer_compmethod;
+
+/* Cache of compressed file content, most recently used first, so a
+ * file sent to several receivers is compressed only once.  The cache
+ * holds one reference to each compressed_file_t in it, and the cache
+ * and the reference counts are protected by the mutex.  The
+ * condition variable is signaled when an entry becomes ready. */
+static sk_dllist_t *compressed_cache;
+static size_t compressed_cache_size;
+static pthread_mutex_t compressed_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t compressed_cache_cond = PTHREAD_COND_INITIALIZER;
+
 /* Directory poller for incoming-directory */
 static skPollDir_t *polldir;
 
@@ -174,7 +215,8 @@ typedef enum {
     OPT_FILTER,
     OPT_PRIORITY,
     OPT_POLLING_INTERVAL,
-    OPT_FILE_BLOCK_SIZE
+    OPT_FILE_BLOCK_SIZE,
+    OPT_TRANSFER_COMPRESSION
 } appOptionsEnum;
 
 static struct option appOptions[] = {
@@ -187,6 +229,7 @@ static struct option appOptions[] = {
     {"priority",             REQUIRED_ARG, 0, OPT_PRIORITY},
     {"polling-interval",     REQUIRED_ARG, 0, OPT_POLLING_INTERVAL},
     {"block-size",           REQUIRED_ARG, 0, OPT_FILE_BLOCK_SIZE},
+    {"transfer-compression", REQUIRED_ARG, 0, OPT_TRANSFER_COMPRESSION},
     {0,0,0,0}           /* sentinel entry */
 };
 
@@ -214,8 +257,15 @@ static const char *appHelp[] = {
     ("Check the incoming-directory for new files this\n"
      "\toften (in seconds). Def. " DEFAULT_POLL_INTERVAL_STRING),
     ("Specify the chunk size to use to use when transferring a\n"
-     "\tfile to an rwreceiver (in bytes)."
-     " Def. " FILE_BLOCK_SIZE_STRING ". Range 256-65535"),
+     "\tfile to an rwreceiver (in bytes). Def. " FILE_BLOCK_SIZE_STRING
+     ", or " LARGE_FILE_BLOCK_SIZE_STRING " for an\n"
+     "\trwreceiver that supports pipelined transfers. Range 256-"
+     MAXIMUM_FILE_BLOCK_SIZE_STRING ".\n"
+     "\tOlder rwreceivers get chunks of at most 65535 bytes"),
+    ("Compress file content with this method while it is\n"
+     "\tin transit to each rwreceiver that supports the method; the\n"
+     "\trwreceiver writes the original content.  Choices: none, best, or\n"
+     "\tan available compression method. Def. none"),
     (char *)NULL
 };
 
@@ -229,7 +279,9 @@ static void freePriority(void *p);
 static void addLocalDest(const char *arg);
 static void addPriority(const char *arg);
 static void parseFilterData(void);
+static int  parseTransferCompression(const char *arg);
 static int  rwsenderVerifyOptions(void);
+static void compressedFileRelease(void *cf);
 
 
 /* FUNCTION DEFINITIONS */
@@ -283,6 +335,7 @@ appTeardown(
         rbdestroy(transfers);
         skDLListDestroy(priority_regexps);
         skDLListDestroy(local_dests);
+        skDLListDestroy(compressed_cache);
         skdaemonTeardown();
         skAppUnregister();
         return;
@@ -341,6 +394,7 @@ appTeardown(
     rbdestroy(transfers);
     skDLListDestroy(priority_regexps);
     skDLListDestroy(local_dests);
+    skDLListDestroy(compressed_cache);
 
     NOTICEMSG("Finished shutting down.");
 
@@ -388,8 +442,10 @@ appSetup(
     incoming_thread_valid = 0;
     polldir               = NULL;
     polling_interval      = DEFAULT_POLL_INTERVAL;
-    file_block_size       = FILE_BLOCK_SIZE;
+    file_block_size       = 0;
     unique_local_copies   = 0;
+    transfer_compmethod   = SK_COMPMETHOD_NONE;
+    compressed_cache_size = 0;
 
     transfers = transferIdentTreeCreate();
     if (transfers == NULL) {
@@ -415,6 +471,12 @@ appSetup(
         exit(EXIT_FAILURE);
     }
 
+    compressed_cache = skDLListCreate(compressedFileRelease);
+    if (compressed_cache == NULL) {
+        skAppPrintErr("Unable to allocate compressed file cache");
+        exit(EXIT_FAILURE);
+    }
+
     /* register the options and handler */
     if (skOptionsRegister(appOptions, &appOptionsHandler, NULL))
     {
@@ -555,7 +617,8 @@ appOptionsHandler(
 
       case OPT_FILE_BLOCK_SIZE:
         rv = skStringParseUint32(&file_block_size, opt_arg,
-                                 MINIMUM_FILE_BLOCK_SIZE, UINT16_MAX);
+                                 MINIMUM_FILE_BLOCK_SIZE,
+                                 MAXIMUM_FILE_BLOCK_SIZE);
         if (rv) {
             goto PARSE_ERROR;
         }
@@ -564,6 +627,12 @@ appOptionsHandler(
                            + SKMSG_MESSAGE_OVERHEAD;
         break;
 
+      case OPT_TRANSFER_COMPRESSION:
+        if (parseTransferCompression(opt_arg)) {
+            return 1;
+        }
+        break;
+
     }
 
     return 0;  /* OK */
@@ -576,6 +645,40 @@ appOptionsHandler(
 }
 
 
+/*
+ *    status = parseTransferCompression(arg);
+ *
+ *    Set the compression method to use when sending file content
+ *    from the name of the method in 'arg': "none", "best", or the
+ *    name of a compression method that is available in this build.
+ *    Return 0 on success, or print an error and return -1.
+ */
+static int
+parseTransferCompression(
+    const char         *arg)
+{
+    char name[64];
+    sk_compmethod_t cm;
+
+    if (0 == strcmp(arg, "best")) {
+        transfer_compmethod = sksiteCompmethodGetBest();
+        return 0;
+    }
+    for (cm = 0; sksiteCompmethodCheck(cm) != 0; ++cm) {
+        if (SK_COMPMETHOD_IS_AVAIL == sksiteCompmethodCheck(cm)
+            && sksiteCompmethodGetName(name, sizeof(name), cm) >= 0
+            && 0 == strcmp(arg, name))
+        {
+            transfer_compmethod = cm;
+            return 0;
+        }
+    }
+    skAppPrintErr("Invalid %s '%s': Not an available compression method",
+                  appOptions[OPT_TRANSFER_COMPRESSION].name, arg);
+    return -1;
+}
+
+
 /* Free a local destination */
 static void
 freeLocalDest(
@@ -1324,6 +1427,268 @@ free_block(
     }
 }
 
+static void
+free_compressed_file(
+    compressed_file_t  *cf)
+{
+    free(cf->data);
+    free(cf->block_len);
+    free(cf->block_method);
+    free(cf);
+}
+
+static void
+decref_compressed_file(
+    compressed_file_t  *cf)
+{
+    uint64_t nonzero;
+
+    pthread_mutex_lock(&compressed_cache_mutex);
+    nonzero = --cf->count;
+    pthread_mutex_unlock(&compressed_cache_mutex);
+    if (!nonzero) {
+        free_compressed_file(cf);
+    }
+}
+
+/* Release the cache's reference to a compressed file; the data free
+ * function of the compressed_cache list */
+static void
+compressedFileRelease(
+    void               *cf)
+{
+    decref_compressed_file((compressed_file_t *)cf);
+}
+
+static void
+free_compressed_block(
+    uint16_t            count,
+    struct iovec       *iov)
+{
+    if (count != 0) {
+        sender_compressed_block_t *block
+            = (sender_compressed_block_t *)iov->iov_base;
+        decref_compressed_file(block->ref);
+        free(block);
+    }
+}
+
+
+/*
+ *    status = compressedFileFill(cf, content);
+ *
+ *    Compress the 'cf->size' bytes of file content in 'content' one
+ *    block at a time, using the method and block size in 'cf', and
+ *    store the result in 'cf'.  A block that does not get smaller is
+ *    stored uncompressed.  Return 0 on success, or -1 if memory
+ *    cannot be allocated.
+ */
+static int
+compressedFileFill(
+    compressed_file_t  *cf,
+    const uint8_t      *content)
+{
+    uint8_t *data;
+    size_t alloc = 0;
+    uint64_t offset;
+    uint32_t bound;
+    uint32_t clen;
+    uint32_t len;
+    uint32_t i;
+
+    cf->block_count = (uint32_t)((cf->size + cf->block_size - 1)
+                                 / cf->block_size);
+    cf->block_len = (uint32_t *)malloc(cf->block_count * sizeof(uint32_t));
+    cf->block_method = (uint8_t *)malloc(cf->block_count);
+    if (NULL == cf->block_len || NULL == cf->block_method) {
+        return -1;
+    }
+
+    for (i = 0, offset = 0; i < cf->block_count; ++i) {
+        len = ((cf->size - offset < cf->block_size)
+               ? (uint32_t)(cf->size - offset) : cf->block_size);
+        bound = transferCompressBound(cf->compmethod, len);
+        if (cf->data_size + bound > alloc) {
+            alloc = ((alloc > bound) ? alloc : bound) * 2;
+            data = (uint8_t *)realloc(cf->data, alloc);
+            if (NULL == data) {
+                return -1;
+            }
+            cf->data = data;
+        }
+        clen = bound;
+        if (transferCompress(cf->compmethod, cf->data + cf->data_size,
+                             &clen, content + offset, len)
+            || clen >= len)
+        {
+            memcpy(cf->data + cf->data_size, content + offset, len);
+            clen = len;
+            cf->block_method[i] = SK_COMPMETHOD_NONE;
+        } else {
+            cf->block_method[i] = cf->compmethod;
+        }
+        cf->block_len[i] = clen;
+        cf->data_size += clen;
+        offset += len;
+    }
+
+    /* return the unused space */
+    if (cf->data_size && cf->data_size < alloc) {
+        data = (uint8_t *)realloc(cf->data, cf->data_size);
+        if (data) {
+            cf->data = data;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ *    cf = compressedFileGet(st, content, compmethod, block_size);
+ *
+ *    Return the compressed content of the file whose status is 'st'
+ *    and whose content is 'content', compressed with 'compmethod' in
+ *    blocks of 'block_size' bytes.  The caller owns one reference to
+ *    the result and must call decref_compressed_file() when done.
+ *
+ *    The result comes from the cache when another receiver has been
+ *    sent the file (or is being sent it, in which case wait for the
+ *    other thread to finish compressing the file).  Otherwise,
+ *    compress the file and add it to the cache, removing the least
+ *    recently used entries when the cache is larger than
+ *    COMPRESSED_CACHE_MAX.  Return NULL if the file cannot be
+ *    compressed.  The caller should not pass a file larger than
+ *    COMPRESSED_FILE_MAX.
+ */
+static compressed_file_t *
+compressedFileGet(
+    const struct stat  *st,
+    const uint8_t      *content,
+    sk_compmethod_t     compmethod,
+    uint32_t            block_size)
+{
+    compressed_file_t *cf;
+    compressed_file_t *old;
+    sk_dll_iter_t iter;
+    int rv;
+
+    pthread_mutex_lock(&compressed_cache_mutex);
+    skDLLAssignIter(&iter, compressed_cache);
+    while (skDLLIterForward(&iter, (void **)&cf) == 0) {
+        if (cf->dev == st->st_dev && cf->ino == st->st_ino
+            && cf->size == (uint64_t)st->st_size
+            && cf->mtime == st->st_mtime
+            && cf->compmethod == compmethod
+            && cf->block_size == block_size)
+        {
+            /* move the entry to the front of the cache */
+            ++cf->count;
+            skDLLIterDel(&iter);
+            rv = skDLListPushHead(compressed_cache, cf);
+            CHECK_ALLOC(0 == rv);
+            while (!cf->ready) {
+                pthread_cond_wait(&compressed_cache_cond,
+                                  &compressed_cache_mutex);
+            }
+            pthread_mutex_unlock(&compressed_cache_mutex);
+            if (cf->failed) {
+                /* the thread that compressed the file has removed it
+                 * from the cache; drop this thread's reference */
+                decref_compressed_file(cf);
+                return NULL;
+            }
+            return cf;
+        }
+    }
+
+    /* Add an entry for the file, so that other threads wait for it
+     * rather than compress the file themselves */
+    cf = (compressed_file_t *)calloc(1, sizeof(compressed_file_t));
+    CHECK_ALLOC(cf);
+    cf->dev = st->st_dev;
+    cf->ino = st->st_ino;
+    cf->size = st->st_size;
+    cf->mtime = st->st_mtime;
+    cf->compmethod = compmethod;
+    cf->block_size = block_size;
+    cf->count = 2;
+    rv = skDLListPushHead(compressed_cache, cf);
+    CHECK_ALLOC(0 == rv);
+    pthread_mutex_unlock(&compressed_cache_mutex);
+
+    rv = compressedFileFill(cf, content);
+
+    pthread_mutex_lock(&compressed_cache_mutex);
+    cf->ready = 1;
+    if (rv != 0) {
+        ERRMSG("Failed to allocate memory for compressing file content");
+        cf->failed = 1;
+        /* remove the entry from the cache */
+        skDLLAssignIter(&iter, compressed_cache);
+        while (skDLLIterForward(&iter, (void **)&old) == 0) {
+            if (old == cf) {
+                skDLLIterDel(&iter);
+                --cf->count;
+                break;
+            }
+        }
+    } else {
+        compressed_cache_size += cf->data_size;
+        /* remove the least recently used entries; the memory is
+         * freed once the receivers using them no longer need it */
+        while (compressed_cache_size > COMPRESSED_CACHE_MAX
+               && skDLListPeekTail(compressed_cache, (void **)&old) == 0
+               && old->ready)
+        {
+            skDLListPopTail(compressed_cache, NULL);
+            compressed_cache_size -= old->data_size;
+            if (0 == --old->count) {
+                free_compressed_file(old);
+            }
+        }
+    }
+    pthread_cond_broadcast(&compressed_cache_cond);
+    pthread_mutex_unlock(&compressed_cache_mutex);
+
+    if (cf->failed) {
+        decref_compressed_file(cf);
+        return NULL;
+    }
+    return cf;
+}
+
+
+/*
+ *    size = transferBlockSize(rcvr);
+ *
+ *    Return the number of bytes of file content to put into each
+ *    CONN_FILE_BLOCK message sent to 'rcvr'.
+ */
+static uint32_t
+transferBlockSize(
+    const transfer_t   *rcvr)
+{
+    /* largest block an older rwreceiver can accept */
+    const uint32_t max_small = (UINT16_MAX - offsetof(block_info_t, block)
+                                - SKMSG_MESSAGE_OVERHEAD);
+
+    /* largest block that fits in a CONN_COMPRESSED_BLOCK message */
+    const uint32_t max_large = (MAXIMUM_FILE_BLOCK_SIZE
+                                - offsetof(compressed_block_info_t, block)
+                                - SKMSG_MESSAGE_OVERHEAD);
+
+    if (rcvr->remote_version >= PIPELINE_VERSION) {
+        if (0 == file_block_size) {
+            return LARGE_FILE_BLOCK_SIZE;
+        }
+        return (file_block_size > max_large) ? max_large : file_block_size;
+    }
+    if (0 == file_block_size) {
+        return FILE_BLOCK_SIZE;
+    }
+    return (file_block_size > max_small) ? max_small : file_block_size;
+}
+
 
 /* Move the file 'path' to the error directory associated with the
  * receiver 'ident'.  'name' is the filename of the file, and is used
@@ -1453,7 +1818,10 @@ transferFile(
                 break;
             }
             size = st.st_size;
-            block_size = (size > file_block_size) ? file_block_size : size;
+            block_size = transferBlockSize(rcvr);
+            if (block_size > size) {
+                block_size = size;
+            }
 
             name = strrchr(path, '/');
             if (name == NULL) {
@@ -1655,6 +2023,455 @@ transferFile(
 }
 
 
+/*
+ *    status = pipelineSendFile(q, channel, rcvr, pf, compmethod);
+ *
+ *    Queue the CONN_NEW_FILE message, all the CONN_FILE_BLOCK
+ *    messages, and the CONN_FILE_COMPLETE message for the file whose
+ *    path is in 'pf' for sending to 'rcvr', which must support
+ *    pipelined transfers.  Do not wait for any replies.  Fill in the
+ *    remaining members of 'pf'.
+ *
+ *    When 'compmethod' is not SK_COMPMETHOD_NONE, send the content
+ *    as CONN_COMPRESSED_BLOCK messages instead, using the compressed
+ *    content that is shared with the other receivers of the file.
+ *
+ *    Return TR_SUCCEEEDED if the file was queued, TR_IMPOSSIBLE if
+ *    the file cannot be read (nothing was sent), or TR_FAILED if
+ *    queueing a message failed.
+ */
+static transfer_rv_t
+pipelineSendFile(
+    sk_msg_queue_t     *q,
+    skm_channel_t       channel,
+    transfer_t         *rcvr,
+    pipeline_file_t    *pf,
+    sk_compmethod_t     compmethod)
+{
+    sender_block_info_t *block;
+    sender_compressed_block_t *cblock;
+    compressed_file_t *cf = NULL;
+    file_info_t *finfo;
+    file_map_t *map = NULL;
+    uint8_t *map_pointer = NULL;
+    uint32_t block_size;
+    uint32_t infolen;
+    uint64_t offset;
+    uint64_t size;
+    struct stat st;
+    int fd;
+    int rv;
+    transfer_rv_t retval = TR_IMPOSSIBLE;
+
+    assert(rcvr->remote_version >= PIPELINE_VERSION);
+
+    fd = open(pf->path, O_RDONLY);
+    if (fd == -1) {
+        ERRMSG("Could not open '%s' for reading: %s",
+               pf->path, strerror(errno));
+        return TR_IMPOSSIBLE;
+    }
+    rv = fstat(fd, &st);
+    if (rv != 0) {
+        ERRMSG("Could not stat '%s': %s", pf->path, strerror(errno));
+        goto END;
+    }
+    if ((size_t)st.st_size > SIZE_MAX) {
+        ERRMSG("The file '%s' was too large to be mapped", pf->path);
+        goto END;
+    }
+    size = st.st_size;
+
+    /* Map the file before announcing it, so that a failure to map the
+     * file does not leave the receiver waiting for its content */
+    if (size) {
+        map = (file_map_t*)malloc(sizeof(file_map_t));
+        CHECK_ALLOC(map);
+        rv = pthread_mutex_init(&map->mutex, NULL);
+        if (rv != 0) {
+            free(map);
+            map = NULL;
+            ERRMSG("Failed to create mutex");
+            retval = TR_FAILED;
+            goto END;
+        }
+        map->map = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map->map == MAP_FAILED) {
+            pthread_mutex_destroy(&map->mutex);
+            free(map);
+            map = NULL;
+            ERRMSG("Could not map '%s': %s", pf->path, strerror(errno));
+            goto END;
+        }
+        map->count = 1;
+        map->map_size = size;
+        map_pointer = (uint8_t*)map->map;
+    }
+    close(fd);
+    fd = -1;
+
+    pf->name = strrchr(pf->path, '/');
+    if (pf->name == NULL) {
+        pf->name = pf->path;
+    } else {
+        pf->name++;
+    }
+    pf->size = size;
+    pf->ready = 0;
+    /* see transferFile() for the meaning of these times */
+    pf->dropoff_time = st.st_ctime;
+    pf->send_time = time(NULL);
+
+    block_size = transferBlockSize(rcvr);
+    if (block_size > size) {
+        block_size = size;
+    }
+
+    if (compmethod != SK_COMPMETHOD_NONE && size
+        && size <= COMPRESSED_FILE_MAX)
+    {
+        /* on failure, fall back to sending the file as is */
+        cf = compressedFileGet(&st, map_pointer, compmethod, block_size);
+    }
+    if (cf) {
+        INFOMSG(("Transferring to %s: %s (%" PRIu64 " bytes, %" SK_PRIuZ
+                 " compressed)"),
+                rcvr->ident, pf->name, size, cf->data_size);
+    } else {
+        INFOMSG("Transferring to %s: %s (%" PRIu64 " bytes)",
+                rcvr->ident, pf->name, size);
+    }
+
+    infolen = offsetof(file_info_t, filename) + strlen(pf->name) + 1;
+    finfo = (file_info_t*)malloc(infolen);
+    CHECK_ALLOC(finfo);
+    strcpy(finfo->filename, pf->name); /* Should be safe due to
+                                          precalculated size */
+    finfo->high_filesize = htonl((uint32_t)(size >> 32));
+    finfo->low_filesize  = htonl((uint32_t)(size & UINT32_MAX));
+    finfo->block_size    = htonl(block_size);
+    finfo->mode          = htonl(st.st_mode & 0777);
+
+    retval = TR_FAILED;
+    if (skMsgQueueSendMessageNoCopy(q, channel, CONN_NEW_FILE,
+                                    finfo, infolen, free))
+    {
+        goto END;
+    }
+
+    if (cf) {
+        /* Queue every compressed block of the file.  Each message
+         * refers to the shared compressed content. */
+        uint8_t *data = cf->data;
+        uint32_t i;
+
+        for (i = 0, offset = 0; i < cf->block_count; ++i) {
+            uint32_t len = ((size - offset < block_size)
+                            ? (uint32_t)(size - offset) : block_size);
+            struct iovec iov[2];
+
+            cblock = ((sender_compressed_block_t *)
+                      malloc(sizeof(*cblock)));
+            CHECK_ALLOC(cblock);
+            cblock->high_offset = htonl((uint32_t)(offset >> 32));
+            cblock->low_offset  = htonl((uint32_t)(offset & UINT32_MAX));
+            cblock->uncompressed_size = htonl(len);
+            cblock->compmethod = htonl(cf->block_method[i]);
+
+            DEBUG_CONTENT_PRINT(("Sending offset=%" PRIu64 " compressed"
+                                 " len=%" PRIu32),
+                                offset, cf->block_len[i]);
+
+            iov[0].iov_base = cblock;
+            iov[0].iov_len = offsetof(sender_compressed_block_t, ref);
+            iov[1].iov_base = data;
+            iov[1].iov_len = cf->block_len[i];
+
+            pthread_mutex_lock(&compressed_cache_mutex);
+            cblock->ref = cf;
+            cf->count++;
+            pthread_mutex_unlock(&compressed_cache_mutex);
+
+            if (skMsgQueueScatterSendLargeMessageNoCopy(
+                    q, channel, CONN_COMPRESSED_BLOCK, 2, iov,
+                    free_compressed_block))
+            {
+                goto END;
+            }
+            data += cf->block_len[i];
+            offset += len;
+        }
+    }
+
+    /* Queue every block of the file.  Each message refers to the
+     * mmap()ed file, which is unmapped once the last block has been
+     * written to the socket. */
+    for (offset = (cf ? size : 0); offset < size; offset += block_size) {
+        uint32_t len = ((size - offset < block_size)
+                        ? (uint32_t)(size - offset) : block_size);
+        struct iovec iov[2];
+
+        block = (sender_block_info_t *)malloc(sizeof(*block));
+        CHECK_ALLOC(block);
+        block->high_offset = htonl((uint32_t)(offset >> 32));
+        block->low_offset  = htonl((uint32_t)(offset & UINT32_MAX));
+
+        DEBUG_CONTENT_PRINT("Sending offset=%" PRIu64 " len=%" PRIu32,
+                            offset, len);
+
+        iov[0].iov_base = block;
+        iov[0].iov_len = offsetof(sender_block_info_t, ref);
+        iov[1].iov_base = map_pointer + offset;
+        iov[1].iov_len = len;
+
+        pthread_mutex_lock(&map->mutex);
+        block->ref = map;
+        map->count++;
+        pthread_mutex_unlock(&map->mutex);
+
+        if (skMsgQueueScatterSendLargeMessageNoCopy(
+                q, channel, CONN_FILE_BLOCK, 2, iov, free_block))
+        {
+            goto END;
+        }
+    }
+
+    DEBUG_PRINT1("Sending CONN_FILE_COMPLETE");
+    if (skMsgQueueSendMessage(q, channel, CONN_FILE_COMPLETE, NULL, 0)) {
+        goto END;
+    }
+    retval = TR_SUCCEEEDED;
+
+  END:
+    if (fd != -1) {
+        close(fd);
+    }
+    if (map) {
+        decref_map(map);
+    }
+    if (cf) {
+        decref_compressed_file(cf);
+    }
+    return retval;
+}
+
+
+/*
+ *    Implementation of transferFiles() for a receiver that supports
+ *    pipelined transfers.
+ *
+ *    Rather than waiting for the receiver to reply to each message,
+ *    keep up to FILE_PIPELINE_DEPTH files in flight.  The receiver
+ *    replies to the files in the order they were sent: first with
+ *    CONN_NEW_FILE_READY (or CONN_DUPLICATE_FILE or CONN_REJECT_FILE,
+ *    after which it discards the file's blocks), then with
+ *    CONN_FILE_COMPLETE once the file has been written.  Files that
+ *    are in flight when the connection is lost are returned to the
+ *    queue.
+ */
+static int
+transferFilesPipelined(
+    sk_msg_queue_t     *q,
+    skm_channel_t       channel,
+    transfer_t         *rcvr)
+{
+    pipeline_file_t pipeline[FILE_PIPELINE_DEPTH];
+    pipeline_file_t *pf;
+    size_t head = 0;
+    size_t count = 0;
+    int transferred_file = 0;
+    int proto_err = 0;
+    int fatal_err = 0;
+    time_t finished_time;
+    skm_type_t t;
+    sk_msg_t *msg;
+    char *path;
+    mq_err_t err;
+    sk_compmethod_t compmethod = SK_COMPMETHOD_NONE;
+    char name[64];
+    int rv;
+
+    /* A receiver that supports compression begins by sending the
+     * bitmap of the compression methods it can uncompress */
+    if (rcvr->remote_version >= COMPRESSION_VERSION) {
+        rv = skMsgQueueGetMessage(q, &msg);
+        if (rv == -1) {
+            ASSERT_ABORT(shuttingdown);
+            return 0;
+        }
+        if (handleDisconnect(msg, rcvr->ident)) {
+            skMsgDestroy(msg);
+            return 0;
+        }
+        if (checkMsg(msg, q, CONN_COMPRESSION_METHODS)) {
+            skMsgDestroy(msg);
+            return 0;
+        }
+        if (transfer_compmethod != SK_COMPMETHOD_NONE) {
+            sksiteCompmethodGetName(name, sizeof(name), transfer_compmethod);
+            if (MSG_UINT32(msg) & (1u << transfer_compmethod)) {
+                compmethod = transfer_compmethod;
+                DEBUGMSG("Using %s compression for transfers to %s",
+                         name, rcvr->ident);
+            } else {
+                NOTICEMSG(("Receiver %s does not support %s compression;"
+                           " sending uncompressed content"),
+                          rcvr->ident, name);
+            }
+        }
+        skMsgDestroy(msg);
+    }
+
+    while (!shuttingdown && !rcvr->disconnect && !proto_err) {
+        /* Start sending as many files as the pipeline allows.  Only
+         * block waiting for a file when nothing is in flight. */
+        if (count < FILE_PIPELINE_DEPTH) {
+            if (count) {
+                err = mqGetNoWait(rcvr->app.r.queue, (void **)&path);
+            } else {
+                err = mqGet(rcvr->app.r.queue, (void **)&path);
+            }
+            if (err == MQ_DISABLED || err == MQ_SHUTDOWN) {
+                assert(shuttingdown || rcvr->disconnect);
+                break;
+            }
+            if (err == MQ_NOERROR) {
+                if (shuttingdown) {
+                    free(path);
+                    break;
+                }
+                if (rcvr->disconnect) {
+                    err = mqPushBack(rcvr->app.r.queue, path);
+                    CHECK_ALLOC(err != MQ_MEMERROR);
+                    if (err != MQ_NOERROR) {
+                        assert(shuttingdown);
+                        free(path);
+                    }
+                    break;
+                }
+                pf = &pipeline[(head + count) % FILE_PIPELINE_DEPTH];
+                pf->path = path;
+                switch (pipelineSendFile(q, channel, rcvr, pf, compmethod)) {
+                  case TR_SUCCEEEDED:
+                    ++count;
+                    break;
+                  case TR_IMPOSSIBLE:
+                    INFOMSG("Unable to send %s to %s", path, rcvr->ident);
+                    free(path);
+                    break;
+                  case TR_FAILED:
+                  case TR_FATAL:
+                    /* part of the file may have been sent; it is
+                     * re-sent with the other files in flight */
+                    ++count;
+                    proto_err = 1;
+                    break;
+                }
+                continue;
+            }
+            assert(err == MQ_EMPTY);
+        }
+
+        /* Handle the next reply, which concerns the oldest file */
+        assert(count > 0);
+        rv = skMsgQueueGetMessage(q, &msg);
+        if (rv == -1) {
+            ASSERT_ABORT(shuttingdown);
+            continue;
+        }
+        pf = &pipeline[head];
+
+        rv = handleDisconnect(msg, rcvr->ident);
+        if (rv != 0) {
+            if (rv == -1) {
+                /* as in transferFiles(), do not retry the file the
+                 * receiver was handling */
+                INFOMSG("Remote side %s rejected %s", rcvr->ident, pf->path);
+                free(pf->path);
+                head = (head + 1) % FILE_PIPELINE_DEPTH;
+                --count;
+            }
+            skMsgDestroy(msg);
+            break;
+        }
+
+        t = skMsgType(msg);
+        if (!pf->ready) {
+            if (t == CONN_DUPLICATE_FILE || t == CONN_REJECT_FILE) {
+                if (t == CONN_DUPLICATE_FILE) {
+                    WARNINGMSG("Duplicate instance of %s on %s.  %s",
+                               pf->name, rcvr->ident,
+                               (char *)skMsgMessage(msg));
+                } else {
+                    WARNINGMSG("File %s was rejected by %s. %s",
+                               pf->name, rcvr->ident,
+                               (char *)skMsgMessage(msg));
+                }
+                handleErrorFile(pf->path, pf->name, rcvr->ident);
+                INFOMSG("Remote side %s rejected %s", rcvr->ident, pf->path);
+                free(pf->path);
+                head = (head + 1) % FILE_PIPELINE_DEPTH;
+                --count;
+            } else {
+                proto_err = checkMsg(msg, q, CONN_NEW_FILE_READY);
+                if (!proto_err) {
+                    DEBUG_PRINT1("Received CONN_NEW_FILE_READY");
+                    pf->ready = 1;
+                }
+            }
+        } else if (0 == (proto_err = checkMsg(msg, q, CONN_FILE_COMPLETE))) {
+            DEBUG_PRINT1("Received CONN_FILE_COMPLETE");
+            finished_time = time(NULL);
+            rv = unlink(pf->path);
+            if (rv != 0) {
+                CRITMSG("Unable to remove '%s' after sending: %s",
+                        pf->path, strerror(errno));
+                fatal_err = 1;
+                proto_err = 1;
+            } else {
+                INFOMSG(("Finished transferring to %s: %s  "
+                         "total: %.0f secs.  wait: %.0f secs.  "
+                         "send: %.0f secs.  size: %" PRIu64 " bytes."),
+                        rcvr->ident, pf->name,
+                        difftime(finished_time, pf->dropoff_time),
+                        difftime(pf->send_time, pf->dropoff_time),
+                        difftime(finished_time, pf->send_time),
+                        pf->size);
+                transferred_file = 1;
+                INFOMSG("Succeeded sending %s to %s", pf->path, rcvr->ident);
+            }
+            free(pf->path);
+            head = (head + 1) % FILE_PIPELINE_DEPTH;
+            --count;
+        }
+        skMsgDestroy(msg);
+    }
+
+    /* Return the unacknowledged files to the queue, newest first, so
+     * they are sent in their original order on the next connection */
+    while (count > 0) {
+        --count;
+        path = pipeline[(head + count) % FILE_PIPELINE_DEPTH].path;
+        if (fatal_err) {
+            free(path);
+            continue;
+        }
+        err = mqPushBack(rcvr->app.r.queue, path);
+        CHECK_ALLOC(err != MQ_MEMERROR);
+        if (err == MQ_NOERROR) {
+            INFOMSG("Will attempt to re-send %s", path);
+        } else {
+            assert(shuttingdown);
+            INFOMSG("Not scheduling %s to %s for retrying",
+                    path, rcvr->ident);
+            free(path);
+        }
+    }
+
+    return (fatal_err ? -1 : transferred_file);
+}
+
+
 /*
  *    This function is called by the handleConnection() function in
  *    rwtransfer.c once the connection has been established.  This
@@ -1671,6 +2488,10 @@ transferFiles(
 
     mqEnable(rcvr->app.r.queue, MQ_REMOVE);
 
+    if (rcvr->remote_version >= PIPELINE_VERSION) {
+        return transferFilesPipelined(q, channel, rcvr);
+    }
+
     while (!shuttingdown && !rcvr->disconnect) {
         char *path;
         mq_err_t err;
@@ -69,6 +69,17 @@ RCSIDENT("$SiLK: rwtransfer.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 #include <silk/skdaemon.h>
 #include "rwtransfer.h"
 
+SK_DIAGNOSTIC_IGNORE_PUSH("-Wundef")
+
+#if SK_ENABLE_ZLIB
+#include <zlib.h>
+#endif
+#if SK_ENABLE_LZO
+#include SK_LZO_HEADER_NAME
+#endif
+
+SK_DIAGNOSTIC_IGNORE_POP("-Wundef")
+
 
 /* LOCAL DEFINES AND TYPEDEFS */
 
@@ -85,7 +96,7 @@ RCSIDENT("$SiLK: rwtransfer.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 #define LOW_VERSION  1
 
 /* Version protocol we emit */
-#define EMIT_VERISION 2
+#define EMIT_VERISION COMPRESSION_VERSION
 
 /* Turn on PKCS12 support */
 #define PKCS12 1
@@ -280,7 +291,9 @@ static connection_msg_data_t conn_msg_data[CONN_NUMBER_OF_CONNECTION_MESSAGES]=
         {"CONN_FILE_BLOCK",       -1},
         {"CONN_FILE_COMPLETE",     0},
         {"CONN_DUPLICATE_FILE",   -1},
-        {"CONN_REJECT_FILE",      -1}
+        {"CONN_REJECT_FILE",      -1},
+        {"CONN_COMPRESSION_METHODS", sizeof(uint32_t)},
+        {"CONN_COMPRESSED_BLOCK", -1}
     };
 
 
@@ -1029,7 +1042,7 @@ handleDisconnect(
     if (msgtyp == CONN_DISCONNECT || msgtyp == CONN_DISCONNECT_RETRY) {
         int length = MAX_ERROR_MESSAGE;
 
-        if (skMsgLength(msg) < length) {
+        if (skMsgLength(msg) < (uint32_t)length) {
             length = skMsgLength(msg);
         }
 
@@ -1699,7 +1712,7 @@ checkMsg(
     connection_msg_t    type)
 {
     skm_type_t t;
-    skm_len_t  len;
+    uint32_t   len;
 
     assert(msg);
     assert(q);
@@ -1724,10 +1737,11 @@ checkMsg(
     }
 
     len = skMsgLength(msg);
-    if (len != conn_msg_data[type].size) {
+    if (len != (uint32_t)conn_msg_data[type].size) {
         sendString(q, skMsgChannel(msg), EXTERNAL,
                    CONN_DISCONNECT, LOG_WARNING,
-                   "Protocol error: type %s, expected len %" PRId32 ", got %d",
+                   ("Protocol error: type %s, expected len %" PRId32
+                    ", got %" PRIu32),
                    conn_msg_data[type].name,
                    conn_msg_data[type].size, len);
         return 1;
@@ -1737,6 +1751,157 @@ checkMsg(
 }
 
 
+#if SK_ENABLE_LZO
+/* LZO must be initialized once before it is used */
+static pthread_once_t lzo_once = PTHREAD_ONCE_INIT;
+static int lzo_initialized = 0;
+
+static void
+transferLzoInit(
+    void)
+{
+    lzo_initialized = (lzo_init() == LZO_E_OK);
+}
+#endif  /* SK_ENABLE_LZO */
+
+
+uint32_t
+transferCompmethodsAvailable(
+    void)
+{
+    uint32_t methods = (1u << SK_COMPMETHOD_NONE);
+
+#if SK_ENABLE_ZLIB
+    methods |= (1u << SK_COMPMETHOD_ZLIB);
+#endif
+#if SK_ENABLE_LZO
+    pthread_once(&lzo_once, transferLzoInit);
+    if (lzo_initialized) {
+        methods |= (1u << SK_COMPMETHOD_LZO1X);
+    }
+#endif
+    return methods;
+}
+
+
+uint32_t
+transferCompressBound(
+    sk_compmethod_t     compmethod,
+    uint32_t            sourcelen)
+{
+    switch (compmethod) {
+#if SK_ENABLE_ZLIB
+      case SK_COMPMETHOD_ZLIB:
+        return compressBound(sourcelen);
+#endif
+#if SK_ENABLE_LZO
+      case SK_COMPMETHOD_LZO1X:
+        /* formula from the lzo faq */
+        return (sourcelen + (sourcelen >> 4) + 64 + 3);
+#endif
+      default:
+        break;
+    }
+    return sourcelen;
+}
+
+
+int
+transferCompress(
+    sk_compmethod_t     compmethod,
+    void               *dest,
+    uint32_t           *destlen,
+    const void         *source,
+    uint32_t            sourcelen)
+{
+    switch (compmethod) {
+#if SK_ENABLE_ZLIB
+      case SK_COMPMETHOD_ZLIB:
+        {
+            uLongf dl = *destlen;
+            int rv;
+
+            /* favor speed; the result is sent once per receiver */
+            rv = compress2((Bytef*)dest, &dl, (const Bytef*)source,
+                           sourcelen, Z_BEST_SPEED);
+            *destlen = dl;
+            return (rv == Z_OK) ? 0 : -1;
+        }
+#endif  /* SK_ENABLE_ZLIB */
+#if SK_ENABLE_LZO
+      case SK_COMPMETHOD_LZO1X:
+        {
+            lzo_uint dl = *destlen;
+            uint8_t *scratch;
+            int rv;
+
+            pthread_once(&lzo_once, transferLzoInit);
+            if (!lzo_initialized) {
+                return -1;
+            }
+            scratch = (uint8_t*)malloc(LZO1X_1_15_MEM_COMPRESS);
+            if (NULL == scratch) {
+                return -1;
+            }
+            rv = lzo1x_1_15_compress((const unsigned char*)source, sourcelen,
+                                     (unsigned char*)dest, &dl, scratch);
+            free(scratch);
+            *destlen = dl;
+            return (rv == LZO_E_OK) ? 0 : -1;
+        }
+#endif  /* SK_ENABLE_LZO */
+      default:
+        break;
+    }
+    return -1;
+}
+
+
+int
+transferUncompress(
+    sk_compmethod_t     compmethod,
+    void               *dest,
+    uint32_t           *destlen,
+    const void         *source,
+    uint32_t            sourcelen)
+{
+    switch (compmethod) {
+#if SK_ENABLE_ZLIB
+      case SK_COMPMETHOD_ZLIB:
+        {
+            uLongf dl = *destlen;
+            int rv;
+
+            rv = uncompress((Bytef*)dest, &dl, (const Bytef*)source,
+                            sourcelen);
+            *destlen = dl;
+            return (rv == Z_OK) ? 0 : -1;
+        }
+#endif  /* SK_ENABLE_ZLIB */
+#if SK_ENABLE_LZO
+      case SK_COMPMETHOD_LZO1X:
+        {
+            lzo_uint dl = *destlen;
+            int rv;
+
+            pthread_once(&lzo_once, transferLzoInit);
+            if (!lzo_initialized) {
+                return -1;
+            }
+            rv = lzo1x_decompress_safe((const unsigned char*)source,
+                                       sourcelen, (unsigned char*)dest,
+                                       &dl, NULL);
+            *destlen = dl;
+            return (rv == LZO_E_OK) ? 0 : -1;
+        }
+#endif  /* SK_ENABLE_LZO */
+      default:
+        break;
+    }
+    return -1;
+}
+
+
 #undef sendString
 int
 sendString(
@@ -67,6 +67,7 @@ RCSIDENTVAR(rcsID_RWTRANSFER_H, "$SiLK: rwtransfer.h b7b8edebba12 2015-01-05 18:
 */
 
 #include <silk/redblack.h>
+#include <silk/silk_files.h>
 #include "libsendrcv.h"
 #include "multiqueue.h"
 #include "skmsg.h"
@@ -84,10 +85,31 @@ RCSIDENTVAR(rcsID_RWTRANSFER_H, "$SiLK: rwtransfer.h b7b8edebba12 2015-01-05 18:
 #define FILE_BLOCK_SIZE         8192
 #define FILE_BLOCK_SIZE_STRING "8192"
 
+/* Block size used with receivers that support pipelined transfers */
+#define LARGE_FILE_BLOCK_SIZE         0x100000
+#define LARGE_FILE_BLOCK_SIZE_STRING "1048576"
+
 /* Minimum block size (Must be larger than message overhead (14 bytes
  * when this comment was last updated) */
 #define MINIMUM_FILE_BLOCK_SIZE 256
 
+/* Maximum block size.  Receivers that do not support pipelined
+ * transfers are sent blocks of at most UINT16_MAX bytes. */
+#define MAXIMUM_FILE_BLOCK_SIZE        SKMSG_LARGE_MESSAGE_MAX
+#define MAXIMUM_FILE_BLOCK_SIZE_STRING "67108864"
+
+/* Lowest protocol version that supports pipelined transfers: the
+ * sender may send multiple files without waiting for replies, blocks
+ * may be larger than UINT16_MAX bytes, and the receiver discards the
+ * blocks of a file it has rejected. */
+#define PIPELINE_VERSION 3
+
+/* Lowest protocol version that supports compressing file content on
+ * the wire.  The receiver tells the sender which compression methods
+ * it can decompress, and the sender may send CONN_COMPRESSED_BLOCK
+ * messages in place of CONN_FILE_BLOCK messages. */
+#define COMPRESSION_VERSION 4
+
 /* Password env postfix */
 #define PASSWORD_ENV_POSTFIX "_TLS_PASSWORD"
 
@@ -155,6 +177,8 @@ typedef enum {
     CONN_FILE_COMPLETE,
     CONN_DUPLICATE_FILE,
     CONN_REJECT_FILE,
+    CONN_COMPRESSION_METHODS,
+    CONN_COMPRESSED_BLOCK,
 
     CONN_NUMBER_OF_CONNECTION_MESSAGES
 } connection_msg_t;
@@ -175,6 +199,16 @@ typedef struct block_info_st {
     uint8_t  block[1];
 } block_info_t;
 
+/* The header of a CONN_COMPRESSED_BLOCK message.  The offset is that
+ * of the uncompressed block within the file. */
+typedef struct compressed_block_info_st {
+    uint32_t high_offset;
+    uint32_t low_offset;
+    uint32_t uncompressed_size;
+    uint32_t compmethod;
+    uint8_t  block[1];
+} compressed_block_info_t;
+
 typedef struct file_map_st {
     void           *map;
     size_t          map_size;
@@ -188,6 +222,41 @@ typedef struct sender_block_info_st {
     file_map_t *ref;
 } sender_block_info_t;
 
+/* The compressed content of a file, shared by every receiver that is
+ * sent the file.  The key identifies the file (all the hard links to
+ * a file in the processing-directory share it), the compression
+ * method, and the block size.  Block 'i' has 'block_len[i]' bytes in
+ * 'data', compressed with 'block_method[i]'. */
+typedef struct compressed_file_st {
+    dev_t           dev;
+    ino_t           ino;
+    uint64_t        size;
+    time_t          mtime;
+    uint32_t        block_size;
+    sk_compmethod_t compmethod;
+
+    uint8_t        *data;
+    size_t          data_size;
+    uint32_t        block_count;
+    uint32_t       *block_len;
+    uint8_t        *block_method;
+
+    /* reference count; protected by the mutex of the cache */
+    uint64_t        count;
+    /* whether the content has been compressed */
+    unsigned        ready  : 1;
+    /* whether compressing the content failed */
+    unsigned        failed : 1;
+} compressed_file_t;
+
+typedef struct sender_compressed_block_st {
+    uint32_t           high_offset;
+    uint32_t           low_offset;
+    uint32_t           uncompressed_size;
+    uint32_t           compmethod;
+    compressed_file_t *ref;
+} sender_compressed_block_t;
+
 typedef struct transfer_st {
     char                *ident;
     sk_sockaddr_array_t *addr;
@@ -296,6 +365,42 @@ checkMsg(
     sk_msg_queue_t     *q,
     connection_msg_t    type);
 
+/* Return a bitmap of the compression methods that may be used on the
+ * wire by this build: bit N is set when method N is available */
+uint32_t
+transferCompmethodsAvailable(
+    void);
+
+/* Return the largest size of 'sourcelen' bytes once compressed with
+ * 'compmethod' */
+uint32_t
+transferCompressBound(
+    sk_compmethod_t     compmethod,
+    uint32_t            sourcelen);
+
+/* Compress 'sourcelen' bytes of 'source' into 'dest' using
+ * 'compmethod'.  '*destlen' is the size of 'dest' on input and the
+ * compressed size on output.  Return 0 on success, -1 on failure. */
+int
+transferCompress(
+    sk_compmethod_t     compmethod,
+    void               *dest,
+    uint32_t           *destlen,
+    const void         *source,
+    uint32_t            sourcelen);
+
+/* Uncompress 'sourcelen' bytes of 'source' into 'dest' using
+ * 'compmethod'.  '*destlen' is the size of 'dest' on input and the
+ * uncompressed size on output.  Return 0 on success, -1 on
+ * failure. */
+int
+transferUncompress(
+    sk_compmethod_t     compmethod,
+    void               *dest,
+    uint32_t           *destlen,
+    const void         *source,
+    uint32_t            sourcelen);
+
 
 #define MSG_FROMTYPE(msg, type) *(type *)skMsgMessage(msg)
 #define MSG_UINT32(msg) ntohl(MSG_FROMTYPE(msg, uint32_t))
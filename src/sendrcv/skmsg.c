@@ -146,6 +146,10 @@ SK_DIAGNOSTIC_IGNORE_POP("-Wdeprecated-declarations")
 
 #define SKMSG_MINIMUM_SYSTEM_CTL_CHANNEL 0xFFFA
 
+/* Bit set in the type of a message on a user channel to denote a
+ * large message, whose 32-bit length follows the header */
+#define SKMSG_TYPE_LARGE 0x8000
+
 /* Diffie-Hellman bits for GnuTLS */
 #define DH_BITS 1024
 
@@ -158,6 +162,17 @@ SK_DIAGNOSTIC_IGNORE_POP("-Wdeprecated-declarations")
 
 /* Define Macros */
 
+/* Whether the message header 'hdr' (in host byte order) is the header
+ * of a large message */
+#define MSG_HDR_IS_LARGE(hdr)                                           \
+    ((hdr)->channel != SKMSG_CHANNEL_CONTROL                            \
+     && ((hdr)->type & SKMSG_TYPE_LARGE))
+
+/* The body length of the large message 'msg' in host byte order */
+#define MSG_LARGE_SIZE(msg)                                             \
+    (((uint32_t)ntohs((msg)->large_size[0]) << 16)                      \
+     | (uint32_t)ntohs((msg)->large_size[1]))
+
 /*
  *  this macro is used when the extra-level debugging statements write
  *  to the log, since we do not want the result of the log's printf()
@@ -371,6 +386,10 @@ typedef struct sk_msg_hdr_st {
 /* typedef struct sk_msg_st sk_msg_t;  // from skmsg.h */
 struct sk_msg_st {
     sk_msg_hdr_t hdr;
+    /* For a large message, the length of the body in network byte
+     * order.  This immediately follows 'hdr' so that both are sent
+     * and received as segment[0]. */
+    uint16_t     large_size[2];
     void       (*free_fn)(uint16_t, struct iovec *);
     void       (*simple_free)(void *);
     uint16_t     segments;
@@ -384,7 +403,10 @@ typedef struct sk_msg_read_buf_st {
     /* Location to read into */
     uint8_t  *loc;
     /* Number of bytes still to read */
-    uint16_t  count;
+    uint32_t  count;
+    /* Whether the bytes being read are the length of a large
+     * message rather than its body */
+    unsigned  reading_size : 1;
 } sk_msg_read_buf_t;
 
 /* Buffer for writing an sk_msg_t; used to support partial writes */
@@ -396,7 +418,7 @@ typedef struct sk_msg_write_buf_st {
     /* The index of the iov segment currently being sent */
     uint16_t    cur_seg;
     /* Number of bytes of the current segment that have been sent */
-    uint16_t    seg_offset;
+    size_t      seg_offset;
 } sk_msg_write_buf_t;
 
 
@@ -1256,6 +1278,69 @@ read_check_pkcs12(
 #endif  /* SK_ENABLE_GNUTLS */
 
 
+/*** Functions common to all transports ***/
+
+/*
+ *    is_complete = recv_alloc_body(buffer, size);
+ *
+ *    Helper for the recv() functions.  Allocate a body of 'size'
+ *    bytes for the message being read into 'buffer' and prepare
+ *    'buffer' to read into it.  Return 1 if 'size' is 0 and the
+ *    message is therefore complete; 0 otherwise.
+ */
+static int
+recv_alloc_body(
+    sk_msg_read_buf_t  *buffer,
+    uint32_t            size)
+{
+    sk_msg_t *msg = buffer->msg;
+
+    if (0 == size) {
+        return 1;
+    }
+    /* Allocate space for the body of the message */
+    msg->segment[1].iov_base = malloc(size);
+    MEM_ASSERT(msg->segment[1].iov_base);
+    msg->segment[1].iov_len = size;
+    msg->segments++;
+
+    /* Maintain state for re-entrant call */
+    buffer->count = size;
+    buffer->loc = (uint8_t*)msg->segment[1].iov_base;
+    return 0;
+}
+
+
+/*
+ *    status = recv_large_body(buffer);
+ *
+ *    Helper for the recv() functions.  Called once the length of a
+ *    large message has been read into 'buffer'.  Verify the length
+ *    and allocate the body.  On return, the count member of 'buffer'
+ *    is 0 if the message has no body.  Return SKMERR_ERROR if the
+ *    length exceeds SKMSG_LARGE_MESSAGE_MAX; 0 otherwise.
+ */
+static int
+recv_large_body(
+    sk_msg_read_buf_t  *buffer)
+{
+    uint32_t size;
+
+    assert(buffer->reading_size);
+    assert(0 == buffer->count);
+
+    buffer->reading_size = 0;
+    size = MSG_LARGE_SIZE(buffer->msg);
+    DEBUG_PRINT2("Receiving large message size=%" PRIu32, size);
+    if (size > SKMSG_LARGE_MESSAGE_MAX) {
+        DEBUG_PRINT2("Large message size %" PRIu32 " exceeds maximum", size);
+        return SKMERR_ERROR;
+    }
+    recv_alloc_body(buffer, size);
+    return 0;
+}
+
+
 /*** TCP functions ***/
 
 /*
@@ -1281,7 +1366,9 @@ tcp_send(
     assert(conn);
     assert(msg->segments);
     assert(msg->segment[0].iov_base == &msg->hdr);
-    assert(msg->segment[0].iov_len  == sizeof(msg->hdr));
+    assert(msg->segment[0].iov_len  == sizeof(msg->hdr)
+           || (msg->segment[0].iov_len
+               == sizeof(msg->hdr) + sizeof(msg->large_size)));
 
     DEBUG_PRINT3("Sending chan=%#x type=%#x",
                  ntohs(msg->hdr.channel), ntohs(msg->hdr.type));
@@ -1407,6 +1494,7 @@ tcp_recv(
         msg->segment[0].iov_base = hdr;
         msg->segment[0].iov_len = sizeof(*hdr);
         memset(hdr, 0, sizeof(*hdr));
+        buffer->reading_size = 0;
 
         /* Read a header */
         hdr_buf = ((uint8_t*)hdr);
@@ -1472,21 +1560,19 @@ tcp_recv(
         DEBUG_PRINT4("Receiving chan=%#x type=%#x size=%d",
                      hdr->channel, hdr->type, hdr->size);
 
-        if (hdr->size == 0) {
+        if (MSG_HDR_IS_LARGE(hdr)) {
+            /* The length of the body follows the header; read it as
+             * though it were the body, then allocate the body */
+            msg->segment[0].iov_len += sizeof(msg->large_size);
+            buffer->count = sizeof(msg->large_size);
+            buffer->loc = (uint8_t*)msg->large_size;
+            buffer->reading_size = 1;
+        } else if (recv_alloc_body(buffer, hdr->size)) {
             /* If the size is zero, the message is complete */
             *message = msg;
             buffer->msg = NULL;
             RETURN(0);
         }
-        /* Allocate space for the body of the message */
-        msg->segment[1].iov_base = malloc(hdr->size);
-        MEM_ASSERT(msg->segment[1].iov_base);
-        msg->segment[1].iov_len = hdr->size;
-        msg->segments++;
-
-        /* Maintain state for re-entrant call */
-        buffer->count = hdr->size;
-        buffer->loc = (uint8_t*)msg->segment[1].iov_base;
 
         /* Fall through to read the rest of the message.  NOTE: Do not
          * fail if the next read() returns 0, since maybe the header
@@ -1526,6 +1612,17 @@ tcp_recv(
         DEBUG_PRINT2("PARTIAL message, %u bytes remaining", buffer->count);
         RETURN(SKMERR_PARTIAL);
     }
+    if (buffer->reading_size) {
+        /* Have the length of a large message; read its body on the
+         * next call */
+        retval = recv_large_body(buffer);
+        if (retval != 0) {
+            goto error;
+        }
+        if (buffer->count) {
+            RETURN(SKMERR_PARTIAL);
+        }
+    }
     /* else, message is complete */
 
     *message = buffer->msg;
@@ -1568,7 +1665,9 @@ tls_send(
     assert(conn->use_tls);
     assert(msg->segments);
     assert(msg->segment[0].iov_base == &msg->hdr);
-    assert(msg->segment[0].iov_len  == sizeof(msg->hdr));
+    assert(msg->segment[0].iov_len  == sizeof(msg->hdr)
+           || (msg->segment[0].iov_len
+               == sizeof(msg->hdr) + sizeof(msg->large_size)));
 
     DEBUG_PRINT3("Sending chan=%#x type=%#x",
                  ntohs(msg->hdr.channel), ntohs(msg->hdr.type));
@@ -1648,6 +1747,7 @@ tls_recv(
         msg->segment[0].iov_base = hdr;
         msg->segment[0].iov_len = sizeof(*hdr);
         memset(hdr, 0, sizeof(*hdr));
+        buffer->reading_size = 0;
 
         /* Read a header.  This code assumes we can read the entire
          * header in one call to gnutls_record_recv(). */
@@ -1684,21 +1784,19 @@ tls_recv(
         DEBUG_PRINT4("Receiving chan=%#x type=%#x size=%d",
                      hdr->channel, hdr->type, hdr->size);
 
-        if (hdr->size == 0) {
+        if (MSG_HDR_IS_LARGE(hdr)) {
+            /* The length of the body follows the header; read it as
+             * though it were the body, then allocate the body */
+            msg->segment[0].iov_len += sizeof(msg->large_size);
+            buffer->count = sizeof(msg->large_size);
+            buffer->loc = (uint8_t*)msg->large_size;
+            buffer->reading_size = 1;
+        } else if (recv_alloc_body(buffer, hdr->size)) {
             /* If the size is zero, the message is complete */
             *message = msg;
             buffer->msg = NULL;
             RETURN(0);
         }
-        /* Allocate space for the body of the message */
-        msg->segment[1].iov_base = malloc(hdr->size);
-        MEM_ASSERT(msg->segment[1].iov_base);
-        msg->segment[1].iov_len = hdr->size;
-        msg->segments++;
-
-        /* Maintain state for re-entrant call */
-        buffer->count = hdr->size;
-        buffer->loc = (uint8_t*)msg->segment[1].iov_base;
 
         /* Fall through to read the rest of the message.  NOTE: Do not
          * fail if the next gnutls_record_recv() returns 0, since
@@ -1740,6 +1838,17 @@ tls_recv(
          * again */
         RETURN(SKMERR_PARTIAL);
     }
+    if (buffer->reading_size) {
+        /* have the length of a large message; read its body on the
+         * next call */
+        retval = recv_large_body(buffer);
+        if (retval != 0) {
+            goto error;
+        }
+        if (buffer->count) {
+            RETURN(SKMERR_PARTIAL);
+        }
+    }
     /* else, message is complete */
 
     *message = buffer->msg;
@@ -2523,7 +2632,7 @@ unblock_connection(
 {
     static sk_msg_t unblocker = {{SKMSG_CHANNEL_CONTROL,
                                   SKMSG_WRITER_UNBLOCKER, 0},
-                                 NULL, NULL, 1, {{NULL, 0}}};
+                                 {0, 0}, NULL, NULL, 1, {{NULL, 0}}};
     skDQErr_t err;
 
     DEBUG_ENTER_FUNC;
@@ -3260,8 +3369,13 @@ writer_thread(
                 continue;
             }
             have_msg = 1;
-            write_buf.msg_size
-                = sizeof(write_buf.msg->hdr) + write_buf.msg->hdr.size;
+            if (MSG_HDR_IS_LARGE(&write_buf.msg->hdr)) {
+                write_buf.msg_size = (write_buf.msg->segment[0].iov_len
+                                      + MSG_LARGE_SIZE(write_buf.msg));
+            } else {
+                write_buf.msg_size
+                    = sizeof(write_buf.msg->hdr) + write_buf.msg->hdr.size;
+            }
             write_buf.cur_seg = 0;
             write_buf.seg_offset = 0;
 
@@ -4240,18 +4354,28 @@ skMsgQueueSendMessageNoCopy(
     RETURN(rv);
 }
 
-int
-skMsgQueueScatterSendMessageNoCopy(
+/*
+ *  status = scatter_send(q, channel, type, num_segments, segments,
+ *                        free_fn, large);
+ *
+ *    Helper for skMsgQueueScatterSendMessageNoCopy() and
+ *    skMsgQueueScatterSendLargeMessageNoCopy().  When 'large' is
+ *    non-zero, send the message as a large message.
+ */
+static int
+scatter_send(
     sk_msg_queue_t     *q,
     skm_channel_t       channel,
     skm_type_t          type,
     uint16_t            num_segments,
     struct iovec       *segments,
-    void              (*free_fn)(uint16_t, struct iovec *))
+    void              (*free_fn)(uint16_t, struct iovec *),
+    int                 large)
 {
     sk_msg_channel_queue_t *chan;
     sk_msg_t               *msg;
     size_t                  size;
+    size_t                  max_size;
     uint16_t                i;
     int                     rv;
 
@@ -4259,6 +4383,12 @@ skMsgQueueScatterSendMessageNoCopy(
 
     assert(q);
     assert((num_segments && segments) || (!num_segments && !segments));
+    assert(offsetof(sk_msg_t, large_size) == sizeof(sk_msg_hdr_t));
+
+    if (type & SKMSG_TYPE_LARGE) {
+        RETURN(-1);
+    }
+    max_size = (large ? SKMSG_LARGE_MESSAGE_MAX : UINT16_MAX);
 
     QUEUE_LOCK(q);
 
@@ -4290,7 +4420,7 @@ skMsgQueueScatterSendMessageNoCopy(
         msg->segment[i + 1] = segments[i];
         size += segments[i].iov_len;
         msg->segments++;
-        if (size > UINT16_MAX) {
+        if (size > max_size) {
             memset(&msg->hdr, 0, sizeof(msg->hdr));
             skMsgDestroy(msg);
             rv = -1;
@@ -4298,7 +4428,15 @@ skMsgQueueScatterSendMessageNoCopy(
         }
     }
 
-    msg->hdr.size = size;
+    if (large) {
+        msg->hdr.type |= SKMSG_TYPE_LARGE;
+        msg->hdr.size = 0;
+        msg->large_size[0] = htons((uint16_t)(size >> 16));
+        msg->large_size[1] = htons((uint16_t)(size & 0xFFFF));
+        msg->segment[0].iov_len += sizeof(msg->large_size);
+    } else {
+        msg->hdr.size = size;
+    }
 
     rv = send_message_internal(chan, msg, SKM_SEND_REMOTE);
     if (rv != 0) {
@@ -4312,6 +4450,34 @@ skMsgQueueScatterSendMessageNoCopy(
 }
 
 
+int
+skMsgQueueScatterSendMessageNoCopy(
+    sk_msg_queue_t     *q,
+    skm_channel_t       channel,
+    skm_type_t          type,
+    uint16_t            num_segments,
+    struct iovec       *segments,
+    void              (*free_fn)(uint16_t, struct iovec *))
+{
+    return scatter_send(q, channel, type, num_segments, segments,
+                        free_fn, 0);
+}
+
+
+int
+skMsgQueueScatterSendLargeMessageNoCopy(
+    sk_msg_queue_t     *q,
+    skm_channel_t       channel,
+    skm_type_t          type,
+    uint16_t            num_segments,
+    struct iovec       *segments,
+    void              (*free_fn)(uint16_t, struct iovec *))
+{
+    return scatter_send(q, channel, type, num_segments, segments,
+                        free_fn, 1);
+}
+
+
 int
 skMsgQueueInjectMessageNoCopy(
     sk_msg_queue_t     *q,
@@ -4553,17 +4719,23 @@ skMsgType(
     DEBUG_ENTER_FUNC;
 
     assert(msg);
+    if (MSG_HDR_IS_LARGE(&msg->hdr)) {
+        RETURN(msg->hdr.type & ~SKMSG_TYPE_LARGE);
+    }
     RETURN(msg->hdr.type);
 }
 
 
-skm_len_t
+uint32_t
 skMsgLength(
     const sk_msg_t     *msg)
 {
     DEBUG_ENTER_FUNC;
 
     assert(msg);
+    if (MSG_HDR_IS_LARGE(&msg->hdr)) {
+        RETURN(MSG_LARGE_SIZE(msg));
+    }
     RETURN(msg->hdr.size);
 }
 
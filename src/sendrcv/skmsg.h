@@ -76,6 +76,12 @@ RCSIDENTVAR(rcsID_SKMSG_H, "$SiLK: skmsg.h b7b8edebba12 2015-01-05 18:05:21Z mth
 /* The message type of non-user-defined error messages */
 #define SKMSG_TYPE_ERROR      0xFFFF
 
+/* The largest body of a message sent by
+ * skMsgQueueScatterSendLargeMessageNoCopy().  User-defined message
+ * types must be less than 0x8000, since the high bit of the type
+ * denotes a large message on the wire. */
+#define SKMSG_LARGE_MESSAGE_MAX  0x4000000
+
 
 /*** Control channel messages ***/
 
@@ -242,6 +248,19 @@ skMsgQueueScatterSendMessageNoCopy(
     struct iovec       *sections,
     void              (*free_fn)(uint16_t, struct iovec *));
 
+/* As skMsgQueueScatterSendMessageNoCopy(), but the total length may
+   be up to SKMSG_LARGE_MESSAGE_MAX bytes.  The remote side must
+   support large messages, which the caller must determine (for
+   example, by protocol version) before using this function. */
+int
+skMsgQueueScatterSendLargeMessageNoCopy(
+    sk_msg_queue_t     *queue,
+    skm_channel_t       channel,
+    skm_type_t          type,
+    uint16_t            num_sections,
+    struct iovec       *sections,
+    void              (*free_fn)(uint16_t, struct iovec *));
+
 
 /* Inject a message (into this message queue). Message is to be freed
    with free_fn  */
@@ -331,7 +350,7 @@ skMsgChannel(
 skm_type_t
 skMsgType(
     const sk_msg_t     *msg);
-skm_len_t
+uint32_t
 skMsgLength(
     const sk_msg_t     *msg);
 const void *
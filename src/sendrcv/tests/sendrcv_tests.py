@@ -102,6 +102,11 @@ global_int     = 0
 
 KILL_DELAY     = 20
 CHUNKSIZE      = 2048
+
+# block size and size of a file too large to compress, in bytes, for
+# testLargeFiles and testLargeFilesCompression
+LARGE_BLOCK_SIZE           = 2 * 1024 * 1024
+LARGE_COMPRESSED_FILE_SIZE = 17 * 1024 * 1024
 OVERWRITE      = False
 LOG_LEVEL      = "info"
 LOG_OUTPUT     = []
@@ -127,7 +132,8 @@ ALL_TESTS = ['testConnectOnlyIPv4Addr', 'testConnectOnlyHostname',
              'testSendRcvKillReceiverClientTLS',
              'testSendRcvKillSenderClientTLS',
              'testMultiple', 'testMultipleTLS',
-             'testFilter', 'testPostCommand']
+             'testFilter', 'testPostCommand', 'testCompression',
+             'testLargeFiles', 'testLargeFilesCompression']
 
 rfiles = None
 
@@ -228,7 +234,7 @@ def check_dh(*daemons):
 
 def create_random_file(suffix="", prefix="random", dir=None, size=(0, 0)):
     (handle, path) = tempfile.mkstemp(suffix, prefix, dir)
-    f = os.fdopen(handle, "w")
+    f = os.fdopen(handle, "wb")
     numbytes = random.randint(size[0], size[1])
     totalbytes = numbytes
     #checksum_sha = sha1_new()
@@ -238,8 +244,8 @@ def create_random_file(suffix="", prefix="random", dir=None, size=(0, 0)):
         try:
             bytes = os.urandom(length)
         except NotImplementedError:
-            bytes = ''.join(chr(random.getrandbits(8))
-                            for x in range(0, length))
+            bytes = bytearray(random.getrandbits(8)
+                              for x in range(0, length))
         f.write(bytes)
         #checksum_sha.update(bytes)
         checksum_md5.update(bytes)
@@ -630,6 +636,7 @@ class Sndrcv_base(Daemon):
 class Rwsender(Sndrcv_base):
 
     def __init__(self, name=None, polling_interval=5, filters=[],
+                 transfer_compression=None, block_size=None,
                  overwrite=None, log_level=None, **kwds):
         if log_level is None:
             log_level = LOG_LEVEL
@@ -640,6 +647,8 @@ class Rwsender(Sndrcv_base):
         self.exe_name = "rwsender"
         self.filters = filters
         self.polling_interval = polling_interval
+        self.transfer_compression = transfer_compression
+        self.block_size = block_size
         self.dirs = ["in", "proc", "error"]
 
     def get_args(self):
@@ -651,6 +660,10 @@ class Rwsender(Sndrcv_base):
                  '--polling-interval', str(self.polling_interval)]
         for ident, regexp in self.filters:
             args.extend(["--filter", ident + ':' + regexp])
+        if self.transfer_compression:
+            args += ['--transfer-compression', self.transfer_compression]
+        if self.block_size:
+            args += ['--block-size', str(self.block_size)]
         return args
 
     def send_random_file(self, suffix="", prefix="random", size=(0, 0)):
@@ -1249,6 +1262,151 @@ def testPostCommand():
         sy.end(noremove=NO_REMOVE)
 
 
+def create_text_file(prefix="text", lines=200000):
+    (handle, path) = tempfile.mkstemp("", prefix)
+    f = os.fdopen(handle, "wb")
+    for i in range(0, lines):
+        f.write(("%d\tsome compressible text\n" % i).encode("ascii"))
+    f.close()
+    return (path, checksum_file(path))
+
+def testCompression():
+    """
+    Test compressing file content in transit with a sender and two
+    receivers.  Both receivers must get the original content of
+    random (incompressible) and text (compressible) files.
+    """
+    global rfiles
+    r1 = Rwreceiver()
+    r2 = Rwreceiver()
+    s1 = Rwsender(transfer_compression="best")
+    sy = System()
+    files = rfiles + [create_text_file()]
+    try:
+        sy.connect([r1, r2], s1)
+        sy.start()
+        trigger((s1, 70, "Connected to remote %s" % r1.name),
+                (r1, 70, "Connected to remote %s" % s1.name),
+                (r2, 70, "Connected to remote %s" % s1.name))
+        trigger((s1, 70, "Connected to remote %s" % r2.name))
+
+        s1.send_files(files)
+        for (f, data) in files:
+            for r in [r1, r2]:
+                trigger((s1, 25,
+                         "Succeeded sending .*/%(file)s to %(name)s"
+                         % {"file": re.escape(os.path.basename(f)),
+                            "name" : r.name}))
+        for f in files:
+            for r in [r1, r2]:
+                (error, path) = r.check_sent(f)
+                if error:
+                    global_log(False, ("Error receiving %s: %s" %
+                                       (os.path.basename(f[0]), error)))
+                    raise FileTransferError()
+        sy.stop()
+        trigger((s1, 25, "Stopped logging"),
+                (r1, 25, "Stopped logging"),
+                (r2, 25, "Stopped logging"))
+    except:
+        traceback.print_exc()
+        sy.stop()
+        raise
+    finally:
+        os.unlink(files[-1][0])
+        sy.end(noremove=NO_REMOVE)
+
+
+def _testLargeFiles(transfer_compression=None, big_file_size=0):
+    global rfiles
+    r1 = Rwreceiver()
+    s1 = Rwsender(transfer_compression=transfer_compression,
+                  block_size=LARGE_BLOCK_SIZE)
+    sy = System()
+    # files of several blocks each, all placed in the incoming
+    # directory at once so that several are in flight together
+    size = (2 * LARGE_BLOCK_SIZE + 1, 3 * LARGE_BLOCK_SIZE)
+    files = [create_random_file(prefix="large", size=size)
+             for x in range(0, 5)]
+    files.append(create_text_file(prefix="largetext", lines=300000))
+    if big_file_size:
+        files.append(create_random_file(prefix="big",
+                                        size=(big_file_size, big_file_size)))
+    # the receiver already holds a file with the name of the second
+    # file, so it rejects that file and skips its blocks
+    skipped = files[1]
+    good = [f for f in files if f is not skipped]
+    try:
+        sy.connect(s1, r1)
+        sy.start()
+        existing = os.path.join(r1.dirname["dest"],
+                                os.path.basename(skipped[0]))
+        f = open(existing, "wb")
+        f.write("already here\n".encode("ascii"))
+        f.close()
+        existing_data = checksum_file(existing)
+        trigger((s1, 70, "Connected to remote %s" % r1.name),
+                (r1, 70, "Connected to remote %s" % s1.name))
+
+        s1.send_files(files)
+        trigger((s1, 60,
+                 "Remote side %(name)s rejected .*/%(file)s"
+                 % {"file": re.escape(os.path.basename(skipped[0])),
+                    "name" : r1.name}))
+        for (f, data) in good:
+            trigger((s1, 60,
+                     "Succeeded sending .*/%(file)s to %(name)s"
+                     % {"file": re.escape(os.path.basename(f)),
+                        "name" : r1.name}))
+        for f in good:
+            (error, path) = r1.check_sent(f)
+            if error:
+                global_log(False, ("Error receiving %s: %s" %
+                                   (os.path.basename(f[0]), error)))
+                raise FileTransferError()
+        # the sender moves the file to a subdirectory of its error
+        # directory named for the receiver
+        error_file = os.path.join(s1.dirname["error"], r1.name,
+                                  os.path.basename(skipped[0]))
+        if (not os.path.exists(error_file)
+            or checksum_file(error_file) != skipped[1]):
+            global_log(False, ("Rejected file %s not in error directory" %
+                               os.path.basename(skipped[0])))
+            raise FileTransferError()
+        if checksum_file(existing) != existing_data:
+            global_log(False, ("Rejected file %s overwrote existing file" %
+                               os.path.basename(skipped[0])))
+            raise FileTransferError()
+        sy.stop()
+        trigger((s1, 25, "Stopped logging"),
+                (r1, 25, "Stopped logging"))
+    except:
+        traceback.print_exc()
+        sy.stop()
+        raise
+    finally:
+        for (f, data) in files:
+            os.unlink(f)
+        sy.end(noremove=NO_REMOVE)
+
+def testLargeFiles():
+    """
+    Test sending files of several multi-megabyte blocks, with several
+    files in flight at once.  The receiver rejects one file, skips its
+    blocks, and must still get the content of the files after it.
+    """
+    _testLargeFiles()
+
+def testLargeFilesCompression():
+    """
+    Test sending files of several multi-megabyte blocks compressed in
+    transit, including a file too large to be compressed that is sent
+    as is.  The receiver rejects one file and skips its blocks.
+    """
+    _testLargeFiles(transfer_compression="best",
+                    big_file_size=LARGE_COMPRESSED_FILE_SIZE)
+
+
 if __name__ == '__main__':
     parser = optparse.OptionParser()
     parser.add_option("--verbose", action="store_true", dest="verbose",